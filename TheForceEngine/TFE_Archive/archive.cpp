@@ -9,6 +9,7 @@
 #include <assert.h>
 #include <string>
 #include <map>
+#include <algorithm>
 
 namespace
 {
@@ -16,6 +17,8 @@ namespace
 	static ArchiveMap s_archives[ARCHIVE_COUNT];
 }
 
+u32 Archive::s_contentVersion = 0;
+
 static const char* c_archiveExt[ARCHIVE_COUNT]=
 {
 	"GOB", // ARCHIVE_GOB
@@ -176,3 +179,33 @@ void Archive::deleteCustomArchive(Archive* archive)
 	}
 	delete archive;
 }
+
+u32 Archive::getContentVersion()
+{
+	return s_contentVersion;
+}
+
+void Archive::buildFileIndex()
+{
+	m_fileIndex.build(getFileCount(), [](u32 id, void* userData) { return ((Archive*)userData)->getFileName(id); }, this);
+	s_contentVersion++;
+}
+
+void Archive::clearFileIndex()
+{
+	m_fileIndex.clear();
+	s_contentVersion++;
+}
+
+size_t Archive::readMapped(void* data, size_t size, size_t fileStart, size_t fileLength)
+{
+	if (m_fileOffset < 0 || size_t(m_fileOffset) >= fileLength) { return 0; }
+	size = std::min(size, fileLength - size_t(m_fileOffset));
+
+	const u8* src = m_mapped.getRange(fileStart + m_fileOffset, size);
+	if (!src) { return 0; }
+
+	memcpy(data, src, size);
+	m_fileOffset += s32(size);
+	return size;
+}
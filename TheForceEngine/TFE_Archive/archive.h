@@ -3,6 +3,8 @@
 
 #include <TFE_System/types.h>
 #include <TFE_FileSystem/paths.h>
+#include <TFE_FileSystem/mappedFile.h>
+#include "fileIndex.h"
 
 enum ArchiveType
 {
@@ -14,8 +16,6 @@ enum ArchiveType
 	ARCHIVE_UNKNOWN = ARCHIVE_COUNT
 };
 
-#define INVALID_FILE 0xffffffff
-
 class Archive
 {
 	// Public API handling the same archive in multiple locations.
@@ -28,6 +28,8 @@ public:
 	static void deleteCustomArchive(Archive* archive);
 
 	static ArchiveType getArchiveTypeFromName(const char* path);
+	// Incremented whenever the file list of any archive changes, so indices built across archives know to rebuild.
+	static u32 getContentVersion();
 	
 	// Public Archive API
 public:
@@ -60,14 +62,28 @@ public:
 	virtual const char* getFileName(u32 index) = 0;
 	virtual size_t getFileLength(u32 index) = 0;
 
+	// Zero-copy access, returns the file contents if the archive is memory mapped or null otherwise.
+	// The data is valid until the archive is closed or modified.
+	virtual const u8* getFileData(u32 index) { return nullptr; }
+
 	// Edit
 	virtual void addFile(const char* fileName, const char* filePath) = 0;
 
 	// Shared Private State
 protected:
+	// Build the name index from getFileCount() and getFileName(), call whenever the file list changes.
+	void buildFileIndex();
+	void clearFileIndex();
+	// Read from a file stored as a contiguous range of the mapped archive, starting at m_fileOffset.
+	size_t readMapped(void* data, size_t size, size_t fileStart, size_t fileLength);
+
 	ArchiveType m_type;
 	char m_name[TFE_MAX_PATH];
 	char m_archivePath[TFE_MAX_PATH];
 
 	s32 m_fileOffset;
+	FileIndex m_fileIndex;
+	MappedFile m_mapped;
+
+	static u32 s_contentVersion;
 };
@@ -0,0 +1,78 @@
+#include <cstring>
+#include <cctype>
+
+#include "fileIndex.h"
+
+u32 FileIndex::hashName(const char* name)
+{
+	// FNV-1a on the lower case name.
+	u32 hash = 2166136261u;
+	for (const u8* c = (const u8*)name; *c; c++)
+	{
+		hash ^= u32(tolower(*c));
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void FileIndex::clear()
+{
+	m_slots.clear();
+	m_mask = 0;
+	m_getName = nullptr;
+	m_userData = nullptr;
+}
+
+void FileIndex::build(u32 count, GetNameFunc getName, void* userData)
+{
+	clear();
+	if (!count || !getName) { return; }
+
+	// Keep the load factor at or below 50%.
+	u32 slotCount = 16;
+	while (slotCount < count * 2) { slotCount <<= 1; }
+	m_slots.resize(slotCount, { 0, INVALID_FILE });
+	m_mask = slotCount - 1;
+	m_getName = getName;
+	m_userData = userData;
+
+	for (u32 id = 0; id < count; id++)
+	{
+		const char* name = getName(id, userData);
+		if (!name) { continue; }
+
+		const u32 hash = hashName(name);
+		u32 slot = hash & m_mask;
+		while (m_slots[slot].id != INVALID_FILE)
+		{
+			if (m_slots[slot].hash == hash && strcasecmp(getName(m_slots[slot].id, userData), name) == 0)
+			{
+				// Duplicate name, the first file is used.
+				break;
+			}
+			slot = (slot + 1) & m_mask;
+		}
+		if (m_slots[slot].id == INVALID_FILE)
+		{
+			m_slots[slot].hash = hash;
+			m_slots[slot].id = id;
+		}
+	}
+}
+
+u32 FileIndex::find(const char* name) const
+{
+	if (m_slots.empty() || !name) { return INVALID_FILE; }
+
+	const u32 hash = hashName(name);
+	u32 slot = hash & m_mask;
+	while (m_slots[slot].id != INVALID_FILE)
+	{
+		if (m_slots[slot].hash == hash && strcasecmp(m_getName(m_slots[slot].id, m_userData), name) == 0)
+		{
+			return m_slots[slot].id;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+	return INVALID_FILE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Case-insensitive hash index used to find files by name.
+// Files are referenced by id, names are looked up through a callback
+// so the index does not need to store copies of the strings.
+// When several files share the same name, the lowest id wins, which
+// matches the result of a linear search.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include <vector>
+
+#define INVALID_FILE 0xffffffff
+
+class FileIndex
+{
+public:
+	typedef const char* (*GetNameFunc)(u32 id, void* userData);
+
+	FileIndex() : m_mask(0), m_getName(nullptr), m_userData(nullptr) {}
+
+	// Build the index for ids [0, count).
+	void build(u32 count, GetNameFunc getName, void* userData);
+	void clear();
+	// Returns the file id or INVALID_FILE.
+	u32  find(const char* name) const;
+
+	static u32 hashName(const char* name);
+
+private:
+	struct Slot
+	{
+		u32 hash;
+		u32 id;
+	};
+
+	std::vector<Slot> m_slots;
+	u32 m_mask;
+	GetNameFunc m_getName;
+	void* m_userData;
+};
@@ -26,6 +26,7 @@ bool GobArchive::create(const char *archivePath)
 	
 	m_fileList.MASTERN = 0;
 	m_fileList.entries = nullptr;
+	clearFileIndex();
 
 	m_file.writeBuffer(&m_header, sizeof(GOB_Header_t));
 	m_file.writeBuffer(&m_fileList.MASTERN, sizeof(long));
@@ -82,12 +83,17 @@ bool GobArchive::open(const char *archivePath)
 	strcpy(m_archivePath, archivePath);
 	m_file.close();
 
+	// Map the archive so files can be read without reopening it, fall back to file reads on failure.
+	m_mapped.open(archivePath);
+	buildFileIndex();
 	return true;
 }
 
 void GobArchive::close()
 {
 	m_file.close();
+	m_mapped.close();
+	clearFileIndex();
 	m_archiveOpen = false;
 	delete[] m_fileList.entries;
 	m_fileList.entries = nullptr;
@@ -98,30 +104,14 @@ bool GobArchive::openFile(const char *file)
 {
 	if (!m_archiveOpen) { return false; }
 
-	m_file.open(m_archivePath, Stream::MODE_READ);
-	m_curFile = -1;
-	m_fileOffset = 0;
-
-	//search for this file.
-	for (s32 i = 0; i < m_fileList.MASTERN; i++)
-	{
-		if (strcasecmp(file, m_fileList.entries[i].NAME) == 0)
-		{
-			m_curFile = i;
-			break;
-		}
-	}
-
-	if (m_curFile == -1)
+	const u32 index = m_fileIndex.find(file);
+	if (index == INVALID_FILE)
 	{
-		m_file.close();
+		m_curFile = -1;
 		TFE_System::logWrite(LOG_ERROR, "GOB", "Failed to load \"%s\" from \"%s\"", file, m_archivePath);
+		return false;
 	}
-	else
-	{
-		m_file.seek(m_fileList.entries[m_curFile].IX);
-	}
-	return m_curFile > -1 ? true : false;
+	return openFile(index);
 }
 
 bool GobArchive::openFile(u32 index)
@@ -130,8 +120,11 @@ bool GobArchive::openFile(u32 index)
 
 	m_curFile = s32(index);
 	m_fileOffset = 0;
-	m_file.open(m_archivePath, Stream::MODE_READ);
-	m_file.seek(m_fileList.entries[m_curFile].IX);
+	if (!m_mapped.isOpen())
+	{
+		m_file.open(m_archivePath, Stream::MODE_READ);
+		m_file.seek(m_fileList.entries[m_curFile].IX);
+	}
 	return true;
 }
 
@@ -144,32 +137,14 @@ void GobArchive::closeFile()
 u32 GobArchive::getFileIndex(const char* file)
 {
 	if (!m_archiveOpen) { return INVALID_FILE; }
-
-	//search for this file.
-	for (s32 i = 0; i < m_fileList.MASTERN; i++)
-	{
-		if (strcasecmp(file, m_fileList.entries[i].NAME) == 0)
-		{
-			return i;
-		}
-	}
-	return INVALID_FILE;
+	return m_fileIndex.find(file);
 }
 
 bool GobArchive::fileExists(const char *file)
 {
 	if (!m_archiveOpen) { return false; }
 	m_curFile = -1;
-
-	//search for this file.
-	for (s32 i = 0; i < m_fileList.MASTERN; i++)
-	{
-		if (strcasecmp(file, m_fileList.entries[i].NAME) == 0)
-		{
-			return true;
-		}
-	}
-	return false;
+	return m_fileIndex.find(file) != INVALID_FILE;
 }
 
 bool GobArchive::fileExists(u32 index)
@@ -188,6 +163,10 @@ size_t GobArchive::readFile(void *data, size_t size)
 {
 	if (m_curFile < 0) { return false; }
 	if (size == 0) { size = m_fileList.entries[m_curFile].LEN; }
+	if (m_mapped.isOpen())
+	{
+		return readMapped(data, size, m_fileList.entries[m_curFile].IX, m_fileList.entries[m_curFile].LEN);
+	}
 	const size_t sizeToRead = std::min(size, (size_t)m_fileList.entries[m_curFile].LEN);
 
 	u32 bytesRead = m_file.readBuffer(data, (u32)sizeToRead);
@@ -222,7 +201,10 @@ bool GobArchive::seekFile(s32 offset, s32 origin)
 		return false;
 	}
 
-	m_file.seek(m_fileList.entries[m_curFile].IX + m_fileOffset);
+	if (!m_mapped.isOpen())
+	{
+		m_file.seek(m_fileList.entries[m_curFile].IX + m_fileOffset);
+	}
 	return true;
 }
 
@@ -250,6 +232,12 @@ size_t GobArchive::getFileLength(u32 index)
 	return m_fileList.entries[index].LEN;
 }
 
+const u8* GobArchive::getFileData(u32 index)
+{
+	if (!m_archiveOpen || index >= getFileCount()) { return nullptr; }
+	return m_mapped.getRange(m_fileList.entries[index].IX, m_fileList.entries[index].LEN);
+}
+
 // Edit
 void GobArchive::addFile(const char* fileName, const char* filePath)
 {
@@ -259,6 +247,10 @@ void GobArchive::addFile(const char* fileName, const char* filePath)
 		return;
 	}
 	const size_t len = file.getSize();
+	// The archive is rewritten below, so it cannot stay mapped.
+	const bool wasMapped = m_mapped.isOpen();
+	m_mapped.close();
+
 	const long newId = m_fileList.MASTERN;
 	m_fileList.MASTERN++;
 	GOB_Entry_t* newEntries = new GOB_Entry_t[m_fileList.MASTERN];
@@ -302,4 +294,10 @@ void GobArchive::addFile(const char* fileName, const char* filePath)
 		m_file.writeBuffer(m_fileList.entries, sizeof(GOB_Entry_t), m_fileList.MASTERN);
 		m_file.close();
 	}
+
+	if (wasMapped)
+	{
+		m_mapped.open(m_archivePath);
+	}
+	buildFileIndex();
 }
@@ -37,6 +37,7 @@ public:
 	u32 getFileCount() override;
 	const char* getFileName(u32 index) override;
 	size_t getFileLength(u32 index) override;
+	const u8* getFileData(u32 index) override;
 
 	// Validation
 	static bool validate(const char *archivePath, s32 minFileCount = 1);
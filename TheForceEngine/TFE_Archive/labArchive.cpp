@@ -36,13 +36,18 @@ bool LabArchive::open(const char *archivePath)
 	m_file.close();
 		
 	strcpy(m_archivePath, archivePath);
-	
+
+	// Map the archive so files can be read without reopening it, fall back to file reads on failure.
+	m_mapped.open(archivePath);
+	buildFileIndex();
 	return true;
 }
 
 void LabArchive::close()
 {
 	m_file.close();
+	m_mapped.close();
+	clearFileIndex();
 	m_archiveOpen = false;
 	delete[] m_entries;
 	delete[] m_stringTable;
@@ -53,30 +58,14 @@ bool LabArchive::openFile(const char *file)
 {
 	if (!m_archiveOpen) { return false; }
 
-	m_file.open(m_archivePath, Stream::MODE_READ);
-	m_curFile = -1;
-	m_fileOffset = 0;
-
-	//search for this file.
-	for (u32 i = 0; i < m_header.fileCount; i++)
-	{
-		if (strcasecmp(file, &m_stringTable[m_entries[i].nameOffset]) == 0)
-		{
-			m_curFile = i;
-			break;
-		}
-	}
-
-	if (m_curFile == -1)
+	const u32 index = m_fileIndex.find(file);
+	if (index == INVALID_FILE)
 	{
-		m_file.close();
-		TFE_System::logWrite(LOG_ERROR, "GOB", "Failed to load \"%s\" from \"%s\"", file, m_archivePath);
-	}
-	else
-	{
-		m_file.seek(m_entries[m_curFile].dataOffset);
+		m_curFile = -1;
+		TFE_System::logWrite(LOG_ERROR, "LAB", "Failed to load \"%s\" from \"%s\"", file, m_archivePath);
+		return false;
 	}
-	return m_curFile > -1 ? true : false;
+	return openFile(index);
 }
 
 bool LabArchive::openFile(u32 index)
@@ -85,8 +74,11 @@ bool LabArchive::openFile(u32 index)
 
 	m_curFile = s32(index);
 	m_fileOffset = 0;
-	m_file.open(m_archivePath, Stream::MODE_READ);
-	m_file.seek(m_entries[m_curFile].dataOffset);
+	if (!m_mapped.isOpen())
+	{
+		m_file.open(m_archivePath, Stream::MODE_READ);
+		m_file.seek(m_entries[m_curFile].dataOffset);
+	}
 	return true;
 }
 
@@ -100,32 +92,14 @@ u32 LabArchive::getFileIndex(const char* file)
 {
 	if (!m_archiveOpen) { return INVALID_FILE; }
 	m_curFile = -1;
-
-	//search for this file.
-	for (u32 i = 0; i < m_header.fileCount; i++)
-	{
-		if (strcasecmp(file, &m_stringTable[m_entries[i].nameOffset]) == 0)
-		{
-			return i;
-		}
-	}
-	return INVALID_FILE;
+	return m_fileIndex.find(file);
 }
 
 bool LabArchive::fileExists(const char *file)
 {
 	if (!m_archiveOpen) { return false; }
 	m_curFile = -1;
-
-	//search for this file.
-	for (u32 i = 0; i < m_header.fileCount; i++)
-	{
-		if (strcasecmp(file, &m_stringTable[m_entries[i].nameOffset]) == 0)
-		{
-			return true;
-		}
-	}
-	return false;
+	return m_fileIndex.find(file) != INVALID_FILE;
 }
 
 bool LabArchive::fileExists(u32 index)
@@ -144,6 +118,10 @@ size_t LabArchive::readFile(void *data, size_t size)
 {
 	if (m_curFile < 0) { return false; }
 	if (size == 0) { size = m_entries[m_curFile].len; }
+	if (m_mapped.isOpen())
+	{
+		return readMapped(data, size, m_entries[m_curFile].dataOffset, m_entries[m_curFile].len);
+	}
 	const size_t sizeToRead = std::min(size, (size_t)m_entries[m_curFile].len);
 
 	size_t bytesRead = m_file.readBuffer(data, (u32)sizeToRead);
@@ -178,7 +156,10 @@ bool LabArchive::seekFile(s32 offset, s32 origin)
 		return false;
 	}
 
-	m_file.seek(m_entries[m_curFile].dataOffset + m_fileOffset);
+	if (!m_mapped.isOpen())
+	{
+		m_file.seek(m_entries[m_curFile].dataOffset + m_fileOffset);
+	}
 	return true;
 }
 
@@ -206,6 +187,12 @@ size_t LabArchive::getFileLength(u32 index)
 	return m_entries[index].len;
 }
 
+const u8* LabArchive::getFileData(u32 index)
+{
+	if (!m_archiveOpen || index >= getFileCount()) { return nullptr; }
+	return m_mapped.getRange(m_entries[index].dataOffset, m_entries[index].len);
+}
+
 // Edit
 void LabArchive::addFile(const char* fileName, const char* filePath)
 {
@@ -63,12 +63,17 @@ bool LfdArchive::open(const char *archivePath)
 	strcpy(m_archivePath, archivePath);
 	m_file.close();
 
+	// Map the archive so files can be read without reopening it, fall back to file reads on failure.
+	m_mapped.open(archivePath);
+	buildFileIndex();
 	return true;
 }
 
 void LfdArchive::close()
 {
 	m_file.close();
+	m_mapped.close();
+	clearFileIndex();
 	m_archiveOpen = false;
 
 	if (m_fileList.entries)
@@ -83,30 +88,14 @@ bool LfdArchive::openFile(const char *file)
 {
 	if (!m_archiveOpen) { return false; }
 
-	m_file.open(m_archivePath, Stream::MODE_READ);
-	m_curFile = -1;
-	m_fileOffset = 0;
-
-	//search for this file.
-	for (s32 i = 0; i < m_fileList.MASTERN; i++)
-	{
-		if (strcasecmp(file, m_fileList.entries[i].NAME) == 0)
-		{
-			m_curFile = i;
-			break;
-		}
-	}
-
-	if (m_curFile == -1)
+	const u32 index = m_fileIndex.find(file);
+	if (index == INVALID_FILE)
 	{
-		m_file.close();
+		m_curFile = -1;
 		TFE_System::logWrite(LOG_ERROR, "LFD", "Failed to load \"%s\" from \"%s\"", file, m_archivePath);
+		return false;
 	}
-	else
-	{
-		m_file.seek(m_fileList.entries[m_curFile].IX);
-	}
-	return m_curFile > -1 ? true : false;
+	return openFile(index);
 }
 
 bool LfdArchive::openFile(u32 index)
@@ -115,8 +104,11 @@ bool LfdArchive::openFile(u32 index)
 
 	m_curFile = s32(index);
 	m_fileOffset = 0;
-	m_file.open(m_archivePath, Stream::MODE_READ);
-	m_file.seek(m_fileList.entries[m_curFile].IX);
+	if (!m_mapped.isOpen())
+	{
+		m_file.open(m_archivePath, Stream::MODE_READ);
+		m_file.seek(m_fileList.entries[m_curFile].IX);
+	}
 	return true;
 }
 
@@ -130,32 +122,14 @@ u32 LfdArchive::getFileIndex(const char* file)
 {
 	if (!m_archiveOpen) { return INVALID_FILE; }
 	m_curFile = -1;
-
-	//search for this file.
-	for (s32 i = 0; i < m_fileList.MASTERN; i++)
-	{
-		if (strcasecmp(file, m_fileList.entries[i].NAME) == 0)
-		{
-			return i;
-		}
-	}
-	return INVALID_FILE;
+	return m_fileIndex.find(file);
 }
 
 bool LfdArchive::fileExists(const char *file)
 {
 	if (!m_archiveOpen) { return false; }
 	m_curFile = -1;
-
-	//search for this file.
-	for (s32 i = 0; i < m_fileList.MASTERN; i++)
-	{
-		if (strcasecmp(file, m_fileList.entries[i].NAME) == 0)
-		{
-			return true;
-		}
-	}
-	return false;
+	return m_fileIndex.find(file) != INVALID_FILE;
 }
 
 bool LfdArchive::fileExists(u32 index)
@@ -174,6 +148,10 @@ size_t LfdArchive::readFile(void *data, size_t size)
 {
 	if (m_curFile < 0) { return false; }
 	if (size == 0) { size = m_fileList.entries[m_curFile].LENGTH; }
+	if (m_mapped.isOpen())
+	{
+		return readMapped(data, size, m_fileList.entries[m_curFile].IX, m_fileList.entries[m_curFile].LENGTH);
+	}
 	const size_t sizeToRead = std::min(size, (size_t)m_fileList.entries[m_curFile].LENGTH);
 
 	size_t bytesRead = m_file.readBuffer(data, (u32)sizeToRead);
@@ -208,7 +186,10 @@ bool LfdArchive::seekFile(s32 offset, s32 origin)
 		return false;
 	}
 
-	m_file.seek(m_fileList.entries[m_curFile].IX + m_fileOffset);
+	if (!m_mapped.isOpen())
+	{
+		m_file.seek(m_fileList.entries[m_curFile].IX + m_fileOffset);
+	}
 	return true;
 }
 
@@ -236,6 +217,12 @@ size_t LfdArchive::getFileLength(u32 index)
 	return m_fileList.entries[index].LENGTH;
 }
 
+const u8* LfdArchive::getFileData(u32 index)
+{
+	if (!m_archiveOpen || index >= getFileCount()) { return nullptr; }
+	return m_mapped.getRange(m_fileList.entries[index].IX, m_fileList.entries[index].LENGTH);
+}
+
 // Edit
 void LfdArchive::addFile(const char* fileName, const char* filePath)
 {
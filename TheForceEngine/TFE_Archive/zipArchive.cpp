@@ -1,30 +1,178 @@
 #include "zipArchive.h"
 #include <TFE_FileSystem/fileutil.h>
 #include <TFE_System/system.h>
-#include "zip/zip.h"
+#include <TFE_System/profiler.h>
+#include <TFE_System/Threads/mutex.h>
 #include <assert.h>
+#include <string.h>
 #include <string>
 #include <algorithm>
-#include <map>
+#include <list>
+#include <unordered_map>
+
+// The miniz implementation is compiled with the zip library.
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "zip/miniz.h"
+
+// Inflate state used to read entries too large to cache.
+struct ZipStreamState
+{
+	tinfl_decompressor inflator;
+	u8 dict[TINFL_LZ_DICT_SIZE];	// Wrapping output window, deflate never references more than 32KB back.
+
+	const u8* src;
+	size_t srcSize;
+	size_t srcPos;
+
+	size_t outPos;		// Uncompressed position of the next byte handed to the reader.
+	size_t dictPos;		// Where the next inflate call writes into the window.
+	size_t readPos;		// Start of the inflated bytes not consumed yet.
+	size_t available;	// Number of inflated bytes not consumed yet.
+	bool done;
+};
 
 namespace
 {
-	const size_t c_blockShift = 8;	// 256 bytes.
-	const size_t c_blockSize = 1 << c_blockShift;
+	enum
+	{
+		ZIP_METHOD_STORED = 0,
+		ZIP_METHOD_DEFLATE = 8,
+		ZIP_LOCAL_HEADER_SIG = 0x04034b50,
+		ZIP_LOCAL_HEADER_SIZE = 30,
+	};
+
+	// Budget for the decompressed entries shared by all zip archives.
+	const size_t c_entryCacheBudget = 32 * 1024 * 1024;
+	// Larger entries are streamed instead of cached so a single file cannot flush the whole cache.
+	const size_t c_maxCachedEntry = c_entryCacheBudget / 4;
+
+	struct CachedEntry
+	{
+		u64 key;
+		u8* data;
+		size_t size;
+		s32 pinCount;
+	};
+	typedef std::list<CachedEntry> EntryList;
+
+	// Most recently used entries are at the front.
+	static EntryList s_entryLru;
+	static std::unordered_map<u64, EntryList::iterator> s_entryLookup;
+	static size_t s_entryCacheSize = 0;
+	// Created with the first open archive and freed with the last.
+	static Mutex* s_entryMutex = nullptr;
+	static u32 s_openArchiveCount = 0;
+	static u32 s_nextArchiveId = 1;
+
+	u64 getEntryKey(u32 archiveId, u32 index)
+	{
+		return (u64(archiveId) << 32ull) | u64(index);
+	}
+
+	// Evict unpinned entries, least recently used first, until 'size' more bytes fit in the budget.
+	void evictEntries(size_t size)
+	{
+		EntryList::iterator iEntry = s_entryLru.end();
+		while (s_entryCacheSize + size > c_entryCacheBudget && iEntry != s_entryLru.begin())
+		{
+			--iEntry;
+			if (iEntry->pinCount > 0) { continue; }
+
+			s_entryCacheSize -= iEntry->size;
+			s_entryLookup.erase(iEntry->key);
+			free(iEntry->data);
+			iEntry = s_entryLru.erase(iEntry);
+		}
+	}
+
+	// Returns the cached data and pins it, or null if the entry is not in the cache.
+	const u8* pinEntry(u64 key)
+	{
+		s_entryMutex->lock();
+		const u8* data = nullptr;
+		auto iEntry = s_entryLookup.find(key);
+		if (iEntry != s_entryLookup.end())
+		{
+			s_entryLru.splice(s_entryLru.begin(), s_entryLru, iEntry->second);
+			iEntry->second->pinCount++;
+			data = iEntry->second->data;
+		}
+		s_entryMutex->unlock();
+		return data;
+	}
+
+	void unpinEntry(u64 key)
+	{
+		s_entryMutex->lock();
+		auto iEntry = s_entryLookup.find(key);
+		if (iEntry != s_entryLookup.end())
+		{
+			assert(iEntry->second->pinCount > 0);
+			iEntry->second->pinCount--;
+		}
+		// Entries added while everything else was pinned may have pushed the cache over budget.
+		evictEntries(0);
+		s_entryMutex->unlock();
+	}
+
+	// Takes ownership of 'data' and returns the cached copy, pinned if requested.
+	// If another reader added the entry first, 'data' is freed and the existing copy is returned.
+	const u8* addEntry(u64 key, u8* data, size_t size, bool pin)
+	{
+		s_entryMutex->lock();
+		auto iExisting = s_entryLookup.find(key);
+		if (iExisting != s_entryLookup.end())
+		{
+			free(data);
+			CachedEntry& entry = *iExisting->second;
+			if (pin) { entry.pinCount++; }
+			s_entryMutex->unlock();
+			return entry.data;
+		}
+
+		evictEntries(size);
+		s_entryLru.push_front({ key, data, size, pin ? 1 : 0 });
+		s_entryLookup[key] = s_entryLru.begin();
+		s_entryCacheSize += size;
+		s_entryMutex->unlock();
+		return data;
+	}
 
-	size_t roundBufferSize(size_t size)
+	// Remove all of the entries belonging to an archive, none of them can be pinned.
+	void removeArchiveEntries(u32 archiveId)
 	{
-		size = (size + c_blockSize - 1) >> c_blockShift;
-		return size << c_blockShift;
+		s_entryMutex->lock();
+		EntryList::iterator iEntry = s_entryLru.begin();
+		while (iEntry != s_entryLru.end())
+		{
+			if (u32(iEntry->key >> 32ull) != archiveId)
+			{
+				++iEntry;
+				continue;
+			}
+			assert(iEntry->pinCount == 0);
+			s_entryCacheSize -= iEntry->size;
+			s_entryLookup.erase(iEntry->key);
+			free(iEntry->data);
+			iEntry = s_entryLru.erase(iEntry);
+		}
+		s_entryMutex->unlock();
+	}
+
+	u32 readU16(const u8* data)
+	{
+		return u32(data[0]) | (u32(data[1]) << 8u);
+	}
+
+	u32 readU32(const u8* data)
+	{
+		return readU16(data) | (readU16(data + 2) << 16u);
 	}
 }
 
 ZipArchive::~ZipArchive()
 {
-	free(m_tempBuffer);
-	m_tempBuffer = nullptr;
-	m_tempBufferSize = 0;
-
 	close();
 }
 
@@ -38,44 +186,73 @@ bool ZipArchive::open(const char *archivePath)
 	m_curFile = INVALID_FILE;
 	m_entryCount = 0;
 	m_fileOffset = 0;
-	m_tempBuffer = nullptr;
-	m_tempBufferSize = 0;
-
-	struct zip_t* zip = zip_open(archivePath, 0, 'r');
-	if (!zip)
+	// Keep the archive open for the lifetime of the ZipArchive. Read the directory and entries straight
+	// from the mapping when possible, falling back to regular file reads otherwise.
+	mz_zip_archive* zip = new mz_zip_archive;
+	memset(zip, 0, sizeof(mz_zip_archive));
+	bool zipOpen;
+	if (m_mapped.open(archivePath))
+	{
+		zipOpen = mz_zip_reader_init_mem(zip, m_mapped.getData(), m_mapped.getSize(), 0) != 0;
+	}
+	else
+	{
+		zipOpen = mz_zip_reader_init_file(zip, archivePath, 0) != 0;
+	}
+	if (!zipOpen)
 	{
 		TFE_System::logWrite(LOG_ERROR, "zipArchive", "Cannot open Zip Archive '%s'", archivePath);
+		delete zip;
+		m_mapped.close();
 		return false;
 	}
 
 	// Read the directory.
-	m_entryCount = zip_total_entries(zip);
+	m_entryCount = s32(mz_zip_reader_get_num_files(zip));
 	if (m_entryCount <= 0)
 	{
 		TFE_System::logWrite(LOG_ERROR, "zipArchive", "Zip Archive '%s' is empty.", archivePath);
-		zip_close(zip);
+		mz_zip_reader_end(zip);
+		delete zip;
+		m_mapped.close();
+		m_entryCount = 0;
 		return false;
 	}
 	m_entries = new ZipEntry[m_entryCount];
 
 	for (s32 i = 0; i < m_entryCount; i++)
 	{
-		if (zip_entry_openbyindex(zip, i) != 0)
+		mz_zip_archive_file_stat stat;
+		if (!mz_zip_reader_file_stat(zip, mz_uint(i), &stat))
 		{
 			TFE_System::logWrite(LOG_ERROR, "zipArchive", "Cannot read entry '%d' from archive '%s'", i, archivePath);
-			zip_close(zip);
+			mz_zip_reader_end(zip);
+			delete zip;
+			m_mapped.close();
+			delete[] m_entries;
+			m_entries = nullptr;
+			m_entryCount = 0;
 			return false;
 		}
 
-		m_entries[i].isDir = (zip_entry_isdir(zip) == 1);
-		m_entries[i].name = zip_entry_name(zip);
-		m_entries[i].length = (size_t)zip_entry_size(zip);
-		zip_entry_close(zip);
+		m_entries[i].isDir = mz_zip_reader_is_file_a_directory(zip, mz_uint(i)) != 0;
+		m_entries[i].name = stat.m_filename;
+		m_entries[i].length = (size_t)stat.m_uncomp_size;
+		m_entries[i].compressedLength = (size_t)stat.m_comp_size;
+		m_entries[i].localHeaderOffset = (size_t)stat.m_local_header_ofs;
+		// Encrypted entries are left to miniz, which will refuse them.
+		m_entries[i].method = (stat.m_bit_flag & 1) ? 0xffffffffu : stat.m_method;
 	}
-	zip_close(zip);
 
 	strcpy(m_archivePath, archivePath);
-	m_fileHandle = nullptr;
+	m_fileHandle = zip;
+	m_archiveId = s_nextArchiveId++;
+	if (!s_openArchiveCount)
+	{
+		s_entryMutex = Mutex::create();
+	}
+	s_openArchiveCount++;
+	buildFileIndex();
 
 	return true;
 }
@@ -83,79 +260,70 @@ bool ZipArchive::open(const char *archivePath)
 void ZipArchive::close()
 {
 	closeFile();
+	if (m_fileHandle)
+	{
+		mz_zip_archive* zip = (mz_zip_archive*)m_fileHandle;
+		mz_zip_reader_end(zip);
+		delete zip;
+		m_fileHandle = nullptr;
+	}
+	if (m_archiveId)
+	{
+		removeArchiveEntries(m_archiveId);
+		m_archiveId = 0;
+
+		s_openArchiveCount--;
+		if (!s_openArchiveCount)
+		{
+			delete s_entryMutex;
+			s_entryMutex = nullptr;
+		}
+	}
+	m_mapped.close();
+	clearFileIndex();
+
+	delete m_stream;
+	m_stream = nullptr;
 
 	delete[] m_entries;
 	m_entries = nullptr;
+	m_entryCount = 0;
 	m_curFile = INVALID_FILE;
 }
 
 // File Access
 bool ZipArchive::openFile(const char *file)
 {
-	m_curFile = getFileIndex(file);
-	m_fileOffset = 0;
-	if (m_curFile != INVALID_FILE)
-	{
-		m_fileHandle = zip_open(m_archivePath, 0, 'r');
-		if (zip_entry_openbyindex((struct zip_t*)m_fileHandle, m_curFile) != 0)
-		{
-			TFE_System::logWrite(LOG_ERROR, "zipArchive", "Cannot open file '%s' from archive '%s'", file, m_archivePath);
-			m_curFile = INVALID_FILE;
-			zip_close((struct zip_t*)m_fileHandle);
-			m_fileHandle = nullptr;
-		}
-	}
-
-	// Make sure our temp buffer is large enough to hold the entry.
-	if (m_curFile != INVALID_FILE && m_tempBufferSize < m_entries[m_curFile].length)
+	const u32 index = getFileIndex(file);
+	if (index == INVALID_FILE)
 	{
-		m_tempBufferSize = roundBufferSize(m_entries[m_curFile].length);
-		m_tempBuffer = (u8*)realloc(m_tempBuffer, m_tempBufferSize);
+		closeFile();
+		return false;
 	}
-	m_entryRead = false;
-
-	return m_curFile != INVALID_FILE;
+	return openFile(index);
 }
 
 bool ZipArchive::openFile(u32 index)
 {
-	m_curFile = INVALID_FILE;
+	closeFile();
 	m_fileOffset = 0;
-	if (index <= (u32)m_entryCount)
-	{
-		// Open the system file.
-		m_fileHandle = zip_open(m_archivePath, 0, 'r');
-		// Open the file entry itself.
-		m_curFile = index;
-		if (zip_entry_openbyindex((struct zip_t*)m_fileHandle, index) != 0)
-		{
-			TFE_System::logWrite(LOG_ERROR, "zipArchive", "Cannot open file '%s' from archive '%s'", m_entries[index].name.c_str(), m_archivePath);
-			m_curFile = INVALID_FILE;
-			zip_close((struct zip_t*)m_fileHandle);
-			m_fileHandle = nullptr;
-		}
-	}
-
-	// Make sure our temp buffer is large enough to hold the entry.
-	if (m_curFile != INVALID_FILE && m_tempBufferSize < m_entries[m_curFile].length)
+	if (!m_fileHandle || index >= (u32)m_entryCount)
 	{
-		m_tempBufferSize = roundBufferSize(m_entries[m_curFile].length);
-		m_tempBuffer = (u8*)realloc(m_tempBuffer, m_tempBufferSize);
+		return false;
 	}
-	m_entryRead = false;
 
-	return m_curFile != INVALID_FILE;
+	m_curFile = index;
+	// Restart the stream if the previous file was streamed.
+	if (m_stream) { m_stream->src = nullptr; }
+	return true;
 }
 
 void ZipArchive::closeFile()
 {
-	if (m_fileHandle)
+	if (m_cachedData)
 	{
-		// Close the file entry.
-		zip_entry_close((struct zip_t*)m_fileHandle);
-		// Close the system file.
-		zip_close((struct zip_t*)m_fileHandle);
-		m_fileHandle = nullptr;
+		unpinEntry(getEntryKey(m_archiveId, m_curFile));
+		m_cachedData = nullptr;
 	}
 	m_curFile = INVALID_FILE;
 }
@@ -172,14 +340,7 @@ bool ZipArchive::fileExists(u32 index)
 
 u32 ZipArchive::getFileIndex(const char* file)
 {
-	for (s32 i = 0; i < m_entryCount; i++)
-	{
-		if (strcasecmp(file, m_entries[i].name.c_str()) == 0)
-		{
-			return i;
-		}
-	}
-	return INVALID_FILE;
+	return m_fileIndex.find(file);
 }
 
 size_t ZipArchive::getFileLength()
@@ -188,41 +349,175 @@ size_t ZipArchive::getFileLength()
 	return m_entries[m_curFile].length;
 }
 
+// Returns the compressed data of an entry within the mapped archive, or null if it is not mapped.
+const u8* ZipArchive::getCompressedData(u32 index)
+{
+	if (!m_mapped.isOpen()) { return nullptr; }
+
+	const ZipEntry& entry = m_entries[index];
+	const u8* header = m_mapped.getRange(entry.localHeaderOffset, ZIP_LOCAL_HEADER_SIZE);
+	if (!header || readU32(header) != ZIP_LOCAL_HEADER_SIG) { return nullptr; }
+
+	// The local name and extra field lengths may differ from the central directory.
+	const size_t dataOffset = entry.localHeaderOffset + ZIP_LOCAL_HEADER_SIZE + readU16(header + 26) + readU16(header + 28);
+	return m_mapped.getRange(dataOffset, entry.compressedLength);
+}
+
+const u8* ZipArchive::getFileData(u32 index)
+{
+	if (index >= (u32)m_entryCount || m_entries[index].method != ZIP_METHOD_STORED) { return nullptr; }
+	return getCompressedData(index);
+}
+
+bool ZipArchive::extractEntry(u32 index, void* data)
+{
+	TFE_ZONE("Zip Extract");
+	const ZipEntry& entry = m_entries[index];
+	if (entry.length == 0) { return true; }
+	return mz_zip_reader_extract_to_mem_no_alloc((mz_zip_archive*)m_fileHandle, index, data, entry.length, 0, nullptr, 0) != 0;
+}
+
 size_t ZipArchive::readFile(void *data, size_t size)
 {
-	if (m_curFile == INVALID_FILE) { return false; }
-	if (size == 0) { size = m_entries[m_curFile].length; }
+	if (m_curFile == INVALID_FILE) { return 0; }
+	const ZipEntry& entry = m_entries[m_curFile];
+	if (size == 0) { size = entry.length; }
+	if (m_fileOffset < 0 || size_t(m_fileOffset) >= entry.length) { return 0; }
+	const size_t sizeToRead = std::min(size, entry.length - size_t(m_fileOffset));
 
-	const size_t sizeToRead = std::min(size, m_entries[m_curFile].length);
-	// The fast path is to just read the entire entry into the provided memory, avoiding the extra memcopy.
-	// This is only done if we are reading the entire file and there is no offset.
-	if (m_fileOffset == 0 && sizeToRead == m_entries[m_curFile].length)
+	// Stored entries are read directly from the mapping.
+	if (entry.method == ZIP_METHOD_STORED)
 	{
-		m_fileOffset += (s32)sizeToRead;
-		return zip_entry_noallocread((struct zip_t*)m_fileHandle, data, sizeToRead);
+		const u8* src = getCompressedData(m_curFile);
+		if (src) { return readMapped(data, size, src - m_mapped.getData(), entry.length); }
 	}
 
-	// Otherwise go through the slower path - a one time decompression and read, followed
-	// by memcopying the data into the output as needed.
-	if (!m_entryRead)
+	const u64 key = getEntryKey(m_archiveId, m_curFile);
+	if (!m_cachedData)
+	{
+		m_cachedData = pinEntry(key);
+	}
+	if (!m_cachedData)
 	{
-		// Read the whole entry into temporary memory.
-		assert(m_tempBufferSize >= m_entries[m_curFile].length);
-		if (!zip_entry_noallocread((struct zip_t*)m_fileHandle, m_tempBuffer, m_entries[m_curFile].length))
+		const bool cacheable = entry.length <= c_maxCachedEntry;
+		// The fast path is to read the entire entry into the provided memory, avoiding the extra memcopy.
+		// This is only done if we are reading the entire file and there is no offset.
+		if (m_fileOffset == 0 && sizeToRead == entry.length)
 		{
-			return false;
+			if (!extractEntry(m_curFile, data)) { return 0; }
+			// Keep a copy so reopening the file does not decompress it again.
+			if (cacheable)
+			{
+				u8* copy = (u8*)malloc(entry.length);
+				if (copy)
+				{
+					memcpy(copy, data, entry.length);
+					addEntry(key, copy, entry.length, false);
+				}
+			}
+			m_fileOffset += s32(sizeToRead);
+			return sizeToRead;
+		}
+
+		// Large entries are inflated as a stream when the compressed data is available in memory.
+		if (!cacheable && entry.method == ZIP_METHOD_DEFLATE && m_mapped.isOpen())
+		{
+			return readStream(data, sizeToRead);
 		}
-		m_entryRead = true;
+
+		// Otherwise decompress the whole entry once and copy out the sections as they are read.
+		u8* entryData = (u8*)malloc(std::max(entry.length, size_t(1)));
+		if (!entryData || !extractEntry(m_curFile, entryData))
+		{
+			free(entryData);
+			return 0;
+		}
+		m_cachedData = addEntry(key, entryData, entry.length, true);
 	}
-	// Then copy the section we want into the output.
-	memcpy(data, m_tempBuffer + m_fileOffset, sizeToRead);
-	m_fileOffset += (s32)sizeToRead;
+
+	memcpy(data, m_cachedData + m_fileOffset, sizeToRead);
+	m_fileOffset += s32(sizeToRead);
 	return sizeToRead;
 }
 
+// Inflate the current entry from m_fileOffset. Reading forward continues the stream, seeking
+// backwards restarts it from the beginning of the entry.
+size_t ZipArchive::readStream(void* data, size_t size)
+{
+	TFE_ZONE("Zip Stream");
+	if (!m_stream)
+	{
+		m_stream = new ZipStreamState;
+		m_stream->src = nullptr;
+	}
+	ZipStreamState* stream = m_stream;
+	if (!stream->src || size_t(m_fileOffset) < stream->outPos)
+	{
+		stream->src = getCompressedData(m_curFile);
+		if (!stream->src) { return 0; }
+		stream->srcSize = m_entries[m_curFile].compressedLength;
+		stream->srcPos = 0;
+		stream->outPos = 0;
+		stream->dictPos = 0;
+		stream->readPos = 0;
+		stream->available = 0;
+		stream->done = false;
+		tinfl_init(&stream->inflator);
+	}
+
+	// Skip forward to the file offset, then copy out the requested data.
+	size_t skip = size_t(m_fileOffset) - stream->outPos;
+	u8* out = (u8*)data;
+	size_t outSize = 0;
+	while (outSize < size)
+	{
+		if (stream->available)
+		{
+			const size_t count = std::min(stream->available, skip ? skip : size - outSize);
+			if (skip)
+			{
+				skip -= count;
+			}
+			else
+			{
+				memcpy(out + outSize, &stream->dict[stream->readPos], count);
+				outSize += count;
+			}
+			stream->readPos += count;
+			stream->available -= count;
+			stream->outPos += count;
+			continue;
+		}
+		if (stream->done) { break; }
+
+		size_t inSize = stream->srcSize - stream->srcPos;
+		size_t inflated = TINFL_LZ_DICT_SIZE - stream->dictPos;
+		const tinfl_status status = tinfl_decompress(&stream->inflator, stream->src + stream->srcPos, &inSize,
+			stream->dict, stream->dict + stream->dictPos, &inflated, 0);
+		stream->srcPos += inSize;
+		stream->readPos = stream->dictPos;
+		stream->available = inflated;
+		stream->dictPos = (stream->dictPos + inflated) & (TINFL_LZ_DICT_SIZE - 1);
+
+		if (status == TINFL_STATUS_DONE)
+		{
+			stream->done = true;
+		}
+		else if (status < TINFL_STATUS_DONE || (status == TINFL_STATUS_NEEDS_MORE_INPUT && !inflated))
+		{
+			TFE_System::logWrite(LOG_ERROR, "zipArchive", "Failed to inflate '%s' from archive '%s'", m_entries[m_curFile].name.c_str(), m_archivePath);
+			stream->src = nullptr;
+			break;
+		}
+	}
+
+	m_fileOffset += s32(outSize);
+	return outSize;
+}
+
 bool ZipArchive::seekFile(s32 offset, s32 origin)
 {
-	if (m_curFile < 0) { return false; }
+	if (m_curFile == INVALID_FILE) { return false; }
 	size_t size = m_entries[m_curFile].length;
 
 	switch (origin)
@@ -275,4 +570,4 @@ size_t ZipArchive::getFileLength(u32 index)
 // Edit
 void ZipArchive::addFile(const char* fileName, const char* filePath)
 {
-}
\ No newline at end of file
+}
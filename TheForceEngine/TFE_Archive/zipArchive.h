@@ -1,7 +1,17 @@
 #pragma once
+//////////////////////////////////////////////////////////////////////
+// Zip Archive
+// The archive stays open (memory mapped when possible) from open()
+// until close(), so opening a file only positions the reader on the
+// entry. Decompressed entries are kept in a bounded LRU cache shared
+// by all zip archives, and entries too large to cache are inflated as
+// a stream instead of being decompressed in one block.
+//////////////////////////////////////////////////////////////////////
 #include "archive.h"
 #include <string>
 
+struct ZipStreamState;
+
 class ZipArchive : public Archive
 {
 public:
@@ -32,6 +42,9 @@ public:
 	const char* getFileName(u32 index) override;
 	size_t getFileLength(u32 index) override;
 
+	// Only uncompressed (stored) entries in a mapped archive can be accessed directly.
+	const u8* getFileData(u32 index) override;
+
 	// Edit
 	void addFile(const char* fileName, const char* filePath) override;
 
@@ -40,15 +53,23 @@ private:
 	{
 		std::string name;
 		size_t length;
+		size_t compressedLength;
+		size_t localHeaderOffset;
+		u32 method;
 		bool isDir;
 	};
 
+	const u8* getCompressedData(u32 index);
+	bool extractEntry(u32 index, void* data);
+	size_t readStream(void* data, size_t size);
+
 	s32 m_entryCount;
 	u32 m_curFile;
 	ZipEntry* m_entries;
-	void* m_fileHandle;
+	void* m_fileHandle;		// mz_zip_archive, open from open() until close().
+	u32 m_archiveId = 0;	// Identifies this archive's entries in the shared cache.
 
-	u8* m_tempBuffer = nullptr;
-	size_t m_tempBufferSize = 0;
-	bool m_entryRead;
+	// The cached, decompressed contents of the current file - pinned until the file is closed.
+	const u8* m_cachedData = nullptr;
+	ZipStreamState* m_stream = nullptr;
 };
@@ -0,0 +1,230 @@
+#include <cstring>
+#include <cstdlib>
+
+#include "assetRegistry.h"
+
+namespace TFE_AssetRegistry
+{
+	enum
+	{
+		NAME_BLOCK_SIZE = 16384,
+	};
+
+	struct NameSlot
+	{
+		u32 hash;
+		u32 id;
+	};
+
+	// Interned strings are stored in fixed blocks so their addresses never change.
+	static std::vector<char*> s_nameBlocks;
+	static size_t s_nameBlockUsed = NAME_BLOCK_SIZE;
+	static std::vector<const char*> s_names;
+	static std::vector<u32> s_nameHashes;
+	static std::vector<NameSlot> s_nameSlots;
+	static u32 s_nameMask = 0;
+
+	u32 hashName(const char* name)
+	{
+		// FNV-1a
+		u32 hash = 2166136261u;
+		for (const u8* c = (const u8*)name; *c; c++)
+		{
+			hash ^= u32(*c);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	void insertSlot(u32 hash, u32 id)
+	{
+		u32 slot = hash & s_nameMask;
+		while (s_nameSlots[slot].id != INVALID_ASSET_NAME)
+		{
+			slot = (slot + 1) & s_nameMask;
+		}
+		s_nameSlots[slot] = { hash, id };
+	}
+
+	const char* copyName(const char* name)
+	{
+		const size_t size = strlen(name) + 1;
+		// Very long names get their own block.
+		if (size > NAME_BLOCK_SIZE / 4)
+		{
+			char* block = (char*)malloc(size);
+			s_nameBlocks.push_back(block);
+			memcpy(block, name, size);
+			return block;
+		}
+		if (s_nameBlockUsed + size > NAME_BLOCK_SIZE)
+		{
+			s_nameBlocks.push_back((char*)malloc(NAME_BLOCK_SIZE));
+			s_nameBlockUsed = 0;
+		}
+		char* str = s_nameBlocks.back() + s_nameBlockUsed;
+		memcpy(str, name, size);
+		s_nameBlockUsed += size;
+		return str;
+	}
+
+	u32 findName(const char* name, u32 hash)
+	{
+		if (s_nameSlots.empty()) { return INVALID_ASSET_NAME; }
+
+		u32 slot = hash & s_nameMask;
+		while (s_nameSlots[slot].id != INVALID_ASSET_NAME)
+		{
+			if (s_nameSlots[slot].hash == hash && strcmp(s_names[s_nameSlots[slot].id], name) == 0)
+			{
+				return s_nameSlots[slot].id;
+			}
+			slot = (slot + 1) & s_nameMask;
+		}
+		return INVALID_ASSET_NAME;
+	}
+
+	u32 findName(const char* name)
+	{
+		return name ? findName(name, hashName(name)) : INVALID_ASSET_NAME;
+	}
+
+	u32 internName(const char* name)
+	{
+		if (!name) { name = ""; }
+		const u32 hash = hashName(name);
+		u32 id = findName(name, hash);
+		if (id != INVALID_ASSET_NAME)
+		{
+			return id;
+		}
+
+		// Keep the load factor at or below 50%.
+		id = (u32)s_names.size();
+		if ((id + 1) * 2 > (u32)s_nameSlots.size())
+		{
+			const u32 slotCount = s_nameSlots.empty() ? 1024 : (u32)s_nameSlots.size() * 2;
+			s_nameSlots.assign(slotCount, { 0, INVALID_ASSET_NAME });
+			s_nameMask = slotCount - 1;
+			for (u32 i = 0; i < id; i++)
+			{
+				insertSlot(s_nameHashes[i], i);
+			}
+		}
+
+		s_names.push_back(copyName(name));
+		s_nameHashes.push_back(hash);
+		insertSlot(hash, id);
+		return id;
+	}
+
+	const char* getName(u32 nameId)
+	{
+		return nameId < s_names.size() ? s_names[nameId] : nullptr;
+	}
+}
+
+static u32 hashKey(uintptr_t key)
+{
+	// Mix the bits so that sequential ids and aligned pointers spread across the table.
+	u64 x = u64(key);
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	return u32(x);
+}
+
+void AssetIndex::clear()
+{
+	m_nameSlots.clear();
+	m_assetSlots.clear();
+	m_names.clear();
+	m_mask = 0;
+}
+
+s32 AssetIndex::add(u32 nameId, const void* asset)
+{
+	const s32 index = (s32)m_names.size();
+	// Keep the load factor at or below 50%.
+	if ((u32(index) + 1) * 2 > (u32)m_nameSlots.size())
+	{
+		grow();
+	}
+	m_names.push_back(nameId);
+
+	// Duplicates keep the first index, which matches the result of a linear search.
+	if (find(m_nameSlots, nameId) < 0)
+	{
+		insert(m_nameSlots, nameId, index);
+	}
+	if (asset && find(m_assetSlots, uintptr_t(asset)) < 0)
+	{
+		insert(m_assetSlots, uintptr_t(asset), index);
+	}
+	return index;
+}
+
+s32 AssetIndex::findName(u32 nameId) const
+{
+	return find(m_nameSlots, nameId);
+}
+
+s32 AssetIndex::findAsset(const void* asset) const
+{
+	return find(m_assetSlots, uintptr_t(asset));
+}
+
+void AssetIndex::grow()
+{
+	const u32 slotCount = m_nameSlots.empty() ? 64 : (u32)m_nameSlots.size() * 2;
+	std::vector<Slot> assetSlots;
+	assetSlots.swap(m_assetSlots);
+
+	m_nameSlots.assign(slotCount, { 0, -1 });
+	m_assetSlots.assign(slotCount, { 0, -1 });
+	m_mask = slotCount - 1;
+
+	// Re-insert in index order so the first entry still wins for duplicate names.
+	const s32 count = (s32)m_names.size();
+	for (s32 i = 0; i < count; i++)
+	{
+		if (find(m_nameSlots, m_names[i]) < 0)
+		{
+			insert(m_nameSlots, m_names[i], i);
+		}
+	}
+	const size_t assetSlotCount = assetSlots.size();
+	for (size_t i = 0; i < assetSlotCount; i++)
+	{
+		if (assetSlots[i].index >= 0)
+		{
+			insert(m_assetSlots, assetSlots[i].key, assetSlots[i].index);
+		}
+	}
+}
+
+void AssetIndex::insert(std::vector<Slot>& slots, uintptr_t key, s32 index)
+{
+	u32 slot = hashKey(key) & m_mask;
+	while (slots[slot].index >= 0)
+	{
+		slot = (slot + 1) & m_mask;
+	}
+	slots[slot] = { key, index };
+}
+
+s32 AssetIndex::find(const std::vector<Slot>& slots, uintptr_t key) const
+{
+	if (slots.empty()) { return -1; }
+
+	u32 slot = hashKey(key) & m_mask;
+	while (slots[slot].index >= 0)
+	{
+		if (slots[slot].key == key)
+		{
+			return slots[slot].index;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+	return -1;
+}
@@ -0,0 +1,120 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// The Force Engine Asset Registry
+// Interned asset names and the tables used to find loaded assets by
+// name and to map asset pointers back to their index for
+// serialization.
+//
+// Asset names are interned once into a shared string pool, so the
+// tables store 32-bit name ids instead of strings. Both the name and
+// the pointer lookups use open addressing with linear probing. Assets
+// are only removed by clearing a whole table (when a pool is freed),
+// so no tombstones are required.
+//
+// Names are case sensitive, matching the std::map based tables that
+// were used before. The registry is not thread-safe and should only
+// be used from the main thread.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include <vector>
+
+#define INVALID_ASSET_NAME 0xffffffff
+
+namespace TFE_AssetRegistry
+{
+	// Returns the id of 'name', adding it to the string pool if it is new.
+	u32 internName(const char* name);
+	// Returns the id of 'name' or INVALID_ASSET_NAME if it has not been interned.
+	u32 findName(const char* name);
+	// Returns the interned string, which remains valid for the lifetime of the program.
+	const char* getName(u32 nameId);
+}
+
+// Maps name ids and asset pointers to indices in insertion order.
+class AssetIndex
+{
+public:
+	AssetIndex() : m_mask(0) {}
+
+	// Returns the index of the new entry.
+	// If the name is already in the index, the new entry is added but name lookups keep returning the first one.
+	s32  add(u32 nameId, const void* asset);
+	void clear();
+
+	// Returns the index or -1 if not found.
+	s32  findName(u32 nameId) const;
+	s32  findAsset(const void* asset) const;
+
+	u32  getNameId(s32 index) const { return m_names[index]; }
+	s32  getCount() const { return (s32)m_names.size(); }
+
+private:
+	struct Slot
+	{
+		uintptr_t key;
+		s32 index;		// -1 = empty.
+	};
+
+	std::vector<Slot> m_nameSlots;
+	std::vector<Slot> m_assetSlots;
+	std::vector<u32>  m_names;
+	u32 m_mask;
+
+	void grow();
+	void insert(std::vector<Slot>& slots, uintptr_t key, s32 index);
+	s32  find(const std::vector<Slot>& slots, uintptr_t key) const;
+};
+
+// A list of loaded assets of one type, with name and pointer lookups.
+template<typename T>
+class AssetTable
+{
+public:
+	s32 add(const char* name, T* asset)
+	{
+		m_list.push_back(asset);
+		return m_index.add(TFE_AssetRegistry::internName(name), asset);
+	}
+
+	void clear()
+	{
+		m_list.clear();
+		m_index.clear();
+	}
+
+	// Returns the index of the asset named 'name' or -1 if it has not been added.
+	s32 findIndex(const char* name) const
+	{
+		const u32 nameId = TFE_AssetRegistry::findName(name);
+		return nameId == INVALID_ASSET_NAME ? -1 : m_index.findName(nameId);
+	}
+
+	T* find(const char* name) const
+	{
+		const s32 index = findIndex(name);
+		return index < 0 ? nullptr : m_list[index];
+	}
+
+	// Returns the index of 'asset' or -1 if it is not in the table.
+	s32 getIndex(const T* asset) const
+	{
+		return asset ? m_index.findAsset(asset) : -1;
+	}
+
+	T* get(s32 index) const
+	{
+		return (index < 0 || index >= (s32)m_list.size()) ? nullptr : m_list[index];
+	}
+
+	const char* getName(s32 index) const
+	{
+		return TFE_AssetRegistry::getName(m_index.getNameId(index));
+	}
+
+	s32 getCount() const { return (s32)m_list.size(); }
+	const std::vector<T*>& getList() const { return m_list; }
+
+private:
+	AssetIndex m_index;
+	std::vector<T*> m_list;
+};
@@ -3,18 +3,19 @@
 #include "modelAsset_jedi.h"
 #include <TFE_System/system.h>
 #include <TFE_Asset/assetSystem.h>
+#include <TFE_Asset/assetRegistry.h>
 #include <TFE_FileSystem/filestream.h>
 #include <TFE_FileSystem/paths.h>
 #include <TFE_System/parser.h>
 
 #include <TFE_Jedi/Math/core_math.h>
 #include <TFE_Jedi/Level/rtexture.h>
+#include <TFE_Jedi/Level/levelPrefetch.h>
 #include <TFE_Jedi/Serialization/serialization.h>
 // TODO: dependency on JediRenderer, this should be refactored...
 #include <TFE_Jedi/Renderer/rlimits.h>
 
 #include <assert.h>
-#include <map>
 #include <algorithm>
 
 using namespace TFE_Jedi;
@@ -136,14 +137,10 @@ using namespace TFE_Jedi_Object3d;
 
 namespace TFE_Model_Jedi
 {
-	typedef std::map<std::string, JediModel*> ModelMap;
-	typedef std::vector<JediModel*> ModelList;
-	typedef std::map<std::string, TextureData*> TextureMap;
-	typedef std::vector<std::string> NameList;
-	static ModelMap s_models[POOL_COUNT];
-	static ModelList s_modelList[POOL_COUNT];
-	static NameList s_modelNames[POOL_COUNT];
+	typedef AssetTable<JediModel> ModelTable;
+	static ModelTable s_models[POOL_COUNT];
 	static std::vector<char> s_buffer;
+	static std::vector<u8> s_prefetchData;
 
 	static vec2 s_tmpVtx[MAX_VERTEX_COUNT_3DO];
 
@@ -151,27 +148,40 @@ namespace TFE_Model_Jedi
 
 	JediModel* get(const char* name, AssetPool pool)
 	{
-		ModelMap::iterator iModel = s_models[pool].find(name);
-		if (iModel != s_models[pool].end())
+		JediModel* cached = s_models[pool].find(name);
+		if (cached)
 		{
-			return iModel->second;
+			return cached;
 		}
 
 		// It doesn't exist yet, try to load the model.
-		FilePath filePath;
-		if (!TFE_Paths::getFilePath(name, &filePath))
+		// TFE: Use the file data read by the level prefetch if available.
+		if (levelPrefetch_takeData(PREFETCH_3DO, name, &s_prefetchData))
 		{
-			return nullptr;
+			if (s_prefetchData.empty())
+			{
+				return nullptr;
+			}
+			s_buffer.assign(s_prefetchData.begin(), s_prefetchData.end());
+			s_prefetchData.clear();
 		}
-		FileStream file;
-		if (!file.open(&filePath, Stream::MODE_READ))
+		else
 		{
-			return nullptr;
+			FilePath filePath;
+			if (!TFE_Paths::getFilePath(name, &filePath))
+			{
+				return nullptr;
+			}
+			FileStream file;
+			if (!file.open(&filePath, Stream::MODE_READ))
+			{
+				return nullptr;
+			}
+			size_t len = file.getSize();
+			s_buffer.resize(len);
+			file.readBuffer(s_buffer.data(), u32(len));
+			file.close();
 		}
-		size_t len = file.getSize();
-		s_buffer.resize(len);
-		file.readBuffer(s_buffer.data(), u32(len));
-		file.close();
 			
 		s_memRegion = (pool == POOL_GAME) ? s_gameRegion : s_levelRegion;
 		JediModel* model = (JediModel*)model_alloc(sizeof(JediModel));
@@ -223,9 +233,7 @@ namespace TFE_Model_Jedi
 
 		// TODO (maybe): Cache binary models to disk so they can be
 		// directly loaded, which will reduce load time.
-		s_models[pool][name] = model;
-		s_modelList[pool].push_back(model);
-		s_modelNames[pool].push_back(name);
+		s_models[pool].add(name, model);
 		return model;
 	}
 
@@ -236,16 +244,12 @@ namespace TFE_Model_Jedi
 
 		for (s32 p = 0; p < POOL_COUNT; p++)
 		{
-			const size_t count = s_modelList[p].size();
-			JediModel** list = s_modelList[p].data();
-			for (size_t m = 0; m < count; m++)
+			const s32 m = s_models[p].getIndex(model);
+			if (m >= 0)
 			{
-				if (list[m] == model)
-				{
-					*index = s32(m);
-					*pool = AssetPool(p);
-					return true;
-				}
+				*index = m;
+				*pool = AssetPool(p);
+				return true;
 			}
 		}
 		return false;
@@ -253,24 +257,22 @@ namespace TFE_Model_Jedi
 
 	JediModel* getModelByIndex(s32 index, AssetPool pool)
 	{
-		if (pool >= POOL_COUNT || index >= (s32)s_modelList[pool].size())
+		if (pool >= POOL_COUNT)
 		{
 			return nullptr;
 		}
-		return s_modelList[pool][index];
+		return s_models[pool].get(index);
 	}
 
 	const std::vector<JediModel*>& getModelList(AssetPool pool)
 	{
-		return s_modelList[pool];
+		return s_models[pool].getList();
 	}
 
 	void freePool(AssetPool pool)
 	{
 		// Memory will get freed with the memory region automatically.
 		s_models[pool].clear();
-		s_modelList[pool].clear();
-		s_modelNames[pool].clear();
 	}
 
 	void serializeModels(Stream* stream)
@@ -281,17 +283,17 @@ namespace TFE_Model_Jedi
 			freePool(POOL_LEVEL);
 		}
 
-		s32 count = (s32)s_modelNames[POOL_LEVEL].size();
+		s32 count = s_models[POOL_LEVEL].getCount();
 		SERIALIZE(SaveVersionInit, count, 0);
 
-		std::string* names = s_modelNames[POOL_LEVEL].data();
 		std::string name;
 		for (s32 i = 0; i < count; i++)
 		{
 			u8 size;
 			if (modeWrite)
 			{
-				size = (u8)names[i].length();
+				name = s_models[POOL_LEVEL].getName(i);
+				size = (u8)name.length();
 			}
 			SERIALIZE(SaveVersionInit, size, 0);
 
@@ -299,7 +301,7 @@ namespace TFE_Model_Jedi
 			{
 				name.resize(size);
 			}
-			SERIALIZE_BUF(SaveVersionInit, modeWrite ? &names[i][0] : &name[0], size);
+			SERIALIZE_BUF(SaveVersionInit, &name[0], size);
 
 			if (!modeWrite)
 			{
@@ -5,8 +5,10 @@
 #include <TFE_FileSystem/filestream.h>
 #include <TFE_FileSystem/paths.h>
 #include <TFE_Asset/assetSystem.h>
+#include <TFE_Asset/assetRegistry.h>
 #include <TFE_Jedi/Math/core_math.h>
 #include <TFE_Jedi/Level/robject.h>
+#include <TFE_Jedi/Level/levelPrefetch.h>
 #include <TFE_Jedi/Serialization/serialization.h>
 // TODO: dependency on JediRenderer, this should be refactored...
 #include <TFE_Jedi/Renderer/rlimits.h>
@@ -15,52 +17,67 @@
 #include <algorithm>
 #include <vector>
 #include <string>
-#include <map>
 
 using namespace TFE_Jedi;
 
 namespace TFE_Sprite_Jedi
 {
-	typedef std::map<std::string, JediFrame*> FrameMap;
-	typedef std::map<std::string, JediWax*> SpriteMap;
-	typedef std::vector<JediFrame*> FrameList;
-	typedef std::vector<JediWax*> SpriteList;
-	typedef std::vector<std::string> NameList;
-
-	static FrameMap   s_frames[POOL_COUNT];
-	static SpriteMap  s_sprites[POOL_COUNT];
-	static FrameList  s_frameList[POOL_COUNT];
-	static SpriteList s_spriteList[POOL_COUNT];
-	static NameList   s_frameNames[POOL_COUNT];
-	static NameList   s_spriteNames[POOL_COUNT];
+	typedef AssetTable<JediFrame> FrameTable;
+	typedef AssetTable<JediWax> SpriteTable;
+
+	static FrameTable  s_frames[POOL_COUNT];
+	static SpriteTable s_sprites[POOL_COUNT];
 	static std::vector<u8> s_buffer;
 
-	JediFrame* getFrame(const char* name, AssetPool pool)
+	bool readAssetFile(const char* name)
 	{
-		FrameMap::iterator iFrame = s_frames[pool].find(name);
-		if (iFrame != s_frames[pool].end())
-		{
-			return iFrame->second;
-		}
-
-		// It doesn't exist yet, try to load the frame.
 		FilePath filePath;
 		if (!TFE_Paths::getFilePath(name, &filePath))
 		{
-			return nullptr;
+			return false;
 		}
 		FileStream file;
 		if (!file.open(&filePath, Stream::MODE_READ))
 		{
-			return nullptr;
+			return false;
 		}
 		size_t len = file.getSize();
 		s_buffer.resize(len);
 		file.readBuffer(s_buffer.data(), u32(len));
 		file.close();
+		return true;
+	}
 
-		const u8* data = s_buffer.data();
+	JediFrame* getFrame(const char* name, AssetPool pool)
+	{
+		JediFrame* frame = s_frames[pool].find(name);
+		if (frame)
+		{
+			return frame;
+		}
+
+		// It doesn't exist yet, try to load the frame.
+		// TFE: Use the frame decoded by the level prefetch if available.
+		JediFrame* asset = nullptr;
+		if (!levelPrefetch_takeAsset(PREFETCH_FME, name, (void**)&asset))
+		{
+			if (!readAssetFile(name))
+			{
+				return nullptr;
+			}
+			asset = decodeFrame(s_buffer.data(), s_buffer.size());
+		}
+		if (!asset)
+		{
+			return nullptr;
+		}
+
+		s_frames[pool].add(name, asset);
+		return asset;
+	}
 
+	JediFrame* decodeFrame(const u8* data, size_t size)
+	{
 		// Determine ahead of time how much we need to allocate.
 		const WaxFrame* base_frame = (WaxFrame*)data;
 		const WaxCell* base_cell = WAX_CellPtr(data, base_frame);
@@ -68,10 +85,10 @@ namespace TFE_Sprite_Jedi
 
 		// This is a "load in place" format in the original code.
 		// We are going to allocate new memory and copy the data.
-		u8* assetPtr = (u8*)malloc(s_buffer.size() + columnSize);
+		u8* assetPtr = (u8*)malloc(size + columnSize);
 		JediFrame* asset = (JediFrame*)assetPtr;
 		
-		memcpy(asset, data, s_buffer.size());
+		memcpy(asset, data, size);
 
 		WaxFrame* frame = asset;
 		WaxCell* cell = WAX_CellPtr(asset, frame);
@@ -93,7 +110,7 @@ namespace TFE_Sprite_Jedi
 		}
 		else
 		{
-			u32* columns = (u32*)((u8*)asset + s_buffer.size());
+			u32* columns = (u32*)((u8*)asset + size);
 			// Local pointer.
 			cell->columnOffset = u32((u8*)columns - (u8*)asset);
 			// Calculate column offsets.
@@ -102,24 +119,18 @@ namespace TFE_Sprite_Jedi
 				columns[c] = cell->sizeY * c;
 			}
 		}
-		
-		s_frames[pool][name] = asset;
-		s_frameList[pool].push_back(asset);
-		s_frameNames[pool].push_back(name);
 		return asset;
 	}
 
-	static std::vector<u32> s_cellOffsets;
-
-	bool isUniqueCell(u32 offset)
+	bool isUniqueCell(std::vector<u32>& cellOffsets, u32 offset)
 	{
-		const size_t count = s_cellOffsets.size();
-		const u32* offsetList = s_cellOffsets.data();
+		const size_t count = cellOffsets.size();
+		const u32* offsetList = cellOffsets.data();
 		for (u32 i = 0; i < count; i++)
 		{
 			if (offsetList[i] == offset) { return false; }
 		}
-		s_cellOffsets.push_back(offset);
+		cellOffsets.push_back(offset);
 
 		return true;
 	}
@@ -136,21 +147,20 @@ namespace TFE_Sprite_Jedi
 		s32 frameCount, spriteCount;
 		if (modeWrite)
 		{
-			frameCount = (s32)s_frameNames[POOL_LEVEL].size();
-			spriteCount = (s32)s_spriteNames[POOL_LEVEL].size();
+			frameCount = s_frames[POOL_LEVEL].getCount();
+			spriteCount = s_sprites[POOL_LEVEL].getCount();
 		}
 		SERIALIZE(SaveVersionInit, frameCount, 0);
 		SERIALIZE(SaveVersionInit, spriteCount, 0);
 
-		std::string* frameNames  = s_frameNames[POOL_LEVEL].data();
-		std::string* spriteNames = s_spriteNames[POOL_LEVEL].data();
 		std::string name;
 		for (s32 i = 0; i < frameCount; i++)
 		{
 			u8 size;
 			if (modeWrite)
 			{
-				size = (u8)frameNames[i].length();
+				name = s_frames[POOL_LEVEL].getName(i);
+				size = (u8)name.length();
 			}
 			SERIALIZE(SaveVersionInit, size, 0);
 
@@ -158,7 +168,7 @@ namespace TFE_Sprite_Jedi
 			{
 				name.resize(size);
 			}
-			SERIALIZE_BUF(SaveVersionInit, modeWrite ? &frameNames[i][0] : &name[0], size);
+			SERIALIZE_BUF(SaveVersionInit, &name[0], size);
 
 			if (serialization_getMode() == SMODE_READ)
 			{
@@ -170,14 +180,15 @@ namespace TFE_Sprite_Jedi
 			u8 size;
 			if (modeWrite)
 			{
-				size = (u8)spriteNames[i].length();
+				name = s_sprites[POOL_LEVEL].getName(i);
+				size = (u8)name.length();
 			}
 			SERIALIZE(SaveVersionInit, size, 0);
 			if (!modeWrite)
 			{
 				name.resize(size);
 			}
-			SERIALIZE_BUF(SaveVersionInit, modeWrite ? &spriteNames[i][0] : &name[0], size);
+			SERIALIZE_BUF(SaveVersionInit, &name[0], size);
 
 			if (serialization_getMode() == SMODE_READ)
 			{
@@ -188,29 +199,34 @@ namespace TFE_Sprite_Jedi
 		
 	JediWax* getWax(const char* name, AssetPool pool)
 	{
-		SpriteMap::iterator iSprite = s_sprites[pool].find(name);
-		if (iSprite != s_sprites[pool].end())
+		JediWax* sprite = s_sprites[pool].find(name);
+		if (sprite)
 		{
-			return iSprite->second;
+			return sprite;
 		}
 
 		// It doesn't exist yet, try to load the frame.
-		FilePath filePath;
-		if (!TFE_Paths::getFilePath(name, &filePath))
+		// TFE: Use the sprite decoded by the level prefetch if available.
+		JediWax* asset = nullptr;
+		if (!levelPrefetch_takeAsset(PREFETCH_WAX, name, (void**)&asset))
 		{
-			return nullptr;
+			if (!readAssetFile(name))
+			{
+				return nullptr;
+			}
+			asset = decodeWax(s_buffer.data(), s_buffer.size());
 		}
-		FileStream file;
-		if (!file.open(&filePath, Stream::MODE_READ))
+		if (!asset)
 		{
 			return nullptr;
 		}
-		size_t len = file.getSize();
-		s_buffer.resize(len);
-		file.readBuffer(s_buffer.data(), u32(len));
-		file.close();
 
-		const u8* data = s_buffer.data();
+		s_sprites[pool].add(name, asset);
+		return asset;
+	}
+
+	JediWax* decodeWax(const u8* data, size_t size)
+	{
 		const Wax* srcWax = (Wax*)data;
 		
 		// every animation is filled out until the end, so no animations = no wax.
@@ -218,10 +234,10 @@ namespace TFE_Sprite_Jedi
 		{
 			return nullptr;
 		}
-		s_cellOffsets.clear();
+		std::vector<u32> cellOffsets;
 
 		// First determine the size to allocate (note that this will overallocate a bit because cells are shared).
-		u32 sizeToAlloc = sizeof(JediWax) + (u32)s_buffer.size();
+		u32 sizeToAlloc = sizeof(JediWax) + (u32)size;
 		const s32* animOffset = srcWax->animOffsets;
 		for (s32 animIdx = 0; animIdx < 32 && animOffset[animIdx]; animIdx++)
 		{
@@ -235,7 +251,7 @@ namespace TFE_Sprite_Jedi
 				{
 					const WaxFrame* frame = (WaxFrame*)(data + frameOffset[f]);
 					const WaxCell* cell = frame->cellOffset ? (WaxCell*)(data + frame->cellOffset) : nullptr;
-					if (cell && cell->compressed == 0 && isUniqueCell(frame->cellOffset))
+					if (cell && cell->compressed == 0 && isUniqueCell(cellOffsets, frame->cellOffset))
 					{
 						sizeToAlloc += cell->sizeX * sizeof(u32);
 					}
@@ -246,7 +262,7 @@ namespace TFE_Sprite_Jedi
 		// Allocate and copy the data (this is a "copy in place" format... mostly.
 		JediWax* asset = (JediWax*)malloc(sizeToAlloc);
 		Wax* dstWax = asset;
-		memcpy(dstWax, srcWax, s_buffer.size());
+		memcpy(dstWax, srcWax, size);
 
 		// Loop through animation list until we reach 32 (maximum count) or a null animation.
 		// This means that animations are contiguous.
@@ -308,7 +324,7 @@ namespace TFE_Sprite_Jedi
 							}
 							else
 							{
-								u32* columns = (u32*)((u8*)asset + s_buffer.size() + cellOffsetPtr);
+								u32* columns = (u32*)((u8*)asset + size + cellOffsetPtr);
 								cellOffsetPtr += dstCell->sizeX * sizeof(u32);
 
 								// Local pointer.
@@ -338,44 +354,34 @@ namespace TFE_Sprite_Jedi
 			}
 		}
 		asset->animCount = animIdx;
-
-		s_sprites[pool][name] = asset;
-		s_spriteList[pool].push_back(asset);
-		s_spriteNames[pool].push_back(name);
 		return asset;
 	}
 				
 	const std::vector<JediWax*>& getWaxList(AssetPool pool)
 	{
-		return s_spriteList[pool];
+		return s_sprites[pool].getList();
 	}
 
 	const std::vector<JediFrame*>& getFrameList(AssetPool pool)
 	{
-		return s_frameList[pool];
+		return s_frames[pool].getList();
 	}
 
 	void freePool(AssetPool pool)
 	{
-		const size_t frameCount = s_frameList[pool].size();
-		JediFrame** frameList = s_frameList[pool].data();
-		for (size_t i = 0; i < frameCount; i++)
+		const s32 frameCount = s_frames[pool].getCount();
+		for (s32 i = 0; i < frameCount; i++)
 		{
-			free(frameList[i]);
+			free(s_frames[pool].get(i));
 		}
 		s_frames[pool].clear();
-		s_frameList[pool].clear();
-		s_frameNames[pool].clear();
 
-		const size_t waxCount = s_spriteList[pool].size();
-		JediWax** waxList = s_spriteList[pool].data();
-		for (size_t i = 0; i < waxCount; i++)
+		const s32 waxCount = s_sprites[pool].getCount();
+		for (s32 i = 0; i < waxCount; i++)
 		{
-			free(waxList[i]);
+			free(s_sprites[pool].get(i));
 		}
 		s_sprites[pool].clear();
-		s_spriteList[pool].clear();
-		s_spriteNames[pool].clear();
 	}
 
 	void freeAll()
@@ -395,16 +401,12 @@ namespace TFE_Sprite_Jedi
 	{
 		for (s32 p = 0; p < POOL_COUNT; p++)
 		{
-			const size_t waxCount = s_spriteList[p].size();
-			JediWax** waxList = s_spriteList[p].data();
-			for (size_t i = 0; i < waxCount; i++)
+			const s32 i = s_sprites[p].getIndex(wax);
+			if (i >= 0)
 			{
-				if (waxList[i] == wax)
-				{
-					*index = s32(i);
-					*pool = AssetPool(p);
-					return true;
-				}
+				*index = i;
+				*pool = AssetPool(p);
+				return true;
 			}
 		}
 		return false;
@@ -412,27 +414,23 @@ namespace TFE_Sprite_Jedi
 
 	JediWax* getWaxByIndex(s32 index, AssetPool pool)
 	{
-		if (pool >= POOL_COUNT || index >= (s32)s_spriteList[pool].size())
+		if (pool >= POOL_COUNT)
 		{
 			return nullptr;
 		}
-		return s_spriteList[pool][index];
+		return s_sprites[pool].get(index);
 	}
 
 	bool getFrameIndex(JediFrame* frame, s32* index, AssetPool* pool)
 	{
 		for (s32 p = 0; p < POOL_COUNT; p++)
 		{
-			const size_t frameCount = s_frameList[p].size();
-			JediFrame** frameList = s_frameList[p].data();
-			for (size_t i = 0; i < frameCount; i++)
+			const s32 i = s_frames[p].getIndex(frame);
+			if (i >= 0)
 			{
-				if (frameList[i] == frame)
-				{
-					*index = s32(i);
-					*pool = AssetPool(p);
-					return true;
-				}
+				*index = i;
+				*pool = AssetPool(p);
+				return true;
 			}
 		}
 		return false;
@@ -440,10 +438,10 @@ namespace TFE_Sprite_Jedi
 
 	JediFrame* getFrameByIndex(s32 index, AssetPool pool)
 	{
-		if (pool >= POOL_COUNT || index >= (s32)s_frameList[pool].size())
+		if (pool >= POOL_COUNT)
 		{
 			return nullptr;
 		}
-		return s_frameList[pool][index];
+		return s_frames[pool].get(index);
 	}
 }
@@ -91,6 +91,9 @@ namespace TFE_Sprite_Jedi
 {
 	JediFrame* getFrame(const char* name, AssetPool pool = POOL_LEVEL);
 	JediWax*   getWax(const char* name, AssetPool pool = POOL_LEVEL);
+	// Decode file data into a new asset without adding it to the asset tables, these can be called from any thread.
+	JediFrame* decodeFrame(const u8* data, size_t size);
+	JediWax*   decodeWax(const u8* data, size_t size);
 	void freeAll();
 	void freeLevelData();
 
@@ -0,0 +1,295 @@
+#include "videoStreamWriter.h"
+#include <TFE_System/system.h>
+#include <TFE_System/profiler.h>
+#include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/signal.h>
+#include <TFE_FileSystem/filestream.h>
+#include <TFE_FileSystem/paths.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// The miniz implementation is compiled with the zip library.
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <TFE_Archive/zip/miniz.h>
+
+namespace TFE_VideoStream
+{
+	enum
+	{
+		VSTREAM_SLOT_COUNT = 8,				// Frames that can be in flight between the capture and the encoder.
+		VSTREAM_MAGIC = 0x56454654,			// 'TFEV'
+		VSTREAM_VERSION = 1,
+	};
+
+	struct FrameSlot
+	{
+		std::vector<u8> imageData;
+		f64 time;
+	};
+
+	static FrameSlot s_slots[VSTREAM_SLOT_COUNT];
+	// Single producer (the render thread), single consumer (the encoder thread).
+	static atomic_u32 s_slotWrite;
+	static atomic_u32 s_slotRead;
+	static atomic_bool s_running;
+
+	static Thread* s_encoderThread = nullptr;
+	static Signal* s_frameReady = nullptr;
+	static Signal* s_slotFreed = nullptr;
+
+	static FileStream s_videoFile;
+	static FileStream s_timeFile;
+	static VideoStreamFormat s_format;
+	static u32 s_width;
+	static u32 s_height;
+	static u32 s_frameCount;
+	static f64 s_firstTime;
+	static f64 s_prevTime;
+	static bool s_active = false;
+	static bool s_hasTimeFile = false;
+
+	static std::vector<u8> s_encodeBuffer;
+	static std::vector<u8> s_compressBuffer;
+
+	TFE_THREADRET encoderFunc(void* userData);
+
+	bool start(const char* path, u32 width, u32 height, u32 fps, VideoStreamFormat format)
+	{
+		if (s_active || !width || !height || format >= VSTREAM_COUNT) { return false; }
+		if (!s_videoFile.open(path, Stream::MODE_WRITE))
+		{
+			TFE_System::logWrite(LOG_ERROR, "VideoStream", "Cannot open '%s' for recording.", path);
+			return false;
+		}
+		char timePath[TFE_MAX_PATH];
+		snprintf(timePath, TFE_MAX_PATH, "%s.csv", path);
+		s_hasTimeFile = s_timeFile.open(timePath, Stream::MODE_WRITE);
+		if (s_hasTimeFile)
+		{
+			const char* csvHeader = "frame,time_ms,delta_ms\n";
+			s_timeFile.writeBuffer(csvHeader, u32(strlen(csvHeader)));
+		}
+
+		s_format = format;
+		s_width = width;
+		s_height = height;
+		s_frameCount = 0;
+		s_firstTime = 0.0;
+		s_prevTime = 0.0;
+
+		const size_t frameSize = size_t(width) * size_t(height) * 4;
+		for (s32 i = 0; i < VSTREAM_SLOT_COUNT; i++)
+		{
+			s_slots[i].imageData.resize(frameSize);
+		}
+		s_encodeBuffer.resize(frameSize);
+		if (format == VSTREAM_RAW_DEFLATE)
+		{
+			s_compressBuffer.resize(mz_compressBound(mz_ulong(frameSize)));
+		}
+
+		// Stream header.
+		if (format == VSTREAM_Y4M)
+		{
+			char header[256];
+			snprintf(header, 256, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", width, height, fps);
+			s_videoFile.writeBuffer(header, u32(strlen(header)));
+		}
+		else if (format == VSTREAM_RAW_DEFLATE)
+		{
+			VideoStreamHeader header = { VSTREAM_MAGIC, VSTREAM_VERSION, width, height, fps, u32(format) };
+			s_videoFile.writeBuffer(&header, sizeof(VideoStreamHeader));
+		}
+
+		s_slotWrite.store(0);
+		s_slotRead.store(0);
+		s_running.store(true);
+		if (!s_frameReady) { s_frameReady = Signal::create(); }
+		if (!s_slotFreed)  { s_slotFreed = Signal::create(); }
+		s_encoderThread = Thread::create("VideoEncoderThread", encoderFunc, nullptr);
+		if (!s_encoderThread || !s_encoderThread->run())
+		{
+			TFE_System::logWrite(LOG_ERROR, "VideoStream", "Cannot create the video encoder thread.");
+			delete s_encoderThread;
+			s_encoderThread = nullptr;
+			s_videoFile.close();
+			if (s_hasTimeFile) { s_timeFile.close(); }
+			return false;
+		}
+
+		s_active = true;
+		TFE_System::logWrite(LOG_MSG, "VideoStream", "Recording %ux%u video to '%s'.", width, height, path);
+		return true;
+	}
+
+	void finish()
+	{
+		if (!s_active) { return; }
+
+		// The encoder writes out the remaining frames before exiting.
+		s_running.store(false);
+		s_frameReady->fire();
+		s_encoderThread->waitOnExit();
+		delete s_encoderThread;
+		s_encoderThread = nullptr;
+
+		s_videoFile.close();
+		if (s_hasTimeFile) { s_timeFile.close(); }
+		s_active = false;
+
+		// Free the frame memory, it can be large at high resolutions.
+		for (s32 i = 0; i < VSTREAM_SLOT_COUNT; i++)
+		{
+			s_slots[i].imageData.clear();
+			s_slots[i].imageData.shrink_to_fit();
+		}
+		s_encodeBuffer.clear();
+		s_encodeBuffer.shrink_to_fit();
+		s_compressBuffer.clear();
+		s_compressBuffer.shrink_to_fit();
+		TFE_System::logWrite(LOG_MSG, "VideoStream", "Recording finished, %u frames written.", s_frameCount);
+	}
+
+	bool isActive()
+	{
+		return s_active;
+	}
+
+	u8* beginFrame()
+	{
+		if (!s_active) { return nullptr; }
+		// Wait for the encoder to free up a slot.
+		while (s_slotWrite.load() - s_slotRead.load() >= VSTREAM_SLOT_COUNT)
+		{
+			TFE_ZONE("Video Stream Wait");
+			s_slotFreed->wait();
+		}
+		return s_slots[s_slotWrite.load() % VSTREAM_SLOT_COUNT].imageData.data();
+	}
+
+	void endFrame(f64 time)
+	{
+		if (!s_active) { return; }
+		const u32 slot = s_slotWrite.load();
+		s_slots[slot % VSTREAM_SLOT_COUNT].time = time;
+		s_slotWrite.store(slot + 1);
+		s_frameReady->fire();
+	}
+
+	/////////////////////////////////////////////
+	// Encoder
+	/////////////////////////////////////////////
+	inline u8 clampColor(s32 value)
+	{
+		return value < 0 ? 0 : (value > 255 ? 255 : u8(value));
+	}
+
+	// Convert to planar 4:4:4 YCbCr, flipping the image so it is top-down.
+	void encodeY4m(const u8* image)
+	{
+		const u32 planeSize = s_width * s_height;
+		u8* yPlane = s_encodeBuffer.data();
+		u8* uPlane = yPlane + planeSize;
+		u8* vPlane = uPlane + planeSize;
+		for (u32 y = 0; y < s_height; y++)
+		{
+			const u8* src = &image[(s_height - y - 1) * s_width * 4];
+			for (u32 x = 0; x < s_width; x++, src += 4)
+			{
+				const s32 r = src[0], g = src[1], b = src[2];
+				*yPlane++ = clampColor((77 * r + 150 * g + 29 * b + 128) >> 8);
+				*uPlane++ = clampColor(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+				*vPlane++ = clampColor(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+			}
+		}
+
+		const char* frameHeader = "FRAME\n";
+		s_videoFile.writeBuffer(frameHeader, u32(strlen(frameHeader)));
+		s_videoFile.writeBuffer(s_encodeBuffer.data(), planeSize * 3);
+	}
+
+	void flipImage(const u8* image)
+	{
+		const u32 stride = s_width * 4;
+		u8* output = s_encodeBuffer.data();
+		for (u32 y = 0; y < s_height; y++, output += stride)
+		{
+			memcpy(output, &image[(s_height - y - 1) * stride], stride);
+		}
+	}
+
+	void encodeFrame(const FrameSlot* slot)
+	{
+		TFE_ZONE("Video Encode");
+		const u32 frameSize = s_width * s_height * 4;
+		switch (s_format)
+		{
+			case VSTREAM_Y4M:
+			{
+				encodeY4m(slot->imageData.data());
+			} break;
+			case VSTREAM_RAW:
+			{
+				flipImage(slot->imageData.data());
+				s_videoFile.writeBuffer(s_encodeBuffer.data(), frameSize);
+			} break;
+			case VSTREAM_RAW_DEFLATE:
+			{
+				flipImage(slot->imageData.data());
+				mz_ulong compressedSize = mz_ulong(s_compressBuffer.size());
+				if (mz_compress2(s_compressBuffer.data(), &compressedSize, s_encodeBuffer.data(), frameSize, MZ_BEST_SPEED) == MZ_OK)
+				{
+					const u32 size = u32(compressedSize);
+					s_videoFile.writeBuffer(&size, sizeof(u32));
+					s_videoFile.writeBuffer(s_compressBuffer.data(), size);
+				}
+				else
+				{
+					// Store the frame uncompressed, flagged with the high bit so the stream stays readable.
+					const u32 size = frameSize | 0x80000000u;
+					s_videoFile.writeBuffer(&size, sizeof(u32));
+					s_videoFile.writeBuffer(s_encodeBuffer.data(), frameSize);
+				}
+			} break;
+			default: break;
+		}
+
+		// Frame timing.
+		if (s_frameCount == 0)
+		{
+			s_firstTime = slot->time;
+			s_prevTime = slot->time;
+		}
+		if (s_hasTimeFile)
+		{
+			char line[128];
+			const s32 len = snprintf(line, 128, "%u,%.3f,%.3f\n", s_frameCount, (slot->time - s_firstTime) * 1000.0, (slot->time - s_prevTime) * 1000.0);
+			s_timeFile.writeBuffer(line, u32(len));
+		}
+		s_prevTime = slot->time;
+		s_frameCount++;
+	}
+
+	TFE_THREADRET encoderFunc(void* userData)
+	{
+		TFE_Profiler::setThreadName("VideoEncoderThread");
+		while (1)
+		{
+			const u32 read = s_slotRead.load();
+			if (read != s_slotWrite.load())
+			{
+				encodeFrame(&s_slots[read % VSTREAM_SLOT_COUNT]);
+				s_slotRead.store(read + 1);
+				s_slotFreed->fire();
+				continue;
+			}
+			// Only exit once all of the queued frames have been written.
+			if (!s_running.load()) { break; }
+			s_frameReady->wait();
+		}
+		return (TFE_THREADRET)0;
+	}
+}
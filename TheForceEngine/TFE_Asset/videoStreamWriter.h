@@ -0,0 +1,45 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// The Force Engine Video Stream Writer
+// Writes captured frames to disk as they are recorded instead of
+// keeping them in memory. Frames are handed to an encoder thread
+// through a fixed ring of frame buffers, so memory use does not grow
+// with the length of the recording.
+//
+// A "<path>.csv" file is written alongside the video with the capture
+// time of each frame, which can be used for frame pacing analysis.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+
+enum VideoStreamFormat
+{
+	VSTREAM_Y4M = 0,		// YUV4MPEG2 4:4:4, full range BT.601.
+	VSTREAM_RAW,			// Top-down RGBA frames with no header (ffmpeg: -f rawvideo -pix_fmt rgba -s WxH).
+	VSTREAM_RAW_DEFLATE,	// VideoStreamHeader, then each frame as a u32 size followed by zlib compressed RGBA.
+	VSTREAM_COUNT
+};
+
+// Header used by VSTREAM_RAW_DEFLATE.
+struct VideoStreamHeader
+{
+	u32 magic;		// 'TFEV'
+	u32 version;
+	u32 width;
+	u32 height;
+	u32 fps;
+	u32 format;
+};
+
+namespace TFE_VideoStream
+{
+	bool start(const char* path, u32 width, u32 height, u32 fps, VideoStreamFormat format);
+	// Finish writing the queued frames and close the files.
+	void finish();
+	bool isActive();
+
+	// Returns the buffer to read the next frame into: width x height RGBA, bottom-up as read back from the GPU.
+	// This blocks if the encoder has fallen behind, so no frames are dropped.
+	u8* beginFrame();
+	// Queue the frame for encoding, 'time' is the time it was captured in seconds.
+	void endFrame(f64 time);
+}
@@ -3,21 +3,19 @@
 #include "vocAsset.h"
 #include <TFE_System/system.h>
 #include <TFE_Asset/assetSystem.h>
+#include <TFE_Asset/assetRegistry.h>
 #include <TFE_Archive/archive.h>
 #include <TFE_System/parser.h>
 #include <TFE_Audio/audioSystem.h>
 #include <TFE_FileSystem/filestream.h>
 #include <TFE_FileSystem/paths.h>
 #include <assert.h>
-#include <map>
 #include <algorithm>
 
 namespace TFE_VocAsset
 {
-	typedef std::map<std::string, SoundBuffer*> VocMap;
-	typedef std::vector<SoundBuffer*> VocList;
-	static VocMap s_vocAssets;
-	static VocList s_vocAssetList;
+	typedef AssetTable<SoundBuffer> VocTable;
+	static VocTable s_vocAssets;
 	static std::vector<u8> s_buffer;
 
 	bool parseVoc(SoundBuffer* voc);
@@ -45,10 +43,10 @@ namespace TFE_VocAsset
 	
 	SoundBuffer* get(const char* name)
 	{
-		VocMap::iterator iVoc = s_vocAssets.find(name);
-		if (iVoc != s_vocAssets.end())
+		SoundBuffer* voc = s_vocAssets.find(name);
+		if (voc)
 		{
-			return iVoc->second;
+			return voc;
 		}
 
 		if (!loadSoundFile(name))
@@ -56,63 +54,39 @@ namespace TFE_VocAsset
 			return nullptr;
 		}
 				
-		SoundBuffer* voc = new SoundBuffer;
+		voc = new SoundBuffer;
 		if (!parseVoc(voc))
 		{
 			delete voc;
 			return nullptr;
 		}
 
-		s_vocAssets[name] = voc;
-		voc->id = (u32)s_vocAssetList.size();
-		s_vocAssetList.push_back(voc);
+		voc->id = (u32)s_vocAssets.add(name, voc);
 		return voc;
 	}
 
 	void freeAll()
 	{
-		VocList::iterator iVoc = s_vocAssetList.begin();
-		for (; iVoc != s_vocAssetList.end(); ++iVoc)
+		const s32 count = s_vocAssets.getCount();
+		for (s32 i = 0; i < count; i++)
 		{
-			SoundBuffer* voc = *iVoc;
+			SoundBuffer* voc = s_vocAssets.get(i);
 			delete[] voc->data;
 			delete voc;
 		}
 		s_vocAssets.clear();
-		s_vocAssetList.clear();
 	}
 
 	s32 getIndex(const char* name)
 	{
-		VocMap::iterator iVoc = s_vocAssets.find(name);
-		if (iVoc != s_vocAssets.end())
-		{
-			return (s32)iVoc->second->id;
-		}
-
-		// It doesn't exist yet, try to load the font.
-		if (!loadSoundFile(name))
-		{
-			return -1;
-		}
-
-		SoundBuffer* voc = new SoundBuffer;
-		if (!parseVoc(voc))
-		{
-			delete voc;
-			return -1;
-		}
-
-		s_vocAssets[name] = voc;
-		voc->id = (u32)s_vocAssetList.size();
-		s_vocAssetList.push_back(voc);
-		return (s32)voc->id;
+		// Load the sound if it doesn't exist yet.
+		SoundBuffer* voc = get(name);
+		return voc ? (s32)voc->id : -1;
 	}
 
 	SoundBuffer* getFromIndex(s32 index)
 	{
-		if (index < 0 || index >= s_vocAssetList.size()) { return nullptr; }
-		return s_vocAssetList[index];
+		return s_vocAssets.get(index);
 	}
 
 	////////////////////////////////////////
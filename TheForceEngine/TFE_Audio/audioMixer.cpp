@@ -0,0 +1,744 @@
+#include <cstring>
+#include <SDL_cpuinfo.h>
+
+#include "audioMixer.h"
+#include <TFE_System/system.h>
+#include <TFE_System/math.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define MIXER_X86 1
+	#include <emmintrin.h>
+	#include <immintrin.h>
+	// MSVC allows AVX2 intrinsics without changing the target architecture of the whole file.
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define MIXER_TARGET_AVX2
+	#else
+		#define MIXER_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	// The limiter requires vector division, which is only available on 64-bit ARM.
+	#define MIXER_NEON 1
+	#include <arm_neon.h>
+#endif
+
+// Comment out the desired sigmoid function and comment all of the others.
+//#define AUDIO_SIGMOID_CLIP 1
+#define AUDIO_SIGMOID_TANH 1
+//#define AUDIO_SIGMOID_RCP_SQRT 1
+
+namespace TFE_Audio
+{
+	typedef void(*MixerAddMonoFunc)(f32* out, const u8* data, u32 count, f32 leftGain, f32 rightGain);
+	typedef void(*MixerAddMonoPackedFunc)(s16* out, const u8* data, const u32* table, u32 count);
+	typedef void(*MixerNormalizeFunc)(f32* out, const s16* in, const f32* table, u32 count, f32 scale);
+	typedef void(*MixerLimitFunc)(f32* buffer, u32 count);
+	typedef void(*MixerAddResampledFunc)(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep);
+
+	struct MixerFuncs
+	{
+		MixerAddMonoFunc addMono[3];	// indexed by SoundDataType.
+		MixerAddMonoPackedFunc addMonoPacked;
+		MixerNormalizeFunc normalize;
+		MixerLimitFunc limit;
+		MixerAddResampledFunc addResampled;
+	};
+
+	// Fill the addMono table in SoundDataType order from a template<SoundDataType type> function.
+	#define MIXER_TYPE_TABLE(name) { name<SOUND_DATA_8BIT>, name<SOUND_DATA_16BIT>, name<SOUND_DATA_FLOAT> }
+
+	static const f32 c_channelLimit = 1.0f;
+	static const f32 c_scale[]  = { 2.0f / 255.0f, 2.0f / 65535.0f, 1.0f };
+	static const f32 c_offset[] = { -1.0f, -1.0f, 0.0f };
+
+	static const char* c_mixerSimdNames[MIXER_SIMD_COUNT] =
+	{
+		"Scalar",	// MIXER_SIMD_SCALAR
+		"SSE2",		// MIXER_SIMD_SSE2
+		"AVX2",		// MIXER_SIMD_AVX2
+		"NEON",		// MIXER_SIMD_NEON
+	};
+
+	/////////////////////////////////////////////
+	// Scalar
+	/////////////////////////////////////////////
+	template<SoundDataType type>
+	inline f32 mixer_readSample(const u8* data, u32 index)
+	{
+		f32 sampleValue;
+		switch (type)
+		{
+			case SOUND_DATA_8BIT:  { sampleValue = (f32)data[index]; } break;
+			case SOUND_DATA_16BIT: { sampleValue = (f32)(*((u16*)data + index)); } break;
+			default:               { sampleValue = *((f32*)data + index); } break;
+		};
+		return sampleValue * c_scale[type] + c_offset[type];
+	}
+
+	template<SoundDataType type>
+	void mixer_addMono_Scalar(f32* out, const u8* data, u32 count, f32 leftGain, f32 rightGain)
+	{
+		for (u32 i = 0; i < count; i++, out += 2)
+		{
+			const f32 sample = mixer_readSample<type>(data, i);
+			out[0] += sample * leftGain;
+			out[1] += sample * rightGain;
+		}
+	}
+
+	void mixer_addMonoPacked_Scalar(s16* out, const u8* data, const u32* table, u32 count)
+	{
+		for (u32 i = 0; i < count; i++, out += 2)
+		{
+			const u32 pair = table[data[i]];
+			out[0] += s16(pair & 0xffff);
+			out[1] += s16(pair >> 16);
+		}
+	}
+
+	void mixer_normalize_Scalar(f32* out, const s16* in, const f32* table, u32 count, f32 scale)
+	{
+		for (u32 i = 0; i < count * 2; i++)
+		{
+			out[i] = table[in[i]] * scale;
+		}
+	}
+
+	inline f32 mixer_limitSample(f32 value)
+	{
+		// Audio outside of the [-1, 1] range will cause overflow, which is a major artifact.
+		// Instead the audio needs to be limited in range, which can be done in several ways.
+		// Sigmoid functions map an arbitrary range into [-1, 1] generall along an S-Curve, allowing us to avoid overflow.
+	#if defined(AUDIO_SIGMOID_CLIP)		// Not really a Sigmoid function but acts in a similar way, naively mapping to the required range.
+		return std::max(-c_channelLimit, std::min(value, c_channelLimit));
+	#elif defined(AUDIO_SIGMOID_TANH)	// Considered one of the most "musical sounding" sigmoid functions, it avoids hard clipping.
+		// Note the usable range is approximately -4.8 to 4.8 so the volumes should be adjusted to stay within those ranges when possible.
+		// Still much better than the effect -1 to 1 range with hard clipping and cheaper than the more accurate library tanh(). :)
+		return TFE_Math::tanhf_series(value);
+	#elif defined(AUDIO_SIGMOID_RCP_SQRT)
+		return value / sqrtf(1.0f + value * value);
+	#endif
+	}
+
+	void mixer_limit_Scalar(f32* buffer, u32 count)
+	{
+		for (u32 i = 0; i < count * 2; i++)
+		{
+			buffer[i] = mixer_limitSample(buffer[i]);
+		}
+	}
+
+	// 'first' is the index of the first frame, so the SIMD loops can finish the remaining frames with the same positions and gains.
+	void mixer_addResampledFrom_Scalar(f32* out, const s16* data, u32 first, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep)
+	{
+		for (u32 i = first; i < count; i++)
+		{
+			const f32 pos = frac + step * f32(i);
+			const s32 index = s32(pos);
+			const f32 t = pos - f32(index);
+			const f32 a = f32(data[index]);
+			const f32 b = f32(data[index + 1]);
+			const f32 sample = a + (b - a) * t;
+			out[i * 2 + 0] += sample * (leftGain + leftStep * f32(i));
+			out[i * 2 + 1] += sample * (rightGain + rightStep * f32(i));
+		}
+	}
+
+	void mixer_addResampled_Scalar(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep)
+	{
+		mixer_addResampledFrom_Scalar(out, data, 0, count, frac, step, leftGain, rightGain, leftStep, rightStep);
+	}
+
+	static const MixerFuncs c_mixerScalar =
+	{
+		MIXER_TYPE_TABLE(mixer_addMono_Scalar),
+		mixer_addMonoPacked_Scalar,
+		mixer_normalize_Scalar,
+		mixer_limit_Scalar,
+		mixer_addResampled_Scalar,
+	};
+
+#if MIXER_X86
+	/////////////////////////////////////////////
+	// SSE2
+	/////////////////////////////////////////////
+	// Load 4 samples and convert them to float, without scaling.
+	template<SoundDataType type>
+	inline __m128 mixer_load4_SSE2(const u8* data)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		switch (type)
+		{
+			case SOUND_DATA_8BIT:
+			{
+				s32 bytes;
+				memcpy(&bytes, data, 4);
+				const __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+				return _mm_cvtepi32_ps(_mm_unpacklo_epi16(b, zero));
+			}
+			case SOUND_DATA_16BIT:
+			{
+				return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)data), zero));
+			}
+			default:
+			{
+				return _mm_loadu_ps((const f32*)data);
+			}
+		}
+	}
+
+	// Stereo output: [s0*l, s0*r, s1*l, s1*r] and [s2*l, s2*r, s3*l, s3*r]
+	inline void mixer_addStereo4_SSE2(f32* out, __m128 sample, __m128 gain)
+	{
+		const __m128 lo = _mm_mul_ps(_mm_unpacklo_ps(sample, sample), gain);
+		const __m128 hi = _mm_mul_ps(_mm_unpackhi_ps(sample, sample), gain);
+		_mm_storeu_ps(out,     _mm_add_ps(_mm_loadu_ps(out),     lo));
+		_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), hi));
+	}
+
+	template<SoundDataType type>
+	void mixer_addMono_SSE2(f32* out, const u8* data, u32 count, f32 leftGain, f32 rightGain)
+	{
+		const u32 sampleSize = type == SOUND_DATA_8BIT ? 1 : (type == SOUND_DATA_16BIT ? 2 : 4);
+		const __m128 scale  = _mm_set1_ps(c_scale[type]);
+		const __m128 offset = _mm_set1_ps(c_offset[type]);
+		const __m128 gain   = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+
+		u32 i = 0;
+		for (; i + 4 <= count; i += 4, out += 8)
+		{
+			const __m128 sample = _mm_add_ps(_mm_mul_ps(mixer_load4_SSE2<type>(data + i * sampleSize), scale), offset);
+			mixer_addStereo4_SSE2(out, sample, gain);
+		}
+		if (i < count)
+		{
+			mixer_addMono_Scalar<type>(out, data + i * sampleSize, count - i, leftGain, rightGain);
+		}
+	}
+
+	void mixer_addMonoPacked_SSE2(s16* out, const u8* data, const u32* table, u32 count)
+	{
+		u32 i = 0;
+		for (; i + 4 <= count; i += 4, out += 8)
+		{
+			const __m128i pairs = _mm_setr_epi32(s32(table[data[i]]), s32(table[data[i + 1]]), s32(table[data[i + 2]]), s32(table[data[i + 3]]));
+			_mm_storeu_si128((__m128i*)out, _mm_add_epi16(_mm_loadu_si128((const __m128i*)out), pairs));
+		}
+		if (i < count)
+		{
+			mixer_addMonoPacked_Scalar(out, data + i, table, count - i);
+		}
+	}
+
+	void mixer_normalize_SSE2(f32* out, const s16* in, const f32* table, u32 count, f32 scale)
+	{
+		const __m128 vscale = _mm_set1_ps(scale);
+		const u32 valueCount = count * 2;
+		u32 i = 0;
+		for (; i + 4 <= valueCount; i += 4)
+		{
+			const __m128 value = _mm_setr_ps(table[in[i]], table[in[i + 1]], table[in[i + 2]], table[in[i + 3]]);
+			_mm_storeu_ps(out + i, _mm_mul_ps(value, vscale));
+		}
+		// 'count' is the number of stereo frames, so there are 0 or 2 values left.
+		if (i < valueCount)
+		{
+			mixer_normalize_Scalar(out + i, in + i, table, (valueCount - i) / 2, scale);
+		}
+	}
+
+#if defined(AUDIO_SIGMOID_TANH)
+	// Same as TFE_Math::tanhf_series(), evaluated in the same order so the results match.
+	void mixer_limit_SSE2(f32* buffer, u32 count)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		const __m128 upper = _mm_set1_ps(4.8f);
+		const __m128 lower = _mm_set1_ps(-4.8f);
+		const u32 valueCount = count * 2;
+		u32 i = 0;
+		for (; i + 4 <= valueCount; i += 4)
+		{
+			const __m128 x  = _mm_loadu_ps(buffer + i);
+			const __m128 x2 = _mm_mul_ps(x, x);
+			__m128 a = _mm_add_ps(_mm_set1_ps(378.0f), x2);
+			a = _mm_add_ps(_mm_set1_ps(17325.0f), _mm_mul_ps(x2, a));
+			a = _mm_mul_ps(x, _mm_add_ps(_mm_set1_ps(135135.0f), _mm_mul_ps(x2, a)));
+			__m128 b = _mm_add_ps(_mm_set1_ps(3150.0f), _mm_mul_ps(x2, _mm_set1_ps(28.0f)));
+			b = _mm_add_ps(_mm_set1_ps(62370.0f), _mm_mul_ps(x2, b));
+			b = _mm_add_ps(_mm_set1_ps(135135.0f), _mm_mul_ps(x2, b));
+
+			const __m128 above = _mm_cmpgt_ps(x, upper);
+			const __m128 below = _mm_cmple_ps(x, lower);
+			__m128 res = _mm_andnot_ps(_mm_or_ps(above, below), _mm_div_ps(a, b));
+			res = _mm_or_ps(res, _mm_and_ps(above, one));
+			res = _mm_or_ps(res, _mm_and_ps(below, minusOne));
+			_mm_storeu_ps(buffer + i, res);
+		}
+		if (i < valueCount)
+		{
+			mixer_limit_Scalar(buffer + i, (valueCount - i) / 2);
+		}
+	}
+	#define MIXER_LIMIT_SSE2 mixer_limit_SSE2
+#else
+	#define MIXER_LIMIT_SSE2 mixer_limit_Scalar
+#endif
+
+	// Each 32-bit load at 'index' holds the sample pair (data[index], data[index + 1]), split into 'a' and 'b'.
+	inline void mixer_splitPairs_SSE2(__m128i pairs, __m128& a, __m128& b)
+	{
+		a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(pairs, 16), 16));
+		b = _mm_cvtepi32_ps(_mm_srai_epi32(pairs, 16));
+	}
+
+	void mixer_addResampled_SSE2(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep)
+	{
+		const __m128 vfrac = _mm_set1_ps(frac);
+		const __m128 vstep = _mm_set1_ps(step);
+		const __m128 gain  = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+		const __m128 gainStep = _mm_setr_ps(leftStep, rightStep, leftStep, rightStep);
+		__m128 frame = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 four = _mm_set1_ps(4.0f);
+
+		u32 i = 0;
+		for (; i + 4 <= count; i += 4, frame = _mm_add_ps(frame, four))
+		{
+			const __m128 pos = _mm_add_ps(vfrac, _mm_mul_ps(vstep, frame));
+			const __m128i index = _mm_cvttps_epi32(pos);
+			const __m128 t = _mm_sub_ps(pos, _mm_cvtepi32_ps(index));
+
+			s32 idx[4];
+			_mm_storeu_si128((__m128i*)idx, index);
+			s32 pairs[4];
+			for (s32 k = 0; k < 4; k++) { memcpy(&pairs[k], data + idx[k], 4); }
+			__m128 a, b;
+			mixer_splitPairs_SSE2(_mm_loadu_si128((const __m128i*)pairs), a, b);
+			const __m128 sample = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+
+			// Frame gains: [f0 f0 f1 f1] and [f2 f2 f3 f3]
+			const __m128 frameLo = _mm_unpacklo_ps(frame, frame);
+			const __m128 frameHi = _mm_unpackhi_ps(frame, frame);
+			const __m128 gainLo = _mm_add_ps(gain, _mm_mul_ps(gainStep, frameLo));
+			const __m128 gainHi = _mm_add_ps(gain, _mm_mul_ps(gainStep, frameHi));
+			f32* dst = out + i * 2;
+			_mm_storeu_ps(dst,     _mm_add_ps(_mm_loadu_ps(dst),     _mm_mul_ps(_mm_unpacklo_ps(sample, sample), gainLo)));
+			_mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(_mm_unpackhi_ps(sample, sample), gainHi)));
+		}
+		if (i < count)
+		{
+			mixer_addResampledFrom_Scalar(out, data, i, count, frac, step, leftGain, rightGain, leftStep, rightStep);
+		}
+	}
+
+	static const MixerFuncs c_mixerSSE2 =
+	{
+		MIXER_TYPE_TABLE(mixer_addMono_SSE2),
+		mixer_addMonoPacked_SSE2,
+		mixer_normalize_SSE2,
+		MIXER_LIMIT_SSE2,
+		mixer_addResampled_SSE2,
+	};
+
+	/////////////////////////////////////////////
+	// AVX2
+	/////////////////////////////////////////////
+	// Load 8 samples and convert them to float, without scaling.
+	template<SoundDataType type>
+	MIXER_TARGET_AVX2 inline __m256 mixer_load8_AVX2(const u8* data)
+	{
+		switch (type)
+		{
+			case SOUND_DATA_8BIT:
+			{
+				return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)data)));
+			}
+			case SOUND_DATA_16BIT:
+			{
+				return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)data)));
+			}
+			default:
+			{
+				return _mm256_loadu_ps((const f32*)data);
+			}
+		}
+	}
+
+	template<SoundDataType type>
+	MIXER_TARGET_AVX2 void mixer_addMono_AVX2(f32* out, const u8* data, u32 count, f32 leftGain, f32 rightGain)
+	{
+		const u32 sampleSize = type == SOUND_DATA_8BIT ? 1 : (type == SOUND_DATA_16BIT ? 2 : 4);
+		const __m256 scale  = _mm256_set1_ps(c_scale[type]);
+		const __m256 offset = _mm256_set1_ps(c_offset[type]);
+		const __m256 gain   = _mm256_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+
+		u32 i = 0;
+		for (; i + 8 <= count; i += 8, out += 16)
+		{
+			const __m256 sample = _mm256_add_ps(_mm256_mul_ps(mixer_load8_AVX2<type>(data + i * sampleSize), scale), offset);
+			// Unpacking works within 128-bit lanes: lo = [s0 s0 s1 s1 | s4 s4 s5 s5], hi = [s2 s2 s3 s3 | s6 s6 s7 s7]
+			const __m256 lo = _mm256_unpacklo_ps(sample, sample);
+			const __m256 hi = _mm256_unpackhi_ps(sample, sample);
+			const __m256 first  = _mm256_mul_ps(_mm256_permute2f128_ps(lo, hi, 0x20), gain);
+			const __m256 second = _mm256_mul_ps(_mm256_permute2f128_ps(lo, hi, 0x31), gain);
+			_mm256_storeu_ps(out,     _mm256_add_ps(_mm256_loadu_ps(out),     first));
+			_mm256_storeu_ps(out + 8, _mm256_add_ps(_mm256_loadu_ps(out + 8), second));
+		}
+		if (i < count)
+		{
+			mixer_addMono_SSE2<type>(out, data + i * sampleSize, count - i, leftGain, rightGain);
+		}
+	}
+
+#if defined(AUDIO_SIGMOID_TANH)
+	MIXER_TARGET_AVX2 void mixer_limit_AVX2(f32* buffer, u32 count)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 minusOne = _mm256_set1_ps(-1.0f);
+		const __m256 upper = _mm256_set1_ps(4.8f);
+		const __m256 lower = _mm256_set1_ps(-4.8f);
+		const u32 valueCount = count * 2;
+		u32 i = 0;
+		for (; i + 8 <= valueCount; i += 8)
+		{
+			const __m256 x  = _mm256_loadu_ps(buffer + i);
+			const __m256 x2 = _mm256_mul_ps(x, x);
+			__m256 a = _mm256_add_ps(_mm256_set1_ps(378.0f), x2);
+			a = _mm256_add_ps(_mm256_set1_ps(17325.0f), _mm256_mul_ps(x2, a));
+			a = _mm256_mul_ps(x, _mm256_add_ps(_mm256_set1_ps(135135.0f), _mm256_mul_ps(x2, a)));
+			__m256 b = _mm256_add_ps(_mm256_set1_ps(3150.0f), _mm256_mul_ps(x2, _mm256_set1_ps(28.0f)));
+			b = _mm256_add_ps(_mm256_set1_ps(62370.0f), _mm256_mul_ps(x2, b));
+			b = _mm256_add_ps(_mm256_set1_ps(135135.0f), _mm256_mul_ps(x2, b));
+
+			const __m256 above = _mm256_cmp_ps(x, upper, _CMP_GT_OQ);
+			const __m256 below = _mm256_cmp_ps(x, lower, _CMP_LE_OQ);
+			__m256 res = _mm256_blendv_ps(_mm256_div_ps(a, b), one, above);
+			res = _mm256_blendv_ps(res, minusOne, below);
+			_mm256_storeu_ps(buffer + i, res);
+		}
+		if (i < valueCount)
+		{
+			mixer_limit_SSE2(buffer + i, (valueCount - i) / 2);
+		}
+	}
+	#define MIXER_LIMIT_AVX2 mixer_limit_AVX2
+#else
+	#define MIXER_LIMIT_AVX2 mixer_limit_Scalar
+#endif
+
+	MIXER_TARGET_AVX2 void mixer_addResampled_AVX2(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep)
+	{
+		const __m256 vfrac = _mm256_set1_ps(frac);
+		const __m256 vstep = _mm256_set1_ps(step);
+		const __m256 gain  = _mm256_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+		const __m256 gainStep = _mm256_setr_ps(leftStep, rightStep, leftStep, rightStep, leftStep, rightStep, leftStep, rightStep);
+		__m256 frame = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		const __m256 eight = _mm256_set1_ps(8.0f);
+
+		u32 i = 0;
+		for (; i + 8 <= count; i += 8, frame = _mm256_add_ps(frame, eight))
+		{
+			const __m256 pos = _mm256_add_ps(vfrac, _mm256_mul_ps(vstep, frame));
+			const __m256i index = _mm256_cvttps_epi32(pos);
+			const __m256 t = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(index));
+
+			// Gather the sample pairs (data[index], data[index + 1]) as 32-bit values, 'index' is scaled by the sample size.
+			const __m256i pairs = _mm256_i32gather_epi32((const int*)data, index, 2);
+			const __m256 a = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(pairs, 16), 16));
+			const __m256 b = _mm256_cvtepi32_ps(_mm256_srai_epi32(pairs, 16));
+			const __m256 sample = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+
+			// Unpacking works within 128-bit lanes: lo = [s0 s0 s1 s1 | s4 s4 s5 s5], hi = [s2 s2 s3 s3 | s6 s6 s7 s7]
+			const __m256 sampleLo = _mm256_unpacklo_ps(sample, sample);
+			const __m256 sampleHi = _mm256_unpackhi_ps(sample, sample);
+			const __m256 frameLo  = _mm256_unpacklo_ps(frame, frame);
+			const __m256 frameHi  = _mm256_unpackhi_ps(frame, frame);
+			const __m256 valueLo = _mm256_mul_ps(sampleLo, _mm256_add_ps(gain, _mm256_mul_ps(gainStep, frameLo)));
+			const __m256 valueHi = _mm256_mul_ps(sampleHi, _mm256_add_ps(gain, _mm256_mul_ps(gainStep, frameHi)));
+			f32* dst = out + i * 2;
+			_mm256_storeu_ps(dst,     _mm256_add_ps(_mm256_loadu_ps(dst),     _mm256_permute2f128_ps(valueLo, valueHi, 0x20)));
+			_mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_loadu_ps(dst + 8), _mm256_permute2f128_ps(valueLo, valueHi, 0x31)));
+		}
+		if (i < count)
+		{
+			mixer_addResampledFrom_Scalar(out, data, i, count, frac, step, leftGain, rightGain, leftStep, rightStep);
+		}
+	}
+
+	// The table lookups dominate the packed and normalize loops, so wider vectors do not help there.
+	static const MixerFuncs c_mixerAVX2 =
+	{
+		MIXER_TYPE_TABLE(mixer_addMono_AVX2),
+		mixer_addMonoPacked_SSE2,
+		mixer_normalize_SSE2,
+		MIXER_LIMIT_AVX2,
+		mixer_addResampled_AVX2,
+	};
+#endif
+
+#if MIXER_NEON
+	/////////////////////////////////////////////
+	// NEON
+	/////////////////////////////////////////////
+	// Load 4 samples and convert them to float, without scaling.
+	template<SoundDataType type>
+	inline float32x4_t mixer_load4_NEON(const u8* data)
+	{
+		switch (type)
+		{
+			case SOUND_DATA_8BIT:
+			{
+				u32 bytes;
+				memcpy(&bytes, data, 4);
+				const uint16x8_t h = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+				return vcvtq_f32_u32(vmovl_u16(vget_low_u16(h)));
+			}
+			case SOUND_DATA_16BIT:
+			{
+				return vcvtq_f32_u32(vmovl_u16(vld1_u16((const u16*)data)));
+			}
+			default:
+			{
+				return vld1q_f32((const f32*)data);
+			}
+		}
+	}
+
+	template<SoundDataType type>
+	void mixer_addMono_NEON(f32* out, const u8* data, u32 count, f32 leftGain, f32 rightGain)
+	{
+		const u32 sampleSize = type == SOUND_DATA_8BIT ? 1 : (type == SOUND_DATA_16BIT ? 2 : 4);
+		const float32x4_t scale  = vdupq_n_f32(c_scale[type]);
+		const float32x4_t offset = vdupq_n_f32(c_offset[type]);
+		const f32 gainValues[4] = { leftGain, rightGain, leftGain, rightGain };
+		const float32x4_t gain = vld1q_f32(gainValues);
+
+		u32 i = 0;
+		for (; i + 4 <= count; i += 4, out += 8)
+		{
+			// Multiply and add separately, fused multiply-add would round differently than the scalar loop.
+			const float32x4_t sample = vaddq_f32(vmulq_f32(mixer_load4_NEON<type>(data + i * sampleSize), scale), offset);
+			const float32x4x2_t stereo = vzipq_f32(sample, sample);
+			vst1q_f32(out,     vaddq_f32(vld1q_f32(out),     vmulq_f32(stereo.val[0], gain)));
+			vst1q_f32(out + 4, vaddq_f32(vld1q_f32(out + 4), vmulq_f32(stereo.val[1], gain)));
+		}
+		if (i < count)
+		{
+			mixer_addMono_Scalar<type>(out, data + i * sampleSize, count - i, leftGain, rightGain);
+		}
+	}
+
+	void mixer_addMonoPacked_NEON(s16* out, const u8* data, const u32* table, u32 count)
+	{
+		u32 i = 0;
+		for (; i + 4 <= count; i += 4, out += 8)
+		{
+			const u32 pairs[4] = { table[data[i]], table[data[i + 1]], table[data[i + 2]], table[data[i + 3]] };
+			vst1q_s16(out, vaddq_s16(vld1q_s16(out), vreinterpretq_s16_u32(vld1q_u32(pairs))));
+		}
+		if (i < count)
+		{
+			mixer_addMonoPacked_Scalar(out, data + i, table, count - i);
+		}
+	}
+
+	void mixer_normalize_NEON(f32* out, const s16* in, const f32* table, u32 count, f32 scale)
+	{
+		const float32x4_t vscale = vdupq_n_f32(scale);
+		const u32 valueCount = count * 2;
+		u32 i = 0;
+		for (; i + 4 <= valueCount; i += 4)
+		{
+			const f32 values[4] = { table[in[i]], table[in[i + 1]], table[in[i + 2]], table[in[i + 3]] };
+			vst1q_f32(out + i, vmulq_f32(vld1q_f32(values), vscale));
+		}
+		if (i < valueCount)
+		{
+			mixer_normalize_Scalar(out + i, in + i, table, (valueCount - i) / 2, scale);
+		}
+	}
+
+#if defined(AUDIO_SIGMOID_TANH)
+	void mixer_limit_NEON(f32* buffer, u32 count)
+	{
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t minusOne = vdupq_n_f32(-1.0f);
+		const float32x4_t upper = vdupq_n_f32(4.8f);
+		const float32x4_t lower = vdupq_n_f32(-4.8f);
+		const u32 valueCount = count * 2;
+		u32 i = 0;
+		for (; i + 4 <= valueCount; i += 4)
+		{
+			const float32x4_t x  = vld1q_f32(buffer + i);
+			const float32x4_t x2 = vmulq_f32(x, x);
+			float32x4_t a = vaddq_f32(vdupq_n_f32(378.0f), x2);
+			a = vaddq_f32(vdupq_n_f32(17325.0f), vmulq_f32(x2, a));
+			a = vmulq_f32(x, vaddq_f32(vdupq_n_f32(135135.0f), vmulq_f32(x2, a)));
+			float32x4_t b = vaddq_f32(vdupq_n_f32(3150.0f), vmulq_f32(x2, vdupq_n_f32(28.0f)));
+			b = vaddq_f32(vdupq_n_f32(62370.0f), vmulq_f32(x2, b));
+			b = vaddq_f32(vdupq_n_f32(135135.0f), vmulq_f32(x2, b));
+
+			float32x4_t res = vdivq_f32(a, b);
+			res = vbslq_f32(vcgtq_f32(x, upper), one, res);
+			res = vbslq_f32(vcleq_f32(x, lower), minusOne, res);
+			vst1q_f32(buffer + i, res);
+		}
+		if (i < valueCount)
+		{
+			mixer_limit_Scalar(buffer + i, (valueCount - i) / 2);
+		}
+	}
+	#define MIXER_LIMIT_NEON mixer_limit_NEON
+#else
+	#define MIXER_LIMIT_NEON mixer_limit_Scalar
+#endif
+
+	void mixer_addResampled_NEON(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep)
+	{
+		const float32x4_t vfrac = vdupq_n_f32(frac);
+		const float32x4_t vstep = vdupq_n_f32(step);
+		const f32 gainValues[4] = { leftGain, rightGain, leftGain, rightGain };
+		const f32 gainStepValues[4] = { leftStep, rightStep, leftStep, rightStep };
+		const f32 frameValues[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+		const float32x4_t gain = vld1q_f32(gainValues);
+		const float32x4_t gainStep = vld1q_f32(gainStepValues);
+		const float32x4_t four = vdupq_n_f32(4.0f);
+		float32x4_t frame = vld1q_f32(frameValues);
+
+		u32 i = 0;
+		for (; i + 4 <= count; i += 4, frame = vaddq_f32(frame, four))
+		{
+			// Multiply and add separately, fused multiply-add would round differently than the scalar loop.
+			const float32x4_t pos = vaddq_f32(vfrac, vmulq_f32(vstep, frame));
+			const int32x4_t index = vcvtq_s32_f32(pos);
+			const float32x4_t t = vsubq_f32(pos, vcvtq_f32_s32(index));
+
+			s32 idx[4];
+			vst1q_s32(idx, index);
+			s32 pairs[4];
+			for (s32 k = 0; k < 4; k++) { memcpy(&pairs[k], data + idx[k], 4); }
+			const int32x4_t p = vld1q_s32(pairs);
+			const float32x4_t a = vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(p, 16), 16));
+			const float32x4_t b = vcvtq_f32_s32(vshrq_n_s32(p, 16));
+			const float32x4_t sample = vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), t));
+
+			const float32x4x2_t stereo = vzipq_f32(sample, sample);
+			const float32x4x2_t frames = vzipq_f32(frame, frame);
+			f32* dst = out + i * 2;
+			vst1q_f32(dst,     vaddq_f32(vld1q_f32(dst),     vmulq_f32(stereo.val[0], vaddq_f32(gain, vmulq_f32(gainStep, frames.val[0])))));
+			vst1q_f32(dst + 4, vaddq_f32(vld1q_f32(dst + 4), vmulq_f32(stereo.val[1], vaddq_f32(gain, vmulq_f32(gainStep, frames.val[1])))));
+		}
+		if (i < count)
+		{
+			mixer_addResampledFrom_Scalar(out, data, i, count, frac, step, leftGain, rightGain, leftStep, rightStep);
+		}
+	}
+
+	static const MixerFuncs c_mixerNEON =
+	{
+		MIXER_TYPE_TABLE(mixer_addMono_NEON),
+		mixer_addMonoPacked_NEON,
+		mixer_normalize_NEON,
+		MIXER_LIMIT_NEON,
+		mixer_addResampled_NEON,
+	};
+#endif
+
+	static MixerSimd s_simd = MIXER_SIMD_SCALAR;
+	static const MixerFuncs* s_mixerFuncs = &c_mixerScalar;
+
+	/////////////////////////////////////////////
+	// API
+	/////////////////////////////////////////////
+	void mixer_init()
+	{
+		MixerSimd simd = MIXER_SIMD_SCALAR;
+	#if MIXER_X86
+		if (SDL_HasAVX2())
+		{
+			simd = MIXER_SIMD_AVX2;
+		}
+		else if (SDL_HasSSE2())
+		{
+			simd = MIXER_SIMD_SSE2;
+		}
+	#elif MIXER_NEON
+		simd = MIXER_SIMD_NEON;
+	#endif
+		mixer_setSimd(simd);
+		TFE_System::logWrite(LOG_MSG, "Audio", "Audio mixer functions: %s", c_mixerSimdNames[s_simd]);
+	}
+
+	bool mixer_setSimd(MixerSimd simd)
+	{
+		switch (simd)
+		{
+			case MIXER_SIMD_SCALAR:
+			{
+				s_mixerFuncs = &c_mixerScalar;
+			} break;
+		#if MIXER_X86
+			case MIXER_SIMD_SSE2:
+			{
+				if (!SDL_HasSSE2()) { return false; }
+				s_mixerFuncs = &c_mixerSSE2;
+			} break;
+			case MIXER_SIMD_AVX2:
+			{
+				if (!SDL_HasAVX2()) { return false; }
+				s_mixerFuncs = &c_mixerAVX2;
+			} break;
+		#endif
+		#if MIXER_NEON
+			case MIXER_SIMD_NEON:
+			{
+				s_mixerFuncs = &c_mixerNEON;
+			} break;
+		#endif
+			default:
+				return false;
+		}
+		s_simd = simd;
+		return true;
+	}
+
+	MixerSimd mixer_getSimd()
+	{
+		return s_simd;
+	}
+
+	const char* mixer_getSimdName(MixerSimd simd)
+	{
+		return (simd >= MIXER_SIMD_SCALAR && simd < MIXER_SIMD_COUNT) ? c_mixerSimdNames[simd] : "Invalid";
+	}
+
+	void mixer_addMono(f32* out, const u8* data, SoundDataType type, u32 count, f32 leftGain, f32 rightGain)
+	{
+		if (!count) { return; }
+		s_mixerFuncs->addMono[type](out, data, count, leftGain, rightGain);
+	}
+
+	void mixer_addMonoPacked(s16* out, const u8* data, const u32* table, u32 count)
+	{
+		if (!count) { return; }
+		s_mixerFuncs->addMonoPacked(out, data, table, count);
+	}
+
+	void mixer_normalize(f32* out, const s16* in, const f32* table, u32 count, f32 scale)
+	{
+		if (!count) { return; }
+		s_mixerFuncs->normalize(out, in, table, count, scale);
+	}
+
+	void mixer_limit(f32* buffer, u32 count)
+	{
+		if (!count) { return; }
+		s_mixerFuncs->limit(buffer, count);
+	}
+
+	void mixer_addResampled(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep)
+	{
+		if (!count) { return; }
+		s_mixerFuncs->addResampled(out, data, count, frac, step, leftGain, rightGain, leftStep, rightStep);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Audio Mixer
+// Block based inner loops used to mix sound sources, iMuse digital
+// sound and MIDI synthesizer voices into the output buffer.
+//
+// The loops are selected at runtime based on the CPU (scalar, SSE2,
+// AVX2 or NEON). Samples are converted and accumulated several at a
+// time, but the SIMD versions produce the same output as the scalar
+// loops.
+//
+// Output buffers are interleaved stereo, 'count' is the number of
+// stereo frames.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include "audioSystem.h"
+
+namespace TFE_Audio
+{
+	enum MixerSimd
+	{
+		MIXER_SIMD_SCALAR = 0,
+		MIXER_SIMD_SSE2,
+		MIXER_SIMD_AVX2,
+		MIXER_SIMD_NEON,
+		MIXER_SIMD_COUNT
+	};
+
+	// Select the best implementation supported by the CPU.
+	void mixer_init();
+	// Force a specific implementation, returns false if it is not supported.
+	bool mixer_setSimd(MixerSimd simd);
+	MixerSimd mixer_getSimd();
+	const char* mixer_getSimdName(MixerSimd simd);
+
+	// Convert 'count' mono samples of 'type' starting at 'data' to [-1, 1) and add them to 'out' scaled by the channel gains.
+	void mixer_addMono(f32* out, const u8* data, SoundDataType type, u32 count, f32 leftGain, f32 rightGain);
+	// Add 'count' 8-bit mono samples to 16-bit 'out', 'table' maps each sample value to a left (low 16 bits) and right (high 16 bits) pair.
+	void mixer_addMonoPacked(s16* out, const u8* data, const u32* table, u32 count);
+	// out = table[in] * scale, where 'table' may be addressed with negative values.
+	void mixer_normalize(f32* out, const s16* in, const f32* table, u32 count, f32 scale);
+	// Limit the output to [-1, 1] without hard clipping.
+	void mixer_limit(f32* buffer, u32 count);
+	// Add 'count' frames of 16-bit mono 'data' to 'out', resampled with linear interpolation. Frame i reads position
+	// 'frac + step * i' so 'data' must be readable up to one sample past the last position. The gains start at
+	// 'leftGain' and 'rightGain' and change by 'leftStep' and 'rightStep' every frame.
+	void mixer_addResampled(f32* out, const s16* data, u32 count, f32 frac, f32 step, f32 leftGain, f32 rightGain, f32 leftStep, f32 rightStep);
+}
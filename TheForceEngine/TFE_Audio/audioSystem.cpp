@@ -2,6 +2,7 @@
 
 #include "audioSystem.h"
 #include "audioDevice.h"
+#include "audioMixer.h"
 #include <TFE_System/system.h>
 #include <TFE_System/math.h>
 #include <TFE_Settings/settings.h>
@@ -10,11 +11,6 @@
 #include <assert.h>
 #include <algorithm>
 
-// Comment out the desired sigmoid function and comment all of the others.
-//#define AUDIO_SIGMOID_CLIP 1
-#define AUDIO_SIGMOID_TANH 1
-//#define AUDIO_SIGMOID_RCP_SQRT 1
-
 // Volume level below which sound processing can be skipped.
 #define SND_CULL_VOLUME 0.0001f
 
@@ -37,6 +33,8 @@ struct SoundSource
 	u32 sampleIndex;
 	u32 flags;
 	s32 slot;
+	// Incremented whenever the client changes the playback state, so the mixer can tell if the source changed while it was mixing.
+	u32 generation;
 
 	// Sound data.
 	const SoundBuffer* buffer;
@@ -47,10 +45,21 @@ struct SoundSource
 	s32 finishedArg = 0;
 };
 
+// Playback state of a source copied at the start of the audio callback, so it can be mixed outside of the lock.
+struct SoundSourceMix
+{
+	SoundSource* source;
+	const SoundBuffer* buffer;
+	u32 generation;
+	u32 sampleIndex;
+	u32 flags;
+	f32 volume;
+};
+
 namespace TFE_Audio
 {
-	static const f32 c_channelLimit  = 1.0f;
 	static const f32 c_soundHeadroom = 0.7f;
+	static const u32 c_sampleSize[] = { 1, 2, 4 };
 
 	// Client volume controls, ranging from [0, 1]
 	static f32 s_soundFxVolume = 1.0f;
@@ -61,11 +70,19 @@ namespace TFE_Audio
 	static bool s_paused = false;
 	static bool s_nullDevice = false;
 
+	// Set while the audio thread is mixing outside of the lock.
+	static atomic_bool s_mixing;
+	static u32 s_mixCount = 0;
+	static SoundSourceMix s_mix[MAX_SOUND_SOURCES];
+
 	static AudioThreadCallback s_audioThreadCallback = nullptr;
+	static AudioThreadCallback s_midiSynthCallback = nullptr;
+	static const u32 c_outputSampleRate = 11025u;
 
 	s32 audioCallback(void *outputBuffer, void* inputBuffer, u32 bufferSize, f64 streamTime, u32 status, void* userData);
 	void setSoundVolumeConsole(const ConsoleArgList& args);
 	void getSoundVolumeConsole(const ConsoleArgList& args);
+	void waitForMixing();
 
 #if AUDIO_TIMING == 1
 	static f64 s_soundIterMaxF = 0.0;
@@ -89,7 +106,9 @@ namespace TFE_Audio
 
 		TFE_Settings_Sound* soundSettings = TFE_Settings::getSoundSettings();
 		setVolume(soundSettings->soundFxVolume);
+		mixer_init();
 
+		s_mixing = false;
 		memset(s_sources, 0, sizeof(SoundSource) * MAX_SOUND_SOURCES);
 		for (s32 i = 0; i < MAX_SOUND_SOURCES; i++)
 		{
@@ -104,7 +123,7 @@ namespace TFE_Audio
 			return false;
 		}
 
-		bool audStream = TFE_AudioDevice::startOutput(audioCallback, nullptr, 2u, 11025u);
+		bool audStream = TFE_AudioDevice::startOutput(audioCallback, nullptr, 2u, c_outputSampleRate);
 		if (!audStream)
 		{
 			TFE_System::logWrite(LOG_ERROR, "Audio", "Cannot start audio stream.");
@@ -134,12 +153,16 @@ namespace TFE_Audio
 
 		MUTEX_LOCK(&s_mutex);
 		s_sourceCount = 0u;
-		memset(s_sources, 0, sizeof(SoundSource) * MAX_SOUND_SOURCES);
 		for (s32 i = 0; i < MAX_SOUND_SOURCES; i++)
 		{
+			// Keep the generation counting up so sources being mixed are not restored.
+			const u32 generation = s_sources[i].generation + 1;
+			memset(&s_sources[i], 0, sizeof(SoundSource));
 			s_sources[i].slot = i;
+			s_sources[i].generation = generation;
 		}
 		MUTEX_UNLOCK(&s_mutex);
+		waitForMixing();
 	}
 
 	void setVolume(f32 volume)
@@ -171,6 +194,20 @@ namespace TFE_Audio
 		MUTEX_UNLOCK(&s_mutex);
 	}
 
+	void setMidiSynthCallback(AudioThreadCallback callback)
+	{
+		if (s_nullDevice) { return; }
+
+		MUTEX_LOCK(&s_mutex);
+		s_midiSynthCallback = callback;
+		MUTEX_UNLOCK(&s_mutex);
+	}
+
+	u32 getSampleRate()
+	{
+		return c_outputSampleRate;
+	}
+
 	void lock()
 	{
 		if (s_nullDevice) { return; }
@@ -221,6 +258,7 @@ namespace TFE_Audio
 			newSource->finishedCallback = finishedCallback;
 			newSource->finishedUserData = cbUserData;
 			newSource->finishedArg = cbArg;
+			newSource->generation++;
 		}
 		MUTEX_UNLOCK(&s_mutex);
 
@@ -260,6 +298,7 @@ namespace TFE_Audio
 			newSource->sampleIndex = 0u;
 			newSource->finishedCallback = callback;
 			newSource->finishedUserData = userData;
+			newSource->generation++;
 		}
 		MUTEX_UNLOCK(&s_mutex);
 
@@ -299,6 +338,7 @@ namespace TFE_Audio
 			source->flags |= SND_FLAG_PLAYING;
 			if (looping) { source->flags |= SND_FLAG_LOOPING; }
 			source->sampleIndex = 0u;
+			source->generation++;
 		MUTEX_UNLOCK(&s_mutex);
 	}
 
@@ -307,6 +347,7 @@ namespace TFE_Audio
 		if (!source || s_nullDevice) { return; }
 		MUTEX_LOCK(&s_mutex);
 			source->flags &= ~SND_FLAG_PLAYING;
+			source->generation++;
 		MUTEX_UNLOCK(&s_mutex);
 	}
 	
@@ -317,7 +358,10 @@ namespace TFE_Audio
 			source->flags &= ~SND_FLAG_PLAYING;
 			source->flags &= ~SND_FLAG_ACTIVE;
 			source->buffer = nullptr;
+			source->generation++;
 		MUTEX_UNLOCK(&s_mutex);
+		// The client may free the buffer once this returns.
+		waitForMixing();
 	}
 
 	void setSourceVolume(SoundSource* source, f32 volume)
@@ -333,7 +377,9 @@ namespace TFE_Audio
 		MUTEX_LOCK(&s_mutex);
 			source->sampleIndex = 0u;
 			source->buffer = buffer;
+			source->generation++;
 		MUTEX_UNLOCK(&s_mutex);
+		waitForMixing();
 	}
 
 	bool isSourcePlaying(SoundSource* source)
@@ -349,8 +395,14 @@ namespace TFE_Audio
 	}
 
 	// Internal
-	static const f32 c_scale[] = { 2.0f / 255.0f, 2.0f / 65535.0f, 1.0f };
-	static const f32 c_offset[] = { -1.0f, -1.0f, 0.0f };
+	// Wait until the audio thread is done with the sources it copied, so their buffers are no longer referenced.
+	void waitForMixing()
+	{
+		while (s_mixing)
+		{
+			TFE_System::sleep(0);
+		}
+	}
 
 	void cleanupSources()
 	{
@@ -379,21 +431,66 @@ namespace TFE_Audio
 			s_sourceCount--;
 		}
 	}
-		
-	f32 sampleBuffer(u32 index, SoundDataType type, const u8* data)
+
+	void mixSource(SoundSourceMix* snd, f32* outputBuffer, u32 bufferSize)
 	{
-		f32 sampleValue = 0.0f;
-		switch (type)
+		// Skip sound sample processing the sound is too quiet...
+		const u32 sndBufferSize = snd->buffer->size;
+		if (snd->volume < SND_CULL_VOLUME)
 		{
-			case SOUND_DATA_8BIT:  { sampleValue = (f32)data[index]; } break;
-			case SOUND_DATA_16BIT: { sampleValue = (f32)(*((u16*)data + index)); } break;
-			case SOUND_DATA_FLOAT: { sampleValue = *((f32*)data + index); } break;
-		};
+			// Pretend we played the sound and handle looping.
+			snd->sampleIndex += bufferSize;
+			if (snd->sampleIndex >= sndBufferSize)
+			{
+				if (snd->flags&SND_FLAG_LOOPING)
+				{
+					snd->sampleIndex = (snd->sampleIndex % sndBufferSize) + snd->buffer->loopStart;
+				}
+				else
+				{
+					snd->flags &= ~SND_FLAG_PLAYING;
+					snd->flags |= SND_FLAG_FINISHED;
+					snd->sampleIndex = 0u;
+				}
+			}
+			return;
+		}
 
-		return sampleValue * c_scale[type] + c_offset[type];
+		// Sample loop.
+		f32* buffer = outputBuffer;
+		const SoundDataType type = snd->buffer->type;
+		const u8* data = snd->buffer->data;
+		// The sound may be split into multiple iterations if it loops or the loop
+		// may end early, once we reach the end.
+		for (u32 i = 0; i < bufferSize;)
+		{
+			if (snd->sampleIndex >= sndBufferSize)
+			{
+				if (snd->flags&SND_FLAG_LOOPING)
+				{
+					snd->sampleIndex = snd->buffer->loopStart;
+				}
+				else
+				{
+					snd->flags &= ~SND_FLAG_PLAYING;
+					snd->flags |= SND_FLAG_FINISHED;
+					snd->sampleIndex = 0u;
+					break;
+				}
+			}
+
+			// Sources are mono and not panned, so both channels get the same gain.
+			const u32 count = std::min(sndBufferSize - snd->sampleIndex, bufferSize - i);
+			mixer_addMono(buffer, data + snd->sampleIndex * c_sampleSize[type], type, count, snd->volume, snd->volume);
+			snd->sampleIndex += count;
+			buffer += count * 2;
+			i += count;
+		}
 	}
 
 	// Audio callback
+	// The lock is only held while copying the playing sources and while writing the results back,
+	// the thread callback and mixing run without it so the game thread is not blocked.
 	s32 audioCallback(void *outputBuffer, void* inputBuffer, u32 bufferSize, f64 streamTime, u32 status, void* userData)
 	{
 		f32* buffer = (f32*)outputBuffer;
@@ -404,106 +501,66 @@ namespace TFE_Audio
 
 		// First clear samples
 		memset(buffer, 0, sizeof(f32)*bufferSize*2);
-			   
+
+		// Copy the playing sources.
+		// Note: this is no longer used by Dark Forces. However I decided to keep direct sound support around
+		// so it can be used for tools.
 		MUTEX_LOCK(&s_mutex);
-		// Then call the audio thread callback
-		if (s_audioThreadCallback && !s_paused)
+		const AudioThreadCallback threadCallback = s_paused ? nullptr : s_audioThreadCallback;
+		const AudioThreadCallback synthCallback = s_paused ? nullptr : s_midiSynthCallback;
+		const f32 systemVolume = s_soundFxVolume * c_soundHeadroom;
+		s_mixCount = 0;
+		SoundSource* src = s_sources;
+		for (u32 s = 0; s < s_sourceCount && !s_paused; s++, src++)
 		{
-			s_audioThreadCallback(buffer, bufferSize, s_soundFxVolume * c_soundHeadroom);
+			if (!(src->flags&SND_FLAG_PLAYING)) { continue; }
+			assert(src->buffer && src->buffer->data);
+
+			SoundSourceMix* snd = &s_mix[s_mixCount++];
+			snd->source = src;
+			snd->buffer = src->buffer;
+			snd->generation = src->generation;
+			snd->sampleIndex = src->sampleIndex;
+			snd->flags = src->flags;
+			snd->volume = src->volume;
 		}
+		s_mixing = s_mixCount > 0;
+		MUTEX_UNLOCK(&s_mutex);
 
-		// Then loop through the sources.
-		// Note: this is no longer used by Dark Forces. However I decided to keep direct sound support around
-		// so it can be used for tools.
-		SoundSource* snd = s_sources;
-		for (u32 s = 0; s < s_sourceCount && !s_paused; s++, snd++)
+		// Then call the audio thread callbacks, they handle their own locking.
+		if (threadCallback)
+		{
+			threadCallback(buffer, bufferSize, systemVolume);
+		}
+		if (synthCallback)
 		{
-			if (!(snd->flags&SND_FLAG_PLAYING)) { continue; }
-			assert(snd->buffer->data);
+			synthCallback(buffer, bufferSize, systemVolume);
+		}
 
-			// Skip sound sample processing the sound is too quiet...
-			const u32 sndBufferSize = snd->buffer->size;
-			if (snd->volume < SND_CULL_VOLUME)
-			{
-				// Pretend we played the sound and handle looping.
-				snd->sampleIndex += bufferSize;
-				if (snd->sampleIndex >= sndBufferSize)
-				{
-					if (snd->flags&SND_FLAG_LOOPING)
-					{
-						snd->sampleIndex = (snd->sampleIndex % sndBufferSize) + snd->buffer->loopStart;
-					}
-					else
-					{
-						snd->flags &= ~SND_FLAG_PLAYING;
-						snd->flags |= SND_FLAG_FINISHED;
-						snd->sampleIndex = 0u;
-					}
-				}
-				continue;
-			}
+		// Then mix the sources.
+		for (u32 s = 0; s < s_mixCount; s++)
+		{
+			mixSource(&s_mix[s], buffer, bufferSize);
+		}
+		s_mixing = false;
 
-			// Sample loop.
-			buffer = (f32*)outputBuffer;
-			// The sound may be split into multiple iterations if it loops or the loop
-			// may end early, once we reach the end.
-			for (u32 i = 0; i < bufferSize;)
-			{
-				if (snd->sampleIndex >= sndBufferSize)
-				{
-					if (snd->flags&SND_FLAG_LOOPING)
-					{
-						snd->sampleIndex = snd->buffer->loopStart;
-					}
-					else
-					{
-						snd->flags &= ~SND_FLAG_PLAYING;
-						snd->flags |= SND_FLAG_FINISHED;
-						snd->sampleIndex = 0u;
-						break;
-					}
-				}
+		// Write back the playback state, unless the client changed the source in the meantime.
+		MUTEX_LOCK(&s_mutex);
+		for (u32 s = 0; s < s_mixCount; s++)
+		{
+			const SoundSourceMix* snd = &s_mix[s];
+			SoundSource* source = snd->source;
+			if (source->generation != snd->generation) { continue; }
 
-				const SoundDataType type = snd->buffer->type;
-				const u8* data = snd->buffer->data;
-				const u32 end = std::min(sndBufferSize, snd->sampleIndex + bufferSize - i);
-				u32 sIndex = snd->sampleIndex;
-				for (; sIndex < end; i++, sIndex++, buffer += 2)
-				{
-					const f32 sample = sampleBuffer(sIndex, type, data) * snd->volume;
-					buffer[0] += sample;
-					buffer[1] += sample;
-				}
-				snd->sampleIndex = sIndex;
-			}
+			source->sampleIndex = snd->sampleIndex;
+			source->flags = snd->flags;
 		}
 		// Cleanup sound sources while we are still in the mutex.
 		cleanupSources();
 		MUTEX_UNLOCK(&s_mutex);
 
 		// Finally handle out of range audio samples.
-		buffer = (f32*)outputBuffer;
-		for (u32 i = 0; i < bufferSize; i++, buffer += 2)
-		{
-			const f32 valueLeft  = buffer[0];
-			const f32 valueRight = buffer[1];
-
-			// Audio outside of the [-1, 1] range will cause overflow, which is a major artifact.
-			// Instead the audio needs to be limited in range, which can be done in several ways.
-			// Sigmoid functions map an arbitrary range into [-1, 1] generall along an S-Curve, allowing us to avoid overflow.
-		#if defined(AUDIO_SIGMOID_CLIP)		// Not really a Sigmoid function but acts in a similar way, naively mapping to the required range.
-			buffer[0] = std::max(-c_channelLimit, std::min(valueLeft,  c_channelLimit));
-			buffer[1] = std::max(-c_channelLimit, std::min(valueRight, c_channelLimit));
-		#elif defined(AUDIO_SIGMOID_TANH)	// Considered one of the most "musical sounding" sigmoid functions, it avoids hard clipping.
-			// Note the usable range is approximately -4.8 to 4.8 so the volumes should be adjusted to stay within those ranges when possible.
-			// Still much better than the effect -1 to 1 range with hard clipping and cheaper than the more accurate library tanh(). :)
-			buffer[0] = TFE_Math::tanhf_series(valueLeft);
-			buffer[1] = TFE_Math::tanhf_series(valueRight);
-		#elif defined(AUDIO_SIGMOID_RCP_SQRT)
-			buffer[0] = valueLeft  / sqrtf(1.0f + valueLeft * valueLeft);
-			buffer[1] = valueRight / sqrtf(1.0f + valueRight * valueRight);
-		#endif
-		}
+		mixer_limit(buffer, bufferSize);
 
 		// Timing
 	#if AUDIO_TIMING == 1
@@ -67,7 +67,12 @@ namespace TFE_Audio
 	void lock();
 	void unlock();
 
+	// The callback is called from the audio thread without the audio lock held, use lock() and unlock() to protect shared state.
 	void setAudioThreadCallback(AudioThreadCallback callback = nullptr);
+	// Same as the audio thread callback, used by the MIDI synthesizer so it can play alongside iMuse digital sound.
+	void setMidiSynthCallback(AudioThreadCallback callback = nullptr);
+	// Output sample rate in Hz.
+	u32 getSampleRate();
 
 	// One shot, play and forget. Only do this if the client needs no control until stopAllSounds() is called.
 	// Note that looping one shots are valid though may generate too many sound sources if not used carefully.
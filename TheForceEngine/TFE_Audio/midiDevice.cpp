@@ -1,6 +1,7 @@
 #include <cstring>
 
 #include "midiDevice.h"
+#include "midiSynth.h"
 #include "RtMidi.h"
 #include <TFE_System/system.h>
 #include <algorithm>
@@ -17,18 +18,23 @@ namespace TFE_MidiDevice
 {
 	RtMidiOut *s_midiout = nullptr;
 	static s32 s_openPort = -1;
+	static bool s_synthAvailable = false;
+	static bool s_synthSelected = false;
+	static const char c_synthName[] = "TFE SoundFont Synth";
 
 	void midiErrorCallback(RtMidiError::Type type, const std::string &errorText, void *userData)
 	{
 		TFE_System::logWrite(LOG_ERROR, "Midi Device", "%s", errorText.c_str());
 	}
 
-	bool init()
+	bool init(const char* soundFontPath)
 	{
 		s_midiout = new RtMidiOut();
 		s_midiout->setErrorCallback(midiErrorCallback);
 		s_openPort = -1;
 
+		s_synthAvailable = soundFontPath && TFE_MidiSynth::loadSoundFont(soundFontPath);
+		s_synthSelected = false;
 		return true;
 	}
 
@@ -41,17 +47,48 @@ namespace TFE_MidiDevice
 		delete s_midiout;
 		s_midiout = nullptr;
 		s_openPort = -1;
+
+		if (s_synthAvailable)
+		{
+			TFE_MidiSynth::unloadSoundFont();
+		}
+		s_synthAvailable = false;
+		s_synthSelected = false;
 	}
 
 	// Returns the number of devices.
 	u32 getDeviceCount()
 	{
-		return s_midiout ? s_midiout->getPortCount() : 0;
+		const u32 portCount = s_midiout ? s_midiout->getPortCount() : 0;
+		return portCount + (s_synthAvailable ? 1 : 0);
+	}
+
+	s32 getSynthDevice()
+	{
+		return s_synthAvailable ? 0 : -1;
+	}
+
+	s32 getSelectedDevice()
+	{
+		if (s_synthSelected) { return 0; }
+		if (s_openPort < 0) { return -1; }
+		return s_openPort + (s_synthAvailable ? 1 : 0);
 	}
 
 	void getDeviceName(u32 index, char* buffer, u32 maxLength)
 	{
-		if (index > getDeviceCount()) { return; }
+		if (index >= getDeviceCount()) { return; }
+		if (s_synthAvailable)
+		{
+			if (index == 0)
+			{
+				strncpy(buffer, c_synthName, maxLength - 1);
+				buffer[maxLength - 1] = 0;
+				return;
+			}
+			index--;
+		}
+
 		const std::string& name = s_midiout->getPortName(index);
 		const u32 copyLength = std::min((u32)name.length(), maxLength - 1);
 		strncpy(buffer, s_midiout->getPortName(index).c_str(), copyLength);
@@ -61,18 +98,34 @@ namespace TFE_MidiDevice
 	void selectDevice(u32 index)
 	{
 		if (!s_midiout) { return; }
-		s_midiout->openPort(index);
-		s_openPort = (s32)index;
+		if (s_openPort >= 0)
+		{
+			s_midiout->closePort();
+			s_openPort = -1;
+		}
+
+		s_synthSelected = s_synthAvailable && index == 0;
+		if (s_synthSelected)
+		{
+			TFE_MidiSynth::start();
+			return;
+		}
+		TFE_MidiSynth::stop();
+
+		const u32 port = s_synthAvailable ? index - 1 : index;
+		s_midiout->openPort(port);
+		s_openPort = (s32)port;
 	}
 
 	void sendMessage(const u8* msg, u32 size)
 	{
-		if (s_midiout) { s_midiout->sendMessage(msg, (size_t)size); }
+		if (s_synthSelected) { TFE_MidiSynth::sendMessage(msg, size); }
+		else if (s_midiout) { s_midiout->sendMessage(msg, (size_t)size); }
 	}
 
 	void sendMessage(u8 arg0, u8 arg1, u8 arg2)
 	{
 		const u8 msg[3] = { arg0, arg1, arg2 };
-		if (s_midiout) { s_midiout->sendMessage(msg, 3); }
+		sendMessage(msg, 3);
 	}
-}
+}
\ No newline at end of file
@@ -3,12 +3,17 @@
 
 namespace TFE_MidiDevice
 {
-	bool init();
+	// If a SoundFont is given and loads, the built-in synthesizer is listed as device 0
+	// followed by the external midi devices.
+	bool init(const char* soundFontPath = nullptr);
 	void destroy();
 
 	u32  getDeviceCount();
 	void getDeviceName(u32 index, char* buffer, u32 maxLength);
 	void selectDevice(u32 index);
+	s32  getSelectedDevice();
+	// Returns the index of the built-in synthesizer or -1 if it is not available.
+	s32  getSynthDevice();
 
 	void sendMessage(const u8* msg, u32 size);
 	void sendMessage(u8 arg0, u8 arg1, u8 arg2 = 0);
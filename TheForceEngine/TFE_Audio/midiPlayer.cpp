@@ -1,9 +1,13 @@
 #include "midiPlayer.h"
 #include "midiDevice.h"
+#include "midiSynth.h"
 #include "audioDevice.h"
 #include <TFE_Asset/gmidAsset.h>
 #include <TFE_System/system.h>
 #include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/signal.h>
+#include <TFE_FileSystem/fileutil.h>
+#include <TFE_FileSystem/paths.h>
 #include <TFE_Settings/settings.h>
 #include <TFE_FrontEndUI/console.h>
 #include <algorithm>
@@ -12,6 +16,7 @@
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN 1
 #include <Windows.h>
+#include <mmsystem.h>
 #undef min
 #undef max
 #endif
@@ -49,6 +54,8 @@ namespace TFE_MidiPlayer
 	static f32 s_masterVolume = 1.0f;
 	static f32 s_masterVolumeScaled = s_masterVolume * c_musicVolumeScale;
 	static Thread* s_thread = nullptr;
+	// Wakes the midi thread when commands are queued, otherwise it sleeps until the next callback is due.
+	static Signal* s_wakeSignal = nullptr;
 
 	static atomic_bool s_runMusicThread;
 	static u8 s_channelSrcVolume[MIDI_CHANNEL_COUNT] = { 0 };
@@ -68,6 +75,7 @@ namespace TFE_MidiPlayer
 	TFE_THREADRET midiUpdateFunc(void* userData);
 	void stopAllNotes();
 	void changeVolume();
+	void selectDefaultDevice(bool useSynth);
 
 	// Console Functions
 	void setMusicVolumeConsole(const ConsoleArgList& args);
@@ -77,12 +85,27 @@ namespace TFE_MidiPlayer
 	{
 		TFE_System::logWrite(LOG_MSG, "Startup", "TFE_MidiPlayer::init");
 
-		bool res = TFE_MidiDevice::init();
-		TFE_MidiDevice::selectDevice(0);
+		// The SoundFont path is relative to the program directory unless it exists as given.
+		TFE_Settings_Sound* soundSettings = TFE_Settings::getSoundSettings();
+		char soundFontPath[TFE_MAX_PATH];
+		strcpy(soundFontPath, soundSettings->midiSoundFont);
+		if (!FileUtil::exists(soundFontPath))
+		{
+			TFE_Paths::appendPath(PATH_PROGRAM, soundSettings->midiSoundFont, soundFontPath);
+		}
+		TFE_MidiSynth::setPolyphony(u32(soundSettings->midiSynthPolyphony));
+
+		bool res = TFE_MidiDevice::init(soundFontPath);
+		selectDefaultDevice(soundSettings->useMidiSynth);
 		s_runMusicThread.store(true);
 
 		MUTEX_INITIALIZE(&s_mutex);
+	#ifdef _WIN32
+		// Sleep with 1ms precision instead of the default ~15ms scheduler tick.
+		timeBeginPeriod(1);
+	#endif
 
+		s_wakeSignal = Signal::create();
 		s_thread = Thread::create("MidiThread", midiUpdateFunc, nullptr);
 		if (s_thread)
 		{
@@ -92,7 +115,6 @@ namespace TFE_MidiPlayer
 		CCMD("setMusicVolume", setMusicVolumeConsole, 1, "Sets the music volume, range is 0.0 to 1.0");
 		CCMD("getMusicVolume", getMusicVolumeConsole, 0, "Get the current music volume where 0 = silent, 1 = maximum.");
 
-		TFE_Settings_Sound* soundSettings = TFE_Settings::getSoundSettings();
 		setVolume(soundSettings->musicVolume);
 		setMaximumNoteLength();
 
@@ -104,6 +126,7 @@ namespace TFE_MidiPlayer
 		TFE_System::logWrite(LOG_MSG, "MidiPlayer", "Shutdown");
 		// Destroy the thread before shutting down the Midi Device.
 		s_runMusicThread.store(false);
+		s_wakeSignal->fire();
 		if (s_thread->isPaused())
 		{
 			s_thread->resume();
@@ -111,9 +134,14 @@ namespace TFE_MidiPlayer
 		s_thread->waitOnExit();
 
 		delete s_thread;
+		delete s_wakeSignal;
+		s_wakeSignal = nullptr;
 		TFE_MidiDevice::destroy();
 
 		MUTEX_DESTROY(&s_mutex);
+	#ifdef _WIN32
+		timeEndPeriod(1);
+	#endif
 	}
 
 	//////////////////////////////////////////////////
@@ -145,6 +173,7 @@ namespace TFE_MidiPlayer
 			midiCmd->newVolume = volume;
 		}
 		MUTEX_UNLOCK(&s_mutex);
+		s_wakeSignal->fire();
 	}
 	
 	// Set the length in seconds that a note is allowed to play for in seconds.
@@ -162,6 +191,7 @@ namespace TFE_MidiPlayer
 			midiCmd->cmd = MIDI_PAUSE;
 		}
 		MUTEX_UNLOCK(&s_mutex);
+		s_wakeSignal->fire();
 	}
 
 	void resume()
@@ -173,6 +203,7 @@ namespace TFE_MidiPlayer
 			midiCmd->cmd = MIDI_RESUME;
 		}
 		MUTEX_UNLOCK(&s_mutex);
+		s_wakeSignal->fire();
 	}
 
 	void stopMidiSound()
@@ -184,6 +215,7 @@ namespace TFE_MidiPlayer
 			midiCmd->cmd = MIDI_STOP_NOTES;
 		}
 		MUTEX_UNLOCK(&s_mutex);
+		s_wakeSignal->fire();
 	}
 
 	f32 getVolume()
@@ -204,6 +236,7 @@ namespace TFE_MidiPlayer
 		}
 		changeVolume();
 		MUTEX_UNLOCK(&s_mutex);
+		s_wakeSignal->fire();
 	}
 
 	void midiClearCallback()
@@ -213,11 +246,35 @@ namespace TFE_MidiPlayer
 		s_midiCallback.timeStep = 0.0;
 		s_midiCallback.accumulator = 0.0;
 		MUTEX_UNLOCK(&s_mutex);
+		s_wakeSignal->fire();
+	}
+
+	void useSoundFontSynth(bool enable)
+	{
+		MUTEX_LOCK(&s_mutex);
+		stopAllNotes();
+		selectDefaultDevice(enable);
+		changeVolume();
+		MUTEX_UNLOCK(&s_mutex);
 	}
 
 	//////////////////////////////////////////////////
 	// Internal
 	//////////////////////////////////////////////////
+	// Use the built-in synthesizer if requested or if there are no other devices.
+	void selectDefaultDevice(bool useSynth)
+	{
+		const s32 synthDevice = TFE_MidiDevice::getSynthDevice();
+		if (synthDevice >= 0 && (useSynth || TFE_MidiDevice::getDeviceCount() == 1))
+		{
+			TFE_MidiDevice::selectDevice(u32(synthDevice));
+		}
+		else
+		{
+			TFE_MidiDevice::selectDevice(synthDevice >= 0 ? 1 : 0);
+		}
+	}
+
 	void changeVolume()
 	{
 		for (u32 i = 0; i < MIDI_CHANNEL_COUNT; i++)
@@ -314,18 +371,17 @@ namespace TFE_MidiPlayer
 	}
 
 	// Thread Function
+	// The thread sleeps until the next midi callback is due or a command is queued, rather than polling.
+	// Callbacks are still run from the accumulated time, so waking up late only delays a callback
+	// and never changes the tempo.
 	TFE_THREADRET midiUpdateFunc(void* userData)
 	{
 		bool runThread  = true;
-		bool wasPlaying = false;
-		bool isPlaying  = false;
 		bool isPaused = false;
-		s32 loopStart = -1;
-		u64 localTime = 0;
 		u64 localTimeCallback = 0;
-		f64 dt = 0.0;
 		while (runThread)
 		{
+			u32 waitTimeMS = TIMEOUT_INFINITE;
 			MUTEX_LOCK(&s_mutex);
 						
 			// Read from the command buffer.
@@ -374,10 +430,26 @@ namespace TFE_MidiPlayer
 
 				// Check for hanging notes.
 				detectHangingNotes();
+
+				// Sleep until the next callback is due, rounding up so it is never early.
+				if (s_midiCallback.callback)
+				{
+					const f64 timeToNext = s_midiCallback.timeStep - s_midiCallback.accumulator;
+					waitTimeMS = std::max(1u, u32(timeToNext * 1000.0 + 0.999));
+				}
+			}
+			else
+			{
+				// Don't accumulate time while there is nothing to update.
+				localTimeCallback = 0;
 			}
 
 			MUTEX_UNLOCK(&s_mutex);
 			runThread = s_runMusicThread.load();
+			if (runThread)
+			{
+				s_wakeSignal->wait(waitTimeMS);
+			}
 		};
 		
 		return (TFE_THREADRET)0;
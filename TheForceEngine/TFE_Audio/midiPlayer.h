@@ -24,6 +24,9 @@ namespace TFE_MidiPlayer
 	// Callback
 	void midiSetCallback(void(*callback)(void) = nullptr, f64 timeStep = 0.0);
 	void midiClearCallback();
+
+	// Switch between the built-in SoundFont synthesizer and the first external midi device.
+	void useSoundFontSynth(bool enable);
 		
 	// Pause the midi player, which also stops all sound channels.
 	void pause();
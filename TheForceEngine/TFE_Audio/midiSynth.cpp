@@ -0,0 +1,1116 @@
+#include "midiSynth.h"
+#include "midi.h"
+#include "audioSystem.h"
+#include "audioMixer.h"
+#include <TFE_System/system.h>
+#include <TFE_System/profiler.h>
+#include <TFE_FileSystem/filestream.h>
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+namespace TFE_MidiSynth
+{
+	enum
+	{
+		SYNTH_QUEUE_SIZE = 4096,		// Must be a power of two.
+		// Stolen voices fade out over one block, so there are extra voices beyond the polyphony limit.
+		SYNTH_VOICE_COUNT = SYNTH_MAX_POLYPHONY + 32,
+		SYNTH_BLOCK_SIZE = 64,			// Frames between envelope, volume and pitch updates.
+		SYNTH_CHANNEL_COUNT = 16,
+		SYNTH_DRUM_CHANNEL = 9,
+		SYNTH_DRUM_BANK = 128,
+		SYNTH_SAMPLE_PADDING = 8,		// Zero samples after each sample, interpolation reads one sample ahead.
+		SYNTH_WAVE_LENGTH = 256,		// Length of the generated single cycle waveforms.
+		SYNTH_NOISE_LENGTH = 8192,
+	};
+
+	// SoundFont 2 generators, only the ones used by the synthesizer are listed.
+	enum SF2Generator
+	{
+		GEN_START_OFFSET = 0,
+		GEN_END_OFFSET = 1,
+		GEN_LOOP_START_OFFSET = 2,
+		GEN_LOOP_END_OFFSET = 3,
+		GEN_START_COARSE = 4,
+		GEN_END_COARSE = 12,
+		GEN_PAN = 17,
+		GEN_DELAY_VOL_ENV = 33,
+		GEN_ATTACK_VOL_ENV = 34,
+		GEN_HOLD_VOL_ENV = 35,
+		GEN_DECAY_VOL_ENV = 36,
+		GEN_SUSTAIN_VOL_ENV = 37,
+		GEN_RELEASE_VOL_ENV = 38,
+		GEN_INSTRUMENT = 41,
+		GEN_KEY_RANGE = 43,
+		GEN_VEL_RANGE = 44,
+		GEN_LOOP_START_COARSE = 45,
+		GEN_INITIAL_ATTENUATION = 48,
+		GEN_LOOP_END_COARSE = 50,
+		GEN_COARSE_TUNE = 51,
+		GEN_FINE_TUNE = 52,
+		GEN_SAMPLE_ID = 53,
+		GEN_SAMPLE_MODES = 54,
+		GEN_SCALE_TUNING = 56,
+		GEN_EXCLUSIVE_CLASS = 57,
+		GEN_ROOT_KEY = 58,
+		GEN_COUNT = 61
+	};
+
+	// Preset level generators add to the instrument values, the rest can only be set by instruments.
+	static const SF2Generator c_additiveGenerators[] =
+	{
+		GEN_PAN, GEN_DELAY_VOL_ENV, GEN_ATTACK_VOL_ENV, GEN_HOLD_VOL_ENV, GEN_DECAY_VOL_ENV, GEN_SUSTAIN_VOL_ENV,
+		GEN_RELEASE_VOL_ENV, GEN_INITIAL_ATTENUATION, GEN_COARSE_TUNE, GEN_FINE_TUNE, GEN_SCALE_TUNING,
+	};
+
+	enum SF2SampleType
+	{
+		SF2_SAMPLE_ROM = 0x8000,
+	};
+
+	enum SF2LoopMode
+	{
+		LOOP_NONE = 0,
+		LOOP_CONTINUOUS = 1,
+		LOOP_UNTIL_RELEASE = 3,
+	};
+
+	enum SynthWave
+	{
+		WAVE_SOFT = 0,
+		WAVE_SAW,
+		WAVE_SQUARE,
+		WAVE_NOISE,
+		WAVE_COUNT
+	};
+
+	// Waveform used for each General MIDI instrument family (8 programs each) when the bank has no sample data.
+	static const SynthWave c_familyWave[16] =
+	{
+		WAVE_SOFT,   WAVE_SOFT,  WAVE_SQUARE, WAVE_SAW,		// Piano, Chromatic Percussion, Organ, Guitar
+		WAVE_SOFT,   WAVE_SAW,   WAVE_SAW,    WAVE_SAW,		// Bass, Strings, Ensemble, Brass
+		WAVE_SQUARE, WAVE_SOFT,  WAVE_SQUARE, WAVE_SAW,		// Reed, Pipe, Synth Lead, Synth Pad
+		WAVE_SAW,    WAVE_SAW,   WAVE_SOFT,   WAVE_NOISE,	// Synth Effects, Ethnic, Percussive, Sound Effects
+	};
+
+	enum EnvStage
+	{
+		ENV_DELAY = 0,
+		ENV_ATTACK,
+		ENV_HOLD,
+		ENV_DECAY,
+		ENV_SUSTAIN,
+		ENV_RELEASE,
+		ENV_FADE,		// Stolen or cut off, fades out over one block.
+		ENV_OFF,
+	};
+
+	// A preset zone combined with an instrument zone, with all of the generators resolved.
+	struct SynthZone
+	{
+		u8 keyLo, keyHi;
+		u8 velLo, velHi;
+		u32 start, end;
+		u32 loopStart, loopEnd;
+		u32 loopMode;
+		f32 sampleRate;
+		s32 rootKey;
+		s32 tune;			// Cents.
+		s32 scaleTuning;	// Cents per key.
+		s32 exclusiveClass;
+		f32 gain;			// Linear gain from the initial attenuation.
+		f32 pan;			// -0.5 (left) to 0.5 (right).
+		// Volume envelope, times are in seconds and the sustain level in centibels of attenuation.
+		f32 delay, attack, hold, decay, sustain, release;
+	};
+
+	struct SynthPreset
+	{
+		u16 bank;
+		u16 program;
+		u32 firstZone;
+		u32 zoneCount;
+	};
+
+	struct SynthChannel
+	{
+		s32 preset;			// Index into s_presets or -1.
+		u8 bank;
+		u8 program;
+		u8 volume;
+		u8 expression;
+		u8 pan;
+		u8 bendRange;		// Semitones.
+		u8 rpnMsb, rpnLsb;
+		bool sustain;
+		s32 pitchBend;		// -8192 to 8191.
+	};
+
+	struct SynthVoice
+	{
+		const SynthZone* zone;
+		EnvStage stage;
+		u8 channel;
+		u8 key;
+		bool sustained;		// Note off received while the sustain pedal was held.
+		bool looping;
+		u32 age;
+		f32 stageTime;
+		f32 level;			// Envelope amplitude.
+		f32 atten;			// Envelope attenuation in centibels during decay and release.
+		f32 velocityGain;
+		f32 gainL, gainR;	// Gains at the end of the previous block.
+		u64 pos;			// Sample position, 32.32 fixed point.
+		u64 step;			// Sample step, 32.32 fixed point.
+		s32 bend;			// Pitch bend times the bend range used to compute 'step'.
+		u8 pan;				// Channel pan used to compute 'panL' and 'panR'.
+		f32 panL, panR;
+	};
+
+	struct SynthMessage
+	{
+		u64 time;
+		u8 data[3];
+	};
+
+	static std::vector<s16> s_sampleData;
+	static std::vector<SynthZone> s_zones;
+	static std::vector<SynthPreset> s_presets;
+	static s32 s_defaultPreset[2][128];		// Bank 0 and the drum bank.
+
+	static SynthChannel s_channels[SYNTH_CHANNEL_COUNT];
+	static SynthVoice s_voices[SYNTH_VOICE_COUNT];
+	static u32 s_voiceAge = 0;
+	static f32 s_sampleRate = 11025.0f;
+	static u64 s_prevRenderTime = 0;
+
+	// Messages, single producer (the midi thread) and single consumer (the audio thread).
+	static SynthMessage s_queue[SYNTH_QUEUE_SIZE];
+	static atomic_u32 s_queueWrite;
+	static atomic_u32 s_queueRead;
+	static atomic_u32 s_polyphony(SYNTH_DEFAULT_POLYPHONY);
+	static atomic_bool s_active(false);
+	static atomic_bool s_rendering(false);
+	static atomic_bool s_resetPending(false);
+
+	void render(f32* buffer, u32 frameCount, f32 systemVolume);
+	void resetState();
+
+	/////////////////////////////////////////////
+	// SoundFont loading
+	/////////////////////////////////////////////
+	struct GenList
+	{
+		s32 value[GEN_COUNT];
+		bool set[GEN_COUNT];
+	};
+
+	struct SF2Chunks
+	{
+		const u8* smpl = nullptr; u32 smplSize = 0;
+		const u8* phdr = nullptr; u32 phdrSize = 0;
+		const u8* pbag = nullptr; u32 pbagSize = 0;
+		const u8* pgen = nullptr; u32 pgenSize = 0;
+		const u8* inst = nullptr; u32 instSize = 0;
+		const u8* ibag = nullptr; u32 ibagSize = 0;
+		const u8* igen = nullptr; u32 igenSize = 0;
+		const u8* shdr = nullptr; u32 shdrSize = 0;
+	};
+
+	u16 readU16(const u8* data) { return u16(data[0] | (data[1] << 8)); }
+	u32 readU32(const u8* data) { return u32(readU16(data)) | (u32(readU16(data + 2)) << 16u); }
+	bool chunkIs(const u8* data, const char* id) { return memcmp(data, id, 4) == 0; }
+
+	void readChunkList(const u8* data, u32 size, SF2Chunks* chunks)
+	{
+		u32 offset = 0;
+		while (offset + 8 <= size)
+		{
+			const u8* chunk = data + offset;
+			const u32 chunkSize = std::min(readU32(chunk + 4), size - offset - 8);
+			const u8* chunkData = chunk + 8;
+			if (chunkIs(chunk, "LIST") && chunkSize >= 4) { readChunkList(chunkData + 4, chunkSize - 4, chunks); }
+			else if (chunkIs(chunk, "smpl")) { chunks->smpl = chunkData; chunks->smplSize = chunkSize; }
+			else if (chunkIs(chunk, "phdr")) { chunks->phdr = chunkData; chunks->phdrSize = chunkSize; }
+			else if (chunkIs(chunk, "pbag")) { chunks->pbag = chunkData; chunks->pbagSize = chunkSize; }
+			else if (chunkIs(chunk, "pgen")) { chunks->pgen = chunkData; chunks->pgenSize = chunkSize; }
+			else if (chunkIs(chunk, "inst")) { chunks->inst = chunkData; chunks->instSize = chunkSize; }
+			else if (chunkIs(chunk, "ibag")) { chunks->ibag = chunkData; chunks->ibagSize = chunkSize; }
+			else if (chunkIs(chunk, "igen")) { chunks->igen = chunkData; chunks->igenSize = chunkSize; }
+			else if (chunkIs(chunk, "shdr")) { chunks->shdr = chunkData; chunks->shdrSize = chunkSize; }
+			offset += 8 + chunkSize + (chunkSize & 1);
+		}
+	}
+
+	void setDefaultGenerators(GenList* gens)
+	{
+		memset(gens, 0, sizeof(GenList));
+		gens->value[GEN_KEY_RANGE] = 127 << 8;
+		gens->value[GEN_VEL_RANGE] = 127 << 8;
+		gens->value[GEN_DELAY_VOL_ENV]   = -12000;
+		gens->value[GEN_ATTACK_VOL_ENV]  = -12000;
+		gens->value[GEN_HOLD_VOL_ENV]    = -12000;
+		gens->value[GEN_DECAY_VOL_ENV]   = -12000;
+		gens->value[GEN_RELEASE_VOL_ENV] = -12000;
+		gens->value[GEN_SCALE_TUNING] = 100;
+		gens->value[GEN_ROOT_KEY] = -1;
+	}
+
+	// Read the generators of bag 'bagIndex', returns false if the bag is out of range.
+	bool readBagGenerators(const u8* bags, u32 bagCount, const u8* gens, u32 genCount, u32 bagIndex, GenList* list)
+	{
+		memset(list->set, 0, sizeof(list->set));
+		if (bagIndex + 1 >= bagCount) { return false; }
+		const u32 first = readU16(bags + bagIndex * 4);
+		const u32 last = std::min(u32(readU16(bags + (bagIndex + 1) * 4)), genCount);
+		for (u32 g = first; g < last; g++)
+		{
+			const u16 oper = readU16(gens + g * 4);
+			if (oper >= GEN_COUNT) { continue; }
+			const u16 amount = readU16(gens + g * 4 + 2);
+			// Ranges are two bytes, everything else is signed.
+			list->value[oper] = (oper == GEN_KEY_RANGE || oper == GEN_VEL_RANGE) ? s32(amount) : s32(s16(amount));
+			list->set[oper] = true;
+		}
+		return true;
+	}
+
+	void applyGenerators(GenList* dst, const GenList* src)
+	{
+		for (u32 g = 0; g < GEN_COUNT; g++)
+		{
+			if (src->set[g])
+			{
+				dst->value[g] = src->value[g];
+				dst->set[g] = true;
+			}
+		}
+	}
+
+	f32 timecentsToSeconds(s32 timecents)
+	{
+		return powf(2.0f, f32(timecents) / 1200.0f);
+	}
+
+	// Intersect two ranges packed as (lo | hi << 8), returns false if they do not overlap.
+	bool intersectRange(s32 a, s32 b, u8* lo, u8* hi)
+	{
+		*lo = u8(std::max(a & 0xff, b & 0xff));
+		*hi = u8(std::min((a >> 8) & 0xff, (b >> 8) & 0xff));
+		return *lo <= *hi;
+	}
+
+	// Generated waveforms, used in place of ROM samples. Returns the offset of each wave in 'data'.
+	void generateWaves(std::vector<s16>& data, u32* waveOffset)
+	{
+		const f32 pi = 3.14159265f;
+		for (s32 w = 0; w < WAVE_COUNT; w++)
+		{
+			const u32 length = (w == WAVE_NOISE) ? SYNTH_NOISE_LENGTH : SYNTH_WAVE_LENGTH;
+			waveOffset[w] = u32(data.size());
+			data.resize(data.size() + length + SYNTH_SAMPLE_PADDING, 0);
+
+			u32 seed = 0x2545f491u;
+			s16* wave = &data[waveOffset[w]];
+			for (u32 i = 0; i < length; i++)
+			{
+				const f32 phase = 2.0f * pi * f32(i) / f32(length);
+				f32 value = 0.0f;
+				switch (w)
+				{
+					case WAVE_SOFT:
+					{
+						value = sinf(phase) + 0.25f * sinf(2.0f * phase) + 0.1f * sinf(3.0f * phase);
+					} break;
+					case WAVE_SAW:
+					{
+						// Band limited so the higher notes do not alias.
+						for (s32 h = 1; h <= 16; h++) { value += sinf(f32(h) * phase) / f32(h); }
+					} break;
+					case WAVE_SQUARE:
+					{
+						for (s32 h = 1; h <= 15; h += 2) { value += sinf(f32(h) * phase) / f32(h); }
+					} break;
+					case WAVE_NOISE:
+					{
+						seed = seed * 1664525u + 1013904223u;
+						value = f32(s32(seed >> 16) - 32768) / 32768.0f;
+					} break;
+				}
+				wave[i] = s16(std::max(-1.0f, std::min(value * 0.5f, 1.0f)) * 32767.0f);
+			}
+			// The looped waves wrap, so interpolating past the end reads the start.
+			wave[length] = wave[0];
+		}
+	}
+
+	// Resolve a preset zone and an instrument zone into a synth zone.
+	bool resolveZone(const SF2Chunks& sf2, u32 sampleCount, const GenList& presetGens, const GenList& instGens, u16 bank, u16 program, const u32* waveOffset, SynthZone* zone)
+	{
+		// Preset values are offsets added to the instrument values.
+		GenList gens = instGens;
+		for (u32 i = 0; i < TFE_ARRAYSIZE(c_additiveGenerators); i++)
+		{
+			const SF2Generator g = c_additiveGenerators[i];
+			if (presetGens.set[g]) { gens.value[g] += presetGens.value[g]; }
+		}
+		if (!intersectRange(gens.value[GEN_KEY_RANGE], presetGens.value[GEN_KEY_RANGE], &zone->keyLo, &zone->keyHi)) { return false; }
+		if (!intersectRange(gens.value[GEN_VEL_RANGE], presetGens.value[GEN_VEL_RANGE], &zone->velLo, &zone->velHi)) { return false; }
+
+		const u32 sampleId = u32(gens.value[GEN_SAMPLE_ID]);
+		if ((sampleId + 1) * 46 > sf2.shdrSize) { return false; }
+		const u8* shdr = sf2.shdr + sampleId * 46;
+		const u32 sampleRate = readU32(shdr + 36);
+		const s32 originalPitch = shdr[40];
+		const s32 pitchCorrection = s8(shdr[41]);
+		const u16 sampleType = readU16(shdr + 44);
+
+		zone->rootKey = gens.value[GEN_ROOT_KEY] >= 0 ? gens.value[GEN_ROOT_KEY] : originalPitch;
+		zone->tune = gens.value[GEN_COARSE_TUNE] * 100 + gens.value[GEN_FINE_TUNE] + pitchCorrection;
+		zone->scaleTuning = gens.value[GEN_SCALE_TUNING];
+		zone->exclusiveClass = gens.value[GEN_EXCLUSIVE_CLASS];
+		// EMU hardware applies 40% of the specified attenuation, which is what SoundFonts are authored for.
+		zone->gain = powf(10.0f, -0.4f * f32(std::max(0, gens.value[GEN_INITIAL_ATTENUATION])) / 200.0f);
+		zone->pan = std::max(-500, std::min(gens.value[GEN_PAN], 500)) / 1000.0f;
+		zone->delay   = timecentsToSeconds(gens.value[GEN_DELAY_VOL_ENV]);
+		zone->attack  = timecentsToSeconds(gens.value[GEN_ATTACK_VOL_ENV]);
+		zone->hold    = timecentsToSeconds(gens.value[GEN_HOLD_VOL_ENV]);
+		zone->decay   = timecentsToSeconds(gens.value[GEN_DECAY_VOL_ENV]);
+		zone->sustain = f32(std::max(0, std::min(gens.value[GEN_SUSTAIN_VOL_ENV], 1000)));
+		// Very short releases click.
+		zone->release = std::max(0.01f, timecentsToSeconds(gens.value[GEN_RELEASE_VOL_ENV]));
+		zone->loopMode = u32(gens.value[GEN_SAMPLE_MODES]) & 3;
+		if (zone->loopMode == 2) { zone->loopMode = LOOP_NONE; }
+
+		const s64 start     = s64(readU32(shdr + 20)) + gens.value[GEN_START_OFFSET] + 32768 * s64(gens.value[GEN_START_COARSE]);
+		const s64 end       = s64(readU32(shdr + 24)) + gens.value[GEN_END_OFFSET] + 32768 * s64(gens.value[GEN_END_COARSE]);
+		const s64 loopStart = s64(readU32(shdr + 28)) + gens.value[GEN_LOOP_START_OFFSET] + 32768 * s64(gens.value[GEN_LOOP_START_COARSE]);
+		const s64 loopEnd   = s64(readU32(shdr + 32)) + gens.value[GEN_LOOP_END_OFFSET] + 32768 * s64(gens.value[GEN_LOOP_END_COARSE]);
+
+		if ((sampleType & SF2_SAMPLE_ROM) || !sampleCount)
+		{
+			// The sample data is not available, substitute a generated waveform.
+			const bool drums = bank == SYNTH_DRUM_BANK;
+			const SynthWave wave = drums ? WAVE_NOISE : c_familyWave[(program >> 3) & 15];
+			const u32 length = wave == WAVE_NOISE ? SYNTH_NOISE_LENGTH : SYNTH_WAVE_LENGTH;
+			if (zone->loopMode == LOOP_NONE)
+			{
+				// One shot samples fade out over the length of the original sample instead.
+				const f32 duration = sampleRate ? f32(std::max(s64(0), end - start)) / f32(sampleRate) : 0.5f;
+				zone->decay = std::max(0.05f, std::min(duration, 4.0f));
+				zone->sustain = 1000.0f;
+			}
+			zone->start = waveOffset[wave];
+			zone->end = zone->start + length;
+			zone->loopStart = zone->start;
+			zone->loopEnd = zone->end;
+			zone->loopMode = LOOP_CONTINUOUS;
+			if (wave == WAVE_NOISE)
+			{
+				zone->sampleRate = 22050.0f;
+				zone->scaleTuning = drums ? 0 : zone->scaleTuning;
+			}
+			else
+			{
+				// Play the root key at its own pitch.
+				zone->sampleRate = f32(SYNTH_WAVE_LENGTH) * 440.0f * powf(2.0f, f32(zone->rootKey - 69) / 12.0f);
+			}
+			return true;
+		}
+
+		zone->start = u32(std::max(s64(0), std::min(start, s64(sampleCount))));
+		zone->end = u32(std::max(s64(zone->start), std::min(end, s64(sampleCount))));
+		zone->loopStart = u32(std::max(s64(zone->start), std::min(loopStart, s64(zone->end))));
+		zone->loopEnd = u32(std::max(s64(zone->loopStart), std::min(loopEnd, s64(zone->end))));
+		zone->sampleRate = f32(sampleRate ? sampleRate : 44100);
+		if (zone->loopEnd - zone->loopStart < 2) { zone->loopMode = LOOP_NONE; }
+		return zone->end > zone->start;
+	}
+
+	bool loadSoundFont(const char* path)
+	{
+		unloadSoundFont();
+
+		FileStream file;
+		if (!file.open(path, Stream::MODE_READ))
+		{
+			TFE_System::logWrite(LOG_WARNING, "MidiSynth", "Cannot open SoundFont '%s'.", path);
+			return false;
+		}
+		std::vector<u8> data(file.getSize());
+		file.readBuffer(data.data(), u32(data.size()));
+		file.close();
+
+		if (data.size() < 12 || !chunkIs(data.data(), "RIFF") || !chunkIs(data.data() + 8, "sfbk"))
+		{
+			TFE_System::logWrite(LOG_ERROR, "MidiSynth", "'%s' is not a SoundFont 2 file.", path);
+			return false;
+		}
+		SF2Chunks sf2;
+		readChunkList(data.data() + 12, u32(data.size()) - 12, &sf2);
+		if (!sf2.phdr || !sf2.pbag || !sf2.pgen || !sf2.inst || !sf2.ibag || !sf2.igen || !sf2.shdr)
+		{
+			TFE_System::logWrite(LOG_ERROR, "MidiSynth", "SoundFont '%s' is missing preset data.", path);
+			return false;
+		}
+
+		// Sample data, padded so interpolation can read past the end.
+		const u32 sampleCount = sf2.smplSize / 2;
+		s_sampleData.resize(sampleCount + SYNTH_SAMPLE_PADDING, 0);
+		if (sampleCount) { memcpy(s_sampleData.data(), sf2.smpl, sampleCount * 2); }
+		u32 waveOffset[WAVE_COUNT];
+		generateWaves(s_sampleData, waveOffset);
+
+		const u32 presetCount = sf2.phdrSize / 38;
+		const u32 pbagCount = sf2.pbagSize / 4, pgenCount = sf2.pgenSize / 4;
+		const u32 instCount = sf2.instSize / 22;
+		const u32 ibagCount = sf2.ibagSize / 4, igenCount = sf2.igenSize / 4;
+		bool romSamples = false;
+
+		// The last preset and instrument are terminators.
+		for (u32 p = 0; p + 1 < presetCount; p++)
+		{
+			const u8* phdr = sf2.phdr + p * 38;
+			SynthPreset preset;
+			preset.program = readU16(phdr + 20);
+			preset.bank = readU16(phdr + 22);
+			preset.firstZone = u32(s_zones.size());
+
+			GenList presetGlobal, presetZone;
+			setDefaultGenerators(&presetGlobal);
+			const u32 firstBag = readU16(phdr + 24), lastBag = readU16(phdr + 38 + 24);
+			for (u32 b = firstBag; b < lastBag; b++)
+			{
+				GenList bagGens;
+				if (!readBagGenerators(sf2.pbag, pbagCount, sf2.pgen, pgenCount, b, &bagGens)) { break; }
+				if (!bagGens.set[GEN_INSTRUMENT])
+				{
+					// Only the first zone can be global.
+					if (b == firstBag) { applyGenerators(&presetGlobal, &bagGens); }
+					continue;
+				}
+				presetZone = presetGlobal;
+				applyGenerators(&presetZone, &bagGens);
+
+				const u32 instIndex = u32(presetZone.value[GEN_INSTRUMENT]);
+				if (instIndex + 1 >= instCount) { continue; }
+				const u8* inst = sf2.inst + instIndex * 22;
+				GenList instGlobal, instZone;
+				setDefaultGenerators(&instGlobal);
+				const u32 firstInstBag = readU16(inst + 20), lastInstBag = readU16(inst + 22 + 20);
+				for (u32 ib = firstInstBag; ib < lastInstBag; ib++)
+				{
+					GenList instBagGens;
+					if (!readBagGenerators(sf2.ibag, ibagCount, sf2.igen, igenCount, ib, &instBagGens)) { break; }
+					if (!instBagGens.set[GEN_SAMPLE_ID])
+					{
+						if (ib == firstInstBag) { applyGenerators(&instGlobal, &instBagGens); }
+						continue;
+					}
+					instZone = instGlobal;
+					applyGenerators(&instZone, &instBagGens);
+
+					SynthZone zone;
+					if (resolveZone(sf2, sampleCount, presetZone, instZone, preset.bank, preset.program, waveOffset, &zone))
+					{
+						const u32 sampleId = u32(instZone.value[GEN_SAMPLE_ID]);
+						romSamples |= !sampleCount || (sampleId * 46 + 46 <= sf2.shdrSize && (readU16(sf2.shdr + sampleId * 46 + 44) & SF2_SAMPLE_ROM));
+						s_zones.push_back(zone);
+					}
+				}
+			}
+			preset.zoneCount = u32(s_zones.size()) - preset.firstZone;
+			s_presets.push_back(preset);
+		}
+
+		// Default presets for the General MIDI banks.
+		for (s32 p = 0; p < 128; p++)
+		{
+			s_defaultPreset[0][p] = -1;
+			s_defaultPreset[1][p] = -1;
+		}
+		for (size_t i = 0; i < s_presets.size(); i++)
+		{
+			const SynthPreset& preset = s_presets[i];
+			if (preset.program >= 128) { continue; }
+			if (preset.bank == 0) { s_defaultPreset[0][preset.program] = s32(i); }
+			else if (preset.bank == SYNTH_DRUM_BANK) { s_defaultPreset[1][preset.program] = s32(i); }
+		}
+
+		if (s_zones.empty())
+		{
+			TFE_System::logWrite(LOG_ERROR, "MidiSynth", "SoundFont '%s' has no playable presets.", path);
+			unloadSoundFont();
+			return false;
+		}
+		if (romSamples)
+		{
+			TFE_System::logWrite(LOG_WARNING, "MidiSynth", "SoundFont '%s' uses ROM samples, generated waveforms are used in their place.", path);
+		}
+		TFE_System::logWrite(LOG_MSG, "MidiSynth", "Loaded SoundFont '%s': %u presets, %u zones.", path, u32(s_presets.size()), u32(s_zones.size()));
+		return true;
+	}
+
+	void unloadSoundFont()
+	{
+		stop();
+		s_sampleData.clear();
+		s_sampleData.shrink_to_fit();
+		s_zones.clear();
+		s_presets.clear();
+	}
+
+	bool isLoaded()
+	{
+		return !s_zones.empty();
+	}
+
+	/////////////////////////////////////////////
+	// Control
+	/////////////////////////////////////////////
+	void start()
+	{
+		if (!isLoaded() || s_active.load()) { return; }
+		s_sampleRate = f32(TFE_Audio::getSampleRate());
+		s_queueRead.store(s_queueWrite.load());
+		s_resetPending.store(true);
+		s_prevRenderTime = 0;
+		s_active.store(true);
+		TFE_Audio::setMidiSynthCallback(render);
+	}
+
+	void stop()
+	{
+		if (!s_active.load()) { return; }
+		TFE_Audio::setMidiSynthCallback();
+		// The audio thread may have already started rendering.
+		s_active.store(false);
+		while (s_rendering.load())
+		{
+			TFE_System::sleep(0);
+		}
+	}
+
+	void setPolyphony(u32 voiceCount)
+	{
+		s_polyphony.store(std::max(1u, std::min(voiceCount, u32(SYNTH_MAX_POLYPHONY))));
+	}
+
+	u32 getPolyphony()
+	{
+		return s_polyphony.load();
+	}
+
+	void sendMessage(const u8* msg, u32 size)
+	{
+		// System exclusive messages are ignored.
+		if (!size || size > 3 || !s_active.load()) { return; }
+
+		const u32 write = s_queueWrite.load();
+		if (write - s_queueRead.load() >= SYNTH_QUEUE_SIZE)
+		{
+			// The audio thread has stopped consuming messages, for example while the audio is paused.
+			return;
+		}
+		SynthMessage* message = &s_queue[write & (SYNTH_QUEUE_SIZE - 1)];
+		message->time = TFE_System::getCurrentTimeInTicks();
+		message->data[0] = msg[0];
+		message->data[1] = size > 1 ? msg[1] : 0;
+		message->data[2] = size > 2 ? msg[2] : 0;
+		s_queueWrite.store(write + 1);
+	}
+
+	/////////////////////////////////////////////
+	// Voices
+	/////////////////////////////////////////////
+	void resetChannel(SynthChannel* channel, s32 index)
+	{
+		channel->bank = index == SYNTH_DRUM_CHANNEL ? SYNTH_DRUM_BANK : 0;
+		channel->program = 0;
+		channel->volume = 100;
+		channel->expression = 127;
+		channel->pan = 64;
+		channel->bendRange = 2;
+		channel->rpnMsb = 127;
+		channel->rpnLsb = 127;
+		channel->sustain = false;
+		channel->pitchBend = 0;
+		channel->preset = -1;
+	}
+
+	s32 findPreset(u32 bank, u32 program)
+	{
+		const s32 bankIndex = bank == SYNTH_DRUM_BANK ? 1 : 0;
+		if (bank == 0 || bank == SYNTH_DRUM_BANK)
+		{
+			if (s_defaultPreset[bankIndex][program] >= 0) { return s_defaultPreset[bankIndex][program]; }
+		}
+		else
+		{
+			for (size_t i = 0; i < s_presets.size(); i++)
+			{
+				if (s_presets[i].bank == bank && s_presets[i].program == program) { return s32(i); }
+			}
+		}
+		// Fall back to the General MIDI instrument, then to the first instrument in the bank.
+		if (s_defaultPreset[bankIndex][program] >= 0) { return s_defaultPreset[bankIndex][program]; }
+		return s_defaultPreset[bankIndex][0];
+	}
+
+	void resetState()
+	{
+		for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+		{
+			s_voices[i].stage = ENV_OFF;
+		}
+		for (s32 i = 0; i < SYNTH_CHANNEL_COUNT; i++)
+		{
+			resetChannel(&s_channels[i], i);
+			s_channels[i].preset = findPreset(s_channels[i].bank, 0);
+		}
+	}
+
+	void releaseVoice(SynthVoice* voice)
+	{
+		if (voice->stage >= ENV_RELEASE) { return; }
+		voice->atten = voice->level > 0.00001f ? -200.0f * log10f(voice->level) : 1000.0f;
+		voice->stage = ENV_RELEASE;
+		voice->stageTime = 0.0f;
+		voice->sustained = false;
+		if (voice->zone->loopMode == LOOP_UNTIL_RELEASE) { voice->looping = false; }
+	}
+
+	SynthVoice* allocateVoice()
+	{
+		SynthVoice* freeVoice = nullptr;
+		SynthVoice* released = nullptr;
+		SynthVoice* oldest = nullptr;
+		u32 activeCount = 0;
+		for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+		{
+			SynthVoice* voice = &s_voices[i];
+			if (voice->stage == ENV_OFF)
+			{
+				if (!freeVoice) { freeVoice = voice; }
+				continue;
+			}
+			if (voice->stage == ENV_FADE) { continue; }
+
+			activeCount++;
+			if (voice->stage == ENV_RELEASE && (!released || voice->level < released->level)) { released = voice; }
+			if (!oldest || voice->age < oldest->age) { oldest = voice; }
+		}
+		if (freeVoice && activeCount < s_polyphony.load())
+		{
+			return freeVoice;
+		}
+
+		// Steal the quietest released voice, or the oldest voice if none are being released.
+		SynthVoice* stolen = released ? released : oldest;
+		if (!stolen) { return freeVoice; }
+		if (!freeVoice)
+		{
+			// Every voice is in use, cut the stolen voice off immediately.
+			return stolen;
+		}
+		stolen->stage = ENV_FADE;
+		return freeVoice;
+	}
+
+	void noteOff(u8 channelIndex, u8 key)
+	{
+		const SynthChannel* channel = &s_channels[channelIndex];
+		for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+		{
+			SynthVoice* voice = &s_voices[i];
+			if (voice->stage >= ENV_RELEASE || voice->channel != channelIndex || voice->key != key) { continue; }
+			if (channel->sustain) { voice->sustained = true; }
+			else { releaseVoice(voice); }
+		}
+	}
+
+	// The pitch and pan only change with controller messages, so they are not computed for every block.
+	void updateVoicePitch(SynthVoice* voice, const SynthChannel* channel)
+	{
+		const SynthZone* zone = voice->zone;
+		voice->bend = channel->pitchBend * channel->bendRange;
+		const f32 cents = f32((s32(voice->key) - zone->rootKey) * zone->scaleTuning + zone->tune) + f32(voice->bend) * (100.0f / 8192.0f);
+		const f32 ratio = std::min(powf(2.0f, cents / 1200.0f) * zone->sampleRate / s_sampleRate, 64.0f);
+		voice->step = std::max(u64(1), u64(ratio * 4294967296.0f));
+	}
+
+	void updateVoicePan(SynthVoice* voice, const SynthChannel* channel)
+	{
+		voice->pan = channel->pan;
+		const f32 pan = std::max(-0.5f, std::min(voice->zone->pan + f32(channel->pan - 64) / 128.0f, 0.5f));
+		const f32 angle = (pan + 0.5f) * 1.57079633f;
+		voice->panL = cosf(angle);
+		voice->panR = sinf(angle);
+	}
+
+	void noteOn(u8 channelIndex, u8 key, u8 velocity)
+	{
+		if (velocity == 0)
+		{
+			noteOff(channelIndex, key);
+			return;
+		}
+		const SynthChannel* channel = &s_channels[channelIndex];
+		if (channel->preset < 0) { return; }
+
+		// Retrigger the note if it is still playing.
+		for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+		{
+			SynthVoice* voice = &s_voices[i];
+			if (voice->stage < ENV_RELEASE && voice->channel == channelIndex && voice->key == key) { releaseVoice(voice); }
+		}
+
+		const SynthPreset* preset = &s_presets[channel->preset];
+		const f32 velocityGain = f32(velocity * velocity) / f32(127 * 127);
+		for (u32 z = 0; z < preset->zoneCount; z++)
+		{
+			const SynthZone* zone = &s_zones[preset->firstZone + z];
+			if (key < zone->keyLo || key > zone->keyHi || velocity < zone->velLo || velocity > zone->velHi) { continue; }
+
+			// Notes in the same exclusive class cut each other off, such as open and closed hi-hats.
+			if (zone->exclusiveClass)
+			{
+				for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+				{
+					SynthVoice* voice = &s_voices[i];
+					if (voice->stage < ENV_FADE && voice->channel == channelIndex && voice->zone->exclusiveClass == zone->exclusiveClass)
+					{
+						voice->stage = ENV_FADE;
+					}
+				}
+			}
+
+			SynthVoice* voice = allocateVoice();
+			if (!voice) { break; }
+			voice->zone = zone;
+			voice->stage = ENV_DELAY;
+			voice->channel = channelIndex;
+			voice->key = key;
+			voice->sustained = false;
+			voice->looping = zone->loopMode != LOOP_NONE;
+			voice->age = s_voiceAge++;
+			voice->stageTime = 0.0f;
+			voice->level = 0.0f;
+			voice->atten = 0.0f;
+			voice->velocityGain = velocityGain;
+			voice->gainL = 0.0f;
+			voice->gainR = 0.0f;
+			voice->pos = u64(zone->start) << 32ull;
+			updateVoicePitch(voice, channel);
+			updateVoicePan(voice, channel);
+		}
+	}
+
+	void controlChange(u8 channelIndex, u8 controller, u8 value)
+	{
+		SynthChannel* channel = &s_channels[channelIndex];
+		switch (controller)
+		{
+			case MID_BANK_SELECT_MSB:
+			{
+				// The drum channel always uses the drum bank.
+				if (channelIndex != SYNTH_DRUM_CHANNEL) { channel->bank = value; }
+			} break;
+			case MID_VOLUME_MSB:
+			{
+				channel->volume = value;
+			} break;
+			case MID_PAN_MSB:
+			{
+				channel->pan = value;
+			} break;
+			case MID_EXPRESSION_MSB:
+			{
+				channel->expression = value;
+			} break;
+			case MID_SUSTAIN_SWITCH:
+			{
+				channel->sustain = value >= 64;
+				if (!channel->sustain)
+				{
+					for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+					{
+						SynthVoice* voice = &s_voices[i];
+						if (voice->sustained && voice->channel == channelIndex) { releaseVoice(voice); }
+					}
+				}
+			} break;
+			case MID_DATA_ENTRY_MSB:
+			{
+				// RPN 0: pitch bend range.
+				if (channel->rpnMsb == 0 && channel->rpnLsb == 0) { channel->bendRange = std::min(value, u8(24)); }
+			} break;
+			case MID_RPN_LSB:
+			{
+				channel->rpnLsb = value;
+			} break;
+			case MID_RPN_MSB:
+			{
+				channel->rpnMsb = value;
+			} break;
+			case MID_ALL_SOUND_OFF:
+			{
+				for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+				{
+					SynthVoice* voice = &s_voices[i];
+					if (voice->stage < ENV_FADE && voice->channel == channelIndex) { voice->stage = ENV_FADE; }
+				}
+			} break;
+			case MID_ALL_CTRL_OFF:
+			{
+				channel->expression = 127;
+				channel->pitchBend = 0;
+				channel->rpnMsb = 127;
+				channel->rpnLsb = 127;
+				controlChange(channelIndex, MID_SUSTAIN_SWITCH, 0);
+			} break;
+			case MID_ALL_NOTES_OFF:
+			{
+				for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+				{
+					SynthVoice* voice = &s_voices[i];
+					if (voice->channel == channelIndex) { releaseVoice(voice); }
+				}
+			} break;
+		}
+	}
+
+	void processMessage(const u8* msg)
+	{
+		const u8 type = msg[0] & 0xf0;
+		const u8 channelIndex = msg[0] & 0x0f;
+		switch (type)
+		{
+			case MID_NOTE_OFF:
+			{
+				noteOff(channelIndex, msg[1] & 0x7f);
+			} break;
+			case MID_NOTE_ON:
+			{
+				noteOn(channelIndex, msg[1] & 0x7f, msg[2] & 0x7f);
+			} break;
+			case MID_CONTROL_CHANGE:
+			{
+				controlChange(channelIndex, msg[1] & 0x7f, msg[2] & 0x7f);
+			} break;
+			case MID_PROGRAM_CHANGE:
+			{
+				SynthChannel* channel = &s_channels[channelIndex];
+				channel->program = msg[1] & 0x7f;
+				channel->preset = findPreset(channel->bank, channel->program);
+			} break;
+			case MID_PITCH_BEND:
+			{
+				s_channels[channelIndex].pitchBend = s32((msg[1] & 0x7f) | ((msg[2] & 0x7f) << 7)) - 8192;
+			} break;
+			default:
+			{
+				if (msg[0] == MID_RESET) { resetState(); }
+			}
+		}
+	}
+
+	/////////////////////////////////////////////
+	// Rendering
+	/////////////////////////////////////////////
+	// Advance the volume envelope by 'dt' seconds and return the amplitude at the end.
+	f32 updateEnvelope(SynthVoice* voice, f32 dt)
+	{
+		const SynthZone* zone = voice->zone;
+		while (dt > 0.0f && voice->stage < ENV_FADE)
+		{
+			switch (voice->stage)
+			{
+				case ENV_DELAY:
+				case ENV_HOLD:
+				{
+					const f32 length = voice->stage == ENV_DELAY ? zone->delay : zone->hold;
+					const f32 step = std::min(dt, length - voice->stageTime);
+					voice->stageTime += step;
+					dt -= step;
+					if (voice->stageTime >= length)
+					{
+						voice->stage = EnvStage(voice->stage + 1);
+						voice->stageTime = 0.0f;
+					}
+					voice->level = voice->stage > ENV_ATTACK ? 1.0f : 0.0f;
+				} break;
+				case ENV_ATTACK:
+				{
+					// Linear in amplitude.
+					const f32 step = std::min(dt, zone->attack - voice->stageTime);
+					voice->stageTime += step;
+					dt -= step;
+					voice->level = std::min(1.0f, voice->stageTime / zone->attack);
+					if (voice->stageTime >= zone->attack)
+					{
+						voice->stage = ENV_HOLD;
+						voice->stageTime = 0.0f;
+						voice->level = 1.0f;
+					}
+				} break;
+				case ENV_DECAY:
+				{
+					// Linear in decibels, the decay time is for a 100dB change.
+					voice->atten += dt * 1000.0f / zone->decay;
+					dt = 0.0f;
+					if (voice->atten >= zone->sustain)
+					{
+						voice->atten = zone->sustain;
+						voice->stage = zone->sustain >= 1000.0f ? ENV_OFF : ENV_SUSTAIN;
+					}
+					voice->level = powf(10.0f, -voice->atten / 200.0f);
+				} break;
+				case ENV_SUSTAIN:
+				{
+					dt = 0.0f;
+				} break;
+				case ENV_RELEASE:
+				{
+					voice->atten += dt * 1000.0f / zone->release;
+					dt = 0.0f;
+					if (voice->atten >= 1000.0f)
+					{
+						voice->atten = 1000.0f;
+						voice->stage = ENV_OFF;
+					}
+					voice->level = powf(10.0f, -voice->atten / 200.0f);
+				} break;
+				default:
+					break;
+			}
+		}
+		// Voices that finish or are cut off fade to zero over the block.
+		if (voice->stage >= ENV_FADE) { voice->level = 0.0f; }
+		return voice->level;
+	}
+
+	void renderVoice(SynthVoice* voice, f32* out, u32 count)
+	{
+		const SynthZone* zone = voice->zone;
+		const SynthChannel* channel = &s_channels[voice->channel];
+		const bool fading = voice->stage >= ENV_FADE;
+		const f32 level = updateEnvelope(voice, f32(count) / s_sampleRate);
+
+		// Volume and expression use the General MIDI 40 log(x) curve.
+		const f32 volume = f32(channel->volume * channel->volume) / f32(127 * 127);
+		const f32 expression = f32(channel->expression * channel->expression) / f32(127 * 127);
+		const f32 gain = level * voice->velocityGain * volume * expression * zone->gain * (0.5f / 32768.0f);
+		if (channel->pan != voice->pan) { updateVoicePan(voice, channel); }
+		const f32 gainL = gain * voice->panL;
+		const f32 gainR = gain * voice->panR;
+		const f32 stepL = (gainL - voice->gainL) / f32(count);
+		const f32 stepR = (gainR - voice->gainR) / f32(count);
+
+		if (channel->pitchBend * channel->bendRange != voice->bend) { updateVoicePitch(voice, channel); }
+		const u64 step = voice->step;
+		const f32 stepF = f32(step) * (1.0f / 4294967296.0f);
+
+		u32 done = 0;
+		while (done < count)
+		{
+			u32 index = u32(voice->pos >> 32ull);
+			if (voice->looping)
+			{
+				const u64 loopLength = u64(zone->loopEnd - zone->loopStart) << 32ull;
+				while (index >= zone->loopEnd)
+				{
+					voice->pos -= loopLength;
+					index = u32(voice->pos >> 32ull);
+				}
+			}
+			else if (index >= zone->end)
+			{
+				voice->stage = ENV_OFF;
+				break;
+			}
+
+			// Render up to the loop end or the end of the sample.
+			const u32 limit = voice->looping ? zone->loopEnd : zone->end;
+			const u64 remaining = (u64(limit) << 32ull) - voice->pos;
+			const u32 frames = u32(std::min((remaining + step - 1) / step, u64(count - done)));
+			const f32 frac = f32(voice->pos & 0xffffffffull) * (1.0f / 4294967296.0f);
+			TFE_Audio::mixer_addResampled(out + done * 2, &s_sampleData[index], frames, frac, stepF,
+				voice->gainL + stepL * f32(done), voice->gainR + stepR * f32(done), stepL, stepR);
+			voice->pos += step * frames;
+			done += frames;
+		}
+		voice->gainL = gainL;
+		voice->gainR = gainR;
+		if (fading) { voice->stage = ENV_OFF; }
+	}
+
+	void renderVoices(f32* out, u32 count)
+	{
+		while (count)
+		{
+			const u32 blockSize = std::min(count, u32(SYNTH_BLOCK_SIZE));
+			for (s32 i = 0; i < SYNTH_VOICE_COUNT; i++)
+			{
+				if (s_voices[i].stage != ENV_OFF)
+				{
+					renderVoice(&s_voices[i], out, blockSize);
+				}
+			}
+			out += blockSize * 2;
+			count -= blockSize;
+		}
+	}
+
+	// Audio thread callback, music volume is applied by the midi player so 'systemVolume' is not used.
+	void render(f32* buffer, u32 frameCount, f32 systemVolume)
+	{
+		s_rendering.store(true);
+		if (!s_active.load())
+		{
+			s_rendering.store(false);
+			return;
+		}
+		TFE_ZONE("MIDI Synth");
+		if (s_resetPending.exchange(false))
+		{
+			resetState();
+		}
+
+		// This buffer covers the time since the previous one, so messages are played one buffer late
+		// but keep the same spacing they were sent with.
+		const u64 now = TFE_System::getCurrentTimeInTicks();
+		const u64 prev = (s_prevRenderTime && s_prevRenderTime < now) ? s_prevRenderTime : now;
+		const u64 window = now - prev;
+
+		u32 frame = 0;
+		u32 read = s_queueRead.load();
+		const u32 write = s_queueWrite.load();
+		for (; read != write; read++)
+		{
+			const SynthMessage* msg = &s_queue[read & (SYNTH_QUEUE_SIZE - 1)];
+			// Messages sent after this buffer started are played in the next one.
+			if (msg->time > now) { break; }
+
+			u32 offset = 0;
+			if (window && msg->time > prev)
+			{
+				offset = u32(std::min(u64(frameCount), (msg->time - prev) * u64(frameCount) / window));
+			}
+			if (offset > frame)
+			{
+				renderVoices(buffer + frame * 2, offset - frame);
+				frame = offset;
+			}
+			processMessage(msg->data);
+		}
+		s_queueRead.store(read);
+		renderVoices(buffer + frame * 2, frameCount - frame);
+
+		s_prevRenderTime = now;
+		s_rendering.store(false);
+	}
+}
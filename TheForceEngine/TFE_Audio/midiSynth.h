@@ -0,0 +1,41 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// The Force Engine MIDI Synthesizer
+// Plays MIDI using a SoundFont 2 bank, rendering the voices directly
+// into the audio mix instead of sending the messages to an external
+// device.
+//
+// Messages are timestamped when sent and played back at the matching
+// sample position one audio buffer later, so the timing does not
+// depend on when the audio callback happens to run.
+//
+// The sample, tuning, volume envelope, attenuation and pan generators
+// are supported. Filters, the modulation envelope and LFOs are not.
+// Banks that only reference ROM samples (such as AWE32 banks) play
+// with generated waveforms in place of the missing samples.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+
+namespace TFE_MidiSynth
+{
+	enum
+	{
+		SYNTH_DEFAULT_POLYPHONY = 48,
+		SYNTH_MAX_POLYPHONY = 128,
+	};
+
+	bool loadSoundFont(const char* path);
+	void unloadSoundFont();
+	bool isLoaded();
+
+	// Start or stop rendering into the audio mix, playback starts from a reset state.
+	void start();
+	void stop();
+
+	// Maximum number of voices that play at once, the quietest or oldest voices are stolen beyond that.
+	void setPolyphony(u32 voiceCount);
+	u32  getPolyphony();
+
+	// Queue a message for playback. Messages must be sent from one thread at a time.
+	void sendMessage(const u8* msg, u32 size);
+}
@@ -3,6 +3,7 @@
 #include "lsound.h"
 #include <TFE_Game/igame.h>
 #include <TFE_Jedi/IMuse/imuse.h>
+#include <TFE_Jedi/Level/levelPrefetch.h>
 #include <TFE_FileSystem/paths.h>
 #include <TFE_FileSystem/filestream.h>
 
@@ -12,6 +13,7 @@ namespace TFE_DarkForces
 {
 	#define DEFAULT_PRIORITY 64
 	static LSound* s_soundList = nullptr;
+	static std::vector<u8> s_prefetchData;
 
 	void purgeAllSounds();
 	void freeSoundList(LSound* sound);
@@ -278,6 +280,20 @@ namespace TFE_DarkForces
 
 	u8* readVocFileData(const char* name, u32* sizeOut)
 	{
+		// TFE: Use the file data read by the level prefetch if available.
+		if (levelPrefetch_takeData(PREFETCH_VOC, name, &s_prefetchData))
+		{
+			const u32 size = (u32)s_prefetchData.size();
+			u8* data = size ? (u8*)game_alloc(size) : nullptr;
+			if (data)
+			{
+				memcpy(data, s_prefetchData.data(), size);
+				if (sizeOut) { *sizeOut = size; }
+			}
+			s_prefetchData.clear();
+			return data;
+		}
+
 		FilePath path;
 		if (strstr(name, ".voc") || strstr(name, ".VOC"))
 		{
@@ -4,10 +4,11 @@
 // Landru system, setup and teardown.
 //////////////////////////////////////////////////////////////////////
 #include <TFE_System/types.h>
+#include <TFE_Memory/memoryTracker.h>
 #include "lrect.h"
 
-#define landru_alloc(size)        TFE_Memory::region_alloc(s_alloc, size)
-#define landru_realloc(ptr, size) TFE_Memory::region_realloc(s_alloc, ptr, size)
+#define landru_alloc(size)        (TFE_ALLOC_SITE(), TFE_Memory::region_alloc(s_alloc, size))
+#define landru_realloc(ptr, size) (TFE_ALLOC_SITE(), TFE_Memory::region_realloc(s_alloc, ptr, size))
 #define landru_free(ptr)          TFE_Memory::region_free(s_alloc, ptr)
 struct MemoryRegion;
 
@@ -45,6 +45,7 @@
 #include <TFE_Archive/gobMemoryArchive.h>
 #include <TFE_Jedi/Level/rfont.h>
 #include <TFE_Jedi/Level/level.h>
+#include <TFE_Jedi/Level/levelData.h>
 #include <TFE_Jedi/InfSystem/infSystem.h>
 #include <TFE_Jedi/Task/task.h>
 #include <TFE_Jedi/Renderer/jediRenderer.h>
@@ -452,6 +453,68 @@ namespace TFE_DarkForces
 		strcpy(modList, s_sharedState.customGobName);
 	}
 
+	u32 DarkForces::getRandomSeed()
+	{
+		return random_getSeed();
+	}
+
+	void DarkForces::setRandomSeed(u32 seed)
+	{
+		random_seed(seed);
+	}
+
+	// FNV-1a
+	static void hashData(u64& hash, const void* data, size_t size)
+	{
+		const u8* bytes = (const u8*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+	}
+
+	// Hash of the simulation state that is affected by input and random numbers, used to verify that demo playback
+	// has not diverged. Only the level state is included, so the hash is only meaningful while in a mission.
+	u64 DarkForces::getStateHash()
+	{
+		u64 hash = 0xcbf29ce484222325ull;
+		const u32 seed = random_getSeed();
+		hashData(hash, &s_curTick, sizeof(s_curTick));
+		hashData(hash, &seed, sizeof(seed));
+		if (s_runGameState.state != GSTATE_MISSION || !s_playerObject)
+		{
+			return hash;
+		}
+
+		hashData(hash, &s_playerObject->posWS, sizeof(s_playerObject->posWS));
+		hashData(hash, &s_playerObject->yaw, sizeof(s_playerObject->yaw));
+		hashData(hash, &s_playerObject->pitch, sizeof(s_playerObject->pitch));
+		hashData(hash, &s_playerInfo.health, sizeof(s_playerInfo.health));
+		hashData(hash, &s_playerInfo.shields, sizeof(s_playerInfo.shields));
+		hashData(hash, &s_energy, sizeof(s_energy));
+
+		RSector* sector = s_levelState.sectors;
+		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++)
+		{
+			hashData(hash, &sector->floorHeight, sizeof(sector->floorHeight));
+			hashData(hash, &sector->ceilingHeight, sizeof(sector->ceilingHeight));
+			hashData(hash, &sector->secHeight, sizeof(sector->secHeight));
+
+			SecObject** list = sector->objectList;
+			for (s32 o = 0, idx = 0; o < sector->objectCount && idx < sector->objectCapacity; idx++)
+			{
+				SecObject* obj = list[idx];
+				if (!obj) { continue; }
+				o++;
+
+				hashData(hash, &obj->posWS, sizeof(obj->posWS));
+				hashData(hash, &obj->yaw, sizeof(obj->yaw));
+				hashData(hash, &obj->flags, sizeof(obj->flags));
+			}
+		}
+		return hash;
+	}
+
 	/**********The basic structure of the Dark Forces main loop is as follows:***************
 	while (1)  // <- This will be replaced by the function call from the main TFE loop.
 	{
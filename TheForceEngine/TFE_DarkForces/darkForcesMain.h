@@ -20,6 +20,9 @@ namespace TFE_DarkForces
 		bool canSave() override;
 		void getLevelName(char* name) override;
 		void getModList(char* modList) override;
+		u32  getRandomSeed() override;
+		void setRandomSeed(u32 seed) override;
+		u64  getStateHash() override;
 	};
 
 	extern void saveLevelStatus();
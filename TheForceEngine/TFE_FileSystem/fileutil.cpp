@@ -256,6 +256,20 @@ namespace FileUtil
 		return modTime;
 	}
 
+	void touchFile(const char* path)
+	{
+		HANDLE fileHandle = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		FILETIME curTime;
+		GetSystemTimeAsFileTime(&curTime);
+		SetFileTime(fileHandle, NULL, NULL, &curTime);
+		CloseHandle(fileHandle);
+	}
+
 	void fixupPath(char* path)
 	{
 		const size_t len = strlen(path);
@@ -26,6 +26,8 @@ namespace FileUtil
 	bool exists(const char* path);
 	bool directoryExits(const char* path);
 	u64  getModifiedTime(const char* path);
+	// Set the modified time to the current time.
+	void touchFile(const char* path);
 
 	void fixupPath(char* path);
 	void convertToOSPath(const char* path, char* pathOS);
@@ -1,9 +1,16 @@
 #pragma once
 #include "filewriterAsync.h"
+#include "filestream.h"
+#include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/mutex.h>
+#include <TFE_System/Threads/signal.h>
+#include <TFE_System/profiler.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <vector>
+#include <deque>
+#include <string>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN 1
@@ -97,4 +104,171 @@ namespace FileWriterAsync
 		return true;
 	}
 #endif
+
+	/////////////////////////////////////////////
+	// Queued writes
+	/////////////////////////////////////////////
+	struct QueuedWrite
+	{
+		std::string path;
+		FileWritePrepareCallback prepare;
+		FileWriteCompletionCallback callback;
+		void* userData;
+	};
+
+	static std::deque<QueuedWrite> s_queue;
+	static Mutex*  s_queueMutex = nullptr;
+	static Signal* s_queueSignal = nullptr;
+	static Thread* s_writerThread = nullptr;
+	static atomic_bool s_writerRunning;
+	// Queued writes that have not finished yet, including the one being processed.
+	static atomic_s32 s_pendingWrites;
+
+	TFE_THREADRET fileWriterFunc(void* userData);
+
+	bool startWriterThread()
+	{
+		if (s_writerThread) { return true; }
+
+		s_queueMutex = Mutex::create();
+		s_queueSignal = Signal::create();
+		s_writerRunning.store(true);
+		s_writerThread = Thread::create("FileWriterThread", fileWriterFunc, nullptr);
+		if (!s_writerThread || !s_writerThread->run())
+		{
+			TFE_System::logWrite(LOG_ERROR, "AsyncFileWrite", "Cannot create the file writer thread.");
+			delete s_writerThread;
+			delete s_queueSignal;
+			delete s_queueMutex;
+			s_writerThread = nullptr;
+			s_queueSignal = nullptr;
+			s_queueMutex = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	void processWrite(QueuedWrite& write, std::vector<u8>& buffer)
+	{
+		buffer.clear();
+		if (write.prepare && !write.prepare(buffer, write.userData))
+		{
+			if (write.callback) { write.callback(0, write.userData, AFW_ERROR_PREPARE); }
+			return;
+		}
+
+		std::string tempPath = write.path + ".tmp";
+		FileStream file;
+		if (!file.open(tempPath.c_str(), Stream::MODE_WRITE))
+		{
+			TFE_System::logWrite(LOG_ERROR, "AsyncFileWrite", "Cannot create file: %s", tempPath.c_str());
+			if (write.callback) { write.callback(0, write.userData, AFW_ERROR_OPEN); }
+			return;
+		}
+		if (!buffer.empty())
+		{
+			file.writeBuffer(buffer.data(), u32(buffer.size()));
+		}
+		file.close();
+
+		// Make sure all of the data reached the file (the disk may be full) before replacing the existing file.
+		size_t writtenSize = 0;
+		if (file.open(tempPath.c_str(), Stream::MODE_READ))
+		{
+			writtenSize = file.getSize();
+			file.close();
+		}
+		if (writtenSize != buffer.size())
+		{
+			TFE_System::logWrite(LOG_ERROR, "AsyncFileWrite", "Only wrote %zu of %zu bytes: %s", writtenSize, buffer.size(), tempPath.c_str());
+			remove(tempPath.c_str());
+			if (write.callback) { write.callback(0, write.userData, AFW_ERROR_WRITE); }
+			return;
+		}
+
+		// Replace the existing file in a single step, so it is never missing if the game crashes.
+	#ifdef _WIN32
+		const bool replaced = MoveFileExA(tempPath.c_str(), write.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+	#else
+		const bool replaced = rename(tempPath.c_str(), write.path.c_str()) == 0;
+	#endif
+		if (!replaced)
+		{
+			TFE_System::logWrite(LOG_ERROR, "AsyncFileWrite", "Cannot write file: %s", write.path.c_str());
+			remove(tempPath.c_str());
+			if (write.callback) { write.callback(0, write.userData, AFW_ERROR_WRITE); }
+			return;
+		}
+		if (write.callback) { write.callback(buffer.size(), write.userData, AFW_SUCCESS); }
+	}
+
+	TFE_THREADRET fileWriterFunc(void* userData)
+	{
+		TFE_Profiler::setThreadName("FileWriterThread");
+		std::vector<u8> buffer;
+		while (1)
+		{
+			s_queueSignal->wait();
+			while (1)
+			{
+				s_queueMutex->lock();
+				if (s_queue.empty())
+				{
+					s_queueMutex->unlock();
+					break;
+				}
+				QueuedWrite write = s_queue.front();
+				s_queue.pop_front();
+				s_queueMutex->unlock();
+
+				TFE_ZONE("File Write");
+				processWrite(write, buffer);
+				s_pendingWrites--;
+			}
+			if (!s_writerRunning.load()) { break; }
+		}
+		return (TFE_THREADRET)0;
+	}
+
+	bool queueFileWrite(const char* path, FileWritePrepareCallback prepare, void* userData, FileWriteCompletionCallback completionCallback)
+	{
+		if (!path || !startWriterThread()) { return false; }
+
+		s_pendingWrites++;
+		s_queueMutex->lock();
+		s_queue.push_back({ path, prepare, completionCallback, userData });
+		s_queueMutex->unlock();
+		s_queueSignal->fire();
+		return true;
+	}
+
+	void waitForQueuedWrites()
+	{
+		while (s_pendingWrites.load() > 0)
+		{
+			TFE_System::sleep(1);
+		}
+	}
+
+	bool hasQueuedWrites()
+	{
+		return s_pendingWrites.load() > 0;
+	}
+
+	void shutdown()
+	{
+		if (!s_writerThread) { return; }
+
+		// The thread finishes the remaining writes before exiting.
+		s_writerRunning.store(false);
+		s_queueSignal->fire();
+		s_writerThread->waitOnExit();
+
+		delete s_writerThread;
+		delete s_queueSignal;
+		delete s_queueMutex;
+		s_writerThread = nullptr;
+		s_queueSignal = nullptr;
+		s_queueMutex = nullptr;
+	}
 };
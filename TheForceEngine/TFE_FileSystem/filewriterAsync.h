@@ -1,15 +1,32 @@
 #pragma once
 #include <TFE_System/system.h>
+#include <vector>
 
 // TODO: Flesh out error codes.
 enum AsyncFileWriteCodes
 {
 	AFW_SUCCESS = 0,
+	AFW_ERROR_PREPARE,	// The prepare callback cancelled the write.
+	AFW_ERROR_OPEN,		// The file could not be created.
+	AFW_ERROR_WRITE,	// The data could not be written or the file could not be replaced.
 };
 
 typedef void(*FileWriteCompletionCallback)(size_t bytesWritten, void* userData, u32 errorCode);
+// Fills in 'buffer' with the file contents, return false to cancel the write.
+typedef bool(*FileWritePrepareCallback)(std::vector<u8>& buffer, void* userData);
 
 namespace FileWriterAsync
 {
 	bool writeFileToDisk(const char* path, u8* data, size_t dataSize, FileWriteCompletionCallback completionCallback = nullptr, void* userData = nullptr);
+
+	// Queue a write on the file writer thread. 'prepare' is called on that thread to build the file contents, so expensive
+	// work such as compression does not stall the caller. Writes are processed in order, the data is written to a temporary
+	// file first so an existing file is only replaced once the new one is complete.
+	// Both callbacks are called from the writer thread.
+	bool queueFileWrite(const char* path, FileWritePrepareCallback prepare, void* userData, FileWriteCompletionCallback completionCallback = nullptr);
+	// Block until all queued writes have finished.
+	void waitForQueuedWrites();
+	bool hasQueuedWrites();
+	// Finish the queued writes and stop the writer thread.
+	void shutdown();
 };
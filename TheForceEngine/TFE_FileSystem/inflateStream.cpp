@@ -0,0 +1,174 @@
+#include <cstring>
+
+#include "inflateStream.h"
+#include <TFE_System/system.h>
+#include <assert.h>
+#include <algorithm>
+
+// The miniz implementation is compiled with the zip library.
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <TFE_Archive/zip/miniz.h>
+
+enum InflateStreamConst : u32
+{
+	IS_INPUT_SIZE = 16384u,
+};
+
+struct InflateState
+{
+	mz_stream zstream;
+	u8 input[IS_INPUT_SIZE];
+};
+
+InflateStream::InflateStream() : Stream()
+{
+	m_source = nullptr;
+	m_state = nullptr;
+	m_size = 0u;
+	m_addr = 0u;
+	m_error = false;
+}
+
+InflateStream::~InflateStream()
+{
+	close();
+}
+
+bool InflateStream::open(Stream* source, size_t size)
+{
+	close();
+	if (!source) { return false; }
+
+	m_state = new InflateState;
+	memset(&m_state->zstream, 0, sizeof(mz_stream));
+	if (mz_inflateInit(&m_state->zstream) != MZ_OK)
+	{
+		delete m_state;
+		m_state = nullptr;
+		return false;
+	}
+
+	m_source = source;
+	m_size = size;
+	m_addr = 0u;
+	m_error = false;
+	return true;
+}
+
+void InflateStream::close()
+{
+	if (m_state)
+	{
+		mz_inflateEnd(&m_state->zstream);
+		delete m_state;
+	}
+	m_state = nullptr;
+	m_source = nullptr;
+	m_size = 0u;
+	m_addr = 0u;
+}
+
+bool InflateStream::isOpen() const
+{
+	return m_state != nullptr;
+}
+
+// Only skipping forward is supported, since the data has to be decompressed to get there.
+bool InflateStream::seek(s32 offset, Origin origin/*=ORIGIN_START*/)
+{
+	if (!m_state) { return false; }
+
+	size_t target;
+	if (origin == ORIGIN_START)        { target = size_t(offset); }
+	else if (origin == ORIGIN_END)     { target = m_size + offset; }
+	else                               { target = m_addr + offset; }
+	if (target < m_addr || target > m_size) { return false; }
+
+	u8 skipBuffer[1024];
+	while (m_addr < target)
+	{
+		const u32 skipSize = u32(std::min(target - m_addr, sizeof(skipBuffer)));
+		if (!readBuffer(skipBuffer, skipSize)) { return false; }
+	}
+	return true;
+}
+
+size_t InflateStream::getLoc()
+{
+	return m_addr;
+}
+
+size_t InflateStream::getSize()
+{
+	return m_size;
+}
+
+bool InflateStream::fillInput()
+{
+	const u32 readSize = m_source->readBuffer(m_state->input, IS_INPUT_SIZE);
+	m_state->zstream.next_in = m_state->input;
+	m_state->zstream.avail_in = readSize;
+	return readSize > 0;
+}
+
+u32 InflateStream::readBuffer(void* ptr, u32 size, u32 count)
+{
+	if (!m_state || m_error) { return 0; }
+
+	size_t totalSize = size_t(size) * count;
+	if (m_addr + totalSize > m_size)
+	{
+		totalSize = m_size - m_addr;
+	}
+
+	mz_stream* zstream = &m_state->zstream;
+	zstream->next_out = (u8*)ptr;
+	zstream->avail_out = (u32)totalSize;
+	while (zstream->avail_out)
+	{
+		if (!zstream->avail_in && !fillInput())
+		{
+			break;
+		}
+		const s32 res = mz_inflate(zstream, MZ_NO_FLUSH);
+		if (res == MZ_STREAM_END) { break; }
+		if (res != MZ_OK)
+		{
+			TFE_System::logWrite(LOG_ERROR, "InflateStream", "Compressed data is corrupt (error %d).", res);
+			m_error = true;
+			break;
+		}
+	}
+
+	const size_t readSize = totalSize - zstream->avail_out;
+	m_addr += readSize;
+	return (u32)readSize;
+}
+
+void InflateStream::read(std::string* ptr, u32 count)
+{
+	// Matches the FileStream layout: the lengths of all of the strings, followed by the string data.
+	std::vector<u32> lengths(count);
+	readBuffer(lengths.data(), sizeof(u32), count);
+	for (u32 s = 0; s < count; s++)
+	{
+		ptr[s].resize(lengths[s]);
+		if (lengths[s]) { readBuffer(&ptr[s][0], lengths[s]); }
+	}
+}
+
+void InflateStream::writeBuffer(const void* ptr, u32 size, u32 count)
+{
+	assert(0);
+}
+
+void InflateStream::write(const std::string* ptr, u32 count)
+{
+	assert(0);
+}
+
+void InflateStream::writeString(const char* fmt, ...)
+{
+	assert(0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <TFE_FileSystem/stream.h>
+
+////////////////////////////////////////////////////
+// Read-only stream that decompresses zlib data from
+// another stream as it is read, so the compressed
+// data never has to be fully loaded into memory.
+// Seeking is limited to skipping forward.
+////////////////////////////////////////////////////
+
+struct InflateState;
+
+class InflateStream : public Stream
+{
+public:
+	InflateStream();
+	~InflateStream();
+
+	// Start decompressing from the current location of 'source', which must stay open until close() is called.
+	// 'size' is the decompressed size.
+	bool open(Stream* source, size_t size);
+	void close();
+
+	//derived functions.
+	bool seek(s32 offset, Origin origin=ORIGIN_START) override;
+	size_t getLoc() override;
+	size_t getSize() override;
+	bool   isOpen() const;
+
+	void read(s8*  ptr, u32 count=1) override { readBuffer(ptr, sizeof(s8),  count); }
+	void read(u8*  ptr, u32 count=1) override { readBuffer(ptr, sizeof(u8),  count); }
+	void read(s16* ptr, u32 count=1) override { readBuffer(ptr, sizeof(s16), count); }
+	void read(u16* ptr, u32 count=1) override { readBuffer(ptr, sizeof(u16), count); }
+	void read(s32* ptr, u32 count=1) override { readBuffer(ptr, sizeof(s32), count); }
+	void read(u32* ptr, u32 count=1) override { readBuffer(ptr, sizeof(u32), count); }
+	void read(s64* ptr, u32 count=1) override { readBuffer(ptr, sizeof(s64), count); }
+	void read(u64* ptr, u32 count=1) override { readBuffer(ptr, sizeof(u64), count); }
+	void read(f32* ptr, u32 count=1) override { readBuffer(ptr, sizeof(f32), count); }
+	void read(f64* ptr, u32 count=1) override { readBuffer(ptr, sizeof(f64), count); }
+	void read(std::string* ptr, u32 count=1) override;
+	u32  readBuffer(void* ptr, u32 size, u32 count=1) override;
+
+	// Writing is not supported.
+	void write(const s8*  ptr, u32 count=1) override { writeBuffer(ptr, sizeof(s8),  count); }
+	void write(const u8*  ptr, u32 count=1) override { writeBuffer(ptr, sizeof(u8),  count); }
+	void write(const s16* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(s16), count); }
+	void write(const u16* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(u16), count); }
+	void write(const s32* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(s32), count); }
+	void write(const u32* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(u32), count); }
+	void write(const s64* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(s64), count); }
+	void write(const u64* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(u64), count); }
+	void write(const f32* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(f32), count); }
+	void write(const f64* ptr, u32 count=1) override { writeBuffer(ptr, sizeof(f64), count); }
+	void write(const std::string* ptr, u32 count=1) override;
+	void writeBuffer(const void* ptr, u32 size, u32 count=1) override;
+
+	void writeString(const char* fmt, ...) override;
+
+private:
+	bool fillInput();
+
+private:
+	Stream* m_source;
+	InflateState* m_state;
+	size_t m_size;
+	size_t m_addr;
+	bool m_error;
+};
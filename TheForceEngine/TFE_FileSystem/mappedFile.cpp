@@ -0,0 +1,96 @@
+#include "mappedFile.h"
+#include <TFE_System/system.h>
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* filePath)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_mapHandle = mapping;
+	m_data = (const u8*)data;
+	m_size = size_t(size.QuadPart);
+#else
+	const int fd = ::open(filePath, O_RDONLY);
+	if (fd < 0) { return false; }
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed.
+	::close(fd);
+	if (data == MAP_FAILED) { return false; }
+
+	m_data = (const u8*)data;
+	m_size = size_t(st.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data) { UnmapViewOfFile(m_data); }
+	if (m_mapHandle) { CloseHandle((HANDLE)m_mapHandle); }
+	if (m_fileHandle) { CloseHandle((HANDLE)m_fileHandle); }
+#else
+	if (m_data) { munmap((void*)m_data, m_size); }
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_fileHandle = nullptr;
+	m_mapHandle = nullptr;
+}
+
+const u8* MappedFile::getRange(size_t offset, size_t length) const
+{
+	if (!m_data || offset > m_size || length > m_size - offset)
+	{
+		return nullptr;
+	}
+	return m_data + offset;
+}
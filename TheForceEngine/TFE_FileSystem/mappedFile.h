@@ -0,0 +1,30 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Read-only memory mapped file.
+// The contents can be accessed directly without copying them into
+// a temporary buffer first.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+
+class MappedFile
+{
+public:
+	MappedFile() : m_data(nullptr), m_size(0), m_fileHandle(nullptr), m_mapHandle(nullptr) {}
+	~MappedFile();
+
+	bool open(const char* filePath);
+	void close();
+
+	bool isOpen() const { return m_data != nullptr; }
+	const u8* getData() const { return m_data; }
+	size_t getSize() const { return m_size; }
+
+	// Returns a pointer to 'length' bytes starting at 'offset', or null if the range is outside of the file.
+	const u8* getRange(size_t offset, size_t length) const;
+
+private:
+	const u8* m_data;
+	size_t m_size;
+	void* m_fileHandle;
+	void* m_mapHandle;
+};
@@ -32,6 +32,43 @@ namespace TFE_Paths
 	static std::vector<std::string> s_searchPaths;
 	static std::vector<FileMapping> s_fileMappings;
 
+	// Index of the files in all of the local archives, rebuilt when the archive list or their contents change.
+	struct ArchiveFile
+	{
+		Archive* archive;
+		u32 index;
+	};
+	static std::vector<ArchiveFile> s_archiveFiles;
+	static FileIndex s_archiveIndex;
+	static bool s_archiveIndexDirty = true;
+	static u32  s_archiveIndexVersion = 0;
+
+	void buildArchiveIndex()
+	{
+		s_archiveFiles.clear();
+		const size_t archiveCount = s_localArchives.size();
+		for (size_t i = 0; i < archiveCount; i++)
+		{
+			Archive* archive = s_localArchives[i];
+			if (!archive) { continue; }	// Avoid crashing if an archive is null.
+
+			const u32 fileCount = archive->getFileCount();
+			for (u32 f = 0; f < fileCount; f++)
+			{
+				s_archiveFiles.push_back({ archive, f });
+			}
+		}
+		// Files are added in archive order and the first entry with a given name wins, matching the search order.
+		s_archiveIndex.build(u32(s_archiveFiles.size()), [](u32 id, void* userData)
+		{
+			const ArchiveFile& file = s_archiveFiles[id];
+			return file.archive->getFileName(file.index);
+		}, nullptr);
+
+		s_archiveIndexDirty = false;
+		s_archiveIndexVersion = Archive::getContentVersion();
+	}
+
 	void setPath(TFE_PathType pathType, const char* path)
 	{
 		s_paths[pathType] = path;
@@ -199,6 +236,7 @@ namespace TFE_Paths
 			Archive::freeArchive(archive[i]);
 		}
 		s_localArchives.clear();
+		s_archiveIndexDirty = true;
 	}
 
 	// Add a single file that can be referenced by 'fileName' even though the real name may be different.
@@ -246,21 +284,25 @@ namespace TFE_Paths
 	void addLocalArchiveToFront(Archive* archive)
 	{
 		s_localArchives.insert(s_localArchives.begin(), archive);
+		s_archiveIndexDirty = true;
 	}
 
 	void removeFirstArchive()
 	{
 		s_localArchives.erase(s_localArchives.begin());
+		s_archiveIndexDirty = true;
 	}
 
 	void addLocalArchive(Archive* archive)
 	{
 		s_localArchives.push_back(archive);
+		s_archiveIndexDirty = true;
 	}
 
 	void removeLastArchive()
 	{
 		s_localArchives.pop_back();
+		s_archiveIndexDirty = true;
 	}
 
 	bool getFilePath(const char* fileName, FilePath* outPath)
@@ -300,19 +342,16 @@ namespace TFE_Paths
 		}
 
 		// Then archives: s_localArchives.
-		const size_t archiveCount = s_localArchives.size();
-		Archive** archive = s_localArchives.data();
-		for (size_t i = 0; i < archiveCount; i++, archive++)
+		if (s_archiveIndexDirty || s_archiveIndexVersion != Archive::getContentVersion())
 		{
-			if (!(*archive)) { continue; }	// Avoid crashing if an archive is null.
-
-			u32 index = (*archive)->getFileIndex(fileName);
-			if (index != INVALID_FILE)
-			{
-				outPath->archive = *archive;
-				outPath->index = index;
-				return true;
-			}
+			buildArchiveIndex();
+		}
+		const u32 id = s_archiveIndex.find(fileName);
+		if (id != INVALID_FILE)
+		{
+			outPath->archive = s_archiveFiles[id].archive;
+			outPath->index = s_archiveFiles[id].index;
+			return true;
 		}
 
 		// Finally admit defeat.
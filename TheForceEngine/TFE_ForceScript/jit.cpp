@@ -6,34 +6,46 @@
 #include <map>
 
 #ifdef VM_ENABLE
+// We currently only support x64, other targets always run in the interpreter.
+#if defined(_M_X64) || defined(__x86_64__)
+#define JIT_X64 1
 #include "asmjit/x86.h"
 
 using namespace asmjit;
-// Incomment to enable per-instruction validation at the assembler level.
-#define JIT_DEBUG 0
+#endif
+// Uncomment to enable per-instruction validation at the assembler level.
+// #define JIT_DEBUG 1
 
 namespace TFE_ForceScript
 {
 	typedef std::map<std::string, ScriptJitFunc> ScriptJitMap;
 	typedef std::vector<ScriptJitFunc> ScriptJitList;
 
-	static JitRuntime s_runtime;
 	static ScriptJitMap s_jitFuncs;
 	static ScriptJitList s_jitFuncList;
-	
+#ifdef JIT_X64
+	static JitRuntime s_runtime;
+#endif
+
 	bool jit_init()
 	{
+	#ifdef JIT_X64
 		return true;
+	#else
+		return false;
+	#endif
 	}
 
 	void jit_destroy()
 	{
+	#ifdef JIT_X64
 		const size_t count = s_jitFuncList.size();
 		ScriptJitFunc* func = s_jitFuncList.data();
 		for (size_t i = 0; i < count; i++)
 		{
 			s_runtime.release(func[i]);
 		}
+	#endif
 		s_jitFuncs.clear();
 		s_jitFuncList.clear();
 	}
@@ -44,271 +56,545 @@ namespace TFE_ForceScript
 		return it == s_jitFuncs.end() ? nullptr : it->second;
 	}
 
-	enum IR_Type
-	{
-		IRT_INSTR = 0,
-		IRT_LABEL,
-		IRT_COUNT
-	};
-
-	struct IR_Jit
+#ifndef JIT_X64
+	ScriptJitFunc jit_compileScriptFunc(const char* funcName, const Instruction* func, s32 funcSize)
 	{
-		IR_Type type;
-		Instruction it;
-		s32 index;
-	};
-	static std::vector<IR_Jit> s_jitIR;
-
+		return nullptr;
+	}
+#else
 	#ifdef JIT_DEBUG
-		#define emit(x) ierr = as. ## x; assert(ierr == 0)
+		#define emit(x) ierr = as.x; assert(ierr == 0)
 	#else
-		#define emit(x) as. ## x
+		#define emit(x) as.x
 	#endif
 
-	#define PTR0 8*I_ARG0(ir->it)
-	#define PTR1 8*I_ARG1(ir->it)
-	#define PTR2 8*I_ARG2(ir->it)
+	// The frame pointer (first register of the function) is kept in rbx, which is preserved across calls.
+	#define FRAME x86::rbx
+	#define REG_QW(r)   x86::qword_ptr(FRAME, s32(8 * (r)))
+	#define REG_DW(r)   x86::dword_ptr(FRAME, s32(8 * (r)))
+	#define REG_TYPE(r) x86::dword_ptr(FRAME, s32(8 * (r) + 4))
+	// The value type as seen in the upper 32-bits of an FsValue.
+	#define TYPE_HI(t)  u32(u64(t) << (FS_TypeDataShift - 32ull))
+	// Bit index of FSF_REF (FLAG_BIT(1)) in an FsValue.
+	#define REF_BIT     (FS_FlagsShift + 1ull)
 
-	Label* s_labels;
-	s32 s_labelTarget[256];
-	s32 s_labelCount = 0;
+	#if defined(_WIN32)
+		#define ARG0_REG x86::rcx
+		#define ARG1_REG x86::rdx
+	#else
+		#define ARG0_REG x86::rdi
+		#define ARG1_REG x86::rsi
+	#endif
 
-	void loadValueType(Error& ierr, x86::Assembler& as, x86::Gp dstReg, x86::Mem src)
+	// Opcodes that are not worth generating inline run through the interpreter.
+	static void jit_interpOp(FsValue* stack, Instruction it)
 	{
-		// type = (src >> FS_TypeDataShift) & FS_TypeMask
-		emit(mov(dstReg, src));
-		emit(shr(dstReg,  FS_TypeDataShift));
-		emit(and_(dstReg, FS_TypeMask));
+		FsValue* prevStackPtr = s_stackPtr;
+		s_stackPtr = stack;
+		s_vmOpCalls[I_OP(it)](it);
+		s_stackPtr = prevStackPtr;
 	}
 
-	void dynamicCastToFloat(Error& ierr, x86::Assembler& as, x86::Gp type, x86::Xmm dst, x86::Mem src)
+	static void emitInterpOp(Error& ierr, x86::Assembler& as, Instruction it)
 	{
-		// Create labels.
-		s32 labelElse = s_labelCount;
-		s32 labelEnd = s_labelCount + 1;
-		s_labelCount +=2;
-		s_labels[labelElse] = as.newLabel();
-		s_labels[labelEnd] = as.newLabel();
-
-		// Check to see if it is integer.
-		// TODO: Support NxM types.
-		// TODO: Default to 0 for invalid types.
-
-		// Zero out the floating point register so the upper bits aren't undefined (which can cause problems later).
-		emit(xorps(dst, dst));
-
-		emit(cmp(type, FST_INT)); // if r0 == FST_INT {
-		emit(jnz(s_labels[labelElse]));
-			emit(cvtsi2ss(dst, src));
-			emit(jmp(s_labels[labelEnd]));
-		emit(bind(s_labels[labelElse])); // } else {
-			emit(movss(dst, src));
-		emit(bind(s_labels[labelEnd]));  // }
+		emit(mov(ARG0_REG, FRAME));
+		emit(mov(ARG1_REG, u64(it)));
+		emit(mov(x86::rax, u64(uintptr_t(jit_interpOp))));
+		emit(call(x86::rax));
 	}
 
-	ScriptJitFunc jit_compileScriptFunc(const char* funcName, Instruction* func, s32 funcSize)
+	static void storeInt(Error& ierr, x86::Assembler& as, u32 dst, x86::Gp value)
 	{
-		s_jitIR.clear();
-
-		Error ierr;
-		CodeHolder code;
-		code.init(s_runtime.environment());
-		x86::Assembler as(&code);
+		emit(mov(REG_DW(dst), value));
+		emit(mov(REG_TYPE(dst), TYPE_HI(FST_INT)));
+	}
 
-		// Enable strict validation.
-	#ifdef JIT_DEBUG
-		as.addDiagnosticOptions(DiagnosticOptions::kRADebugAll);
-	#endif
+	static void storeFloat(Error& ierr, x86::Assembler& as, u32 dst, x86::Xmm value)
+	{
+		emit(movss(REG_DW(dst), value));
+		emit(mov(REG_TYPE(dst), TYPE_HI(FST_FLOAT)));
+	}
 
-		// We currently only support x64.
-	#if defined(_WIN32)
-		x86::Gp stackPtr = x86::rcx;
-	#else
-		x86::Gp stackPtr = x86::rdi;
-	#endif
+	static void storeImm(Error& ierr, x86::Assembler& as, u32 dst, FsValue value)
+	{
+		// In x86_64 the only instruction that takes a 64-bit Immediate value is mov reg64, imm
+		emit(mov(x86::rax, u64(value)));
+		emit(mov(REG_QW(dst), x86::rax));
+	}
 
-		x86::Gp retValue = x86::rax;
+	// dst = (b <cc> c) ? 1 : 0 for integers.
+	static void intCompare(Error& ierr, x86::Assembler& as, u32 op, u32 dst, u32 b, u32 c)
+	{
+		emit(mov(x86::eax, REG_DW(b)));
+		emit(cmp(x86::eax, REG_DW(c)));
+		switch (op)
+		{
+			case FSF_OP_IEQ: { emit(sete(x86::al)); } break;
+			case FSF_OP_INE: { emit(setne(x86::al)); } break;
+			case FSF_OP_ILT: { emit(setl(x86::al)); } break;
+			case FSF_OP_ILE: { emit(setle(x86::al)); } break;
+		}
+		emit(movzx(x86::eax, x86::al));
+		storeInt(ierr, as, dst, x86::eax);
+	}
 
-		x86::Gp r0 = x86::rbx;
-		x86::Gp r1 = x86::rdx;
-		x86::Gp r0_32 = x86::ebx;
-		x86::Gp r1_32 = x86::edx;
-		x86::Xmm f0 = x86::xmm0;
-		x86::Xmm f1 = x86::xmm1;
+	// dst = (b <cc> c) ? 1 : 0 for floats, comparisons with NaN are false except for FNE.
+	static void floatCompare(Error& ierr, x86::Assembler& as, u32 op, u32 dst, u32 b, u32 c)
+	{
+		switch (op)
+		{
+			case FSF_OP_FEQ:
+			{
+				emit(movss(x86::xmm0, REG_DW(b)));
+				emit(ucomiss(x86::xmm0, REG_DW(c)));
+				emit(sete(x86::al));
+				emit(setnp(x86::cl));
+				emit(and_(x86::al, x86::cl));
+			} break;
+			case FSF_OP_FNE:
+			{
+				emit(movss(x86::xmm0, REG_DW(b)));
+				emit(ucomiss(x86::xmm0, REG_DW(c)));
+				emit(setne(x86::al));
+				emit(setp(x86::cl));
+				emit(or_(x86::al, x86::cl));
+			} break;
+			// b < c is tested as c > b so that unordered results are false.
+			case FSF_OP_FLT:
+			{
+				emit(movss(x86::xmm0, REG_DW(c)));
+				emit(ucomiss(x86::xmm0, REG_DW(b)));
+				emit(seta(x86::al));
+			} break;
+			case FSF_OP_FLE:
+			{
+				emit(movss(x86::xmm0, REG_DW(c)));
+				emit(ucomiss(x86::xmm0, REG_DW(b)));
+				emit(setae(x86::al));
+			} break;
+		}
+		emit(movzx(x86::eax, x86::al));
+		storeInt(ierr, as, dst, x86::eax);
+	}
 
-		// Save the temporary registers.
-		emit(push(r0));
-		emit(push(r1));
+	static void castToFloat(Error& ierr, x86::Assembler& as, Instruction it)
+	{
+		const u32 dst = u32(I_ARG0(it));
+		const u32 src = u32(I_ARG1(it));
+		Label notInt = as.newLabel();
+		Label slow = as.newLabel();
+		Label store = as.newLabel();
+		Label done = as.newLabel();
+
+		// type and type modifier = (src >> FS_TypeDataShift) & 0xff
+		emit(mov(x86::rax, REG_QW(src)));
+		emit(shr(x86::rax, FS_TypeDataShift));
+		emit(and_(x86::eax, 0xff));
+
+		emit(cmp(x86::eax, FST_INT));	// if type == FST_INT {
+		emit(jne(notInt));
+			emit(cvtsi2ss(x86::xmm0, REG_DW(src)));
+			emit(jmp(store));
+		emit(bind(notInt));				// } else if type == FST_FLOAT {
+		emit(cmp(x86::eax, FST_FLOAT));
+		emit(jne(slow));
+			emit(movss(x86::xmm0, REG_DW(src)));
+		emit(bind(store));
+			storeFloat(ierr, as, dst, x86::xmm0);
+			emit(jmp(done));
+		emit(bind(slow));				// } else {
+			emitInterpOp(ierr, as, it);
+		emit(bind(done));				// }
+	}
 
-		Label exitLabel = as.newLabel();
-		Label labels[256];
-		s_labels = labels;
-		s_labelCount = 0;
+	static void getField(Error& ierr, x86::Assembler& as, Instruction it)
+	{
+		const u32 dst = u32(I_ARG0(it));
+		const u32 obj = u32(I_ARG1(it));
+		const FsFieldInfo* field = &s_fields[I_ARG2(it)];
+		const s32 offset = s32(field->offset);
+		Label isNull = as.newLabel();
+		Label done = as.newLabel();
+
+		emit(mov(x86::rax, REG_QW(obj)));
+		emit(bt(x86::rax, REF_BIT));
+		emit(jnc(isNull));
+			emit(mov(x86::rcx, FS_ValueMask));
+			emit(and_(x86::rax, x86::rcx));
+			switch (field->type)
+			{
+				case FS_FIELD_INT:
+				{
+					emit(mov(x86::ecx, x86::dword_ptr(x86::rax, offset)));
+					storeInt(ierr, as, dst, x86::ecx);
+				} break;
+				case FS_FIELD_FLOAT:
+				{
+					emit(movss(x86::xmm0, x86::dword_ptr(x86::rax, offset)));
+					storeFloat(ierr, as, dst, x86::xmm0);
+				} break;
+				case FS_FIELD_FIXED16:
+				{
+					const f32 scale = 1.0f / 65536.0f;
+					u32 scaleBits;
+					memcpy(&scaleBits, &scale, sizeof(u32));
+
+					emit(cvtsi2ss(x86::xmm0, x86::dword_ptr(x86::rax, offset)));
+					emit(mov(x86::ecx, scaleBits));
+					emit(movd(x86::xmm1, x86::ecx));
+					emit(mulss(x86::xmm0, x86::xmm1));
+					storeFloat(ierr, as, dst, x86::xmm0);
+				} break;
+				default:
+				{
+					// Matches the interpreter, unknown field types read as null.
+					emit(mov(REG_QW(dst), 0));
+				} break;
+			}
+			emit(jmp(done));
+		emit(bind(isNull));
+			emit(mov(REG_QW(dst), 0));
+		emit(bind(done));
+	}
 
-		// First go through and add instructions, noting any labels.
-		s_jitIR.reserve(funcSize * 2);
-		for (s32 i = 0; i < funcSize; i++)
+	static void setField(Error& ierr, x86::Assembler& as, Instruction it)
+	{
+		const u32 obj = u32(I_ARG0(it));
+		const FsFieldInfo* field = &s_fields[I_ARG1(it)];
+		const u32 src = u32(I_ARG2(it));
+		const s32 offset = s32(field->offset);
+		Label notInt = as.newLabel();
+		Label slow = as.newLabel();
+		Label done = as.newLabel();
+
+		emit(mov(x86::rax, REG_QW(obj)));
+		emit(bt(x86::rax, REF_BIT));
+		emit(jnc(done));
+		emit(mov(x86::rcx, FS_ValueMask));
+		emit(and_(x86::rax, x86::rcx));
+		// Only plain int and float values are converted inline.
+		emit(mov(x86::rdx, REG_QW(src)));
+		emit(shr(x86::rdx, FS_TypeDataShift));
+		emit(and_(x86::edx, 0xff));
+
+		if (field->type == FS_FIELD_INT)
 		{
-			Instruction it = func[i];
-			IR_Jit ir = { IRT_INSTR, it, i };
-
-			if (I_OP(it) == FSF_OP_JMP)
+			emit(cmp(x86::edx, FST_INT));
+			emit(jne(notInt));
+				emit(mov(x86::ecx, REG_DW(src)));
+				emit(mov(x86::dword_ptr(x86::rax, offset), x86::ecx));
+				emit(jmp(done));
+			emit(bind(notInt));
+			emit(cmp(x86::edx, FST_FLOAT));
+			emit(jne(slow));
+				emit(cvttss2si(x86::ecx, REG_DW(src)));
+				emit(mov(x86::dword_ptr(x86::rax, offset), x86::ecx));
+				emit(jmp(done));
+		}
+		else
+		{
+			Label haveFloat = as.newLabel();
+			emit(cmp(x86::edx, FST_INT));
+			emit(jne(notInt));
+				emit(cvtsi2ss(x86::xmm0, REG_DW(src)));
+				emit(jmp(haveFloat));
+			emit(bind(notInt));
+			emit(cmp(x86::edx, FST_FLOAT));
+			emit(jne(slow));
+				emit(movss(x86::xmm0, REG_DW(src)));
+			emit(bind(haveFloat));
+			if (field->type == FS_FIELD_FLOAT)
 			{
-				s32 offset = I_ARG0(it);
-				// Re-write the instruction to point to the label index.
-				ir.it = I_OP_ARG0(FSF_OP_JMP, s_labelCount);
-
-				// insert a label.
-				s_labels[s_labelCount] = as.newLabel();
-				s_labelTarget[s_labelCount] = offset;
-				s_labelCount++;
+				emit(movss(x86::dword_ptr(x86::rax, offset), x86::xmm0));
 			}
-			else if (I_OP(it) == FSF_OP_JL)
+			else
 			{
-				// TODO
+				const f32 scale = 65536.0f;
+				u32 scaleBits;
+				memcpy(&scaleBits, &scale, sizeof(u32));
+
+				emit(mov(x86::ecx, scaleBits));
+				emit(movd(x86::xmm1, x86::ecx));
+				emit(mulss(x86::xmm0, x86::xmm1));
+				emit(cvttss2si(x86::ecx, x86::xmm0));
+				emit(mov(x86::dword_ptr(x86::rax, offset), x86::ecx));
 			}
-
-			s_jitIR.push_back(ir);
+			emit(jmp(done));
 		}
+		emit(bind(slow));
+			emitInterpOp(ierr, as, it);
+		emit(bind(done));
+	}
 
-		// Then go back and insert labels.
-		for (s32 lidx = 0; lidx < s_labelCount; lidx++)
+	// Mark the instructions that can be reached by a branch.
+	static void findBranchTargets(const Instruction* func, s32 funcSize, std::vector<u8>& isTarget)
+	{
+		isTarget.assign(funcSize + 2, 0);
+		for (s32 i = 0; i < funcSize; i++)
 		{
-			const s32 target = s_labelTarget[lidx];
-
-			// Start the loop at the target, since it cannot be found any earlier.
-			const size_t count = s_jitIR.size();
-			const IR_Jit* ir = s_jitIR.data() + target;
-			for (size_t i = target; i < count; i++, ir++)
+			const Instruction it = func[i];
+			switch (I_OP(it))
 			{
-				if (ir->index == target)
-				{
-					// insert the label right *before* the target.
-					IR_Jit label = { IRT_LABEL, Instruction(lidx), -1 };
-					s_jitIR.insert(s_jitIR.begin() + i, label);
-					break;
-				}
+				case FSF_OP_JMP: { isTarget[I_ARG0(it)] = 1; } break;
+				case FSF_OP_JZ:
+				case FSF_OP_JNZ: { isTarget[I_ARG1(it)] = 1; } break;
+				case FSF_OP_JL:
+				case FSF_OP_JLE:
+				case FSF_OP_JEQ:
+				case FSF_OP_JNE:
+				case FSF_OP_JFL:
+				case FSF_OP_JFLE: { isTarget[I_ARG2(it)] = 1; } break;
+				case FSF_OP_LT: { isTarget[i + 2] = 1; } break;
 			}
 		}
-				
-		// Then insert each instruction and label.
-		const size_t count = s_jitIR.size();
-		const IR_Jit* ir = s_jitIR.data();
-		for (size_t i = 0; i < count; i++, ir++)
+	}
+
+	ScriptJitFunc jit_compileScriptFunc(const char* funcName, const Instruction* func, s32 funcSize)
+	{
+		Error ierr;
+		CodeHolder code;
+		code.init(s_runtime.environment());
+		x86::Assembler as(&code);
+
+		// Enable strict validation.
+	#ifdef JIT_DEBUG
+		as.addDiagnosticOptions(DiagnosticOptions::kRADebugAll);
+	#endif
+
+		// Save rbx and reserve the shadow space for calls, this also keeps the stack 16 byte aligned.
+		emit(push(FRAME));
+		emit(sub(x86::rsp, 32));
+		emit(mov(FRAME, ARG0_REG));
+
+		// One label per instruction, the extra label is the end of the function.
+		std::vector<Label> labels(funcSize + 1);
+		for (s32 i = 0; i <= funcSize; i++)
 		{
-			if (ir->type == IRT_LABEL)
-			{
-				as.bind(s_labels[ir->it]);
-			}
-			else // IRT_INSTR
-			{
-				switch (I_OP(ir->it))
-				{
-					case FSF_OP_NOP:
-					{
-					} break;
-					case FSF_OP_MOVE:
-					{
-					} break;
-					case FSF_OP_LOAD:
-					{
-						// In x86_64 the only instruction that takes a 64-bit Immediate value is mov reg64, imm
-						// This means that storing 64-bit immediate values into memory takes two instructions.
-						uint64_t imm = fsValue_createInt(I_ARG1(ir->it));
-						emit(mov(x86::dword_ptr(stackPtr, PTR0), imm & 0xffffffffull));
-						emit(mov(x86::dword_ptr(stackPtr, PTR0 + 4), imm >> 32ull));
-					} break;
-					case FSF_OP_INC:
-					{
-						emit(add(x86::dword_ptr(stackPtr, PTR0), 1));
-					} break;
-					case FSF_OP_DEC:
-					{
-						emit(sub(x86::dword_ptr(stackPtr, PTR0), 1));
-					} break;
-					case FSF_OP_IADD:
-					{
-						x86::Mem arg1 = x86::dword_ptr(stackPtr, PTR1);
-						x86::Mem arg2 = x86::dword_ptr(stackPtr, PTR2);
-
-						// Load first argument and add memory value.
-						emit(mov(r0_32, arg1));
-						emit(add(r0_32, arg2));
-
-						// Write the value and type to memory.
-						emit(mov(x86::dword_ptr(stackPtr, PTR0), r0_32));
-						emit(mov(x86::dword_ptr(stackPtr, PTR0 + 4), FST_INT << 16u));
-					} break;
-					case FSF_OP_FADD:
-					{
-						x86::Mem arg1 = x86::dword_ptr(stackPtr, PTR1);
-						x86::Mem arg2 = x86::dword_ptr(stackPtr, PTR2);
-
-						// Load first argument and add memory value.
-						emit(xorps(f0, f0));  // Zero out the floating point register so the upper bits aren't undefined (which can cause problems later).
-						emit(movss(f0, arg1));
-						emit(addss(f0, arg2));
-
-						// Write the value and type to memory.
-						emit(movss(x86::dword_ptr(stackPtr, PTR0), f0));
-						emit(mov(x86::dword_ptr(stackPtr, PTR0 + 4), FST_FLOAT << 16u));
-					} break;
-					case FSF_OP_CAST_TO_FLOAT:
-					{
-						x86::Mem arg1_qw = x86::qword_ptr(stackPtr, PTR1);
-						x86::Mem arg1 = x86::dword_ptr(stackPtr, PTR1);
+			labels[i] = as.newLabel();
+		}
+		Label exitLabel = as.newLabel();
 
-						loadValueType(ierr, as, r0, arg1_qw);		// r0 = type of arg1.
-						dynamicCastToFloat(ierr, as, r0, f0, arg1); // f0 = float(r0)
+		std::vector<u8> isTarget;
+		findBranchTargets(func, funcSize, isTarget);
 
-						// Save the value and type.
-						emit(movss(x86::dword_ptr(stackPtr, PTR0), f0));
-						emit(mov(x86::dword_ptr(stackPtr, PTR0 + 4), FST_FLOAT << 16u));
-					} break;
-					case FSF_OP_CAST_TO_INT:
-					{
-						// TODO
-					} break;
-					case FSF_OP_ADD:
+		for (s32 i = 0; i < funcSize; i++)
+		{
+			emit(bind(labels[i]));
+
+			const Instruction it = func[i];
+			const u32 a = u32(I_ARG0(it));
+			const u32 b = u32(I_ARG1(it));
+			const u32 c = u32(I_ARG2(it));
+			switch (I_OP(it))
+			{
+				case FSF_OP_NOP:
+				{
+				} break;
+				case FSF_OP_MOVE:
+				{
+					emit(mov(x86::rax, REG_QW(b)));
+					emit(mov(REG_QW(a), x86::rax));
+				} break;
+				case FSF_OP_LOAD:
+				{
+					storeImm(ierr, as, a, fsValue_createInt(s32(u32(I_ARG12(it)))));
+				} break;
+				case FSF_OP_LOADF:
+				{
+					const u32 bits = u32(I_ARG12(it));
+					f32 value;
+					memcpy(&value, &bits, sizeof(f32));
+					storeImm(ierr, as, a, fsValue_createFloat(value));
+				} break;
+				case FSF_OP_LOADNULL:
+				{
+					emit(mov(REG_QW(a), 0));
+				} break;
+				case FSF_OP_INC:
+				{
+					emit(add(REG_DW(a), 1));
+				} break;
+				case FSF_OP_DEC:
+				{
+					emit(sub(REG_DW(a), 1));
+				} break;
+				case FSF_OP_IADD:
+				case FSF_OP_ISUB:
+				case FSF_OP_IMUL:
+				case FSF_OP_IAND:
+				case FSF_OP_IOR:
+				case FSF_OP_IXOR:
+				{
+					emit(mov(x86::eax, REG_DW(b)));
+					switch (I_OP(it))
 					{
-						// TODO
-					} break;
-					case FSF_OP_LT:
+						case FSF_OP_IADD: { emit(add(x86::eax, REG_DW(c))); } break;
+						case FSF_OP_ISUB: { emit(sub(x86::eax, REG_DW(c))); } break;
+						case FSF_OP_IMUL: { emit(imul(x86::eax, REG_DW(c))); } break;
+						case FSF_OP_IAND: { emit(and_(x86::eax, REG_DW(c))); } break;
+						case FSF_OP_IOR:  { emit(or_(x86::eax, REG_DW(c))); } break;
+						case FSF_OP_IXOR: { emit(xor_(x86::eax, REG_DW(c))); } break;
+					}
+					storeInt(ierr, as, a, x86::eax);
+				} break;
+				case FSF_OP_ISHL:
+				case FSF_OP_ISHR:
+				{
+					// x86 masks 32-bit shift counts to 5 bits, matching the interpreter.
+					emit(mov(x86::ecx, REG_DW(c)));
+					emit(mov(x86::eax, REG_DW(b)));
+					if (I_OP(it) == FSF_OP_ISHL) { emit(shl(x86::eax, x86::cl)); }
+					else { emit(sar(x86::eax, x86::cl)); }
+					storeInt(ierr, as, a, x86::eax);
+				} break;
+				case FSF_OP_INEG:
+				{
+					emit(mov(x86::eax, REG_DW(b)));
+					emit(neg(x86::eax));
+					storeInt(ierr, as, a, x86::eax);
+				} break;
+				case FSF_OP_FADD:
+				case FSF_OP_FSUB:
+				case FSF_OP_FMUL:
+				case FSF_OP_FDIV:
+				{
+					emit(movss(x86::xmm0, REG_DW(b)));
+					switch (I_OP(it))
 					{
-						// If the next instruction is a jump, combine them here.
-						if ((ir + 1)->type == IRT_INSTR && I_OP((ir + 1)->it) == FSF_OP_JMP)
-						{
-							// Test here.
-							emit(mov(r0_32, x86::dword_ptr(stackPtr, PTR0)));
-							emit(cmp(r0_32, x86::dword_ptr(stackPtr, PTR1)));
-							emit(jl(s_labels[I_ARG0((ir+1)->it)]));
-
-							// Skip past the next instruction.
-							i++;
-							ir++;
-						}
-					} break;
-					case FSF_OP_JMP:
+						case FSF_OP_FADD: { emit(addss(x86::xmm0, REG_DW(c))); } break;
+						case FSF_OP_FSUB: { emit(subss(x86::xmm0, REG_DW(c))); } break;
+						case FSF_OP_FMUL: { emit(mulss(x86::xmm0, REG_DW(c))); } break;
+						case FSF_OP_FDIV: { emit(divss(x86::xmm0, REG_DW(c))); } break;
+					}
+					storeFloat(ierr, as, a, x86::xmm0);
+				} break;
+				case FSF_OP_FNEG:
+				{
+					emit(mov(x86::eax, REG_DW(b)));
+					emit(xor_(x86::eax, 0x80000000u));
+					emit(mov(REG_DW(a), x86::eax));
+					emit(mov(REG_TYPE(a), TYPE_HI(FST_FLOAT)));
+				} break;
+				case FSF_OP_IEQ:
+				case FSF_OP_INE:
+				case FSF_OP_ILT:
+				case FSF_OP_ILE:
+				{
+					intCompare(ierr, as, u32(I_OP(it)), a, b, c);
+				} break;
+				case FSF_OP_FEQ:
+				case FSF_OP_FNE:
+				case FSF_OP_FLT:
+				case FSF_OP_FLE:
+				{
+					floatCompare(ierr, as, u32(I_OP(it)), a, b, c);
+				} break;
+				case FSF_OP_CAST_TO_FLOAT:
+				{
+					castToFloat(ierr, as, it);
+				} break;
+				case FSF_OP_LT:
+				{
+					emit(mov(x86::eax, REG_DW(a)));
+					emit(cmp(x86::eax, REG_DW(b)));
+					// If the next instruction is a jump that nothing else branches to, combine them here.
+					if (I_OP(func[i + 1]) == FSF_OP_JMP && !isTarget[i + 1])
 					{
-						emit(jmp(s_labels[I_ARG0(ir->it)]));
-					} break;
-					case FSF_OP_JL:
+						emit(jl(labels[I_ARG0(func[i + 1])]));
+						// Skip past the next instruction.
+						i++;
+						emit(bind(labels[i]));
+					}
+					else
 					{
-					} break;
-					case FSF_OP_RET:
+						emit(jge(labels[i + 2]));
+					}
+				} break;
+				case FSF_OP_JMP:
+				{
+					emit(jmp(labels[a]));
+				} break;
+				case FSF_OP_JZ:
+				case FSF_OP_JNZ:
+				{
+					emit(cmp(REG_DW(a), 0));
+					if (I_OP(it) == FSF_OP_JZ) { emit(je(labels[b])); }
+					else { emit(jne(labels[b])); }
+				} break;
+				case FSF_OP_JL:
+				case FSF_OP_JLE:
+				case FSF_OP_JEQ:
+				case FSF_OP_JNE:
+				{
+					emit(mov(x86::eax, REG_DW(a)));
+					emit(cmp(x86::eax, REG_DW(b)));
+					switch (I_OP(it))
 					{
-						x86::Mem arg0 = x86::qword_ptr(stackPtr, PTR0);
-						emit(mov(retValue, arg0));
-						emit(jmp(exitLabel));
-					} break;
+						case FSF_OP_JL:  { emit(jl(labels[c])); } break;
+						case FSF_OP_JLE: { emit(jle(labels[c])); } break;
+						case FSF_OP_JEQ: { emit(je(labels[c])); } break;
+						case FSF_OP_JNE: { emit(jne(labels[c])); } break;
+					}
+				} break;
+				case FSF_OP_JFL:
+				case FSF_OP_JFLE:
+				{
+					// a < b is tested as b > a so that unordered results don't branch.
+					emit(movss(x86::xmm0, REG_DW(b)));
+					emit(ucomiss(x86::xmm0, REG_DW(a)));
+					if (I_OP(it) == FSF_OP_JFL) { emit(ja(labels[c])); }
+					else { emit(jae(labels[c])); }
+				} break;
+				case FSF_OP_GETF:
+				{
+					getField(ierr, as, it);
+				} break;
+				case FSF_OP_SETF:
+				{
+					setField(ierr, as, it);
+				} break;
+				case FSF_OP_CALL:
+				{
+					// Call the VM directly so compiled callees don't go through the interpreter.
+					emit(mov(ARG0_REG.r32(), b));
+					emit(lea(ARG1_REG, REG_QW(c)));
+					emit(mov(x86::rax, u64(uintptr_t(vm_callFunction))));
+					emit(call(x86::rax));
+					emit(mov(REG_QW(a), x86::rax));
+				} break;
+				case FSF_OP_CAST_TO_INT:
+				case FSF_OP_ADD:
+				case FSF_OP_IDIV:
+				case FSF_OP_IMOD:
+				case FSF_OP_CALLN:
+				{
+					emitInterpOp(ierr, as, it);
+				} break;
+				case FSF_OP_RET:
+				{
+					emit(mov(x86::rax, REG_QW(a)));
+					emit(jmp(exitLabel));
+				} break;
+				case FSF_OP_RETNULL:
+				{
+					emit(xor_(x86::eax, x86::eax));
+					emit(jmp(exitLabel));
+				} break;
+				default:
+				{
+					// Unknown opcode, the function will run in the interpreter.
+					return nullptr;
 				}
 			}
 		}
 
+		// Falling off the end of the function returns null.
+		emit(bind(labels[funcSize]));
+		emit(xor_(x86::eax, x86::eax));
+
 		emit(bind(exitLabel));
-		// Restore the temporary registers.
-		emit(pop(r1));
-		emit(pop(r0));
+		emit(add(x86::rsp, 32));
+		emit(pop(FRAME));
 		// Return from our function.
 		emit(ret());
 
@@ -322,5 +608,6 @@ namespace TFE_ForceScript
 		s_jitFuncList.push_back(fn);
 		return fn;
 	}
+#endif
 }
-#endif
\ No newline at end of file
+#endif
@@ -1,5 +1,10 @@
 #pragma once
 //////////////////////////////////////////////////////////////////////
+// ForceScript JIT
+// Compiles verified bytecode to x64 machine code. Simple opcodes are
+// generated inline, the rest call back into the interpreter.
+// Compilation fails on other architectures and the interpreter is
+// used instead.
 //////////////////////////////////////////////////////////////////////
 #include "vmConfig.h"
 
@@ -16,6 +21,6 @@ namespace TFE_ForceScript
 	void jit_destroy();
 
 	ScriptJitFunc jit_getScriptFunc(const char* funcName);
-	ScriptJitFunc jit_compileScriptFunc(const char* funcName, Instruction* func, s32 funcSize);
+	ScriptJitFunc jit_compileScriptFunc(const char* funcName, const Instruction* func, s32 funcSize);
 }
-#endif
\ No newline at end of file
+#endif
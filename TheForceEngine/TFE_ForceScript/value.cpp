@@ -1,6 +1,8 @@
 #include "value.h"
 
 #ifdef VM_ENABLE
+#include <stdio.h>
+#include <string.h>
 namespace TFE_ForceScript
 {
 	void fsValue_toString(FsValue value, char* outStr)
@@ -16,6 +18,14 @@ namespace TFE_ForceScript
 			{
 				sprintf(outStr, "%f", *fsValue_getFloatPtr(value));
 			} break;
+			case FST_STRUCT:
+			{
+				sprintf(outStr, "ref 0x%llx", (unsigned long long)(value & FS_ValueMask));
+			} break;
+			default:
+			{
+				strcpy(outStr, "null");
+			}
 		}
 	}
 }
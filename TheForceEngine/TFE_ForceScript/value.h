@@ -51,6 +51,7 @@ namespace TFE_ForceScript
 
 	#define FS_TypeDataShift 48ull
 	#define FS_TypeModShift  52ull
+	#define FS_FlagsShift    56ull
 	#define FS_TypeMask 15ull
 	#define FS_ValueMask ((1ull << 48ull) - 1ull)
 
@@ -61,6 +62,8 @@ namespace TFE_ForceScript
 	#define fsValue_getValueData(v) (v>>FS_TypeDataShift)
 	#define fsValue_getType(v) FS_Type((v>>FS_TypeDataShift) & FS_TypeMask)
 	#define fsValue_getTypeMod(v) u32((v>>FS_TypeModShift) & FS_TypeMask)
+	#define fsValue_getFlags(v) u32(v>>FS_FlagsShift)
+	#define fsValue_isRef(v) ((fsValue_getFlags(v) & FSF_REF) != 0)
 	
 	inline FsValue fsValue_createNull()
 	{
@@ -79,6 +82,14 @@ namespace TFE_ForceScript
 		return u64(*((u32*)&f)) | (valueData << FS_TypeDataShift);
 	}
 
+	// Reference to an engine object, fields are accessed with the GETF and SETF opcodes.
+	inline FsValue fsValue_createRef(void* ptr)
+	{
+		u64 valueData = FST_STRUCT;
+		u64 flags = FSF_REF;
+		return (u64(ptr) & FS_ValueMask) | (valueData << FS_TypeDataShift) | (flags << FS_FlagsShift);
+	}
+
 	inline s32 fsValue_readAsInt(const FsValue* const v)
 	{
 		const FS_Type type = fsValue_getType(*v);
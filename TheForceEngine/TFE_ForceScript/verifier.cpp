@@ -0,0 +1,432 @@
+#include "verifier.h"
+
+#ifdef VM_ENABLE
+#include <stdio.h>
+#include <vector>
+
+namespace TFE_ForceScript
+{
+	enum OperandKind : u8
+	{
+		OPND_NONE = 0,
+		OPND_REG,		// Register index.
+		OPND_IMM,		// 32-bit immediate stored in Arg1 and Arg2.
+		OPND_TARGET,	// Instruction index.
+		OPND_FUNC,		// Script function index.
+		OPND_NATIVE,	// Native function index.
+		OPND_FIELD,		// Field index.
+	};
+
+	// Value types tracked by the verifier.
+	enum VerifyType : u8
+	{
+		VT_UNSET = 0,	// Not reached yet.
+		VT_NULL,
+		VT_INT,
+		VT_FLOAT,
+		VT_REF,
+		VT_ANY,			// Only known at runtime.
+	};
+
+	struct OpInfo
+	{
+		OperandKind arg[3];
+	};
+
+	static const OpInfo c_opInfo[] =
+	{
+		{ OPND_NONE,   OPND_NONE,   OPND_NONE },	// NOP
+		{ OPND_REG,    OPND_REG,    OPND_NONE },	// MOVE
+		{ OPND_REG,    OPND_IMM,    OPND_NONE },	// LOAD
+		{ OPND_REG,    OPND_NONE,   OPND_NONE },	// INC
+		{ OPND_REG,    OPND_NONE,   OPND_NONE },	// DEC
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IADD
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FADD
+		{ OPND_REG,    OPND_REG,    OPND_NONE },	// CAST_TO_FLOAT
+		{ OPND_REG,    OPND_REG,    OPND_NONE },	// CAST_TO_INT
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// ADD
+		{ OPND_REG,    OPND_REG,    OPND_NONE },	// LT
+		{ OPND_TARGET, OPND_NONE,   OPND_NONE },	// JMP
+		{ OPND_REG,    OPND_REG,    OPND_TARGET },	// JL
+		{ OPND_REG,    OPND_NONE,   OPND_NONE },	// RET
+		{ OPND_REG,    OPND_IMM,    OPND_NONE },	// LOADF
+		{ OPND_REG,    OPND_NONE,   OPND_NONE },	// LOADNULL
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// ISUB
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IMUL
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IDIV
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IMOD
+		{ OPND_REG,    OPND_REG,    OPND_NONE },	// INEG
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IAND
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IOR
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IXOR
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// ISHL
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// ISHR
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FSUB
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FMUL
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FDIV
+		{ OPND_REG,    OPND_REG,    OPND_NONE },	// FNEG
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// IEQ
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// INE
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// ILT
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// ILE
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FEQ
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FNE
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FLT
+		{ OPND_REG,    OPND_REG,    OPND_REG },		// FLE
+		{ OPND_REG,    OPND_TARGET, OPND_NONE },	// JZ
+		{ OPND_REG,    OPND_TARGET, OPND_NONE },	// JNZ
+		{ OPND_REG,    OPND_REG,    OPND_TARGET },	// JLE
+		{ OPND_REG,    OPND_REG,    OPND_TARGET },	// JEQ
+		{ OPND_REG,    OPND_REG,    OPND_TARGET },	// JNE
+		{ OPND_REG,    OPND_REG,    OPND_TARGET },	// JFL
+		{ OPND_REG,    OPND_REG,    OPND_TARGET },	// JFLE
+		{ OPND_REG,    OPND_FUNC,   OPND_REG },		// CALL
+		{ OPND_REG,    OPND_NATIVE, OPND_REG },		// CALLN
+		{ OPND_REG,    OPND_REG,    OPND_FIELD },	// GETF
+		{ OPND_REG,    OPND_FIELD,  OPND_REG },		// SETF
+		{ OPND_NONE,   OPND_NONE,   OPND_NONE },	// RETNULL
+	};
+	static_assert(sizeof(c_opInfo) / sizeof(c_opInfo[0]) == FSF_OP_COUNT, "Verifier opcode table does not match the OpCode enum.");
+
+	static const char* c_typeName[] = { "unset", "null", "int", "float", "ref", "any" };
+
+	static VerifyType mergeType(VerifyType a, VerifyType b)
+	{
+		if (a == VT_UNSET) { return b; }
+		if (b == VT_UNSET || a == b) { return a; }
+		return VT_ANY;
+	}
+
+	static u32 getArg(Instruction it, s32 index)
+	{
+		return index == 0 ? u32(I_ARG0(it)) : (index == 1 ? u32(I_ARG1(it)) : u32(I_ARG2(it)));
+	}
+
+	static bool isConditionalBranch(u32 op)
+	{
+		return op == FSF_OP_JL || op == FSF_OP_JZ || op == FSF_OP_JNZ || op == FSF_OP_JLE || op == FSF_OP_JEQ ||
+			op == FSF_OP_JNE || op == FSF_OP_JFL || op == FSF_OP_JFLE;
+	}
+
+	// Check operand ranges, this doesn't depend on the values so it is done once per instruction.
+	static bool verifyOperands(const Instruction* code, s32 codeSize, s32 argCount, s32 regCount, s32 funcIndex, char* error, size_t errorSize)
+	{
+		for (s32 i = 0; i < codeSize; i++)
+		{
+			const Instruction it = code[i];
+			const u32 op = u32(I_OP(it));
+			if (op >= FSF_OP_COUNT)
+			{
+				snprintf(error, errorSize, "[%d] invalid opcode %u", i, op);
+				return false;
+			}
+
+			const OpInfo* info = &c_opInfo[op];
+			for (s32 a = 0; a < 3; a++)
+			{
+				const u32 value = getArg(it, a);
+				switch (info->arg[a])
+				{
+					case OPND_REG:
+					{
+						if (value >= u32(regCount))
+						{
+							snprintf(error, errorSize, "[%d] register r%u out of range", i, value);
+							return false;
+						}
+					} break;
+					case OPND_TARGET:
+					{
+						if (value >= u32(codeSize))
+						{
+							snprintf(error, errorSize, "[%d] jump target %u out of range", i, value);
+							return false;
+						}
+					} break;
+					case OPND_FUNC:
+					{
+						if (value > u32(funcIndex))
+						{
+							snprintf(error, errorSize, "[%d] invalid function %u", i, value);
+							return false;
+						}
+					} break;
+					case OPND_NATIVE:
+					{
+						if (value >= u32(vm_getNativeCount()))
+						{
+							snprintf(error, errorSize, "[%d] invalid native function %u", i, value);
+							return false;
+						}
+					} break;
+					case OPND_FIELD:
+					{
+						if (value >= u32(vm_getFieldCount()))
+						{
+							snprintf(error, errorSize, "[%d] invalid field %u", i, value);
+							return false;
+						}
+					} break;
+					// Unused operands and immediates have no range to check.
+					default: break;
+				}
+			}
+
+			// Calls place the arguments in consecutive registers, they must all be valid.
+			if (op == FSF_OP_CALL || op == FSF_OP_CALLN)
+			{
+				const u32 target = u32(I_ARG1(it));
+				const s32 calleeArgs = op == FSF_OP_CALLN ? s_natives[target].argCount :
+					(s32(target) == funcIndex ? argCount : vm_getFunctionArgCount(s32(target)));
+				if (I_ARG2(it) + calleeArgs > u64(regCount))
+				{
+					snprintf(error, errorSize, "[%d] call arguments r%u..r%u out of range", i, u32(I_ARG2(it)), u32(I_ARG2(it)) + calleeArgs - 1);
+					return false;
+				}
+			}
+			else if (op == FSF_OP_LT && i + 1 >= codeSize)
+			{
+				snprintf(error, errorSize, "[%d] LT cannot be the last instruction", i);
+				return false;
+			}
+			else if ((op == FSF_OP_LOAD || op == FSF_OP_LOADF) && I_ARG12(it) > 0xffffffffull)
+			{
+				snprintf(error, errorSize, "[%d] immediate value out of range", i);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	struct TypeState
+	{
+		const Instruction* code;
+		s32 regCount;
+		VerifyType* regs;
+		char* error;
+		size_t errorSize;
+		s32 ip;
+	};
+
+	static bool requireType(TypeState* state, u32 reg, VerifyType type)
+	{
+		const VerifyType actual = state->regs[reg];
+		if (actual != type && actual != VT_ANY)
+		{
+			snprintf(state->error, state->errorSize, "[%d] r%u is %s, expected %s", state->ip, reg, c_typeName[actual], c_typeName[type]);
+			return false;
+		}
+		return true;
+	}
+
+	// Apply the instruction at 'state->ip' to the register types.
+	static bool applyTypes(TypeState* state)
+	{
+		const Instruction it = state->code[state->ip];
+		const u32 op = u32(I_OP(it));
+		const u32 a = u32(I_ARG0(it));
+		const u32 b = u32(I_ARG1(it));
+		const u32 c = u32(I_ARG2(it));
+		VerifyType* regs = state->regs;
+
+		switch (op)
+		{
+			case FSF_OP_MOVE:     { regs[a] = regs[b]; } break;
+			case FSF_OP_LOAD:     { regs[a] = VT_INT; } break;
+			case FSF_OP_LOADF:    { regs[a] = VT_FLOAT; } break;
+			case FSF_OP_LOADNULL: { regs[a] = VT_NULL; } break;
+			case FSF_OP_INC:
+			case FSF_OP_DEC:
+			{
+				if (!requireType(state, a, VT_INT)) { return false; }
+				regs[a] = VT_INT;
+			} break;
+			case FSF_OP_IADD:
+			case FSF_OP_ISUB:
+			case FSF_OP_IMUL:
+			case FSF_OP_IDIV:
+			case FSF_OP_IMOD:
+			case FSF_OP_IAND:
+			case FSF_OP_IOR:
+			case FSF_OP_IXOR:
+			case FSF_OP_ISHL:
+			case FSF_OP_ISHR:
+			case FSF_OP_IEQ:
+			case FSF_OP_INE:
+			case FSF_OP_ILT:
+			case FSF_OP_ILE:
+			{
+				if (!requireType(state, b, VT_INT) || !requireType(state, c, VT_INT)) { return false; }
+				regs[a] = VT_INT;
+			} break;
+			case FSF_OP_INEG:
+			{
+				if (!requireType(state, b, VT_INT)) { return false; }
+				regs[a] = VT_INT;
+			} break;
+			case FSF_OP_FADD:
+			case FSF_OP_FSUB:
+			case FSF_OP_FMUL:
+			case FSF_OP_FDIV:
+			{
+				if (!requireType(state, b, VT_FLOAT) || !requireType(state, c, VT_FLOAT)) { return false; }
+				regs[a] = VT_FLOAT;
+			} break;
+			case FSF_OP_FNEG:
+			{
+				if (!requireType(state, b, VT_FLOAT)) { return false; }
+				regs[a] = VT_FLOAT;
+			} break;
+			case FSF_OP_FEQ:
+			case FSF_OP_FNE:
+			case FSF_OP_FLT:
+			case FSF_OP_FLE:
+			{
+				if (!requireType(state, b, VT_FLOAT) || !requireType(state, c, VT_FLOAT)) { return false; }
+				regs[a] = VT_INT;
+			} break;
+			case FSF_OP_CAST_TO_FLOAT: { regs[a] = VT_FLOAT; } break;
+			case FSF_OP_CAST_TO_INT:   { regs[a] = VT_INT; } break;
+			case FSF_OP_ADD:
+			{
+				const VerifyType tb = regs[b], tc = regs[c];
+				if (tb == VT_INT && tc == VT_INT) { regs[a] = VT_INT; }
+				else if (tb == VT_ANY || tc == VT_ANY) { regs[a] = VT_ANY; }
+				else { regs[a] = VT_FLOAT; }
+			} break;
+			case FSF_OP_LT:
+			case FSF_OP_JL:
+			case FSF_OP_JLE:
+			case FSF_OP_JEQ:
+			case FSF_OP_JNE:
+			{
+				if (!requireType(state, a, VT_INT) || !requireType(state, b, VT_INT)) { return false; }
+			} break;
+			case FSF_OP_JFL:
+			case FSF_OP_JFLE:
+			{
+				if (!requireType(state, a, VT_FLOAT) || !requireType(state, b, VT_FLOAT)) { return false; }
+			} break;
+			case FSF_OP_JZ:
+			case FSF_OP_JNZ:
+			{
+				if (!requireType(state, a, VT_INT)) { return false; }
+			} break;
+			case FSF_OP_CALL:
+			case FSF_OP_CALLN:
+			{
+				// The callee frame starts at the base register, so everything from there on is overwritten.
+				for (s32 r = s32(c); r < state->regCount; r++)
+				{
+					regs[r] = VT_ANY;
+				}
+				regs[a] = VT_ANY;
+			} break;
+			case FSF_OP_GETF:
+			{
+				// Fields read from something other than a reference are null.
+				if (regs[b] == VT_REF)
+				{
+					regs[a] = s_fields[c].type == FS_FIELD_INT ? VT_INT : VT_FLOAT;
+				}
+				else
+				{
+					regs[a] = regs[b] == VT_ANY ? VT_ANY : VT_NULL;
+				}
+			} break;
+		}
+		return true;
+	}
+
+	bool vm_verifyFunction(const Instruction* code, s32 codeSize, s32 argCount, s32 regCount, s32 funcIndex, char* error, size_t errorSize)
+	{
+		if (!verifyOperands(code, codeSize, argCount, regCount, funcIndex, error, errorSize))
+		{
+			return false;
+		}
+
+		// Propagate the register types through the control flow graph until nothing changes.
+		// Types only move towards VT_ANY when merged, so this terminates.
+		std::vector<VerifyType> types(size_t(codeSize) * size_t(regCount), VT_UNSET);
+		std::vector<VerifyType> regs(regCount);
+		std::vector<s32> worklist;
+		std::vector<u8> queued(codeSize, 0);
+		std::vector<u8> visited(codeSize, 0);
+
+		// The arguments can be anything, other registers start as null.
+		for (s32 r = 0; r < regCount; r++)
+		{
+			types[r] = r < argCount ? VT_ANY : VT_NULL;
+		}
+		worklist.push_back(0);
+		queued[0] = 1;
+		visited[0] = 1;
+
+		TypeState state = { code, regCount, regs.data(), error, errorSize, 0 };
+		while (!worklist.empty())
+		{
+			const s32 ip = worklist.back();
+			worklist.pop_back();
+			queued[ip] = 0;
+
+			VerifyType* inTypes = &types[size_t(ip) * size_t(regCount)];
+			for (s32 r = 0; r < regCount; r++) { regs[r] = inTypes[r]; }
+
+			state.ip = ip;
+			if (!applyTypes(&state))
+			{
+				return false;
+			}
+
+			// Find the successors, falling off the end of the function returns null.
+			const Instruction it = code[ip];
+			const u32 op = u32(I_OP(it));
+			s32 next[2];
+			s32 nextCount = 0;
+			if (op == FSF_OP_RET || op == FSF_OP_RETNULL)
+			{
+			}
+			else if (op == FSF_OP_JMP)
+			{
+				next[nextCount++] = s32(I_ARG0(it));
+			}
+			else if (op == FSF_OP_LT)
+			{
+				next[nextCount++] = ip + 1;
+				next[nextCount++] = ip + 2;
+			}
+			else if (isConditionalBranch(op))
+			{
+				next[nextCount++] = ip + 1;
+				next[nextCount++] = s32(c_opInfo[op].arg[1] == OPND_TARGET ? I_ARG1(it) : I_ARG2(it));
+			}
+			else
+			{
+				next[nextCount++] = ip + 1;
+			}
+
+			for (s32 n = 0; n < nextCount; n++)
+			{
+				const s32 target = next[n];
+				if (target >= codeSize) { continue; }
+
+				VerifyType* targetTypes = &types[size_t(target) * size_t(regCount)];
+				bool changed = !visited[target];
+				visited[target] = 1;
+				for (s32 r = 0; r < regCount; r++)
+				{
+					const VerifyType merged = mergeType(targetTypes[r], regs[r]);
+					changed |= merged != targetTypes[r];
+					targetTypes[r] = merged;
+				}
+				if (changed && !queued[target])
+				{
+					worklist.push_back(target);
+					queued[target] = 1;
+				}
+			}
+		}
+		return true;
+	}
+}
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// ForceScript Bytecode Verifier
+// Checks bytecode before it is added to the VM so the interpreter
+// and JIT can run it without bounds or type checks:
+// * Opcodes, registers, jump targets and function, native and field
+//   indices are in range.
+// * Calls pass the correct number of arguments.
+// * Typed opcodes are never given values known to be a different
+//   type. Values that are only known at runtime (arguments, call
+//   results, fields) are allowed.
+//////////////////////////////////////////////////////////////////////
+#include "vmConfig.h"
+
+#ifdef VM_ENABLE
+#include <TFE_System/types.h>
+#include "vmOps.h"
+
+namespace TFE_ForceScript
+{
+	// 'funcIndex' is the index the function will have once added, so it can call itself.
+	// Returns false and writes the reason to 'error' if the bytecode is invalid.
+	bool vm_verifyFunction(const Instruction* code, s32 codeSize, s32 argCount, s32 regCount, s32 funcIndex, char* error, size_t errorSize);
+}
+#endif
@@ -2,20 +2,40 @@
 
 #ifdef VM_ENABLE
 #include <TFE_System/system.h>
+#include <TFE_System/profiler.h>
 #include "vm.h"
 #include "vmOps.h"
 #include "value.h"
+#include "verifier.h"
 #include "jit.h"
 #include <assert.h>
+#include <string>
+#include <vector>
 
 namespace TFE_ForceScript
 {
+	#define FS_STACK_SIZE 65536
+	#define FS_MAX_CALL_DEPTH 256
+	#define FS_DEFAULT_JIT_THRESHOLD 64
+
 	struct IRCode
 	{
 		vmCall func;
 		Instruction instr;
 	};
-	IRCode s_funcOpt[256];
+
+	struct FsFunction
+	{
+		std::string name;
+		std::vector<Instruction> code;
+		std::vector<IRCode> ir;
+		s32 argCount;
+		s32 regCount;
+
+		u32 callCount;
+		ScriptJitFunc jit;
+		bool jitFailed;
+	};
 
 	FsValue* s_stackPtr;
 	Instruction* s_func;
@@ -24,30 +44,240 @@ namespace TFE_ForceScript
 	s32 s_funcSize;
 	FsValue s_retValue;
 
+	FsNative    s_natives[FS_MAX_NATIVES];
+	FsFieldInfo s_fields[FS_MAX_FIELDS];
+
+	static std::vector<FsFunction>  s_functions;
+	static std::vector<std::string> s_nativeNames;
+	static std::vector<std::string> s_fieldNames;
+
+	static FsValue  s_stack[FS_STACK_SIZE];
+	static FsValue* s_stackTop = s_stack;
+	static s32 s_callDepth = 0;
+
+	static u32  s_jitThreshold = FS_DEFAULT_JIT_THRESHOLD;
+	static bool s_jitEnabled = true;
+
 	bool init()
 	{
-		return false;
+		s_functions.clear();
+		s_nativeNames.clear();
+		s_fieldNames.clear();
+		s_stackTop = s_stack;
+		s_callDepth = 0;
+
+	#ifdef VM_JIT_ENABLE
+		jit_init();
+	#endif
+		return true;
 	}
 
 	void destroy()
 	{
+	#ifdef VM_JIT_ENABLE
+		jit_destroy();
+	#endif
+		s_functions.clear();
+		s_nativeNames.clear();
+		s_fieldNames.clear();
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Engine bindings
+	//////////////////////////////////////////////////////////////////////
+	s32 vm_findNative(const char* name)
+	{
+		const s32 count = (s32)s_nativeNames.size();
+		for (s32 i = 0; i < count; i++)
+		{
+			if (s_nativeNames[i] == name) { return i; }
+		}
+		return -1;
+	}
+
+	s32 vm_registerNative(const char* name, FsNativeFunc func, s32 argCount)
+	{
+		if (!name || !func || argCount < 0) { return -1; }
+
+		// Re-registering a native replaces the function, so existing bytecode stays valid.
+		s32 index = vm_findNative(name);
+		if (index < 0)
+		{
+			if (s_nativeNames.size() >= FS_MAX_NATIVES)
+			{
+				TFE_System::logWrite(LOG_ERROR, "ForceScript", "Too many native functions, cannot register '%s'.", name);
+				return -1;
+			}
+			index = (s32)s_nativeNames.size();
+			s_nativeNames.push_back(name);
+		}
+		else if (s_natives[index].argCount != argCount)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Native function '%s' is already registered with a different argument count.", name);
+			return -1;
+		}
+		s_natives[index] = { func, argCount };
+		return index;
+	}
+
+	s32 vm_findField(const char* typeName, const char* fieldName)
+	{
+		const std::string name = std::string(typeName) + "." + fieldName;
+		const s32 count = (s32)s_fieldNames.size();
+		for (s32 i = 0; i < count; i++)
+		{
+			if (s_fieldNames[i] == name) { return i; }
+		}
+		return -1;
+	}
+
+	s32 vm_registerField(const char* typeName, const char* fieldName, u32 offset, FsFieldType type)
+	{
+		if (!typeName || !fieldName || type >= FS_FIELD_COUNT) { return -1; }
+
+		s32 index = vm_findField(typeName, fieldName);
+		if (index < 0)
+		{
+			if (s_fieldNames.size() >= FS_MAX_FIELDS)
+			{
+				TFE_System::logWrite(LOG_ERROR, "ForceScript", "Too many fields, cannot register '%s.%s'.", typeName, fieldName);
+				return -1;
+			}
+			index = (s32)s_fieldNames.size();
+			s_fieldNames.push_back(std::string(typeName) + "." + fieldName);
+		}
+		else if (s_fields[index].offset != offset || s_fields[index].type != type)
+		{
+			// Compiled code has the field layout baked in, so it cannot change.
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Field '%s.%s' is already registered with a different layout.", typeName, fieldName);
+			return -1;
+		}
+		s_fields[index] = { offset, type };
+		return index;
+	}
+
+	s32 vm_getNativeCount()
+	{
+		return (s32)s_nativeNames.size();
+	}
+
+	s32 vm_getFieldCount()
+	{
+		return (s32)s_fieldNames.size();
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Functions
+	//////////////////////////////////////////////////////////////////////
+	s32 vm_getFunctionCount()
+	{
+		return (s32)s_functions.size();
+	}
+
+	s32 vm_getFunctionArgCount(s32 funcIndex)
+	{
+		return s_functions[funcIndex].argCount;
+	}
+
+	s32 vm_findFunction(const char* name)
+	{
+		const s32 count = (s32)s_functions.size();
+		for (s32 i = 0; i < count; i++)
+		{
+			if (s_functions[i].name == name) { return i; }
+		}
+		return -1;
+	}
+
+	s32 vm_addFunction(const char* name, const u64* code, s32 codeSize, s32 argCount, s32 regCount)
+	{
+		if (!name || !code || codeSize <= 0 || argCount < 0 || regCount < argCount || regCount > FS_STACK_SIZE)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Invalid function '%s'.", name ? name : "");
+			return -1;
+		}
+		if (vm_findFunction(name) >= 0)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Function '%s' already exists.", name);
+			return -1;
+		}
+
+		// The function may call itself, so the verifier needs to know its index.
+		const s32 index = (s32)s_functions.size();
+		char error[256];
+		if (!vm_verifyFunction(code, codeSize, argCount, regCount, index, error, sizeof(error)))
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Function '%s' failed verification: %s", name, error);
+			return -1;
+		}
+
+		s_functions.push_back({});
+		FsFunction* func = &s_functions.back();
+		func->name = name;
+		func->code.assign(code, code + codeSize);
+		func->argCount = argCount;
+		func->regCount = regCount;
+		func->callCount = 0;
+		func->jit = nullptr;
+		func->jitFailed = false;
+
+		// Resolve the op handlers up front so the interpreter loop doesn't have to.
+		func->ir.resize(codeSize);
+		for (s32 i = 0; i < codeSize; i++)
+		{
+			func->ir[i].func  = s_vmOpCalls[I_OP(code[i])];
+			func->ir[i].instr = code[i];
+		}
+		return index;
+	}
+
+	void vm_setJitThreshold(u32 callCount)
+	{
+		s_jitThreshold = callCount;
+	}
+
+	void vm_enableJit(bool enable)
+	{
+		s_jitEnabled = enable;
 	}
-		
-	void optimizeFunc(Instruction* func, s32 funcSize)
+
+	bool vm_compileFunction(s32 funcIndex)
 	{
-		for (s32 i = 0; i < funcSize; i++)
+		if (funcIndex < 0 || funcIndex >= (s32)s_functions.size()) { return false; }
+		FsFunction* func = &s_functions[funcIndex];
+
+	#ifdef VM_JIT_ENABLE
+		if (!func->jit && !func->jitFailed)
 		{
-			s_funcOpt[i].func  = s_vmOpCalls[I_OP(func[i])];
-			s_funcOpt[i].instr = func[i];
+			TFE_ZONE("ForceScript JIT");
+			func->jit = jit_compileScriptFunc(func->name.c_str(), func->code.data(), (s32)func->code.size());
+			// Don't keep trying to compile functions the JIT cannot handle.
+			func->jitFailed = !func->jit;
+			if (func->jitFailed)
+			{
+				TFE_System::logWrite(LOG_WARNING, "ForceScript", "Cannot compile function '%s', it will run in the interpreter.", func->name.c_str());
+			}
 		}
+		return func->jit != nullptr;
+	#else
+		return false;
+	#endif
 	}
 
+	//////////////////////////////////////////////////////////////////////
+	// Execution
+	//////////////////////////////////////////////////////////////////////
 	// stackPtr = current position on stack, the arguments are the initial values.
 	// Note: it is an error to jump outside of a function.
-	FsValue callFunc(const IRCode* const func, const s32 funcSize, FsValue* stackPtr)
+	static FsValue callFunc(const IRCode* const func, const s32 funcSize, FsValue* stackPtr)
 	{
-		s_stackPtr = stackPtr;
+		// Calls can be nested, so save the current interpreter state.
+		FsValue* prevStackPtr = s_stackPtr;
+		const s32 prevIp = s_ip;
+		const s32 prevFuncSize = s_funcSize;
+		const FsValue prevRetValue = s_retValue;
 
+		s_stackPtr = stackPtr;
 		s_retValue = fsValue_createNull();	// Default return value is null.
 		s_funcSize = funcSize;
 		for (s_ip = 0; s_ip < funcSize; )
@@ -57,35 +287,82 @@ namespace TFE_ForceScript
 
 			code->func(code->instr);
 		}
-		return s_retValue;
+		const FsValue retValue = s_retValue;
+
+		s_stackPtr = prevStackPtr;
+		s_ip = prevIp;
+		s_funcSize = prevFuncSize;
+		s_retValue = prevRetValue;
+		return retValue;
 	}
 
-	f32 cversion(s32 arg0, s32 arg1, f32 arg2)
+	FsValue vm_callFunction(s32 funcIndex, FsValue* frame)
 	{
-		s32 r3i = arg0 + arg1;
-		f32 r3f = f32(r3i);
-		for (s32 i = 0; i < 100; i++)
+		FsFunction* func = &s_functions[funcIndex];
+		if (s_callDepth >= FS_MAX_CALL_DEPTH || frame + func->regCount > s_stack + FS_STACK_SIZE)
 		{
-			r3f += arg2;
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Stack overflow calling '%s'.", func->name.c_str());
+			return fsValue_createNull();
 		}
-		return r3f;
-	}
 
-	f32 cversion2(Instruction* func, FsValue* stackPtr)
-	{
-		s_stackPtr = stackPtr;
+		// Registers past the arguments start as null, the verifier depends on this.
+		for (s32 i = func->argCount; i < func->regCount; i++)
+		{
+			frame[i] = fsValue_createNull();
+		}
 
-		s_vmOpCalls[FSF_OP_LOAD](func[0]);
-		s_vmOpCalls[FSF_OP_LOAD](func[1]);
-		s_vmOpCalls[FSF_OP_IADD](func[2]);
+		FsValue* prevTop = s_stackTop;
+		if (frame + func->regCount > s_stackTop) { s_stackTop = frame + func->regCount; }
+		s_callDepth++;
+
+	#ifdef VM_JIT_ENABLE
+		// Tier-up once the function is hot.
+		if (s_jitEnabled && s_jitThreshold && !func->jit && !func->jitFailed)
+		{
+			func->callCount++;
+			if (func->callCount >= s_jitThreshold)
+			{
+				vm_compileFunction(funcIndex);
+				func = &s_functions[funcIndex];
+			}
+		}
+	#endif
 
-		for (s32 i = 0; i < 100; i++)
+		FsValue retValue;
+		if (s_jitEnabled && func->jit)
+		{
+			retValue = func->jit(frame);
+		}
+		else
 		{
-			s_vmOpCalls[FSF_OP_FADD](func[3]);
+			retValue = callFunc(func->ir.data(), (s32)func->ir.size(), frame);
 		}
 
-		s_vmOpCalls[FSF_OP_RET](func[7]);
-		return *fsValue_getFloatPtr(s_retValue);
+		s_callDepth--;
+		s_stackTop = prevTop;
+		return retValue;
+	}
+
+	FsValue vm_call(s32 funcIndex, const FsValue* args, s32 argCount)
+	{
+		if (funcIndex < 0 || funcIndex >= (s32)s_functions.size() || argCount != s_functions[funcIndex].argCount)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Invalid call to function %d with %d arguments.", funcIndex, argCount);
+			return fsValue_createNull();
+		}
+
+		// Natives may call back into scripts, so new frames always start above the ones in use.
+		FsValue* frame = s_stackTop;
+		if (frame + argCount > s_stack + FS_STACK_SIZE)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Stack overflow calling '%s'.", s_functions[funcIndex].name.c_str());
+			return fsValue_createNull();
+		}
+		for (s32 i = 0; i < argCount; i++)
+		{
+			frame[i] = args[i];
+		}
+		return vm_callFunction(funcIndex, frame);
 	}
 
 	s32 test()
@@ -94,112 +371,16 @@ namespace TFE_ForceScript
 		FsValue v1 = fsValue_createFloat(3.141516f);
 
 		char outStr[256];
-		char outStr2[256];
 		fsValue_toString(v0, outStr);
 		TFE_System::debugWrite("Test", "v0 = %s", outStr);
 
 		fsValue_toString(v1, outStr);
 		TFE_System::debugWrite("Test", "v1 = %s", outStr);
 
-		s32* testCast0 = (s32*)&v0;
-		f32* testCast1 = (f32*)&v1;
-
-		/* -- TODO: Map rN to registers and have seperate load/store.
-		load r4, 0		-- load integer value into r4
-		load r5, 100	-- load integer value into r5
-		iadd r3, r0, r1 -- add function arguments and store in r3
-		toFloat r3, r3  -- cast dynamic value as float.
-		
-		loop:
-			fadd r3, r3, r2 -- r3 = r3 + r2
-			inc r4			-- increment loop counter in r4
-			lt r4, r5		-- skip next instruction unless r4 < r5
-			jmp loop		-- goto loop
-
-		ret r3		-- return r3
-
-		-----------------------
-
-		load r4, 0		-- load integer value into r4
-		load r5, 100	-- load integer value into r5
-		load f1, stack[2]
-		load r0, stack[0]
-		load r1, stack[1]
-		iadd r3, r0, r1 -- add function arguments and store in r3
-		toFloat f0, r3  -- cast dynamic value as float.
-
-		-- for (..100) {}; for (1..100) {}; for (i = ..100) {}; for (i = 1..100) {}
-		loop 100        -- loop opcodes: OP_LOOP_CNT cnt; OP_LOOP_RNG start, end; 
-			fadd f3, f3, f1  -- r3 = r3 + r2
-			endLoop
-
-		ret r3
-		*/
-
-		Instruction testFunc[] =
-		{
-			/*0*/ I_OP_ARG0_1(FSF_OP_LOAD, 4, 0),		// load r4, 0
-			/*1*/ I_OP_ARG0_1(FSF_OP_LOAD, 5, 100),		// load r5, 100
-			/*2*/ I_OP_ARG0_1_2(FSF_OP_IADD, 3, 0, 1),	// iadd r3, r0, r1
-			/*3*/ I_OP_ARG0_1(FSF_OP_CAST_TO_FLOAT, 3, 3),	// mov r3, float(r3)
-			// Loop -> addr = 4
-			/*4*/ I_OP_ARG0_1_2(FSF_OP_FADD, 3, 3, 2),	// fadd r3, r3, r2
-			/*5*/ I_OP_ARG0(FSF_OP_INC, 4),				// inc r4
-			/*6*/ I_OP_ARG0_1(FSF_OP_LT, 4, 5),			// r4 < r5 ? ip++
-			/*7*/ I_OP_ARG0(FSF_OP_JMP, 4),				// goto 4
-			// End Loop
-			/*8*/ I_OP_ARG0(FSF_OP_RET, 3),				// return r3
-		};
-
-		jit_init();
-		ScriptJitFunc jitFunc = jit_compileScriptFunc("Test", testFunc, TFE_ARRAYSIZE(testFunc));
-		
-		f64 dtSec = 0.0;
-		f64 dtSecJit = 0.0;
-		f64 dtSecC = 0.0;
-
-		optimizeFunc(testFunc, TFE_ARRAYSIZE(testFunc));
-
-		FsValue retValue;
-		FsValue retValueJit;
-		f32 retValueC;
-
-		FsValue stack[256];
-		for (s32 i = 0; i < 100000; i++)
-		{
-			// "push" values onto the stack.
-			u64 start = TFE_System::getCurrentTimeInTicks();
-				stack[0] = fsValue_createInt(-237);
-				stack[1] = fsValue_createInt(101);
-				stack[2] = fsValue_createFloat(37.2f);
-				retValue = callFunc(s_funcOpt, TFE_ARRAYSIZE(testFunc), stack);
-			u64 dt = TFE_System::getCurrentTimeInTicks() - start;
-			dtSec += TFE_System::convertFromTicksToSeconds(dt);
-
-			// "push" values onto the stack.
-			start = TFE_System::getCurrentTimeInTicks();
-				stack[0] = fsValue_createInt(-237);
-				stack[1] = fsValue_createInt(101);
-				stack[2] = fsValue_createFloat(37.2f);
-				retValueJit = jitFunc(stack);
-			dt = TFE_System::getCurrentTimeInTicks() - start;
-			dtSecJit += TFE_System::convertFromTicksToSeconds(dt);
-
-			start = TFE_System::getCurrentTimeInTicks();
-				retValueC = cversion(-237, 101, 37.2f);
-				//retValueC = cversion2(testFunc, stack);
-			dt = TFE_System::getCurrentTimeInTicks() - start;
-			dtSecC += TFE_System::convertFromTicksToSeconds(dt);
-		}
-		
-		fsValue_toString(retValue, outStr);
-		fsValue_toString(retValueJit, outStr2);
-		TFE_System::debugWrite("Test", "func(-237, 101, 37.2f) = [Interp] %s, [JIT] %s, [C] %f", outStr, outStr2, retValueC);
-		TFE_System::debugWrite("Test", "Execution time = [Interp] %fms, [JIT] %fms, [C] %fms", dtSec * 1000.0 / 100000.0, dtSecJit * 1000.0 / 100000.0, dtSecC * 1000.0 / 100000.0);
-
-		jit_destroy();
-				
+		init();
+		vm_runBenchmarks(10000);
+		destroy();
 		return 1;
 	}
 }
-#endif
\ No newline at end of file
+#endif
@@ -1,16 +1,60 @@
 #pragma once
 //////////////////////////////////////////////////////////////////////
+// ForceScript VM
+// Register based virtual machine. Each function call gets a window of
+// FsValue registers on the VM stack, the arguments are placed in the
+// first registers by the caller.
+//
+// Functions are verified when added, run by the interpreter and then
+// compiled to native code by the JIT once they have been called
+// enough times (see vm_setJitThreshold()).
 //////////////////////////////////////////////////////////////////////
 
 #include <TFE_System/types.h>
 #include "vmConfig.h"
 
 #ifdef VM_ENABLE
+#include "value.h"
+
 namespace TFE_ForceScript
 {
+	enum FsFieldType
+	{
+		FS_FIELD_INT = 0,	// s32
+		FS_FIELD_FLOAT,		// f32
+		FS_FIELD_FIXED16,	// s32 16.16 fixed point, scripts see it as a float.
+		FS_FIELD_COUNT
+	};
+
+	// Native functions receive a pointer to their arguments, which are in consecutive registers.
+	typedef FsValue(*FsNativeFunc)(FsValue* args, s32 argCount);
+
 	bool init();
 	void destroy();
 
 	s32 test();
+
+	// Engine bindings, returns the index used by the CALLN, GETF and SETF opcodes or -1 on failure.
+	s32 vm_registerNative(const char* name, FsNativeFunc func, s32 argCount);
+	s32 vm_registerField(const char* typeName, const char* fieldName, u32 offset, FsFieldType type);
+	s32 vm_findNative(const char* name);
+	s32 vm_findField(const char* typeName, const char* fieldName);
+
+	// Add a script function, the bytecode is verified first.
+	// Returns the function index used by the CALL opcode or -1 if verification failed.
+	s32 vm_addFunction(const char* name, const u64* code, s32 codeSize, s32 argCount, s32 regCount);
+	s32 vm_findFunction(const char* name);
+	// Call a script function from native code.
+	FsValue vm_call(s32 funcIndex, const FsValue* args, s32 argCount);
+
+	// Functions are compiled once they have been called 'callCount' times, 0 disables tier-up.
+	void vm_setJitThreshold(u32 callCount);
+	// When disabled, compiled functions are ignored and everything runs in the interpreter.
+	void vm_enableJit(bool enable);
+	// Compile a function now, returns false if the JIT is not available.
+	bool vm_compileFunction(s32 funcIndex);
+
+	// Compare interpreter, JIT and native C throughput on a set of micro-benchmarks and write the results to the log.
+	void vm_runBenchmarks(u32 iterations);
 }
-#endif
\ No newline at end of file
+#endif
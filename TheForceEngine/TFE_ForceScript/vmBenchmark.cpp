@@ -0,0 +1,270 @@
+#include "vmConfig.h"
+
+#ifdef VM_ENABLE
+#include <TFE_System/system.h>
+#include "vm.h"
+#include "vmOps.h"
+#include "value.h"
+#include <stddef.h>
+
+//////////////////////////////////////////////////////////////////////
+// ForceScript micro-benchmarks
+// Each benchmark is run through the interpreter, the JIT and an
+// equivalent C function so the cost of script logic can be compared
+// against native code. The results must match.
+//////////////////////////////////////////////////////////////////////
+namespace TFE_ForceScript
+{
+	typedef FsValue(*BenchCFunc)(const FsValue* args);
+
+	struct BenchObject
+	{
+		s32 health;
+		f32 speed;
+		s32 posX;	// 16.16 fixed point.
+	};
+	static BenchObject s_benchObj;
+
+	static void resetBenchObject()
+	{
+		s_benchObj.health = 100;
+		s_benchObj.speed = 0.5f;
+		s_benchObj.posX = 3 << 16;
+	}
+
+	static FsValue bench_getObj(FsValue* args, s32 argCount)
+	{
+		return fsValue_createRef(&s_benchObj);
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// C versions
+	//////////////////////////////////////////////////////////////////////
+	static FsValue cFloatLoop(const FsValue* args)
+	{
+		const s32 arg0 = *fsValue_getIntPtr(args[0]);
+		const s32 arg1 = *fsValue_getIntPtr(args[1]);
+		const f32 arg2 = *fsValue_getFloatPtr(args[2]);
+
+		f32 r3f = f32(arg0 + arg1);
+		for (s32 i = 0; i < 100; i++)
+		{
+			r3f += arg2;
+		}
+		return fsValue_createFloat(r3f);
+	}
+
+	static FsValue cIntMath(const FsValue* args)
+	{
+		const s32 n = *fsValue_getIntPtr(args[0]);
+		s32 acc = 0;
+		for (s32 i = 0; i < n; i++)
+		{
+			acc += ((i * 3) ^ (i >> 1)) & 255;
+		}
+		return fsValue_createInt(acc);
+	}
+
+	static s32 cFib(s32 n)
+	{
+		return n < 2 ? n : cFib(n - 1) + cFib(n - 2);
+	}
+
+	static FsValue cFibCall(const FsValue* args)
+	{
+		return fsValue_createInt(cFib(*fsValue_getIntPtr(args[0])));
+	}
+
+	static FsValue cFields(const FsValue* args)
+	{
+		resetBenchObject();
+		const s32 n = *fsValue_getIntPtr(args[0]);
+		BenchObject* obj = &s_benchObj;
+		for (s32 i = 0; i < n; i++)
+		{
+			const f32 posX = f32(obj->posX) * (1.0f / 65536.0f);
+			obj->posX = s32((posX + obj->speed) * 65536.0f);
+		}
+		return fsValue_createFloat(f32(obj->posX) * (1.0f / 65536.0f));
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Script versions
+	//////////////////////////////////////////////////////////////////////
+	// func(int a, int b, float c) { float r = float(a + b); for (i = 0..100) { r += c; } return r; }
+	static s32 addFloatLoop()
+	{
+		const Instruction code[] =
+		{
+			/*0*/ I_LOAD_INT(4, 0),								// load r4, 0
+			/*1*/ I_LOAD_INT(5, 100),							// load r5, 100
+			/*2*/ I_OP_ARG0_1_2(FSF_OP_IADD, 3, 0, 1),			// iadd r3, r0, r1
+			/*3*/ I_OP_ARG0_1(FSF_OP_CAST_TO_FLOAT, 3, 3),		// mov r3, float(r3)
+			// Loop -> addr = 4
+			/*4*/ I_OP_ARG0_1_2(FSF_OP_FADD, 3, 3, 2),			// fadd r3, r3, r2
+			/*5*/ I_OP_ARG0(FSF_OP_INC, 4),						// inc r4
+			/*6*/ I_OP_ARG0_1(FSF_OP_LT, 4, 5),					// r4 < r5 ? ip++
+			/*7*/ I_OP_ARG0(FSF_OP_JMP, 4),						// goto 4
+			// End Loop
+			/*8*/ I_OP_ARG0(FSF_OP_RET, 3),						// return r3
+		};
+		return vm_addFunction("bench_floatLoop", code, TFE_ARRAYSIZE(code), 3, 6);
+	}
+
+	// func(int n) { int acc = 0; for (i = 0..n) { acc += ((i * 3) ^ (i >> 1)) & 255; } return acc; }
+	static s32 addIntMath()
+	{
+		const Instruction code[] =
+		{
+			/* 0*/ I_LOAD_INT(1, 0),							// i = 0
+			/* 1*/ I_LOAD_INT(2, 0),							// acc = 0
+			/* 2*/ I_LOAD_INT(3, 3),
+			/* 3*/ I_LOAD_INT(4, 1),
+			/* 4*/ I_LOAD_INT(5, 255),
+			// Loop -> addr = 5
+			/* 5*/ I_OP_ARG0_1_2(FSF_OP_JLE, 0, 1, 13),			// if (n <= i) goto 13
+			/* 6*/ I_OP_ARG0_1_2(FSF_OP_IMUL, 6, 1, 3),			// r6 = i * 3
+			/* 7*/ I_OP_ARG0_1_2(FSF_OP_ISHR, 7, 1, 4),			// r7 = i >> 1
+			/* 8*/ I_OP_ARG0_1_2(FSF_OP_IXOR, 6, 6, 7),
+			/* 9*/ I_OP_ARG0_1_2(FSF_OP_IAND, 6, 6, 5),
+			/*10*/ I_OP_ARG0_1_2(FSF_OP_IADD, 2, 2, 6),			// acc += r6
+			/*11*/ I_OP_ARG0(FSF_OP_INC, 1),					// i++
+			/*12*/ I_OP_ARG0(FSF_OP_JMP, 5),
+			// End Loop
+			/*13*/ I_OP_ARG0(FSF_OP_RET, 2),					// return acc
+		};
+		return vm_addFunction("bench_intMath", code, TFE_ARRAYSIZE(code), 1, 8);
+	}
+
+	// func(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+	static s32 addFib()
+	{
+		// The function calls itself, so it needs to know its own index.
+		const s32 self = vm_getFunctionCount();
+		const Instruction code[] =
+		{
+			/*0*/ I_LOAD_INT(1, 2),
+			/*1*/ I_OP_ARG0_1_2(FSF_OP_JL, 0, 1, 9),			// if (n < 2) goto 9
+			/*2*/ I_LOAD_INT(1, 1),
+			/*3*/ I_OP_ARG0_1_2(FSF_OP_ISUB, 3, 0, 1),			// r3 = n - 1
+			/*4*/ I_OP_ARG0_1_2(FSF_OP_CALL, 2, self, 3),		// r2 = fib(r3)
+			/*5*/ I_LOAD_INT(1, 2),
+			/*6*/ I_OP_ARG0_1_2(FSF_OP_ISUB, 3, 0, 1),			// r3 = n - 2
+			/*7*/ I_OP_ARG0_1_2(FSF_OP_CALL, 1, self, 3),		// r1 = fib(r3)
+			/*8*/ I_OP_ARG0_1_2(FSF_OP_IADD, 0, 2, 1),			// n = r2 + r1
+			/*9*/ I_OP_ARG0(FSF_OP_RET, 0),						// return n
+		};
+		return vm_addFunction("bench_fib", code, TFE_ARRAYSIZE(code), 1, 4);
+	}
+
+	// func(int n) { obj = getObj(); for (i = 0..n) { obj.posX = obj.posX + obj.speed; } return obj.posX; }
+	static s32 addFields()
+	{
+		const s32 getObj = vm_registerNative("bench_getObj", bench_getObj, 0);
+		const s32 speed = vm_registerField("BenchObject", "speed", offsetof(BenchObject, speed), FS_FIELD_FLOAT);
+		const s32 posX = vm_registerField("BenchObject", "posX", offsetof(BenchObject, posX), FS_FIELD_FIXED16);
+		if (getObj < 0 || speed < 0 || posX < 0) { return -1; }
+
+		const Instruction code[] =
+		{
+			/* 0*/ I_LOAD_INT(1, 0),							// i = 0
+			/* 1*/ I_OP_ARG0_1_2(FSF_OP_CALLN, 2, getObj, 5),	// obj = getObj()
+			// Loop -> addr = 2
+			/* 2*/ I_OP_ARG0_1_2(FSF_OP_JLE, 0, 1, 9),			// if (n <= i) goto 9
+			/* 3*/ I_OP_ARG0_1_2(FSF_OP_GETF, 3, 2, posX),
+			/* 4*/ I_OP_ARG0_1_2(FSF_OP_GETF, 4, 2, speed),
+			/* 5*/ I_OP_ARG0_1_2(FSF_OP_FADD, 3, 3, 4),
+			/* 6*/ I_OP_ARG0_1_2(FSF_OP_SETF, 2, posX, 3),
+			/* 7*/ I_OP_ARG0(FSF_OP_INC, 1),					// i++
+			/* 8*/ I_OP_ARG0(FSF_OP_JMP, 2),
+			// End Loop
+			/* 9*/ I_OP_ARG0_1_2(FSF_OP_GETF, 3, 2, posX),
+			/*10*/ I_OP_ARG0(FSF_OP_RET, 3),
+		};
+		return vm_addFunction("bench_fields", code, TFE_ARRAYSIZE(code), 1, 6);
+	}
+
+	//////////////////////////////////////////////////////////////////////
+	// Harness
+	//////////////////////////////////////////////////////////////////////
+	static void runBenchmark(const char* name, s32 funcIndex, const FsValue* args, s32 argCount, BenchCFunc cFunc, bool resetObject, u32 iterations)
+	{
+		if (funcIndex < 0)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Benchmark '%s' could not be added.", name);
+			return;
+		}
+
+		FsValue retInterp = fsValue_createNull();
+		FsValue retJit = fsValue_createNull();
+		FsValue retC = fsValue_createNull();
+
+		// Interpreter
+		vm_enableJit(false);
+		u64 start = TFE_System::getCurrentTimeInTicks();
+		for (u32 i = 0; i < iterations; i++)
+		{
+			if (resetObject) { resetBenchObject(); }
+			retInterp = vm_call(funcIndex, args, argCount);
+		}
+		const f64 dtInterp = TFE_System::convertFromTicksToSeconds(TFE_System::getCurrentTimeInTicks() - start);
+
+		// JIT, compiled up front so the compile time isn't measured.
+		vm_enableJit(true);
+		const bool compiled = vm_compileFunction(funcIndex);
+		start = TFE_System::getCurrentTimeInTicks();
+		for (u32 i = 0; i < iterations; i++)
+		{
+			if (resetObject) { resetBenchObject(); }
+			retJit = vm_call(funcIndex, args, argCount);
+		}
+		const f64 dtJit = TFE_System::convertFromTicksToSeconds(TFE_System::getCurrentTimeInTicks() - start);
+
+		// C
+		start = TFE_System::getCurrentTimeInTicks();
+		for (u32 i = 0; i < iterations; i++)
+		{
+			retC = cFunc(args);
+		}
+		const f64 dtC = TFE_System::convertFromTicksToSeconds(TFE_System::getCurrentTimeInTicks() - start);
+
+		char interpStr[256], jitStr[256], cStr[256];
+		fsValue_toString(retInterp, interpStr);
+		fsValue_toString(retJit, jitStr);
+		fsValue_toString(retC, cStr);
+		if (retInterp != retC || retJit != retC)
+		{
+			TFE_System::logWrite(LOG_ERROR, "ForceScript", "Benchmark '%s' results do not match: [Interp] %s, [JIT] %s, [C] %s", name, interpStr, jitStr, cStr);
+		}
+
+		const f64 scale = 1000000.0 / f64(iterations);
+		TFE_System::logWrite(LOG_MSG, "ForceScript", "%-8s = %s | [Interp] %.3fus, [JIT%s] %.3fus, [C] %.3fus | JIT %.1fx faster, %.1fx slower than C",
+			name, cStr, dtInterp * scale, compiled ? "" : " unavailable", dtJit * scale, dtC * scale,
+			dtJit > 0.0 ? dtInterp / dtJit : 0.0, dtC > 0.0 ? dtJit / dtC : 0.0);
+	}
+
+	static s32 getOrAdd(const char* name, s32(*addFunc)())
+	{
+		const s32 index = vm_findFunction(name);
+		return index >= 0 ? index : addFunc();
+	}
+
+	void vm_runBenchmarks(u32 iterations)
+	{
+		if (!iterations) { return; }
+		TFE_System::logWrite(LOG_MSG, "ForceScript", "Running benchmarks, %u iterations, times are per call.", iterations);
+
+		const FsValue floatLoopArgs[] = { fsValue_createInt(-237), fsValue_createInt(101), fsValue_createFloat(37.2f) };
+		runBenchmark("FloatLoop", getOrAdd("bench_floatLoop", addFloatLoop), floatLoopArgs, 3, cFloatLoop, false, iterations);
+
+		const FsValue intMathArgs[] = { fsValue_createInt(1000) };
+		runBenchmark("IntMath", getOrAdd("bench_intMath", addIntMath), intMathArgs, 1, cIntMath, false, iterations);
+
+		const FsValue fibArgs[] = { fsValue_createInt(12) };
+		runBenchmark("Fib", getOrAdd("bench_fib", addFib), fibArgs, 1, cFibCall, false, iterations);
+
+		const FsValue fieldArgs[] = { fsValue_createInt(100) };
+		runBenchmark("Fields", getOrAdd("bench_fields", addFields), fieldArgs, 1, cFields, true, iterations);
+	}
+}
+#endif
@@ -5,16 +5,21 @@
 #ifdef VM_ENABLE
 #include <TFE_System/types.h>
 #include "value.h"
+#include "vm.h"
+#include <string.h>
 
 namespace TFE_ForceScript
 {
+	// Typed opcodes (I*, F*, J*) assume their operands already have the matching type, the verifier rejects
+	// operands that are known to have a different type. Use the CAST opcodes to convert dynamic values.
+	// Operands are registers unless noted otherwise: a = ARG0, b = ARG1, c = ARG2.
 	enum OpCode
 	{
 		FSF_OP_NOP = 0,
-		FSF_OP_MOVE,
-		FSF_OP_LOAD,
-		FSF_OP_INC,
-		FSF_OP_DEC,
+		FSF_OP_MOVE,	// a = b
+		FSF_OP_LOAD,	// a = int immediate (b | c)
+		FSF_OP_INC,		// a++
+		FSF_OP_DEC,		// a--
 		FSF_OP_IADD,	// All values are integer.
 		FSF_OP_FADD,	// All values are float.
 
@@ -22,14 +27,60 @@ namespace TFE_ForceScript
 		FSF_OP_CAST_TO_INT,     // Cast from any Value type to int.
 
 		FSF_OP_ADD,		// Add arbitrary types (slow).
-		
-		FSF_OP_LT,		
-		FSF_OP_JMP,
-		FSF_OP_JL,	// Jump if less.
-		FSF_OP_RET,
+
+		FSF_OP_LT,		// Skip the next instruction unless a < b.
+		FSF_OP_JMP,		// goto a
+		FSF_OP_JL,		// Jump if less: if (a < b) goto c
+		FSF_OP_RET,		// return a
+
+		// Constants.
+		FSF_OP_LOADF,	// a = float immediate (b | c)
+		FSF_OP_LOADNULL,// a = null
+		// Integer arithmetic, a = b op c
+		FSF_OP_ISUB,
+		FSF_OP_IMUL,
+		FSF_OP_IDIV,	// Division by zero results in 0.
+		FSF_OP_IMOD,	// Division by zero results in 0.
+		FSF_OP_INEG,	// a = -b
+		FSF_OP_IAND,
+		FSF_OP_IOR,
+		FSF_OP_IXOR,
+		FSF_OP_ISHL,	// The shift amount is masked to 5 bits.
+		FSF_OP_ISHR,	// Arithmetic shift.
+		// Float arithmetic, a = b op c
+		FSF_OP_FSUB,
+		FSF_OP_FMUL,
+		FSF_OP_FDIV,
+		FSF_OP_FNEG,	// a = -b
+		// Comparisons, a = (b op c) ? 1 : 0
+		FSF_OP_IEQ,
+		FSF_OP_INE,
+		FSF_OP_ILT,
+		FSF_OP_ILE,
+		FSF_OP_FEQ,
+		FSF_OP_FNE,
+		FSF_OP_FLT,
+		FSF_OP_FLE,
+		// Branches.
+		FSF_OP_JZ,		// if (a == 0) goto b
+		FSF_OP_JNZ,		// if (a != 0) goto b
+		FSF_OP_JLE,		// if (a <= b) goto c
+		FSF_OP_JEQ,		// if (a == b) goto c
+		FSF_OP_JNE,		// if (a != b) goto c
+		FSF_OP_JFL,		// if (a < b) goto c, float
+		FSF_OP_JFLE,	// if (a <= b) goto c, float
+		// Calls, the arguments are placed in consecutive registers starting at c.
+		// The callee uses the registers from c onward, so they are not preserved.
+		FSF_OP_CALL,	// a = function b(c...)
+		FSF_OP_CALLN,	// a = native function b(c...)
+		// Engine object fields.
+		FSF_OP_GETF,	// a = b.field[c]
+		FSF_OP_SETF,	// a.field[b] = c
+		FSF_OP_RETNULL,	// return null
+		FSF_OP_COUNT
 	};
 
-	// Instruction = 
+	// Instruction =
 	// OpCode (10) | Arg0 (18) | Arg1 (18) | Arg2 (18)
 	// OpCode (10) | Arg0 (18) | Arg1 (36)
 	typedef u64 Instruction;
@@ -38,7 +89,7 @@ namespace TFE_ForceScript
 	#define I_OP_MASK  (I_OP_SIZE - 1)
 	#define I_ARG_SIZE (1ull << 18ull)
 	#define I_ARG_MASK (I_ARG_SIZE - 1ull)
-	#define I_ARG2_MASK (I_ARG_SIZE*2 - 1ull)
+	#define I_ARG2_MASK (I_ARG_SIZE*I_ARG_SIZE - 1ull)
 
 	#define I_OP(i)   ((i) & I_OP_MASK)
 	#define I_ARG0(i) (((i) >> 10ull) & I_ARG_MASK)
@@ -50,6 +101,36 @@ namespace TFE_ForceScript
 	#define I_OP_ARG0_1(i, arg0, arg1)			(u64(i) | (u64(arg0) << 10ull) | (u64(arg1) << 28ull))
 	#define I_OP_ARG0_1_2(i, arg0, arg1, arg2)	(u64(i) | (u64(arg0) << 10ull) | (u64(arg1) << 28ull) | (u64(arg2) << 46ull))
 
+	// 32-bit immediate values are stored in Arg1 and Arg2.
+	inline Instruction I_LOAD_INT(u32 reg, s32 value)
+	{
+		u32 bits;
+		memcpy(&bits, &value, sizeof(u32));
+		return I_OP_ARG0_1(FSF_OP_LOAD, reg, bits);
+	}
+
+	inline Instruction I_LOAD_FLOAT(u32 reg, f32 value)
+	{
+		u32 bits;
+		memcpy(&bits, &value, sizeof(u32));
+		return I_OP_ARG0_1(FSF_OP_LOADF, reg, bits);
+	}
+
+	struct FsNative
+	{
+		FsNativeFunc func;
+		s32 argCount;
+	};
+
+	struct FsFieldInfo
+	{
+		u32 offset;
+		FsFieldType type;
+	};
+
+	#define FS_MAX_NATIVES 1024
+	#define FS_MAX_FIELDS  1024
+
 	extern FsValue* s_stackPtr;
 	extern Instruction* s_func;
 	extern Instruction s_curInstr;
@@ -57,6 +138,16 @@ namespace TFE_ForceScript
 	extern s32 s_funcSize;
 	extern FsValue s_retValue;
 
+	extern FsNative    s_natives[FS_MAX_NATIVES];
+	extern FsFieldInfo s_fields[FS_MAX_FIELDS];
+
+	// Internal VM functions used by the opcodes, verifier and JIT.
+	FsValue vm_callFunction(s32 funcIndex, FsValue* frame);
+	s32 vm_getFunctionCount();
+	s32 vm_getFunctionArgCount(s32 funcIndex);
+	s32 vm_getNativeCount();
+	s32 vm_getFieldCount();
+
 	typedef void(*vmCall)(Instruction);
 
 	void opNop(Instruction curInstr);
@@ -76,6 +167,43 @@ namespace TFE_ForceScript
 	void opJl(Instruction curInstr);
 	void opRet(Instruction curInstr);
 
+	void opLoadf(Instruction curInstr);
+	void opLoadNull(Instruction curInstr);
+	void opIsub(Instruction curInstr);
+	void opImul(Instruction curInstr);
+	void opIdiv(Instruction curInstr);
+	void opImod(Instruction curInstr);
+	void opIneg(Instruction curInstr);
+	void opIand(Instruction curInstr);
+	void opIor(Instruction curInstr);
+	void opIxor(Instruction curInstr);
+	void opIshl(Instruction curInstr);
+	void opIshr(Instruction curInstr);
+	void opFsub(Instruction curInstr);
+	void opFmul(Instruction curInstr);
+	void opFdiv(Instruction curInstr);
+	void opFneg(Instruction curInstr);
+	void opIeq(Instruction curInstr);
+	void opIne(Instruction curInstr);
+	void opIlt(Instruction curInstr);
+	void opIle(Instruction curInstr);
+	void opFeq(Instruction curInstr);
+	void opFne(Instruction curInstr);
+	void opFlt(Instruction curInstr);
+	void opFle(Instruction curInstr);
+	void opJz(Instruction curInstr);
+	void opJnz(Instruction curInstr);
+	void opJle(Instruction curInstr);
+	void opJeq(Instruction curInstr);
+	void opJne(Instruction curInstr);
+	void opJfl(Instruction curInstr);
+	void opJfle(Instruction curInstr);
+	void opCall(Instruction curInstr);
+	void opCallNative(Instruction curInstr);
+	void opGetField(Instruction curInstr);
+	void opSetField(Instruction curInstr);
+	void opRetNull(Instruction curInstr);
+
 	const vmCall s_vmOpCalls[] =
 	{
 		opNop,
@@ -92,7 +220,48 @@ namespace TFE_ForceScript
 		opJmp,
 		opJl,
 		opRet,
+		opLoadf,
+		opLoadNull,
+		opIsub,
+		opImul,
+		opIdiv,
+		opImod,
+		opIneg,
+		opIand,
+		opIor,
+		opIxor,
+		opIshl,
+		opIshr,
+		opFsub,
+		opFmul,
+		opFdiv,
+		opFneg,
+		opIeq,
+		opIne,
+		opIlt,
+		opIle,
+		opFeq,
+		opFne,
+		opFlt,
+		opFle,
+		opJz,
+		opJnz,
+		opJle,
+		opJeq,
+		opJne,
+		opJfl,
+		opJfle,
+		opCall,
+		opCallNative,
+		opGetField,
+		opSetField,
+		opRetNull,
 	};
+	static_assert(sizeof(s_vmOpCalls) / sizeof(s_vmOpCalls[0]) == FSF_OP_COUNT, "Opcode table does not match the OpCode enum.");
+
+	// Raw register access for the typed opcodes.
+	#define FS_REG_INT(r)   (*fsValue_getIntPtr(s_stackPtr[r]))
+	#define FS_REG_FLOAT(r) (*fsValue_getFloatPtr(s_stackPtr[r]))
 
 	inline void opNop(Instruction curInstr)
 	{
@@ -100,11 +269,12 @@ namespace TFE_ForceScript
 
 	inline void opMove(Instruction curInstr)
 	{
+		s_stackPtr[I_ARG0(curInstr)] = s_stackPtr[I_ARG1(curInstr)];
 	}
 
 	inline void opLoad(Instruction curInstr)
 	{
-		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(I_ARG1(curInstr));
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(u32(I_ARG12(curInstr))));
 	}
 
 	// Assume that inc and dec are only emitted on pure int values.
@@ -120,19 +290,15 @@ namespace TFE_ForceScript
 		(*value)--;
 	}
 
+	// Integer math wraps, like the native code generated by the JIT.
 	inline void opIadd(Instruction curInstr)
 	{
-		const FsValue* const v0 = &s_stackPtr[I_ARG1(curInstr)];
-		const FsValue* const v1 = &s_stackPtr[I_ARG2(curInstr)];
-		// For now pretent v0 and v1 are int.
-		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(*((s32*)v0) + *((s32*)v1));
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(u32(FS_REG_INT(I_ARG1(curInstr))) + u32(FS_REG_INT(I_ARG2(curInstr)))));
 	}
 
 	inline void opFadd(Instruction curInstr)
 	{
-		const FsValue* const v0 = &s_stackPtr[I_ARG1(curInstr)];
-		const FsValue* const v1 = &s_stackPtr[I_ARG2(curInstr)];
-		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(*((f32*)v0) + *((f32*)v1));
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(FS_REG_FLOAT(I_ARG1(curInstr)) + FS_REG_FLOAT(I_ARG2(curInstr)));
 	}
 
 	inline void opCastToFloat(Instruction curInstr)
@@ -149,16 +315,24 @@ namespace TFE_ForceScript
 		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(cast);
 	}
 
+	// The result is an int if both values are ints, otherwise the values are added as floats.
 	inline void opAdd(Instruction curInstr)
 	{
-		// TODO:
+		const FsValue* const v0 = &s_stackPtr[I_ARG1(curInstr)];
+		const FsValue* const v1 = &s_stackPtr[I_ARG2(curInstr)];
+		if (fsValue_getType(*v0) == FST_INT && fsValue_getType(*v1) == FST_INT)
+		{
+			s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(u32(fsValue_readAsInt(v0)) + u32(fsValue_readAsInt(v1))));
+		}
+		else
+		{
+			s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(fsValue_readAsFloat(v0) + fsValue_readAsFloat(v1));
+		}
 	}
 
 	inline void opLt(Instruction curInstr)
 	{
-		const FsValue* const v0 = &s_stackPtr[I_ARG0(curInstr)];
-		const FsValue* const v1 = &s_stackPtr[I_ARG1(curInstr)];
-		if (!(fsValue_readAsInt(v0) < fsValue_readAsInt(v1)))
+		if (!(FS_REG_INT(I_ARG0(curInstr)) < FS_REG_INT(I_ARG1(curInstr))))
 		{
 			// Skip the next instruction if the condition is not true.
 			s_ip++;
@@ -172,9 +346,7 @@ namespace TFE_ForceScript
 
 	inline void opJl(Instruction curInstr)
 	{
-		const FsValue* const v0 = &s_stackPtr[I_ARG0(curInstr)];
-		const FsValue* const v1 = &s_stackPtr[I_ARG1(curInstr)];
-		if (fsValue_readAsInt(v0) < fsValue_readAsInt(v1))
+		if (FS_REG_INT(I_ARG0(curInstr)) < FS_REG_INT(I_ARG1(curInstr)))
 		{
 			s_ip = I_ARG2(curInstr);
 		}
@@ -186,5 +358,228 @@ namespace TFE_ForceScript
 		// Set the IP to the end so we jump out.
 		s_ip = s_funcSize;
 	}
+
+	inline void opLoadf(Instruction curInstr)
+	{
+		const u32 bits = u32(I_ARG12(curInstr));
+		f32 value;
+		memcpy(&value, &bits, sizeof(f32));
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(value);
+	}
+
+	inline void opLoadNull(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createNull();
+	}
+
+	inline void opIsub(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(u32(FS_REG_INT(I_ARG1(curInstr))) - u32(FS_REG_INT(I_ARG2(curInstr)))));
+	}
+
+	inline void opImul(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(u32(FS_REG_INT(I_ARG1(curInstr))) * u32(FS_REG_INT(I_ARG2(curInstr)))));
+	}
+
+	inline void opIdiv(Instruction curInstr)
+	{
+		const s32 a = FS_REG_INT(I_ARG1(curInstr));
+		const s32 b = FS_REG_INT(I_ARG2(curInstr));
+		s32 res;
+		if (b == 0) { res = 0; }
+		else if (b == -1) { res = s32(0u - u32(a)); }	// Avoid the INT_MIN / -1 overflow trap.
+		else { res = a / b; }
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(res);
+	}
+
+	inline void opImod(Instruction curInstr)
+	{
+		const s32 a = FS_REG_INT(I_ARG1(curInstr));
+		const s32 b = FS_REG_INT(I_ARG2(curInstr));
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt((b == 0 || b == -1) ? 0 : a % b);
+	}
+
+	inline void opIneg(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(0u - u32(FS_REG_INT(I_ARG1(curInstr)))));
+	}
+
+	inline void opIand(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) & FS_REG_INT(I_ARG2(curInstr)));
+	}
+
+	inline void opIor(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) | FS_REG_INT(I_ARG2(curInstr)));
+	}
+
+	inline void opIxor(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) ^ FS_REG_INT(I_ARG2(curInstr)));
+	}
+
+	inline void opIshl(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(s32(u32(FS_REG_INT(I_ARG1(curInstr))) << (FS_REG_INT(I_ARG2(curInstr)) & 31)));
+	}
+
+	inline void opIshr(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) >> (FS_REG_INT(I_ARG2(curInstr)) & 31));
+	}
+
+	inline void opFsub(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(FS_REG_FLOAT(I_ARG1(curInstr)) - FS_REG_FLOAT(I_ARG2(curInstr)));
+	}
+
+	inline void opFmul(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(FS_REG_FLOAT(I_ARG1(curInstr)) * FS_REG_FLOAT(I_ARG2(curInstr)));
+	}
+
+	inline void opFdiv(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(FS_REG_FLOAT(I_ARG1(curInstr)) / FS_REG_FLOAT(I_ARG2(curInstr)));
+	}
+
+	inline void opFneg(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(-FS_REG_FLOAT(I_ARG1(curInstr)));
+	}
+
+	inline void opIeq(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) == FS_REG_INT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opIne(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) != FS_REG_INT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opIlt(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) < FS_REG_INT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opIle(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_INT(I_ARG1(curInstr)) <= FS_REG_INT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opFeq(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_FLOAT(I_ARG1(curInstr)) == FS_REG_FLOAT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opFne(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_FLOAT(I_ARG1(curInstr)) != FS_REG_FLOAT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opFlt(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_FLOAT(I_ARG1(curInstr)) < FS_REG_FLOAT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opFle(Instruction curInstr)
+	{
+		s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(FS_REG_FLOAT(I_ARG1(curInstr)) <= FS_REG_FLOAT(I_ARG2(curInstr)) ? 1 : 0);
+	}
+
+	inline void opJz(Instruction curInstr)
+	{
+		if (FS_REG_INT(I_ARG0(curInstr)) == 0) { s_ip = I_ARG1(curInstr); }
+	}
+
+	inline void opJnz(Instruction curInstr)
+	{
+		if (FS_REG_INT(I_ARG0(curInstr)) != 0) { s_ip = I_ARG1(curInstr); }
+	}
+
+	inline void opJle(Instruction curInstr)
+	{
+		if (FS_REG_INT(I_ARG0(curInstr)) <= FS_REG_INT(I_ARG1(curInstr))) { s_ip = I_ARG2(curInstr); }
+	}
+
+	inline void opJeq(Instruction curInstr)
+	{
+		if (FS_REG_INT(I_ARG0(curInstr)) == FS_REG_INT(I_ARG1(curInstr))) { s_ip = I_ARG2(curInstr); }
+	}
+
+	inline void opJne(Instruction curInstr)
+	{
+		if (FS_REG_INT(I_ARG0(curInstr)) != FS_REG_INT(I_ARG1(curInstr))) { s_ip = I_ARG2(curInstr); }
+	}
+
+	inline void opJfl(Instruction curInstr)
+	{
+		if (FS_REG_FLOAT(I_ARG0(curInstr)) < FS_REG_FLOAT(I_ARG1(curInstr))) { s_ip = I_ARG2(curInstr); }
+	}
+
+	inline void opJfle(Instruction curInstr)
+	{
+		if (FS_REG_FLOAT(I_ARG0(curInstr)) <= FS_REG_FLOAT(I_ARG1(curInstr))) { s_ip = I_ARG2(curInstr); }
+	}
+
+	inline void opCall(Instruction curInstr)
+	{
+		// The callee changes the interpreter state, so the result is written back through the restored stack pointer.
+		const FsValue result = vm_callFunction(s32(I_ARG1(curInstr)), &s_stackPtr[I_ARG2(curInstr)]);
+		s_stackPtr[I_ARG0(curInstr)] = result;
+	}
+
+	inline void opCallNative(Instruction curInstr)
+	{
+		const FsNative* native = &s_natives[I_ARG1(curInstr)];
+		const FsValue result = native->func(&s_stackPtr[I_ARG2(curInstr)], native->argCount);
+		s_stackPtr[I_ARG0(curInstr)] = result;
+	}
+
+	inline void opGetField(Instruction curInstr)
+	{
+		const FsValue obj = s_stackPtr[I_ARG1(curInstr)];
+		if (!fsValue_isRef(obj))
+		{
+			s_stackPtr[I_ARG0(curInstr)] = fsValue_createNull();
+			return;
+		}
+
+		const FsFieldInfo* field = &s_fields[I_ARG2(curInstr)];
+		const u8* data = (u8*)fsValue_getVoidPointer(obj) + field->offset;
+		switch (field->type)
+		{
+			case FS_FIELD_INT:     { s_stackPtr[I_ARG0(curInstr)] = fsValue_createInt(*((s32*)data)); } break;
+			case FS_FIELD_FLOAT:   { s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(*((f32*)data)); } break;
+			case FS_FIELD_FIXED16: { s_stackPtr[I_ARG0(curInstr)] = fsValue_createFloat(f32(*((s32*)data)) * (1.0f / 65536.0f)); } break;
+			default:               { s_stackPtr[I_ARG0(curInstr)] = fsValue_createNull(); }
+		}
+	}
+
+	inline void opSetField(Instruction curInstr)
+	{
+		const FsValue obj = s_stackPtr[I_ARG0(curInstr)];
+		if (!fsValue_isRef(obj)) { return; }
+
+		const FsFieldInfo* field = &s_fields[I_ARG1(curInstr)];
+		const FsValue* value = &s_stackPtr[I_ARG2(curInstr)];
+		u8* data = (u8*)fsValue_getVoidPointer(obj) + field->offset;
+		switch (field->type)
+		{
+			case FS_FIELD_INT:     { *((s32*)data) = fsValue_readAsInt(value); } break;
+			case FS_FIELD_FLOAT:   { *((f32*)data) = fsValue_readAsFloat(value); } break;
+			case FS_FIELD_FIXED16: { *((s32*)data) = s32(fsValue_readAsFloat(value) * 65536.0f); } break;
+			default: break;
+		}
+	}
+
+	inline void opRetNull(Instruction curInstr)
+	{
+		s_retValue = fsValue_createNull();
+		s_ip = s_funcSize;
+	}
 }
-#endif
\ No newline at end of file
+#endif
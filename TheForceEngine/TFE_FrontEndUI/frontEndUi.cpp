@@ -4,6 +4,7 @@
 #include "modLoader.h"
 #include <TFE_Audio/audioSystem.h>
 #include <TFE_Audio/midiPlayer.h>
+#include <TFE_Audio/midiSynth.h>
 #include <TFE_DarkForces/config.h>
 #include <TFE_Game/reticle.h>
 #include <TFE_Game/saveSystem.h>
@@ -2033,6 +2034,10 @@ namespace TFE_FrontEndUI
 			graphics->asyncFramebuffer = true;
 			graphics->gpuColorConvert = true;
 			ImGui::Checkbox("Extend Adjoin/Portal Limits", &graphics->extendAjoinLimits);
+			// Only used for resolutions above 320x200.
+			ImGui::SetNextItemWidth(196 * s_uiScale);
+			ImGui::SliderInt("Render Threads", &graphics->renderThreadCount, 1, 16);
+			ImGui::Checkbox("Pipeline Frames (adds 1 frame of latency)", &graphics->pipelineFrames);
 		}
 		else if (graphics->rendererIndex == 1)
 		{
@@ -2057,7 +2062,15 @@ namespace TFE_FrontEndUI
 			{
 				graphics->skyMode = SkyMode(skyMode);
 			}
+
+			ImGui::SetNextItemWidth(196 * s_uiScale);
+			ImGui::SliderInt("Traversal Threads", &graphics->gpuTraversalThreadCount, 1, 16);
 		}
+
+		// Alt+F2 recording format.
+		ImGui::LabelText("##ConfigLabel", "Recording:"); ImGui::SameLine(75 * s_uiScale);
+		ImGui::SetNextItemWidth(196 * s_uiScale);
+		ImGui::Combo("##RecordingFormat", &graphics->recordingFormat, c_tfeRecordingFormatStrings, IM_ARRAYSIZE(c_tfeRecordingFormatStrings));
 		ImGui::Separator();
 
 		//////////////////////////////////////////////////////
@@ -2229,6 +2242,24 @@ namespace TFE_FrontEndUI
 			sound->disableSoundInMenus = disableSoundInMenus;
 		}
 
+		if (TFE_MidiSynth::isLoaded())
+		{
+			bool useMidiSynth = sound->useMidiSynth;
+			if (ImGui::Checkbox("Use the Built-in MIDI Synthesizer", &useMidiSynth))
+			{
+				sound->useMidiSynth = useMidiSynth;
+				TFE_MidiPlayer::useSoundFontSynth(useMidiSynth);
+			}
+			if (sound->useMidiSynth)
+			{
+				ImGui::SetNextItemWidth(196*s_uiScale);
+				if (ImGui::SliderInt("Synthesizer Voices", &sound->midiSynthPolyphony, 8, TFE_MidiSynth::SYNTH_MAX_POLYPHONY))
+				{
+					TFE_MidiSynth::setPolyphony(u32(sound->midiSynthPolyphony));
+				}
+			}
+		}
+
 		TFE_Audio::setVolume(sound->soundFxVolume);
 		TFE_MidiPlayer::setVolume(sound->musicVolume);
 	}
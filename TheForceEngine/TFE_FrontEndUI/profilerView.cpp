@@ -9,13 +9,20 @@
 #include <TFE_Ui/ui.h>
 #include <TFE_Ui/markdown.h>
 #include <TFE_System/parser.h>
+#include <TFE_Memory/memoryTracker.h>
 
 #include <TFE_Ui/imGUI/imgui.h>
 #include <algorithm>
 
 namespace TFE_ProfilerView
 {
+	// Number of frames written by "Export Recent Frames".
+	#define PROFILER_RECENT_FRAMES 120
+	// Number of allocation sites shown in the memory view.
+	#define PROFILER_MEMORY_SITES 12
+
 	static bool s_open = false;
+	static char s_tracePath[TFE_MAX_PATH] = { 0 };
 
 	bool init()
 	{
@@ -26,6 +33,53 @@ namespace TFE_ProfilerView
 	{
 	}
 
+	void drawMemory()
+	{
+		ImGui::Spacing();
+		ImGui::LabelText("##Label", "Memory");
+		ImGui::Separator();
+		ImGui::Indent();
+
+		const u32 regionCount = TFE_Memory::memtrack_getRegionCount();
+		for (u32 r = 0; r < regionCount; r++)
+		{
+			MemTrackRegionInfo info;
+			if (!TFE_Memory::memtrack_getRegionInfo(r, &info)) { break; }
+			ImGui::Text("%s", info.name); ImGui::SameLine(128);
+			ImGui::Text("%0.2f / %0.2f MB, high water %0.2f MB, %zu blocks, fragmentation %0.1f%%", f64(info.used) / (1024.0 * 1024.0),
+				f64(info.capacity) / (1024.0 * 1024.0), f64(info.highWater) / (1024.0 * 1024.0), info.blockCount, info.worstFragmentation * 100.0f);
+		}
+		ImGui::Spacing();
+
+		bool tracking = TFE_Memory::memtrack_isEnabled();
+		if (ImGui::Checkbox("Track Allocations", &tracking))
+		{
+			TFE_Memory::memtrack_enable(tracking);
+		}
+		if (tracking)
+		{
+			ImGui::SameLine();
+			if (ImGui::Button("Reset Peaks"))
+			{
+				TFE_Memory::memtrack_reset();
+			}
+
+			MemTrackFrameStats frame;
+			TFE_Memory::memtrack_getFrameStats(&frame);
+			ImGui::Text("Frame: %u allocations (%zu bytes), %u frees (%zu bytes)", frame.allocCount, frame.allocBytes, frame.freeCount, frame.freeBytes);
+
+			MemTrackSiteInfo sites[PROFILER_MEMORY_SITES];
+			const u32 siteCount = TFE_Memory::memtrack_getTopSites(MEMTRACK_SORT_LIVE_BYTES, sites, PROFILER_MEMORY_SITES);
+			for (u32 s = 0; s < siteCount; s++)
+			{
+				ImGui::Text("%8zu B %5u live %4u/frame", sites[s].liveBytes, sites[s].liveCount, sites[s].frameCount);
+				ImGui::SameLine(256);
+				ImGui::Text("%s  [%s, %s]", sites[s].label, TFE_Memory::memtrack_getKindName(sites[s].kind), sites[s].regionName);
+			}
+		}
+		ImGui::Unindent();
+	}
+
 	void update()
 	{
 		if (!s_open) { return; }
@@ -34,6 +88,31 @@ namespace TFE_ProfilerView
 		ImGui::SetNextWindowSize(ImVec2(800, 768));
 		ImGui::Begin("Profiler View", &s_open);
 
+		// Chrome trace export, these can be viewed in chrome://tracing or Perfetto.
+		if (!TFE_Profiler::isCapturing())
+		{
+			if (ImGui::Button("Begin Capture"))
+			{
+				TFE_Profiler::captureBegin();
+			}
+		}
+		else if (ImGui::Button("End Capture"))
+		{
+			TFE_Paths::appendPath(TFE_PathType::PATH_USER_DOCUMENTS, "profile_capture.json", s_tracePath);
+			if (!TFE_Profiler::captureEnd(s_tracePath)) { s_tracePath[0] = 0; }
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Export Recent Frames"))
+		{
+			TFE_Paths::appendPath(TFE_PathType::PATH_USER_DOCUMENTS, "profile_recent.json", s_tracePath);
+			if (!TFE_Profiler::exportRecentFrames(s_tracePath, PROFILER_RECENT_FRAMES)) { s_tracePath[0] = 0; }
+		}
+		if (s_tracePath[0])
+		{
+			ImGui::Text("Trace written to %s", s_tracePath);
+		}
+		ImGui::Spacing();
+
 		ImGui::LabelText("##Label", "Counters");
 		ImGui::Separator();
 		u32 counterCount = TFE_Profiler::getCounterCount();
@@ -81,6 +160,7 @@ namespace TFE_ProfilerView
 		ImGui::Unindent();
 		ImGui::Unindent();
 
+		drawMemory();
 		ImGui::End();
 	}
 
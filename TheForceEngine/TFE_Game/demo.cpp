@@ -0,0 +1,331 @@
+#include <cstring>
+
+#include "demo.h"
+#include <TFE_Input/inputMapping.h>
+#include <TFE_System/system.h>
+#include <TFE_FileSystem/filestream.h>
+#include <string>
+#include <vector>
+
+using namespace TFE_Input;
+
+namespace TFE_Demo
+{
+	enum DemoConst
+	{
+		DEMO_MAGIC   = 0x44454654,	// 'TFED'
+		DEMO_VERSION = 1,
+	};
+
+	enum DemoFrameFlags
+	{
+		DFRAME_INPUT = FLAG_BIT(0),	// the input was captured this frame.
+		DFRAME_HASH  = FLAG_BIT(1),	// the state hash was computed this frame.
+	};
+
+	enum DemoMode
+	{
+		DEMO_NONE = 0,
+		DEMO_RECORD,
+		DEMO_PLAYBACK,
+	};
+
+	struct DemoFrame
+	{
+		f64 dt;
+		u64 hash;
+		InputReplayFrame input;
+		u32 flags;	// see DemoFrameFlags.
+	};
+
+	// Mouse settings affect how the recorded mouse movement is applied, so they are stored with the demo.
+	struct DemoMouseConfig
+	{
+		u32 mouseMode;
+		u32 mouseFlags;
+		f32 mouseSensitivity[2];
+	};
+
+	static DemoMode s_mode = DEMO_NONE;
+	static std::string s_path;
+	static std::string s_levelName;
+	static u32 s_seed = 0;
+	static DemoMouseConfig s_mouseConfig;
+	static DemoMouseConfig s_prevMouseConfig;
+
+	static std::vector<DemoFrame> s_frames;
+	static DemoFrame* s_curFrame = nullptr;
+	static u32 s_frameIndex = 0;
+	static u32 s_divergenceCount = 0;
+
+	void getMouseConfig(DemoMouseConfig* config)
+	{
+		InputConfig* inputConfig = inputMapping_get();
+		config->mouseMode  = u32(inputConfig->mouseMode);
+		config->mouseFlags = inputConfig->mouseFlags;
+		config->mouseSensitivity[0] = inputConfig->mouseSensitivity[0];
+		config->mouseSensitivity[1] = inputConfig->mouseSensitivity[1];
+	}
+
+	void setMouseConfig(const DemoMouseConfig* config)
+	{
+		InputConfig* inputConfig = inputMapping_get();
+		inputConfig->mouseMode  = MouseMode(config->mouseMode);
+		inputConfig->mouseFlags = config->mouseFlags;
+		inputConfig->mouseSensitivity[0] = config->mouseSensitivity[0];
+		inputConfig->mouseSensitivity[1] = config->mouseSensitivity[1];
+	}
+
+	void serializeFrame(FileStream& file, DemoFrame* frame, bool write)
+	{
+		if (write)
+		{
+			file.write(&frame->dt);
+			file.write(&frame->hash);
+			file.write(frame->input.mouseMove, 2);
+			file.write(frame->input.axis, AA_COUNT);
+			file.write(frame->input.actions, IA_COUNT);
+			file.write(&frame->flags);
+		}
+		else
+		{
+			file.read(&frame->dt);
+			file.read(&frame->hash);
+			file.read(frame->input.mouseMove, 2);
+			file.read(frame->input.axis, AA_COUNT);
+			file.read(frame->input.actions, IA_COUNT);
+			file.read(&frame->flags);
+		}
+	}
+
+	bool writeDemo()
+	{
+		FileStream file;
+		if (!file.open(s_path.c_str(), Stream::MODE_WRITE))
+		{
+			TFE_System::logWrite(LOG_ERROR, "Demo", "Cannot write demo '%s'.", s_path.c_str());
+			return false;
+		}
+
+		const u32 magic = DEMO_MAGIC;
+		const u32 version = DEMO_VERSION;
+		const u32 actionCount = IA_COUNT;
+		const u32 axisCount = AA_COUNT;
+		const u32 frameCount = (u32)s_frames.size();
+		file.write(&magic);
+		file.write(&version);
+		file.write(&actionCount);
+		file.write(&axisCount);
+		file.write(&s_levelName);
+		file.write(&s_seed);
+		file.write(&s_mouseConfig.mouseMode);
+		file.write(&s_mouseConfig.mouseFlags);
+		file.write(s_mouseConfig.mouseSensitivity, 2);
+		file.write(&frameCount);
+		for (u32 i = 0; i < frameCount; i++)
+		{
+			serializeFrame(file, &s_frames[i], true);
+		}
+		file.close();
+
+		TFE_System::logWrite(LOG_MSG, "Demo", "Recorded %u frames to '%s'.", frameCount, s_path.c_str());
+		return true;
+	}
+
+	bool readDemo()
+	{
+		FileStream file;
+		if (!file.open(s_path.c_str(), Stream::MODE_READ))
+		{
+			TFE_System::logWrite(LOG_ERROR, "Demo", "Cannot open demo '%s'.", s_path.c_str());
+			return false;
+		}
+
+		u32 magic, version, actionCount, axisCount, frameCount;
+		file.read(&magic);
+		file.read(&version);
+		file.read(&actionCount);
+		file.read(&axisCount);
+		if (magic != DEMO_MAGIC || version != DEMO_VERSION || actionCount != IA_COUNT || axisCount != AA_COUNT)
+		{
+			TFE_System::logWrite(LOG_ERROR, "Demo", "'%s' is not a valid demo or was recorded with an incompatible version.", s_path.c_str());
+			file.close();
+			return false;
+		}
+		file.read(&s_levelName);
+		file.read(&s_seed);
+		file.read(&s_mouseConfig.mouseMode);
+		file.read(&s_mouseConfig.mouseFlags);
+		file.read(s_mouseConfig.mouseSensitivity, 2);
+		file.read(&frameCount);
+
+		s_frames.resize(frameCount);
+		for (u32 i = 0; i < frameCount; i++)
+		{
+			serializeFrame(file, &s_frames[i], false);
+		}
+		file.close();
+		return true;
+	}
+
+	void reset()
+	{
+		s_mode = DEMO_NONE;
+		s_frames.clear();
+		s_curFrame = nullptr;
+		s_frameIndex = 0;
+		s_divergenceCount = 0;
+		s_seed = 0;
+	}
+
+	bool startRecording(const char* path, const char* levelName)
+	{
+		stop();
+		s_path = path;
+		s_levelName = levelName;
+		getMouseConfig(&s_mouseConfig);
+		s_mode = DEMO_RECORD;
+
+		TFE_System::enableVirtualTime(true);
+		TFE_System::logWrite(LOG_MSG, "Demo", "Recording demo '%s' on level '%s'.", path, levelName);
+		return true;
+	}
+
+	bool startPlayback(const char* path)
+	{
+		stop();
+		s_path = path;
+		if (!readDemo())
+		{
+			reset();
+			return false;
+		}
+		getMouseConfig(&s_prevMouseConfig);
+		setMouseConfig(&s_mouseConfig);
+		s_mode = DEMO_PLAYBACK;
+
+		TFE_System::enableVirtualTime(true);
+		TFE_System::logWrite(LOG_MSG, "Demo", "Playing demo '%s' on level '%s', %u frames.", path, s_levelName.c_str(), (u32)s_frames.size());
+		return true;
+	}
+
+	void stop()
+	{
+		if (s_mode == DEMO_RECORD)
+		{
+			writeDemo();
+		}
+		else if (s_mode == DEMO_PLAYBACK)
+		{
+			if (s_divergenceCount)
+			{
+				TFE_System::logWrite(LOG_WARNING, "Demo", "Demo playback diverged from the recording on %u of %u frames.", s_divergenceCount, s_frameIndex);
+			}
+			else
+			{
+				TFE_System::logWrite(LOG_MSG, "Demo", "Demo playback matched the recording for %u frames.", s_frameIndex);
+			}
+			setMouseConfig(&s_prevMouseConfig);
+			inputMapping_endReplay();
+		}
+		else
+		{
+			return;
+		}
+
+		TFE_System::enableVirtualTime(false);
+		const u32 divergenceCount = s_divergenceCount;
+		reset();
+		// Keep the result around so it can be queried after playback.
+		s_divergenceCount = divergenceCount;
+	}
+
+	bool isRecording()
+	{
+		return s_mode == DEMO_RECORD;
+	}
+
+	bool isPlaying()
+	{
+		return s_mode == DEMO_PLAYBACK;
+	}
+
+	const char* getLevelName()
+	{
+		return s_levelName.c_str();
+	}
+
+	void onGameCreated(IGame* game)
+	{
+		if (!game) { return; }
+		if (s_mode == DEMO_RECORD)
+		{
+			s_seed = game->getRandomSeed();
+		}
+		else if (s_mode == DEMO_PLAYBACK)
+		{
+			game->setRandomSeed(s_seed);
+		}
+	}
+
+	void updateTime()
+	{
+		s_curFrame = nullptr;
+		if (s_mode == DEMO_RECORD)
+		{
+			s_frames.push_back({});
+			s_curFrame = &s_frames.back();
+			s_curFrame->dt = TFE_System::getDeltaTime();
+			s_frameIndex++;
+		}
+		else if (s_mode == DEMO_PLAYBACK && s_frameIndex < (u32)s_frames.size())
+		{
+			s_curFrame = &s_frames[s_frameIndex];
+			s_frameIndex++;
+			TFE_System::setFrameDeltaTime(s_curFrame->dt);
+		}
+	}
+
+	void updateInput()
+	{
+		if (!s_curFrame) { return; }
+
+		if (s_mode == DEMO_RECORD)
+		{
+			inputMapping_captureReplayFrame(&s_curFrame->input);
+			s_curFrame->flags |= DFRAME_INPUT;
+		}
+		else if (s_curFrame->flags & DFRAME_INPUT)
+		{
+			inputMapping_applyReplayFrame(&s_curFrame->input);
+		}
+	}
+
+	bool endFrame(IGame* game)
+	{
+		if (!s_curFrame) { return s_mode != DEMO_PLAYBACK; }
+
+		const u64 hash = game ? game->getStateHash() : 0;
+		if (s_mode == DEMO_RECORD)
+		{
+			s_curFrame->hash = hash;
+			s_curFrame->flags |= DFRAME_HASH;
+		}
+		else if ((s_curFrame->flags & DFRAME_HASH) && s_curFrame->hash != hash)
+		{
+			if (!s_divergenceCount)
+			{
+				TFE_System::logWrite(LOG_ERROR, "Demo", "Demo playback diverged from the recording at frame %u.", s_frameIndex - 1);
+			}
+			s_divergenceCount++;
+		}
+
+		s_curFrame = nullptr;
+		return s_mode != DEMO_PLAYBACK || s_frameIndex < (u32)s_frames.size();
+	}
+
+	u32 getDivergenceCount()
+	{
+		return s_divergenceCount;
+	}
+}
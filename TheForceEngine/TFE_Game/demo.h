@@ -0,0 +1,38 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Demo recording and playback.
+// A demo holds the mapped input state, the delta time and a hash of
+// the game state for every frame, along with the random seed at the
+// start of the game. During playback the recorded values replace the
+// live input and timing, so the exact same simulation runs every time
+// (see the -recorddemo and -playdemo command line options).
+//
+// The state hash is checked every frame during playback so that any
+// divergence is detected and reported.
+//////////////////////////////////////////////////////////////////////
+#include "igame.h"
+
+namespace TFE_Demo
+{
+	bool startRecording(const char* path, const char* levelName);
+	bool startPlayback(const char* path);
+	// Stop recording or playback, a recording is written to disk at this point.
+	void stop();
+
+	bool isRecording();
+	bool isPlaying();
+	const char* getLevelName();
+
+	// Call once the game has been created but before it is run.
+	void onGameCreated(IGame* game);
+	// Call after TFE_System::update(), this records or replaces the frame delta time.
+	void updateTime();
+	// Call after the input mapping has been updated and before the game is updated.
+	void updateInput();
+	// Call after the game has been updated.
+	// Returns false once playback has reached the end of the demo.
+	bool endFrame(IGame* game);
+
+	// The number of frames where the game state did not match the recording.
+	u32 getDivergenceCount();
+}
@@ -1,5 +1,6 @@
 #include "igame.h"
 #include <TFE_FrontEndUI/console.h>
+#include <TFE_Memory/memoryTracker.h>
 #include <TFE_DarkForces/darkForcesMain.h>
 #include <TFE_Outlaws/outlawsMain.h>
 
@@ -31,12 +32,74 @@ void displayMemoryUsage(const ConsoleArgList& args)
 	TFE_Console::addToHistory("-------------------------------------------------------------------");
 }
 
+void memTrack(const ConsoleArgList& args)
+{
+	const bool enable = args.size() > 1 ? atoi(args[1].c_str()) != 0 : !memtrack_isEnabled();
+	memtrack_enable(enable);
+	TFE_Console::addToHistory(enable ? "Allocation tracking enabled." : "Allocation tracking disabled.");
+}
+
+void memReport(const ConsoleArgList& args)
+{
+	enum { REPORT_SITE_COUNT = 16 };
+	char res[256];
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+	TFE_Console::addToHistory("Region           | Memory Used | Capacity   | High Water | Blocks | Worst Fragmentation");
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+	const u32 regionCount = memtrack_getRegionCount();
+	for (u32 r = 0; r < regionCount; r++)
+	{
+		MemTrackRegionInfo info;
+		if (!memtrack_getRegionInfo(r, &info)) { break; }
+		sprintf(res, "%-16s | %11zu | %10zu | %10zu | %6zu | %5.1f%% (block %u)", info.name, info.used, info.capacity, info.highWater,
+			info.blockCount, info.worstFragmentation * 100.0f, info.worstBlock);
+		TFE_Console::addToHistory(res);
+	}
+
+	if (!memtrack_isEnabled())
+	{
+		TFE_Console::addToHistory("Allocation tracking is disabled, use \"memTrack 1\" to see the allocation sites.");
+		return;
+	}
+
+	MemTrackFrameStats frame;
+	memtrack_getFrameStats(&frame);
+	sprintf(res, "Last frame: %u allocations (%zu bytes), %u frees (%zu bytes)", frame.allocCount, frame.allocBytes, frame.freeCount, frame.freeBytes);
+	TFE_Console::addToHistory(res);
+
+	MemTrackSiteInfo sites[REPORT_SITE_COUNT];
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+	TFE_Console::addToHistory("Site (by live bytes)                  | Kind      | Region | Live Bytes | Live | Peak Bytes");
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+	u32 siteCount = memtrack_getTopSites(MEMTRACK_SORT_LIVE_BYTES, sites, REPORT_SITE_COUNT);
+	for (u32 s = 0; s < siteCount; s++)
+	{
+		sprintf(res, "%-37.37s | %-9s | %-6.6s | %10zu | %4u | %10zu", sites[s].label, memtrack_getKindName(sites[s].kind), sites[s].regionName,
+			sites[s].liveBytes, sites[s].liveCount, sites[s].peakBytes);
+		TFE_Console::addToHistory(res);
+	}
+
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+	TFE_Console::addToHistory("Site (by allocations per frame)       | Kind      | Region | Last Frame | Max Frame | Total");
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+	siteCount = memtrack_getTopSites(MEMTRACK_SORT_FRAME_COUNT, sites, REPORT_SITE_COUNT);
+	for (u32 s = 0; s < siteCount && sites[s].maxFrameCount; s++)
+	{
+		sprintf(res, "%-37.37s | %-9s | %-6.6s | %10u | %9u | %llu", sites[s].label, memtrack_getKindName(sites[s].kind), sites[s].regionName,
+			sites[s].frameCount, sites[s].maxFrameCount, (unsigned long long)sites[s].totalCount);
+		TFE_Console::addToHistory(res);
+	}
+	TFE_Console::addToHistory("----------------------------------------------------------------------------------");
+}
+
 void game_init()
 {
 	s_gameRegion  = region_create("game",  GAME_MEMORY_BASE);	// Region for "permanent" game allocations.
 	s_levelRegion = region_create("level", LEVEL_MEMORY_BASE);	// Region for "per-level" game allocations.
 
 	CCMD("displayMemoryUsage", displayMemoryUsage, 0, "Display memory usage.");
+	CCMD("memTrack", memTrack, 0, "Enable or disable allocation tracking, toggles if no value is given - memTrack 0/1");
+	CCMD("memReport", memReport, 0, "Display region high-water marks and fragmentation, and the top allocation sites when tracking is enabled.");
 }
 
 void game_destroy()
@@ -6,16 +6,17 @@
 //////////////////////////////////////////////////////////////////////
 #include <TFE_Settings/gameSourceData.h>
 #include <TFE_Memory/memoryRegion.h>
+#include <TFE_Memory/memoryTracker.h>
 
 extern MemoryRegion* s_gameRegion;
 extern MemoryRegion* s_levelRegion;
 
-#define game_alloc(size) TFE_Memory::region_alloc(s_gameRegion, size)
-#define game_realloc(ptr, size) TFE_Memory::region_realloc(s_gameRegion, ptr, size)
+#define game_alloc(size) (TFE_ALLOC_SITE(), TFE_Memory::region_alloc(s_gameRegion, size))
+#define game_realloc(ptr, size) (TFE_ALLOC_SITE(), TFE_Memory::region_realloc(s_gameRegion, ptr, size))
 #define game_free(ptr) TFE_Memory::region_free(s_gameRegion, ptr)
 
-#define level_alloc(size) TFE_Memory::region_alloc(s_levelRegion, size)
-#define level_realloc(ptr, size) TFE_Memory::region_realloc(s_levelRegion, ptr, size)
+#define level_alloc(size) (TFE_ALLOC_SITE(), TFE_Memory::region_alloc(s_levelRegion, size))
+#define level_realloc(ptr, size) (TFE_ALLOC_SITE(), TFE_Memory::region_realloc(s_levelRegion, ptr, size))
 #define level_free(ptr) TFE_Memory::region_free(s_levelRegion, ptr)
 
 struct IGame
@@ -29,6 +30,10 @@ struct IGame
 	virtual bool canSave() { return false; }
 	virtual void getLevelName(char* name) {};
 	virtual void getModList(char* modList) {};
+	// Used to record and replay demos (see TFE_Demo).
+	virtual u32  getRandomSeed() { return 0; }
+	virtual void setRandomSeed(u32 seed) {};
+	virtual u64  getStateHash() { return 0; }
 		
 	GameID id;
 };
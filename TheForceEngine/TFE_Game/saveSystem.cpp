@@ -3,10 +3,24 @@
 #include <TFE_System/system.h>
 #include <TFE_Settings/gameSourceData.h>
 #include <TFE_FileSystem/fileutil.h>
+#include <TFE_FileSystem/filestream.h>
+#include <TFE_FileSystem/memorystream.h>
+#include <TFE_FileSystem/inflateStream.h>
+#include <TFE_FileSystem/filewriterAsync.h>
+#include <TFE_System/profiler.h>
 
 #include <TFE_RenderBackend/renderBackend.h>
 #include <TFE_Asset/imageAsset.h>
 #include <assert.h>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// The miniz implementation is compiled with the zip library.
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <TFE_Archive/zip/miniz.h>
 
 using namespace TFE_Input;
 
@@ -22,7 +36,25 @@ namespace TFE_SaveSystem
 	enum SaveMasterVersion
 	{
 		SVER_INIT = 1,
-		SVER_CUR = SVER_INIT
+		SVER_COMPRESSED,	// The thumbnail and game state are zlib compressed.
+		SVER_CUR = SVER_COMPRESSED
+	};
+
+	// Everything needed to write a save, captured on the main thread.
+	// The thumbnail, compression and file write are handled by the file writer thread.
+	struct SaveJob
+	{
+		std::string filePath;
+		std::string saveName;
+		std::string dateTime;
+		std::string levelName;
+		std::string modList;
+
+		std::vector<u32> screen;
+		u32 screenWidth;
+		u32 screenHeight;
+
+		MemoryStream state;
 	};
 
 	static SaveRequest s_req = SF_REQ_NONE;
@@ -32,26 +64,16 @@ namespace TFE_SaveSystem
 	static IGame* s_game = nullptr;
 	static s32 s_saveDelay = 0;
 
-	static u32* s_imageBuffer[2] = { nullptr, nullptr };
-	static size_t s_imageBufferSize[2] = { 0 };
+	// Used to read the thumbnail when loading headers.
+	static u8* s_imageBuffer = nullptr;
+	static size_t s_imageBufferSize = 0;
 
-	void saveHeader(Stream* stream, const char* saveName)
+	// Scale and crop the image to fit inside 426 x 240 (widescreen).
+	void scaleThumbnail(const u32* screen, u32 width, u32 height, u32* dst)
 	{
-		// Generate a screenshot.
-		DisplayInfo displayInfo;
-		TFE_RenderBackend::getDisplayInfo(&displayInfo);
-		size_t size = displayInfo.width * displayInfo.height * 4;
-		if (size > s_imageBufferSize[0])
-		{
-			s_imageBuffer[0] = (u32*)realloc(s_imageBuffer[0], size);
-			s_imageBufferSize[0] = size;
-		}
-		TFE_RenderBackend::captureScreenToMemory(s_imageBuffer[0]);
-
-		// Scale and crop the image to fit inside 426 x 240 (widescreen).
-		s64 scale = SAVE_IMAGE_HEIGHT * 65536 / displayInfo.height;
-		s64 invScale = displayInfo.height * 65536 / SAVE_IMAGE_HEIGHT;
-		s32 scaledWidth = s32((displayInfo.width * scale) >> 16ll);
+		s64 scale = SAVE_IMAGE_HEIGHT * 65536 / height;
+		s64 invScale = height * 65536 / SAVE_IMAGE_HEIGHT;
+		s32 scaledWidth = s32((width * scale) >> 16ll);
 		s32 newWidth = SAVE_IMAGE_WIDTH, newHeight = SAVE_IMAGE_HEIGHT;
 
 		s32 dstOffset = 0;
@@ -66,15 +88,7 @@ namespace TFE_SaveSystem
 			srcOffset = srcOffset * invScale;
 		}
 
-		size_t newSize = newWidth * newHeight * 4;
-		if (newSize > s_imageBufferSize[1])
-		{
-			s_imageBuffer[1] = (u32*)realloc(s_imageBuffer[1], newSize);
-			s_imageBufferSize[1] = newSize;
-		}
-
 		const u32 *src;
-		u32* dst = s_imageBuffer[1];
 		memset(dst, 0, newWidth * newHeight * 4);
 
 		s64 u  = srcOffset, v = 0;
@@ -82,55 +96,114 @@ namespace TFE_SaveSystem
 		for (s32 y = 0; y < newHeight; y++, v += dv, dst += newWidth)
 		{
 			u = srcOffset;
-			src = &s_imageBuffer[0][(v >> 16ll) * displayInfo.width];
+			src = &screen[(v >> 16ll) * width];
 			for (s32 x = dstOffset; x < newWidth - dstOffset; x++, u += du)
 			{
 				dst[x] = src[u >> 16ll];
 			}
 		}
+	}
+
+	void appendData(std::vector<u8>& buffer, const void* data, size_t size)
+	{
+		const u8* bytes = (const u8*)data;
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	void appendString(std::vector<u8>& buffer, const std::string& str, size_t maxLen)
+	{
+		u8 len = (u8)std::min(str.length(), maxLen);
+		appendData(buffer, &len, 1);
+		appendData(buffer, str.data(), len);
+	}
+
+	// Compress 'size' bytes and append them to the buffer, prefixed by the compressed size.
+	bool appendCompressed(std::vector<u8>& buffer, const void* data, size_t size)
+	{
+		const size_t start = buffer.size();
+		mz_ulong compressedSize = mz_compressBound((mz_ulong)size);
+		buffer.resize(start + sizeof(u32) + compressedSize);
+		if (mz_compress2(buffer.data() + start + sizeof(u32), &compressedSize, (const u8*)data, (mz_ulong)size, MZ_DEFAULT_LEVEL) != MZ_OK)
+		{
+			return false;
+		}
+		const u32 compressedSize32 = (u32)compressedSize;
+		memcpy(buffer.data() + start, &compressedSize32, sizeof(u32));
+		buffer.resize(start + sizeof(u32) + compressedSize);
+		return true;
+	}
 
-		// Save to memory.
-		u8* png;
-		u32 pngSize = (u32)TFE_Image::writeImageToMemory(png, newWidth, newHeight, s_imageBuffer[1]);
+	// Called from the file writer thread.
+	bool saveJobPrepare(std::vector<u8>& buffer, void* userData)
+	{
+		TFE_ZONE("Save Game");
+		SaveJob* job = (SaveJob*)userData;
 
 		// Master version.
 		u32 version = SVER_CUR;
-		stream->write(&version);
+		appendData(buffer, &version, sizeof(u32));
 
-		// Save Name.
-		size_t saveNameLen = strlen(saveName);
-		if (saveNameLen > SAVE_MAX_NAME_LEN - 1) { saveNameLen = SAVE_MAX_NAME_LEN - 1; }
-		u8 len = (u8)saveNameLen;
-		stream->write(&len);
-		stream->writeBuffer(saveName, len);
+		// Save Name, Time and Date of Save, Level Name and Mod List.
+		appendString(buffer, job->saveName, SAVE_MAX_NAME_LEN - 1);
+		appendString(buffer, job->dateTime, 255);
+		appendString(buffer, job->levelName, 255);
+		appendString(buffer, job->modList, 255);
 
-		// Time and Date of Save.
-		char timeDate[256];
-		TFE_System::getDateTimeString(timeDate);
-		len = (u8)strlen(timeDate);
-		stream->write(&len);
-		stream->writeBuffer(timeDate, len);
+		// Image.
+		std::vector<u32> image(SAVE_IMAGE_WIDTH * SAVE_IMAGE_HEIGHT);
+		scaleThumbnail(job->screen.data(), job->screenWidth, job->screenHeight, image.data());
+		if (!appendCompressed(buffer, image.data(), image.size() * sizeof(u32)))
+		{
+			return false;
+		}
 
-		// Level Name
-		char levelName[256];
-		s_game->getLevelName(levelName);
-		len = (u8)strlen(levelName);
-		stream->write(&len);
-		stream->writeBuffer(levelName, len);
+		// Game state, the uncompressed size is stored so it can be decompressed while loading.
+		const u32 stateSize = (u32)job->state.getSize();
+		appendData(buffer, &stateSize, sizeof(u32));
+		return appendCompressed(buffer, job->state.data(), stateSize);
+	}
 
-		// Mod List
-		char modList[256];
-		s_game->getModList(modList);
-		len = (u8)strlen(modList);
-		stream->write(&len);
-		stream->writeBuffer(modList, len);
+	// Called from the file writer thread.
+	void saveJobComplete(size_t bytesWritten, void* userData, u32 errorCode)
+	{
+		SaveJob* job = (SaveJob*)userData;
+		if (errorCode != AFW_SUCCESS)
+		{
+			TFE_System::logWrite(LOG_ERROR, "Save", "Failed to write save game '%s', error %u.", job->filePath.c_str(), errorCode);
+		}
+		delete job;
+	}
 
-		// Image.
-		stream->write(&pngSize);
-		stream->writeBuffer(png, pngSize);
+	void loadThumbnail(Stream* stream, u32 version, SaveHeader* header)
+	{
+		// Image, PNG for the initial version and compressed pixels after.
+		u32 imageSize;
+		stream->read(&imageSize);
+		if (imageSize > s_imageBufferSize)
+		{
+			s_imageBuffer = (u8*)realloc(s_imageBuffer, imageSize);
+			s_imageBufferSize = imageSize;
+		}
+		stream->readBuffer(s_imageBuffer, imageSize);
+
+		if (version < SVER_COMPRESSED)
+		{
+			Image image = { 0 };
+			image.data = header->imageData;
+			TFE_Image::readImageFromMemory(&image, imageSize, (u32*)s_imageBuffer);
+			assert(image.width == SAVE_IMAGE_WIDTH && image.height == SAVE_IMAGE_HEIGHT);
+		}
+		else
+		{
+			mz_ulong pixelSize = SAVE_IMAGE_WIDTH * SAVE_IMAGE_HEIGHT * sizeof(u32);
+			if (mz_uncompress((u8*)header->imageData, &pixelSize, s_imageBuffer, imageSize) != MZ_OK)
+			{
+				memset(header->imageData, 0, sizeof(header->imageData));
+			}
+		}
 	}
 
-	void loadHeader(Stream* stream, SaveHeader* header)
+	u32 loadHeader(Stream* stream, SaveHeader* header)
 	{
 		// Master version.
 		u32 version;
@@ -159,24 +232,15 @@ namespace TFE_SaveSystem
 		stream->readBuffer(header->modNames, len);
 		header->modNames[len] = 0;
 
-		// Image, re-use buffer 0 for the PNG.
-		u32 pngSize;
-		stream->read(&pngSize);
-		if (pngSize > s_imageBufferSize[0])
-		{
-			s_imageBuffer[0] = (u32*)realloc(s_imageBuffer[0], pngSize);
-			s_imageBufferSize[0] = pngSize;
-		}
-		stream->readBuffer(s_imageBuffer[0], pngSize);
-
-		Image image = { 0 };
-		image.data = header->imageData;
-		TFE_Image::readImageFromMemory(&image, pngSize, s_imageBuffer[0]);
-		assert(image.width == SAVE_IMAGE_WIDTH && image.height == SAVE_IMAGE_HEIGHT);
+		loadThumbnail(stream, version, header);
+		return version;
 	}
 
 	void populateSaveDirectory(std::vector<SaveHeader>& dir)
 	{
+		// Make sure saves in flight show up.
+		FileWriterAsync::waitForQueuedWrites();
+
 		dir.clear();
 		FileList fileList;
 		FileUtil::readDirectory(s_gameSavePath, "tfe", fileList);
@@ -197,25 +261,71 @@ namespace TFE_SaveSystem
 
 	void destroy()
 	{
-		for (s32 i = 0; i < 2; i++)
-		{
-			free(s_imageBuffer[i]);
-			s_imageBufferSize[i] = 0;
-		}
+		// Finish writing any pending saves.
+		FileWriterAsync::shutdown();
+
+		free(s_imageBuffer);
+		s_imageBuffer = nullptr;
+		s_imageBufferSize = 0;
 	}
 
+	// Only the screen capture and game state snapshot happen here, the rest of the work is done by the file writer thread.
 	bool saveGame(const char* filename, const char* saveName)
 	{
+		TFE_ZONE("Save Game Snapshot");
+		SaveJob* job = new SaveJob();
+
 		char filePath[TFE_MAX_PATH];
 		sprintf(filePath, "%s%s", s_gameSavePath, filename);
+		job->filePath = filePath;
+		job->saveName = saveName;
 
-		bool ret = false;
-		FileStream stream;
-		if (stream.open(filePath, Stream::MODE_WRITE))
+		char timeDate[256];
+		TFE_System::getDateTimeString(timeDate);
+		job->dateTime = timeDate;
+
+		char levelName[256];
+		s_game->getLevelName(levelName);
+		job->levelName = levelName;
+
+		char modList[256];
+		s_game->getModList(modList);
+		job->modList = modList;
+
+		// Capture the screen for the thumbnail.
+		DisplayInfo displayInfo;
+		TFE_RenderBackend::getDisplayInfo(&displayInfo);
+		job->screenWidth = displayInfo.width;
+		job->screenHeight = displayInfo.height;
+		job->screen.resize(displayInfo.width * displayInfo.height);
+		TFE_RenderBackend::captureScreenToMemory(job->screen.data());
+
+		// Serialize the game state to memory.
+		job->state.open(Stream::MODE_WRITE);
+		bool ret = s_game->serializeGameState(&job->state, filename, true);
+		job->state.close();
+		if (!ret)
 		{
-			saveHeader(&stream, saveName);
-			ret = s_game->serializeGameState(&stream, filename, true);
-			stream.close();
+			delete job;
+			return false;
+		}
+
+		if (!FileWriterAsync::queueFileWrite(filePath, saveJobPrepare, job, saveJobComplete))
+		{
+			// Fallback to writing the save on this thread.
+			std::vector<u8> buffer;
+			ret = saveJobPrepare(buffer, job);
+			FileStream stream;
+			if (ret && stream.open(filePath, Stream::MODE_WRITE))
+			{
+				stream.writeBuffer(buffer.data(), (u32)buffer.size());
+				stream.close();
+			}
+			else
+			{
+				ret = false;
+			}
+			delete job;
 		}
 		return ret;
 	}
@@ -225,13 +335,35 @@ namespace TFE_SaveSystem
 		char filePath[TFE_MAX_PATH];
 		sprintf(filePath, "%s%s", s_gameSavePath, filename);
 
+		// The save being loaded may still be in the write queue.
+		FileWriterAsync::waitForQueuedWrites();
+
 		bool ret = false;
 		FileStream stream;
 		if (stream.open(filePath, Stream::MODE_READ))
 		{
 			SaveHeader header;
-			loadHeader(&stream, &header);
-			ret = s_game->serializeGameState(&stream, filename, false);
+			const u32 version = loadHeader(&stream, &header);
+
+			if (version >= SVER_COMPRESSED)
+			{
+				// Decompress the game state as it is read.
+				u32 stateSize;
+				stream.read(&stateSize);
+				u32 compressedSize;
+				stream.read(&compressedSize);
+
+				InflateStream state;
+				if (state.open(&stream, stateSize))
+				{
+					ret = s_game->serializeGameState(&state, filename, false);
+					state.close();
+				}
+			}
+			else
+			{
+				ret = s_game->serializeGameState(&stream, filename, false);
+			}
 			stream.close();
 		}
 		return ret;
@@ -45,6 +45,8 @@ namespace TFE_Input
 	f32 getAxis(Axis axis);
 	void getMouseMove(s32* x, s32* y);
 	void getAccumulatedMouseMove(s32* x, s32* y);
+	// Read the accumulated mouse movement without clearing it.
+	void peekAccumulatedMouseMove(s32* x, s32* y);
 	void getMousePos(s32* x, s32* y);
 	void getMouseWheel(s32* dx, s32* dy);
 	bool buttonDown(Button button);
@@ -57,6 +59,7 @@ namespace TFE_Input
 	bool relativeModeEnabled();
 	void clearKeyPressed(KeyboardCode key);
 	void clearAccumulatedMouseMove();
+	void setAccumulatedMouseMove(s32 x, s32 y);
 	// Buffered Input
 	const char* getBufferedText();
 	bool bufferedKeyDown(KeyboardCode key);
@@ -113,6 +113,9 @@ namespace TFE_Input
 
 	static InputConfig s_inputConfig = { 0 };
 	static ActionState s_actions[IA_COUNT];
+	// Analog axis values override the controller while a demo is replayed.
+	static f32 s_replayAxis[AA_COUNT];
+	static bool s_replayActive = false;
 		
 	void addDefaultControlBinds();
 			   
@@ -398,6 +401,10 @@ namespace TFE_Input
 
 	f32 inputMapping_getAnalogAxis(AnalogAxis axis)
 	{
+		if (s_replayActive)
+		{
+			return s_replayAxis[axis];
+		}
 		if (!(s_inputConfig.controllerFlags & CFLAG_ENABLE))
 		{
 			return 0.0f;
@@ -476,4 +483,36 @@ namespace TFE_Input
 	{
 		return &s_inputConfig;
 	}
+
+	void inputMapping_captureReplayFrame(InputReplayFrame* frame)
+	{
+		TFE_Input::peekAccumulatedMouseMove(&frame->mouseMove[0], &frame->mouseMove[1]);
+		for (u32 i = 0; i < AA_COUNT; i++)
+		{
+			frame->axis[i] = inputMapping_getAnalogAxis(AnalogAxis(i));
+		}
+		for (u32 i = 0; i < IA_COUNT; i++)
+		{
+			frame->actions[i] = u8(s_actions[i]);
+		}
+	}
+
+	void inputMapping_applyReplayFrame(const InputReplayFrame* frame)
+	{
+		TFE_Input::setAccumulatedMouseMove(frame->mouseMove[0], frame->mouseMove[1]);
+		for (u32 i = 0; i < AA_COUNT; i++)
+		{
+			s_replayAxis[i] = frame->axis[i];
+		}
+		for (u32 i = 0; i < IA_COUNT; i++)
+		{
+			s_actions[i] = ActionState(frame->actions[i]);
+		}
+		s_replayActive = true;
+	}
+
+	void inputMapping_endReplay()
+	{
+		s_replayActive = false;
+	}
 }  // TFE_DarkForces
\ No newline at end of file
@@ -164,6 +164,14 @@ namespace TFE_Input
 		f32 mouseSensitivity[2];// horizontal/vertical sensitivity.
 	};
 
+	// The mapped input state for a single frame, used to record and replay demos.
+	struct InputReplayFrame
+	{
+		s32 mouseMove[2];		// accumulated mouse movement.
+		f32 axis[AA_COUNT];		// analog axis values, after deadzone and sensitivity are applied.
+		u8  actions[IA_COUNT];	// see ActionState.
+	};
+
 	void inputMapping_startup();
 	void inputMapping_shutdown();
 	void inputMapping_resetToDefaults();
@@ -186,4 +194,12 @@ namespace TFE_Input
 	
 	f32 inputMapping_getHorzMouseSensitivity();
 	f32 inputMapping_getVertMouseSensitivity();
+
+	// Replay
+	// Capture the current frame state without consuming it.
+	void inputMapping_captureReplayFrame(InputReplayFrame* frame);
+	// Replace the current frame state, call after inputMapping_updateInput().
+	// Analog axis values come from the replay frame until inputMapping_endReplay() is called.
+	void inputMapping_applyReplayFrame(const InputReplayFrame* frame);
+	void inputMapping_endReplay();
 }  // TFE_Input
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <TFE_Jedi/Level/rsector.h>
 #include <TFE_Jedi/Level/rwall.h>
 #include <TFE_Jedi/Level/robject.h>
+#include <TFE_Jedi/Level/sectorGrid.h>
 #include <TFE_Jedi/Math/core_math.h>
 #include <TFE_Jedi/InfSystem/infSystem.h>
 // Merge player collision into collision
@@ -58,6 +59,14 @@ namespace TFE_Jedi
 
 	static const fixed16_16 c_maxCollisionDist = FIXED(9999);
 	static const fixed16_16 c_minTraversableOpening = HALF_16;
+	// Objects are expected to be inside of their sector bounds, this adds some slack for objects sitting right on the edge.
+	// Range queries fall back to scanning every sector if a candidate sector has an object outside of this margin.
+	static const fixed16_16 c_rangeSectorMargin = FIXED(2);
+
+	enum RangeQueryConstants
+	{
+		RANGE_QUERY_MAX_DEPTH = 4,	// Effect functions may start another range query.
+	};
 
 	enum IntersectionResult
 	{
@@ -72,6 +81,9 @@ namespace TFE_Jedi
 	JBool s_collision_wallHit = JFALSE;
 	u32 s_collision_excludeEntityFlags = 0;
 	static ColPath s_col_path;
+	// Candidate sectors for the range queries, one list per nesting level.
+	static std::vector<s32> s_rangeSectors[RANGE_QUERY_MAX_DEPTH];
+	static s32 s_rangeDepth = 0;
 
 	static fixed16_16 s_col_hitX;
 	static fixed16_16 s_col_hitDist;
@@ -437,6 +449,71 @@ namespace TFE_Jedi
 		return (sector == sector1) ? JTRUE : JFALSE;
 	}
 
+	// Returns JTRUE if every object in the sector is within c_rangeSectorMargin of the sector bounds.
+	JBool collision_objectsInsideSectorMargin(const RSector* sector)
+	{
+		const fixed16_16 minX = sector->boundsMin.x - c_rangeSectorMargin;
+		const fixed16_16 minZ = sector->boundsMin.z - c_rangeSectorMargin;
+		const fixed16_16 maxX = sector->boundsMax.x + c_rangeSectorMargin;
+		const fixed16_16 maxZ = sector->boundsMax.z + c_rangeSectorMargin;
+		for (s32 objIndex = 0, objListIndex = 0; objIndex < sector->objectCount && objListIndex < sector->objectCapacity; objListIndex++)
+		{
+			const SecObject* obj = sector->objectList[objListIndex];
+			if (!obj) { continue; }
+			objIndex++;
+
+			if (obj->posWS.x < minX || obj->posWS.x > maxX || obj->posWS.z < minZ || obj->posWS.z > maxZ)
+			{
+				return JFALSE;
+			}
+		}
+		return JTRUE;
+	}
+
+	// Gather the sectors that may contain objects inside of [x0, x1] x [z0, z1] using the sector grid.
+	// The sectors are returned in index order so objects are visited in the same order as the original linear scan,
+	// which keeps the hit order (and the game) deterministic. Returns JFALSE if every sector should be scanned instead.
+	// Object positions are sometimes set directly, so if a candidate sector has an object that has drifted outside of
+	// the margin, every sector is scanned to match the original behavior.
+	JBool collision_beginRangeQuery(fixed16_16 x0, fixed16_16 z0, fixed16_16 x1, fixed16_16 z1, const s32** sectorList, s32* sectorCount)
+	{
+		*sectorList = nullptr;
+		*sectorCount = s32(s_levelState.sectorCount);
+		if (s_rangeDepth >= RANGE_QUERY_MAX_DEPTH)
+		{
+			s_rangeDepth++;
+			return JFALSE;
+		}
+
+		std::vector<s32>& list = s_rangeSectors[s_rangeDepth];
+		s_rangeDepth++;
+		if (!sectorGrid_getSectorsInRect(x0 - c_rangeSectorMargin, z0 - c_rangeSectorMargin, x1 + c_rangeSectorMargin, z1 + c_rangeSectorMargin, list))
+		{
+			return JFALSE;
+		}
+		const size_t count = list.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!collision_objectsInsideSectorMargin(&s_levelState.sectors[list[i]]))
+			{
+				return JFALSE;
+			}
+		}
+		*sectorList = list.data();
+		*sectorCount = s32(list.size());
+		return JTRUE;
+	}
+
+	void collision_endRangeQuery()
+	{
+		s_rangeDepth--;
+	}
+
+	RSector* collision_getRangeSector(const s32* sectorList, s32 i)
+	{
+		return sectorList ? &s_levelState.sectors[sectorList[i]] : &s_levelState.sectors[i];
+	}
+
 	// Determines if an object with the correct entityFlag(s) is in range (radius) of (x,y,z) in sector and is not skipObj.
 	// Note only objects with a clear line-of-sight are accepted.
 	JBool collision_isAnyObjectInRange(RSector* sector, fixed16_16 radius, vec3_fixed origin, SecObject* skipObj, u32 entityFlags)
@@ -455,29 +532,25 @@ namespace TFE_Jedi
 		fixed16_16 z1 = origin.z + radius;
 
 		fixed16_16 secHeightThreshold = origin.y - FIXED(2);
-		RSector* curSector = s_levelState.sectors;
 
-		for (u32 i = 0; i < s_levelState.sectorCount; i++, curSector++)
+		// These tests only depend on the start sector, so they have been pulled out of the sector loop.
+		if (x0 > sector->boundsMax.x || x1 < sector->boundsMin.x || z0 > sector->boundsMax.z || z1 < sector->boundsMin.z)
 		{
-			///////////////////////////////////////////////
-			// These tests should only happen once I think,
-			// unless x0, x1, z0, z1 change over time.
-			///////////////////////////////////////////////
-			if (x0 > sector->boundsMax.x || x1 < sector->boundsMin.x || z0 > sector->boundsMax.z || z1 < sector->boundsMin.z)
-			{
-				continue;
-			}
-
-			fixed16_16 floorHeight, ceilHeight;
-			sector_calculateFloor(sector, origin.y, &floorHeight, &ceilHeight);
-			if (floorHeight < y0 || ceilHeight > y1)
-			{
-				continue;
-			}
-			/////////////////////////////////////////////
-			// End of checks to pull out of the loop.
-			/////////////////////////////////////////////
+			return JFALSE;
+		}
+		fixed16_16 floorHeight, ceilHeight;
+		sector_calculateFloor(sector, origin.y, &floorHeight, &ceilHeight);
+		if (floorHeight < y0 || ceilHeight > y1)
+		{
+			return JFALSE;
+		}
 
+		const s32* sectorList;
+		s32 sectorCount;
+		collision_beginRangeQuery(x0, z0, x1, z1, &sectorList, &sectorCount);
+		for (s32 i = 0; i < sectorCount; i++)
+		{
+			RSector* curSector = collision_getRangeSector(sectorList, i);
 			s32 objCapacity = curSector->objectCapacity;
 			s32 objCount = curSector->objectCount;
 			for (s32 objListIndex = 0, objIndex = 0; objIndex < objCount && objListIndex < objCapacity; objListIndex++)
@@ -510,10 +583,12 @@ namespace TFE_Jedi
 
 				if (curSector == obj->sector)
 				{
+					collision_endRangeQuery();
 					return JTRUE;
 				}
 			}
 		}
+		collision_endRangeQuery();
 		return JFALSE;
 	}
 		
@@ -530,19 +605,21 @@ namespace TFE_Jedi
 		const fixed16_16 z1 = origin.z + range;
 
 		const fixed16_16 secHeightThreshold = origin.y - FIXED(2);
-		RSector* sector = s_levelState.sectors;
-		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++)
+		// Checks the start sector, pulled out of the loop.
+		if (x0 > startSector->boundsMax.x || x1 < startSector->boundsMin.x || z0 > startSector->boundsMax.z || z1 < startSector->boundsMin.z)
 		{
-			// Checks the start sector, should be pulled out of the loop.
-			if (x0 > startSector->boundsMax.x || x1 < startSector->boundsMin.x || z0 > startSector->boundsMax.z || z1 < startSector->boundsMin.z)
-			{
-				continue;
-			}
+			return;
+		}
 
+		const s32* sectorList;
+		s32 sectorCount;
+		collision_beginRangeQuery(x0, z0, x1, z1, &sectorList, &sectorCount);
+		for (s32 i = 0; i < sectorCount; i++)
+		{
+			RSector* sector = collision_getRangeSector(sectorList, i);
 			fixed16_16 floor, ceil;
 			sector_calculateFloor(sector, origin.y, &floor, &ceil);
 			if (y0 > floor || y1 < ceil) { continue; }
-			// End of start sector check.
 
 			for (s32 objIndex = 0, objListIndex = 0; objIndex < sector->objectCount && objListIndex < sector->objectCapacity; objListIndex++)
 			{
@@ -570,6 +647,7 @@ namespace TFE_Jedi
 				}
 			}  // Object Loop.
 		}  // Sector loop.
+		collision_endRangeQuery();
 	}
 
 	// Call the effectFunc() for each object within 'range' of point (x,y,z). This will only be called for objects in range and that have a valid collision path.
@@ -590,22 +668,24 @@ namespace TFE_Jedi
 		const fixed16_16 z1 = origin.z + range;
 
 		const fixed16_16 secHeightThreshold = origin.y - FIXED(2);
-		RSector* sector = s_levelState.sectors;
-		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++)
+		// Checks the start sector, pulled out of the loop.
+		if (x0 > startSector->boundsMax.x || x1 < startSector->boundsMin.x || z0 > startSector->boundsMax.z || z1 < startSector->boundsMin.z)
 		{
-			// Checks the start sector, should be pulled out of the loop.
-			if (x0 > startSector->boundsMax.x || x1 < startSector->boundsMin.x || z0 > startSector->boundsMax.z || z1 < startSector->boundsMin.z)
-			{
-				continue;
-			}
-			fixed16_16 floor, ceil;
-			sector_calculateFloor(startSector, origin.y, &floor, &ceil);
-			if (y0 > floor || y1 < ceil)
-			{
-				continue;
-			}
-			// End of start sector check.
+			return;
+		}
+		fixed16_16 floor, ceil;
+		sector_calculateFloor(startSector, origin.y, &floor, &ceil);
+		if (y0 > floor || y1 < ceil)
+		{
+			return;
+		}
 
+		const s32* sectorList;
+		s32 sectorCount;
+		collision_beginRangeQuery(x0, z0, x1, z1, &sectorList, &sectorCount);
+		for (s32 i = 0; i < sectorCount; i++)
+		{
+			RSector* sector = collision_getRangeSector(sectorList, i);
 			for (s32 objIndex = 0, objListIndex = 0; objIndex < sector->objectCount && objListIndex < sector->objectCapacity; objListIndex++)
 			{
 				SecObject* obj = sector->objectList[objListIndex];
@@ -654,6 +734,7 @@ namespace TFE_Jedi
 				}
 			}  // Object Loop.
 		}  // Sector Loop.
+		collision_endRangeQuery();
 	}
 		
 	static RSector*   s_hcolSector;
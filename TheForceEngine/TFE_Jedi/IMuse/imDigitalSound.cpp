@@ -8,6 +8,7 @@
 #include <TFE_System/system.h>
 #include <TFE_Audio/midi.h>
 #include <TFE_Audio/audioSystem.h>
+#include <TFE_Audio/audioMixer.h>
 #include <assert.h>
 
 namespace TFE_Jedi
@@ -43,6 +44,11 @@ namespace TFE_Jedi
 
 		s32 detuneTrans;
 		s32 mailbox;
+
+		// Left and right output values for each sample value, packed into one u32 so both channels are mixed
+		// with a single lookup. Rebuilt when the left or right volume changes.
+		s32 outputKey;
+		u32 outputTable[256];
 	};
 
 	struct ImWaveData
@@ -198,13 +204,18 @@ namespace TFE_Jedi
 		memset(s_audioOut, 0, 2 * bufferSize * sizeof(s16));
 
 		// Write sounds to s_audioOut.
-		ImWaveSound* sound = s_imWaveSoundList;
-		while (sound)
+		// This is called from the audio thread without the audio lock held, so only hold it while the sounds are accessed.
+		AUDIO_LOCK();
 		{
-			ImWaveSound* next = sound->next;
-			audioPlaySoundFrame(sound);
-			sound = next;
+			ImWaveSound* sound = s_imWaveSoundList;
+			while (sound)
+			{
+				ImWaveSound* next = sound->next;
+				audioPlaySoundFrame(sound);
+				sound = next;
+			}
 		}
+		AUDIO_UNLOCK();
 
 		// Convert s_audioOut to "driver" buffer.
 		audioWriteToDriver(systemVolume);
@@ -593,6 +604,7 @@ namespace TFE_Jedi
 		sound->transpose = 0;
 		sound->detuneTrans = 0;
 		sound->mailbox = 0;
+		sound->outputKey = -1;
 		if (ImWaveSetupSoundData(sound, chunkIndex) != imSuccess)
 		{
 			IM_LOG_ERR("Failed to setup wave player data - soundId: 0x%x, priority: %d", soundId, priority);
@@ -659,17 +671,20 @@ namespace TFE_Jedi
 	
 	// leftMapping:  map left channel samples to final values based on volume and pan.
 	// rightMapping: map right channel samples to final values based on volume and pan.
-	void digitalAudioOutput_Stereo(s16* audioOut, const u8* sndData, const s8* leftMapping, const s8* rightMapping, s32 size)
+	void digitalAudioBuildOutputTable(u32* outputTable, const s8* leftMapping, const s8* rightMapping)
 	{
-		for (s32 i = 0; i < size; i++, sndData++, audioOut+=2)
+		for (s32 i = 0; i < 256; i++)
 		{
-			const u8 sample = *sndData;
-			audioOut[0] += (s16)leftMapping[sample];
-			audioOut[1] += (s16)rightMapping[sample];
+			outputTable[i] = u32(u16(s16(leftMapping[i]))) | (u32(u16(s16(rightMapping[i]))) << 16u);
 		}
 	}
 
-	void audioProcessFrame(u8* audioFrame, s32 size, s32 outOffset, s32 vol, s32 pan)
+	void digitalAudioOutput_Stereo(s16* audioOut, const u8* sndData, const u32* outputTable, s32 size)
+	{
+		TFE_Audio::mixer_addMonoPacked(audioOut, sndData, outputTable, size);
+	}
+
+	void audioProcessFrame(ImWaveSound* sound, u8* audioFrame, s32 size, s32 outOffset, s32 vol, s32 pan)
 	{
 		s32 vTop = vol >> 3;
 		if (vol)
@@ -690,11 +705,17 @@ namespace TFE_Jedi
 		// Calculate where the in panVolume mapping channel to read from for each channel.
 		s32 leftVolume  = s_audioPanVolumeTable[8 - panTop + vTop*17];
 		s32 rightVolume = s_audioPanVolumeTable[8 + panTop + vTop*17];
-		// Map [0,255] sample values to signed output values based on volume.
-		const s8* leftMapping  = (s8*)&s_audioVolumeToSignedMapping[leftVolume  << 8];
-		const s8* rightMapping = (s8*)&s_audioVolumeToSignedMapping[rightVolume << 8];
+		const s32 outputKey = leftVolume | (rightVolume << 8);
+		if (sound->outputKey != outputKey)
+		{
+			// Map [0,255] sample values to signed output values based on volume.
+			const s8* leftMapping  = (s8*)&s_audioVolumeToSignedMapping[leftVolume  << 8];
+			const s8* rightMapping = (s8*)&s_audioVolumeToSignedMapping[rightVolume << 8];
+			digitalAudioBuildOutputTable(sound->outputTable, leftMapping, rightMapping);
+			sound->outputKey = outputKey;
+		}
 
-		digitalAudioOutput_Stereo(&s_audioOut[outOffset * 2], audioFrame, leftMapping, rightMapping, size);
+		digitalAudioOutput_Stereo(&s_audioOut[outOffset * 2], audioFrame, sound->outputTable, size);
 	}
 
 	s32 audioPlaySoundFrame(ImWaveSound* sound)
@@ -721,7 +742,7 @@ namespace TFE_Jedi
 
 			s32 readSize = (bufferSize <= data->chunkSize) ? bufferSize : data->chunkSize;
 			s_audioData = ImInternalGetSoundData(sound->soundId) + data->offset;
-			audioProcessFrame(s_audioData, readSize, offset, sound->volume, sound->pan);
+			audioProcessFrame(sound, s_audioData, readSize, offset, sound->volume, sound->pan);
 
 			offset += readSize;
 			bufferSize -= readSize;
@@ -738,13 +759,7 @@ namespace TFE_Jedi
 			return imInvalidSound;
 		}
 
-		s32 bufferSize = s_audioOutSize * 2;
-		s16* audioOut  = s_audioOut;
-		f32* driverOut = s_audioDriverOut;
-		for (s32 i = 0; i < bufferSize; i++, audioOut++, driverOut++)
-		{
-			*driverOut = s_audioNormalization[*audioOut] * systemVolume;
-		}
+		TFE_Audio::mixer_normalize(s_audioDriverOut, s_audioOut, s_audioNormalization, s_audioOutSize, systemVolume);
 		return imSuccess;
 	}
 
@@ -28,6 +28,7 @@ namespace TFE_Jedi
 	void inf_serializeSlave(Stream* stream, Slave* slave);
 	void inf_serializeLink(Stream* stream, InfLink* link, Allocator* parent);
 	void inf_serializeFixupLinks();
+	void inf_rebuildActiveElevators();
 
 	void inf_computeElevValuePointer(InfElevator* elev);
 	extern void inf_deleteElevator(InfElevator* elev);
@@ -561,6 +562,7 @@ namespace TFE_Jedi
 		if (serialization_getMode() == SMODE_READ)
 		{
 			inf_serializeFixupLinks();
+			inf_rebuildActiveElevators();
 		}
 	}
 
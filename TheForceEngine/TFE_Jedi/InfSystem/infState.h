@@ -12,6 +12,7 @@
 namespace TFE_Jedi
 {
 	struct Stop;
+	struct InfElevator;
 
 	// State that should be serialized for quick-saves.
 	struct InfSerializableState
@@ -30,6 +31,15 @@ namespace TFE_Jedi
 		Task* infTriggerTask = nullptr;
 		Task* teleportTask = nullptr;
 		Stop* nextStop = nullptr;
+
+		// Elevators that may need to be updated, sorted by allocation order so they update in the same order as the
+		// elevator allocator. Sleeping elevators (master off or holding) are removed until woken up by a message.
+		InfElevator** activeElev = nullptr;
+		u32* activeOrder = nullptr;
+		s32 activeCount = 0;
+		s32 activeCapacity = 0;
+		s32 activeIter = 0;
+		u32 nextElevOrder = 0;
 	};
 	extern InfState s_infState;
 }
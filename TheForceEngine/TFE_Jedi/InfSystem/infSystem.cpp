@@ -74,6 +74,7 @@ namespace TFE_Jedi
 
 	void inf_deleteElevator(InfElevator* elev);
 	void inf_deleteTrigger(InfTrigger* trigger);
+	void inf_wakeElevator(InfElevator* elev);
 	JBool updateElevator(InfElevator* elev);
 	void elevHandleStopDelay(InfElevator* elev);
 	Stop* inf_advanceStops(Allocator* stops, s32 absoluteStop, s32 relativeStop);
@@ -187,7 +188,11 @@ namespace TFE_Jedi
 	{
 		if (!elev || !elev->stops)
 		{
-			if (elev) { elev->nextTick = s_curTick; }
+			if (elev)
+			{
+				elev->nextTick = s_curTick;
+				inf_wakeElevator(elev);
+			}
 			return;
 		}
 
@@ -226,6 +231,7 @@ namespace TFE_Jedi
 		else
 		{
 			elev->nextTick = s_curTick + next->delay;
+			inf_wakeElevator(elev);
 		}
 
 		// Setup the next stop.
@@ -250,11 +256,14 @@ namespace TFE_Jedi
 		elev->flags = 0;
 		elev->loopingSoundID = NULL_SOUND;
 		elev->deleted = JFALSE;
+		elev->order = s_infState.nextElevOrder++;
+		elev->active = JFALSE;
 
 		elev->type = type;
 		elev->self = elev;
 		elev->sector = sector;
 		elev->updateFlags = ELEV_MASTER_ON;
+		inf_wakeElevator(elev);
 		elev->sound0 = NULL_SOUND;
 		elev->sound1 = NULL_SOUND;
 		elev->sound2 = NULL_SOUND;
@@ -1418,6 +1427,90 @@ namespace TFE_Jedi
 		infElevatorMsgFunc(msg);
 	}
 
+	/////////////////////////////////////////////////////
+	// Active elevators
+	/////////////////////////////////////////////////////
+	// An elevator only updates if the master is on and its next tick has passed. Holding elevators sleep forever,
+	// so elevators in either state can be skipped until a message changes the flags or next tick.
+	JBool inf_isElevatorAsleep(InfElevator* elev)
+	{
+		return (elev->deleted || !(elev->updateFlags & ELEV_MASTER_ON) || elev->nextTick == DELAY_SLEEP) ? JTRUE : JFALSE;
+	}
+
+	// Add the elevator to the active list if it is not already there.
+	// This must be called whenever the master is turned on or the next tick is changed.
+	void inf_wakeElevator(InfElevator* elev)
+	{
+		if (elev->active || elev->deleted) { return; }
+
+		if (s_infState.activeCount >= s_infState.activeCapacity)
+		{
+			s_infState.activeCapacity = max(64, s_infState.activeCapacity * 2);
+			s_infState.activeElev  = (InfElevator**)level_realloc(s_infState.activeElev, sizeof(InfElevator*) * s_infState.activeCapacity);
+			s_infState.activeOrder = (u32*)level_realloc(s_infState.activeOrder, sizeof(u32) * s_infState.activeCapacity);
+		}
+
+		// Find the insertion point that keeps the list in allocation order.
+		s32 lo = 0, hi = s_infState.activeCount;
+		while (lo < hi)
+		{
+			const s32 mid = (lo + hi) >> 1;
+			if (s_infState.activeOrder[mid] < elev->order) { lo = mid + 1; }
+			else { hi = mid; }
+		}
+
+		const s32 moveCount = s_infState.activeCount - lo;
+		if (moveCount > 0)
+		{
+			memmove(&s_infState.activeElev[lo + 1], &s_infState.activeElev[lo], sizeof(InfElevator*) * moveCount);
+			memmove(&s_infState.activeOrder[lo + 1], &s_infState.activeOrder[lo], sizeof(u32) * moveCount);
+		}
+		s_infState.activeElev[lo] = elev;
+		s_infState.activeOrder[lo] = elev->order;
+		s_infState.activeCount++;
+		elev->active = JTRUE;
+
+		// Elevators before the current one are not updated until the next frame, just like in the original loop.
+		if (lo <= s_infState.activeIter)
+		{
+			s_infState.activeIter++;
+		}
+	}
+
+	void inf_removeActiveElevator(s32 index)
+	{
+		s_infState.activeElev[index]->active = JFALSE;
+		const s32 moveCount = s_infState.activeCount - index - 1;
+		if (moveCount > 0)
+		{
+			memmove(&s_infState.activeElev[index], &s_infState.activeElev[index + 1], sizeof(InfElevator*) * moveCount);
+			memmove(&s_infState.activeOrder[index], &s_infState.activeOrder[index + 1], sizeof(u32) * moveCount);
+		}
+		s_infState.activeCount--;
+	}
+
+	// Rebuild the active list after the elevators have been restored from a save.
+	void inf_rebuildActiveElevators()
+	{
+		s_infState.activeCount = 0;
+		s_infState.activeIter = 0;
+		s_infState.nextElevOrder = 0;
+
+		allocator_saveIter(s_infSerState.infElevators);
+		InfElevator* elev = (InfElevator*)allocator_getHead(s_infSerState.infElevators);
+		while (elev)
+		{
+			elev->order = s_infState.nextElevOrder++;
+			elev->active = JFALSE;
+			if (!inf_isElevatorAsleep(elev))
+			{
+				inf_wakeElevator(elev);
+			}
+			elev = (InfElevator*)allocator_getNext(s_infSerState.infElevators);
+		}
+		allocator_restoreIter(s_infSerState.infElevators);
+	}
+
 	void inf_startElevator(InfElevator* elev)
 	{
 		if (!(elev->updateFlags & ELEV_MOVING))
@@ -1435,6 +1528,7 @@ namespace TFE_Jedi
 
 			// Update the next time, so this will move on the next update.
 			elev->nextTick = s_curTick;
+			inf_wakeElevator(elev);
 
 			// Flag the elevator as moving.
 			elev->updateFlags |= ELEV_MOVING;
@@ -1473,17 +1567,21 @@ namespace TFE_Jedi
 			}
 			else  // id == MSG_RUN_TASK
 			{
-				taskCtx->elev = (InfElevator*)allocator_getHead(s_infSerState.infElevators);
-				while (taskCtx->elev)
+				// Only active elevators are visited, in the same order as the elevator allocator.
+				// Note activeIter is adjusted if elevators are woken up while stop messages are being handled.
+				s_infState.activeIter = 0;
+				while (s_infState.activeIter < s_infState.activeCount)
 				{
-					if (taskCtx->elev->deleted)
+					taskCtx->elev = s_infState.activeElev[s_infState.activeIter];
+					if (inf_isElevatorAsleep(taskCtx->elev))
 					{
-						taskCtx->elev = (InfElevator*)allocator_getNext(s_infSerState.infElevators);
+						// Remove the elevator until a message wakes it up again, so it costs nothing while asleep.
+						inf_removeActiveElevator(s_infState.activeIter);
 						continue;
 					}
 
 					taskCtx->elevDeleted = 0;
-					if ((taskCtx->elev->updateFlags & ELEV_MASTER_ON) && taskCtx->elev->nextTick < s_curTick)
+					if (taskCtx->elev->nextTick < s_curTick)
 					{
 						// If not already moving, get started.
 						if (!(taskCtx->elev->updateFlags & ELEV_MOVING) && !taskCtx->elevDeleted)
@@ -1569,8 +1667,8 @@ namespace TFE_Jedi
 					} // ((elev->updateFlags & ELEV_MASTER_ON) && elev->nextTick < s_curTick)
 
 					// Next elevator.
-					taskCtx->elev = (InfElevator*)allocator_getNext(s_infSerState.infElevators);
-				} // while (elev)
+					s_infState.activeIter++;
+				} // while (activeIter < activeCount)
 			}  // id == 0 (main elevator update loop)
 			task_yield(TASK_NO_DELAY);
 		}  // while (id != -1)
@@ -2395,6 +2493,7 @@ namespace TFE_Jedi
 			}
 			elev->nextTick = s_curTick;
 			elev->updateFlags |= ELEV_MOVING;
+			inf_wakeElevator(elev);
 		}
 	}
 
@@ -2564,6 +2663,7 @@ namespace TFE_Jedi
 		{
 			// Turn master on.
 			elev->updateFlags |= ELEV_MASTER_ON;
+			inf_wakeElevator(elev);
 			return;
 		}
 		if (!(elev->updateFlags & ELEV_MASTER_ON))
@@ -2679,6 +2779,7 @@ namespace TFE_Jedi
 						elev->updateFlags |= ELEV_CRUSH;
 					}
 					elev->nextTick = 0;
+					inf_wakeElevator(elev);
 				}
 			} break;
 			case MSG_MASTER_OFF:
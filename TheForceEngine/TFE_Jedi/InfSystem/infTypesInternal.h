@@ -195,5 +195,7 @@ namespace TFE_Jedi
 		// TFE
 		fixed16_16 prevValue;
 		JBool deleted;
+		u32 order;		// Allocation order, used to keep the active elevator list sorted.
+		JBool active;	// JTRUE if the elevator is in the active elevator list.
 	};
 }
\ No newline at end of file
@@ -3,8 +3,11 @@
 
 #include "level.h"
 #include "levelData.h"
+#include "levelCache.h"
+#include "levelPrefetch.h"
 #include "rwall.h"
 #include "rtexture.h"
+#include "sectorGrid.h"
 #include <TFE_Game/igame.h>
 #include <TFE_Asset/assetSystem.h>
 #include <TFE_Asset/dfKeywords.h>
@@ -44,6 +47,8 @@ namespace TFE_Jedi
 	static s32 s_dataIndex;
 	static char s_readBuffer[256];
 	static std::vector<char> s_buffer;
+	static std::vector<std::string> s_textureNames;
+	static std::vector<std::string> s_sectorNames;
 
 	JBool level_loadGeometry(const char* levelName);
 	JBool level_loadObjects(const char* levelName, u8 difficulty);
@@ -63,8 +68,14 @@ namespace TFE_Jedi
 			s_levelState.complete[COMPL_ITEM][i] = JFALSE;
 		}
 
-		if (!level_loadGeometry(levelName)) { return JFALSE; }
+		// TFE: The level assets are prefetched from level_loadGeometry() until the objects have been loaded.
+		if (!level_loadGeometry(levelName))
+		{
+			levelPrefetch_end();
+			return JFALSE;
+		}
 		level_loadObjects(levelName, difficulty);
+		levelPrefetch_end();
 		inf_load(levelName);
 		level_loadGoals(levelName);
 
@@ -95,6 +106,7 @@ namespace TFE_Jedi
 		s_levelState.minLayer = INT_MAX;
 		s_levelState.maxLayer = INT_MIN;
 		message_free();
+		sectorGrid_free();
 
 		char levelPath[TFE_MAX_PATH];
 		strcpy(levelPath, levelName);
@@ -117,6 +129,15 @@ namespace TFE_Jedi
 		file.readBuffer(s_buffer.data(), u32(len));
 		file.close();
 
+		// TFE: Use the cached geometry if the source data has not changed.
+		const u64 sourceHash = levelCache_hash(s_buffer.data(), s_buffer.size());
+		// TFE: Read and decode the level assets in the background while the level is parsed.
+		levelPrefetch_begin(levelName, s_buffer, sourceHash);
+		if (levelCache_read(levelName, sourceHash))
+		{
+			return true;
+		}
+
 		TFE_Parser parser;
 		size_t bufferPos = 0;
 		parser.init(s_buffer.data(), s_buffer.size());
@@ -187,44 +208,21 @@ namespace TFE_Jedi
 		memset(s_levelState.textures, 0, 2 * s_levelState.textureCount * sizeof(TextureData**));
 
 		// Load Textures.
-		TextureData** texture = s_levelState.textures;
-		TextureData** texBase = s_levelState.textures + s_levelState.textureCount;
-		for (s32 i = 0; i < s_levelState.textureCount; i++, texture++, texBase++)
+		s_textureNames.resize(s_levelState.textureCount);
+		for (s32 i = 0; i < s_levelState.textureCount; i++)
 		{
 			line = parser.readLine(bufferPos);
 			char textureName[256];
 			if (sscanf(line, " TEXTURE: %s ", textureName) != 1)
 			{
 				TFE_System::logWrite(LOG_ERROR, "level_loadGeometry", "Cannot read texture name.");
-				*texture = bitmap_load("default.bm", 1);
-			}
-			else if (strcasecmp(textureName, "<NoTexture>") == 0)
-			{
-				*texture = nullptr;
+				s_textureNames[i].clear();
+				if (!level_loadTexture(i, nullptr)) { return false; }
 			}
 			else
 			{
-				TextureData* tex = bitmap_load(textureName, 1);
-				if (!tex)
-				{
-					TFE_System::logWrite(LOG_WARNING, "level_loadGeometry", "Could not open '%s', using 'default.bm' instead.", textureName);
-					tex = bitmap_load("default.bm", 1);
-					if (!tex)
-					{
-						TFE_System::logWrite(LOG_ERROR, "level_loadGeometry", "'default.bm' is not a valid BM file!");
-						assert(0);
-						return false;
-					}
-				}
-				*texture = tex;
-				// This version never gets modified, so serialization is simpler.
-				*texBase = tex;
-
-				// Setup an animated texture.
-				if (tex->uvWidth == BM_ANIMATED_TEXTURE)
-				{
-					bitmap_setupAnimatedTexture(texture, i);
-				}
+				s_textureNames[i] = textureName;
+				if (!level_loadTexture(i, textureName)) { return false; }
 			}
 		}
 
@@ -238,6 +236,7 @@ namespace TFE_Jedi
 
 		s_levelState.sectors = (RSector*)level_alloc(sizeof(RSector) * s_levelState.sectorCount);
 		memset(s_levelState.sectors, 0, sizeof(RSector) * s_levelState.sectorCount);
+		s_sectorNames.resize(s_levelState.sectorCount);
 		for (u32 i = 0; i < s_levelState.sectorCount; i++)
 		{
 			RSector* sector = &s_levelState.sectors[i];
@@ -259,22 +258,12 @@ namespace TFE_Jedi
 			char name[256];
 			if (sscanf(line, " NAME %s", name) == 1)
 			{
-				// Add the sector "address" for later use by the INF system.
-				message_addAddress(name, 0, 0, sector);
-
-				// Track special elevators.
-				if (!strcasecmp(name, "complete"))
-				{
-					s_levelState.completeSector = sector;
-				}
-				else if (!strcasecmp(name, "boss"))
-				{
-					s_levelState.bossSector = sector;
-				}
-				else if (!strcasecmp(name, "mohc"))
-				{
-					s_levelState.mohcSector = sector;
-				}
+				s_sectorNames[i] = name;
+				level_addSectorAddress(sector, name);
+			}
+			else
+			{
+				s_sectorNames[i].clear();
 			}
 
 			// Lighting
@@ -355,22 +344,7 @@ namespace TFE_Jedi
 				TFE_System::logWrite(LOG_ERROR, "level_loadGeometry", "Cannot read sector flags.");
 				return false;
 			}
-			// Create a door if needed.
-			if (sector->flags1 & SEC_FLAGS1_DOOR)
-			{
-				InfElevator* elev = inf_allocateSpecialElevator(sector, IELEV_SP_DOOR);
-				if (elev) { elev->flags |= INF_EFLAG_DOOR; }
-			}
-			// Create an exploding wall if needed.
-			if (sector->flags1 & SEC_FLAGS1_EXP_WALL)
-			{
-				inf_allocateSpecialElevator(sector, IELEV_SP_EXPLOSIVE_WALL);
-			}
-			// Add secrets.
-			if (sector->flags1 & SEC_FLAGS1_SECRET)
-			{
-				s_levelState.secretCount++;
-			}
+			level_setupSectorFlags(sector);
 
 			// Layer
 			line = parser.readLine(bufferPos);
@@ -536,14 +510,99 @@ namespace TFE_Jedi
 			// TFE: Added to support non-fixed-point rendering.
 			sector->dirtyFlags = SDF_ALL;
 		}
+		// TFE: Build the sector grid once all of the bounds are known.
+		sectorGrid_build();
 
 		// Setup the control sector.
 		s_levelState.controlSector->id = s_levelState.sectorCount;
 		s_levelState.controlSector->index = s_levelState.controlSector->id;
 
+		// TFE: Store the built geometry so the next load can skip parsing.
+		levelCache_write(levelName, sourceHash, s_textureNames, s_sectorNames);
 		return true;
 	}
 
+	// Loads texture 'index' of the level texture list.
+	// A null 'textureName' means the name could not be read, in which case 'default.bm' is used.
+	JBool level_loadTexture(s32 index, const char* textureName)
+	{
+		TextureData** texture = &s_levelState.textures[index];
+		TextureData** texBase = &s_levelState.textures[index + s_levelState.textureCount];
+		if (!textureName)
+		{
+			*texture = bitmap_load("default.bm", 1);
+		}
+		else if (strcasecmp(textureName, "<NoTexture>") == 0)
+		{
+			*texture = nullptr;
+		}
+		else
+		{
+			TextureData* tex = bitmap_load(textureName, 1);
+			if (!tex)
+			{
+				TFE_System::logWrite(LOG_WARNING, "level_loadGeometry", "Could not open '%s', using 'default.bm' instead.", textureName);
+				tex = bitmap_load("default.bm", 1);
+				if (!tex)
+				{
+					TFE_System::logWrite(LOG_ERROR, "level_loadGeometry", "'default.bm' is not a valid BM file!");
+					assert(0);
+					return JFALSE;
+				}
+			}
+			*texture = tex;
+			// This version never gets modified, so serialization is simpler.
+			*texBase = tex;
+
+			// Setup an animated texture.
+			if (tex->uvWidth == BM_ANIMATED_TEXTURE)
+			{
+				bitmap_setupAnimatedTexture(texture, index);
+			}
+		}
+		return JTRUE;
+	}
+
+	void level_addSectorAddress(RSector* sector, const char* name)
+	{
+		// Add the sector "address" for later use by the INF system.
+		message_addAddress(name, 0, 0, sector);
+
+		// Track special elevators.
+		if (!strcasecmp(name, "complete"))
+		{
+			s_levelState.completeSector = sector;
+		}
+		else if (!strcasecmp(name, "boss"))
+		{
+			s_levelState.bossSector = sector;
+		}
+		else if (!strcasecmp(name, "mohc"))
+		{
+			s_levelState.mohcSector = sector;
+		}
+	}
+
+	void level_setupSectorFlags(RSector* sector)
+	{
+		// Create a door if needed.
+		if (sector->flags1 & SEC_FLAGS1_DOOR)
+		{
+			InfElevator* elev = inf_allocateSpecialElevator(sector, IELEV_SP_DOOR);
+			if (elev) { elev->flags |= INF_EFLAG_DOOR; }
+		}
+		// Create an exploding wall if needed.
+		if (sector->flags1 & SEC_FLAGS1_EXP_WALL)
+		{
+			inf_allocateSpecialElevator(sector, IELEV_SP_EXPLOSIVE_WALL);
+		}
+		// Add secrets.
+		if (sector->flags1 & SEC_FLAGS1_SECRET)
+		{
+			s_levelState.secretCount++;
+		}
+	}
+
 	void level_freeAllAssets()
 	{
 		TFE_Sprite_Jedi::freeLevelData();
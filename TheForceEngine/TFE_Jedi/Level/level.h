@@ -53,6 +53,11 @@ namespace TFE_Jedi
 	void level_addSound(const char* name, u32 freq, s32 priority);
 	void level_loadPalette();
 
+	// Shared by the level parser and the level cache.
+	JBool level_loadTexture(s32 index, const char* textureName);
+	void  level_addSectorAddress(RSector* sector, const char* name);
+	void  level_setupSectorFlags(RSector* sector);
+
 	void level_updateSecretPercent();
 
 	void ambientSoundTaskFunc(MessageType msg);
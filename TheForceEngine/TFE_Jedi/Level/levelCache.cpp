@@ -0,0 +1,488 @@
+#include <cstdio>
+#include <cstring>
+
+#include "levelCache.h"
+#include "level.h"
+#include "levelData.h"
+#include "rsector.h"
+#include "rwall.h"
+#include "sectorGrid.h"
+#include <TFE_Game/igame.h>
+#include <TFE_FileSystem/filestream.h>
+#include <TFE_FileSystem/fileutil.h>
+#include <TFE_FileSystem/paths.h>
+#include <TFE_System/system.h>
+
+namespace TFE_Jedi
+{
+	enum LevelCacheConstants : u32
+	{
+		LEVEL_CACHE_MAGIC = 0x4356454c,		// 'LEVC'
+		LEVEL_CACHE_VERSION = 1,
+		LEVEL_CACHE_ALIGN = 8,				// Record sections are aligned so they can be validated in place.
+	};
+
+	struct LevelCacheHeader
+	{
+		u32 magic;
+		u32 version;
+		u64 sourceHash;
+		// Record layout, the cache is rebuilt if the structures change.
+		u32 sectorSize;
+		u32 wallSize;
+		u32 pointerSize;
+		// Counts.
+		s32 textureCount;
+		u32 sectorCount;
+		u32 vertexCount;
+		u32 wallCount;
+		u32 namesSize;
+		// Level values.
+		s32 minLayer;
+		s32 maxLayer;
+		fixed16_16 parallax0;
+		fixed16_16 parallax1;
+	};
+
+	// Name section: palette name, texture names then sector names, each stored as a length byte followed by the characters.
+	struct CacheName
+	{
+		const char* str;
+		u32 length;
+	};
+
+	static std::vector<u8> s_cacheData;
+
+	void level_serializeFixupMirrors();
+
+	/////////////////////////////////////////////
+	// Internal
+	/////////////////////////////////////////////
+	// Pointers are stored as (index + 1) so that null pointers remain null.
+	template <typename T>
+	T* levelCache_encode(s32 index)
+	{
+		return (T*)(intptr_t(index) + 1);
+	}
+
+	s32 levelCache_decode(const void* ptr)
+	{
+		return s32(intptr_t(ptr) - 1);
+	}
+
+	s32 levelCache_encodeTexture(TextureData** tex)
+	{
+		return tex ? s32(tex - s_levelState.textures) : -1;
+	}
+
+	size_t levelCache_align(size_t size)
+	{
+		return (size + LEVEL_CACHE_ALIGN - 1) & ~size_t(LEVEL_CACHE_ALIGN - 1);
+	}
+
+	void levelCache_getPath(const char* levelName, char* path)
+	{
+		sprintf(path, "%sCache/Levels/%s.lvc", TFE_Paths::getPath(PATH_PROGRAM_DATA), levelName);
+	}
+
+	void levelCache_appendName(std::vector<u8>& names, const char* name)
+	{
+		size_t length = strlen(name);
+		if (length > 255) { length = 255; }
+		names.push_back(u8(length));
+		names.insert(names.end(), (const u8*)name, (const u8*)name + length);
+	}
+
+	JBool levelCache_readNames(const u8* data, u32 size, std::vector<CacheName>& names, u32 count)
+	{
+		names.resize(count);
+		u32 offset = 0;
+		for (u32 i = 0; i < count; i++)
+		{
+			if (offset >= size) { return JFALSE; }
+			names[i].length = data[offset];
+			names[i].str = (const char*)&data[offset + 1];
+			offset += 1 + names[i].length;
+			if (offset > size) { return JFALSE; }
+		}
+		return JTRUE;
+	}
+
+	JBool levelCache_validTexture(TextureData** tex, s32 textureCount)
+	{
+		if (!tex) { return JTRUE; }
+		const s32 index = levelCache_decode(tex);
+		return index >= 0 && index < textureCount;
+	}
+
+	// Make sure every index in the records is in range before touching the level state.
+	JBool levelCache_validate(const LevelCacheHeader* header, const RSector* sectors, const RWall* walls)
+	{
+		const s32 sectorCount = s32(header->sectorCount);
+		for (s32 s = 0; s < sectorCount; s++)
+		{
+			const RSector* sector = &sectors[s];
+			const s64 vtxStart = levelCache_decode(sector->verticesWS);
+			const s64 wallStart = levelCache_decode(sector->walls);
+			if (sector->vertexCount < 0 || vtxStart < 0 || vtxStart + sector->vertexCount > s64(header->vertexCount) ||
+				sector->wallCount < 0 || wallStart < 0 || wallStart + sector->wallCount > s64(header->wallCount) ||
+				!levelCache_validTexture(sector->floorTex, header->textureCount) || !levelCache_validTexture(sector->ceilTex, header->textureCount))
+			{
+				return JFALSE;
+			}
+
+			const RWall* wall = &walls[wallStart];
+			for (s32 w = 0; w < sector->wallCount; w++, wall++)
+			{
+				const s32 i0 = levelCache_decode(wall->w0);
+				const s32 i1 = levelCache_decode(wall->w1);
+				if (levelCache_decode(wall->sector) != s || i0 < 0 || i0 >= sector->vertexCount || i1 < 0 || i1 >= sector->vertexCount ||
+					!levelCache_validTexture(wall->topTex, header->textureCount) || !levelCache_validTexture(wall->midTex, header->textureCount) ||
+					!levelCache_validTexture(wall->botTex, header->textureCount) || !levelCache_validTexture(wall->signTex, header->textureCount))
+				{
+					return JFALSE;
+				}
+				if (wall->nextSector)
+				{
+					const s32 next = levelCache_decode(wall->nextSector);
+					if (next < 0 || next >= sectorCount || wall->mirror < 0 || wall->mirror >= sectors[next].wallCount)
+					{
+						return JFALSE;
+					}
+				}
+			}
+		}
+		return JTRUE;
+	}
+
+	JBool levelCache_validHeader(const LevelCacheHeader* header, u64 sourceHash)
+	{
+		return header->magic == LEVEL_CACHE_MAGIC && header->version == LEVEL_CACHE_VERSION && header->sourceHash == sourceHash &&
+			header->sectorSize == sizeof(RSector) && header->wallSize == sizeof(RWall) && header->pointerSize == sizeof(void*) &&
+			header->textureCount >= 0;
+	}
+
+	TextureData** levelCache_fixupTexture(TextureData** tex)
+	{
+		return tex ? &s_levelState.textures[levelCache_decode(tex)] : nullptr;
+	}
+
+	/////////////////////////////////////////////
+	// API Implementation
+	/////////////////////////////////////////////
+	u64 levelCache_hash(const void* data, size_t size)
+	{
+		// FNV-1a
+		const u8* bytes = (const u8*)data;
+		u64 hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	JBool levelCache_read(const char* levelName, u64 sourceHash)
+	{
+		char cachePath[TFE_MAX_PATH];
+		levelCache_getPath(levelName, cachePath);
+
+		FileStream file;
+		if (!FileUtil::exists(cachePath) || !file.open(cachePath, Stream::MODE_READ))
+		{
+			return JFALSE;
+		}
+		const size_t size = file.getSize();
+		if (size < sizeof(LevelCacheHeader))
+		{
+			file.close();
+			return JFALSE;
+		}
+		s_cacheData.resize(size);
+		file.readBuffer(s_cacheData.data(), u32(size));
+		file.close();
+
+		LevelCacheHeader header;
+		memcpy(&header, s_cacheData.data(), sizeof(LevelCacheHeader));
+		if (!levelCache_validHeader(&header, sourceHash))
+		{
+			return JFALSE;
+		}
+
+		// Section offsets.
+		const size_t namesOffset  = levelCache_align(sizeof(LevelCacheHeader));
+		const size_t sectorOffset = levelCache_align(namesOffset + header.namesSize);
+		const size_t vertexOffset = levelCache_align(sectorOffset + size_t(header.sectorCount) * sizeof(RSector));
+		const size_t wallOffset   = levelCache_align(vertexOffset + size_t(header.vertexCount) * sizeof(vec2_fixed));
+		const size_t totalSize    = wallOffset + size_t(header.wallCount) * sizeof(RWall);
+		if (totalSize != size)
+		{
+			TFE_System::logWrite(LOG_WARNING, "LevelCache", "Level cache '%s' is corrupt, rebuilding.", cachePath);
+			return JFALSE;
+		}
+
+		std::vector<CacheName> names;
+		const u32 nameCount = 1 + u32(header.textureCount) + header.sectorCount;
+		const RSector* srcSectors = (const RSector*)(s_cacheData.data() + sectorOffset);
+		const vec2_fixed* srcVertices = (const vec2_fixed*)(s_cacheData.data() + vertexOffset);
+		const RWall* srcWalls = (const RWall*)(s_cacheData.data() + wallOffset);
+		if (!levelCache_readNames(s_cacheData.data() + namesOffset, header.namesSize, names, nameCount) ||
+			!levelCache_validate(&header, srcSectors, srcWalls))
+		{
+			TFE_System::logWrite(LOG_WARNING, "LevelCache", "Level cache '%s' is corrupt, rebuilding.", cachePath);
+			return JFALSE;
+		}
+
+		// Level values and palette.
+		const CacheName* name = names.data();
+		memcpy(s_levelState.levelPaletteName, name->str, name->length);
+		s_levelState.levelPaletteName[name->length] = 0;
+		name++;
+		level_loadPalette();
+
+		s_levelState.parallax0 = header.parallax0;
+		s_levelState.parallax1 = header.parallax1;
+		s_levelState.minLayer = header.minLayer;
+		s_levelState.maxLayer = header.maxLayer;
+
+		// Textures.
+		s_levelState.textureCount = header.textureCount;
+		s_levelState.textures = (TextureData**)level_alloc(2 * s_levelState.textureCount * sizeof(TextureData**));
+		memset(s_levelState.textures, 0, 2 * s_levelState.textureCount * sizeof(TextureData**));
+		for (s32 i = 0; i < s_levelState.textureCount; i++, name++)
+		{
+			char textureName[256];
+			memcpy(textureName, name->str, name->length);
+			textureName[name->length] = 0;
+			if (!level_loadTexture(i, name->length ? textureName : nullptr))
+			{
+				return JFALSE;
+			}
+		}
+
+		// Sectors and walls, read in bulk and then fixed up.
+		s_levelState.sectorCount = header.sectorCount;
+		s_levelState.sectors = (RSector*)level_alloc(sizeof(RSector) * s_levelState.sectorCount);
+		memcpy(s_levelState.sectors, srcSectors, sizeof(RSector) * s_levelState.sectorCount);
+
+		RSector* sector = s_levelState.sectors;
+		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++)
+		{
+			const s32 vtxStart = levelCache_decode(sector->verticesWS);
+			const s32 wallStart = levelCache_decode(sector->walls);
+			const size_t vtxSize = sector->vertexCount * sizeof(vec2_fixed);
+
+			sector->self = sector;
+			sector->verticesWS = (vec2_fixed*)level_alloc(vtxSize);
+			sector->verticesVS = (vec2_fixed*)level_alloc(vtxSize);
+			memcpy(sector->verticesWS, &srcVertices[vtxStart], vtxSize);
+
+			sector->walls = (RWall*)level_alloc(sector->wallCount * sizeof(RWall));
+			memcpy(sector->walls, &srcWalls[wallStart], sector->wallCount * sizeof(RWall));
+
+			sector->floorTex = levelCache_fixupTexture(sector->floorTex);
+			sector->ceilTex = levelCache_fixupTexture(sector->ceilTex);
+			sector->infLink = nullptr;
+			sector->objectCount = 0;
+			sector->objectCapacity = 0;
+			sector->objectList = nullptr;
+			sector->dirtyFlags = SDF_ALL;
+
+			RWall* wall = sector->walls;
+			for (s32 w = 0; w < sector->wallCount; w++, wall++)
+			{
+				const s32 i0 = levelCache_decode(wall->w0);
+				const s32 i1 = levelCache_decode(wall->w1);
+				wall->sector = sector;
+				wall->nextSector = wall->nextSector ? &s_levelState.sectors[levelCache_decode(wall->nextSector)] : nullptr;
+				wall->mirrorWall = nullptr;
+				wall->w0 = &sector->verticesWS[i0];
+				wall->w1 = &sector->verticesWS[i1];
+				wall->v0 = &sector->verticesVS[i0];
+				wall->v1 = &sector->verticesVS[i1];
+				wall->topTex  = levelCache_fixupTexture(wall->topTex);
+				wall->midTex  = levelCache_fixupTexture(wall->midTex);
+				wall->botTex  = levelCache_fixupTexture(wall->botTex);
+				wall->signTex = levelCache_fixupTexture(wall->signTex);
+				wall->infLink = nullptr;
+			}
+		}
+		level_serializeFixupMirrors();
+
+		// Replay the sector setup in the same order as the parser, so addresses and special elevators match.
+		sector = s_levelState.sectors;
+		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++, name++)
+		{
+			if (name->length)
+			{
+				char sectorName[256];
+				memcpy(sectorName, name->str, name->length);
+				sectorName[name->length] = 0;
+				level_addSectorAddress(sector, sectorName);
+			}
+			level_setupSectorFlags(sector);
+		}
+		sectorGrid_build();
+
+		// Setup the control sector.
+		s_levelState.controlSector->id = s_levelState.sectorCount;
+		s_levelState.controlSector->index = s_levelState.controlSector->id;
+
+		s_cacheData.clear();
+		return JTRUE;
+	}
+
+	JBool levelCache_readTextureNames(const char* levelName, u64 sourceHash, std::vector<std::string>& textureNames)
+	{
+		char cachePath[TFE_MAX_PATH];
+		levelCache_getPath(levelName, cachePath);
+
+		FileStream file;
+		if (!FileUtil::exists(cachePath) || !file.open(cachePath, Stream::MODE_READ))
+		{
+			return JFALSE;
+		}
+		// The names come right after the header, so the rest of the file does not need to be read.
+		LevelCacheHeader header;
+		const size_t size = file.getSize();
+		const size_t namesOffset = levelCache_align(sizeof(LevelCacheHeader));
+		if (size < namesOffset)
+		{
+			file.close();
+			return JFALSE;
+		}
+		file.readBuffer(&header, sizeof(LevelCacheHeader));
+		if (!levelCache_validHeader(&header, sourceHash) || namesOffset + header.namesSize > size)
+		{
+			file.close();
+			return JFALSE;
+		}
+		std::vector<u8> data(header.namesSize);
+		file.seek(s32(namesOffset));
+		file.readBuffer(data.data(), header.namesSize);
+		file.close();
+
+		// Skip the palette name.
+		std::vector<CacheName> names;
+		if (!levelCache_readNames(data.data(), header.namesSize, names, 1 + u32(header.textureCount)))
+		{
+			return JFALSE;
+		}
+		textureNames.resize(header.textureCount);
+		for (s32 i = 0; i < header.textureCount; i++)
+		{
+			textureNames[i].assign(names[i + 1].str, names[i + 1].length);
+		}
+		return JTRUE;
+	}
+
+	void levelCache_write(const char* levelName, u64 sourceHash, const std::vector<std::string>& textureNames, const std::vector<std::string>& sectorNames)
+	{
+		char cacheDir[TFE_MAX_PATH];
+		sprintf(cacheDir, "%sCache/", TFE_Paths::getPath(PATH_PROGRAM_DATA));
+		FileUtil::makeDirectory(cacheDir);
+		strcat(cacheDir, "Levels/");
+		FileUtil::makeDirectory(cacheDir);
+
+		// Names.
+		std::vector<u8> names;
+		levelCache_appendName(names, s_levelState.levelPaletteName);
+		for (s32 i = 0; i < s_levelState.textureCount; i++)
+		{
+			levelCache_appendName(names, textureNames[i].c_str());
+		}
+		for (u32 i = 0; i < s_levelState.sectorCount; i++)
+		{
+			levelCache_appendName(names, sectorNames[i].c_str());
+		}
+
+		// Convert the records, replacing pointers with indices.
+		std::vector<RSector> sectors(s_levelState.sectorCount);
+		std::vector<vec2_fixed> vertices;
+		std::vector<RWall> walls;
+		RSector* srcSector = s_levelState.sectors;
+		for (u32 i = 0; i < s_levelState.sectorCount; i++, srcSector++)
+		{
+			RSector* sector = &sectors[i];
+			*sector = *srcSector;
+			sector->self = nullptr;
+			sector->verticesWS = levelCache_encode<vec2_fixed>(s32(vertices.size()));
+			sector->verticesVS = nullptr;
+			sector->walls = levelCache_encode<RWall>(s32(walls.size()));
+			sector->floorTex = levelCache_encode<TextureData*>(levelCache_encodeTexture(srcSector->floorTex));
+			sector->ceilTex = levelCache_encode<TextureData*>(levelCache_encodeTexture(srcSector->ceilTex));
+			sector->infLink = nullptr;
+			sector->objectList = nullptr;
+			vertices.insert(vertices.end(), srcSector->verticesWS, srcSector->verticesWS + srcSector->vertexCount);
+
+			const RWall* srcWall = srcSector->walls;
+			for (s32 w = 0; w < srcSector->wallCount; w++, srcWall++)
+			{
+				RWall wall = *srcWall;
+				wall.sector = levelCache_encode<RSector>(s32(i));
+				wall.nextSector = srcWall->nextSector ? levelCache_encode<RSector>(s32(srcWall->nextSector - s_levelState.sectors)) : nullptr;
+				wall.mirrorWall = nullptr;
+				wall.w0 = levelCache_encode<vec2_fixed>(s32(srcWall->w0 - srcSector->verticesWS));
+				wall.w1 = levelCache_encode<vec2_fixed>(s32(srcWall->w1 - srcSector->verticesWS));
+				wall.v0 = nullptr;
+				wall.v1 = nullptr;
+				wall.topTex  = levelCache_encode<TextureData*>(levelCache_encodeTexture(srcWall->topTex));
+				wall.midTex  = levelCache_encode<TextureData*>(levelCache_encodeTexture(srcWall->midTex));
+				wall.botTex  = levelCache_encode<TextureData*>(levelCache_encodeTexture(srcWall->botTex));
+				wall.signTex = levelCache_encode<TextureData*>(levelCache_encodeTexture(srcWall->signTex));
+				wall.infLink = nullptr;
+				walls.push_back(wall);
+			}
+		}
+
+		LevelCacheHeader header = {};
+		header.magic = LEVEL_CACHE_MAGIC;
+		header.version = LEVEL_CACHE_VERSION;
+		header.sourceHash = sourceHash;
+		header.sectorSize = sizeof(RSector);
+		header.wallSize = sizeof(RWall);
+		header.pointerSize = sizeof(void*);
+		header.textureCount = s_levelState.textureCount;
+		header.sectorCount = s_levelState.sectorCount;
+		header.vertexCount = u32(vertices.size());
+		header.wallCount = u32(walls.size());
+		header.namesSize = u32(names.size());
+		header.minLayer = s_levelState.minLayer;
+		header.maxLayer = s_levelState.maxLayer;
+		header.parallax0 = s_levelState.parallax0;
+		header.parallax1 = s_levelState.parallax1;
+
+		char cachePath[TFE_MAX_PATH];
+		levelCache_getPath(levelName, cachePath);
+		FileStream file;
+		if (!file.open(cachePath, Stream::MODE_WRITE))
+		{
+			TFE_System::logWrite(LOG_WARNING, "LevelCache", "Cannot write level cache '%s'.", cachePath);
+			return;
+		}
+
+		const u8 pad[LEVEL_CACHE_ALIGN] = { 0 };
+		size_t offset = sizeof(LevelCacheHeader);
+		file.writeBuffer(&header, sizeof(LevelCacheHeader));
+		file.writeBuffer(pad, u32(levelCache_align(offset) - offset));
+		offset = levelCache_align(offset);
+
+		file.writeBuffer(names.data(), u32(names.size()));
+		offset += names.size();
+		file.writeBuffer(pad, u32(levelCache_align(offset) - offset));
+		offset = levelCache_align(offset);
+
+		file.writeBuffer(sectors.data(), u32(sectors.size() * sizeof(RSector)));
+		offset += sectors.size() * sizeof(RSector);
+		file.writeBuffer(pad, u32(levelCache_align(offset) - offset));
+		offset = levelCache_align(offset);
+
+		file.writeBuffer(vertices.data(), u32(vertices.size() * sizeof(vec2_fixed)));
+		offset += vertices.size() * sizeof(vec2_fixed);
+		file.writeBuffer(pad, u32(levelCache_align(offset) - offset));
+
+		file.writeBuffer(walls.data(), u32(walls.size() * sizeof(RWall)));
+		file.close();
+	}
+}
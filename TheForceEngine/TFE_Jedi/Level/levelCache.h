@@ -0,0 +1,32 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Level Cache
+// Added for TFE: a binary cache of the level geometry built from the
+// text .LEV file.
+//
+// Once a level has been parsed, the final sector, wall and vertex
+// records are written to the program data directory along with the
+// texture and sector names. Pointers are stored as indices so that the
+// records can be loaded with a few bulk reads followed by a fixup pass.
+// The cache is keyed by a hash of the .LEV contents, so editing the
+// level or loading a mod with a different version invalidates it.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include <string>
+#include <vector>
+
+namespace TFE_Jedi
+{
+	// Hash of the source level data, used to validate the cache.
+	u64 levelCache_hash(const void* data, size_t size);
+
+	// Loads the level geometry from the cache, returns JFALSE if there is no valid cache for 'sourceHash'.
+	// On failure the level state is left untouched, so the level can be parsed normally.
+	JBool levelCache_read(const char* levelName, u64 sourceHash);
+	// Reads only the texture names from the cache, returns JFALSE if there is no valid cache for 'sourceHash'.
+	// Missing textures have empty names.
+	JBool levelCache_readTextureNames(const char* levelName, u64 sourceHash, std::vector<std::string>& textureNames);
+	// Writes the geometry currently loaded, should be called once the level geometry has been fully built.
+	// 'textureNames' and 'sectorNames' are the names read from the level, empty if missing.
+	void levelCache_write(const char* levelName, u64 sourceHash, const std::vector<std::string>& textureNames, const std::vector<std::string>& sectorNames);
+}
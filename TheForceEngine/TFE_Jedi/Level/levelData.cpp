@@ -5,6 +5,7 @@
 #include "rsector.h"
 #include "rwall.h"
 #include "robjData.h"
+#include "sectorGrid.h"
 #include <TFE_Game/igame.h>
 #include <TFE_System/system.h>
 #include <TFE_Asset/spriteAsset_Jedi.h>
@@ -49,6 +50,7 @@ namespace TFE_Jedi
 	{
 		s_levelState = { 0 };
 		s_levelIntState = { 0 };
+		sectorGrid_free();
 
 		s_levelState.controlSector = (RSector*)level_alloc(sizeof(RSector));
 		sector_clear(s_levelState.controlSector);
@@ -215,6 +217,7 @@ namespace TFE_Jedi
 			}
 
 			level_serializeFixupMirrors();
+			sectorGrid_build();
 		}
 
 		// Serialize objects.
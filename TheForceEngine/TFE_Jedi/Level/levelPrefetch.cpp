@@ -0,0 +1,435 @@
+#include <cstdio>
+#include <cstring>
+
+#include "levelPrefetch.h"
+#include "levelCache.h"
+#include "rtexture.h"
+#include <TFE_Archive/archive.h>
+#include <TFE_Asset/spriteAsset_Jedi.h>
+#include <TFE_FileSystem/filestream.h>
+#include <TFE_FileSystem/paths.h>
+#include <TFE_System/parser.h>
+#include <TFE_System/profiler.h>
+#include <TFE_System/system.h>
+#include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/signal.h>
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace TFE_Jedi
+{
+	enum
+	{
+		PREFETCH_MAX_THREADS = 8,
+	};
+
+	enum PrefetchJobState : u32
+	{
+		JOB_PENDING = 0,
+		JOB_RUNNING,
+		JOB_DONE,
+	};
+
+	struct PrefetchJob
+	{
+		PrefetchType type;
+		std::string name;
+		FilePath path;
+		JBool found;
+		const u8* mapped;		// File contents in a memory mapped archive.
+		size_t mappedSize;
+		std::vector<u8> data;	// File data for PREFETCH_3DO and PREFETCH_VOC, or the contents of a loose file.
+		void* asset;			// Decoded asset.
+		atomic_u32 state;
+		JBool taken;
+	};
+
+	struct PrefetchWorker
+	{
+		Thread* thread;
+		std::vector<u8> buffer;	// Loose files are read into this buffer before being decoded.
+	};
+
+	static PrefetchJob* s_jobs = nullptr;
+	static s32 s_jobCount = 0;
+	static std::unordered_map<std::string, s32> s_jobIndex;
+	static PrefetchWorker s_workers[PREFETCH_MAX_THREADS];
+	static s32 s_workerCount = 0;
+	static std::vector<u8> s_mainBuffer;
+	static Signal* s_jobDone = nullptr;
+	static atomic_s32 s_nextJob;
+	static atomic_bool s_cancel;
+
+	TFE_THREADRET prefetchWorkerFunc(void* userData);
+
+	/////////////////////////////////////////////
+	// Jobs
+	/////////////////////////////////////////////
+	bool isDecodedType(PrefetchType type)
+	{
+		return type == PREFETCH_BM || type == PREFETCH_FME || type == PREFETCH_WAX;
+	}
+
+	std::string prefetch_getKey(PrefetchType type, const char* name)
+	{
+		std::string key(1, char('0' + type));
+		key += name;
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+		return key;
+	}
+
+	bool prefetch_readLooseFile(const char* path, std::vector<u8>& buffer)
+	{
+		FileStream file;
+		if (!file.open(path, Stream::MODE_READ))
+		{
+			return false;
+		}
+		buffer.resize(file.getSize());
+		file.readBuffer(buffer.data(), u32(buffer.size()));
+		file.close();
+		return true;
+	}
+
+	void prefetch_freeAsset(PrefetchType type, void* asset)
+	{
+		if (!asset) { return; }
+		if (type == PREFETCH_BM)
+		{
+			TextureData* texture = (TextureData*)asset;
+			free(texture->image);
+			free(texture->columns);
+		}
+		free(asset);
+	}
+
+	// Read and decode a job, 'buffer' belongs to the calling thread.
+	void prefetch_execute(PrefetchJob* job, std::vector<u8>& buffer)
+	{
+		TFE_ZONE("Prefetch Job");
+		if (!job->found) { return; }
+
+		const u8* data = job->mapped;
+		size_t size = job->mappedSize;
+		if (!data && !job->path.archive)
+		{
+			std::vector<u8>& dst = isDecodedType(job->type) ? buffer : job->data;
+			if (!prefetch_readLooseFile(job->path.path, dst))
+			{
+				dst.clear();
+				return;
+			}
+			data = dst.data();
+			size = dst.size();
+		}
+		if (!data || !size) { return; }
+
+		switch (job->type)
+		{
+			case PREFETCH_BM:
+			{
+				job->asset = bitmap_loadFromMemory(data, size, 1);
+			} break;
+			case PREFETCH_FME:
+			{
+				job->asset = TFE_Sprite_Jedi::decodeFrame(data, size);
+			} break;
+			case PREFETCH_WAX:
+			{
+				job->asset = TFE_Sprite_Jedi::decodeWax(data, size);
+			} break;
+			default:
+			{
+				if (job->mapped) { job->data.assign(data, data + size); }
+			}
+		}
+		// Decoded types no longer need the source data.
+		if (isDecodedType(job->type))
+		{
+			job->data.clear();
+			job->data.shrink_to_fit();
+		}
+	}
+
+	// Claim a job that has not been started, returns false if another thread already has it.
+	bool prefetch_claim(PrefetchJob* job)
+	{
+		u32 expected = JOB_PENDING;
+		return job->state.compare_exchange_strong(expected, JOB_RUNNING);
+	}
+
+	void prefetch_addJob(std::vector<std::pair<PrefetchType, std::string>>& list, PrefetchType type, const char* name)
+	{
+		const std::string key = prefetch_getKey(type, name);
+		if (s_jobIndex.find(key) != s_jobIndex.end()) { return; }
+		s_jobIndex[key] = s32(list.size());
+		list.push_back({ type, name });
+	}
+
+	/////////////////////////////////////////////
+	// Scanning
+	/////////////////////////////////////////////
+	bool prefetch_readFile(const char* levelName, const char* ext, std::vector<char>& buffer)
+	{
+		char path[TFE_MAX_PATH];
+		snprintf(path, TFE_MAX_PATH, "%s%s", levelName, ext);
+		FilePath filePath;
+		if (!TFE_Paths::getFilePath(path, &filePath)) { return false; }
+
+		FileStream file;
+		if (!file.open(&filePath, Stream::MODE_READ)) { return false; }
+		buffer.resize(file.getSize());
+		file.readBuffer(buffer.data(), u32(buffer.size()));
+		file.close();
+		return !buffer.empty();
+	}
+
+	void prefetch_addTexture(std::vector<std::pair<PrefetchType, std::string>>& list, const char* textureName)
+	{
+		if (textureName[0] && strcasecmp(textureName, "<NoTexture>") != 0)
+		{
+			prefetch_addJob(list, PREFETCH_BM, textureName);
+		}
+	}
+
+	// The texture list is near the start of the level, so scanning stops once it has been read.
+	void prefetch_scanTextures(const char* levelName, const std::vector<char>& levelData, u64 sourceHash, std::vector<std::pair<PrefetchType, std::string>>& list)
+	{
+		// The level cache stores the texture names, so the level does not need to be parsed.
+		std::vector<std::string> textureNames;
+		if (levelCache_readTextureNames(levelName, sourceHash, textureNames))
+		{
+			for (size_t i = 0; i < textureNames.size(); i++)
+			{
+				prefetch_addTexture(list, textureNames[i].c_str());
+			}
+			return;
+		}
+
+		TFE_Parser parser;
+		size_t bufferPos = 0;
+		parser.init(levelData.data(), levelData.size());
+		parser.addCommentString("#");
+		parser.convertToUpperCase(true);
+
+		const char* line;
+		s32 textureCount = 0;
+		while ((line = parser.readLine(bufferPos)) != nullptr)
+		{
+			if (sscanf(line, " TEXTURES %d", &textureCount) == 1) { break; }
+		}
+		for (s32 i = 0; i < textureCount && (line = parser.readLine(bufferPos)); i++)
+		{
+			char textureName[256];
+			if (sscanf(line, " TEXTURE: %s ", textureName) == 1)
+			{
+				prefetch_addTexture(list, textureName);
+			}
+		}
+	}
+
+	// The asset lists come before the objects, so scanning stops at the object list.
+	void prefetch_scanObjects(const char* levelName, std::vector<std::pair<PrefetchType, std::string>>& list)
+	{
+		std::vector<char> buffer;
+		if (!prefetch_readFile(levelName, ".O", buffer)) { return; }
+
+		TFE_Parser parser;
+		size_t bufferPos = 0;
+		parser.init(buffer.data(), buffer.size());
+		parser.enableBlockComments();
+		parser.addCommentString("//");
+		parser.addCommentString("#");
+		parser.convertToUpperCase(true);
+
+		const char* line;
+		s32 count;
+		while ((line = parser.readLine(bufferPos)) != nullptr)
+		{
+			if (sscanf(line, "OBJECTS %d", &count) == 1) { break; }
+
+			const char* format = nullptr;
+			PrefetchType type = PREFETCH_COUNT;
+			if (sscanf(line, "PODS %d", &count) == 1)        { format = " POD: %s";    type = PREFETCH_3DO; }
+			else if (sscanf(line, "SPRS %d", &count) == 1)   { format = " SPR: %s ";   type = PREFETCH_WAX; }
+			else if (sscanf(line, "FMES %d", &count) == 1)   { format = " FME: %s ";   type = PREFETCH_FME; }
+			else if (sscanf(line, "SOUNDS %d", &count) == 1) { format = " SOUND: %s "; type = PREFETCH_VOC; }
+			if (!format) { continue; }
+
+			for (s32 i = 0; i < count && (line = parser.readLine(bufferPos)); i++)
+			{
+				char name[32];
+				if (sscanf(line, format, name) != 1) { continue; }
+				// Sounds without an extension are looked up in the LFD files first, those are loaded normally.
+				if (type == PREFETCH_VOC && !strstr(name, ".VOC")) { continue; }
+				prefetch_addJob(list, type, name);
+			}
+		}
+	}
+
+	/////////////////////////////////////////////
+	// API
+	/////////////////////////////////////////////
+	void levelPrefetch_begin(const char* levelName, const std::vector<char>& levelData, u64 sourceHash)
+	{
+		TFE_ZONE("Level Prefetch Scan");
+		levelPrefetch_end();
+
+		std::vector<std::pair<PrefetchType, std::string>> list;
+		prefetch_scanTextures(levelName, levelData, sourceHash, list);
+		prefetch_scanObjects(levelName, list);
+		if (list.empty()) { return; }
+
+		// Resolve the file paths on the main thread. Loose files and mapped data are read by the workers.
+		s_jobCount = s32(list.size());
+		s_jobs = new PrefetchJob[s_jobCount];
+		for (s32 i = 0; i < s_jobCount; i++)
+		{
+			PrefetchJob* job = &s_jobs[i];
+			job->type = list[i].first;
+			job->name = list[i].second;
+			job->mapped = nullptr;
+			job->mappedSize = 0;
+			job->asset = nullptr;
+			job->taken = JFALSE;
+			job->state.store(JOB_PENDING);
+			job->found = TFE_Paths::getFilePath(job->name.c_str(), &job->path) ? JTRUE : JFALSE;
+			if (!job->found || !job->path.archive) { continue; }
+
+			job->mapped = job->path.archive->getFileData(job->path.index);
+			if (job->mapped)
+			{
+				job->mappedSize = job->path.archive->getFileLength(job->path.index);
+				continue;
+			}
+			// Archive file access is not thread safe, so files in archives that are not memory mapped
+			// are not prefetched and the loader reads them as usual.
+			job->state.store(JOB_DONE);
+			s_jobIndex.erase(prefetch_getKey(job->type, job->name.c_str()));
+		}
+
+		// The main thread processes jobs as well when the loader gets ahead of the workers.
+		const s32 coreCount = s32(std::thread::hardware_concurrency());
+		const s32 workerCount = std::min(std::max(coreCount - 1, 1), std::min(s_jobCount, (s32)PREFETCH_MAX_THREADS));
+		if (!s_jobDone)
+		{
+			s_jobDone = Signal::create();
+		}
+		s_nextJob.store(0);
+		s_cancel.store(false);
+		for (s32 i = 0; i < workerCount; i++)
+		{
+			PrefetchWorker* worker = &s_workers[i];
+			worker->thread = Thread::create("PrefetchThread", prefetchWorkerFunc, worker);
+			if (!worker->thread || !worker->thread->run())
+			{
+				TFE_System::logWrite(LOG_ERROR, "Level Prefetch", "Cannot create prefetch thread %d.", i);
+				delete worker->thread;
+				worker->thread = nullptr;
+				break;
+			}
+			s_workerCount++;
+		}
+		TFE_System::logWrite(LOG_MSG, "Level Prefetch", "Prefetching %d assets using %d worker threads.", s_jobCount, s_workerCount);
+	}
+
+	void levelPrefetch_end()
+	{
+		if (!s_jobs) { return; }
+
+		// Jobs that have not been started are skipped.
+		s_cancel.store(true);
+		for (s32 i = 0; i < s_workerCount; i++)
+		{
+			PrefetchWorker* worker = &s_workers[i];
+			worker->thread->waitOnExit();
+			delete worker->thread;
+			worker->thread = nullptr;
+			worker->buffer.clear();
+			worker->buffer.shrink_to_fit();
+		}
+		s_workerCount = 0;
+
+		for (s32 i = 0; i < s_jobCount; i++)
+		{
+			if (!s_jobs[i].taken)
+			{
+				prefetch_freeAsset(s_jobs[i].type, s_jobs[i].asset);
+			}
+		}
+		delete[] s_jobs;
+		s_jobs = nullptr;
+		s_jobCount = 0;
+		s_jobIndex.clear();
+		s_mainBuffer.clear();
+		s_mainBuffer.shrink_to_fit();
+	}
+
+	PrefetchJob* prefetch_waitForJob(PrefetchType type, const char* name)
+	{
+		if (!s_jobs) { return nullptr; }
+		std::unordered_map<std::string, s32>::iterator iJob = s_jobIndex.find(prefetch_getKey(type, name));
+		if (iJob == s_jobIndex.end()) { return nullptr; }
+
+		PrefetchJob* job = &s_jobs[iJob->second];
+		if (job->taken) { return nullptr; }
+		if (prefetch_claim(job))
+		{
+			// No worker has started this job yet, so do it here rather than wait.
+			prefetch_execute(job, s_mainBuffer);
+			job->state.store(JOB_DONE);
+		}
+		else
+		{
+			TFE_ZONE("Prefetch Wait");
+			while (job->state.load() != JOB_DONE)
+			{
+				s_jobDone->wait();
+			}
+		}
+		job->taken = JTRUE;
+		return job;
+	}
+
+	JBool levelPrefetch_takeAsset(PrefetchType type, const char* name, void** asset)
+	{
+		PrefetchJob* job = prefetch_waitForJob(type, name);
+		if (!job) { return JFALSE; }
+		*asset = job->asset;
+		job->asset = nullptr;
+		return JTRUE;
+	}
+
+	JBool levelPrefetch_takeData(PrefetchType type, const char* name, std::vector<u8>* data)
+	{
+		PrefetchJob* job = prefetch_waitForJob(type, name);
+		if (!job) { return JFALSE; }
+		data->swap(job->data);
+		job->data.clear();
+		return JTRUE;
+	}
+
+	/////////////////////////////////////////////
+	// Workers
+	/////////////////////////////////////////////
+	TFE_THREADRET prefetchWorkerFunc(void* userData)
+	{
+		PrefetchWorker* worker = (PrefetchWorker*)userData;
+		TFE_Profiler::setThreadName("PrefetchThread");
+		while (!s_cancel.load())
+		{
+			const s32 index = s_nextJob.fetch_add(1);
+			if (index >= s_jobCount) { break; }
+
+			PrefetchJob* job = &s_jobs[index];
+			if (!prefetch_claim(job)) { continue; }
+			prefetch_execute(job, worker->buffer);
+			job->state.store(JOB_DONE);
+			s_jobDone->fire();
+		}
+		return (TFE_THREADRET)0;
+	}
+}
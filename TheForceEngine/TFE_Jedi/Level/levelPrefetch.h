@@ -0,0 +1,44 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Level Prefetch
+// Added for TFE: reads and decodes the assets referenced by a level
+// on worker threads while the level is being loaded.
+//
+// The texture list of the .LEV file (or the level cache) and the pod,
+// sprite, frame and sound lists of the .O file are scanned before
+// parsing starts. Each asset becomes a job, which the workers read
+// (from the memory mapped archive, or from disk for loose files) and
+// decode into their own buffers. Assets in archives that cannot be
+// memory mapped are left to the loader. The loaders then take the results as they reach each asset,
+// so assets are still added to the asset tables in the original order
+// and the load result is identical to a serial load. If the loader
+// reaches an asset that no worker has started yet, it is processed on
+// the main thread instead of waiting.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include <vector>
+
+namespace TFE_Jedi
+{
+	enum PrefetchType
+	{
+		PREFETCH_BM = 0,	// Decoded texture (bitmap_loadFromMemory() with decompression).
+		PREFETCH_FME,		// Decoded frame.
+		PREFETCH_WAX,		// Decoded sprite.
+		PREFETCH_3DO,		// File data, models are parsed by the loader.
+		PREFETCH_VOC,		// File data.
+		PREFETCH_COUNT
+	};
+
+	// Scan the level asset lists and start reading and decoding them in the background.
+	// 'levelData' is the contents of the .LEV file and 'sourceHash' its level cache hash.
+	void levelPrefetch_begin(const char* levelName, const std::vector<char>& levelData, u64 sourceHash);
+	// Wait for the workers to exit and free any results that were not taken.
+	void levelPrefetch_end();
+
+	// Take the decoded asset for 'name', waiting for it if necessary. Returns JFALSE if the asset was not prefetched,
+	// in which case it should be loaded normally. On success the caller owns '*asset', which is null if loading failed.
+	JBool levelPrefetch_takeAsset(PrefetchType type, const char* name, void** asset);
+	// Take the file data for 'name', 'data' is left empty if the file could not be read.
+	JBool levelPrefetch_takeData(PrefetchType type, const char* name, std::vector<u8>* data);
+}
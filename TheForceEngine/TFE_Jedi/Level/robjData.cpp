@@ -33,6 +33,7 @@ namespace TFE_Jedi
 	{
 		if (!s_objData.objectList)
 		{
+			TFE_ALLOC_SITE();
 			s_objData.objectList = TFE_Memory::createChunkedArray(sizeof(SecObject), 256, 1, s_levelRegion);
 		}
 		return (SecObject*)TFE_Memory::allocFromChunkedArray(s_objData.objectList);
@@ -191,6 +192,7 @@ namespace TFE_Jedi
 			if (!s_objData.objectList)
 			{
 				const u32 initChunkCount = max(1, (writeCount + 255) >> 8);
+				TFE_ALLOC_SITE();
 				s_objData.objectList = TFE_Memory::createChunkedArray(sizeof(SecObject), 256, initChunkCount, s_levelRegion);
 			}
 			else
@@ -6,6 +6,7 @@
 #include "robject.h"
 #include "level.h"
 #include "levelData.h"
+#include "sectorGrid.h"
 #include <TFE_Game/igame.h>
 #include <TFE_System/system.h>
 #include <TFE_DarkForces/player.h>
@@ -205,6 +206,8 @@ namespace TFE_Jedi
 		sector->boundsMax.x = maxX;
 		sector->boundsMin.z = minZ;
 		sector->boundsMax.z = maxZ;
+		// TFE: Keep the sector grid in sync with the bounds.
+		sectorGrid_updateSector(sector);
 
 		// Setup when needed.
 		//s_minX = minX;
@@ -519,13 +522,19 @@ namespace TFE_Jedi
 		fixed16_16 iz = dz;
 		fixed16_16 y = dy;
 		
-		RSector* sector = s_levelState.sectors;
 		RSector* foundSector = nullptr;
 		s32 sectorUnitArea = 0;
 		s32 prevSectorUnitArea = INT_MAX;
 
-		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++)
+		// TFE: Only visit the sectors whose bounds overlap the grid cell containing the point.
+		// The candidates are sorted by index, so the result matches a scan over every sector.
+		s32 count;
+		const s32* candidates = sectorGrid_getCandidates(ix, iz, &count);
+		if (!candidates) { count = s32(s_levelState.sectorCount); }
+
+		for (s32 i = 0; i < count; i++)
 		{
+			RSector* sector = &s_levelState.sectors[candidates ? candidates[i] : i];
 			if (y >= sector->ceilingHeight && y <= sector->floorHeight)
 			{
 				const fixed16_16 sectorMaxX = sector->boundsMax.x;
@@ -558,13 +567,19 @@ namespace TFE_Jedi
 		fixed16_16 ix = dx;
 		fixed16_16 iz = dz;
 
-		RSector* sector = s_levelState.sectors;
 		RSector* foundSector = nullptr;
 		s32 sectorUnitArea = 0;
 		s32 prevSectorUnitArea = INT_MAX;
 
-		for (u32 i = 0; i < s_levelState.sectorCount; i++, sector++)
+		// TFE: Only visit the sectors whose bounds overlap the grid cell containing the point.
+		// The candidates are sorted by index, so the result matches a scan over every sector.
+		s32 count;
+		const s32* candidates = sectorGrid_getCandidates(ix, iz, &count);
+		if (!candidates) { count = s32(s_levelState.sectorCount); }
+
+		for (s32 i = 0; i < count; i++)
 		{
+			RSector* sector = &s_levelState.sectors[candidates ? candidates[i] : i];
 			if (sector->layer == layer)
 			{
 				const fixed16_16 sectorMaxX = sector->boundsMax.x;
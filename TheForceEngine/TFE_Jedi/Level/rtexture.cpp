@@ -1,16 +1,17 @@
 #include <cstring>
 
 #include "rtexture.h"
+#include "levelPrefetch.h"
 #include <TFE_Game/igame.h>
 #include <TFE_System/system.h>
 #include <TFE_Archive/archive.h>
 #include <TFE_Asset/assetSystem.h>
+#include <TFE_Asset/assetRegistry.h>
 #include <TFE_FileSystem/paths.h>
 #include <TFE_FileSystem/filestream.h>
 #include <TFE_Jedi/Task/task.h>
 #include <TFE_Jedi/Serialization/serialization.h>
 #include <TFE_System/math.h>
-#include <unordered_map>
 
 using namespace TFE_DarkForces;
 using namespace TFE_Memory;
@@ -23,13 +24,7 @@ namespace TFE_Jedi
 		DF_ANIM_ID = 2,
 	};
 
-	struct LevelTexture
-	{
-		std::string name;
-		TextureData* texture;
-	};
-	typedef std::vector<LevelTexture> TextureList;
-	typedef std::unordered_map<std::string, s32> TextureTable;
+	typedef AssetTable<TextureData> TextureTable;
 		
 	struct TextureState
 	{
@@ -40,12 +35,12 @@ namespace TFE_Jedi
 	};
 	static TextureState s_texState = {};
 	static std::vector<u8> s_buffer;
-	static std::vector<TextureData*> s_tempTextureList;
 
-	static TextureList  s_textureList[POOL_COUNT];
 	static TextureTable s_textureTable[POOL_COUNT];
 
 	void decompressColumn_Type1(const u8* src, u8* dst, s32 pixelCount);
+	void bitmap_addLoaded(const char* name, TextureData* texture, AssetPool pool, bool addToCache);
+	TextureData* bitmap_copyToRegion(TextureData* decoded);
 	void decompressColumn_Type2(const u8* src, u8* dst, s32 pixelCount);
 	void textureAnimationTaskFunc(MessageType msg);
 
@@ -102,7 +97,6 @@ namespace TFE_Jedi
 	// Added for TFE to clear out per-level texture data.
 	void bitmap_clearLevelData()
 	{
-		s_textureList[POOL_LEVEL].clear();
 		s_textureTable[POOL_LEVEL].clear();
 	}
 
@@ -111,7 +105,6 @@ namespace TFE_Jedi
 		s_texState = {};
 		for (s32 p = 0; p < POOL_COUNT; p++)
 		{
-			s_textureList[p].clear();
 			s_textureTable[p].clear();
 		}
 	}
@@ -120,16 +113,12 @@ namespace TFE_Jedi
 	{
 		for (s32 p = 0; p < POOL_COUNT; p++)
 		{
-			s32 count = (s32)s_textureList[p].size();
-			const LevelTexture* srcList = s_textureList[p].data();
-			for (s32 i = 0; i < count; i++)
+			const s32 i = s_textureTable[p].getIndex(tex);
+			if (i >= 0)
 			{
-				if (srcList[i].texture == tex)
-				{
-					*index = i;
-					*pool = AssetPool(p);
-					return true;
-				}
+				*index = i;
+				*pool = AssetPool(p);
+				return true;
 			}
 		}
 		return false;
@@ -137,47 +126,46 @@ namespace TFE_Jedi
 
 	TextureData* bitmap_getTextureByIndex(s32 index, AssetPool pool)
 	{
-		return s_textureList[pool][index].texture;
+		return s_textureTable[pool].get(index);
 	}
 
 	// Serialize only level textures.
 	void bitmap_serializeLevelTextures(Stream* stream)
 	{
+		TextureTable& table = s_textureTable[POOL_LEVEL];
 		s32 count = 0;
-		LevelTexture* list = nullptr;
 		if (serialization_getMode() == SMODE_WRITE)
 		{
-			count = (s32)s_textureList[POOL_LEVEL].size();
+			count = table.getCount();
 		}
 		SERIALIZE(SaveVersionInit, count, 0);
 		if (serialization_getMode() == SMODE_READ)
 		{
-			s_textureList[POOL_LEVEL].resize(count);
-			s_textureTable[POOL_LEVEL].clear();
+			table.clear();
 		}
-		list = s_textureList[POOL_LEVEL].data();
 
-		for (s32 i = 0; i < count; i++, list++)
+		std::string name;
+		for (s32 i = 0; i < count; i++)
 		{
 			// Assume names are less than 256 characters.
 			u8 length = 0;
 			if (serialization_getMode() == SMODE_WRITE)
 			{
-				length = (u8)list->name.length();
+				name = table.getName(i);
+				length = (u8)name.length();
 			}
 			SERIALIZE(SaveVersionInit, length, 0);
 			if (serialization_getMode() == SMODE_READ)
 			{
-				list->name.resize(length);
+				name.resize(length);
 			}
-			SERIALIZE_BUF(SaveVersionInit, &list->name[0], length);
+			SERIALIZE_BUF(SaveVersionInit, &name[0], length);
 
 			// If reading, we need to load the texture now.
 			if (serialization_getMode() == SMODE_READ)
 			{
-				const char* name = list->name.c_str();
-				list->texture = bitmap_load(name, 1, POOL_LEVEL, false);
-				s_textureTable[POOL_LEVEL][name] = i;
+				TextureData* texture = bitmap_load(name.c_str(), 1, POOL_LEVEL, false);
+				table.add(name.c_str(), texture);
 			}
 		}
 	}
@@ -185,26 +173,28 @@ namespace TFE_Jedi
 	TextureData** bitmap_getTextures(s32* textureCount, AssetPool pool)
 	{
 		assert(textureCount);
-		s32 count = (s32)s_textureList[pool].size();
-		s_tempTextureList.resize(count);
-		TextureData** list = s_tempTextureList.data();
-		const LevelTexture* srcList = s_textureList[pool].data();
-		for (s32 i = 0; i < count; i++)
-		{
-			list[i] = srcList[i].texture;
-		}
-		*textureCount = count;
-		return list;
+		*textureCount = s_textureTable[pool].getCount();
+		return (TextureData**)s_textureTable[pool].getList().data();
 	}
 
 	TextureData* bitmap_load(const char* name, u32 decompress, AssetPool pool, bool addToCache)
 	{
 		// TFE: Keep track of per-level texture state for serialization.
 		// This is also useful for handling per-level GPU texture mirrors.
-		TextureTable::iterator iTex = s_textureTable[pool].find(name);
-		if (iTex != s_textureTable[pool].end())
+		const s32 index = s_textureTable[pool].findIndex(name);
+		if (index >= 0)
 		{
-			return s_textureList[pool][iTex->second].texture;
+			return s_textureTable[pool].get(index);
+		}
+
+		// TFE: Use the texture decoded by the level prefetch if available.
+		TextureData* decoded = nullptr;
+		if ((decompress & 1) && levelPrefetch_takeAsset(PREFETCH_BM, name, (void**)&decoded))
+		{
+			if (!decoded) { return nullptr; }
+			TextureData* texture = bitmap_copyToRegion(decoded);
+			bitmap_addLoaded(name, texture, pool, addToCache);
+			return texture;
 		}
 
 		FilePath filepath;
@@ -213,19 +203,24 @@ namespace TFE_Jedi
 			return nullptr;
 		}
 
-		FileStream file;
-		if (!file.open(&filepath, Stream::MODE_READ))
+		// Read directly from the archive if it is memory mapped.
+		const u8* data = filepath.archive ? filepath.archive->getFileData(filepath.index) : nullptr;
+		if (!data)
 		{
-			return nullptr;
-		}
+			FileStream file;
+			if (!file.open(&filepath, Stream::MODE_READ))
+			{
+				return nullptr;
+			}
 
-		size_t size = file.getSize();
-		s_buffer.resize(size);
-		file.readBuffer(s_buffer.data(), (u32)size);
-		file.close();
+			size_t size = file.getSize();
+			s_buffer.resize(size);
+			file.readBuffer(s_buffer.data(), (u32)size);
+			file.close();
+			data = s_buffer.data();
+		}
 
 		TextureData* texture = (TextureData*)region_alloc(s_texState.memoryRegion, sizeof(TextureData));
-		const u8* data = s_buffer.data();
 		const u8* fheader = data;
 		data += 3;
 
@@ -319,18 +314,38 @@ namespace TFE_Jedi
 			data += texture->dataSize;
 		}
 
+		bitmap_addLoaded(name, texture, pool, addToCache);
+		return texture;
+	}
+
+	void bitmap_addLoaded(const char* name, TextureData* texture, AssetPool pool, bool addToCache)
+	{
 		// Add the texture to the level texture cache if appropriate.
 		if (addToCache)
 		{
-			s32 index = (s32)s_textureList[pool].size();
-			s_textureList[pool].push_back({ name, texture });
-			s_textureTable[pool][name] = index;
+			s_textureTable[pool].add(name, texture);
 		}
 
 		texture->animIndex = -1;
 		texture->frameIdx = -1;
 		texture->animPtr = nullptr;
+	}
 
+	// Move a texture decoded with bitmap_loadFromMemory() into the texture memory region.
+	TextureData* bitmap_copyToRegion(TextureData* decoded)
+	{
+		TextureData* texture = (TextureData*)region_alloc(s_texState.memoryRegion, sizeof(TextureData));
+		*texture = *decoded;
+		texture->image = (u8*)region_alloc(s_texState.memoryRegion, texture->dataSize);
+		memcpy(texture->image, decoded->image, texture->dataSize);
+		if (decoded->columns)
+		{
+			texture->columns = (u32*)region_alloc(s_texState.memoryRegion, texture->width * sizeof(u32));
+			memcpy(texture->columns, decoded->columns, texture->width * sizeof(u32));
+		}
+		free(decoded->image);
+		free(decoded->columns);
+		free(decoded);
 		return texture;
 	}
 
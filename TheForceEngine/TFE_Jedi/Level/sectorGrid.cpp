@@ -0,0 +1,247 @@
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "sectorGrid.h"
+#include "levelData.h"
+#include <TFE_System/system.h>
+#include <TFE_System/math.h>
+
+namespace TFE_Jedi
+{
+	enum SectorGridConstants
+	{
+		GRID_MIN_CELL_SHIFT = 3,		// Minimum cell size = 8 units.
+		GRID_MAX_CELL_SHIFT = 12,		// Maximum cell size = 4096 units.
+		GRID_MAX_DIM = 256,				// Maximum number of cells along each axis.
+		GRID_CELLS_PER_SECTOR = 2,		// Target cell count relative to the sector count.
+	};
+
+	struct GridRect
+	{
+		s32 x0, z0;
+		s32 x1, z1;
+	};
+
+	typedef std::vector<s32> GridCell;
+
+	static std::vector<GridCell> s_cells;
+	static std::vector<GridRect> s_sectorRect;
+	static s64 s_originX = 0;
+	static s64 s_originZ = 0;
+	static s32 s_cellShift = 0;
+	static s32 s_width = 0;
+	static s32 s_height = 0;
+	static u32 s_sectorCount = 0;
+	static JBool s_gridBuilt = JFALSE;
+	// Used to avoid adding a sector more than once when gathering the sectors in a rectangle.
+	static std::vector<u32> s_sectorStamp;
+	static u32 s_queryStamp = 0;
+	// Returned for empty cells so that a valid grid never returns a null list.
+	static const s32 c_emptyCell = -1;
+
+	/////////////////////////////////////////////
+	// Internal
+	/////////////////////////////////////////////
+	inline s32 sectorGrid_cellX(fixed16_16 x)
+	{
+		const s64 cell = (s64(x) - s_originX) >> s_cellShift;
+		if (cell < 0) { return 0; }
+		return (cell >= s_width) ? s_width - 1 : s32(cell);
+	}
+
+	inline s32 sectorGrid_cellZ(fixed16_16 z)
+	{
+		const s64 cell = (s64(z) - s_originZ) >> s_cellShift;
+		if (cell < 0) { return 0; }
+		return (cell >= s_height) ? s_height - 1 : s32(cell);
+	}
+
+	// Cells outside of the grid are clamped to the border, which is fine since queries are clamped the same way.
+	GridRect sectorGrid_computeRect(RSector* sector)
+	{
+		GridRect rect;
+		rect.x0 = sectorGrid_cellX(sector->boundsMin.x);
+		rect.z0 = sectorGrid_cellZ(sector->boundsMin.z);
+		rect.x1 = sectorGrid_cellX(sector->boundsMax.x);
+		rect.z1 = sectorGrid_cellZ(sector->boundsMax.z);
+		return rect;
+	}
+
+	void sectorGrid_insert(const GridRect& rect, s32 index)
+	{
+		for (s32 z = rect.z0; z <= rect.z1; z++)
+		{
+			GridCell* cell = &s_cells[z * s_width + rect.x0];
+			for (s32 x = rect.x0; x <= rect.x1; x++, cell++)
+			{
+				// Keep the list sorted by index to match the linear scan order.
+				GridCell::iterator iter = std::lower_bound(cell->begin(), cell->end(), index);
+				cell->insert(iter, index);
+			}
+		}
+	}
+
+	void sectorGrid_remove(const GridRect& rect, s32 index)
+	{
+		for (s32 z = rect.z0; z <= rect.z1; z++)
+		{
+			GridCell* cell = &s_cells[z * s_width + rect.x0];
+			for (s32 x = rect.x0; x <= rect.x1; x++, cell++)
+			{
+				GridCell::iterator iter = std::lower_bound(cell->begin(), cell->end(), index);
+				if (iter != cell->end() && *iter == index)
+				{
+					cell->erase(iter);
+				}
+			}
+		}
+	}
+
+	/////////////////////////////////////////////
+	// API Implementation
+	/////////////////////////////////////////////
+	void sectorGrid_free()
+	{
+		s_cells.clear();
+		s_sectorRect.clear();
+		s_sectorStamp.clear();
+		s_queryStamp = 0;
+		s_width = 0;
+		s_height = 0;
+		s_sectorCount = 0;
+		s_gridBuilt = JFALSE;
+	}
+
+	void sectorGrid_build()
+	{
+		sectorGrid_free();
+		if (!s_levelState.sectors || !s_levelState.sectorCount) { return; }
+
+		// Compute the level extents.
+		RSector* sector = s_levelState.sectors;
+		fixed16_16 minX = sector->boundsMin.x, maxX = sector->boundsMax.x;
+		fixed16_16 minZ = sector->boundsMin.z, maxZ = sector->boundsMax.z;
+		sector++;
+		for (u32 i = 1; i < s_levelState.sectorCount; i++, sector++)
+		{
+			minX = min(minX, sector->boundsMin.x);
+			minZ = min(minZ, sector->boundsMin.z);
+			maxX = max(maxX, sector->boundsMax.x);
+			maxZ = max(maxZ, sector->boundsMax.z);
+		}
+
+		// Pick a power of two cell size so that the cell count is roughly proportional to the sector count.
+		const s64 extentX = s64(floor16(maxX) - floor16(minX)) + 1;
+		const s64 extentZ = s64(floor16(maxZ) - floor16(minZ)) + 1;
+		const s64 targetCells = s64(s_levelState.sectorCount) * GRID_CELLS_PER_SECTOR;
+		s32 shift = GRID_MIN_CELL_SHIFT;
+		while (shift < GRID_MAX_CELL_SHIFT && ((extentX * extentZ) >> (2 * shift)) > targetCells)
+		{
+			shift++;
+		}
+		while (shift < GRID_MAX_CELL_SHIFT && (((extentX >> shift) + 1) > GRID_MAX_DIM || ((extentZ >> shift) + 1) > GRID_MAX_DIM))
+		{
+			shift++;
+		}
+
+		s_originX = minX;
+		s_originZ = minZ;
+		s_cellShift = shift + 16;
+		s_width  = min(s32((s64(maxX) - s_originX) >> s_cellShift) + 1, (s32)GRID_MAX_DIM);
+		s_height = min(s32((s64(maxZ) - s_originZ) >> s_cellShift) + 1, (s32)GRID_MAX_DIM);
+		s_sectorCount = s_levelState.sectorCount;
+
+		s_cells.resize(s_width * s_height);
+		s_sectorRect.resize(s_sectorCount);
+		s_sectorStamp.resize(s_sectorCount, 0);
+
+		// Sectors are added in index order, so the cell lists start out sorted.
+		sector = s_levelState.sectors;
+		for (u32 i = 0; i < s_sectorCount; i++, sector++)
+		{
+			GridRect rect = sectorGrid_computeRect(sector);
+			s_sectorRect[i] = rect;
+			for (s32 z = rect.z0; z <= rect.z1; z++)
+			{
+				GridCell* cell = &s_cells[z * s_width + rect.x0];
+				for (s32 x = rect.x0; x <= rect.x1; x++, cell++)
+				{
+					cell->push_back(s32(i));
+				}
+			}
+		}
+		s_gridBuilt = JTRUE;
+	}
+
+	void sectorGrid_updateSector(RSector* sector)
+	{
+		if (!s_gridBuilt || s_sectorCount != s_levelState.sectorCount) { return; }
+		const s32 index = s32(sector - s_levelState.sectors);
+		if (index < 0 || index >= s32(s_sectorCount)) { return; }
+
+		GridRect rect = sectorGrid_computeRect(sector);
+		GridRect& prevRect = s_sectorRect[index];
+		if (rect.x0 == prevRect.x0 && rect.z0 == prevRect.z0 && rect.x1 == prevRect.x1 && rect.z1 == prevRect.z1)
+		{
+			return;
+		}
+		sectorGrid_remove(prevRect, index);
+		sectorGrid_insert(rect, index);
+		prevRect = rect;
+	}
+
+	const s32* sectorGrid_getCandidates(fixed16_16 x, fixed16_16 z, s32* count)
+	{
+		if (!s_gridBuilt || s_sectorCount != s_levelState.sectorCount)
+		{
+			*count = 0;
+			return nullptr;
+		}
+
+		const GridCell& cell = s_cells[sectorGrid_cellZ(z) * s_width + sectorGrid_cellX(x)];
+		*count = s32(cell.size());
+		return cell.empty() ? &c_emptyCell : cell.data();
+	}
+
+	JBool sectorGrid_getSectorsInRect(fixed16_16 x0, fixed16_16 z0, fixed16_16 x1, fixed16_16 z1, std::vector<s32>& sectors)
+	{
+		sectors.clear();
+		if (!s_gridBuilt || s_sectorCount != s_levelState.sectorCount)
+		{
+			return JFALSE;
+		}
+
+		s_queryStamp++;
+		if (!s_queryStamp)
+		{
+			// The stamp wrapped around, so clear the old stamps.
+			std::fill(s_sectorStamp.begin(), s_sectorStamp.end(), 0u);
+			s_queryStamp = 1;
+		}
+
+		const s32 cx0 = sectorGrid_cellX(x0), cx1 = sectorGrid_cellX(x1);
+		const s32 cz0 = sectorGrid_cellZ(z0), cz1 = sectorGrid_cellZ(z1);
+		for (s32 z = cz0; z <= cz1; z++)
+		{
+			const GridCell* cell = &s_cells[z * s_width + cx0];
+			for (s32 x = cx0; x <= cx1; x++, cell++)
+			{
+				const size_t count = cell->size();
+				const s32* index = cell->data();
+				for (size_t i = 0; i < count; i++)
+				{
+					if (s_sectorStamp[index[i]] != s_queryStamp)
+					{
+						s_sectorStamp[index[i]] = s_queryStamp;
+						sectors.push_back(index[i]);
+					}
+				}
+			}
+		}
+		// Callers rely on visiting sectors in index order, matching the original linear scan.
+		std::sort(sectors.begin(), sectors.end());
+		return JTRUE;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Sector Grid
+// Added for TFE: a uniform grid over the sector XZ bounds used to
+// accelerate point queries such as sector_which3D() and range queries
+// such as collision_effectObjectsInRange3D().
+//
+// Each cell stores the indices of the sectors whose bounds overlap it,
+// sorted by index so that queries visit sectors in the same order as
+// the original linear scan (which preserves tie-breaking).
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include <vector>
+#include <TFE_Jedi/Math/core_math.h>
+#include "rsector.h"
+
+namespace TFE_Jedi
+{
+	// Build the grid from the current level sectors, should be called once the sector bounds are valid.
+	void sectorGrid_build();
+	// Free the grid, sector queries fall back to a linear scan until it is rebuilt.
+	void sectorGrid_free();
+	// Update the cells overlapped by a sector after its bounds have changed.
+	void sectorGrid_updateSector(RSector* sector);
+
+	// Returns the list of sector indices (sorted) which may contain the point (x, z).
+	// Returns nullptr if the grid has not been built.
+	const s32* sectorGrid_getCandidates(fixed16_16 x, fixed16_16 z, s32* count);
+	// Fills 'sectors' with the indices (sorted, no duplicates) of the sectors whose bounds may overlap the rectangle [x0, x1] x [z0, z1].
+	// Returns JFALSE if the grid has not been built, in which case 'sectors' is left empty.
+	JBool sectorGrid_getSectorsInRect(fixed16_16 x0, fixed16_16 z0, fixed16_16 x1, fixed16_16 z1, std::vector<s32>& sectors);
+}
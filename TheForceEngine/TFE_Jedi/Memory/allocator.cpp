@@ -24,6 +24,7 @@ struct Allocator
 	// TFE
 	AllocHeader* iterSave;
 	AllocHeader* iterPrevSave;
+	u32 trackSite;
 };
 
 namespace TFE_Jedi
@@ -36,7 +37,8 @@ namespace TFE_Jedi
 	#define MAX_ALLOC_SIZE (8*1024*1024)  // 8MB
 
 	// Create and free an allocator.
-	Allocator* allocator_create(s32 allocSize, MemoryRegion* region)
+	// The name is in parentheses so that the call site tracking macro in allocator.h is not expanded.
+	Allocator* (allocator_create)(s32 allocSize, MemoryRegion* region)
 	{
 		if (allocSize > MAX_ALLOC_SIZE || allocSize <= 0)
 		{
@@ -45,6 +47,12 @@ namespace TFE_Jedi
 			return nullptr;
 		}
 		region = region ? region : s_levelRegion;	// If a null region is passed in, assume we want the level region.
+	#if TFE_MEMORY_TRACKING
+		char label[64];
+		sprintf(label, "Allocator %dB", allocSize);
+		const u32 trackSite = TFE_Memory::memtrack_takeSite(MEMTRACK_ALLOCATOR_ITEM, region, label);
+		TFE_Memory::memtrack_setSiteId(trackSite);
+	#endif
 		Allocator* res = (Allocator*)TFE_Memory::region_alloc(region, sizeof(Allocator));
 		if (!res)
 		{
@@ -62,6 +70,9 @@ namespace TFE_Jedi
 		res->iter = ALLOC_INVALID_PTR;
 		res->size = allocSize + sizeof(AllocHeader);
 		res->refCount = 0;
+	#if TFE_MEMORY_TRACKING
+		res->trackSite = trackSite;
+	#endif
 
 		return res;
 	}
@@ -91,6 +102,9 @@ namespace TFE_Jedi
 	{
 		if (!alloc) { return nullptr; }
 
+	#if TFE_MEMORY_TRACKING
+		TFE_Memory::memtrack_setSiteId(alloc->trackSite);
+	#endif
 		AllocHeader* header = (AllocHeader*)TFE_Memory::region_alloc(alloc->region, alloc->size);
 		if (!header)
 		{
@@ -4,6 +4,7 @@
 //////////////////////////////////////////////////////////////////////
 #include <TFE_System/types.h>
 #include <TFE_Memory/memoryRegion.h>
+#include <TFE_Memory/memoryTracker.h>
 
 struct Allocator;
 
@@ -43,4 +44,9 @@ namespace TFE_Jedi
 	void allocator_addRef(Allocator* alloc);
 	void allocator_release(Allocator* alloc);
 	s32  allocator_getRefCount(Allocator* alloc);
-}
\ No newline at end of file
+}
+
+#if TFE_MEMORY_TRACKING
+// Items are attributed to the place where the allocator was created.
+#define allocator_create(...) (TFE_ALLOC_SITE(), TFE_Jedi::allocator_create(__VA_ARGS__))
+#endif
\ No newline at end of file
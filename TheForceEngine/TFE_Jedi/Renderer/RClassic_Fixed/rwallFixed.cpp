@@ -12,6 +12,7 @@
 #include "redgePairFixed.h"
 #include "rclassicFixedSharedState.h"
 #include "../rcommon.h"
+#include "../rspan.h"
 #include "../jediRenderer.h"
 
 namespace TFE_Jedi
@@ -2078,74 +2079,22 @@ namespace RClassic_Fixed
 
 	void drawColumn_Fullbright()
 	{
-		fixed16_16 vCoordFixed = s_vCoordFixed;
-		u8* tex = s_texImage;
-
-		s32 v = floor16(vCoordFixed) & s_texHeightMask;
-		s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width)
-		{
-			const u8 c = tex[v];
-			vCoordFixed += s_vCoordStep;
-			v = floor16(vCoordFixed) & s_texHeightMask;
-			s_columnOut[offset] = c;
-		}
+		span_drawColumn(SPAN_FULLBRIGHT, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_16);
 	}
 
 	void drawColumn_Lit()
 	{
-		fixed16_16 vCoordFixed = s_vCoordFixed;
-		u8* tex = s_texImage;
-
-		s32 v = floor16(vCoordFixed) & s_texHeightMask;
-		s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width)
-		{
-			const u8 c = s_columnLight[tex[v]];
-			vCoordFixed += s_vCoordStep;
-			v = floor16(vCoordFixed) & s_texHeightMask;
-			s_columnOut[offset] = c;
-		}
+		span_drawColumn(SPAN_LIT, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_16);
 	}
 
 	void drawColumn_Fullbright_Trans()
 	{
-		fixed16_16 vCoordFixed = s_vCoordFixed;
-		u8* tex = s_texImage;
-
-		s32 v = floor16(vCoordFixed) & s_texHeightMask;
-		s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width)
-		{
-			const u8 c = tex[v];
-			vCoordFixed += s_vCoordStep;
-			v = floor16(vCoordFixed) & s_texHeightMask;
-			if (c) { s_columnOut[offset] = c; }
-		}
+		span_drawColumn(SPAN_FULLBRIGHT_TRANS, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_16);
 	}
 
 	void drawColumn_Lit_Trans()
 	{
-		fixed16_16 vCoordFixed = s_vCoordFixed;
-		u8* tex = s_texImage;
-
-		s32 v = floor16(vCoordFixed) & s_texHeightMask;
-		s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width)
-		{
-			const u8 c = tex[v];
-			vCoordFixed += s_vCoordStep;
-			v = floor16(vCoordFixed) & s_texHeightMask;
-			if (c) { s_columnOut[offset] = s_columnLight[c]; }
-		}
+		span_drawColumn(SPAN_LIT_TRANS, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_16);
 	}
 
 	void wall_addAdjoinSegment(s32 length, s32 x0, fixed16_16 top_dydx, fixed16_16 y1, fixed16_16 bot_dydx, fixed16_16 y0, RWallSegmentFixed* wallSegment)
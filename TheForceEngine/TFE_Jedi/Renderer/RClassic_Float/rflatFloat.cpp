@@ -7,10 +7,12 @@
 #include "rclassicFloat.h"
 #include "rclassicFloatSharedState.h"
 #include "fixedPoint20.h"
+#include "rrasterFloat.h"
 #include "../rscanline.h"
 #include "../rsectorRender.h"
 #include "../redgePair.h"
 #include "../rcommon.h"
+#include "../rspan.h"
 #include <assert.h>
 
 namespace TFE_Jedi
@@ -77,74 +79,43 @@ namespace RClassic_Float
 		}
 	}
 				
-	// This produces functionally identical results to the original but splits apart the U/V and dUdx/dVdx into seperate variables
-	// to account for C vs ASM differences.
+	// Record the scanline for the raster threads instead of drawing it directly.
+	void drawScanline_Deferred(SpanFunc func)
+	{
+		const s32 x0 = s32((s_scanlineOut - s_display) % s_width);
+		raster_addScanline(func, s_scanlineOut, x0, s_scanlineWidth, s_ftexImage, s_ftexDataEnd, s_scanlineLight,
+			s_scanlineU0, s_scanlineV0, s_scanline_dUdX, s_scanline_dVdX);
+	}
+
+	// The inner loops are shared with RClassic_Fixed, see span_drawScanline().
+	// Note this produces a distorted mapping if the texture is not 64x64.
+	// This behavior matches the original.
 	void drawScanline()
 	{
-		const fixed44_20 dVdX = s_scanline_dVdX;
-		const fixed44_20 dUdX = s_scanline_dUdX;
-		fixed44_20 V = s_scanlineV0;
-		fixed44_20 U = s_scanlineU0;
-
-		// Note this produces a distorted mapping if the texture is not 64x64.
-		// This behavior matches the original.
-		for (s32 i = s_scanlineWidth - 1; i >= 0; i--, U += dUdX, V += dVdX)
-		{
-			const u32 texel = ((floor20(U) & 63) * 64 + (floor20(V) & 63)) & s_ftexDataEnd;
-			s_scanlineOut[i] = s_scanlineLight[s_ftexImage[texel]];
-		}
+		if (s_rasterDeferred) { drawScanline_Deferred(SPAN_LIT); return; }
+		span_drawScanline(SPAN_LIT, s_scanlineOut, s_scanlineWidth, s_ftexImage, s_ftexDataEnd, s_scanlineLight,
+			s_scanlineU0, s_scanlineV0, s_scanline_dUdX, s_scanline_dVdX, FRAC_BITS_20);
 	}
 
 	void drawScanline_Fullbright()
 	{
-		const fixed44_20 dVdX = s_scanline_dVdX;
-		const fixed44_20 dUdX = s_scanline_dUdX;
-		fixed44_20 V = s_scanlineV0;
-		fixed44_20 U = s_scanlineU0;
-
-		// Note this produces a distorted mapping if the texture is not 64x64.
-		// This behavior matches the original.
-		for (s32 i = s_scanlineWidth - 1; i >= 0; i--, U += dUdX, V += dVdX)
-		{
-			const u32 texel = ((floor20(U) & 63) * 64 + (floor20(V) & 63)) & s_ftexDataEnd;
-			s_scanlineOut[i] = s_ftexImage[texel];
-		}
+		if (s_rasterDeferred) { drawScanline_Deferred(SPAN_FULLBRIGHT); return; }
+		span_drawScanline(SPAN_FULLBRIGHT, s_scanlineOut, s_scanlineWidth, s_ftexImage, s_ftexDataEnd, s_scanlineLight,
+			s_scanlineU0, s_scanlineV0, s_scanline_dUdX, s_scanline_dVdX, FRAC_BITS_20);
 	}
 
 	void drawScanline_Trans()
 	{
-		const fixed44_20 dVdX = s_scanline_dVdX;
-		const fixed44_20 dUdX = s_scanline_dUdX;
-		fixed44_20 V = s_scanlineV0;
-		fixed44_20 U = s_scanlineU0;
-
-		// Note this produces a distorted mapping if the texture is not 64x64.
-		// This behavior matches the original.
-		for (s32 i = s_scanlineWidth - 1; i >= 0; i--, U += dUdX, V += dVdX)
-		{
-			const u32 texel = ((floor20(U) & 63) * 64 + (floor20(V) & 63)) & s_ftexDataEnd;
-			const u8 baseColor = s_ftexImage[texel];
-
-			if (baseColor) { s_scanlineOut[i] = s_scanlineLight[baseColor]; }
-		}
+		if (s_rasterDeferred) { drawScanline_Deferred(SPAN_LIT_TRANS); return; }
+		span_drawScanline(SPAN_LIT_TRANS, s_scanlineOut, s_scanlineWidth, s_ftexImage, s_ftexDataEnd, s_scanlineLight,
+			s_scanlineU0, s_scanlineV0, s_scanline_dUdX, s_scanline_dVdX, FRAC_BITS_20);
 	}
 
 	void drawScanline_Fullbright_Trans()
 	{
-		const fixed44_20 dVdX = s_scanline_dVdX;
-		const fixed44_20 dUdX = s_scanline_dUdX;
-		fixed44_20 V = s_scanlineV0;
-		fixed44_20 U = s_scanlineU0;
-
-		// Note this produces a distorted mapping if the texture is not 64x64.
-		// This behavior matches the original.
-		for (s32 i = s_scanlineWidth - 1; i >= 0; i--, U += dUdX, V += dVdX)
-		{
-			const u32 texel = ((floor20(U) & 63) * 64 + (floor20(V) & 63)) & s_ftexDataEnd;
-			const u8 baseColor = s_ftexImage[texel];
-
-			if (baseColor) { s_scanlineOut[i] = baseColor; }
-		}
+		if (s_rasterDeferred) { drawScanline_Deferred(SPAN_FULLBRIGHT_TRANS); return; }
+		span_drawScanline(SPAN_FULLBRIGHT_TRANS, s_scanlineOut, s_scanlineWidth, s_ftexImage, s_ftexDataEnd, s_scanlineLight,
+			s_scanlineU0, s_scanlineV0, s_scanline_dUdX, s_scanline_dVdX, FRAC_BITS_20);
 	}
 			   
 	bool flat_setTexture(TextureData* tex)
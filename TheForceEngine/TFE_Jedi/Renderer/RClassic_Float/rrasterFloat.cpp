@@ -0,0 +1,419 @@
+#include <cstring>
+#include <vector>
+
+#include <TFE_System/system.h>
+#include <TFE_System/profiler.h>
+#include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/signal.h>
+#include <TFE_Settings/settings.h>
+#include <TFE_Jedi/Math/core_math.h>
+#include "rrasterFloat.h"
+#include "../rcommon.h"
+
+namespace TFE_Jedi
+{
+
+namespace RClassic_Float
+{
+	enum RasterCmdType
+	{
+		RCMD_COLUMN = 0,
+		RCMD_SCANLINE,
+	};
+
+	enum
+	{
+		RASTER_TEMP_SIZE = 1024 * 1024,	// Transient texture data (decompressed sprite columns).
+	};
+
+	struct RasterCommand
+	{
+		u8* out;
+		const u8* tex;
+		const u8* light;
+		// Column: vCoord, vStep; Scanline: V0, dVdX.
+		fixed44_20 v;
+		fixed44_20 dv;
+		// Scanline only: U0, dUdX.
+		fixed44_20 u;
+		fixed44_20 du;
+		s32 x0;
+		s32 count;	// column: pixel count, scanline: width.
+		s32 mask;	// column: texture height mask, scanline: texture data end.
+		u16 type;
+		u16 func;
+	};
+
+	struct RasterStrip
+	{
+		s32 x0;
+		s32 x1;
+		std::vector<RasterCommand> commands;
+	};
+
+	struct RasterWorker
+	{
+		Thread* thread;
+		Signal* start;
+		s32 stripIndex;
+	};
+
+	JBool s_rasterDeferred = JFALSE;
+
+	static s32 s_threadCount = 1;
+	static s32 s_stripWidth = 0;
+	static s32 s_stripCount = 0;
+	static s32 s_pendingCount = 0;
+	static JBool s_rasterDirect = JFALSE;
+	static RasterStrip s_strips[RASTER_MAX_THREADS];
+	static std::vector<s32> s_stripIndex;	// x -> strip.
+	static std::vector<u8>  s_tempData;
+	static s32 s_tempUsed = 0;
+
+	// Frame pipelining.
+	static JBool s_pipelined = JFALSE;
+	static JBool s_jobPending = JFALSE;
+	static JBool s_prevFrameValid = JFALSE;
+	static std::vector<u8> s_worldBuffer;
+	static u8* s_frameDisplay = nullptr;
+
+	static RasterWorker s_workers[RASTER_MAX_THREADS];
+	static s32 s_workerCount = 0;
+	static Signal* s_doneSignal = nullptr;
+	static atomic_s32  s_stripsRemaining;
+	static atomic_bool s_workersRunning;
+
+	TFE_THREADRET rasterWorkerFunc(void* userData);
+	void raster_executeStrip(RasterStrip* strip);
+	void raster_destroyWorkers();
+	void raster_createWorkers(s32 count);
+	void raster_setupStrips(s32 count);
+	void raster_startWorkers();
+	void raster_finish();
+
+	/////////////////////////////////////////////
+	// API
+	/////////////////////////////////////////////
+	u8* raster_beginFrame(u8* display)
+	{
+		// The previous frame has to be completed before the commands and buffers can be reused.
+		raster_wait();
+
+		const TFE_Settings_Graphics* graphics = TFE_Settings::getGraphicsSettings();
+		const s32 threadCount = clamp(graphics->renderThreadCount, 1, (s32)RASTER_MAX_THREADS);
+		const JBool pipelined = graphics->pipelineFrames ? JTRUE : JFALSE;
+		if (threadCount != s_threadCount || pipelined != s_pipelined || s_stripWidth != s_width)
+		{
+			raster_flush();
+			raster_destroyWorkers();
+			s_threadCount = threadCount;
+			s_pipelined = pipelined;
+			s_stripCount = 0;
+			s_prevFrameValid = JFALSE;
+			if (s_threadCount > 1 || s_pipelined)
+			{
+				// When pipelined, every strip is handled by a worker so the main thread can move on to the next frame.
+				raster_createWorkers(s_pipelined ? s_threadCount : s_threadCount - 1);
+			}
+			s_stripWidth = s_width;
+		}
+		s_rasterDirect = JFALSE;
+		s_rasterDeferred = s_workerCount ? JTRUE : JFALSE;
+
+		if (!s_pipelined)
+		{
+			return display;
+		}
+
+		const size_t size = size_t(s_width) * size_t(s_height);
+		if (s_worldBuffer.size() != size)
+		{
+			s_worldBuffer.resize(size);
+			s_prevFrameValid = JFALSE;
+		}
+		// Present the previous frame, which was rasterized while the simulation was running.
+		if (s_prevFrameValid)
+		{
+			memcpy(display, s_worldBuffer.data(), size);
+		}
+		s_frameDisplay = display;
+		return s_worldBuffer.data();
+	}
+
+	void raster_endFrame()
+	{
+		if (s_pipelined && s_prevFrameValid && s_pendingCount && s_workerCount == s_stripCount)
+		{
+			// The frame is completed in the background, see raster_wait().
+			raster_startWorkers();
+			s_jobPending = JTRUE;
+		}
+		else
+		{
+			raster_flush();
+			if (s_pipelined)
+			{
+				// Nothing to present yet, so complete this frame right away.
+				memcpy(s_frameDisplay, s_worldBuffer.data(), s_worldBuffer.size());
+				s_prevFrameValid = JTRUE;
+			}
+		}
+		s_rasterDeferred = JFALSE;
+	}
+
+	void raster_wait()
+	{
+		if (!s_jobPending) { return; }
+		TFE_ZONE("Raster Wait");
+
+		s_doneSignal->wait();
+		s_jobPending = JFALSE;
+		raster_finish();
+	}
+
+	void raster_reset()
+	{
+		raster_wait();
+		s_prevFrameValid = JFALSE;
+	}
+
+	void raster_destroy()
+	{
+		raster_flush();
+		raster_destroyWorkers();
+		s_rasterDeferred = JFALSE;
+		s_threadCount = 1;
+		s_stripCount = 0;
+		s_stripWidth = 0;
+		s_pipelined = JFALSE;
+		s_prevFrameValid = JFALSE;
+		s_worldBuffer.clear();
+	}
+
+	void raster_flush()
+	{
+		raster_wait();
+		if (!s_pendingCount) { return; }
+		TFE_ZONE("Raster Flush");
+
+		// Strips not owned by a worker are rasterized on the calling thread.
+		raster_startWorkers();
+		for (s32 i = 0; i < s_stripCount - s_workerCount; i++)
+		{
+			raster_executeStrip(&s_strips[i]);
+		}
+		if (s_workerCount)
+		{
+			s_doneSignal->wait();
+		}
+		raster_finish();
+	}
+
+	void raster_beginDirect()
+	{
+		if (!s_rasterDeferred) { return; }
+		raster_flush();
+		s_rasterDeferred = JFALSE;
+		s_rasterDirect = JTRUE;
+	}
+
+	void raster_endDirect()
+	{
+		if (!s_rasterDirect) { return; }
+		s_rasterDeferred = JTRUE;
+		s_rasterDirect = JFALSE;
+	}
+
+	void raster_addColumn(SpanFunc func, u8* out, const u8* tex, s32 texSize, const u8* light, fixed44_20 vCoord, fixed44_20 vStep, s32 count, s32 heightMask)
+	{
+		if (count <= 0) { return; }
+		if (texSize > 0)
+		{
+			if (s_tempUsed + texSize > RASTER_TEMP_SIZE)
+			{
+				raster_flush();
+			}
+			u8* texCopy = &s_tempData[s_tempUsed];
+			memcpy(texCopy, tex, texSize);
+			s_tempUsed += texSize;
+			tex = texCopy;
+		}
+
+		const s32 x = s32(size_t(out - s_display) % size_t(s_width));
+		RasterStrip* strip = &s_strips[s_stripIndex[x]];
+		strip->commands.push_back({ out, tex, light, vCoord, vStep, 0, 0, x, count, heightMask, RCMD_COLUMN, u16(func) });
+		s_pendingCount++;
+	}
+
+	void raster_addScanline(SpanFunc func, u8* out, s32 x0, s32 width, const u8* tex, s32 dataEnd, const u8* light, fixed44_20 u0, fixed44_20 v0, fixed44_20 dUdX, fixed44_20 dVdX)
+	{
+		if (width <= 0) { return; }
+
+		// Scanlines are added to every strip that they overlap, each strip only draws its own part.
+		const s32 s0 = s_stripIndex[x0];
+		const s32 s1 = s_stripIndex[x0 + width - 1];
+		for (s32 s = s0; s <= s1; s++)
+		{
+			s_strips[s].commands.push_back({ out, tex, light, v0, dVdX, u0, dUdX, x0, width, dataEnd, RCMD_SCANLINE, u16(func) });
+		}
+		s_pendingCount++;
+	}
+
+	/////////////////////////////////////////////
+	// Internal
+	/////////////////////////////////////////////
+	void raster_setupStrips(s32 count)
+	{
+		s_stripCount = min(count, s_width);
+		s_stripIndex.resize(s_width);
+		for (s32 i = 0; i < s_stripCount; i++)
+		{
+			RasterStrip* strip = &s_strips[i];
+			strip->x0 = i * s_width / s_stripCount;
+			strip->x1 = (i + 1) * s_width / s_stripCount - 1;
+			strip->commands.clear();
+			for (s32 x = strip->x0; x <= strip->x1; x++)
+			{
+				s_stripIndex[x] = i;
+			}
+		}
+		s_tempData.resize(RASTER_TEMP_SIZE);
+		s_tempUsed = 0;
+		s_pendingCount = 0;
+	}
+
+	void raster_createWorkers(s32 count)
+	{
+		count = min(count, s_width);
+		if (count <= 0) { return; }
+
+		if (!s_doneSignal)
+		{
+			s_doneSignal = Signal::create();
+		}
+		s_workersRunning.store(true);
+		for (s32 i = 0; i < count; i++)
+		{
+			RasterWorker* worker = &s_workers[i];
+			worker->start = Signal::create();
+			worker->thread = Thread::create("RasterThread", rasterWorkerFunc, worker);
+			if (!worker->start || !worker->thread || !worker->thread->run())
+			{
+				TFE_System::logWrite(LOG_ERROR, "Raster", "Cannot create raster thread %d.", i);
+				delete worker->thread;
+				delete worker->start;
+				worker->thread = nullptr;
+				worker->start = nullptr;
+				break;
+			}
+			s_workerCount++;
+		}
+
+		// Workers own the last strips, any remaining strip is rasterized by the calling thread.
+		raster_setupStrips((s_pipelined && s_workerCount) ? s_workerCount : s_workerCount + 1);
+		for (s32 i = 0; i < s_workerCount; i++)
+		{
+			s_workers[i].stripIndex = s_stripCount - s_workerCount + i;
+		}
+		TFE_System::logWrite(LOG_MSG, "Raster", "Software rasterization using %d strips, %d worker threads.", s_stripCount, s_workerCount);
+	}
+
+	void raster_destroyWorkers()
+	{
+		if (!s_workerCount) { return; }
+
+		s_workersRunning.store(false);
+		for (s32 i = 0; i < s_workerCount; i++)
+		{
+			s_workers[i].start->fire();
+		}
+		for (s32 i = 0; i < s_workerCount; i++)
+		{
+			RasterWorker* worker = &s_workers[i];
+			worker->thread->waitOnExit();
+			delete worker->thread;
+			delete worker->start;
+			worker->thread = nullptr;
+			worker->start = nullptr;
+		}
+		s_workerCount = 0;
+	}
+
+	void raster_startWorkers()
+	{
+		s_stripsRemaining.store(s_workerCount);
+		for (s32 i = 0; i < s_workerCount; i++)
+		{
+			s_workers[i].start->fire();
+		}
+	}
+
+	void raster_finish()
+	{
+		for (s32 i = 0; i < s_stripCount; i++)
+		{
+			s_strips[i].commands.clear();
+		}
+		s_pendingCount = 0;
+		s_tempUsed = 0;
+	}
+
+	TFE_THREADRET rasterWorkerFunc(void* userData)
+	{
+		RasterWorker* worker = (RasterWorker*)userData;
+		TFE_Profiler::setThreadName("RasterThread");
+		while (1)
+		{
+			worker->start->wait();
+			if (!s_workersRunning.load()) { break; }
+
+			TFE_ZONE_BEGIN(rasterStrip, "Raster Strip");
+			raster_executeStrip(&s_strips[worker->stripIndex]);
+			TFE_ZONE_END(rasterStrip);
+			if (s_stripsRemaining.fetch_sub(1) == 1)
+			{
+				s_doneSignal->fire();
+			}
+		}
+		return (TFE_THREADRET)0;
+	}
+
+	void raster_executeColumn(const RasterCommand* cmd)
+	{
+		span_drawColumn(SpanFunc(cmd->func), cmd->out, s_width, cmd->count, cmd->tex, cmd->light, cmd->v, cmd->dv, u32(cmd->mask), FRAC_BITS_20);
+	}
+
+	// Only the part of the scanline inside of the strip is drawn, since U and V are stepped
+	// using integer math the start values can be computed exactly.
+	void raster_executeScanline(const RasterCommand* cmd, s32 stripX0, s32 stripX1)
+	{
+		const s32 width = cmd->count;
+		const s32 iMin = max(0, stripX0 - cmd->x0);
+		const s32 iMax = min(width - 1, stripX1 - cmd->x0);
+		if (iMin > iMax) { return; }
+
+		const fixed44_20 skip = fixed44_20(width - 1 - iMax);
+		const fixed44_20 U = cmd->u + skip * cmd->du;
+		const fixed44_20 V = cmd->v + skip * cmd->dv;
+		span_drawScanline(SpanFunc(cmd->func), cmd->out + iMin, iMax - iMin + 1, cmd->tex, u32(cmd->mask), cmd->light, U, V, cmd->du, cmd->dv, FRAC_BITS_20);
+	}
+
+	void raster_executeStrip(RasterStrip* strip)
+	{
+		const s32 count = (s32)strip->commands.size();
+		const RasterCommand* cmd = strip->commands.data();
+		for (s32 i = 0; i < count; i++, cmd++)
+		{
+			if (cmd->type == RCMD_COLUMN)
+			{
+				raster_executeColumn(cmd);
+			}
+			else
+			{
+				raster_executeScanline(cmd, strip->x0, strip->x1);
+			}
+		}
+	}
+}  // RClassic_Float
+
+}  // TFE_Jedi
@@ -0,0 +1,62 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Raster
+// Added for TFE: Optional multithreaded rasterization for the
+// floating point sub-renderer.
+//
+// Sector traversal still happens on the main thread, but when more
+// than one render thread is selected, the column and scanline draws
+// are recorded instead of executed. The framebuffer is split into
+// vertical strips and each strip replays the commands that touch it,
+// in submission order, on its own thread. Since every command writes
+// the exact same pixels it would have written directly, the output is
+// identical to the single-threaded path.
+//
+// When frame pipelining is enabled, the world is drawn into a separate
+// buffer and the recorded commands are rasterized in the background
+// while the game simulation runs. The result is presented at the start
+// of the next frame, which adds one frame of latency. The commands only
+// reference texture and colormap data, so the simulation is free to
+// modify the level while they are being rasterized.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+#include "fixedPoint20.h"
+#include "../rspan.h"
+
+namespace TFE_Jedi
+{
+	namespace RClassic_Float
+	{
+		enum RasterConstants
+		{
+			RASTER_MAX_THREADS = 16,
+		};
+
+		// JTRUE when draws should be recorded rather than executed directly.
+		extern JBool s_rasterDeferred;
+
+		// Called at the start of the frame, picks up the thread count and pipelining from the settings.
+		// Returns the buffer that the world should be drawn into, when pipelining this is not 'display' and the
+		// previous frame is copied into 'display' instead.
+		u8* raster_beginFrame(u8* display);
+		// Executes all pending commands, when pipelining this is done in the background.
+		void raster_endFrame();
+		// Wait for the frame being rasterized in the background, if any.
+		void raster_wait();
+		// Wait for any pending work and discard the previous frame (level change, renderer change, etc.).
+		void raster_reset();
+		void raster_destroy();
+
+		// Execute any pending commands, after this returns it is safe to read or write the framebuffer.
+		void raster_flush();
+		// Some draws (3D objects) write to the framebuffer directly, pending commands are flushed first.
+		void raster_beginDirect();
+		void raster_endDirect();
+
+		// Record a column, see drawColumn_*() in rwallFloat.cpp.
+		// If 'texSize' is non-zero, the texture data is transient and 'texSize' bytes are copied.
+		void raster_addColumn(SpanFunc func, u8* out, const u8* tex, s32 texSize, const u8* light, fixed44_20 vCoord, fixed44_20 vStep, s32 count, s32 heightMask);
+		// Record a scanline, see drawScanline*() in rflatFloat.cpp.
+		void raster_addScanline(SpanFunc func, u8* out, s32 x0, s32 width, const u8* tex, s32 dataEnd, const u8* light, fixed44_20 u0, fixed44_20 v0, fixed44_20 dUdX, fixed44_20 dVdX);
+	}
+}
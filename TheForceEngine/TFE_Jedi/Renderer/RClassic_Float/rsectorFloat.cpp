@@ -16,6 +16,7 @@
 #include "rflatFloat.h"
 #include "rlightingFloat.h"
 #include "redgePairFloat.h"
+#include "rrasterFloat.h"
 #include "rclassicFloatSharedState.h"
 #include "robj3d_float/robj3dFloat.h"
 #include "../rcommon.h"
@@ -545,7 +546,10 @@ namespace TFE_Jedi
 				{
 					TFE_ZONE("Draw 3DO");
 
+					// 3D objects write to the framebuffer directly, so pending raster commands must be completed first.
+					raster_beginDirect();
 					robj3d_draw(obj, obj->model);
+					raster_endDirect();
 				}
 				else if (type == OBJ_TYPE_FRAME)
 				{
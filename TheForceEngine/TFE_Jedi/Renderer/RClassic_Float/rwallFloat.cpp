@@ -11,8 +11,10 @@
 #include "rlightingFloat.h"
 #include "rsectorFloat.h"
 #include "redgePairFloat.h"
+#include "rrasterFloat.h"
 #include "rclassicFloatSharedState.h"
 #include "../rcommon.h"
+#include "../rspan.h"
 #include "../jediRenderer.h"
 
 namespace TFE_Jedi
@@ -2134,62 +2136,42 @@ namespace RClassic_Float
 		return z;
 	}
 
-	void drawColumn_Fullbright()
+	// Record the column for the raster threads instead of drawing it directly.
+	void drawColumn_Deferred(SpanFunc func)
 	{
-		fixed44_20 vCoordFixed = s_vCoordFixed;
-		const u8* tex = s_texImage;
-		const s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width, vCoordFixed += s_vCoordStep)
+		s32 texSize = 0;
+		if (s_texImage == s_workBuffer)
 		{
-			const s32 v = floor20(vCoordFixed) & s_texHeightMask;
-			s_columnOut[offset] = tex[v];
+			// The work buffer is overwritten by the next column, so only copy the part that can be sampled.
+			const s32 v0 = floor20(s_vCoordFixed);
+			const s32 v1 = floor20(s_vCoordFixed + s_vCoordStep * fixed44_20(s_yPixelCount - 1));
+			texSize = (v0 < 0 || v1 < 0) ? 1024 : min(max(v0, v1) + 1, 1024);
 		}
+		raster_addColumn(func, s_columnOut, s_texImage, texSize, s_columnLight, s_vCoordFixed, s_vCoordStep, s_yPixelCount, s_texHeightMask);
 	}
 
-	void drawColumn_Lit()
+	void drawColumn_Fullbright()
 	{
-		fixed44_20 vCoordFixed = s_vCoordFixed;
-		const u8* tex = s_texImage;
-		const s32 end = s_yPixelCount - 1;
+		if (s_rasterDeferred) { drawColumn_Deferred(SPAN_FULLBRIGHT); return; }
+		span_drawColumn(SPAN_FULLBRIGHT, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_20);
+	}
 
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width, vCoordFixed += s_vCoordStep)
-		{
-			const s32 v = floor20(vCoordFixed) & s_texHeightMask;
-			s_columnOut[offset] = s_columnLight[tex[v]];
-		}
+	void drawColumn_Lit()
+	{
+		if (s_rasterDeferred) { drawColumn_Deferred(SPAN_LIT); return; }
+		span_drawColumn(SPAN_LIT, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_20);
 	}
 
 	void drawColumn_Fullbright_Trans()
 	{
-		fixed44_20 vCoordFixed = s_vCoordFixed;
-		const u8* tex = s_texImage;
-		const s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width, vCoordFixed += s_vCoordStep)
-		{
-			const s32 v = floor20(vCoordFixed) & s_texHeightMask;
-			const u8 c = tex[v];
-			if (c) { s_columnOut[offset] = c; }
-		}
+		if (s_rasterDeferred) { drawColumn_Deferred(SPAN_FULLBRIGHT_TRANS); return; }
+		span_drawColumn(SPAN_FULLBRIGHT_TRANS, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_20);
 	}
 
 	void drawColumn_Lit_Trans()
 	{
-		fixed44_20 vCoordFixed = s_vCoordFixed;
-		const u8* tex = s_texImage;
-		const s32 end = s_yPixelCount - 1;
-
-		s32 offset = end * s_width;
-		for (s32 i = end; i >= 0; i--, offset -= s_width, vCoordFixed += s_vCoordStep)
-		{
-			const s32 v = floor20(vCoordFixed) & s_texHeightMask;
-			const u8 c = tex[v];
-			if (c) { s_columnOut[offset] = s_columnLight[c]; }
-		}
+		if (s_rasterDeferred) { drawColumn_Deferred(SPAN_LIT_TRANS); return; }
+		span_drawColumn(SPAN_LIT_TRANS, s_columnOut, s_width, s_yPixelCount, s_texImage, s_columnLight, s_vCoordFixed, s_vCoordStep, s_texHeightMask, FRAC_BITS_20);
 	}
 
 	void wall_addAdjoinSegment(s32 length, s32 x0, f32 top_dydx, f32 y1, f32 bot_dydx, f32 y0, RWallSegmentFloat* wallSegment)
@@ -30,8 +30,8 @@ namespace TFE_Jedi
 	const f32 c_superSidePlaneNormalScale = 0.98f;
 	const f32 c_superNearPlaneOffsetScale = 0.1f;
 
-	static Frustum s_frustumStack[FRUSTUM_STACK_SIZE];
-	static u32 s_frustumStackPtr = 0;
+	static FrustumStack s_mainFrustumStack;
+	static thread_local FrustumStack* s_frustumStack = &s_mainFrustumStack;
 
 	extern Mat3  s_cameraMtx;
 	extern Mat4  s_cameraProj;
@@ -42,7 +42,26 @@ namespace TFE_Jedi
 
 	void frustum_clearStack()
 	{
-		s_frustumStackPtr = 0;
+		s_frustumStack->count = 0;
+	}
+
+	void frustum_setThreadStack(FrustumStack* stack)
+	{
+		s_frustumStack = stack ? stack : &s_mainFrustumStack;
+	}
+
+	FrustumStack* frustum_getThreadStack()
+	{
+		return s_frustumStack;
+	}
+
+	void frustum_copyStack(const FrustumStack* src)
+	{
+		s_frustumStack->count = src->count;
+		for (u32 i = 0; i < src->count; i++)
+		{
+			frustum_copy(&src->frustum[i], &s_frustumStack->frustum[i]);
+		}
 	}
 
 	void frustum_copy(const Frustum* src, Frustum* dst)
@@ -56,33 +75,33 @@ namespace TFE_Jedi
 
 	void frustum_push(Frustum& frustum)
 	{
-		if (s_frustumStackPtr >= FRUSTUM_STACK_SIZE)
+		if (s_frustumStack->count >= FRUSTUM_STACK_SIZE)
 		{
 			TFE_System::logWrite(LOG_ERROR, "GPU Renderer", "Frustum stack is too deep.");
 			assert(0);
 			return;
 		}
 
-		frustum_copy(&frustum, &s_frustumStack[s_frustumStackPtr]);
-		s_frustumStackPtr++;
+		frustum_copy(&frustum, &s_frustumStack->frustum[s_frustumStack->count]);
+		s_frustumStack->count++;
 	}
 
 	Frustum* frustum_pop()
 	{
-		if (s_frustumStackPtr < 1) { assert(0); return nullptr; }
-		s_frustumStackPtr--;
-		return &s_frustumStack[s_frustumStackPtr];
+		if (s_frustumStack->count < 1) { assert(0); return nullptr; }
+		s_frustumStack->count--;
+		return &s_frustumStack->frustum[s_frustumStack->count];
 	}
 
 	Frustum* frustum_getBack()
 	{
-		if (s_frustumStackPtr < 1) { assert(0); return nullptr; }
-		return &s_frustumStack[s_frustumStackPtr - 1];
+		if (s_frustumStack->count < 1) { assert(0); return nullptr; }
+		return &s_frustumStack->frustum[s_frustumStack->count - 1];
 	}
 
 	Frustum* frustum_getFront()
 	{
-		return &s_frustumStack[0];
+		return &s_frustumStack->frustum[0];
 	}
 
 	bool frustum_sphereInside(Vec3f pos, f32 radius)
@@ -27,7 +27,18 @@ namespace TFE_Jedi
 		Vec3f vtx[FRUSTUM_PLANE_MAX];
 	};
 
+	struct FrustumStack
+	{
+		Frustum frustum[FRUSTUM_STACK_SIZE];
+		u32 count;
+	};
+
 	void frustum_copy(const Frustum* src, Frustum* dst);
+	// Each thread uses the main frustum stack unless it sets its own (used by the traversal threads).
+	void frustum_setThreadStack(FrustumStack* stack);
+	FrustumStack* frustum_getThreadStack();
+	// Replace the frustum stack of the calling thread with a copy of 'src'.
+	void frustum_copyStack(const FrustumStack* src);
 	void frustum_clearStack();
 	void frustum_push(Frustum& frustum);
 
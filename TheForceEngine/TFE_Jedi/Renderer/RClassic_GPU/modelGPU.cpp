@@ -22,9 +22,11 @@
 #include "modelGPU.h"
 #include "frustum.h"
 #include "sectorDisplayList.h"
+#include "objectPortalPlanes.h"
 #include "../rcommon.h"
 
 #include <map>
+#include <vector>
 #include <algorithm>
 
 using namespace TFE_RenderBackend;
@@ -105,6 +107,13 @@ namespace TFE_Jedi
 	static s32 s_modelDrawListCount[MGPU_SHADER_COUNT];
 	static s32 s_modelCount;
 
+	// Models added by a traversal thread, see sdisplayList_beginChunk().
+	struct ModelDrawChunk
+	{
+		std::vector<ModelDraw> drawList[MGPU_SHADER_COUNT];
+	};
+	static thread_local ModelDrawChunk* s_chunk = nullptr;
+
 	extern Mat3  s_cameraMtx;
 	extern Mat4  s_cameraProj;
 	extern Vec3f s_cameraPos;
@@ -671,18 +680,33 @@ namespace TFE_Jedi
 		}
 
 		ModelGPU* modelGPU = &s_models[model->drawId];
-		ModelDraw* drawList = s_modelDrawList[modelGPU->shader];
-
-		s32* listCount = &s_modelDrawListCount[modelGPU->shader];
-		if ((*listCount) >= MGPU_MAX_3DO_PER_PASS)
+		ModelDraw* drawItem;
+		if (s_chunk)
 		{
-			// Too many objects in a single pass!
-			assert(0);
-			return;
+			std::vector<ModelDraw>& drawList = s_chunk->drawList[modelGPU->shader];
+			if (drawList.size() >= MGPU_MAX_3DO_PER_PASS)
+			{
+				assert(0);
+				return;
+			}
+			drawList.push_back({});
+			drawItem = &drawList.back();
 		}
+		else
+		{
+			ModelDraw* drawList = s_modelDrawList[modelGPU->shader];
 
-		ModelDraw* drawItem = &drawList[*listCount];
-		(*listCount)++;
+			s32* listCount = &s_modelDrawListCount[modelGPU->shader];
+			if ((*listCount) >= MGPU_MAX_3DO_PER_PASS)
+			{
+				// Too many objects in a single pass!
+				assert(0);
+				return;
+			}
+
+			drawItem = &drawList[*listCount];
+			(*listCount)++;
+		}
 
 		drawItem->modelId = model->drawId;
 		drawItem->posWS = posWS;
@@ -699,6 +723,41 @@ namespace TFE_Jedi
 		};
 	}
 
+	ModelDrawChunk* model_createChunk()
+	{
+		return new ModelDrawChunk();
+	}
+
+	void model_destroyChunk(ModelDrawChunk* chunk)
+	{
+		delete chunk;
+	}
+
+	void model_beginChunk(ModelDrawChunk* chunk)
+	{
+		s_chunk = chunk;
+		if (!chunk) { return; }
+
+		for (s32 i = 0; i < MGPU_SHADER_COUNT; i++)
+		{
+			chunk->drawList[i].clear();
+		}
+	}
+
+	void model_mergeChunk(ModelDrawChunk* chunk, u32 objectPlaneBase)
+	{
+		for (s32 s = 0; s < MGPU_SHADER_COUNT; s++)
+		{
+			const s32 count = min((s32)chunk->drawList[s].size(), MGPU_MAX_3DO_PER_PASS - s_modelDrawListCount[s]);
+			for (s32 i = 0; i < count; i++)
+			{
+				ModelDraw* drawItem = &s_modelDrawList[s][s_modelDrawListCount[s]++];
+				*drawItem = chunk->drawList[s][i];
+				drawItem->portalInfo = objectPortalPlanes_rebaseInfo(drawItem->portalInfo, objectPlaneBase);
+			}
+		}
+	}
+
 	void model_drawList()
 	{
 		// Bind the uber-vertex and index buffers. This holds geometry for *all* 3D models currently loaded.
@@ -11,6 +11,8 @@
 
 namespace TFE_Jedi
 {
+	struct ModelDrawChunk;
+
 	bool model_init();
 	void model_destroy();
 	// This needs to be called *after* texture packing is complete so that textureIds are already set.
@@ -20,5 +22,12 @@ namespace TFE_Jedi
 	void model_drawListFinish();
 
 	void model_add(JediModel* model, Vec3f posWS, fixed16_16* transform, f32 ambient, Vec2f floorOffset, u32 portalInfo);
+
+	// Traversal threads add their models to a separate chunk, see sdisplayList_beginChunk().
+	ModelDrawChunk* model_createChunk();
+	void model_destroyChunk(ModelDrawChunk* chunk);
+	void model_beginChunk(ModelDrawChunk* chunk);
+	// 'objectPlaneBase' is the value returned by objectPortalPlanes_mergeChunk() for the same traversal job.
+	void model_mergeChunk(ModelDrawChunk* chunk, u32 objectPlaneBase);
 	void model_drawList();
 }  // TFE_Jedi
@@ -1,4 +1,5 @@
 #include <cstring>
+#include <vector>
 
 #include <TFE_System/profiler.h>
 #include <TFE_System/math.h>
@@ -31,6 +32,13 @@ namespace TFE_Jedi
 	static u32* s_objectPlaneInfo = nullptr;
 	static Vec4f* s_objectPlanes = nullptr;
 	static ShaderBuffer s_objectPlanesGPU;
+
+	// Planes added by a traversal thread, offsets are local to the chunk until it is merged.
+	struct ObjectPortalPlanesChunk
+	{
+		std::vector<Vec4f> planes;
+	};
+	static thread_local ObjectPortalPlanesChunk* s_chunk = nullptr;
 		
 	void objectPortalPlanes_init()
 	{
@@ -77,6 +85,14 @@ namespace TFE_Jedi
 
 	u32 objectPortalPlanes_add(u32 count, const Vec4f* planes)
 	{
+		if (s_chunk)
+		{
+			if (count < 1 || s_chunk->planes.size() >= MAX_BUFFER_SIZE) { return 0; }
+
+			const u32 planeInfo = PACK_PORTAL_INFO(s_chunk->planes.size(), count);
+			s_chunk->planes.insert(s_chunk->planes.end(), planes, planes + count);
+			return planeInfo;
+		}
 		if (count < 1 || s_objectPlaneCount >= MAX_BUFFER_SIZE) { return 0; }
 
 		const u32 planeInfo = PACK_PORTAL_INFO(s_objectPlaneCount, count);
@@ -84,4 +100,46 @@ namespace TFE_Jedi
 		s_objectPlaneCount += count;
 		return planeInfo;
 	}
+
+	ObjectPortalPlanesChunk* objectPortalPlanes_createChunk()
+	{
+		return new ObjectPortalPlanesChunk();
+	}
+
+	void objectPortalPlanes_destroyChunk(ObjectPortalPlanesChunk* chunk)
+	{
+		delete chunk;
+	}
+
+	void objectPortalPlanes_beginChunk(ObjectPortalPlanesChunk* chunk)
+	{
+		s_chunk = chunk;
+		if (chunk)
+		{
+			chunk->planes.clear();
+		}
+	}
+
+	u32 objectPortalPlanes_mergeChunk(ObjectPortalPlanesChunk* chunk)
+	{
+		const u32 base = s_objectPlaneCount;
+		const s32 count = min((s32)chunk->planes.size(), s32(MAX_BUFFER_SIZE) - s32(s_objectPlaneCount));
+		if (count > 0)
+		{
+			memcpy(&s_objectPlanes[s_objectPlaneCount], chunk->planes.data(), sizeof(Vec4f) * count);
+			s_objectPlaneCount += count;
+		}
+		return base;
+	}
+
+	u32 objectPortalPlanes_rebaseInfo(u32 planeInfo, u32 base)
+	{
+		if (!planeInfo) { return 0; }
+
+		const u32 offset = UNPACK_PORTAL_INFO_OFFSET(planeInfo) + base;
+		const u32 count  = UNPACK_PORTAL_INFO_COUNT(planeInfo);
+		// Planes that did not fit in the main list are dropped, which matches objectPortalPlanes_add().
+		if (offset + count > s_objectPlaneCount) { return 0; }
+		return PACK_PORTAL_INFO(offset, count);
+	}
 }  // TFE_Jedi
\ No newline at end of file
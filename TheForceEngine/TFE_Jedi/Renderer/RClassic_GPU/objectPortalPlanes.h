@@ -8,6 +8,8 @@
 
 namespace TFE_Jedi
 {
+	struct ObjectPortalPlanesChunk;
+
 	void objectPortalPlanes_init();
 	void objectPortalPlanes_destroy();
 
@@ -18,4 +20,13 @@ namespace TFE_Jedi
 	void objectPortalPlanes_unbind(s32 index);
 
 	u32  objectPortalPlanes_add(u32 count, const Vec4f* planes);
+
+	// Traversal threads add their planes to a separate chunk, see sdisplayList_beginChunk().
+	ObjectPortalPlanesChunk* objectPortalPlanes_createChunk();
+	void objectPortalPlanes_destroyChunk(ObjectPortalPlanesChunk* chunk);
+	void objectPortalPlanes_beginChunk(ObjectPortalPlanesChunk* chunk);
+	// Append the chunk planes to the main list, returns the offset that should be passed to objectPortalPlanes_rebaseInfo().
+	u32  objectPortalPlanes_mergeChunk(ObjectPortalPlanesChunk* chunk);
+	// Convert plane info returned by objectPortalPlanes_add() while building a chunk so it references the main list.
+	u32  objectPortalPlanes_rebaseInfo(u32 planeInfo, u32 base);
 }  // TFE_Jedi
@@ -1,7 +1,11 @@
 #include <cstring>
+#include <vector>
+#include <thread>
 
 #include <TFE_System/profiler.h>
 #include <TFE_System/math.h>
+#include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/signal.h>
 #include <TFE_Asset/modelAsset_jedi.h>
 #include <TFE_Game/igame.h>
 #include <TFE_Jedi/Level/level.h>
@@ -53,7 +57,10 @@ namespace TFE_Jedi
 	};
 	enum Constants
 	{
-		SPRITE_PASS = SECTOR_PASS_COUNT
+		SPRITE_PASS = SECTOR_PASS_COUNT,
+		TRAVERSAL_MAX_THREADS = 16,
+		TRAVERSAL_MAX_WALL_SEG = 2048,
+		TRAVERSAL_MAX_PATH = MAX_ADJOIN_DEPTH_EXT + 2,
 	};
 
 	struct GPUSourceData
@@ -71,6 +78,68 @@ namespace TFE_Jedi
 		Frustum  frustum;
 		RWall*   wall;
 	};
+	struct TraversalJob;
+	// A sector updated by a traversal job, the GPU buffer ranges are marked dirty when the results are merged.
+	struct SectorUpdate
+	{
+		RSector* sector;
+		u32 flags;
+	};
+
+	// Traversal state, each traversal thread has its own.
+	struct TraversalContext
+	{
+		Vec2f range[2];
+		Vec2f rangeSrc[2];
+		s32   rangeCount;
+
+		RSector* clipSector;
+		Vec3f    clipObjPos;
+
+		Segment wallSegments[TRAVERSAL_MAX_WALL_SEG];
+		std::vector<Portal> portalList;
+		s32 portalListCount;
+		// Portal walls on the path from the camera sector to the current sector, these are skipped to avoid loops.
+		RWall* path[TRAVERSAL_MAX_PATH];
+		s32 pathCount;
+
+		s32 portalsTraversed;
+		s32 wallSegGenerated;
+
+		// Only used by the traversal threads, the main thread uses the global frustum stack and s-buffer.
+		FrustumStack* frustumStack;
+		SBufferState* sbuffer;
+		// The job being processed, null when traversing on the main thread.
+		TraversalJob* job;
+	};
+
+	// A portal subtree processed by a traversal thread.
+	struct TraversalJob
+	{
+		Portal   portal;
+		RSector* sector;
+		s32 parentPortalId;
+		s32 level;
+
+		// Output.
+		SDisplayListChunk* sectorChunk;
+		SpriteDisplayListChunk* spriteChunk;
+		ObjectPortalPlanesChunk* planeChunk;
+		ModelDrawChunk* modelChunk;
+		std::vector<RSector*> renderedSectors;
+		std::vector<SectorUpdate> updatedSectors;
+		u32 uploadFlags;
+		s32 portalsTraversed;
+		s32 wallSegGenerated;
+	};
+
+	struct TraversalWorker
+	{
+		Thread* thread;
+		Signal* start;
+		TraversalContext* context;
+	};
+
 	struct ShaderInputs
 	{
 		s32 cameraPosId;
@@ -103,17 +172,30 @@ namespace TFE_Jedi
 	static bool s_enableDebug = false;
 
 	static s32 s_gpuFrame;
-	static s32 s_portalListCount = 0;
-	static s32 s_rangeCount;
-
-	static Portal* s_portalList = nullptr;
-	static Vec2f  s_range[2];
-	static Vec2f  s_rangeSrc[2];
 
 	static bool s_showWireframe = false;
 	static SkyMode s_skyMode = SKYMODE_CYLINDER;
-	static RSector* s_clipSector;
-	static Vec3f s_clipObjPos;
+
+	static TraversalContext s_mainContext;
+	static thread_local TraversalContext* s_ctx = &s_mainContext;
+
+	// Parallel traversal - once a sector with more than one visible portal is reached, each portal subtree
+	// becomes a job. Jobs write to their own display list chunks, which are merged in portal order.
+	static TraversalWorker s_traversalWorkers[TRAVERSAL_MAX_THREADS];
+	static s32 s_traversalWorkerCount = 0;
+	static TraversalContext* s_traversalHelperContext = nullptr;	// Used by the main thread while processing jobs.
+	static Signal* s_traversalDoneSignal = nullptr;
+	static atomic_bool s_traversalWorkersRunning;
+	static std::vector<TraversalJob*> s_traversalJobs;
+	static atomic_s32 s_traversalJobLimit;	// Jobs available to the threads.
+	static atomic_s32 s_traversalNextJob;
+	static atomic_s32 s_traversalJobsRemaining;
+	static const TraversalContext* s_traversalSplitContext = nullptr;	// State shared by all jobs in the current batch.
+	static FrustumStack* s_traversalSplitFrustum = nullptr;
+	// Per-sector update state for the current batch, so only one job updates a cached sector.
+	static std::vector<atomic_s32> s_traversalSectorState;
+	static s32 s_traversalBatch = 0;
+	static bool s_traversalSerialFallback = false;
 
 	static JBool s_flushCache = JFALSE;
 
@@ -123,7 +205,7 @@ namespace TFE_Jedi
 	extern Vec3f s_cameraDir;
 	extern Vec3f s_cameraDirXZ;
 	extern Vec3f s_cameraRight;
-	extern s32   s_displayCurrentPortalId;
+	extern thread_local s32 s_displayCurrentPortalId;
 	extern ShaderBuffer s_displayListPlanesGPU;
 		
 	bool loadSpriteShader()
@@ -190,9 +272,11 @@ namespace TFE_Jedi
 		return true;
 	}
 
+	void traversal_destroyWorkers();
+
 	void TFE_Sectors_GPU::destroy()
 	{
-		free(s_portalList);
+		traversal_destroyWorkers();
 		s_spriteShader.destroy();
 		s_wallShader[0].destroy();
 		s_wallShader[1].destroy();
@@ -201,7 +285,6 @@ namespace TFE_Jedi
 		s_wallGpuBuffer.destroy();
 		TFE_RenderBackend::freeTexture(s_colormapTex);
 		
-		s_portalList = nullptr;
 		s_cachedSectors = nullptr;
 		s_colormapTex = nullptr;
 
@@ -233,10 +316,6 @@ namespace TFE_Jedi
 			
 			m_gpuInit = true;
 			s_gpuFrame = 1;
-			if (!s_portalList)
-			{
-				s_portalList = (Portal*)malloc(sizeof(Portal) * MAX_DISP_ITEMS);
-			}
 
 			// Read the current graphics settings before compiling shaders.
 			TFE_Settings_Graphics* graphics = TFE_Settings::getGraphicsSettings();
@@ -287,6 +366,7 @@ namespace TFE_Jedi
 			// Let's just cache the current data.
 			s_cachedSectors = (GPUCachedSector*)level_alloc(sizeof(GPUCachedSector) * s_levelState.sectorCount);
 			memset(s_cachedSectors, 0, sizeof(GPUCachedSector) * s_levelState.sectorCount);
+			s_traversalSectorState = std::vector<atomic_s32>(s_levelState.sectorCount);
 
 			s_gpuSourceData.sectorSize = sizeof(Vec4f) * s_levelState.sectorCount * 2;
 			s_gpuSourceData.sectors = (Vec4f*)level_alloc(s_gpuSourceData.sectorSize);
@@ -385,8 +465,8 @@ namespace TFE_Jedi
 				}
 
 				const ShaderBufferDef bufferDefSectors = { 4, sizeof(f32), BUF_CHANNEL_FLOAT };
-				s_sectorGpuBuffer.create(s_levelState.sectorCount * 2, bufferDefSectors, true, s_gpuSourceData.sectors);
-				s_wallGpuBuffer.create(wallCount * 3, bufferDefSectors, true, s_gpuSourceData.walls);
+				s_sectorGpuBuffer.createPersistent(s_levelState.sectorCount * 2, bufferDefSectors, s_gpuSourceData.sectors);
+				s_wallGpuBuffer.createPersistent(wallCount * 3, bufferDefSectors, s_gpuSourceData.walls);
 
 				m_gpuBuffersAllocated = true;
 				m_prevSectorCount = s_levelState.sectorCount;
@@ -452,14 +532,23 @@ namespace TFE_Jedi
 		renderDebug_enable(s_enableDebug);
 	}
 	
-	void updateCachedWalls(RSector* srcSector, u32 flags, u32& uploadFlags)
+	void markCachedSectorDirty(const RSector* srcSector, u32 flags)
 	{
-		GPUCachedSector* cached = &s_cachedSectors[srcSector->index];
-		if (flags & (SDF_HEIGHTS | SDF_AMBIENT))
+		if (flags & (SDF_HEIGHTS | SDF_FLAT_OFFSETS | SDF_AMBIENT))
 		{
-			uploadFlags |= UPLOAD_WALLS;
+			s_sectorGpuBuffer.markDirty(srcSector->index * 2, 2);
 		}
 		if (flags & (SDF_VERTICES | SDF_WALL_CHANGE | SDF_WALL_OFFSETS | SDF_WALL_SHAPE))
+		{
+			s_wallGpuBuffer.markDirty(s_cachedSectors[srcSector->index].wallStart * 3, srcSector->wallCount * 3);
+		}
+	}
+
+	void updateCachedWalls(RSector* srcSector, u32 flags, u32& uploadFlags)
+	{
+		GPUCachedSector* cached = &s_cachedSectors[srcSector->index];
+		// Note the wall data does not depend on the sector heights or ambient.
+		if (flags & (SDF_VERTICES | SDF_WALL_CHANGE | SDF_WALL_OFFSETS | SDF_WALL_SHAPE))
 		{
 			uploadFlags |= UPLOAD_WALLS;
 			Vec4f* wallData = &s_gpuSourceData.walls[cached->wallStart*3];
@@ -527,6 +616,65 @@ namespace TFE_Jedi
 		}
 		updateCachedWalls(srcSector, flags, uploadFlags);
 		srcSector->dirtyFlags = SDF_NONE;
+
+		// The GPU buffers are not thread-safe, so jobs leave marking the ranges to the main thread.
+		if (s_ctx->job)
+		{
+			s_ctx->job->updatedSectors.push_back({ srcSector, flags });
+		}
+		else
+		{
+			markCachedSectorDirty(srcSector, flags);
+		}
+	}
+
+	// Traversal jobs can reach the same sector at the same time, so the first job to reach the sector updates it
+	// and any others wait until it is done.
+	void traversal_updateCachedSector(RSector* srcSector, u32& uploadFlags)
+	{
+		if (!s_ctx->job)
+		{
+			updateCachedSector(srcSector, uploadFlags);
+			return;
+		}
+
+		atomic_s32& state = s_traversalSectorState[srcSector->index];
+		const s32 busy = s_traversalBatch * 2 + 1;
+		const s32 done = busy + 1;
+		s32 cur = state.load();
+		if (cur == done) { return; }
+		if (cur != busy && state.compare_exchange_strong(cur, busy))
+		{
+			updateCachedSector(srcSector, uploadFlags);
+			state.store(done);
+			return;
+		}
+		while (state.load() != done)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	bool traversal_isOnPath(const RWall* wall)
+	{
+		for (s32 i = 0; i < s_ctx->pathCount; i++)
+		{
+			if (s_ctx->path[i] == wall) { return true; }
+		}
+		return false;
+	}
+
+	// Mark sector as being rendered for the automap.
+	// Traversal jobs can visit the same sector, so the flags are set when the job results are merged instead.
+	void traversal_markRendered(RSector* sector)
+	{
+		if (s_ctx->job)
+		{
+			s_ctx->job->renderedSectors.push_back(sector);
+			return;
+		}
+		sector->flags1 |= SEC_FLAGS1_RENDERED;
+		s_cachedSectors[sector->index].builtFrame = s_gpuFrame;
 	}
 
 	s32 traversal_addPortals(RSector* curSector)
@@ -555,8 +703,12 @@ namespace TFE_Jedi
 			Polygon clippedPortal;
 			if (frustum_clipQuadToFrustum(p0, p1, &clippedPortal, true/*ignoreNearPlane*/))
 			{
-				Portal* portalOut = &s_portalList[s_portalListCount];
-				s_portalListCount++;
+				if (s_ctx->portalListCount >= (s32)s_ctx->portalList.size())
+				{
+					s_ctx->portalList.resize(max(256, s32(s_ctx->portalList.size()) * 2));
+				}
+				Portal* portalOut = &s_ctx->portalList[s_ctx->portalListCount];
+				s_ctx->portalListCount++;
 
 				frustum_buildFromPolygon(&clippedPortal, &portalOut->frustum);
 				portalOut->v0 = portal->v0;
@@ -586,14 +738,14 @@ namespace TFE_Jedi
 
 		// Build the display list.
 		SegmentClipped* segment = sbuffer_get();
-		while (segment && s_wallSegGenerated < s_maxWallSeg)
+		while (segment && s_ctx->wallSegGenerated < s_maxWallSeg)
 		{
 			// DEBUG
 			debug_addQuad(segment->v0, segment->v1, segment->seg->y0, segment->seg->y1,
 				          segment->seg->portalY0, segment->seg->portalY1, segment->seg->portal);
 
 			sdisplayList_addSegment(curSector, &s_cachedSectors[curSector->index], segment, forceTreatAsSolid);
-			s_wallSegGenerated++;
+			s_ctx->wallSegGenerated++;
 			segment = segment->next;
 		}
 	}
@@ -677,13 +829,10 @@ namespace TFE_Jedi
 		return side0 <= 0.01f || side1 <= 0.01f;
 	}
 
-	static Segment s_wallSegments[2048];
-
 	void addPortalAsSky(RSector* curSector, RWall* wall)
 	{
 		u32 segCount = 0;
 		GPUCachedSector* cached = &s_cachedSectors[curSector->index];
-		cached->builtFrame = s_gpuFrame;
 
 		// Calculate the vertices.
 		const f32 x0 = fixed16ToFloat(wall->w0->x);
@@ -695,7 +844,7 @@ namespace TFE_Jedi
 		f32 portalY0 = y0, portalY1 = y1;
 
 		// Add a new segment.
-		Segment* seg = &s_wallSegments[segCount];
+		Segment* seg = &s_ctx->wallSegments[segCount];
 		const Vec3f wallNormal = { -(z1 - z0), 0.0f, x1 - x0 };
 		Vec2f v0 = { x0, z0 }, v1 = { x1, z1 }, heights = { y0, y1 }, portalHeights = { portalY0, portalY1 };
 		if (!createNewSegment(seg, wall->id, false, v0, v1, heights, portalHeights, wallNormal))
@@ -707,9 +856,9 @@ namespace TFE_Jedi
 		// Split segments that cross the modulo boundary.
 		if (seg->x1 > 4.0f)
 		{
-			splitSegment(false, s_wallSegments, segCount, seg, s_range, s_rangeSrc, s_rangeCount);
+			splitSegment(false, s_ctx->wallSegments, segCount, seg, s_ctx->range, s_ctx->rangeSrc, s_ctx->rangeCount);
 		}
-		else if (!sbuffer_splitByRange(seg, s_range, s_rangeSrc, s_rangeCount))
+		else if (!sbuffer_splitByRange(seg, s_ctx->range, s_ctx->rangeSrc, s_ctx->rangeCount))
 		{
 			// Out of the range, so cancel the segment.
 			segCount--;
@@ -719,7 +868,7 @@ namespace TFE_Jedi
 			assert(seg->x0 >= 0.0f && seg->x1 <= 4.0f);
 		}
 
-		buildSegmentBuffer(false, curSector, segCount, s_wallSegments, true/*forceTreatAsSolid*/);
+		buildSegmentBuffer(false, curSector, segCount, s_ctx->wallSegments, true/*forceTreatAsSolid*/);
 	}
 		
 	// Build world-space wall segments.
@@ -727,32 +876,31 @@ namespace TFE_Jedi
 	{
 		segCount = 0;
 		GPUCachedSector* cached = &s_cachedSectors[curSector->index];
-		cached->builtFrame = s_gpuFrame;
 
 		// Portal range, all segments must be clipped to this.
 		// The actual clip vertices are p0 and p1.
-		s_rangeSrc[0] = p0;
-		s_rangeSrc[1] = p1;
-		s_rangeCount = 0;
+		s_ctx->rangeSrc[0] = p0;
+		s_ctx->rangeSrc[1] = p1;
+		s_ctx->rangeCount = 0;
 		if (!initSector)
 		{
-			s_range[0].x = sbuffer_projectToUnitSquare(p0);
-			s_range[0].z = sbuffer_projectToUnitSquare(p1);
-			sbuffer_handleEdgeWrapping(s_range[0].x, s_range[0].z);
-			s_rangeCount = 1;
+			s_ctx->range[0].x = sbuffer_projectToUnitSquare(p0);
+			s_ctx->range[0].z = sbuffer_projectToUnitSquare(p1);
+			sbuffer_handleEdgeWrapping(s_ctx->range[0].x, s_ctx->range[0].z);
+			s_ctx->rangeCount = 1;
 
-			if (fabsf(s_range[0].x - s_range[0].z) < FLT_EPSILON)
+			if (fabsf(s_ctx->range[0].x - s_ctx->range[0].z) < FLT_EPSILON)
 			{
 				sbuffer_clear();
 				return false;
 			}
 
-			if (s_range[0].z > 4.0f)
+			if (s_ctx->range[0].z > 4.0f)
 			{
-				s_range[1].x = 0.0f;
-				s_range[1].z = s_range[0].z - 4.0f;
-				s_range[0].z = 4.0f;
-				s_rangeCount = 2;
+				s_ctx->range[1].x = 0.0f;
+				s_ctx->range[1].z = s_ctx->range[0].z - 4.0f;
+				s_ctx->range[0].z = 4.0f;
+				s_ctx->rangeCount = 2;
 			}
 		}
 			
@@ -764,7 +912,7 @@ namespace TFE_Jedi
 			RSector* next = wall->nextSector;
 
 			// Wall already processed.
-			if (wall->drawFrame == s_gpuFrame)
+			if (traversal_isOnPath(wall))
 			{
 				continue;
 			}
@@ -800,7 +948,7 @@ namespace TFE_Jedi
 
 				// Update any potential adjoins even if they are not traversed to make sure the
 				// heights and walls settings are handled correctly.
-				updateCachedSector(next, uploadFlags);
+				traversal_updateCachedSector(next, uploadFlags);
 
 				fixed16_16 openTop, openBot;
 				// Sky handling
@@ -852,7 +1000,7 @@ namespace TFE_Jedi
 			}
 
 			// Add a new segment.
-			Segment* seg = &s_wallSegments[segCount];
+			Segment* seg = &s_ctx->wallSegments[segCount];
 			Vec2f v0 = { x0, z0 }, v1 = { x1, z1 }, heights = { y0, y1 }, portalHeights = { portalY0, portalY1 };
 			if (!createNewSegment(seg, w, isPortal, v0, v1, heights, portalHeights, wallNormal))
 			{
@@ -863,9 +1011,9 @@ namespace TFE_Jedi
 			// Split segments that cross the modulo boundary.
 			if (seg->x1 > 4.0f)
 			{
-				splitSegment(initSector, s_wallSegments, segCount, seg, s_range, s_rangeSrc, s_rangeCount);
+				splitSegment(initSector, s_ctx->wallSegments, segCount, seg, s_ctx->range, s_ctx->rangeSrc, s_ctx->rangeCount);
 			}
-			else if (!initSector && !sbuffer_splitByRange(seg, s_range, s_rangeSrc, s_rangeCount))
+			else if (!initSector && !sbuffer_splitByRange(seg, s_ctx->range, s_ctx->rangeSrc, s_ctx->rangeCount))
 			{
 				// Out of the range, so cancel the segment.
 				segCount--;
@@ -876,7 +1024,7 @@ namespace TFE_Jedi
 			}
 		}
 
-		buildSegmentBuffer(initSector, curSector, segCount, s_wallSegments, false/*forceTreatAsSolid*/);
+		buildSegmentBuffer(initSector, curSector, segCount, s_ctx->wallSegments, false/*forceTreatAsSolid*/);
 		return true;
 	}
 		
@@ -885,8 +1033,8 @@ namespace TFE_Jedi
 	bool clipRule(s32 id)
 	{
 		// for now always return false for adjoins.
-		assert(id >= 0 && id < s_clipSector->wallCount);
-		RWall* wall = &s_clipSector->walls[id];
+		assert(id >= 0 && id < s_ctx->clipSector->wallCount);
+		RWall* wall = &s_ctx->clipSector->walls[id];
 		assert(wall->nextSector);	// we shouldn't get in here if nextSector is null.
 		if (!wall->nextSector)
 		{
@@ -895,7 +1043,7 @@ namespace TFE_Jedi
 		
 		// next verify that there is an opening, if not then treat it as a regular wall.
 		RSector* next = wall->nextSector;
-		fixed16_16 opening = min(s_clipSector->floorHeight, next->floorHeight) - max(s_clipSector->ceilingHeight, next->ceilingHeight);
+		fixed16_16 opening = min(s_ctx->clipSector->floorHeight, next->floorHeight) - max(s_ctx->clipSector->ceilingHeight, next->ceilingHeight);
 		if (opening <= 0)
 		{
 			return true;
@@ -903,12 +1051,12 @@ namespace TFE_Jedi
 
 		// if the camera is below the floor, treat it as a wall.
 		const f32 floorHeight = fixed16ToFloat(next->floorHeight);
-		if (s_cameraPos.y > floorHeight && s_clipObjPos.y <= floorHeight)
+		if (s_cameraPos.y > floorHeight && s_ctx->clipObjPos.y <= floorHeight)
 		{
 			return true;
 		}
 		const f32 ceilHeight = fixed16ToFloat(next->ceilingHeight);
-		if (s_cameraPos.y < ceilHeight && s_clipObjPos.y >= ceilHeight)
+		if (s_cameraPos.y < ceilHeight && s_ctx->clipObjPos.y >= ceilHeight)
 		{
 			return true;
 		}
@@ -919,8 +1067,8 @@ namespace TFE_Jedi
 	void clipSpriteToView(RSector* curSector, Vec3f posWS, WaxFrame* frame, void* basePtr, void* objPtr, bool fullbright, u32 portalInfo)
 	{
 		if (!frame) { return; }
-		s_clipSector = curSector;
-		s_clipObjPos = posWS;
+		s_ctx->clipSector = curSector;
+		s_ctx->clipObjPos = posWS;
 
 		// Compute the (x,z) extents of the frame.
 		const f32 widthWS  = fixed16ToFloat(frame->widthWS);
@@ -956,7 +1104,7 @@ namespace TFE_Jedi
 
 		// Clip against the current wall segments and the portal XZ extents.
 		SegmentClipped dstSegs[1024];
-		const s32 segCount = sbuffer_clipSegmentToBuffer(points[0], points[1], s_rangeCount, s_range, s_rangeSrc, 1024, dstSegs, clipRule);
+		const s32 segCount = sbuffer_clipSegmentToBuffer(points[0], points[1], s_ctx->rangeCount, s_ctx->range, s_ctx->rangeSrc, 1024, dstSegs, clipRule);
 		if (!segCount) { return; }
 
 		// Then add the segments to the list.
@@ -1076,6 +1224,40 @@ namespace TFE_Jedi
 		}
 	}
 		
+	void traverseSector(RSector* curSector, RSector* prevSector, RWall* portalWall, s32 prevPortalId, s32& level, u32& uploadFlags, Vec2f p0, Vec2f p1);
+	void traversal_runJobs(RSector* curSector, s32 parentPortalId, s32 portalStart, s32 portalCount, s32 level, u32& uploadFlags);
+
+	void traversePortal(Portal* portal, RSector* curSector, s32 parentPortalId, s32& level, u32& uploadFlags)
+	{
+		frustum_push(portal->frustum);
+		level++;
+		s_ctx->portalsTraversed++;
+
+		// Add a portal to the display list.
+		Vec3f corner0 = { portal->v0.x, portal->y0, portal->v0.z };
+		Vec3f corner1 = { portal->v1.x, portal->y1, portal->v1.z };
+		if (sdisplayList_addPortal(corner0, corner1, parentPortalId) && s_ctx->pathCount < TRAVERSAL_MAX_PATH)
+		{
+			// Copy the portal, the list may be resized during the traversal.
+			const Portal cur = *portal;
+			s_ctx->path[s_ctx->pathCount++] = cur.wall;
+			traverseSector(cur.next, curSector, cur.wall, parentPortalId, level, uploadFlags, cur.v0, cur.v1);
+			s_ctx->pathCount--;
+		}
+
+		frustum_pop();
+		level--;
+	}
+
+	// Split the traversal once there is more than one portal to process. Only one split happens per frame, since all of the
+	// sectors leading up to it have a single portal.
+	bool traversal_canSplit(s32 portalCount)
+	{
+		// The debug limits depend on the traversal order, so keep the serial path when they are in use.
+		// The debug drawing is not thread-safe either.
+		return portalCount > 1 && s_traversalWorkerCount > 0 && !s_ctx->job && !s_traversalSerialFallback && !s_enableDebug && s_maxPortals >= 4096 && s_maxWallSeg >= 4096;
+	}
+		
 	void traverseSector(RSector* curSector, RSector* prevSector, RWall* portalWall, s32 prevPortalId, s32& level, u32& uploadFlags, Vec2f p0, Vec2f p1)
 	{
 		if (level > MAX_ADJOIN_DEPTH_EXT)
@@ -1084,7 +1266,7 @@ namespace TFE_Jedi
 		}
 		
 		// Mark sector as being rendered for the automap.
-		curSector->flags1 |= SEC_FLAGS1_RENDERED;
+		traversal_markRendered(curSector);
 
 		// Build the world-space wall segments.
 		u32 segCount = 0;
@@ -1110,30 +1292,299 @@ namespace TFE_Jedi
 		// Traverse through visible portals.
 		s32 parentPortalId = s_displayCurrentPortalId;
 
-		const s32 portalStart = s_portalListCount;
+		const s32 portalStart = s_ctx->portalListCount;
 		const s32 portalCount = traversal_addPortals(curSector);
-		Portal* portal = &s_portalList[portalStart];
-		for (s32 p = 0; p < portalCount && s_portalsTraversed < s_maxPortals; p++, portal++)
+		if (traversal_canSplit(portalCount))
+		{
+			traversal_runJobs(curSector, parentPortalId, portalStart, portalCount, level, uploadFlags);
+		}
+		else
+		{
+			for (s32 p = 0; p < portalCount && s_ctx->portalsTraversed < s_maxPortals; p++)
+			{
+				traversePortal(&s_ctx->portalList[portalStart + p], curSector, parentPortalId, level, uploadFlags);
+			}
+		}
+		s_ctx->portalListCount = portalStart;
+	}
+
+	/////////////////////////////////////////////
+	// Parallel traversal
+	/////////////////////////////////////////////
+	TFE_THREADRET traversalWorkerFunc(void* userData);
+
+	TraversalContext* traversal_createContext()
+	{
+		TraversalContext* context = new TraversalContext();
+		context->frustumStack = new FrustumStack();
+		context->sbuffer = new SBufferState();
+		context->frustumStack->count = 0;
+		context->pathCount = 0;
+		context->portalListCount = 0;
+		context->job = nullptr;
+		return context;
+	}
+
+	void traversal_destroyContext(TraversalContext* context)
+	{
+		if (!context) { return; }
+		delete context->frustumStack;
+		delete context->sbuffer;
+		delete context;
+	}
+
+	void traversal_createWorkers(s32 count)
+	{
+		count = min(count, (s32)TRAVERSAL_MAX_THREADS);
+		if (count <= 0) { return; }
+
+		if (!s_traversalDoneSignal)
+		{
+			s_traversalDoneSignal = Signal::create();
+		}
+		if (!s_traversalHelperContext)
+		{
+			s_traversalHelperContext = traversal_createContext();
+		}
+		s_traversalWorkersRunning.store(true);
+		for (s32 i = 0; i < count; i++)
+		{
+			TraversalWorker* worker = &s_traversalWorkers[i];
+			worker->context = traversal_createContext();
+			worker->start = Signal::create();
+			worker->thread = Thread::create("TraversalThread", traversalWorkerFunc, worker);
+			if (!worker->start || !worker->thread || !worker->thread->run())
+			{
+				TFE_System::logWrite(LOG_ERROR, "GPU Renderer", "Cannot create traversal thread %d.", i);
+				delete worker->thread;
+				delete worker->start;
+				traversal_destroyContext(worker->context);
+				worker->thread = nullptr;
+				worker->start = nullptr;
+				worker->context = nullptr;
+				break;
+			}
+			s_traversalWorkerCount++;
+		}
+		TFE_System::logWrite(LOG_MSG, "GPU Renderer", "Sector traversal using %d worker threads.", s_traversalWorkerCount);
+	}
+
+	void traversal_destroyWorkers()
+	{
+		if (s_traversalWorkerCount)
+		{
+			s_traversalWorkersRunning.store(false);
+			for (s32 i = 0; i < s_traversalWorkerCount; i++)
+			{
+				s_traversalWorkers[i].start->fire();
+			}
+			for (s32 i = 0; i < s_traversalWorkerCount; i++)
+			{
+				TraversalWorker* worker = &s_traversalWorkers[i];
+				worker->thread->waitOnExit();
+				delete worker->thread;
+				delete worker->start;
+				traversal_destroyContext(worker->context);
+				worker->thread = nullptr;
+				worker->start = nullptr;
+				worker->context = nullptr;
+			}
+			s_traversalWorkerCount = 0;
+		}
+
+		const s32 jobCount = (s32)s_traversalJobs.size();
+		for (s32 i = 0; i < jobCount; i++)
+		{
+			TraversalJob* job = s_traversalJobs[i];
+			sdisplayList_destroyChunk(job->sectorChunk);
+			sprdisplayList_destroyChunk(job->spriteChunk);
+			objectPortalPlanes_destroyChunk(job->planeChunk);
+			model_destroyChunk(job->modelChunk);
+			delete job;
+		}
+		s_traversalJobs.clear();
+		traversal_destroyContext(s_traversalHelperContext);
+		s_traversalHelperContext = nullptr;
+	}
+
+	// Pick up changes to the thread count.
+	void traversal_updateWorkers()
+	{
+		TFE_Settings_Graphics* graphics = TFE_Settings::getGraphicsSettings();
+		const s32 workerCount = clamp(graphics->gpuTraversalThreadCount, 1, (s32)TRAVERSAL_MAX_THREADS) - 1;
+		if (workerCount != s_traversalWorkerCount)
+		{
+			traversal_destroyWorkers();
+			traversal_createWorkers(workerCount);
+		}
+	}
+
+	TraversalJob* traversal_getJob(s32 index)
+	{
+		while (index >= (s32)s_traversalJobs.size())
+		{
+			TraversalJob* job = new TraversalJob();
+			job->sectorChunk = sdisplayList_createChunk();
+			job->spriteChunk = sprdisplayList_createChunk();
+			job->planeChunk = objectPortalPlanes_createChunk();
+			job->modelChunk = model_createChunk();
+			s_traversalJobs.push_back(job);
+		}
+		return s_traversalJobs[index];
+	}
+
+	void traversal_executeJob(TraversalJob* job)
+	{
+		const TraversalContext* split = s_traversalSplitContext;
+		frustum_copyStack(s_traversalSplitFrustum);
+		memcpy(s_ctx->path, split->path, sizeof(RWall*) * split->pathCount);
+		s_ctx->pathCount = split->pathCount;
+		s_ctx->portalListCount = 0;
+		s_ctx->portalsTraversed = split->portalsTraversed;
+		s_ctx->wallSegGenerated = split->wallSegGenerated;
+		s_ctx->job = job;
+
+		job->renderedSectors.clear();
+		job->updatedSectors.clear();
+		job->uploadFlags = UPLOAD_NONE;
+		sdisplayList_beginChunk(job->sectorChunk);
+		sprdisplayList_beginChunk(job->spriteChunk);
+		objectPortalPlanes_beginChunk(job->planeChunk);
+		model_beginChunk(job->modelChunk);
+
+		s32 level = job->level;
+		traversePortal(&job->portal, job->sector, job->parentPortalId, level, job->uploadFlags);
+
+		sdisplayList_beginChunk(nullptr);
+		sprdisplayList_beginChunk(nullptr);
+		objectPortalPlanes_beginChunk(nullptr);
+		model_beginChunk(nullptr);
+
+		job->portalsTraversed = s_ctx->portalsTraversed - split->portalsTraversed;
+		job->wallSegGenerated = s_ctx->wallSegGenerated - split->wallSegGenerated;
+		s_ctx->job = nullptr;
+	}
+
+	void traversal_executeJobs()
+	{
+		while (1)
+		{
+			const s32 index = s_traversalNextJob.fetch_add(1);
+			if (index >= s_traversalJobLimit.load()) { break; }
+			traversal_executeJob(s_traversalJobs[index]);
+		}
+	}
+
+	TFE_THREADRET traversalWorkerFunc(void* userData)
+	{
+		TraversalWorker* worker = (TraversalWorker*)userData;
+		s_ctx = worker->context;
+		frustum_setThreadStack(s_ctx->frustumStack);
+		sbuffer_setThreadState(s_ctx->sbuffer);
+		TFE_Profiler::setThreadName("TraversalThread");
+		while (1)
 		{
-			frustum_push(portal->frustum);
-			level++;
-			s_portalsTraversed++;
+			worker->start->wait();
+			if (!s_traversalWorkersRunning.load()) { break; }
 
-			// Add a portal to the display list.
-			Vec3f corner0 = { portal->v0.x, portal->y0, portal->v0.z };
-			Vec3f corner1 = { portal->v1.x, portal->y1, portal->v1.z };
-			if (sdisplayList_addPortal(corner0, corner1, parentPortalId))
+			TFE_ZONE_BEGIN(traversalJobs, "Traversal Jobs");
+			traversal_executeJobs();
+			TFE_ZONE_END(traversalJobs);
+			if (s_traversalJobsRemaining.fetch_sub(1) == 1)
 			{
-				portal->wall->drawFrame = s_gpuFrame;
-				traverseSector(portal->next, curSector, portal->wall, parentPortalId, level, uploadFlags, portal->v0, portal->v1);
-				portal->wall->drawFrame = 0;
+				s_traversalDoneSignal->fire();
 			}
+		}
+		return (TFE_THREADRET)0;
+	}
 
-			frustum_pop();
-			level--;
+	// Process each portal subtree as a separate job and then merge the results in portal order, which produces the same
+	// display lists as the serial traversal.
+	void traversal_runJobs(RSector* curSector, s32 parentPortalId, s32 portalStart, s32 portalCount, s32 level, u32& uploadFlags)
+	{
+		for (s32 p = 0; p < portalCount; p++)
+		{
+			TraversalJob* job = traversal_getJob(p);
+			job->portal = s_ctx->portalList[portalStart + p];
+			job->sector = curSector;
+			job->parentPortalId = parentPortalId;
+			job->level = level;
 		}
+		s_traversalSplitContext = s_ctx;
+		s_traversalSplitFrustum = frustum_getThreadStack();
+		s_traversalBatch++;
+
+		// Every worker checks in once, so no worker can still be looking at the job list when the next batch starts.
+		s_traversalJobLimit.store(portalCount);
+		s_traversalNextJob.store(0);
+		s_traversalJobsRemaining.store(s_traversalWorkerCount);
+		for (s32 i = 0; i < s_traversalWorkerCount; i++)
+		{
+			s_traversalWorkers[i].start->fire();
+		}
+
+		// The main thread processes jobs as well, using its own state so the split frustum stack is left untouched.
+		TraversalContext* mainContext = s_ctx;
+		FrustumStack* mainFrustum = s_traversalSplitFrustum;
+		s_ctx = s_traversalHelperContext;
+		frustum_setThreadStack(s_ctx->frustumStack);
+		sbuffer_setThreadState(s_ctx->sbuffer);
+		traversal_executeJobs();
+		s_traversalDoneSignal->wait();
+		s_ctx = mainContext;
+		frustum_setThreadStack(mainFrustum);
+		sbuffer_setThreadState(nullptr);
+		s_traversalSplitContext = nullptr;
+		s_traversalSplitFrustum = nullptr;
+
+		// Sector updates are kept either way, since the cached sectors have already changed.
+		s32 portalsTraversed = s_ctx->portalsTraversed;
+		s32 wallSegGenerated = s_ctx->wallSegGenerated;
+		for (s32 p = 0; p < portalCount; p++)
+		{
+			TraversalJob* job = s_traversalJobs[p];
+			const s32 updateCount = (s32)job->updatedSectors.size();
+			for (s32 i = 0; i < updateCount; i++)
+			{
+				markCachedSectorDirty(job->updatedSectors[i].sector, job->updatedSectors[i].flags);
+			}
+			uploadFlags |= job->uploadFlags;
+			portalsTraversed += job->portalsTraversed;
+			wallSegGenerated += job->wallSegGenerated;
+		}
+
+		// Each job checks the portal and wall segment limits on its own. If the limits were reached, the serial
+		// traversal would have stopped at a different point, so discard the results and traverse serially instead.
+		if (portalsTraversed >= s_maxPortals || wallSegGenerated >= s_maxWallSeg)
+		{
+			s_traversalSerialFallback = true;
+			for (s32 p = 0; p < portalCount && s_ctx->portalsTraversed < s_maxPortals; p++)
+			{
+				traversePortal(&s_ctx->portalList[portalStart + p], curSector, parentPortalId, level, uploadFlags);
+			}
+			s_traversalSerialFallback = false;
+			return;
+		}
+
+		// Merge the results in order.
+		for (s32 p = 0; p < portalCount; p++)
+		{
+			TraversalJob* job = s_traversalJobs[p];
+			sdisplayList_mergeChunk(job->sectorChunk);
+			const u32 planeBase = objectPortalPlanes_mergeChunk(job->planeChunk);
+			sprdisplayList_mergeChunk(job->spriteChunk, planeBase);
+			model_mergeChunk(job->modelChunk, planeBase);
+
+			const s32 renderedCount = (s32)job->renderedSectors.size();
+			for (s32 i = 0; i < renderedCount; i++)
+			{
+				traversal_markRendered(job->renderedSectors[i]);
+			}
+		}
+		s_ctx->portalsTraversed = portalsTraversed;
+		s_ctx->wallSegGenerated = wallSegGenerated;
 	}
-						
+
 	bool traverseScene(RSector* sector)
 	{
 #if 0
@@ -1145,9 +1596,10 @@ namespace TFE_Jedi
 
 		s32 level = 0;
 		u32 uploadFlags = UPLOAD_NONE;
-		s_portalsTraversed = 0;
-		s_portalListCount = 0;
-		s_wallSegGenerated = 0;
+		s_ctx->portalsTraversed = 0;
+		s_ctx->portalListCount = 0;
+		s_ctx->pathCount = 0;
+		s_ctx->wallSegGenerated = 0;
 		Vec2f startView[] = { {0,0}, {0,0} };
 
 		// Compute an XZ direction for sprite culling.
@@ -1169,9 +1621,12 @@ namespace TFE_Jedi
 		model_drawListClear();
 		objectPortalPlanes_clear();
 
+		traversal_updateWorkers();
 		updateCachedSector(sector, uploadFlags);
 		traverseSector(sector, nullptr, nullptr, 0, level, uploadFlags, startView[0], startView[1]);
 		frustum_pop();
+		s_portalsTraversed = s_ctx->portalsTraversed;
+		s_wallSegGenerated = s_ctx->wallSegGenerated;
 
 		sdisplayList_finish();
 		sprdisplayList_finish();
@@ -1190,13 +1645,14 @@ namespace TFE_Jedi
 		s_scaledAmbient = (s_sectorAmbient >> 1) + (s_sectorAmbient >> 2) + (s_sectorAmbient >> 3);
 		s_sectorAmbientFraction = s_sectorAmbient << 11;	// fraction of ambient compared to max.
 
+		// Only the sectors and walls that changed are uploaded.
 		if (uploadFlags & UPLOAD_SECTORS)
 		{
-			s_sectorGpuBuffer.update(s_gpuSourceData.sectors, s_gpuSourceData.sectorSize);
+			s_sectorGpuBuffer.flush(s_gpuSourceData.sectors);
 		}
 		if (uploadFlags & UPLOAD_WALLS)
 		{
-			s_wallGpuBuffer.update(s_gpuSourceData.walls, s_gpuSourceData.wallSize);
+			s_wallGpuBuffer.flush(s_gpuSourceData.walls);
 		}
 
 		return sdisplayList_getSize() > 0;
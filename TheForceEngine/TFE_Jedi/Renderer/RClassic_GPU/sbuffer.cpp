@@ -33,15 +33,8 @@ namespace TFE_Jedi
 	extern Vec3f s_cameraPos;
 	const f32 c_sideEps = 0.0001f;
 
-	enum
-	{
-		SEG_CLIP_POOL_SIZE = 8192
-	};
-
-	SegmentClipped s_segClippedPool[SEG_CLIP_POOL_SIZE];
-	SegmentClipped* s_segClippedHead;
-	SegmentClipped* s_segClippedTail;
-	s32 s_segClippedPoolCount = 0;
+	static SBufferState s_mainState;
+	static thread_local SBufferState* s_state = &s_mainState;
 
 	SegmentClipped* sbuffer_getClippedSeg(Segment* seg);
 	void insertSegmentBefore(SegmentClipped* cur, SegmentClipped* seg);
@@ -55,6 +48,11 @@ namespace TFE_Jedi
 	///////////////////////////////////////////////////////////////
 	// API
 	///////////////////////////////////////////////////////////////
+	void sbuffer_setThreadState(SBufferState* state)
+	{
+		s_state = state ? state : &s_mainState;
+	}
+
 		
 	// Project a 2D coordinate onto the unit square centered around the camera.
 	// This returns back a single value where 0.5 = +x,0; 1.5 = 0,+z; 2.5 = -x,0; 3.5 = 0,-z
@@ -163,14 +161,14 @@ namespace TFE_Jedi
 
 	void sbuffer_clear()
 	{
-		s_segClippedHead = nullptr;
-		s_segClippedTail = nullptr;
-		s_segClippedPoolCount = 0;
+		s_state->head = nullptr;
+		s_state->tail = nullptr;
+		s_state->poolCount = 0;
 	}
 
 	void sbuffer_mergeSegments()
 	{
-		SegmentClipped* cur = s_segClippedHead;
+		SegmentClipped* cur = s_state->head;
 		while (cur)
 		{
 			SegmentClipped* curNext = cur->next;
@@ -184,14 +182,14 @@ namespace TFE_Jedi
 
 		// Try to merge the head and tail because they might have been split on the modulo line.
 		/*
-		if (s_segClippedHead != s_segClippedTail)
+		if (s_state->head != s_state->tail)
 		{
-			if (s_segClippedHead->x0 == 0.0f && s_segClippedTail->x1 == 4.0f && s_segClippedHead->seg->id == s_segClippedTail->seg->id)
+			if (s_state->head->x0 == 0.0f && s_state->tail->x1 == 4.0f && s_state->head->seg->id == s_state->tail->seg->id)
 			{
-				s_segClippedTail->x1 = s_segClippedHead->x1 + 4.0f;
-				s_segClippedTail->v1 = s_segClippedHead->v1;
-				s_segClippedHead = s_segClippedHead->next;
-				s_segClippedHead->prev = nullptr;
+				s_state->tail->x1 = s_state->head->x1 + 4.0f;
+				s_state->tail->v1 = s_state->head->v1;
+				s_state->head = s_state->head->next;
+				s_state->head->prev = nullptr;
 			}
 		}
 		*/
@@ -199,15 +197,15 @@ namespace TFE_Jedi
 
 	void sbuffer_insertSegment(Segment* seg)
 	{
-		if (!s_segClippedHead)
+		if (!s_state->head)
 		{
-			s_segClippedHead = sbuffer_getClippedSeg(seg);
-			s_segClippedTail = s_segClippedHead;
+			s_state->head = sbuffer_getClippedSeg(seg);
+			s_state->tail = s_state->head;
 			return;
 		}
 
 		// Go through and see if there is an overlap.
-		SegmentClipped* cur = s_segClippedHead;
+		SegmentClipped* cur = s_state->head;
 		while (cur)
 		{
 			// Do the segments overlap?
@@ -318,12 +316,12 @@ namespace TFE_Jedi
 			cur = cur->next;
 		}
 		// The new segment is to the right of everything.
-		insertSegmentAfter(s_segClippedTail, sbuffer_getClippedSeg(seg));
+		insertSegmentAfter(s_state->tail, sbuffer_getClippedSeg(seg));
 	}
 
 	SegmentClipped* sbuffer_get()
 	{
-		return s_segClippedHead;
+		return s_state->head;
 	}
 
 	SegmentClipped* sbuffer_getClippedSeg(Segment* seg, SegmentClipped* dstSegs, s32 maxOutputSegs, s32& dstSegCount)
@@ -494,7 +492,7 @@ namespace TFE_Jedi
 	s32 sbuffer_clipSegmentToBuffer(Vec2f v0, Vec2f v1, s32 rangeCount, Vec2f* range, Vec2f* rangeSrc, s32 maxOutputSegs, SegmentClipped* dstSegs, SBufferClipRule clipRule)
 	{
 		// Invalid state.
-		if (!s_segClippedHead || !s_segClippedTail) { return 0; }
+		if (!s_state->head || !s_state->tail) { return 0; }
 
 		// Convert from positions to segments.
 		// Early return if no segments are generated.
@@ -507,7 +505,7 @@ namespace TFE_Jedi
 		{
 			Segment* seg = &srcSeg[srcSegCount - s - 1];
 
-			SegmentClipped* cur = s_segClippedHead;
+			SegmentClipped* cur = s_state->head;
 			bool addSegEnd = true;
 			while (cur)
 			{
@@ -693,7 +691,7 @@ namespace TFE_Jedi
 
 	void sbuffer_debugDisplay()
 	{
-		const SegmentClipped* wallSeg = s_segClippedHead;
+		const SegmentClipped* wallSeg = s_state->head;
 		while (wallSeg)
 		{
 			const Segment* seg = wallSeg->seg;
@@ -764,13 +762,13 @@ namespace TFE_Jedi
 
 	SegmentClipped* sbuffer_getClippedSeg(Segment* seg)
 	{
-		if (s_segClippedPoolCount >= SEG_CLIP_POOL_SIZE)
+		if (s_state->poolCount >= SEG_CLIP_POOL_SIZE)
 		{
 			assert(0);
 			TFE_System::logWrite(LOG_ERROR, "SegBuffer", "Too many clipped segs allocated - max is %d", SEG_CLIP_POOL_SIZE);
 			return nullptr;
 		}
-		SegmentClipped* segClipped = &s_segClippedPool[s_segClippedPoolCount];
+		SegmentClipped* segClipped = &s_state->pool[s_state->poolCount];
 		segClipped->prev = nullptr;
 		segClipped->next = nullptr;
 		segClipped->seg = seg;
@@ -781,7 +779,7 @@ namespace TFE_Jedi
 			segClipped->v0 = seg->v0;
 			segClipped->v1 = seg->v1;
 		}
-		s_segClippedPoolCount++;
+		s_state->poolCount++;
 		return segClipped;
 	}
 
@@ -794,7 +792,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedHead = seg;
+			s_state->head = seg;
 		}
 		seg->prev = curPrev;
 		seg->next = cur;
@@ -810,7 +808,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedTail = seg;
+			s_state->tail = seg;
 		}
 		seg->next = curNext;
 		seg->prev = cur;
@@ -827,7 +825,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedHead = curNext;
+			s_state->head = curNext;
 		}
 
 		if (curNext)
@@ -836,7 +834,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedTail = curPrev;
+			s_state->tail = curPrev;
 		}
 	}
 
@@ -852,7 +850,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedTail = a;
+			s_state->tail = a;
 		}
 		return a;
 	}
@@ -868,7 +866,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedHead = b;
+			s_state->head = b;
 		}
 		b->next = a;
 		a->prev = b;
@@ -879,7 +877,7 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_segClippedTail = a;
+			s_state->tail = a;
 		}
 	}
 
@@ -33,6 +33,19 @@ namespace TFE_Jedi
 		Vec2f v0, v1;
 	};
 
+	enum SBufferConstants
+	{
+		SEG_CLIP_POOL_SIZE = 8192
+	};
+
+	struct SBufferState
+	{
+		SegmentClipped pool[SEG_CLIP_POOL_SIZE];
+		SegmentClipped* head;
+		SegmentClipped* tail;
+		s32 poolCount;
+	};
+
 	// Clip rule called on portal segments.
 	// Return true if the segment should clip the incoming segment.
 	typedef bool(*SBufferClipRule)(s32 id);
@@ -42,6 +55,9 @@ namespace TFE_Jedi
 	bool  sbuffer_splitByRange(Segment* seg, Vec2f* range, Vec2f* points, s32 rangeCount);
 	Vec2f sbuffer_clip(Vec2f v0, Vec2f v1, Vec2f pointOnPlane);
 
+	// Each thread uses the main s-buffer unless it sets its own (used by the traversal threads).
+	void sbuffer_setThreadState(SBufferState* state);
+
 	void sbuffer_clear();
 	void sbuffer_mergeSegments();
 	void sbuffer_insertSegment(Segment* seg);
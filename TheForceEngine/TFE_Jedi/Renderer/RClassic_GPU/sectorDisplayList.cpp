@@ -1,4 +1,5 @@
 #include <cstring>
+#include <vector>
 
 #include <TFE_System/profiler.h>
 #include <TFE_System/math.h>
@@ -51,8 +52,24 @@ namespace TFE_Jedi
 		SPARTID_COUNT
 	};
 
+	// Display list output from a traversal thread, merged into the main list once traversal is complete.
+	// Portal IDs continue on from the main list so portals from the main list can be used as parents, but
+	// plane offsets are local to the chunk until it is merged.
+	struct SDisplayListChunk
+	{
+		std::vector<Vec4f>  pos[SECTOR_PASS_COUNT];
+		std::vector<Vec4ui> data[SECTOR_PASS_COUNT];
+		std::vector<Vec4f>  planes;
+		std::vector<u32>    portalPlaneInfo;
+		std::vector<Frustum> portalFrustum;
+		std::vector<RWall*> seenWalls;
+		s32 portalIdBase;
+		s32 portalCount;
+		s32 maxPlaneCount;
+	};
+
 	// TODO: factor out so the sprite, sector, and geometry passes can use it.
-	s32 s_displayCurrentPortalId = 0;
+	thread_local s32 s_displayCurrentPortalId = 0;
 	ShaderBuffer s_displayListPlanesGPU;
 
 	static s32 s_displayListCount[SECTOR_PASS_COUNT];
@@ -70,6 +87,7 @@ namespace TFE_Jedi
 	static s32 s_dataIndex[SECTOR_PASS_COUNT];
 	static s32 s_planesIndex = -1;
 	static s32 s_maxPlaneCount = 0;
+	static thread_local SDisplayListChunk* s_chunk = nullptr;
 
 	void sdisplayList_init(s32* posIndex, s32* dataIndex, s32 planesIndex)
 	{
@@ -162,7 +180,8 @@ namespace TFE_Jedi
 		const u32 planeInfo = sdisplayList_getPackedPortalInfo(portalId);
 		const u32 count  = UNPACK_PORTAL_INFO_COUNT(planeInfo);
 		const u32 offset = UNPACK_PORTAL_INFO_OFFSET(planeInfo);
-		const Vec4f* planes = &s_displayListPlanes[offset];
+		const bool chunkPortal = s_chunk && s32(portalId) > s_chunk->portalIdBase;
+		const Vec4f* planes = chunkPortal ? &s_chunk->planes[offset] : &s_displayListPlanes[offset];
 
 		if ((planeType & PLANE_TYPE_BOTH) == PLANE_TYPE_BOTH)
 		{
@@ -191,8 +210,36 @@ namespace TFE_Jedi
 		{
 			return 0;
 		}
+		if (s_chunk && portalId > s_chunk->portalIdBase)
+		{
+			return s_chunk->portalPlaneInfo[portalId - s_chunk->portalIdBase - 1];
+		}
 		return s_portalPlaneInfo[portalIndex];
 	}
+
+	// Returns the clipping frustum of an existing portal, which may belong to the main list or the current chunk.
+	Frustum* sdisplayList_getPortalFrustum(s32 portalId)
+	{
+		if (s_chunk && portalId > s_chunk->portalIdBase)
+		{
+			return &s_chunk->portalFrustum[portalId - s_chunk->portalIdBase - 1];
+		}
+		return &s_portalFrustumVert[portalId - 1];
+	}
+
+	// Returns the frustum for the next portal to be added.
+	Frustum* sdisplayList_allocPortalFrustum()
+	{
+		if (s_chunk)
+		{
+			if (s_chunk->portalCount >= (s32)s_chunk->portalFrustum.size())
+			{
+				s_chunk->portalFrustum.resize(s_chunk->portalCount + 1);
+			}
+			return &s_chunk->portalFrustum[s_chunk->portalCount];
+		}
+		return &s_portalFrustumVert[s_displayPortalCount];
+	}
 		
 	bool sdisplayList_addPortal(Vec3f p0, Vec3f p1, s32 parentPortalId)
 	{
@@ -207,15 +254,18 @@ namespace TFE_Jedi
 			{ p0.x, p0.y, p0.z },
 		};
 		
+		// Allocate the new frustum first, since that may move the existing frustums in a chunk.
+		Frustum* frust = sdisplayList_allocPortalFrustum();
+		s32& maxPlaneCount = s_chunk ? s_chunk->maxPlaneCount : s_maxPlaneCount;
 		if (parentPortalId > 0)
 		{
 			Polygon clipped;
-			s32 parentPortalIndex = parentPortalId - 1;
-			if (frustum_clipQuadToPlanes(s_portalFrustumVert[parentPortalIndex].planeCount, s_portalFrustumVert[parentPortalIndex].planes, botEdge[0], topEdge[0], &clipped))
+			const Frustum* parentFrustum = sdisplayList_getPortalFrustum(parentPortalId);
+			if (frustum_clipQuadToPlanes(parentFrustum->planeCount, parentFrustum->planes, botEdge[0], topEdge[0], &clipped))
 			{
 				// Build a new frustum.
-				u32& count = s_portalFrustumVert[s_displayPortalCount].planeCount;
-				Vec4f* plane = s_portalFrustumVert[s_displayPortalCount].planes;
+				u32& count = frust->planeCount;
+				Vec4f* plane = frust->planes;
 				count = 0;
 				for (s32 i = 0; i < clipped.vertexCount; i++)
 				{
@@ -226,8 +276,8 @@ namespace TFE_Jedi
 						plane[count++] = frustum_calculatePlaneFromEdge(edge);
 					}
 				}
-				s_maxPlaneCount = max(count, s_maxPlaneCount);
-				assert(s_maxPlaneCount <= FRUSTUM_PLANE_MAX);
+				maxPlaneCount = max(count, maxPlaneCount);
+				assert(maxPlaneCount <= FRUSTUM_PLANE_MAX);
 
 				// Add left and right planes if there is enough room...
 				// This is so that caps are properly clipped.
@@ -251,9 +301,9 @@ namespace TFE_Jedi
 		}
 		else
 		{
-			s_portalFrustumVert[s_displayPortalCount].planeCount = 2;
-			s_portalFrustumVert[s_displayPortalCount].planes[0] = frustum_calculatePlaneFromEdge(botEdge);
-			s_portalFrustumVert[s_displayPortalCount].planes[1] = frustum_calculatePlaneFromEdge(topEdge);
+			frust->planeCount = 2;
+			frust->planes[0] = frustum_calculatePlaneFromEdge(botEdge);
+			frust->planes[1] = frustum_calculatePlaneFromEdge(topEdge);
 
 			// Add left and right planes if there is enough room...
 			// This is so that caps are properly clipped.
@@ -268,18 +318,35 @@ namespace TFE_Jedi
 				{ p1.x, p0.y, p1.z },
 			};
 
-			s_portalFrustumVert[s_displayPortalCount].planeCount += 2;
-			s_portalFrustumVert[s_displayPortalCount].planes[2] = frustum_calculatePlaneFromEdge(leftEdge);
-			s_portalFrustumVert[s_displayPortalCount].planes[3] = frustum_calculatePlaneFromEdge(rightEdge);
+			frust->planeCount += 2;
+			frust->planes[2] = frustum_calculatePlaneFromEdge(leftEdge);
+			frust->planes[3] = frustum_calculatePlaneFromEdge(rightEdge);
 		}
 
-		const u32 planeCount = min(MAX_PORTAL_PLANES, s_portalFrustumVert[s_displayPortalCount].planeCount);
-		if (s_displayPortalCount + planeCount < MAX_BUFFER_SIZE)
+		const u32 planeCount = min(MAX_PORTAL_PLANES, frust->planeCount);
+		if (s_chunk)
+		{
+			if (s_chunk->portalIdBase + s_chunk->portalCount + planeCount < MAX_BUFFER_SIZE)
+			{
+				s_chunk->portalPlaneInfo.push_back(PACK_PORTAL_INFO(s_chunk->planes.size(), planeCount));
+				for (u32 i = 0; i < planeCount; i++)
+				{
+					s_chunk->planes.push_back(frust->planes[i]);
+				}
+				s_displayCurrentPortalId = 1 + s_chunk->portalIdBase + s_chunk->portalCount;
+				s_chunk->portalCount++;
+			}
+			else
+			{
+				TFE_System::logWrite(LOG_WARNING, "GPU Renderer", "Too many portal planes.");
+				assert(0);
+			}
+		}
+		else if (s_displayPortalCount + planeCount < MAX_BUFFER_SIZE)
 		{
 			s_portalPlaneInfo[s_displayPortalCount] = PACK_PORTAL_INFO(s_displayPlaneCount, planeCount);
 
 			// The new planes either match the parent or are created from the edges.
-			const Frustum* frust = &s_portalFrustumVert[s_displayPortalCount];
 			Vec4f* outPlanes = &s_displayListPlanes[s_displayPlaneCount];
 			for (u32 i = 0; i < planeCount; i++)
 			{
@@ -300,6 +367,17 @@ namespace TFE_Jedi
 
 	void addDisplayListItem(const Vec4f pos, const Vec4ui data, const SectorPass bufferIndex)
 	{
+		if (s_chunk)
+		{
+			if (s_chunk->pos[bufferIndex].size() >= MAX_DISP_ITEMS)
+			{
+				return;
+			}
+			s_chunk->pos[bufferIndex].push_back(pos);
+			s_chunk->data[bufferIndex].push_back(data);
+			return;
+		}
+
 		assert(s_displayListCount[bufferIndex] < MAX_DISP_ITEMS);
 		if (s_displayListCount[bufferIndex] >= MAX_DISP_ITEMS)
 		{
@@ -325,7 +403,14 @@ namespace TFE_Jedi
 		s32 wallId = wallSeg->seg->id;
 		RWall* srcWall = &curSector->walls[wallId];
 		// Mark only visible walls as being rendered.
-		srcWall->seen = JTRUE;
+		if (s_chunk)
+		{
+			s_chunk->seenWalls.push_back(srcWall);
+		}
+		else
+		{
+			srcWall->seen = JTRUE;
+		}
 
 		// Limit 65536 walls **per sector**.
 		u32 wallGpuId = u32(wallId) << 16u;
@@ -484,6 +569,77 @@ namespace TFE_Jedi
 			curSector->ceilTex && *curSector->ceilTex ? (*curSector->ceilTex)->textureId : 0u }, SECTOR_PASS_OPAQUE);
 	}
 
+	SDisplayListChunk* sdisplayList_createChunk()
+	{
+		return new SDisplayListChunk();
+	}
+
+	void sdisplayList_destroyChunk(SDisplayListChunk* chunk)
+	{
+		delete chunk;
+	}
+
+	void sdisplayList_beginChunk(SDisplayListChunk* chunk)
+	{
+		s_chunk = chunk;
+		s_displayCurrentPortalId = 0;
+		if (!chunk) { return; }
+
+		for (s32 i = 0; i < SECTOR_PASS_COUNT; i++)
+		{
+			chunk->pos[i].clear();
+			chunk->data[i].clear();
+		}
+		chunk->planes.clear();
+		chunk->portalPlaneInfo.clear();
+		chunk->seenWalls.clear();
+		// The main list is not modified while chunks are being built.
+		chunk->portalIdBase = s_displayPortalCount;
+		chunk->portalCount = 0;
+		chunk->maxPlaneCount = 0;
+	}
+
+	void sdisplayList_mergeChunk(SDisplayListChunk* chunk)
+	{
+		// Append the portal planes, the plane offsets of the chunk become relative to the main list.
+		const u32 planeBase = s_displayPlaneCount;
+		const s32 planeCount = min((s32)chunk->planes.size(), MAX_BUFFER_SIZE - s_displayPlaneCount);
+		if (planeCount > 0)
+		{
+			memcpy(&s_displayListPlanes[s_displayPlaneCount], chunk->planes.data(), sizeof(Vec4f) * planeCount);
+			s_displayPlaneCount += planeCount;
+		}
+		// Portal frustums are only used during traversal, so only the plane info is kept.
+		for (s32 i = 0; i < chunk->portalCount && s_displayPortalCount < MAX_DISP_ITEMS; i++)
+		{
+			const u32 info = chunk->portalPlaneInfo[i];
+			s_portalPlaneInfo[s_displayPortalCount++] = PACK_PORTAL_INFO(UNPACK_PORTAL_INFO_OFFSET(info) + planeBase, UNPACK_PORTAL_INFO_COUNT(info));
+		}
+		s_maxPlaneCount = max(s_maxPlaneCount, chunk->maxPlaneCount);
+
+		for (s32 p = 0; p < SECTOR_PASS_COUNT; p++)
+		{
+			const s32 count = (s32)chunk->pos[p].size();
+			for (s32 i = 0; i < count; i++)
+			{
+				// The portal info is stored in the upper bits of 'z', see sdisplayList_addSegment().
+				Vec4ui data = chunk->data[p][i];
+				const u32 info = data.z >> 7u;
+				if (info)
+				{
+					data.z = (data.z & 127u) | (PACK_PORTAL_INFO(UNPACK_PORTAL_INFO_OFFSET(info) + planeBase, UNPACK_PORTAL_INFO_COUNT(info)) << 7u);
+				}
+				addDisplayListItem(chunk->pos[p][i], data, SectorPass(p));
+			}
+		}
+
+		const size_t seenCount = chunk->seenWalls.size();
+		for (size_t i = 0; i < seenCount; i++)
+		{
+			chunk->seenWalls[i]->seen = JTRUE;
+		}
+	}
+
 	s32 sdisplayList_getSize(SectorPass passId)
 	{
 		return s_displayListCount[passId];
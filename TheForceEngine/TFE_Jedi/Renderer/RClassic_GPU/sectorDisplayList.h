@@ -45,6 +45,8 @@ namespace TFE_Jedi
 		s32 wallStart;
 	};
 
+	struct SDisplayListChunk;
+
 	void sdisplayList_init(s32* posIndex, s32* dataIndex, s32 planesIndex);
 	void sdisplayList_destroy();
 
@@ -59,4 +61,13 @@ namespace TFE_Jedi
 
 	u32 sdisplayList_getPackedPortalInfo(s32 portalId);
 	u32 sdisplayList_getPlanesFromPortal(u32 portalId, u32 planeType, Vec4f* outPlanes);
+
+	// Traversal threads build their part of the display list in a separate chunk, which is then merged
+	// into the main list by the main thread. Merging the chunks in traversal order produces the same
+	// display list as a single threaded traversal.
+	SDisplayListChunk* sdisplayList_createChunk();
+	void sdisplayList_destroyChunk(SDisplayListChunk* chunk);
+	// Redirect the display list output of the calling thread into 'chunk', or back to the main list if 'chunk' is null.
+	void sdisplayList_beginChunk(SDisplayListChunk* chunk);
+	void sdisplayList_mergeChunk(SDisplayListChunk* chunk);
 }  // TFE_Jedi
@@ -1,4 +1,5 @@
 #include <cstring>
+#include <vector>
 
 #include <TFE_System/profiler.h>
 #include <TFE_System/math.h>
@@ -50,8 +51,18 @@ namespace TFE_Jedi
 	static s32 s_texIdTextureIndex;
 	static s32 s_planesIndex;
 
+	// Sprites added by a traversal thread, see sdisplayList_beginChunk().
+	struct SpriteDisplayListChunk
+	{
+		std::vector<Vec4f> posXZ;
+		std::vector<Vec4f> posYU;
+		std::vector<Vec2i> texId;
+		std::vector<void*> objList;
+	};
+	static thread_local SpriteDisplayListChunk* s_chunk = nullptr;
+
 	// TODO: Refactor
-	extern s32 s_displayCurrentPortalId;
+	extern thread_local s32 s_displayCurrentPortalId;
 	extern ShaderBuffer s_displayListPlanesGPU;
 
 	extern Vec3f s_cameraPos;
@@ -122,7 +133,8 @@ namespace TFE_Jedi
 	void sprdisplayList_addFrame(const SpriteDrawFrame* const drawFrame)
 	{
 		if (!drawFrame->basePtr || !drawFrame->frame) { return; }
-		if (s_displayListCount >= MAX_DISP_ITEMS)
+		const s32 count = s_chunk ? (s32)s_chunk->posXZ.size() : s_displayListCount;
+		if (count >= MAX_DISP_ITEMS)
 		{
 			assert(0);
 			return;
@@ -157,6 +169,14 @@ namespace TFE_Jedi
 		const u32 portalInfo = drawFrame->portalInfo;
 		const f32 heightWS = fixed16ToFloat(drawFrame->frame->heightWS);
 		const f32 fOffsetY = fixed16ToFloat(drawFrame->frame->offsetY);
+		if (s_chunk)
+		{
+			s_chunk->posXZ.push_back({ drawFrame->c0.x, drawFrame->c0.z, drawFrame->c1.x, drawFrame->c1.z });
+			s_chunk->posYU.push_back({ drawFrame->posY + fOffsetY, drawFrame->posY + fOffsetY - heightWS, u0, u1 });
+			s_chunk->texId.push_back({ cell->textureId | (ambient << 16), s32(portalInfo) });
+			s_chunk->objList.push_back(drawFrame->objPtr);
+			return;
+		}
 		s_displayListPosXZTexture[0][s_displayListCount] = { drawFrame->c0.x, drawFrame->c0.z, drawFrame->c1.x, drawFrame->c1.z };
 		s_displayListPosYUTexture[0][s_displayListCount] = { drawFrame->posY + fOffsetY, drawFrame->posY + fOffsetY - heightWS, u0, u1 };
 		s_displayListTexIdTexture[0][s_displayListCount] = { cell->textureId | (ambient << 16), s32(portalInfo) };
@@ -164,6 +184,39 @@ namespace TFE_Jedi
 		s_displayListCount++;
 	}
 
+	SpriteDisplayListChunk* sprdisplayList_createChunk()
+	{
+		return new SpriteDisplayListChunk();
+	}
+
+	void sprdisplayList_destroyChunk(SpriteDisplayListChunk* chunk)
+	{
+		delete chunk;
+	}
+
+	void sprdisplayList_beginChunk(SpriteDisplayListChunk* chunk)
+	{
+		s_chunk = chunk;
+		if (!chunk) { return; }
+
+		chunk->posXZ.clear();
+		chunk->posYU.clear();
+		chunk->texId.clear();
+		chunk->objList.clear();
+	}
+
+	void sprdisplayList_mergeChunk(SpriteDisplayListChunk* chunk, u32 objectPlaneBase)
+	{
+		const s32 count = min((s32)chunk->posXZ.size(), MAX_DISP_ITEMS - s_displayListCount);
+		for (s32 i = 0; i < count; i++, s_displayListCount++)
+		{
+			s_displayListPosXZTexture[0][s_displayListCount] = chunk->posXZ[i];
+			s_displayListPosYUTexture[0][s_displayListCount] = chunk->posYU[i];
+			s_displayListTexIdTexture[0][s_displayListCount] = { chunk->texId[i].x, s32(objectPortalPlanes_rebaseInfo(u32(chunk->texId[i].z), objectPlaneBase)) };
+			s_displayListObjList[s_displayListCount] = chunk->objList[i];
+		}
+	}
+
 	s32 sprdisplayList_getSize()
 	{
 		return s_displayListCount;
@@ -29,6 +29,8 @@ namespace TFE_Jedi
 		u32 portalInfo;
 	};
 
+	struct SpriteDisplayListChunk;
+
 	void sprdisplayList_init(s32 startIndex);
 	void sprdisplayList_destroy();
 
@@ -39,4 +41,11 @@ namespace TFE_Jedi
 	void sprdisplayList_draw();
 
 	s32  sprdisplayList_getSize();
+
+	// Traversal threads add their sprites to a separate chunk, see sdisplayList_beginChunk().
+	SpriteDisplayListChunk* sprdisplayList_createChunk();
+	void sprdisplayList_destroyChunk(SpriteDisplayListChunk* chunk);
+	void sprdisplayList_beginChunk(SpriteDisplayListChunk* chunk);
+	// 'objectPlaneBase' is the value returned by objectPortalPlanes_mergeChunk() for the same traversal job.
+	void sprdisplayList_mergeChunk(SpriteDisplayListChunk* chunk, u32 objectPlaneBase);
 }  // TFE_Jedi
@@ -5,6 +5,7 @@
 #include "rcommon.h"
 #include "rsectorRender.h"
 #include "screenDraw.h"
+#include "rspan.h"
 #include "RClassic_Fixed/rclassicFixedSharedState.h"
 #include "RClassic_Fixed/rclassicFixed.h"
 #include "RClassic_Fixed/rsectorFixed.h"
@@ -12,6 +13,7 @@
 #include "RClassic_Float/rclassicFloat.h"
 #include "RClassic_Float/rsectorFloat.h"
 #include "RClassic_Float/rclassicFloatSharedState.h"
+#include "RClassic_Float/rrasterFloat.h"
 
 #include "RClassic_GPU/rclassicGPU.h"
 #include "RClassic_GPU/rsectorGPU.h"
@@ -39,12 +41,15 @@ namespace TFE_Jedi
 	void clear1dDepth();
 	void console_setSubRenderer(const std::vector<std::string>& args);
 	void console_getSubRenderer(const std::vector<std::string>& args);
+	void console_setSpanSimd(const std::vector<std::string>& args);
+	void console_getSpanSimd(const std::vector<std::string>& args);
 
 	/////////////////////////////////////////////
 	// Implementation
 	/////////////////////////////////////////////
 	void renderer_resetState()
 	{
+		RClassic_Float::raster_reset();
 		RClassic_Fixed::resetState();
 		RClassic_Float::resetState();
 		RClassic_GPU::resetState();
@@ -110,6 +115,11 @@ namespace TFE_Jedi
 		// Remove temporarily until they do something useful again.
 		CCMD("rsetSubRenderer", console_setSubRenderer, 1, "Set the sub-renderer - valid values are: Classic_Fixed, Classic_Float, Classic_GPU");
 		CCMD("rgetSubRenderer", console_getSubRenderer, 0, "Get the current sub-renderer.");
+		CCMD("rsetSpanSimd", console_setSpanSimd, 1, "Set the software span implementation - valid values are: Scalar, SSE2, AVX2, NEON");
+		CCMD("rgetSpanSimd", console_getSpanSimd, 0, "Get the current software span implementation.");
+
+		// Select the software span functions based on the CPU.
+		span_init();
 
 		// Setup performance counters.
 		TFE_COUNTER(s_maxAdjoinDepth, "Maximum Adjoin Depth");
@@ -125,11 +135,15 @@ namespace TFE_Jedi
 
 	void renderer_destroy()
 	{
+		RClassic_Float::raster_destroy();
 		renderer_resetState();
 	}
 
 	void renderer_reset()
 	{
+		// Level data is about to change, so background rasterization must be finished.
+		RClassic_Float::raster_reset();
+
 		// Reset all allocated renderers.
 		for (s32 i = 0; i < TSR_COUNT; i++)
 		{
@@ -158,6 +172,10 @@ namespace TFE_Jedi
 
 	void renderer_setType(RendererType type)
 	{
+		if (type != s_rendererType)
+		{
+			RClassic_Float::raster_reset();
+		}
 		s_rendererType = type;
 		render_setResolution();
 	}
@@ -223,6 +241,29 @@ namespace TFE_Jedi
 		};
 		TFE_Console::addToHistory(c_subRenderers[s_subRenderer]);
 	}
+
+	void console_setSpanSimd(const std::vector<std::string>& args)
+	{
+		if (args.size() < 2) { return; }
+		const char* value = args[1].c_str();
+
+		for (s32 i = 0; i < SPAN_SIMD_COUNT; i++)
+		{
+			if (strcasecmp(value, span_getSimdName(SpanSimd(i))) == 0)
+			{
+				if (!span_setSimd(SpanSimd(i)))
+				{
+					TFE_Console::addToHistory("Not supported on this CPU.");
+				}
+				return;
+			}
+		}
+	}
+
+	void console_getSpanSimd(const std::vector<std::string>& args)
+	{
+		TFE_Console::addToHistory(span_getSimdName(span_getSimd()));
+	}
 		
 	JBool render_setResolution()
 	{
@@ -424,6 +465,12 @@ namespace TFE_Jedi
 
 	void drawWorld(u8* display, RSector* sector, const u8* colormap, const u8* lightSourceRamp)
 	{
+		// The float sub-renderer may draw into its own buffer when frames are pipelined.
+		if (s_subRenderer == TSR_CLASSIC_FLOAT)
+		{
+			display = RClassic_Float::raster_beginFrame(display);
+		}
+
 		// Clear the top pixel row.
 		if (s_subRenderer != TSR_CLASSIC_GPU)
 		{
@@ -489,6 +536,10 @@ namespace TFE_Jedi
 			TFE_ZONE("Sector Draw");
 			s_sectorRenderer->prepare();
 			s_sectorRenderer->draw(sector);
+			if (s_subRenderer == TSR_CLASSIC_FLOAT)
+			{
+				RClassic_Float::raster_endFrame();
+			}
 		}
 	}
 
@@ -0,0 +1,436 @@
+#include <cstring>
+#include <assert.h>
+#include <SDL_cpuinfo.h>
+
+#include <TFE_System/system.h>
+#include "rspan.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define SPAN_X86 1
+	#include <emmintrin.h>
+	#include <immintrin.h>
+	// MSVC allows AVX2 intrinsics without changing the target architecture of the whole file.
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define SPAN_TARGET_AVX2
+	#else
+		#define SPAN_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#define SPAN_NEON 1
+	#include <arm_neon.h>
+#endif
+
+namespace TFE_Jedi
+{
+	typedef void(*SpanColumnFunc)(u8* out, s32 stride, s32 count, const u8* tex, const u8* light, u32 v0, u32 dv, u32 mask, s32 fracBits);
+	typedef void(*SpanScanlineFunc)(u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, u32 u0, u32 v0, u32 dUdX, u32 dVdX, s32 fracBits);
+
+	// Fill a function table in SpanFunc order from a template<bool lit, bool trans> function.
+	#define SPAN_FUNC_TABLE(name) { name<false, false>, name<true, false>, name<false, true>, name<true, true> }
+
+	static const char* c_spanSimdNames[SPAN_SIMD_COUNT] =
+	{
+		"Scalar",	// SPAN_SIMD_SCALAR
+		"SSE2",		// SPAN_SIMD_SSE2
+		"AVX2",		// SPAN_SIMD_AVX2
+		"NEON",		// SPAN_SIMD_NEON
+	};
+
+	/////////////////////////////////////////////
+	// Shared
+	/////////////////////////////////////////////
+	template<bool lit, bool trans>
+	inline void span_writePixel(u8* dst, u8 c, const u8* light)
+	{
+		if (trans && !c) { return; }
+		*dst = lit ? light[c] : c;
+	}
+
+	// Write 8 scanline pixels given their texel offsets, pixel 'j' (in stepping order) is written to dst[7 - j].
+	template<bool lit, bool trans>
+	inline void span_write8(u8* dst, const u32* texel, const u8* tex, const u8* light)
+	{
+		if (trans)
+		{
+			for (s32 j = 0; j < 8; j++)
+			{
+				span_writePixel<lit, trans>(&dst[7 - j], tex[texel[j]], light);
+			}
+		}
+		else
+		{
+			u8 color[8];
+			for (s32 j = 0; j < 8; j++)
+			{
+				const u8 c = tex[texel[j]];
+				color[7 - j] = lit ? light[c] : c;
+			}
+			memcpy(dst, color, 8);
+		}
+	}
+
+	/////////////////////////////////////////////
+	// Scalar
+	/////////////////////////////////////////////
+	// Only the low 32 bits of the coordinates are required as long as the texel bits fit, which
+	// is true for every column except for some sprites in RClassic_Float - see span_drawColumn().
+	template<bool lit, bool trans>
+	void span_column_Scalar(u8* out, s32 stride, s32 count, const u8* tex, const u8* light, u32 v0, u32 dv, u32 mask, s32 fracBits)
+	{
+		u8* dst = out + (count - 1) * stride;
+		u32 v = v0;
+		for (s32 i = 0; i < count; i++, dst -= stride, v += dv)
+		{
+			span_writePixel<lit, trans>(dst, tex[(v >> fracBits) & mask], light);
+		}
+	}
+
+	template<bool lit, bool trans>
+	void span_column_Scalar64(u8* out, s32 stride, s32 count, const u8* tex, const u8* light, s64 v0, s64 dv, u32 mask, s32 fracBits)
+	{
+		u8* dst = out + (count - 1) * stride;
+		s64 v = v0;
+		for (s32 i = 0; i < count; i++, dst -= stride, v += dv)
+		{
+			span_writePixel<lit, trans>(dst, tex[s32(v >> fracBits) & s32(mask)], light);
+		}
+	}
+
+	template<bool lit, bool trans>
+	void span_scanline_Scalar(u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, u32 u0, u32 v0, u32 dUdX, u32 dVdX, s32 fracBits)
+	{
+		u32 u = u0, v = v0;
+		for (s32 i = width - 1; i >= 0; i--, u += dUdX, v += dVdX)
+		{
+			const u32 texel = ((((u >> fracBits) & 63) << 6) + ((v >> fracBits) & 63)) & dataEnd;
+			span_writePixel<lit, trans>(&out[i], tex[texel], light);
+		}
+	}
+
+	static const SpanColumnFunc   c_columnScalar[SPAN_FUNC_COUNT]   = SPAN_FUNC_TABLE(span_column_Scalar);
+	static const SpanScanlineFunc c_scanlineScalar[SPAN_FUNC_COUNT] = SPAN_FUNC_TABLE(span_scanline_Scalar);
+
+#if SPAN_X86
+	/////////////////////////////////////////////
+	// SSE2
+	/////////////////////////////////////////////
+	inline __m128i span_texel_SSE2(__m128i u, __m128i v, __m128i shift, __m128i mask63, __m128i dataEnd)
+	{
+		const __m128i tu = _mm_slli_epi32(_mm_and_si128(_mm_srl_epi32(u, shift), mask63), 6);
+		const __m128i tv = _mm_and_si128(_mm_srl_epi32(v, shift), mask63);
+		return _mm_and_si128(_mm_or_si128(tu, tv), dataEnd);
+	}
+
+	template<bool lit, bool trans>
+	void span_column_SSE2(u8* out, s32 stride, s32 count, const u8* tex, const u8* light, u32 v0, u32 dv, u32 mask, s32 fracBits)
+	{
+		const __m128i shift = _mm_cvtsi32_si128(fracBits);
+		const __m128i texMask = _mm_set1_epi32(s32(mask));
+		const __m128i step = _mm_set1_epi32(s32(dv * 4));
+		__m128i v = _mm_setr_epi32(s32(v0), s32(v0 + dv), s32(v0 + dv * 2), s32(v0 + dv * 3));
+
+		alignas(16) u32 texel[4];
+		u8* dst = out + (count - 1) * stride;
+		s32 i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			_mm_store_si128((__m128i*)texel, _mm_and_si128(_mm_srl_epi32(v, shift), texMask));
+			v = _mm_add_epi32(v, step);
+
+			span_writePixel<lit, trans>(dst, tex[texel[0]], light); dst -= stride;
+			span_writePixel<lit, trans>(dst, tex[texel[1]], light); dst -= stride;
+			span_writePixel<lit, trans>(dst, tex[texel[2]], light); dst -= stride;
+			span_writePixel<lit, trans>(dst, tex[texel[3]], light); dst -= stride;
+		}
+		if (i < count)
+		{
+			span_column_Scalar<lit, trans>(out, stride, count - i, tex, light, v0 + dv * u32(i), dv, mask, fracBits);
+		}
+	}
+
+	template<bool lit, bool trans>
+	void span_scanline_SSE2(u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, u32 u0, u32 v0, u32 dUdX, u32 dVdX, s32 fracBits)
+	{
+		const __m128i shift = _mm_cvtsi32_si128(fracBits);
+		const __m128i mask63 = _mm_set1_epi32(63);
+		const __m128i endMask = _mm_set1_epi32(s32(dataEnd));
+		const __m128i stepU = _mm_set1_epi32(s32(dUdX * 4));
+		const __m128i stepV = _mm_set1_epi32(s32(dVdX * 4));
+		__m128i u = _mm_setr_epi32(s32(u0), s32(u0 + dUdX), s32(u0 + dUdX * 2), s32(u0 + dUdX * 3));
+		__m128i v = _mm_setr_epi32(s32(v0), s32(v0 + dVdX), s32(v0 + dVdX * 2), s32(v0 + dVdX * 3));
+
+		alignas(16) u32 texel[8];
+		s32 i = width - 1;
+		for (; i >= 7; i -= 8)
+		{
+			_mm_store_si128((__m128i*)&texel[0], span_texel_SSE2(u, v, shift, mask63, endMask));
+			u = _mm_add_epi32(u, stepU);
+			v = _mm_add_epi32(v, stepV);
+			_mm_store_si128((__m128i*)&texel[4], span_texel_SSE2(u, v, shift, mask63, endMask));
+			u = _mm_add_epi32(u, stepU);
+			v = _mm_add_epi32(v, stepV);
+
+			span_write8<lit, trans>(&out[i - 7], texel, tex, light);
+		}
+		if (i >= 0)
+		{
+			const u32 step = u32(width - 1 - i);
+			span_scanline_Scalar<lit, trans>(out, i + 1, tex, dataEnd, light, u0 + dUdX * step, v0 + dVdX * step, dUdX, dVdX, fracBits);
+		}
+	}
+
+	static const SpanColumnFunc   c_columnSSE2[SPAN_FUNC_COUNT]   = SPAN_FUNC_TABLE(span_column_SSE2);
+	static const SpanScanlineFunc c_scanlineSSE2[SPAN_FUNC_COUNT] = SPAN_FUNC_TABLE(span_scanline_SSE2);
+
+	/////////////////////////////////////////////
+	// AVX2
+	/////////////////////////////////////////////
+	SPAN_TARGET_AVX2 inline __m256i span_texel_AVX2(__m256i u, __m256i v, __m128i shift, __m256i mask63, __m256i dataEnd)
+	{
+		const __m256i tu = _mm256_slli_epi32(_mm256_and_si256(_mm256_srl_epi32(u, shift), mask63), 6);
+		const __m256i tv = _mm256_and_si256(_mm256_srl_epi32(v, shift), mask63);
+		return _mm256_and_si256(_mm256_or_si256(tu, tv), dataEnd);
+	}
+
+	SPAN_TARGET_AVX2 inline __m256i span_ramp_AVX2(u32 x0, u32 dx)
+	{
+		return _mm256_setr_epi32(s32(x0), s32(x0 + dx), s32(x0 + dx * 2), s32(x0 + dx * 3),
+			s32(x0 + dx * 4), s32(x0 + dx * 5), s32(x0 + dx * 6), s32(x0 + dx * 7));
+	}
+
+	template<bool lit, bool trans>
+	SPAN_TARGET_AVX2 void span_column_AVX2(u8* out, s32 stride, s32 count, const u8* tex, const u8* light, u32 v0, u32 dv, u32 mask, s32 fracBits)
+	{
+		const __m128i shift = _mm_cvtsi32_si128(fracBits);
+		const __m256i texMask = _mm256_set1_epi32(s32(mask));
+		const __m256i step = _mm256_set1_epi32(s32(dv * 8));
+		__m256i v = span_ramp_AVX2(v0, dv);
+
+		alignas(32) u32 texel[8];
+		u8* dst = out + (count - 1) * stride;
+		s32 i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_store_si256((__m256i*)texel, _mm256_and_si256(_mm256_srl_epi32(v, shift), texMask));
+			v = _mm256_add_epi32(v, step);
+
+			for (s32 j = 0; j < 8; j++, dst -= stride)
+			{
+				span_writePixel<lit, trans>(dst, tex[texel[j]], light);
+			}
+		}
+		if (i < count)
+		{
+			span_column_Scalar<lit, trans>(out, stride, count - i, tex, light, v0 + dv * u32(i), dv, mask, fracBits);
+		}
+	}
+
+	template<bool lit, bool trans>
+	SPAN_TARGET_AVX2 void span_scanline_AVX2(u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, u32 u0, u32 v0, u32 dUdX, u32 dVdX, s32 fracBits)
+	{
+		const __m128i shift = _mm_cvtsi32_si128(fracBits);
+		const __m256i mask63 = _mm256_set1_epi32(63);
+		const __m256i endMask = _mm256_set1_epi32(s32(dataEnd));
+		const __m256i stepU = _mm256_set1_epi32(s32(dUdX * 8));
+		const __m256i stepV = _mm256_set1_epi32(s32(dVdX * 8));
+		__m256i u = span_ramp_AVX2(u0, dUdX);
+		__m256i v = span_ramp_AVX2(v0, dVdX);
+
+		alignas(32) u32 texel[16];
+		s32 i = width - 1;
+		for (; i >= 15; i -= 16)
+		{
+			_mm256_store_si256((__m256i*)&texel[0], span_texel_AVX2(u, v, shift, mask63, endMask));
+			u = _mm256_add_epi32(u, stepU);
+			v = _mm256_add_epi32(v, stepV);
+			_mm256_store_si256((__m256i*)&texel[8], span_texel_AVX2(u, v, shift, mask63, endMask));
+			u = _mm256_add_epi32(u, stepU);
+			v = _mm256_add_epi32(v, stepV);
+
+			span_write8<lit, trans>(&out[i - 7], &texel[0], tex, light);
+			span_write8<lit, trans>(&out[i - 15], &texel[8], tex, light);
+		}
+		if (i >= 0)
+		{
+			const u32 step = u32(width - 1 - i);
+			span_scanline_Scalar<lit, trans>(out, i + 1, tex, dataEnd, light, u0 + dUdX * step, v0 + dVdX * step, dUdX, dVdX, fracBits);
+		}
+	}
+
+	static const SpanColumnFunc   c_columnAVX2[SPAN_FUNC_COUNT]   = SPAN_FUNC_TABLE(span_column_AVX2);
+	static const SpanScanlineFunc c_scanlineAVX2[SPAN_FUNC_COUNT] = SPAN_FUNC_TABLE(span_scanline_AVX2);
+#endif
+
+#if SPAN_NEON
+	/////////////////////////////////////////////
+	// NEON
+	/////////////////////////////////////////////
+	// Note: NEON only has a left shift by register, so 'shift' is negative.
+	inline uint32x4_t span_texel_NEON(uint32x4_t u, uint32x4_t v, int32x4_t shift, uint32x4_t mask63, uint32x4_t dataEnd)
+	{
+		const uint32x4_t tu = vshlq_n_u32(vandq_u32(vshlq_u32(u, shift), mask63), 6);
+		const uint32x4_t tv = vandq_u32(vshlq_u32(v, shift), mask63);
+		return vandq_u32(vorrq_u32(tu, tv), dataEnd);
+	}
+
+	inline uint32x4_t span_ramp_NEON(u32 x0, u32 dx)
+	{
+		const u32 ramp[4] = { x0, x0 + dx, x0 + dx * 2, x0 + dx * 3 };
+		return vld1q_u32(ramp);
+	}
+
+	template<bool lit, bool trans>
+	void span_column_NEON(u8* out, s32 stride, s32 count, const u8* tex, const u8* light, u32 v0, u32 dv, u32 mask, s32 fracBits)
+	{
+		const int32x4_t shift = vdupq_n_s32(-fracBits);
+		const uint32x4_t texMask = vdupq_n_u32(mask);
+		const uint32x4_t step = vdupq_n_u32(dv * 4);
+		uint32x4_t v = span_ramp_NEON(v0, dv);
+
+		u32 texel[4];
+		u8* dst = out + (count - 1) * stride;
+		s32 i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			vst1q_u32(texel, vandq_u32(vshlq_u32(v, shift), texMask));
+			v = vaddq_u32(v, step);
+
+			span_writePixel<lit, trans>(dst, tex[texel[0]], light); dst -= stride;
+			span_writePixel<lit, trans>(dst, tex[texel[1]], light); dst -= stride;
+			span_writePixel<lit, trans>(dst, tex[texel[2]], light); dst -= stride;
+			span_writePixel<lit, trans>(dst, tex[texel[3]], light); dst -= stride;
+		}
+		if (i < count)
+		{
+			span_column_Scalar<lit, trans>(out, stride, count - i, tex, light, v0 + dv * u32(i), dv, mask, fracBits);
+		}
+	}
+
+	template<bool lit, bool trans>
+	void span_scanline_NEON(u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, u32 u0, u32 v0, u32 dUdX, u32 dVdX, s32 fracBits)
+	{
+		const int32x4_t shift = vdupq_n_s32(-fracBits);
+		const uint32x4_t mask63 = vdupq_n_u32(63);
+		const uint32x4_t endMask = vdupq_n_u32(dataEnd);
+		const uint32x4_t stepU = vdupq_n_u32(dUdX * 4);
+		const uint32x4_t stepV = vdupq_n_u32(dVdX * 4);
+		uint32x4_t u = span_ramp_NEON(u0, dUdX);
+		uint32x4_t v = span_ramp_NEON(v0, dVdX);
+
+		u32 texel[8];
+		s32 i = width - 1;
+		for (; i >= 7; i -= 8)
+		{
+			vst1q_u32(&texel[0], span_texel_NEON(u, v, shift, mask63, endMask));
+			u = vaddq_u32(u, stepU);
+			v = vaddq_u32(v, stepV);
+			vst1q_u32(&texel[4], span_texel_NEON(u, v, shift, mask63, endMask));
+			u = vaddq_u32(u, stepU);
+			v = vaddq_u32(v, stepV);
+
+			span_write8<lit, trans>(&out[i - 7], texel, tex, light);
+		}
+		if (i >= 0)
+		{
+			const u32 step = u32(width - 1 - i);
+			span_scanline_Scalar<lit, trans>(out, i + 1, tex, dataEnd, light, u0 + dUdX * step, v0 + dVdX * step, dUdX, dVdX, fracBits);
+		}
+	}
+
+	static const SpanColumnFunc   c_columnNEON[SPAN_FUNC_COUNT]   = SPAN_FUNC_TABLE(span_column_NEON);
+	static const SpanScanlineFunc c_scanlineNEON[SPAN_FUNC_COUNT] = SPAN_FUNC_TABLE(span_scanline_NEON);
+#endif
+
+	static SpanSimd s_simd = SPAN_SIMD_SCALAR;
+	static const SpanColumnFunc*   s_columnFunc   = c_columnScalar;
+	static const SpanScanlineFunc* s_scanlineFunc = c_scanlineScalar;
+
+	/////////////////////////////////////////////
+	// API
+	/////////////////////////////////////////////
+	void span_init()
+	{
+		SpanSimd simd = SPAN_SIMD_SCALAR;
+	#if SPAN_X86
+		if (SDL_HasAVX2())
+		{
+			simd = SPAN_SIMD_AVX2;
+		}
+		else if (SDL_HasSSE2())
+		{
+			simd = SPAN_SIMD_SSE2;
+		}
+	#elif SPAN_NEON
+		simd = SPAN_SIMD_NEON;
+	#endif
+		span_setSimd(simd);
+		TFE_System::logWrite(LOG_MSG, "Renderer", "Software span functions: %s", c_spanSimdNames[s_simd]);
+	}
+
+	bool span_setSimd(SpanSimd simd)
+	{
+		switch (simd)
+		{
+			case SPAN_SIMD_SCALAR:
+			{
+				s_columnFunc = c_columnScalar;
+				s_scanlineFunc = c_scanlineScalar;
+			} break;
+		#if SPAN_X86
+			case SPAN_SIMD_SSE2:
+			{
+				if (!SDL_HasSSE2()) { return false; }
+				s_columnFunc = c_columnSSE2;
+				s_scanlineFunc = c_scanlineSSE2;
+			} break;
+			case SPAN_SIMD_AVX2:
+			{
+				if (!SDL_HasAVX2()) { return false; }
+				s_columnFunc = c_columnAVX2;
+				s_scanlineFunc = c_scanlineAVX2;
+			} break;
+		#endif
+		#if SPAN_NEON
+			case SPAN_SIMD_NEON:
+			{
+				s_columnFunc = c_columnNEON;
+				s_scanlineFunc = c_scanlineNEON;
+			} break;
+		#endif
+			default:
+				return false;
+		}
+		s_simd = simd;
+		return true;
+	}
+
+	SpanSimd span_getSimd()
+	{
+		return s_simd;
+	}
+
+	const char* span_getSimdName(SpanSimd simd)
+	{
+		return (simd >= SPAN_SIMD_SCALAR && simd < SPAN_SIMD_COUNT) ? c_spanSimdNames[simd] : "Invalid";
+	}
+
+	void span_drawColumn(SpanFunc func, u8* out, s32 stride, s32 count, const u8* tex, const u8* light, s64 v0, s64 dv, u32 mask, s32 fracBits)
+	{
+		if (count <= 0) { return; }
+		// Sprites in RClassic_Float use a 16-bit mask, so the texel bits do not fit in the low 32 bits.
+		if ((u64(mask) << fracBits) > 0xffffffffull)
+		{
+			static const decltype(&span_column_Scalar64<false, false>) c_column64[SPAN_FUNC_COUNT] = SPAN_FUNC_TABLE(span_column_Scalar64);
+			c_column64[func](out, stride, count, tex, light, v0, dv, mask, fracBits);
+			return;
+		}
+		s_columnFunc[func](out, stride, count, tex, light, u32(v0), u32(dv), mask, fracBits);
+	}
+
+	void span_drawScanline(SpanFunc func, u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, s64 u0, s64 v0, s64 dUdX, s64 dVdX, s32 fracBits)
+	{
+		if (width <= 0) { return; }
+		assert(fracBits <= 26);
+		s_scanlineFunc[func](out, width, tex, dataEnd, light, u32(u0), u32(v0), u32(dUdX), u32(dVdX), fracBits);
+	}
+}
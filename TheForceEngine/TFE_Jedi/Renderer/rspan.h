@@ -0,0 +1,53 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Span
+// Added for TFE: Shared inner loops for the classic software
+// renderers - texture mapped columns (walls, sprites) and scanlines
+// (floors, ceilings).
+//
+// The loops are selected at runtime based on the CPU (scalar, SSE2,
+// AVX2 or NEON). The SIMD versions compute texel addresses for
+// multiple pixels at once but produce the exact same output as the
+// scalar loops.
+//
+// Texture coordinates are passed as fixed point values with
+// 'fracBits' fractional bits (16 for RClassic_Fixed, 20 for
+// RClassic_Float). Coordinates are stepped once per pixel starting
+// from the last pixel, matching the original DOS loops.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+
+namespace TFE_Jedi
+{
+	enum SpanFunc
+	{
+		SPAN_FULLBRIGHT = 0,
+		SPAN_LIT,
+		SPAN_FULLBRIGHT_TRANS,
+		SPAN_LIT_TRANS,
+		SPAN_FUNC_COUNT
+	};
+
+	enum SpanSimd
+	{
+		SPAN_SIMD_SCALAR = 0,
+		SPAN_SIMD_SSE2,
+		SPAN_SIMD_AVX2,
+		SPAN_SIMD_NEON,
+		SPAN_SIMD_COUNT
+	};
+
+	// Select the best implementation supported by the CPU.
+	void span_init();
+	// Force a specific implementation, returns false if it is not supported.
+	bool span_setSimd(SpanSimd simd);
+	SpanSimd span_getSimd();
+	const char* span_getSimdName(SpanSimd simd);
+
+	// Draws 'count' pixels, starting from the bottom: out[(count - 1) * stride] uses 'v0', the next pixel up uses 'v0 + dv', etc.
+	// texel = tex[(v >> fracBits) & mask]
+	void span_drawColumn(SpanFunc func, u8* out, s32 stride, s32 count, const u8* tex, const u8* light, s64 v0, s64 dv, u32 mask, s32 fracBits);
+	// Draws 'width' pixels, starting from the right: out[width - 1] uses (u0, v0), out[width - 2] uses (u0 + dUdX, v0 + dVdX), etc.
+	// texel = tex[((((u >> fracBits) & 63) << 6) + ((v >> fracBits) & 63)) & dataEnd]
+	void span_drawScanline(SpanFunc func, u8* out, s32 width, const u8* tex, u32 dataEnd, const u8* light, s64 u0, s64 v0, s64 dUdX, s64 dVdX, s32 fracBits);
+}
@@ -96,7 +96,9 @@ namespace TFE_Jedi
 
 	void createRootTask()
 	{
+		TFE_ALLOC_SITE();
 		s_tasks = createChunkedArray(sizeof(Task), TASK_CHUNK_SIZE, TASK_PREALLOCATED_CHUNKS, s_gameRegion);
+		TFE_ALLOC_SITE();
 		s_stackBlocks = createChunkedArray(TASK_STACK_SIZE, TASK_STACK_CHUNK_SIZE, TASK_PREALLOCATED_CHUNKS, s_gameRegion);
 
 		s_rootTask = { 0 };
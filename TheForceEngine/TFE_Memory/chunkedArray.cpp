@@ -3,6 +3,7 @@
 #include "chunkedArray.h"
 #include <TFE_System/system.h>
 #include <TFE_Memory/memoryRegion.h>
+#include <TFE_Memory/memoryTracker.h>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,6 +29,7 @@ struct ChunkedArray
 	u8** chunks;
 	u8** freeSlots;
 	MemoryRegion* region;
+	u32 trackSite;		// not serialized.
 };
 
 namespace TFE_Memory
@@ -38,6 +40,18 @@ namespace TFE_Memory
 	};
 	void addFreeSlot(ChunkedArray* arr, u8* ptr);
 
+	// Elements are attributed to the site that created the array (see TFE_ALLOC_SITE()), the chunks themselves are attributed to the region.
+	u32 getTrackSite(u32 elemSize, MemoryRegion* region)
+	{
+	#if TFE_MEMORY_TRACKING
+		char label[64];
+		sprintf(label, "ChunkedArray %uB", elemSize);
+		return memtrack_takeSite(MEMTRACK_CHUNKED_ELEMENT, region, label);
+	#else
+		return 0;
+	#endif
+	}
+
 	void serialize(ChunkedArray* arr, FileStream* file)
 	{
 		assert(file);
@@ -65,6 +79,7 @@ namespace TFE_Memory
 
 		size_t size = size_t(&arr->chunks) - sizeof(arr);
 		file->readBuffer(arr, (u32)size);
+		arr->trackSite = getTrackSite(arr->elemSize, region);
 
 		arr->chunks = (u8**)region_realloc(region, arr->chunks, sizeof(u8*) * arr->chunkCount);
 		const u32 chunkAllocSize = arr->elemPerChunk * arr->elemSize;
@@ -93,10 +108,12 @@ namespace TFE_Memory
 
 	ChunkedArray* createChunkedArray(u32 elemSize, u32 elemPerChunk, u32 initChunkCount, MemoryRegion* region)
 	{
+		const u32 trackSite = getTrackSite(elemSize, region);
 		ChunkedArray* arr = (ChunkedArray*)region_alloc(region, sizeof(ChunkedArray));
 		memset(arr, 0, sizeof(ChunkedArray));
 		
 		arr->region = region;
+		arr->trackSite = trackSite;
 		arr->elemSize = elemSize;
 		arr->elemCount = 0;
 				
@@ -120,6 +137,9 @@ namespace TFE_Memory
 	void freeChunkedArray(ChunkedArray* arr)
 	{
 		if (!arr) { return; }
+	#if TFE_MEMORY_TRACKING
+		memtrack_freeOwner(arr);
+	#endif
 
 		for (u32 i = 0; i < arr->chunkCount; i++)
 		{
@@ -135,6 +155,9 @@ namespace TFE_Memory
 		if (arr->freeSlotCount)
 		{
 			arr->freeSlotCount--;
+		#if TFE_MEMORY_TRACKING
+			memtrack_allocElement(arr->trackSite, arr->region, arr, arr->freeSlots[arr->freeSlotCount], arr->elemSize);
+		#endif
 			return arr->freeSlots[arr->freeSlotCount];
 		}
 		s32 elementIndex = arr->elemCount;
@@ -156,7 +179,11 @@ namespace TFE_Memory
 
 		const u32 index = elementIndex - newChunkIndex*arr->elemPerChunk;
 		assert(index < arr->elemPerChunk);
-		return arr->chunks[newChunkIndex] + index*arr->elemSize;
+		u8* elem = arr->chunks[newChunkIndex] + index*arr->elemSize;
+	#if TFE_MEMORY_TRACKING
+		memtrack_allocElement(arr->trackSite, arr->region, arr, elem, arr->elemSize);
+	#endif
+		return elem;
 	}
 		
 	void freeToChunkedArray(ChunkedArray* arr, void* ptr)
@@ -183,12 +210,18 @@ namespace TFE_Memory
 		}
 #endif
 
+	#if TFE_MEMORY_TRACKING
+		memtrack_freeElement(ptr);
+	#endif
 		addFreeSlot(arr, (u8*)ptr);
 	}
 
 	void chunkedArrayClear(ChunkedArray* arr)
 	{
 		if (!arr) { return; }
+	#if TFE_MEMORY_TRACKING
+		memtrack_freeOwner(arr);
+	#endif
 
 		arr->elemCount = 0;
 		arr->freeSlotCount = 0;
@@ -1,15 +1,24 @@
 #include <cstring>
 
 #include "memoryRegion.h"
+#include "memoryTracker.h"
 #include <TFE_System/system.h>
 #include <TFE_System/memoryPool.h>
 #include <TFE_System/math.h>
+#include <TFE_System/Threads/mutex.h>
 #include <TFE_Jedi/Math/core_math.h>
 #include <assert.h>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 #include <stdlib.h>
 #include <assert.h>
 #include <algorithm>
+#include <new>
+
+#ifdef _WIN32
+#include <intrin.h>
+#endif
 
 // #define _VERIFY_MEMORY
 
@@ -33,6 +42,26 @@ enum
 	MAX_BLOCK_SIZE  = 16 * 1024 * 1024,
 	RELATIVE_NON_NULL_BIT = 1u,
 	SHARED_HEADER_SIZE = 8,	// 8 bytes are shared between RegionAllocHeader{} and AllocHeaderFree{}
+	BLOCK_MASK_WORDS = MAX_BLOCK_COUNT / 64,
+	// Arena mode.
+	SLAB_SIZE = 16 * 1024,		// Size of the object area of each slab.
+	SLAB_CLASS_COUNT = 20,		// See c_slabClassSize[] below.
+	SLAB_MAX_OBJECT = 512,		// Larger allocations go directly to the blocks.
+	SLAB_ADOPT_SCAN = 16,		// Maximum number of detached slabs checked when looking for one to reuse.
+	THREAD_CACHE_COUNT = 8,		// Number of arena regions that each thread can cache slabs for.
+	HEADER_FLAG_SLAB = 1,		// Stored in RegionAllocHeader::pad8[0] for allocations that hold a slab.
+};
+
+// Magic values stored in the SmallAllocHeader, these are used to tell small and large allocations apart.
+static const u32 c_smallAllocMagic = 0x534c4241;	// 'ABLS'
+static const u32 c_smallFreeMagic  = 0x534c4246;	// 'FBLS'
+// Object sizes of each slab size class, excluding the SmallAllocHeader.
+static const u32 c_slabClassSize[SLAB_CLASS_COUNT] =
+{
+	8, 16, 24, 32, 40, 48, 56, 64,	// 8 byte steps
+	80, 96, 112, 128,				// 16 byte steps
+	160, 192, 224, 256,				// 32 byte steps
+	320, 384, 448, 512,				// 64 byte steps
 };
 
 struct RegionAllocHeader
@@ -60,6 +89,8 @@ struct MemoryBlock
 {
 	u32 sizeFree;
 	u32 count;
+	u32 index;
+	u32 pad;
 	// Head pointer to each bin.
 	// Bin index = clamp(log2(nextPow2(size)) - 5, 0, 5)
 	// bin 0: [0,  32]
@@ -71,6 +102,29 @@ struct MemoryBlock
 	AllocHeaderFree* freeListBins[ALLOC_BIN_COUNT];
 };
 
+// Arena mode: a slab holds objects of a single size class, and is stored inside of a regular allocation so
+// that relative pointers and serialization work the same way as with any other allocation.
+// Free lists are stored as offsets from the start of the slab so they remain valid when restored.
+struct RegionSlab
+{
+	u32 sizeClass;
+	u32 stride;				// Object size including the SmallAllocHeader.
+	u32 capacity;
+	u32 bumpOffset;			// Offset of the first object that has never been allocated.
+	u32 localFree;			// Free list only used by the owning thread.
+	atomic_u32 remoteFree;	// Free list pushed to by other threads, taken as a whole by the owner.
+	atomic_u32 owner;		// Id of the thread that allocates from this slab, 0 if detached.
+	u32 pad;
+	RegionSlab* nextDetached;
+};
+
+// Placed directly before each slab allocation. For regular allocations the same 8 bytes are RegionAllocHeader::pad which is always 0.
+struct SmallAllocHeader
+{
+	u32 slabOffset;
+	u32 magic;
+};
+
 struct MemoryRegion
 {
 	char name[32];
@@ -80,10 +134,39 @@ struct MemoryRegion
 	size_t blockCount;
 	size_t blockSize;
 	size_t maxBlocks;
+
+	// Bit 'b' of freeBinMask[bin] is set if block 'b' has at least one entry in that free list bin.
+	u64 freeBinMask[ALLOC_BIN_COUNT][BLOCK_MASK_WORDS];
+
+	// Arena mode.
+	RegionMode mode;
+	Mutex* mutex;
+	u32 epoch;		// Changes whenever all slabs are discarded, so thread caches know to reset.
+	RegionSlab* detachedHead[SLAB_CLASS_COUNT];
+	RegionSlab* detachedTail[SLAB_CLASS_COUNT];
+};
+
+// Per-thread slab cache for an arena region.
+struct ThreadSlabCache
+{
+	MemoryRegion* region;
+	u32 epoch;
+	RegionSlab* active[SLAB_CLASS_COUNT];
+};
+
+// The slab caches of a thread, which are given back to their regions when the thread exits.
+struct ThreadSlabCacheSet
+{
+	ThreadSlabCache entries[THREAD_CACHE_COUNT];
+	u32 next;
+
+	~ThreadSlabCacheSet();
 };
 
 static_assert(sizeof(RegionAllocHeader) == 16, "RegionAllocHeader is the wrong size.");
 static_assert(sizeof(AllocHeaderFree) == 24, "AllocHeaderFree is the wrong size.");
+static_assert(sizeof(SmallAllocHeader) == 8, "SmallAllocHeader is the wrong size.");
+static_assert((sizeof(RegionSlab) & 7) == 0, "RegionSlab must keep the objects aligned.");
 
 namespace TFE_Memory
 {
@@ -92,12 +175,34 @@ namespace TFE_Memory
 	static const u32 c_relativeBlockShift = 24u;
 	static const u32 c_relativeOffsetMask = (1u << c_relativeBlockShift) - 1u;
 
-	void freeSlot(RegionAllocHeader* alloc, RegionAllocHeader* next, MemoryBlock* block);
+	static atomic_u32 s_nextThreadId(1);
+	static atomic_u32 s_nextEpoch(1);
+	static thread_local u32 s_threadId = 0;
+	static thread_local ThreadSlabCacheSet s_threadCaches;
+	// Live arena regions, so thread caches never touch a region that has been destroyed.
+	static std::vector<MemoryRegion*> s_arenaRegions;
+	static atomic_bool s_arenaRegionsLock(false);
+
+	void freeSlot(MemoryRegion* region, RegionAllocHeader* alloc, RegionAllocHeader* next, MemoryBlock* block);
 	size_t alloc_align(size_t baseSize);
 	s32  getBinFromSize(u32 size);
 	bool allocateNewBlock(MemoryRegion* region);
-	void removeHeaderFromFreelist(MemoryBlock* block, RegionAllocHeader* header);
-	void insertBlockIntoFreelist(MemoryBlock* block, RegionAllocHeader* header);
+	void removeHeaderFromFreelist(MemoryRegion* region, MemoryBlock* block, RegionAllocHeader* header);
+	void insertBlockIntoFreelist(MemoryRegion* region, MemoryBlock* block, RegionAllocHeader* header);
+	void* region_allocInternal(MemoryRegion* region, size_t size);
+	void* region_reallocInternal(MemoryRegion* region, void* ptr, size_t size);
+	void  region_freeInternal(MemoryRegion* region, void* ptr);
+	void* region_allocUntracked(MemoryRegion* region, size_t size);
+	void* region_reallocUntracked(MemoryRegion* region, void* ptr, size_t size);
+	void  region_freeUntracked(MemoryRegion* region, void* ptr);
+	void* slab_alloc(MemoryRegion* region, size_t size);
+	void* slab_realloc(MemoryRegion* region, void* ptr, size_t size);
+	void  slab_free(SmallAllocHeader* header);
+	void  slab_resetRegion(MemoryRegion* region);
+	void  slab_restoreRegion(MemoryRegion* region);
+	void  slab_releaseCache(ThreadSlabCache* cache);
+	void  slab_removeArena(MemoryRegion* region);
+	void  region_setMode(MemoryRegion* region, RegionMode mode);
 
 	void verifyMemory(MemoryRegion* region)
 	{
@@ -132,7 +237,7 @@ namespace TFE_Memory
 		}
 	}
 
-	MemoryRegion* region_create(const char* name, size_t blockSize, size_t maxSize)
+	MemoryRegion* region_create(const char* name, size_t blockSize, size_t maxSize, RegionMode mode)
 	{
 		assert(name);
 		if (!name || !blockSize) { return nullptr; }
@@ -155,13 +260,24 @@ namespace TFE_Memory
 		region->blockCount = 0;
 		region->blockSize = blockSize;
 		region->maxBlocks = maxSize ? (maxSize + blockSize - 1) / blockSize : 0;
+		memset(region->freeBinMask, 0, sizeof(region->freeBinMask));
+		region->mode = REGION_MODE_DEFAULT;
+		region->mutex = nullptr;
+		region_setMode(region, mode);
+		slab_resetRegion(region);
 		if (!allocateNewBlock(region))
 		{
+			slab_removeArena(region);
+			delete region->mutex;
+			free(region->memBlocks);
 			free(region);
 			TFE_System::logWrite(LOG_ERROR, "MemoryRegion", "Failed to memory block of size %u in region '%s'.", blockSize, name);
 			return nullptr;
 		}
 		VERIFY_MEMORY();
+	#if TFE_MEMORY_TRACKING
+		memtrack_addRegion(region, region->name);
+	#endif
 
 		return region;
 	}
@@ -169,6 +285,10 @@ namespace TFE_Memory
 	void region_clear(MemoryRegion* region)
 	{
 		assert(region);
+	#if TFE_MEMORY_TRACKING
+		memtrack_clearRegion(region);
+	#endif
+		memset(region->freeBinMask, 0, sizeof(region->freeBinMask));
 		for (s32 i = 0; i < region->blockCount; i++)
 		{
 			MemoryBlock* block = region->memBlocks[i];
@@ -179,23 +299,34 @@ namespace TFE_Memory
 			header->size = block->sizeFree;
 			header->free = 0;
 			memset(block->freeListBins, 0, sizeof(AllocHeaderFree*)*ALLOC_BIN_COUNT);
-			insertBlockIntoFreelist(block, header);
+			insertBlockIntoFreelist(region, block, header);
 			VERIFY_MEMORY();
 		}
+		slab_resetRegion(region);
 	}
 
 	void region_destroy(MemoryRegion* region)
 	{
 		assert(region);
+	#if TFE_MEMORY_TRACKING
+		memtrack_removeRegion(region);
+	#endif
+		slab_removeArena(region);
 		for (s32 i = 0; i < region->blockCount; i++)
 		{
 			free(region->memBlocks[i]);
 		}
+		delete region->mutex;
 		free(region->memBlocks);
 		free(region);
 	}
+
+	RegionMode region_getMode(MemoryRegion* region)
+	{
+		return region->mode;
+	}
 		
-	void* allocFromHeader(MemoryBlock* block, RegionAllocHeader* header, u32 size)
+	void* allocFromHeader(MemoryRegion* region, MemoryBlock* block, RegionAllocHeader* header, u32 size)
 	{
 		assert(header->free == 1);
 		if (header->size - size >= MIN_SPLIT_SIZE)
@@ -206,7 +337,7 @@ namespace TFE_Memory
 			RegionAllocHeader* next = (RegionAllocHeader*)((u8*)header + split0);
 
 			// Cleanup the free list.
-			removeHeaderFromFreelist(block, header);
+			removeHeaderFromFreelist(region, block, header);
 			header->size = u32(split0);
 
 			// Create a new free block.
@@ -215,49 +346,97 @@ namespace TFE_Memory
 			block->count++;
 						
 			// Add the new block to the free list.
-			insertBlockIntoFreelist(block, next);
+			insertBlockIntoFreelist(region, block, next);
 		}
 		else
 		{
 			// Consume the whole block.
-			removeHeaderFromFreelist(block, header);
+			removeHeaderFromFreelist(region, block, header);
 		}
 		block->sizeFree -= header->size;
+		// Arena mode relies on this being 0 to tell regular allocations from slab allocations.
+		header->pad = 0;
 		return (u8*)header + sizeof(RegionAllocHeader);
 	}
 
+	// Blocks are allocated separately, so their addresses are in no particular order.
+	inline bool blockContains(MemoryRegion* region, MemoryBlock* block, void* ptr)
+	{
+		return (u8*)ptr > (u8*)block && (u8*)ptr < (u8*)block + sizeof(MemoryBlock) + region->blockSize;
+	}
+
+	inline s32 findFirstBit(u64 bits)
+	{
+	#ifdef _WIN32
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return s32(index);
+	#else
+		return __builtin_ctzll(bits);
+	#endif
+	}
+
 	void* region_alloc(MemoryRegion* region, size_t size)
+	{
+		void* mem = region_allocUntracked(region, size);
+	#if TFE_MEMORY_TRACKING
+		memtrack_alloc(region, mem, size);
+	#endif
+		return mem;
+	}
+
+	void* region_allocUntracked(MemoryRegion* region, size_t size)
 	{
 		assert(region);
 		if (size == 0) { return nullptr; }
+		if (region->mode == REGION_MODE_ARENA)
+		{
+			void* mem = (size <= SLAB_MAX_OBJECT) ? slab_alloc(region, size) : nullptr;
+			if (!mem)
+			{
+				region->mutex->lock();
+				mem = region_allocInternal(region, size);
+				region->mutex->unlock();
+			}
+			return mem;
+		}
+		return region_allocInternal(region, size);
+	}
 
+	void* region_allocInternal(MemoryRegion* region, size_t size)
+	{
 		size = alloc_align(size + sizeof(RegionAllocHeader));
 		assert(size >= 24);	// at least 24 bytes is required to hold the free header.
 		if (size > region->blockSize) { return nullptr; }
-		
-		for (s32 i = 0; i < region->blockCount; i++)
-		{
-			MemoryBlock* block = region->memBlocks[i];
-			if (block->sizeFree < size)
-			{
-				continue;
-			}
 
-			// Try to allocate from the closest matching bin.
-			s32 bin = getBinFromSize((u32)size);
-			for (s32 b = bin; b < ALLOC_BIN_COUNT; b++)
+		// Try to allocate from the closest matching bin, the bin masks avoid visiting blocks that have no free slots in that bin.
+		s32 bin = getBinFromSize((u32)size);
+		for (s32 b = bin; b < ALLOC_BIN_COUNT; b++)
+		{
+			for (s32 w = 0; w < BLOCK_MASK_WORDS; w++)
 			{
-				AllocHeaderFree* header = block->freeListBins[b];
-				while (header)
+				u64 bits = region->freeBinMask[b][w];
+				while (bits)
 				{
-					if (header->size >= size)
+					MemoryBlock* block = region->memBlocks[w * 64 + findFirstBit(bits)];
+					bits &= bits - 1;
+					if (block->sizeFree < size)
+					{
+						continue;
+					}
+
+					AllocHeaderFree* header = block->freeListBins[b];
+					while (header)
 					{
-						VERIFY_MEMORY();
-						void* mem = allocFromHeader(block, (RegionAllocHeader*)header, (u32)size);
-						VERIFY_MEMORY();
-						return mem;
+						if (header->size >= size)
+						{
+							VERIFY_MEMORY();
+							void* mem = allocFromHeader(region, block, (RegionAllocHeader*)header, (u32)size);
+							VERIFY_MEMORY();
+							return mem;
+						}
+						header = header->binNext;
 					}
-					header = header->binNext;
 				}
 			}
 		}
@@ -267,7 +446,7 @@ namespace TFE_Memory
 			if (allocateNewBlock(region))
 			{
 				VERIFY_MEMORY();
-				void* mem = region_alloc(region, size);
+				void* mem = region_allocInternal(region, size);
 				VERIFY_MEMORY();
 				return mem;
 			}
@@ -280,10 +459,35 @@ namespace TFE_Memory
 
 	void* region_realloc(MemoryRegion* region, void* ptr, size_t size)
 	{
-		assert(region);
 		if (!ptr) { return region_alloc(region, size); }
+		void* mem = region_reallocUntracked(region, ptr, size);
+	#if TFE_MEMORY_TRACKING
+		memtrack_realloc(region, ptr, mem, size);
+	#endif
+		return mem;
+	}
+
+	void* region_reallocUntracked(MemoryRegion* region, void* ptr, size_t size)
+	{
+		assert(region);
 		if (size == 0) { return nullptr; }
+		if (region->mode == REGION_MODE_ARENA)
+		{
+			const SmallAllocHeader* small = (SmallAllocHeader*)((u8*)ptr - sizeof(SmallAllocHeader));
+			if (small->magic == c_smallAllocMagic)
+			{
+				return slab_realloc(region, ptr, size);
+			}
+			region->mutex->lock();
+			void* mem = region_reallocInternal(region, ptr, size);
+			region->mutex->unlock();
+			return mem;
+		}
+		return region_reallocInternal(region, ptr, size);
+	}
 
+	void* region_reallocInternal(MemoryRegion* region, void* ptr, size_t size)
+	{
 		size = alloc_align(size + sizeof(RegionAllocHeader));
 		if (size > region->blockSize) { return nullptr; }
 
@@ -299,7 +503,7 @@ namespace TFE_Memory
 		for (s32 i = (s32)region->blockCount - 1; i >= 0; i--)
 		{
 			MemoryBlock* block = region->memBlocks[i];
-			if (ptr >= block)
+			if (blockContains(region, block, ptr))
 			{
 				RegionAllocHeader* header = (RegionAllocHeader*)((u8*)ptr - sizeof(RegionAllocHeader));
 				RegionAllocHeader* nextHeader = (RegionAllocHeader*)((u8*)header + header->size);
@@ -320,7 +524,7 @@ namespace TFE_Memory
 					VERIFY_MEMORY();
 					// Remove the nextHeader from the freelist.
 					assert(nextHeader->free == 1);
-					removeHeaderFromFreelist(block, nextHeader);
+					removeHeaderFromFreelist(region, block, nextHeader);
 
 					// Merge blocks.
 					block->sizeFree += header->size;
@@ -345,7 +549,7 @@ namespace TFE_Memory
 						block->count++;
 
 						// Add the new block to the free list.
-						insertBlockIntoFreelist(block, next);
+						insertBlockIntoFreelist(region, block, next);
 					}
 					block->sizeFree -= header->size;
 					VERIFY_MEMORY();
@@ -358,7 +562,7 @@ namespace TFE_Memory
 		}
 
 		// Allocate a new block of memory.
-		void* newMem = region_alloc(region, size);
+		void* newMem = region_allocInternal(region, size);
 		if (!newMem) { return nullptr; }
 		// Copy over the contents from the previous block.
 		if (prevSize > sizeof(RegionAllocHeader))
@@ -366,7 +570,7 @@ namespace TFE_Memory
 			memcpy(newMem, ptr, std::min((u32)size, prevSize) - sizeof(RegionAllocHeader));
 		}
 		// Free the previous block
-		region_free(region, ptr);
+		region_freeInternal(region, ptr);
 		// Then return the new block.
 		VERIFY_MEMORY();
 		return newMem;
@@ -375,11 +579,41 @@ namespace TFE_Memory
 	void region_free(MemoryRegion* region, void* ptr)
 	{
 		if (!ptr || !region) { return; }
+	#if TFE_MEMORY_TRACKING
+		memtrack_free(ptr);
+	#endif
+		region_freeUntracked(region, ptr);
+	}
 
+	void region_freeUntracked(MemoryRegion* region, void* ptr)
+	{
+		if (region->mode == REGION_MODE_ARENA)
+		{
+			SmallAllocHeader* small = (SmallAllocHeader*)((u8*)ptr - sizeof(SmallAllocHeader));
+			if (small->magic == c_smallAllocMagic)
+			{
+				slab_free(small);
+				return;
+			}
+			else if (small->magic == c_smallFreeMagic)
+			{
+				TFE_System::logWrite(LOG_ERROR, "MemoryRegion", "Attempted to double free pointer %x in region '%s'.", ptr, region->name);
+				return;
+			}
+			region->mutex->lock();
+			region_freeInternal(region, ptr);
+			region->mutex->unlock();
+			return;
+		}
+		region_freeInternal(region, ptr);
+	}
+
+	void region_freeInternal(MemoryRegion* region, void* ptr)
+	{
 		for (s32 i = (s32)region->blockCount - 1; i >= 0; i--)
 		{
 			MemoryBlock* block = region->memBlocks[i];
-			if (ptr >= block)
+			if (blockContains(region, block, ptr))
 			{
 				RegionAllocHeader* header = (RegionAllocHeader*)((u8*)ptr - sizeof(RegionAllocHeader));
 				RegionAllocHeader* nextHeader = (RegionAllocHeader*)((u8*)header + header->size);
@@ -396,7 +630,7 @@ namespace TFE_Memory
 				}
 
 				VERIFY_MEMORY();
-				freeSlot(header, nextHeader, block);
+				freeSlot(region, header, nextHeader, block);
 				VERIFY_MEMORY();
 				return;
 			}
@@ -423,6 +657,29 @@ namespace TFE_Memory
 	{
 		return region->blockCount * region->blockSize;
 	}
+
+	void region_getBlockFreeInfo(MemoryRegion* region, u32 blockIndex, size_t* freeBytes, size_t* largestFree)
+	{
+		*freeBytes = 0;
+		*largestFree = 0;
+		if (blockIndex >= region->blockCount) { return; }
+
+		if (region->mode == REGION_MODE_ARENA) { region->mutex->lock(); }
+		const MemoryBlock* block = region->memBlocks[blockIndex];
+		*freeBytes = block->sizeFree;
+		// Slots are sorted into bins by size, so only the highest non-empty bin needs to be searched.
+		for (s32 bin = ALLOC_BIN_LAST; bin >= 0; bin--)
+		{
+			const AllocHeaderFree* slot = block->freeListBins[bin];
+			if (!slot) { continue; }
+			for (; slot; slot = slot->binNext)
+			{
+				*largestFree = std::max(*largestFree, size_t(slot->size));
+			}
+			break;
+		}
+		if (region->mode == REGION_MODE_ARENA) { region->mutex->unlock(); }
+	}
 		
 	RelativePointer region_getRelativePointer(MemoryRegion* region, void* ptr)
 	{
@@ -432,7 +689,7 @@ namespace TFE_Memory
 		for (s32 i = (s32)region->blockCount - 1; i >= 0; i--)
 		{
 			MemoryBlock* block = region->memBlocks[i];
-			if (ptr >= block)
+			if (blockContains(region, block, ptr))
 			{
 				rp = RelativePointer((u8*)ptr - (u8*)block - sizeof(MemoryBlock));
 				rp |= (i << c_relativeBlockShift);
@@ -526,8 +783,20 @@ namespace TFE_Memory
 		if (!region)
 		{
 			region = (MemoryRegion*)malloc(sizeof(MemoryRegion));
-			region->blockArrCapacity = 0;
+			if (region)
+			{
+				region->blockArrCapacity = 0;
+				region->mode = REGION_MODE_DEFAULT;
+				region->mutex = nullptr;
+			}
+		}
+	#if TFE_MEMORY_TRACKING
+		else
+		{
+			// The restored allocations replace whatever was in the region.
+			memtrack_clearRegion(region);
 		}
+	#endif
 		if (!region)
 		{
 			TFE_System::logWrite(LOG_ERROR, "MemoryRegion", "Failed to allocate region.");
@@ -591,6 +860,7 @@ namespace TFE_Memory
 			TFE_System::logWrite(LOG_ERROR, "MemoryRegion", "Failed to allocate region.");
 			return nullptr;
 		}
+		memset(region->freeBinMask, 0, sizeof(region->freeBinMask));
 		
 		for (s32 b = 0; b < region->blockCount; b++)
 		{
@@ -608,6 +878,7 @@ namespace TFE_Memory
 				return nullptr;
 			}
 
+			block->index = u32(b);
 			file->read(&block->count);
 			file->read(&block->sizeFree);
 			for (s32 bin = 0; bin < ALLOC_BIN_COUNT; bin++)
@@ -615,6 +886,10 @@ namespace TFE_Memory
 				RelativePointer ptr;
 				file->read(&ptr);
 				block->freeListBins[bin] = (AllocHeaderFree*)region_getRealPointer(region, ptr);
+				if (block->freeListBins[bin])
+				{
+					region->freeBinMask[bin][b >> 6] |= (1ull << u64(b & 63));
+				}
 			}
 
 			u8* memPtr = (u8*)block + sizeof(MemoryBlock);
@@ -636,16 +911,25 @@ namespace TFE_Memory
 				else
 				{
 					file->readBuffer((u8*)header + SHARED_HEADER_SIZE, header->size - SHARED_HEADER_SIZE);
+					if (header->pad8[0] != HEADER_FLAG_SLAB)
+					{
+						header->pad = 0;
+					}
 				}
 
 				memPtr += header->size;
 			}
 		}
+		// Slabs only exist in arena mode, so a region that contains them has to be restored as an arena.
+		slab_restoreRegion(region);
+	#if TFE_MEMORY_TRACKING
+		memtrack_addRegion(region, region->name);
+	#endif
 
 		return region;
 	}
 
-	void freeSlot(RegionAllocHeader* alloc, RegionAllocHeader* next, MemoryBlock* block)
+	void freeSlot(MemoryRegion* region, RegionAllocHeader* alloc, RegionAllocHeader* next, MemoryBlock* block)
 	{
 		block->sizeFree += alloc->size;
 
@@ -654,14 +938,14 @@ namespace TFE_Memory
 		{
 			assert(next->free == 1);
 			// Remove the next block from the freelist.
-			removeHeaderFromFreelist(block, next);
+			removeHeaderFromFreelist(region, block, next);
 
 			// Merge
 			alloc->size += next->size;
 			block->count--;
 		}
 		// Then add the new item to the free list.
-		insertBlockIntoFreelist(block, alloc);
+		insertBlockIntoFreelist(region, block, alloc);
 	}
 
 	size_t alloc_align(size_t baseSize)
@@ -679,7 +963,7 @@ namespace TFE_Memory
 		return 5;
 	}
 
-	void removeHeaderFromFreelist(MemoryBlock* block, RegionAllocHeader* header)
+	void removeHeaderFromFreelist(MemoryRegion* region, MemoryBlock* block, RegionAllocHeader* header)
 	{
 		AllocHeaderFree* freeHeader = (AllocHeaderFree*)header;
 		assert(freeHeader->free == 1);
@@ -713,11 +997,12 @@ namespace TFE_Memory
 			if (freeHeader == block->freeListBins[bin])
 			{
 				block->freeListBins[bin] = nullptr;
+				region->freeBinMask[bin][block->index >> 6] &= ~(1ull << u64(block->index & 63));
 			}
 		}
 	}
 
-	void insertBlockIntoFreelist(MemoryBlock* block, RegionAllocHeader* header)
+	void insertBlockIntoFreelist(MemoryRegion* region, MemoryBlock* block, RegionAllocHeader* header)
 	{
 		AllocHeaderFree* freeNext = (AllocHeaderFree*)header;
 		assert(freeNext->free == 0);
@@ -731,6 +1016,7 @@ namespace TFE_Memory
 			block->freeListBins[bin] = freeNext;
 			freeNext->binPrev = nullptr;
 			freeNext->binNext = nullptr;
+			region->freeBinMask[bin][block->index >> 6] |= (1ull << u64(block->index & 63));
 		}
 		else
 		{
@@ -780,16 +1066,389 @@ namespace TFE_Memory
 		MemoryBlock* block = region->memBlocks[blockIndex];
 		block->sizeFree = u32(region->blockSize);
 		block->count = 1;
+		block->index = u32(blockIndex);
 
 		RegionAllocHeader* header = (RegionAllocHeader*)((u8*)block + sizeof(MemoryBlock));
 		header->size = block->sizeFree;
 		header->free = 0;
 		memset(block->freeListBins, 0, sizeof(AllocHeaderFree*)*ALLOC_BIN_COUNT);
-		insertBlockIntoFreelist(block, header);
+		insertBlockIntoFreelist(region, block, header);
 
 		return true;
 	}
 
+	/////////////////////////////////////////////
+	// Arena mode
+	/////////////////////////////////////////////
+	void slab_lockArenas()
+	{
+		while (s_arenaRegionsLock.exchange(true, std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void slab_unlockArenas()
+	{
+		s_arenaRegionsLock.store(false, std::memory_order_release);
+	}
+
+	void slab_removeArena(MemoryRegion* region)
+	{
+		slab_lockArenas();
+		const size_t count = s_arenaRegions.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (s_arenaRegions[i] == region)
+			{
+				s_arenaRegions[i] = s_arenaRegions.back();
+				s_arenaRegions.pop_back();
+				break;
+			}
+		}
+		slab_unlockArenas();
+	}
+
+	void region_setMode(MemoryRegion* region, RegionMode mode)
+	{
+		if (mode == REGION_MODE_ARENA && region->mode != REGION_MODE_ARENA)
+		{
+			slab_lockArenas();
+			s_arenaRegions.push_back(region);
+			slab_unlockArenas();
+		}
+		else if (mode != REGION_MODE_ARENA && region->mode == REGION_MODE_ARENA)
+		{
+			slab_removeArena(region);
+		}
+
+		if (mode == REGION_MODE_ARENA)
+		{
+			if (!region->mutex)
+			{
+				region->mutex = Mutex::create();
+			}
+			// The block array is never reallocated in arena mode, so pointer lookups do not need to lock.
+			if (region->blockArrCapacity < MAX_BLOCK_COUNT)
+			{
+				region->blockArrCapacity = MAX_BLOCK_COUNT;
+				region->memBlocks = (MemoryBlock**)realloc(region->memBlocks, sizeof(MemoryBlock*)*region->blockArrCapacity);
+			}
+		}
+		region->mode = mode;
+	}
+
+	u32 slab_getThreadId()
+	{
+		if (!s_threadId)
+		{
+			s_threadId = s_nextThreadId.fetch_add(1);
+		}
+		return s_threadId;
+	}
+
+	// O(1) mapping from the allocation size to the size class.
+	u32 slab_getSizeClass(size_t size)
+	{
+		assert(size > 0 && size <= SLAB_MAX_OBJECT);
+		if (size <= 64)  { return u32((size + 7) >> 3) - 1; }
+		if (size <= 128) { return u32((size - 64 + 15) >> 4) + 7; }
+		if (size <= 256) { return u32((size - 128 + 31) >> 5) + 11; }
+		return u32((size - 256 + 63) >> 6) + 15;
+	}
+
+	ThreadSlabCache* slab_getThreadCache(MemoryRegion* region)
+	{
+		ThreadSlabCache* cache = s_threadCaches.entries;
+		for (s32 i = 0; i < THREAD_CACHE_COUNT; i++, cache++)
+		{
+			if (cache->region == region && cache->epoch == region->epoch)
+			{
+				return cache;
+			}
+		}
+
+		// Reuse a stale entry for the region or an empty entry if possible, otherwise replace the oldest entry.
+		// Slabs owned by a replaced entry are given back to their region.
+		ThreadSlabCache* newCache = nullptr;
+		cache = s_threadCaches.entries;
+		for (s32 i = 0; i < THREAD_CACHE_COUNT && !newCache; i++, cache++)
+		{
+			if (cache->region == region) { newCache = cache; }
+		}
+		cache = s_threadCaches.entries;
+		for (s32 i = 0; i < THREAD_CACHE_COUNT && !newCache; i++, cache++)
+		{
+			if (!cache->region) { newCache = cache; }
+		}
+		if (!newCache)
+		{
+			newCache = &s_threadCaches.entries[s_threadCaches.next];
+			s_threadCaches.next = (s_threadCaches.next + 1) % THREAD_CACHE_COUNT;
+			slab_releaseCache(newCache);
+		}
+		newCache->region = region;
+		newCache->epoch = region->epoch;
+		memset(newCache->active, 0, sizeof(RegionSlab*) * SLAB_CLASS_COUNT);
+		return newCache;
+	}
+
+	// Only called by the owning thread.
+	void* slab_allocObject(RegionSlab* slab)
+	{
+		if (!slab->localFree)
+		{
+			// Take everything freed by other threads at once.
+			slab->localFree = slab->remoteFree.exchange(0, std::memory_order_acquire);
+		}
+
+		SmallAllocHeader* header;
+		if (slab->localFree)
+		{
+			header = (SmallAllocHeader*)((u8*)slab + slab->localFree);
+			slab->localFree = *(u32*)((u8*)header + sizeof(SmallAllocHeader));
+		}
+		else if (slab->bumpOffset + slab->stride <= sizeof(RegionSlab) + slab->capacity * slab->stride)
+		{
+			header = (SmallAllocHeader*)((u8*)slab + slab->bumpOffset);
+			header->slabOffset = slab->bumpOffset;
+			slab->bumpOffset += slab->stride;
+		}
+		else
+		{
+			return nullptr;
+		}
+		header->magic = c_smallAllocMagic;
+		return (u8*)header + sizeof(SmallAllocHeader);
+	}
+
+	JBool slab_canAdopt(RegionSlab* slab)
+	{
+		return slab->localFree || slab->remoteFree.load(std::memory_order_relaxed) ||
+			slab->bumpOffset + slab->stride <= sizeof(RegionSlab) + slab->capacity * slab->stride;
+	}
+
+	void slab_pushDetached(MemoryRegion* region, RegionSlab* slab)
+	{
+		const u32 sizeClass = slab->sizeClass;
+		slab->nextDetached = nullptr;
+		if (region->detachedTail[sizeClass])
+		{
+			region->detachedTail[sizeClass]->nextDetached = slab;
+		}
+		else
+		{
+			region->detachedHead[sizeClass] = slab;
+		}
+		region->detachedTail[sizeClass] = slab;
+	}
+
+	RegionSlab* slab_popDetached(MemoryRegion* region, u32 sizeClass)
+	{
+		RegionSlab* slab = region->detachedHead[sizeClass];
+		if (slab)
+		{
+			region->detachedHead[sizeClass] = slab->nextDetached;
+			if (!slab->nextDetached)
+			{
+				region->detachedTail[sizeClass] = nullptr;
+			}
+			slab->nextDetached = nullptr;
+		}
+		return slab;
+	}
+
+	// Replace the full slab 'prevSlab' (if any) with a slab that has free objects.
+	// Detached slabs are reused first, checking a bounded number and rotating them so that every slab is eventually revisited.
+	RegionSlab* slab_acquire(MemoryRegion* region, u32 sizeClass, RegionSlab* prevSlab)
+	{
+		const u32 threadId = slab_getThreadId();
+		region->mutex->lock();
+		if (prevSlab)
+		{
+			prevSlab->owner.store(0, std::memory_order_release);
+			slab_pushDetached(region, prevSlab);
+		}
+
+		RegionSlab* slab = nullptr;
+		for (s32 i = 0; i < SLAB_ADOPT_SCAN && region->detachedHead[sizeClass]; i++)
+		{
+			RegionSlab* candidate = slab_popDetached(region, sizeClass);
+			if (slab_canAdopt(candidate))
+			{
+				slab = candidate;
+				break;
+			}
+			slab_pushDetached(region, candidate);
+		}
+
+		if (!slab)
+		{
+			const u32 stride = c_slabClassSize[sizeClass] + sizeof(SmallAllocHeader);
+			const u32 capacity = SLAB_SIZE / stride;
+			slab = (RegionSlab*)region_allocInternal(region, sizeof(RegionSlab) + capacity * stride);
+			if (slab)
+			{
+				RegionAllocHeader* header = (RegionAllocHeader*)((u8*)slab - sizeof(RegionAllocHeader));
+				header->pad8[0] = HEADER_FLAG_SLAB;
+
+				new (slab) RegionSlab();
+				slab->sizeClass = sizeClass;
+				slab->stride = stride;
+				slab->capacity = capacity;
+				slab->bumpOffset = sizeof(RegionSlab);
+				slab->localFree = 0;
+				slab->remoteFree.store(0, std::memory_order_relaxed);
+				slab->pad = 0;
+				slab->nextDetached = nullptr;
+			}
+		}
+		if (slab)
+		{
+			slab->owner.store(threadId, std::memory_order_release);
+		}
+		region->mutex->unlock();
+		return slab;
+	}
+
+	void* slab_alloc(MemoryRegion* region, size_t size)
+	{
+		const u32 sizeClass = slab_getSizeClass(size);
+		ThreadSlabCache* cache = slab_getThreadCache(region);
+		RegionSlab* slab = cache->active[sizeClass];
+
+		void* mem = slab ? slab_allocObject(slab) : nullptr;
+		if (!mem)
+		{
+			slab = slab_acquire(region, sizeClass, slab);
+			cache->active[sizeClass] = slab;
+			mem = slab ? slab_allocObject(slab) : nullptr;
+		}
+		return mem;
+	}
+
+	void* slab_realloc(MemoryRegion* region, void* ptr, size_t size)
+	{
+		const SmallAllocHeader* header = (SmallAllocHeader*)((u8*)ptr - sizeof(SmallAllocHeader));
+		const RegionSlab* slab = (RegionSlab*)((u8*)header - header->slabOffset);
+		const size_t objectSize = c_slabClassSize[slab->sizeClass];
+		if (size <= objectSize)
+		{
+			return ptr;
+		}
+
+		void* newMem = region_allocUntracked(region, size);
+		if (!newMem) { return nullptr; }
+		memcpy(newMem, ptr, objectSize);
+		region_freeUntracked(region, ptr);
+		return newMem;
+	}
+
+	void slab_free(SmallAllocHeader* header)
+	{
+		RegionSlab* slab = (RegionSlab*)((u8*)header - header->slabOffset);
+		u32* next = (u32*)((u8*)header + sizeof(SmallAllocHeader));
+		header->magic = c_smallFreeMagic;
+
+		// Only the owning thread can change the owner away from itself, so this comparison is stable.
+		if (slab->owner.load(std::memory_order_acquire) == slab_getThreadId())
+		{
+			*next = slab->localFree;
+			slab->localFree = header->slabOffset;
+		}
+		else
+		{
+			// Lock-free push, the owner takes the whole list at once so there is no ABA problem.
+			u32 head = slab->remoteFree.load(std::memory_order_relaxed);
+			do
+			{
+				*next = head;
+			} while (!slab->remoteFree.compare_exchange_weak(head, header->slabOffset, std::memory_order_release, std::memory_order_relaxed));
+		}
+	}
+
+	// Detach the active slabs of 'cache' so other threads can adopt them, moving any objects freed by other threads
+	// to the local free list first.
+	void slab_releaseCache(ThreadSlabCache* cache)
+	{
+		MemoryRegion* region = cache->region;
+		if (!region) { return; }
+
+		slab_lockArenas();
+		JBool live = JFALSE;
+		const size_t count = s_arenaRegions.size();
+		for (size_t i = 0; i < count && !live; i++)
+		{
+			live = s_arenaRegions[i] == region ? JTRUE : JFALSE;
+		}
+
+		// If the epoch changed, the slabs have already been discarded.
+		if (live && cache->epoch == region->epoch)
+		{
+			region->mutex->lock();
+			for (s32 c = 0; c < SLAB_CLASS_COUNT; c++)
+			{
+				RegionSlab* slab = cache->active[c];
+				if (!slab) { continue; }
+
+				u32 offset = slab->remoteFree.exchange(0, std::memory_order_acquire);
+				while (offset)
+				{
+					u32* next = (u32*)((u8*)slab + offset + sizeof(SmallAllocHeader));
+					const u32 nextOffset = *next;
+					*next = slab->localFree;
+					slab->localFree = offset;
+					offset = nextOffset;
+				}
+				slab->owner.store(0, std::memory_order_release);
+				slab_pushDetached(region, slab);
+			}
+			region->mutex->unlock();
+		}
+		slab_unlockArenas();
+
+		cache->region = nullptr;
+		memset(cache->active, 0, sizeof(RegionSlab*) * SLAB_CLASS_COUNT);
+	}
+
+	// All slabs are gone (or about to be rebuilt), invalidate the thread caches.
+	void slab_resetRegion(MemoryRegion* region)
+	{
+		region->epoch = s_nextEpoch.fetch_add(1);
+		memset(region->detachedHead, 0, sizeof(RegionSlab*) * SLAB_CLASS_COUNT);
+		memset(region->detachedTail, 0, sizeof(RegionSlab*) * SLAB_CLASS_COUNT);
+	}
+
+	// Restored slabs have no owner, so they all start out detached.
+	void slab_restoreRegion(MemoryRegion* region)
+	{
+		slab_resetRegion(region);
+
+		JBool hasSlabs = JFALSE;
+		for (s32 b = 0; b < region->blockCount; b++)
+		{
+			MemoryBlock* block = region->memBlocks[b];
+			u8* memPtr = (u8*)block + sizeof(MemoryBlock);
+			for (u32 al = 0; al < block->count; al++)
+			{
+				RegionAllocHeader* header = (RegionAllocHeader*)memPtr;
+				if (!header->free && header->pad8[0] == HEADER_FLAG_SLAB)
+				{
+					RegionSlab* slab = (RegionSlab*)(memPtr + sizeof(RegionAllocHeader));
+					slab->owner.store(0, std::memory_order_relaxed);
+					slab_pushDetached(region, slab);
+					hasSlabs = JTRUE;
+				}
+				memPtr += header->size;
+			}
+		}
+
+		if (hasSlabs || region->mode == REGION_MODE_ARENA)
+		{
+			region_setMode(region, REGION_MODE_ARENA);
+		}
+	}
+
 	// 20k allocations and 1250 deallocations:
 	// Malloc = 0.005514 sec.
 	// Region = 0.000991 sec.
@@ -817,7 +1476,7 @@ namespace TFE_Memory
 			free(alloc[i]);
 		}
 
-		MemoryRegion* region = region_create("Test", 32 * 1024 * 1024);
+		MemoryRegion* region = region_create("Test", MAX_BLOCK_SIZE);
 		start = TFE_System::getCurrentTimeInTicks();
 		for (s32 i = 0; i < ALLOC_COUNT; i++)
 		{
@@ -832,6 +1491,29 @@ namespace TFE_Memory
 		// Free memory.
 		region_destroy(region);
 
-		TFE_System::logWrite(LOG_MSG, "MemoryRegion", "Malloc: %f, Region: %f", TFE_System::convertFromTicksToSeconds(mallocDelta), TFE_System::convertFromTicksToSeconds(regionDelta));
+		region = region_create("TestArena", MAX_BLOCK_SIZE, 0u, REGION_MODE_ARENA);
+		start = TFE_System::getCurrentTimeInTicks();
+		for (s32 i = 0; i < ALLOC_COUNT; i++)
+		{
+			alloc[i] = region_alloc(region, _testAllocSize[i&mask]);
+			if ((i % 16) == 0)
+			{
+				region_free(region, alloc[i]);
+				alloc[i] = nullptr;
+			}
+		}
+		u64 arenaDelta = TFE_System::getCurrentTimeInTicks() - start;
+		region_destroy(region);
+
+		TFE_System::logWrite(LOG_MSG, "MemoryRegion", "Malloc: %f, Region: %f, Arena: %f", TFE_System::convertFromTicksToSeconds(mallocDelta),
+			TFE_System::convertFromTicksToSeconds(regionDelta), TFE_System::convertFromTicksToSeconds(arenaDelta));
+	}
+}
+
+ThreadSlabCacheSet::~ThreadSlabCacheSet()
+{
+	for (s32 i = 0; i < THREAD_CACHE_COUNT; i++)
+	{
+		TFE_Memory::slab_releaseCache(&entries[i]);
 	}
-}
\ No newline at end of file
+}
@@ -2,6 +2,16 @@
 //////////////////////////////////////////////////////////////////////
 // General purpose memory allocator which acts as a region of
 // memory which can be quickly cleared.
+//
+// Regions created in arena mode can be used from multiple threads.
+// Allocations of 512 bytes or less come from size-class slabs owned
+// by the allocating thread, so they do not take a lock, and frees
+// from other threads are pushed onto the slab without locking.
+// Larger allocations go to the blocks under a lock. Slabs live
+// inside regular allocations, so relative pointers and serialization
+// work the same way in both modes. Clearing, destroying,
+// serializing and restoring a region still require that no other
+// thread is using it.
 //////////////////////////////////////////////////////////////////////
 #include <TFE_System/types.h>
 #include <TFE_FileSystem/filestream.h>
@@ -13,11 +23,18 @@ typedef u32 RelativePointer;
 
 #define NULL_RELATIVE_POINTER 0
 
+enum RegionMode
+{
+	REGION_MODE_DEFAULT = 0,	// Single threaded, all allocations use the block free lists.
+	REGION_MODE_ARENA,			// Thread-safe, small allocations use per-thread size-class slabs.
+};
+
 namespace TFE_Memory
 {
-	MemoryRegion* region_create(const char* name, size_t blockSize, size_t maxSize = 0u);
+	MemoryRegion* region_create(const char* name, size_t blockSize, size_t maxSize = 0u, RegionMode mode = REGION_MODE_DEFAULT);
 	void region_clear(MemoryRegion* region);
 	void region_destroy(MemoryRegion* region);
+	RegionMode region_getMode(MemoryRegion* region);
 
 	void* region_alloc(MemoryRegion* region, size_t size);
 	void* region_realloc(MemoryRegion* region, void* ptr, size_t size);
@@ -26,6 +43,9 @@ namespace TFE_Memory
 	size_t region_getMemoryUsed(MemoryRegion* region);
 	size_t region_getMemoryCapacity(MemoryRegion* region);
 	void region_getBlockInfo(MemoryRegion* region, size_t* blockCount, size_t* blockSize);
+	// Total free space in a block and the largest single allocation it can hold (including the header),
+	// the difference between the two is a measure of fragmentation.
+	void region_getBlockFreeInfo(MemoryRegion* region, u32 blockIndex, size_t* freeBytes, size_t* largestFree);
 
 	RelativePointer region_getRelativePointer(MemoryRegion* region, void* ptr);
 	void* region_getRealPointer(MemoryRegion* region, RelativePointer ptr);
@@ -34,6 +54,7 @@ namespace TFE_Memory
 	bool region_serializeToDisk(MemoryRegion* region, FileStream* file);
 	// Restore a region from disk. If 'region' is NULL then a new region is allocated,
 	// otherwise it will attempt to reuse the existing region.
+	// Regions that were serialized in arena mode are restored in arena mode.
 	MemoryRegion* region_restoreFromDisk(MemoryRegion* region, FileStream* file);
 
 	void region_test();
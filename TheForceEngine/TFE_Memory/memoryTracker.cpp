@@ -0,0 +1,606 @@
+#include <cstring>
+
+#include "memoryTracker.h"
+#include "memoryRegion.h"
+#include <TFE_System/system.h>
+#include <TFE_System/Threads/mutex.h>
+#include <algorithm>
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <string>
+#include <map>
+
+namespace TFE_Memory
+{
+	enum
+	{
+		SITE_LABEL_LEN = 96,
+		REGION_NAME_LEN = 32,
+	};
+
+	struct TrackedSite
+	{
+		char label[SITE_LABEL_LEN];
+		char regionName[REGION_NAME_LEN];
+		MemTrackKind kind;
+
+		u32 liveCount;
+		u32 peakCount;
+		size_t liveBytes;
+		size_t peakBytes;
+		u64 totalCount;
+		u64 totalBytes;
+
+		u32 curFrameCount;
+		size_t curFrameBytes;
+		u32 frameCount;
+		size_t frameBytes;
+		u32 maxFrameCount;
+		size_t maxFrameBytes;
+	};
+
+	struct TrackedRegion
+	{
+		MemoryRegion* region;
+		char name[REGION_NAME_LEN];
+		u32 defaultSite;
+		size_t highWater;
+	};
+
+	struct TrackedAlloc
+	{
+		u32 site;
+		size_t size;
+		MemoryRegion* region;
+		const void* owner;
+	};
+
+	// Sites recorded with TFE_ALLOC_SITE() are looked up by source location, so the label is only built once.
+	struct SourceSiteKey
+	{
+		const char* file;
+		u32 line;
+		u32 kind;
+		MemoryRegion* region;
+
+		bool operator<(const SourceSiteKey& other) const
+		{
+			if (file != other.file) { return file < other.file; }
+			if (line != other.line) { return line < other.line; }
+			if (kind != other.kind) { return kind < other.kind; }
+			return region < other.region;
+		}
+	};
+
+	struct PendingSite
+	{
+		const char* file;
+		u32 line;
+		u32 id;
+	};
+
+	typedef std::unordered_map<void*, TrackedAlloc> AllocMap;
+	typedef std::map<SourceSiteKey, u32> SourceSiteMap;
+	typedef std::map<std::string, u32> LabelSiteMap;
+
+	static atomic_bool s_enabled(false);
+	static thread_local PendingSite s_pending = { nullptr, 0, MEMTRACK_NO_SITE };
+
+	// Sites are never removed, since Allocators and ChunkedArrays hold on to their site ids.
+	// A deque is used so that the labels do not move as sites are added.
+	static std::deque<TrackedSite> s_sites;
+	static std::vector<TrackedRegion> s_regions;
+	static SourceSiteMap s_sourceSites;
+	static LabelSiteMap s_labelSites;
+	// Elements share addresses with the chunks that hold them, so they are kept separately.
+	static AllocMap s_allocs;
+	static AllocMap s_elements;
+	static MemTrackFrameStats s_curFrame = {};
+	static MemTrackFrameStats s_prevFrame = {};
+
+	static const char* c_kindName[MEMTRACK_KIND_COUNT] =
+	{
+		"Region",		// MEMTRACK_REGION_ALLOC
+		"Allocator",	// MEMTRACK_ALLOCATOR_ITEM
+		"Chunked",		// MEMTRACK_CHUNKED_ELEMENT
+	};
+
+	// Regions can be created before any other system is initialized, so the mutex is created on first use.
+	Mutex* getMutex()
+	{
+		static Mutex* mutex = Mutex::create();
+		return mutex;
+	}
+
+	PendingSite takePending()
+	{
+		const PendingSite pending = s_pending;
+		s_pending = { nullptr, 0, MEMTRACK_NO_SITE };
+		return pending;
+	}
+
+	TrackedRegion* findRegion(MemoryRegion* region)
+	{
+		for (size_t i = 0; i < s_regions.size(); i++)
+		{
+			if (s_regions[i].region == region) { return &s_regions[i]; }
+		}
+		return nullptr;
+	}
+
+	u32 registerSite(const char* label, MemTrackKind kind, MemoryRegion* region)
+	{
+		const TrackedRegion* trackedRegion = findRegion(region);
+		const char* regionName = trackedRegion ? trackedRegion->name : "";
+
+		char key[SITE_LABEL_LEN + REGION_NAME_LEN + 8];
+		snprintf(key, sizeof(key), "%u|%s|%s", u32(kind), regionName, label);
+		LabelSiteMap::iterator iSite = s_labelSites.find(key);
+		if (iSite != s_labelSites.end())
+		{
+			return iSite->second;
+		}
+
+		const u32 id = u32(s_sites.size());
+		s_sites.push_back({});
+		TrackedSite& site = s_sites.back();
+		strncpy(site.label, label, SITE_LABEL_LEN - 1);
+		strncpy(site.regionName, regionName, REGION_NAME_LEN - 1);
+		site.kind = kind;
+		s_labelSites[key] = id;
+		return id;
+	}
+
+	u32 registerSourceSite(const char* file, u32 line, MemTrackKind kind, MemoryRegion* region)
+	{
+		const SourceSiteKey key = { file, line, u32(kind), region };
+		SourceSiteMap::iterator iSite = s_sourceSites.find(key);
+		if (iSite != s_sourceSites.end())
+		{
+			return iSite->second;
+		}
+
+		// Keep the file name and its parent directory, the full path is too long to be useful.
+		const char* name = file;
+		s32 separators = 0;
+		for (const char* c = file + strlen(file) - 1; c >= file; c--)
+		{
+			if (*c == '/' || *c == '\\')
+			{
+				separators++;
+				if (separators == 2)
+				{
+					name = c + 1;
+					break;
+				}
+			}
+		}
+
+		char label[SITE_LABEL_LEN];
+		snprintf(label, SITE_LABEL_LEN, "%s(%u)", name, line);
+		const u32 id = registerSite(label, kind, region);
+		s_sourceSites[key] = id;
+		return id;
+	}
+
+	u32 resolvePending(const PendingSite& pending, MemTrackKind kind, MemoryRegion* region)
+	{
+		if (pending.id != MEMTRACK_NO_SITE)
+		{
+			return pending.id;
+		}
+		if (pending.file)
+		{
+			return registerSourceSite(pending.file, pending.line, kind, region);
+		}
+		const TrackedRegion* trackedRegion = findRegion(region);
+		return trackedRegion ? trackedRegion->defaultSite : MEMTRACK_NO_SITE;
+	}
+
+	void addAllocation(AllocMap& allocMap, void* ptr, const TrackedAlloc& alloc)
+	{
+		allocMap[ptr] = alloc;
+		s_curFrame.allocCount++;
+		s_curFrame.allocBytes += alloc.size;
+		if (alloc.site == MEMTRACK_NO_SITE) { return; }
+
+		TrackedSite& site = s_sites[alloc.site];
+		site.liveCount++;
+		site.liveBytes += alloc.size;
+		site.totalCount++;
+		site.totalBytes += alloc.size;
+		site.curFrameCount++;
+		site.curFrameBytes += alloc.size;
+		site.peakCount = std::max(site.peakCount, site.liveCount);
+		site.peakBytes = std::max(site.peakBytes, site.liveBytes);
+	}
+
+	void removeAllocation(const TrackedAlloc& alloc)
+	{
+		s_curFrame.freeCount++;
+		s_curFrame.freeBytes += alloc.size;
+		if (alloc.site == MEMTRACK_NO_SITE) { return; }
+
+		TrackedSite& site = s_sites[alloc.site];
+		site.liveCount--;
+		site.liveBytes -= alloc.size;
+	}
+
+	bool removeAllocation(AllocMap& allocMap, void* ptr, TrackedAlloc* alloc = nullptr)
+	{
+		AllocMap::iterator iAlloc = allocMap.find(ptr);
+		if (iAlloc == allocMap.end())
+		{
+			return false;
+		}
+		removeAllocation(iAlloc->second);
+		if (alloc) { *alloc = iAlloc->second; }
+		allocMap.erase(iAlloc);
+		return true;
+	}
+
+	template <typename Predicate>
+	void removeAllocations(AllocMap& allocMap, Predicate remove)
+	{
+		for (AllocMap::iterator iAlloc = allocMap.begin(); iAlloc != allocMap.end();)
+		{
+			if (remove(iAlloc->second))
+			{
+				removeAllocation(iAlloc->second);
+				iAlloc = allocMap.erase(iAlloc);
+			}
+			else
+			{
+				++iAlloc;
+			}
+		}
+	}
+
+	void clearLiveAllocations()
+	{
+		s_allocs.clear();
+		s_elements.clear();
+		for (size_t i = 0; i < s_sites.size(); i++)
+		{
+			s_sites[i].liveCount = 0;
+			s_sites[i].liveBytes = 0;
+		}
+	}
+
+	void memtrack_enable(bool enable)
+	{
+		if (enable == s_enabled) { return; }
+
+		getMutex()->lock();
+		s_enabled = enable;
+		// Allocations made while tracking is disabled are not seen, so the live counts are only valid
+		// from the point that tracking was enabled. The region high water marks are not updated either.
+		clearLiveAllocations();
+		for (size_t i = 0; i < s_regions.size(); i++)
+		{
+			s_regions[i].highWater = region_getMemoryUsed(s_regions[i].region);
+		}
+		getMutex()->unlock();
+	}
+
+	bool memtrack_isEnabled()
+	{
+		return s_enabled;
+	}
+
+	void memtrack_reset()
+	{
+		getMutex()->lock();
+		for (size_t i = 0; i < s_sites.size(); i++)
+		{
+			TrackedSite& site = s_sites[i];
+			site.peakCount = site.liveCount;
+			site.peakBytes = site.liveBytes;
+			site.totalCount = 0;
+			site.totalBytes = 0;
+			site.curFrameCount = 0;
+			site.curFrameBytes = 0;
+			site.frameCount = 0;
+			site.frameBytes = 0;
+			site.maxFrameCount = 0;
+			site.maxFrameBytes = 0;
+		}
+		for (size_t i = 0; i < s_regions.size(); i++)
+		{
+			s_regions[i].highWater = region_getMemoryUsed(s_regions[i].region);
+		}
+		s_curFrame = {};
+		s_prevFrame = {};
+		getMutex()->unlock();
+	}
+
+	void memtrack_frameEnd()
+	{
+		if (!s_enabled) { return; }
+
+		getMutex()->lock();
+		for (size_t i = 0; i < s_regions.size(); i++)
+		{
+			TrackedRegion& region = s_regions[i];
+			region.highWater = std::max(region.highWater, region_getMemoryUsed(region.region));
+		}
+
+		for (size_t i = 0; i < s_sites.size(); i++)
+		{
+			TrackedSite& site = s_sites[i];
+			site.frameCount = site.curFrameCount;
+			site.frameBytes = site.curFrameBytes;
+			site.maxFrameCount = std::max(site.maxFrameCount, site.curFrameCount);
+			site.maxFrameBytes = std::max(site.maxFrameBytes, site.curFrameBytes);
+			site.curFrameCount = 0;
+			site.curFrameBytes = 0;
+		}
+		s_prevFrame = s_curFrame;
+		s_curFrame = {};
+		getMutex()->unlock();
+	}
+
+	void memtrack_setSite(const char* file, u32 line)
+	{
+		s_pending = { file, line, MEMTRACK_NO_SITE };
+	}
+
+	void memtrack_setSiteId(u32 site)
+	{
+		s_pending = { nullptr, 0, site };
+	}
+
+	u32 memtrack_takeSite(MemTrackKind kind, MemoryRegion* region, const char* fallbackLabel)
+	{
+		const PendingSite pending = takePending();
+		if (pending.id != MEMTRACK_NO_SITE)
+		{
+			return pending.id;
+		}
+
+		getMutex()->lock();
+		const u32 site = pending.file ? registerSourceSite(pending.file, pending.line, kind, region) : registerSite(fallbackLabel, kind, region);
+		getMutex()->unlock();
+		return site;
+	}
+
+	void memtrack_addRegion(MemoryRegion* region, const char* name)
+	{
+		if (!region) { return; }
+
+		getMutex()->lock();
+		if (!findRegion(region))
+		{
+			TrackedRegion trackedRegion = {};
+			trackedRegion.region = region;
+			strncpy(trackedRegion.name, name, REGION_NAME_LEN - 1);
+			s_regions.push_back(trackedRegion);
+
+			char label[SITE_LABEL_LEN];
+			snprintf(label, SITE_LABEL_LEN, "%s (untracked site)", trackedRegion.name);
+			s_regions.back().defaultSite = registerSite(label, MEMTRACK_REGION_ALLOC, region);
+		}
+		getMutex()->unlock();
+	}
+
+	void memtrack_removeRegion(MemoryRegion* region)
+	{
+		getMutex()->lock();
+		removeAllocations(s_allocs, [region](const TrackedAlloc& alloc) { return alloc.region == region; });
+		removeAllocations(s_elements, [region](const TrackedAlloc& alloc) { return alloc.region == region; });
+		for (size_t i = 0; i < s_regions.size(); i++)
+		{
+			if (s_regions[i].region == region)
+			{
+				s_regions.erase(s_regions.begin() + i);
+				break;
+			}
+		}
+		// A new region may be created at the same address.
+		for (SourceSiteMap::iterator iSite = s_sourceSites.begin(); iSite != s_sourceSites.end();)
+		{
+			if (iSite->first.region == region) { iSite = s_sourceSites.erase(iSite); }
+			else { ++iSite; }
+		}
+		getMutex()->unlock();
+	}
+
+	void memtrack_clearRegion(MemoryRegion* region)
+	{
+		if (!s_enabled) { return; }
+
+		getMutex()->lock();
+		removeAllocations(s_allocs, [region](const TrackedAlloc& alloc) { return alloc.region == region; });
+		removeAllocations(s_elements, [region](const TrackedAlloc& alloc) { return alloc.region == region; });
+		getMutex()->unlock();
+	}
+
+	void memtrack_alloc(MemoryRegion* region, void* ptr, size_t size)
+	{
+		const PendingSite pending = takePending();
+		if (!s_enabled || !ptr) { return; }
+
+		getMutex()->lock();
+		const TrackedAlloc alloc = { resolvePending(pending, MEMTRACK_REGION_ALLOC, region), size, region, region };
+		addAllocation(s_allocs, ptr, alloc);
+		getMutex()->unlock();
+	}
+
+	void memtrack_realloc(MemoryRegion* region, void* oldPtr, void* newPtr, size_t size)
+	{
+		const PendingSite pending = takePending();
+		if (!s_enabled || !newPtr) { return; }
+
+		getMutex()->lock();
+		// Keep the original site unless a new one was given, the reallocation usually happens in shared code.
+		TrackedAlloc prev;
+		const bool hasPrev = removeAllocation(s_allocs, oldPtr, &prev);
+		const bool hasPending = pending.file || pending.id != MEMTRACK_NO_SITE;
+		const u32 site = (hasPrev && !hasPending) ? prev.site : resolvePending(pending, MEMTRACK_REGION_ALLOC, region);
+
+		const TrackedAlloc alloc = { site, size, region, region };
+		addAllocation(s_allocs, newPtr, alloc);
+		getMutex()->unlock();
+	}
+
+	void memtrack_free(void* ptr)
+	{
+		if (!s_enabled || !ptr) { return; }
+
+		getMutex()->lock();
+		removeAllocation(s_allocs, ptr);
+		getMutex()->unlock();
+	}
+
+	void memtrack_allocElement(u32 site, MemoryRegion* region, const void* owner, void* ptr, size_t size)
+	{
+		if (!s_enabled || !ptr) { return; }
+
+		getMutex()->lock();
+		const TrackedAlloc alloc = { site, size, region, owner };
+		addAllocation(s_elements, ptr, alloc);
+		getMutex()->unlock();
+	}
+
+	void memtrack_freeElement(void* ptr)
+	{
+		if (!s_enabled || !ptr) { return; }
+
+		getMutex()->lock();
+		removeAllocation(s_elements, ptr);
+		getMutex()->unlock();
+	}
+
+	void memtrack_freeOwner(const void* owner)
+	{
+		if (!s_enabled) { return; }
+
+		getMutex()->lock();
+		removeAllocations(s_elements, [owner](const TrackedAlloc& alloc) { return alloc.owner == owner; });
+		getMutex()->unlock();
+	}
+
+	u32 memtrack_getRegionCount()
+	{
+		getMutex()->lock();
+		const u32 count = u32(s_regions.size());
+		getMutex()->unlock();
+		return count;
+	}
+
+	bool memtrack_getRegionInfo(u32 index, MemTrackRegionInfo* info)
+	{
+		getMutex()->lock();
+		if (index >= s_regions.size())
+		{
+			getMutex()->unlock();
+			return false;
+		}
+
+		const TrackedRegion& trackedRegion = s_regions[index];
+		MemoryRegion* region = trackedRegion.region;
+		strcpy(info->name, trackedRegion.name);
+		info->used = region_getMemoryUsed(region);
+		info->capacity = region_getMemoryCapacity(region);
+		info->highWater = std::max(trackedRegion.highWater, info->used);
+		region_getBlockInfo(region, &info->blockCount, &info->blockSize);
+
+		info->worstFragmentation = 0.0f;
+		info->worstBlock = 0;
+		for (u32 b = 0; b < u32(info->blockCount); b++)
+		{
+			size_t freeBytes, largestFree;
+			region_getBlockFreeInfo(region, b, &freeBytes, &largestFree);
+			const f32 fragmentation = freeBytes ? 1.0f - f32(largestFree) / f32(freeBytes) : 0.0f;
+			if (fragmentation > info->worstFragmentation)
+			{
+				info->worstFragmentation = fragmentation;
+				info->worstBlock = b;
+			}
+		}
+		getMutex()->unlock();
+		return true;
+	}
+
+	u32 memtrack_getSiteCount()
+	{
+		getMutex()->lock();
+		const u32 count = u32(s_sites.size());
+		getMutex()->unlock();
+		return count;
+	}
+
+	void getSiteInfo(const TrackedSite& site, MemTrackSiteInfo* info)
+	{
+		info->label = site.label;
+		info->kind = site.kind;
+		info->regionName = site.regionName;
+		info->liveCount = site.liveCount;
+		info->peakCount = site.peakCount;
+		info->liveBytes = site.liveBytes;
+		info->peakBytes = site.peakBytes;
+		info->totalCount = site.totalCount;
+		info->totalBytes = site.totalBytes;
+		info->frameCount = site.frameCount;
+		info->frameBytes = site.frameBytes;
+		info->maxFrameCount = site.maxFrameCount;
+		info->maxFrameBytes = site.maxFrameBytes;
+	}
+
+	bool memtrack_getSiteInfo(u32 index, MemTrackSiteInfo* info)
+	{
+		getMutex()->lock();
+		const bool valid = index < s_sites.size();
+		if (valid)
+		{
+			getSiteInfo(s_sites[index], info);
+		}
+		getMutex()->unlock();
+		return valid;
+	}
+
+	u32 memtrack_getTopSites(MemTrackSort sort, MemTrackSiteInfo* sites, u32 maxCount)
+	{
+		std::vector<const TrackedSite*> sorted;
+		getMutex()->lock();
+		for (size_t i = 0; i < s_sites.size(); i++)
+		{
+			if (s_sites[i].totalCount || s_sites[i].liveCount) { sorted.push_back(&s_sites[i]); }
+		}
+
+		std::sort(sorted.begin(), sorted.end(), [sort](const TrackedSite* a, const TrackedSite* b)
+		{
+			switch (sort)
+			{
+				case MEMTRACK_SORT_PEAK_BYTES:
+					return a->peakBytes > b->peakBytes;
+				case MEMTRACK_SORT_FRAME_COUNT:
+					if (a->frameCount != b->frameCount) { return a->frameCount > b->frameCount; }
+					return a->maxFrameCount > b->maxFrameCount;
+				default:
+					return a->liveBytes > b->liveBytes;
+			}
+		});
+
+		const u32 count = std::min(maxCount, u32(sorted.size()));
+		for (u32 i = 0; i < count; i++)
+		{
+			getSiteInfo(*sorted[i], &sites[i]);
+		}
+		getMutex()->unlock();
+		return count;
+	}
+
+	void memtrack_getFrameStats(MemTrackFrameStats* stats)
+	{
+		getMutex()->lock();
+		*stats = s_prevFrame;
+		getMutex()->unlock();
+	}
+
+	const char* memtrack_getKindName(MemTrackKind kind)
+	{
+		return kind < MEMTRACK_KIND_COUNT ? c_kindName[kind] : "";
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// Allocation tracking for MemoryRegion, Allocator and ChunkedArray.
+//
+// Allocations are attributed to a site, which is either the source
+// location recorded by TFE_ALLOC_SITE() right before the allocation
+// or a default site owned by the region, Allocator or ChunkedArray.
+// Each site keeps its live, peak and per-frame allocation counts so
+// that it is easy to see what fills a region and what allocates
+// every frame.
+//
+// Tracking is off by default and only costs a flag check per
+// allocation until it is enabled (see the memTrack console command).
+// Region high-water marks are sampled once per frame while tracking
+// is enabled.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_System/types.h>
+
+// Set to 0 to compile out the tracking hooks.
+#define TFE_MEMORY_TRACKING 1
+
+#if TFE_MEMORY_TRACKING
+// Attribute the next allocation on this thread to the current source location.
+#define TFE_ALLOC_SITE() TFE_Memory::memtrack_setSite(__FILE__, __LINE__)
+#else
+#define TFE_ALLOC_SITE() ((void)0)
+#endif
+
+struct MemoryRegion;
+
+enum MemTrackKind
+{
+	MEMTRACK_REGION_ALLOC = 0,	// Allocated directly from a region.
+	MEMTRACK_ALLOCATOR_ITEM,	// Items of an Allocator, including the Allocator itself.
+	MEMTRACK_CHUNKED_ELEMENT,	// Elements handed out by a ChunkedArray.
+	MEMTRACK_KIND_COUNT
+};
+
+enum MemTrackSort
+{
+	MEMTRACK_SORT_LIVE_BYTES = 0,
+	MEMTRACK_SORT_PEAK_BYTES,
+	MEMTRACK_SORT_FRAME_COUNT,	// Allocations in the last frame, then the most in any frame.
+};
+
+#define MEMTRACK_NO_SITE 0xffffffffu
+
+struct MemTrackSiteInfo
+{
+	const char* label;
+	MemTrackKind kind;
+	const char* regionName;
+
+	u32 liveCount;
+	u32 peakCount;
+	size_t liveBytes;
+	size_t peakBytes;
+	u64 totalCount;
+	u64 totalBytes;
+
+	// Allocations made in the last complete frame, and the most made in any one frame.
+	u32 frameCount;
+	size_t frameBytes;
+	u32 maxFrameCount;
+	size_t maxFrameBytes;
+};
+
+struct MemTrackRegionInfo
+{
+	char name[32];
+	size_t used;
+	size_t capacity;
+	size_t highWater;	// Highest used size seen at the end of a frame while tracking is enabled.
+	size_t blockCount;
+	size_t blockSize;
+	// Fragmentation of the worst block: 1 - largest free slot / free space.
+	f32 worstFragmentation;
+	u32 worstBlock;
+};
+
+struct MemTrackFrameStats
+{
+	u32 allocCount;
+	u32 freeCount;
+	size_t allocBytes;
+	size_t freeBytes;
+};
+
+namespace TFE_Memory
+{
+	void memtrack_enable(bool enable);
+	bool memtrack_isEnabled();
+	// Clear the site statistics and region high-water marks, live allocations are kept.
+	void memtrack_reset();
+	// Call once per frame, while tracking is enabled this closes the per-frame statistics and samples the region high-water marks.
+	void memtrack_frameEnd();
+
+	// Site registration, used by the allocators.
+	void memtrack_setSite(const char* file, u32 line);
+	void memtrack_setSiteId(u32 site);
+	// Returns the pending site, if any, or registers 'fallbackLabel' and clears the pending site.
+	u32  memtrack_takeSite(MemTrackKind kind, MemoryRegion* region, const char* fallbackLabel);
+
+	// Hooks, the pending site is consumed by memtrack_alloc() and memtrack_realloc().
+	void memtrack_addRegion(MemoryRegion* region, const char* name);
+	void memtrack_removeRegion(MemoryRegion* region);
+	void memtrack_clearRegion(MemoryRegion* region);
+	void memtrack_alloc(MemoryRegion* region, void* ptr, size_t size);
+	void memtrack_realloc(MemoryRegion* region, void* oldPtr, void* newPtr, size_t size);
+	void memtrack_free(void* ptr);
+	void memtrack_allocElement(u32 site, MemoryRegion* region, const void* owner, void* ptr, size_t size);
+	void memtrack_freeElement(void* ptr);
+	void memtrack_freeOwner(const void* owner);
+
+	// Queries. Site strings remain valid for the life of the program, region names are copied.
+	u32  memtrack_getRegionCount();
+	bool memtrack_getRegionInfo(u32 index, MemTrackRegionInfo* info);
+	u32  memtrack_getSiteCount();
+	bool memtrack_getSiteInfo(u32 index, MemTrackSiteInfo* info);
+	// Fill 'sites' with up to 'maxCount' of the sites with the highest value for 'sort', sites that never allocated are skipped.
+	u32  memtrack_getTopSites(MemTrackSort sort, MemTrackSiteInfo* sites, u32 maxCount);
+	void memtrack_getFrameStats(MemTrackFrameStats* stats);
+	const char* memtrack_getKindName(MemTrackKind kind);
+}
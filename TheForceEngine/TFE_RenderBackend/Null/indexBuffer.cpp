@@ -0,0 +1,36 @@
+#include <TFE_RenderBackend/indexBuffer.h>
+
+IndexBuffer::~IndexBuffer()
+{
+	destroy();
+}
+
+bool IndexBuffer::create(u32 count, u32 stride, bool dynamic, void* initData)
+{
+	if (!count || !stride) { return false; }
+
+	m_size = count * stride;
+	m_count = count;
+	m_stride = stride;
+	m_dynamic = dynamic;
+	return true;
+}
+
+void IndexBuffer::destroy()
+{
+	m_size = 0;
+	m_count = 0;
+}
+
+void IndexBuffer::update(const void* buffer, size_t size)
+{
+}
+
+u32 IndexBuffer::bind()
+{
+	return m_stride;
+}
+
+void IndexBuffer::unbind()
+{
+}
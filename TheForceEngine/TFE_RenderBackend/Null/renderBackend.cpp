@@ -0,0 +1,525 @@
+//////////////////////////////////////////////////////////////////////
+// Headless "null" render backend.
+// This is built instead of the Win32OpenGL backend for machines
+// without a GPU or display, such as automated performance testing.
+// No window is created and nothing is drawn, but the virtual display
+// is kept in CPU memory so that the software renderers run as-is and
+// the last presented frame can still be captured.
+//
+// The other GPU objects (textures, shaders, buffers) are stubbed out
+// in the other files in this directory.
+//////////////////////////////////////////////////////////////////////
+#include <TFE_RenderBackend/renderBackend.h>
+#include <TFE_RenderBackend/textureGpu.h>
+#include <TFE_Settings/settings.h>
+#include <TFE_Ui/ui.h>
+#include <TFE_Asset/imageAsset.h>	// For image saving, this should be refactored...
+#include <TFE_System/profiler.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+namespace TFE_RenderBackend
+{
+	struct NullRenderTarget
+	{
+		TextureGpu* texture;
+		bool hasDepthBuffer;
+	};
+
+	static char s_screenshotPath[TFE_MAX_PATH];
+	static bool s_screenshotQueued = false;
+
+	static WindowState m_windowState;
+	static bool s_vsync = false;
+
+	// The virtual display is stored as 8-bit palette indices, matching the framebuffer the software renderers produce.
+	static std::vector<u8> s_virtualDisplay;
+	// The frame that was last presented by swap(), which is what captureScreenToMemory() reads from.
+	static std::vector<u8> s_frontBuffer;
+	static u32 s_palette[256];
+	static u32 s_frontPalette[256];
+	static TextureGpu* s_paletteTexture = nullptr;
+	static NullRenderTarget* s_virtualRenderTarget = nullptr;
+
+	static u32 s_virtualWidth, s_virtualHeight;
+	static u32 s_virtualWidthUi;
+	static u32 s_virtualWidth3d;
+
+	static bool s_widescreen = false;
+	static bool s_asyncFrameBuffer = true;
+	static bool s_gpuColorConvert = false;
+	static bool s_useRenderTarget = false;
+	static DisplayMode s_displayMode;
+
+	void resolveFrontBuffer(u32* mem, u32 width, u32 height);
+
+	bool init(const WindowState& state)
+	{
+		m_windowState = state;
+		s_vsync = (state.flags & WINFLAG_VSYNC) != 0;
+		memset(s_palette, 0, sizeof(u32) * 256);
+		memset(s_frontPalette, 0, sizeof(u32) * 256);
+
+		s_paletteTexture = new TextureGpu();
+		s_paletteTexture->create(256, 1);
+
+		// The UI still runs so that the front end state machine behaves the same, but nothing is rendered.
+		TFE_Ui::init(nullptr, nullptr, 100);
+		TFE_System::logWrite(LOG_MSG, "RenderBackend", "Using the headless render backend (%u x %u).", state.width, state.height);
+		return true;
+	}
+
+	void destroy()
+	{
+		TFE_Ui::shutdown();
+
+		delete s_paletteTexture;
+		if (s_virtualRenderTarget)
+		{
+			delete s_virtualRenderTarget->texture;
+			delete s_virtualRenderTarget;
+		}
+		s_paletteTexture = nullptr;
+		s_virtualRenderTarget = nullptr;
+		s_virtualDisplay.clear();
+		s_frontBuffer.clear();
+	}
+
+	bool isHeadless()
+	{
+		return true;
+	}
+
+	bool getVsyncEnabled()
+	{
+		return s_vsync;
+	}
+
+	void enableVsync(bool enable)
+	{
+		s_vsync = enable;
+	}
+
+	void setClearColor(const f32* color)
+	{
+	}
+
+	void swap(bool blitVirtualDisplay)
+	{
+		// "Present" the virtual display, the palette is latched along with it so a capture matches what was swapped.
+		if (blitVirtualDisplay && !s_virtualDisplay.empty())
+		{
+			TFE_ZONE("Draw Virtual Display");
+			s_frontBuffer = s_virtualDisplay;
+			memcpy(s_frontPalette, s_palette, sizeof(u32) * 256);
+		}
+		else
+		{
+			std::fill(s_frontBuffer.begin(), s_frontBuffer.end(), 0);
+		}
+
+		TFE_ZONE_BEGIN(systemUi, "System UI");
+		TFE_Ui::render();
+		TFE_ZONE_END(systemUi);
+
+		if (s_screenshotQueued)
+		{
+			s_screenshotQueued = false;
+
+			std::vector<u32> image(m_windowState.width * m_windowState.height);
+			resolveFrontBuffer(image.data(), m_windowState.width, m_windowState.height);
+			TFE_Image::writeImage(s_screenshotPath, m_windowState.width, m_windowState.height, image.data());
+		}
+	}
+
+	void captureScreenToMemory(u32* mem)
+	{
+		resolveFrontBuffer(mem, m_windowState.width, m_windowState.height);
+	}
+
+	void queueScreenshot(const char* screenshotPath)
+	{
+		strcpy(s_screenshotPath, screenshotPath);
+		s_screenshotQueued = true;
+	}
+
+	void startGifRecording(const char* path)
+	{
+		TFE_System::logWrite(LOG_WARNING, "RenderBackend", "GIF recording is not supported by the headless render backend.");
+	}
+
+	void stopGifRecording()
+	{
+	}
+
+	bool startStreamRecording(const char* path, s32 format)
+	{
+		TFE_System::logWrite(LOG_WARNING, "RenderBackend", "Video recording is not supported by the headless render backend.");
+		return false;
+	}
+
+	void stopStreamRecording()
+	{
+	}
+
+	bool isStreamRecording()
+	{
+		return false;
+	}
+
+	void updateSettings()
+	{
+	}
+
+	void resize(s32 width, s32 height)
+	{
+		TFE_Settings_Window* windowSettings = TFE_Settings::getWindowSettings();
+
+		m_windowState.width = width;
+		m_windowState.height = height;
+
+		windowSettings->width = width;
+		windowSettings->height = height;
+		if (!(m_windowState.flags & WINFLAG_FULLSCREEN))
+		{
+			m_windowState.baseWindowWidth = width;
+			m_windowState.baseWindowHeight = height;
+
+			windowSettings->baseWidth = width;
+			windowSettings->baseHeight = height;
+		}
+	}
+
+	// There are no displays, so report a single "monitor" the size of the window.
+	s32 getDisplayCount()
+	{
+		return 1;
+	}
+
+	s32 getDisplayIndex(s32 x, s32 y)
+	{
+		return 0;
+	}
+
+	bool getDisplayMonitorInfo(s32 displayIndex, MonitorInfo* monitorInfo)
+	{
+		if (displayIndex != 0)
+		{
+			return false;
+		}
+
+		monitorInfo->x = 0;
+		monitorInfo->y = 0;
+		monitorInfo->w = m_windowState.monitorWidth;
+		monitorInfo->h = m_windowState.monitorHeight;
+		return true;
+	}
+
+	f32 getDisplayRefreshRate()
+	{
+		return m_windowState.refreshRate;
+	}
+
+	void getCurrentMonitorInfo(MonitorInfo* monitorInfo)
+	{
+		getDisplayMonitorInfo(0, monitorInfo);
+	}
+
+	void enableFullscreen(bool enable)
+	{
+		TFE_Settings_Window* windowSettings = TFE_Settings::getWindowSettings();
+		windowSettings->fullscreen = enable;
+
+		if (enable)
+		{
+			m_windowState.flags |= WINFLAG_FULLSCREEN;
+			m_windowState.width  = m_windowState.monitorWidth;
+			m_windowState.height = m_windowState.monitorHeight;
+		}
+		else
+		{
+			m_windowState.flags &= ~WINFLAG_FULLSCREEN;
+			m_windowState.width  = m_windowState.baseWindowWidth;
+			m_windowState.height = m_windowState.baseWindowHeight;
+		}
+	}
+
+	void clearWindow()
+	{
+	}
+
+	void getDisplayInfo(DisplayInfo* displayInfo)
+	{
+		assert(displayInfo);
+
+		displayInfo->width = m_windowState.width;
+		displayInfo->height = m_windowState.height;
+		displayInfo->refreshRate = s_vsync ? m_windowState.refreshRate : 0.0f;
+	}
+
+	bool createVirtualDisplay(const VirtualDisplayInfo& vdispInfo)
+	{
+		if (s_virtualRenderTarget)
+		{
+			delete s_virtualRenderTarget->texture;
+			delete s_virtualRenderTarget;
+		}
+		s_virtualRenderTarget = nullptr;
+
+		s_virtualWidth = vdispInfo.width;
+		s_virtualHeight = vdispInfo.height;
+		s_virtualWidthUi = vdispInfo.widthUi;
+		s_virtualWidth3d = vdispInfo.width3d;
+		s_displayMode = vdispInfo.mode;
+		s_widescreen = (vdispInfo.flags & VDISP_WIDESCREEN) != 0;
+		s_asyncFrameBuffer = (vdispInfo.flags & VDISP_ASYNC_FRAMEBUFFER) != 0;
+		s_gpuColorConvert = (vdispInfo.flags & VDISP_GPU_COLOR_CONVERT) != 0;
+		s_useRenderTarget = (vdispInfo.flags & VDISP_RENDER_TARGET) != 0;
+
+		if (s_useRenderTarget)
+		{
+			// GPU rendering has nothing to draw into, but the target is created so the renderer can run.
+			s_virtualDisplay.clear();
+			s_virtualRenderTarget = (NullRenderTarget*)createRenderTarget(s_virtualWidth, s_virtualHeight, true);
+		}
+		else
+		{
+			s_virtualDisplay.resize(s_virtualWidth * s_virtualHeight);
+			memset(s_virtualDisplay.data(), 0, s_virtualDisplay.size());
+		}
+		s_frontBuffer.clear();
+		return true;
+	}
+
+	u32 getVirtualDisplayWidth2D()
+	{
+		return s_virtualWidthUi;
+	}
+
+	u32 getVirtualDisplayWidth3D()
+	{
+		return s_virtualWidth3d;
+	}
+
+	u32 getVirtualDisplayHeight()
+	{
+		return s_virtualHeight;
+	}
+
+	u32 getVirtualDisplayOffset2D()
+	{
+		if (s_virtualWidth <= s_virtualWidthUi) { return 0; }
+		return (s_virtualWidth - s_virtualWidthUi) >> 1;
+	}
+
+	u32 getVirtualDisplayOffset3D()
+	{
+		if (s_virtualWidth <= s_virtualWidth3d) { return 0; }
+		return (s_virtualWidth - s_virtualWidth3d) >> 1;
+	}
+
+	void* getVirtualDisplayGpuPtr()
+	{
+		return nullptr;
+	}
+
+	bool getWidescreen()
+	{
+		return s_widescreen;
+	}
+
+	bool getFrameBufferAsync()
+	{
+		return s_asyncFrameBuffer;
+	}
+
+	bool getGPUColorConvert()
+	{
+		return s_gpuColorConvert;
+	}
+
+	void updateVirtualDisplay(const void* buffer, size_t size)
+	{
+		TFE_ZONE("Update Virtual Display");
+		if (!s_virtualDisplay.empty())
+		{
+			memcpy(s_virtualDisplay.data(), buffer, std::min(size, s_virtualDisplay.size()));
+		}
+	}
+
+	void bindVirtualDisplay()
+	{
+	}
+
+	void clearVirtualDisplay(f32* color, bool clearColor)
+	{
+	}
+
+	void copyToVirtualDisplay(RenderTargetHandle src)
+	{
+	}
+
+	void copyBackbufferToRenderTarget(RenderTargetHandle dst)
+	{
+	}
+
+	void setPalette(const u32* palette)
+	{
+		// Unlike the GPU backend the palette is always kept, since the CPU needs it to resolve captures.
+		if (palette)
+		{
+			memcpy(s_palette, palette, sizeof(u32) * 256);
+		}
+	}
+
+	const TextureGpu* getPaletteTexture()
+	{
+		return s_paletteTexture;
+	}
+
+	void setColorCorrection(bool enabled, const ColorCorrection* color/* = nullptr*/)
+	{
+	}
+
+	// Scale the presented frame to the output size using the same aspect correction as the GPU blit.
+	void resolveFrontBuffer(u32* mem, u32 width, u32 height)
+	{
+		memset(mem, 0, width * height * sizeof(u32));
+		if (s_frontBuffer.empty() || !s_virtualWidth || !s_virtualHeight || !width || !height) { return; }
+
+		s32 x = 0, y = 0;
+		s32 w = width;
+		s32 h = height;
+		const f32 aspect = f32(w) / f32(h);
+		if (s_displayMode == DMODE_ASPECT_CORRECT && aspect > 1.32f && !s_widescreen)
+		{
+			w = 4 * height / 3;
+			x = std::max(0, (s32(width) - w) / 2);
+		}
+		else if (s_displayMode == DMODE_ASPECT_CORRECT && !s_widescreen)
+		{
+			h = 3 * width / 4;
+			y = std::max(0, (s32(height) - h) / 2);
+		}
+		w = std::min(w, s32(width) - x);
+		h = std::min(h, s32(height) - y);
+
+		// 16.16 fixed point steps, the output rows are bottom-up to match glReadPixels() in the GPU backend.
+		const u32 du = (s_virtualWidth  << 16) / u32(w);
+		const u32 dv = (s_virtualHeight << 16) / u32(h);
+		u32 v = 0;
+		for (s32 yi = 0; yi < h; yi++, v += dv)
+		{
+			const u8* srcRow = &s_frontBuffer[(v >> 16) * s_virtualWidth];
+			u32* dstRow = &mem[(height - 1 - (y + yi)) * width + x];
+			u32 u = 0;
+			for (s32 xi = 0; xi < w; xi++, u += du)
+			{
+				dstRow[xi] = s_frontPalette[srcRow[u >> 16]];
+			}
+		}
+	}
+
+	// GPU commands
+	// Render targets and textures only track their dimensions.
+	RenderTargetHandle createRenderTarget(u32 width, u32 height, bool hasDepthBuffer)
+	{
+		NullRenderTarget* newTarget = new NullRenderTarget();
+		newTarget->texture = new TextureGpu();
+		newTarget->texture->create(width, height);
+		newTarget->hasDepthBuffer = hasDepthBuffer;
+
+		return RenderTargetHandle(newTarget);
+	}
+
+	void freeRenderTarget(RenderTargetHandle handle)
+	{
+		if (!handle) { return; }
+
+		NullRenderTarget* renderTarget = (NullRenderTarget*)handle;
+		delete renderTarget->texture;
+		delete renderTarget;
+	}
+
+	void bindRenderTarget(RenderTargetHandle handle)
+	{
+	}
+
+	void clearRenderTarget(RenderTargetHandle handle, const f32* clearColor, f32 clearDepth)
+	{
+	}
+
+	void clearRenderTargetDepth(RenderTargetHandle handle, f32 clearDepth)
+	{
+	}
+
+	void copyRenderTarget(RenderTargetHandle dst, RenderTargetHandle src)
+	{
+	}
+
+	void unbindRenderTarget()
+	{
+	}
+
+	const TextureGpu* getRenderTargetTexture(RenderTargetHandle rtHandle)
+	{
+		NullRenderTarget* renderTarget = (NullRenderTarget*)rtHandle;
+		return renderTarget->texture;
+	}
+
+	void getRenderTargetDim(RenderTargetHandle rtHandle, u32* width, u32* height)
+	{
+		NullRenderTarget* renderTarget = (NullRenderTarget*)rtHandle;
+		*width = renderTarget->texture->getWidth();
+		*height = renderTarget->texture->getHeight();
+	}
+
+	TextureGpu* createTexture(u32 width, u32 height, u32 channels)
+	{
+		TextureGpu* texture = new TextureGpu();
+		texture->create(width, height, channels);
+		return texture;
+	}
+
+	TextureGpu* createTextureArray(u32 width, u32 height, u32 layers, u32 channels)
+	{
+		TextureGpu* texture = new TextureGpu();
+		texture->createArray(width, height, layers, channels);
+		return texture;
+	}
+
+	TextureGpu* createTexture(u32 width, u32 height, const u32* data, MagFilter magFilter)
+	{
+		TextureGpu* texture = new TextureGpu();
+		texture->createWithData(width, height, data, magFilter);
+		return texture;
+	}
+
+	void freeTexture(TextureGpu* texture)
+	{
+		if (!texture) { return; }
+		delete texture;
+	}
+
+	void getTextureDim(TextureGpu* texture, u32* width, u32* height)
+	{
+		*width = texture->getWidth();
+		*height = texture->getHeight();
+	}
+
+	void* getGpuPtr(const TextureGpu* texture)
+	{
+		return nullptr;
+	}
+
+	void drawIndexedTriangles(u32 triCount, u32 indexStride, u32 indexStart)
+	{
+	}
+
+	void drawLines(u32 lineCount)
+	{
+	}
+}  // namespace
@@ -0,0 +1,62 @@
+#include <TFE_RenderBackend/shaderBuffer.h>
+
+// Large enough for any level, since there is no real limit without a GPU.
+static const s32 c_maxBufferSize = 1 << 27;
+
+ShaderBuffer::~ShaderBuffer()
+{
+	destroy();
+}
+
+bool ShaderBuffer::create(u32 count, const ShaderBufferDef& bufferDef, bool dynamic, void* initData)
+{
+	if (!count) { return false; }
+	m_initialized = true;
+
+	m_bufferDef = bufferDef;
+	m_stride  = m_bufferDef.channelCount * m_bufferDef.channelSize;
+	m_count   = count;
+	m_size    = m_stride * m_count;
+	m_dynamic = dynamic;
+	m_gpuHandle[0] = 0;
+	m_gpuHandle[1] = 0;
+	return true;
+}
+
+bool ShaderBuffer::createPersistent(u32 count, const ShaderBufferDef& bufferDef, const void* initData)
+{
+	return create(count, bufferDef, true, (void*)initData);
+}
+
+void ShaderBuffer::destroy()
+{
+	m_dirty.clear();
+	m_gpuHandle[0] = 0;
+	m_gpuHandle[1] = 0;
+	m_initialized = false;
+}
+
+void ShaderBuffer::update(const void* buffer, size_t size)
+{
+}
+
+void ShaderBuffer::markDirty(u32 first, u32 count)
+{
+}
+
+void ShaderBuffer::flush(const void* buffer)
+{
+}
+
+void ShaderBuffer::bind(s32 bindPoint) const
+{
+}
+
+void ShaderBuffer::unbind(s32 bindPoint) const
+{
+}
+
+s32 ShaderBuffer::getMaxSize()
+{
+	return c_maxBufferSize;
+}
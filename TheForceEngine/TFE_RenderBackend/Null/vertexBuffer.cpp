@@ -0,0 +1,36 @@
+#include <TFE_RenderBackend/vertexBuffer.h>
+
+VertexBuffer::~VertexBuffer()
+{
+	destroy();
+}
+
+bool VertexBuffer::create(u32 count, u32 stride, u32 attrCount, const AttributeMapping* attrMapping, bool dynamic, void* initData)
+{
+	if (!count || !stride) { return false; }
+
+	m_size = count * stride;
+	m_count = count;
+	m_stride = stride;
+	m_attrCount = attrCount;
+	m_dynamic = dynamic;
+	return true;
+}
+
+void VertexBuffer::destroy()
+{
+	m_size = 0;
+	m_count = 0;
+}
+
+void VertexBuffer::update(const void* buffer, size_t size)
+{
+}
+
+void VertexBuffer::bind()
+{
+}
+
+void VertexBuffer::unbind()
+{
+}
@@ -10,6 +10,7 @@ enum CapabilityFlags
 	CAP_UBO = (1 << 3),
 	CAP_NON_POW_2 = (1 << 4),
 	CAP_TEXTURE_ARRAY = (1 << 5),
+	CAP_BUFFER_STORAGE = (1 << 6),
 
 	CAP_2_1_FULL = (CAP_VBO | CAP_PBO | CAP_NON_POW_2),
 	CAP_3_3_FULL = (CAP_PBO | CAP_VBO | CAP_FBO | CAP_UBO | CAP_NON_POW_2 | CAP_TEXTURE_ARRAY)
@@ -20,6 +21,7 @@ namespace OpenGL_Caps
 	static u32 m_supportFlags = 0;
 	static u32 m_deviceTier = 0;
 	static s32 m_textureBufferMaxSize = 0;
+	static s32 m_textureBufferOffsetAlignment = 256;
 
 	enum SpecMinimum
 	{
@@ -35,9 +37,15 @@ namespace OpenGL_Caps
 		if (GLEW_ARB_uniform_buffer_object){ m_supportFlags |= CAP_UBO; }
 		if (GLEW_ARB_pixel_buffer_object)  { m_supportFlags |= CAP_NON_POW_2; }
 		if (GLEW_EXT_texture_array)        { m_supportFlags |= CAP_TEXTURE_ARRAY; }
+		if (GLEW_ARB_buffer_storage && GLEW_ARB_texture_buffer_range) { m_supportFlags |= CAP_BUFFER_STORAGE; }
 
 		// Get texture buffer maximum size.
 		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &m_textureBufferMaxSize);
+		if (m_supportFlags & CAP_BUFFER_STORAGE)
+		{
+			glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &m_textureBufferOffsetAlignment);
+			m_textureBufferOffsetAlignment = m_textureBufferOffsetAlignment > 0 ? m_textureBufferOffsetAlignment : 256;
+		}
 
 		if (GLEW_VERSION_4_5 && m_textureBufferMaxSize >= GLSPEC_MAX_TEXTURE_BUFFER_SIZE_MIN)
 		{
@@ -82,6 +90,11 @@ namespace OpenGL_Caps
 		return (m_supportFlags&CAP_TEXTURE_ARRAY) != 0;
 	}
 
+	bool supportsBufferStorage()
+	{
+		return (m_supportFlags&CAP_BUFFER_STORAGE) != 0;
+	}
+
 	bool deviceSupportsGpuBlit()
 	{
 		return m_deviceTier > DEV_TIER_0;
@@ -102,6 +115,11 @@ namespace OpenGL_Caps
 		return m_textureBufferMaxSize;
 	}
 
+	s32 getTextureBufferOffsetAlignment()
+	{
+		return m_textureBufferOffsetAlignment;
+	}
+
 	u32 getDeviceTier()
 	{
 		return m_deviceTier;
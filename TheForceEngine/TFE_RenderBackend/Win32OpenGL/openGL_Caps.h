@@ -22,6 +22,8 @@ namespace OpenGL_Caps
 	bool supportsFbo();
 	bool supportsNonPow2Textures();
 	bool supportsTextureArrays();
+	// Persistently mapped buffers used as texture buffers (GL 4.4 or ARB_buffer_storage + ARB_texture_buffer_range).
+	bool supportsBufferStorage();
 
 	bool deviceSupportsGpuBlit();
 	bool deviceSupportsGpuColorConversion();
@@ -29,4 +31,5 @@ namespace OpenGL_Caps
 
 	u32 getDeviceTier();
 	s32 getMaxTextureBufferSize();
+	s32 getTextureBufferOffsetAlignment();
 };
@@ -173,6 +173,11 @@ namespace TFE_RenderBackend
 		m_window = nullptr;
 	}
 
+	bool isHeadless()
+	{
+		return false;
+	}
+
 	bool getVsyncEnabled()
 	{
 		return SDL_GL_GetSwapInterval() > 0;
@@ -238,6 +243,21 @@ namespace TFE_RenderBackend
 		s_screenCapture->endRecording();
 	}
 
+	bool startStreamRecording(const char* path, s32 format)
+	{
+		return s_screenCapture->beginStreamRecording(path, format);
+	}
+
+	void stopStreamRecording()
+	{
+		s_screenCapture->endStreamRecording();
+	}
+
+	bool isStreamRecording()
+	{
+		return s_screenCapture->isStreamRecording();
+	}
+
 	void updateSettings()
 	{
 		TFE_Settings_Window* windowSettings = TFE_Settings::getWindowSettings();
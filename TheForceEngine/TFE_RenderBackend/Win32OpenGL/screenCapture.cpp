@@ -6,6 +6,7 @@
 #include <TFE_System/system.h>
 #include <TFE_Asset/imageAsset.h>	// For image saving, this should be refactored...
 #include <TFE_Asset/gifWriter.h>
+#include <TFE_Asset/videoStreamWriter.h>
 #include <GL/glew.h>
 #include <assert.h>
 
@@ -32,6 +33,7 @@ namespace
 
 ScreenCapture::~ScreenCapture()
 {
+	endStreamRecording();
 	freeBuffers();
 }
 
@@ -46,6 +48,12 @@ bool ScreenCapture::create(u32 width, u32 height, u32 bufferCount)
 void ScreenCapture::resize(u32 newWidth, u32 newHeight)
 {
 	if (newWidth == m_width && newHeight == m_height) { return; }
+	// The video stream has a fixed size.
+	if (m_streaming)
+	{
+		TFE_System::logWrite(LOG_WARNING, "ScreenCapture", "The window was resized, video recording stopped.");
+		endStreamRecording();
+	}
 	// Flush any pending screenshots.
 	update(true);
 
@@ -84,6 +92,8 @@ bool ScreenCapture::changeBufferCount(u32 newBufferCount, bool forceRealloc/* =
 	{
 		m_captures[i].bufferIndex = 0;
 		m_captures[i].frame = -1;
+		m_captures[i].time = 0.0;
+		m_captures[i].stream = false;
 		m_captures[i].imageData.resize(bufferSize);
 	}
 
@@ -130,54 +140,87 @@ void ScreenCapture::update(bool flush)
 			m_recordingFrameLast = recordingFrame;
 		}
 	}
+	// Every frame is captured when streaming.
+	else if (m_streaming)
+	{
+		queueCapture("", true);
+	}
 
-	// Handle capture
+	// Handle capture, reading back every frame that is ready.
 	m_frame++;
-	if (!m_captureCount) { return; }
-	
-	bool popHead = false;
+	while (m_captureCount && readCaptureHead(flush)) {}
+
+	// Handle write to disk or adding a frame to the recording.
+	if (m_recordingStarted && (m_readCount >= RECORD_FLUSH_COUNT || flush))
+	{
+		// Save the images.
+		recordImages();
+	}
+	else if (!m_recordingStarted && (m_readCount >= FLUSH_READ_COUNT || flush))
+	{
+		writeFramesToDisk();
+	}
+}
+
+// Read back the oldest capture if it is ready or 'force' is set.
+// Streamed frames are copied directly into the video stream.
+bool ScreenCapture::readCaptureHead(bool force)
+{
+	Capture* capture = &m_captures[m_captureHead];
+	if (OpenGL_Caps::supportsPbo() && !force && m_frame <= capture->frame + CAPTURE_FRAME_DELAY)
+	{
+		return false;
+	}
+
+	const size_t size = capture->imageData.size();
+	u8* output = capture->stream ? TFE_VideoStream::beginFrame() : capture->imageData.data();
 	if (!OpenGL_Caps::supportsPbo())
 	{
 		glReadBuffer(GL_BACK);
-		glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_captures[m_captureHead].imageData.data());
-		popHead = true;
+		glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, output);
 	}
-	else if (flush || m_frame > (m_captures[m_captureHead].frame + CAPTURE_FRAME_DELAY))
+	else
 	{
 		// Copy from staging data to read buffer [readBuffer].
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_stagingBuffers[m_captures[m_captureHead].bufferIndex]);
-		void* imageData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_captures[m_captureHead].imageData.size(), GL_MAP_READ_BIT);
-		memcpy(m_captures[m_captureHead].imageData.data(), imageData, m_captures[m_captureHead].imageData.size());
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_stagingBuffers[capture->bufferIndex]);
+		void* imageData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		if (imageData && output)
+		{
+			memcpy(output, imageData, size);
+		}
 		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
 
 		// Cleanup.
 		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 		CHECK_GL_ERROR
-
-		popHead = true;
-	}
-
-	if (popHead)
-	{
-		m_readIndex[m_readCount++] = m_captureHead;
-		m_captureHead = (m_captureHead + 1) % m_bufferCount;
-		m_captureCount--;
 	}
 
-	// Handle write to disk or adding a frame to the recording.
-	if (m_recordingStarted && (m_readCount >= RECORD_FLUSH_COUNT || flush))
+	if (capture->stream)
 	{
-		// Save the images.
-		recordImages();
+		TFE_VideoStream::endFrame(capture->time);
 	}
-	else if (!m_recordingStarted && (m_readCount >= FLUSH_READ_COUNT || flush))
+	else
 	{
-		writeFramesToDisk();
+		m_readIndex[m_readCount++] = m_captureHead;
 	}
+	m_captureHead = (m_captureHead + 1) % m_bufferCount;
+	m_captureCount--;
+	return true;
 }
 
 void ScreenCapture::captureFrame(const char* outputPath)
 {
+	queueCapture(outputPath, false);
+}
+
+void ScreenCapture::queueCapture(const char* outputPath, bool stream)
+{
+	// All of the buffers are in use, so read back the oldest capture now.
+	if (m_captureCount >= m_bufferCount)
+	{
+		readCaptureHead(true);
+	}
+
 	if (m_bufferCount > 1 && OpenGL_Caps::supportsPbo())
 	{
 		// Async copy from GPU data to staging buffer [writeBuffer].
@@ -189,6 +232,8 @@ void ScreenCapture::captureFrame(const char* outputPath)
 	m_captures[index].bufferIndex = m_writeBuffer;
 	m_captures[index].outputPath = outputPath;
 	m_captures[index].frame = m_frame;
+	m_captures[index].time = TFE_System::getTime();
+	m_captures[index].stream = stream;
 	m_captureCount++;
 
 	// Update buffer indices.
@@ -214,6 +259,32 @@ void ScreenCapture::endRecording()
 	TFE_GIF::write();
 }
 
+bool ScreenCapture::beginStreamRecording(const char* path, s32 format)
+{
+	if (m_recordingStarted || m_streaming) { return false; }
+
+	DisplayInfo displayInfo;
+	TFE_RenderBackend::getDisplayInfo(&displayInfo);
+	const u32 fps = displayInfo.refreshRate ? u32(displayInfo.refreshRate) : 60u;
+	m_streaming = TFE_VideoStream::start(path, m_width, m_height, fps, VideoStreamFormat(format));
+	return m_streaming;
+}
+
+void ScreenCapture::endStreamRecording()
+{
+	if (!m_streaming) { return; }
+
+	// Read back the frames still in flight.
+	while (m_captureCount)
+	{
+		readCaptureHead(true);
+	}
+	writeFramesToDisk();
+	m_streaming = false;
+
+	TFE_VideoStream::finish();
+}
+
 void ScreenCapture::writeFramesToDisk()
 {
 	if (!m_readCount) { return; }
@@ -1,6 +1,9 @@
 #pragma once
 //////////////////////////////////////////////////////////////////////
-// Dynamic multi-buffered texture.
+// Screen capture, using a ring of pixel buffers so frames are read
+// back a few frames after they are captured without stalling.
+// Supports screenshots, GIF recording and streaming every frame to
+// disk (see TFE_Asset/videoStreamWriter.h).
 //////////////////////////////////////////////////////////////////////
 
 #include <TFE_System/types.h>
@@ -11,7 +14,7 @@
 class ScreenCapture
 {
 public:
-	ScreenCapture() : m_bufferCount(0), m_writeBuffer(0), m_readIndex(nullptr), m_stagingBuffers(nullptr), m_frame(0), m_readCount(0), m_recordingFrame(0) {}
+	ScreenCapture() : m_bufferCount(0), m_writeBuffer(0), m_readIndex(nullptr), m_stagingBuffers(nullptr), m_frame(0), m_readCount(0), m_recordingStarted(false), m_recordingFrame(0), m_captures(nullptr) {}
 	~ScreenCapture();
 
 	bool create(u32 width, u32 height, u32 bufferCount);
@@ -25,6 +28,11 @@ public:
 
 	void beginRecording(const char* path);
 	void endRecording();
+
+	// Stream every frame to disk, 'format' is a VideoStreamFormat.
+	bool beginStreamRecording(const char* path, s32 format);
+	void endStreamRecording();
+	bool isStreamRecording() const { return m_streaming; }
 	
 private:
 	struct Capture
@@ -34,6 +42,8 @@ private:
 
 		u32 bufferIndex;
 		s32 frame;
+		f64 time;
+		bool stream;	// The frame goes to the video stream instead of 'imageData'.
 	};
 
 	u32 m_bufferCount;
@@ -55,6 +65,7 @@ private:
 	s32 m_recordingFrameStart = 0;
 	f64 m_recordingTimeStart = 0.0;
 	f64 m_recordingFrameLast = 0.0;
+	bool m_streaming = false;
 
 	Capture* m_captures;
 	u32* m_stagingBuffers;
@@ -63,4 +74,6 @@ private:
 	void freeBuffers();
 	void writeFramesToDisk();
 	void recordImages();
+	void queueCapture(const char* outputPath, bool stream);
+	bool readCaptureHead(bool force);
 };
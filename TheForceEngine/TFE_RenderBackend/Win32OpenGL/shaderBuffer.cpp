@@ -1,8 +1,14 @@
 #include <TFE_RenderBackend/shaderBuffer.h>
 #include <GL/glew.h>
 #include <memory.h>
+#include <algorithm>
 #include "openGL_Caps.h"
 
+// Ranges closer than this are uploaded together, since each upload has a fixed cost.
+static const u32 c_dirtyMergeGap = 256;
+// Wait 1ms at a time when a region is still in use by the GPU.
+static const GLuint64 c_fenceWaitTimeout = 1000000;
+
 GLenum getFormat(const ShaderBufferDef& bufferDef);
 
 ShaderBuffer::~ShaderBuffer()
@@ -41,25 +47,235 @@ bool ShaderBuffer::create(u32 count, const ShaderBufferDef& bufferDef, bool dyna
 	return true;
 }
 
+bool ShaderBuffer::createPersistent(u32 count, const ShaderBufferDef& bufferDef, const void* initData)
+{
+	if (!OpenGL_Caps::supportsBufferStorage())
+	{
+		return create(count, bufferDef, true, (void*)initData);
+	}
+
+	if (!count) { return false; }
+	GLenum internalFormat = getFormat(bufferDef);
+	if (internalFormat == GL_INVALID_ENUM)
+	{
+		return false;
+	}
+	m_initialized = true;
+
+	m_bufferDef = bufferDef;
+	m_stride  = m_bufferDef.channelCount * m_bufferDef.channelSize;
+	m_count   = count;
+	m_size    = m_stride * m_count;
+	m_dynamic = true;
+
+	// Each region must start at a valid texture buffer offset.
+	const u32 alignment = u32(OpenGL_Caps::getTextureBufferOffsetAlignment());
+	m_regionSize = (m_size + alignment - 1) / alignment * alignment;
+	m_region = 0;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &m_gpuHandle[0]);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_gpuHandle[0]);
+	glBufferStorage(GL_TEXTURE_BUFFER, m_regionSize * SHADER_BUFFER_REGION_COUNT, nullptr, flags);
+	m_mapped = (u8*)glMapBufferRange(GL_TEXTURE_BUFFER, 0, m_regionSize * SHADER_BUFFER_REGION_COUNT, flags);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	if (!m_mapped)
+	{
+		glDeleteBuffers(1, &m_gpuHandle[0]);
+		m_gpuHandle[0] = 0;
+		m_initialized = false;
+		return create(count, bufferDef, true, (void*)initData);
+	}
+
+	for (s32 i = 0; i < SHADER_BUFFER_REGION_COUNT; i++)
+	{
+		if (initData)
+		{
+			memcpy(m_mapped + m_regionSize * i, initData, m_size);
+		}
+		else
+		{
+			memset(m_mapped + m_regionSize * i, 0, m_size);
+		}
+		m_fence[i] = nullptr;
+		m_regionDirty[i].clear();
+	}
+	m_dirty.clear();
+
+	glGenTextures(1, &m_gpuHandle[1]);
+	glBindTexture(GL_TEXTURE_BUFFER, m_gpuHandle[1]);
+	glTexBufferRange(GL_TEXTURE_BUFFER, internalFormat, m_gpuHandle[0], 0, m_size);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	return true;
+}
+
 void ShaderBuffer::destroy()
 {
 	if (m_initialized)
 	{
+		for (s32 i = 0; i < SHADER_BUFFER_REGION_COUNT; i++)
+		{
+			if (m_fence[i]) { glDeleteSync((GLsync)m_fence[i]); }
+			m_fence[i] = nullptr;
+			m_regionDirty[i].clear();
+		}
+		if (m_mapped && m_gpuHandle[0])
+		{
+			glBindBuffer(GL_TEXTURE_BUFFER, m_gpuHandle[0]);
+			glUnmapBuffer(GL_TEXTURE_BUFFER);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		}
 		if (m_gpuHandle[1]) { glDeleteTextures(1, &m_gpuHandle[1]); }
 		if (m_gpuHandle[0]) { glDeleteBuffers(1, &m_gpuHandle[0]); }
 	}
 	m_gpuHandle[0] = 0;
 	m_gpuHandle[1] = 0;
+	m_mapped = nullptr;
+	m_regionSize = 0;
+	m_dirty.clear();
 	m_initialized = false;
 }
 
 void ShaderBuffer::update(const void* buffer, size_t size)
 {
+	if (m_mapped)
+	{
+		// The storage of a persistent buffer cannot be reallocated, so treat this as a change to the whole range.
+		m_dirty.clear();
+		markDirty(0, u32(std::min(size, size_t(m_size)) / m_stride));
+		flush(buffer);
+		return;
+	}
 	glBindBuffer(GL_TEXTURE_BUFFER, m_gpuHandle[0]);
 	glBufferData(GL_TEXTURE_BUFFER, size, buffer, m_dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 	glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
+void ShaderBuffer::markDirty(u32 first, u32 count)
+{
+	if (!count || first >= m_count) { return; }
+	const u32 start = first * m_stride;
+	const u32 end = std::min(first + count, m_count) * m_stride;
+
+	// Records are usually updated in order, so try to extend the last range first.
+	if (!m_dirty.empty())
+	{
+		DirtyRange& last = m_dirty.back();
+		if (start <= last.end + c_dirtyMergeGap && end + c_dirtyMergeGap >= last.start)
+		{
+			last.start = std::min(last.start, start);
+			last.end = std::max(last.end, end);
+			return;
+		}
+	}
+	m_dirty.push_back({ start, end });
+}
+
+// Sort and merge ranges that overlap or are close together, returns the number of bytes covered.
+u32 ShaderBuffer::coalesceRanges(std::vector<DirtyRange>& ranges)
+{
+	if (ranges.empty()) { return 0; }
+	std::sort(ranges.begin(), ranges.end(), [](const DirtyRange& a, const DirtyRange& b) { return a.start < b.start; });
+
+	size_t outCount = 0;
+	for (size_t i = 1; i < ranges.size(); i++)
+	{
+		DirtyRange& cur = ranges[outCount];
+		if (ranges[i].start <= cur.end + c_dirtyMergeGap)
+		{
+			cur.end = std::max(cur.end, ranges[i].end);
+		}
+		else
+		{
+			outCount++;
+			ranges[outCount] = ranges[i];
+		}
+	}
+	ranges.resize(outCount + 1);
+
+	u32 totalSize = 0;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		totalSize += ranges[i].end - ranges[i].start;
+	}
+	return totalSize;
+}
+
+void ShaderBuffer::waitOnRegion(u32 region)
+{
+	GLsync fence = (GLsync)m_fence[region];
+	if (!fence) { return; }
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, c_fenceWaitTimeout);
+	}
+	glDeleteSync(fence);
+	m_fence[region] = nullptr;
+}
+
+void ShaderBuffer::copyToRegion(u32 region, const void* buffer, std::vector<DirtyRange>& ranges)
+{
+	coalesceRanges(ranges);
+	u8* dst = m_mapped + m_regionSize * region;
+	const u8* src = (const u8*)buffer;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		memcpy(dst + ranges[i].start, src + ranges[i].start, ranges[i].end - ranges[i].start);
+	}
+	ranges.clear();
+}
+
+void ShaderBuffer::flush(const void* buffer)
+{
+	if (m_dirty.empty() || !buffer) { return; }
+
+	if (m_mapped)
+	{
+		// Draws issued so far read from the current region, so fence it before moving on to the next one.
+		if (m_fence[m_region]) { glDeleteSync((GLsync)m_fence[m_region]); }
+		m_fence[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		// Every region needs the new data eventually, but only the next region is written now.
+		for (s32 i = 0; i < SHADER_BUFFER_REGION_COUNT; i++)
+		{
+			m_regionDirty[i].insert(m_regionDirty[i].end(), m_dirty.begin(), m_dirty.end());
+		}
+		m_dirty.clear();
+
+		m_region = (m_region + 1) % SHADER_BUFFER_REGION_COUNT;
+		waitOnRegion(m_region);
+		copyToRegion(m_region, buffer, m_regionDirty[m_region]);
+
+		glBindTexture(GL_TEXTURE_BUFFER, m_gpuHandle[1]);
+		glTexBufferRange(GL_TEXTURE_BUFFER, getFormat(m_bufferDef), m_gpuHandle[0], m_regionSize * m_region, m_size);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		return;
+	}
+
+	const u32 dirtySize = coalesceRanges(m_dirty);
+	const u32 start = m_dirty.front().start;
+	const u32 end = m_dirty.back().end;
+	const u8* src = (const u8*)buffer;
+	glBindBuffer(GL_TEXTURE_BUFFER, m_gpuHandle[0]);
+	if (dirtySize >= (end - start) / 2)
+	{
+		// Most of the span changed, a single upload is cheaper.
+		glBufferSubData(GL_TEXTURE_BUFFER, start, end - start, src + start);
+	}
+	else
+	{
+		for (size_t i = 0; i < m_dirty.size(); i++)
+		{
+			glBufferSubData(GL_TEXTURE_BUFFER, m_dirty[i].start, m_dirty[i].end - m_dirty[i].start, src + m_dirty[i].start);
+		}
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	m_dirty.clear();
+}
+
 void ShaderBuffer::bind(s32 bindPoint) const
 {
 	if (bindPoint < 0) { return; }
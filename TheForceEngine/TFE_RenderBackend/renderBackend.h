@@ -92,6 +92,8 @@ namespace TFE_RenderBackend
 {
 	bool init(const WindowState& state);
 	void destroy();
+	// Returns true if the backend has no window or GPU device (see Null/renderBackend.cpp).
+	bool isHeadless();
 	bool getVsyncEnabled();
 	void enableVsync(bool enable);
 
@@ -100,6 +102,11 @@ namespace TFE_RenderBackend
 	void queueScreenshot(const char* screenshotPath);
 	void startGifRecording(const char* path);
 	void stopGifRecording();
+	// Record every frame to a video stream on disk, 'format' is a VideoStreamFormat (see TFE_Asset/videoStreamWriter.h).
+	bool startStreamRecording(const char* path, s32 format);
+	void stopStreamRecording();
+	// Returns false once the stream has stopped, including when a resize ends it.
+	bool isStreamRecording();
 	void captureScreenToMemory(u32* mem);
 
 	void resize(s32 width, s32 height);
@@ -4,9 +4,18 @@
 // Buffer Textures or Shader Storage Buffers depending on capabilities.
 // Typically hardware will be limited to strides as: 
 //   * 1, 2, or 4 channels
+//
+// Buffers that are mostly static but change a few records at a time
+// (such as the level sector and wall data) can be updated
+// incrementally: changed elements are tracked with markDirty() and
+// flush() uploads only those ranges. When the buffer is created with
+// createPersistent() and the driver supports it, the storage is
+// persistently mapped and triple-buffered so that updates are written
+// directly without stalling on draws still using the previous data.
 //////////////////////////////////////////////////////////////////////
 
 #include <TFE_System/types.h>
+#include <vector>
 
 enum BufferChannelType
 {
@@ -24,16 +33,28 @@ struct ShaderBufferDef
 	BufferChannelType channelType;
 };
 
+enum ShaderBufferConstants
+{
+	SHADER_BUFFER_REGION_COUNT = 3,
+};
+
 class ShaderBuffer
 {
 public:
-	ShaderBuffer() : m_stride(0), m_count(0), m_size(0), m_initialized(false) {}
+	ShaderBuffer() : m_stride(0), m_count(0), m_size(0), m_initialized(false), m_regionSize(0), m_region(0), m_mapped(nullptr), m_fence() {}
 	~ShaderBuffer();
 
 	bool create(u32 count, const ShaderBufferDef& bufferDef, bool dynamic, void* initData = nullptr);
+	// Create a buffer that is updated using markDirty() and flush(), falls back to a regular dynamic buffer if
+	// persistent mapping is not supported.
+	bool createPersistent(u32 count, const ShaderBufferDef& bufferDef, const void* initData);
 	void destroy();
 
 	void update(const void* buffer, size_t size);
+	// Mark 'count' elements starting at 'first' as changed.
+	void markDirty(u32 first, u32 count);
+	// Upload the changed ranges, 'buffer' holds the full buffer contents.
+	void flush(const void* buffer);
 	void bind(s32 bindPoint) const;
 	void unbind(s32 bindPoint) const;
 
@@ -42,6 +63,16 @@ public:
 	static s32 getMaxSize();
 
 private:
+	struct DirtyRange
+	{
+		u32 start;
+		u32 end;
+	};
+
+	static u32 coalesceRanges(std::vector<DirtyRange>& ranges);
+	void copyToRegion(u32 region, const void* buffer, std::vector<DirtyRange>& ranges);
+	void waitOnRegion(u32 region);
+
 	ShaderBufferDef m_bufferDef;
 	u32 m_stride;
 	u32 m_count;
@@ -49,4 +80,14 @@ private:
 	u32 m_gpuHandle[2];
 	bool m_dynamic;
 	bool m_initialized;
+
+	// Dirty ranges in bytes, since the last flush.
+	std::vector<DirtyRange> m_dirty;
+	// Persistent mapping, each region holds a full copy of the buffer.
+	u32 m_regionSize;
+	u32 m_region;
+	u8* m_mapped;
+	void* m_fence[SHADER_BUFFER_REGION_COUNT];
+	// Ranges that still need to be copied into each region.
+	std::vector<DirtyRange> m_regionDirty[SHADER_BUFFER_REGION_COUNT];
 };
@@ -1,7 +1,11 @@
+#include <climits>
 #include <cstring>
 
+#include <TFE_System/system.h>
 #include <TFE_System/profiler.h>
 #include <TFE_System/math.h>
+#include <TFE_System/Threads/thread.h>
+#include <TFE_System/Threads/signal.h>
 #include <TFE_Asset/modelAsset_jedi.h>
 #include <TFE_Game/igame.h>
 #include <TFE_Jedi/Level/level.h>
@@ -20,9 +24,12 @@
 #include <TFE_RenderShared/texturePacker.h>
 
 #include <TFE_Asset/imageAsset.h>
-#include <TFE_Memory/chunkedArray.h>
+#include <TFE_FileSystem/filestream.h>
+#include <TFE_FileSystem/fileutil.h>
+#include <TFE_FileSystem/paths.h>
 
-#include <map>
+#include <algorithm>
+#include <unordered_map>
 
 #define DEBUG_TEXTURE_ATLAS 0
 
@@ -35,44 +42,125 @@ namespace TFE_DarkForces
 
 namespace TFE_Jedi
 {
-	struct TextureNode
+	struct SkylineNode
 	{
-		TextureNode* child[2] = { 0 };	// Binary tree.
-		Vec4ui rect = { 0 };
-		void* tex = nullptr;
-		s32 pageId = 0;
+		s32 x;
+		s32 y;
+		s32 width;
+	};
+
+	// Which entry in the sorted texture list (and which animation frame) produced a packed texture.
+	// This allows a cached packing to be applied to the same list without packing it again.
+	struct PackAssignment
+	{
+		s32 listIndex;
+		s32 frame;
+	};
+
+	enum PackJobType
+	{
+		PACKJOB_TEXTURE = 0,	// Column-major texture.
+		PACKJOB_DELT_TEXTURE,	// Row-major, bottom-up texture.
+		PACKJOB_WAX_CELL,		// Sprite cell, possibly compressed.
+		PACKJOB_WRITE_CACHE,	// Write a packing to the atlas cache once its textures have been copied.
+		PACKJOB_READ_CACHE,		// Copy cached pages into the atlas.
+	};
+
+	// Jobs are executed in order on the texture packer thread.
+	struct PackJob
+	{
+		PackJobType type;
+		u8* output;				// Top left of the texture in the page.
+		s32 stride;				// Page width.
+		const void* src;		// TextureData, WaxCell or AtlasCacheEntry.
+		const void* basePtr;	// Sprite base pointer for cells.
 	};
 
 	enum
 	{
-		TIGHT_FIT_PIXELS = 2,
 		MAX_TEXTURE_COUNT = 16384,
 		MAX_TEXTURE_PAGES = 16,
+		MAX_PACK_JOBS = 32768,			// Power of two, so the ring index stays continuous when the job counters wrap.
+		PACK_JOB_BATCH = 32,			// Wake up the worker after this many jobs have been queued.
+	};
+
+	/////////////////////////////////////////////
+	// Atlas Cache
+	/////////////////////////////////////////////
+	enum AtlasCacheConstants : u32
+	{
+		ATLAS_CACHE_MAGIC = 0x43505441,	// 'ATPC'
+		ATLAS_CACHE_VERSION = 1,
+		ATLAS_CACHE_MAX_SIZE = 256 * 1024 * 1024,	// Least recently used entries are deleted beyond this size.
+	};
+
+	// Followed by PackAssignment[textureCount], Vec4i[textureCount], then an AtlasCachePage
+	// and its skyline for each page, then the texels of each page for rows [0, usedHeight).
+	struct AtlasCacheHeader
+	{
+		u32 magic;
+		u32 version;
+		u64 key;
+		s32 width;
+		s32 height;
+		s32 startId;		// First texture ID, textures [startId, endId) are stored.
+		s32 endId;
+		s32 startPage;		// Pages [startPage, endPage) are stored.
+		s32 endPage;
+	};
+
+	struct AtlasCachePage
+	{
+		s32 textureCount;
+		s32 usedHeight;
+		s32 skylineCount;
+		s32 pad;
+	};
+
+	struct AtlasCacheEntry
+	{
+		AtlasCacheHeader header;
+		std::vector<u8> data;		// Everything after the header, texels are only included when reading.
+		size_t texelOffset;			// Offset of the texels in 'data' when reading.
+		u8* pages[MAX_TEXTURE_PAGES];
+		s32 usedHeight[MAX_TEXTURE_PAGES];
 	};
 
-	static std::vector<TextureNode*> s_nodes;
-	static TextureNode* s_root;
 	static TexturePacker* s_texturePacker;
-	static std::map<TextureData*, s32> s_textureDataMap;
-	static std::map<WaxCell*, s32> s_waxDataMap;
+	static std::unordered_map<TextureData*, s32> s_textureDataMap;
+	static std::unordered_map<WaxCell*, s32> s_waxDataMap;
+	static std::unordered_map<const void*, s32> s_hashDataMap;
 	static std::vector<TextureInfo> s_texInfoPool;
 	static std::vector<TextureInfo*> s_unpackedTextures[2];
-	static ChunkedArray* s_nodePool = nullptr;
-	static MemoryRegion* s_texturePackerRegion = nullptr;
+	static std::vector<PackAssignment> s_assignments;
 
-	static s32 s_usedTexels = 0;
 	static s32 s_totalTexels = 0;
-	static s32 s_nodePoolIndex = 0;
 	static s32 s_unpackedBuffer = 0;
 	static s32 s_currentPage = 0;
+	static s32 s_curListIndex = 0;
+	static u64 s_packHash = 0;			// Hash of the packer state, updated by each pack.
+	static u64 s_reservedPackHash = 0;	// Hash of the packer state when the pages were reserved.
+
+	// Worker
+	static Thread* s_packThread = nullptr;
+	static Signal* s_packStart = nullptr;
+	static Signal* s_packIdle = nullptr;
+	static atomic_bool s_packThreadRunning;
+	// The job counters only increase, jobs are stored in a ring buffer indexed by the counter.
+	static atomic_u32 s_packJobsQueued;
+	static atomic_u32 s_packJobsDone;
+	static PackJob* s_packJobs = nullptr;
 
 	// Global Packer
 	static const char* c_globalTexturePackerName = "GameTextures";
 	static const s32   c_globalPageWidth = 4096;
 	static const s32   c_globalPageReserveCount = 1;
+	static const u64   c_packHashSeed = 0xcbf29ce484222325ull;
 	static TexturePacker* s_globalTexturePacker = nullptr;
 
-	TextureNode* allocateNode();
+	void texturepacker_waitForJobs();
+	void texturepacker_stopWorker();
+	void atlasCache_writeEntry(AtlasCacheEntry* entry);
 
 #if DEBUG_TEXTURE_ATLAS
 	void debug_writeOutAtlas();
@@ -84,23 +172,27 @@ namespace TFE_Jedi
 		memset(page, 0, sizeof(TexturePage));
 		page->backingMemory = (u8*)malloc(width * height);
 		memset(page->backingMemory, 0, width * height);
-		page->root = nullptr;
+		// The skyline never has more nodes than the page is wide.
+		page->skyline = (SkylineNode*)malloc(sizeof(SkylineNode) * (width + 1));
+		page->skylineCount = 0;
 		page->textureCount = 0;
 		return page;
 	}
-				
+
+	void freeTexturePage(TexturePage* page)
+	{
+		if (!page) { return; }
+		free(page->backingMemory);
+		free(page->skyline);
+		free(page);
+	}
+
 	// Initialize the texture packer once, it is persistent across levels.
 	TexturePacker* texturepacker_init(const char* name, s32 width, s32 height)
 	{
 		TexturePacker* texturePacker = (TexturePacker*)malloc(sizeof(TexturePacker));
 		if (!texturePacker) { return nullptr; }
 
-		if (!s_nodePool)
-		{
-			s_texturePackerRegion = TFE_Memory::region_create("game", 8 * 1024 * 1024);
-			s_nodePool = TFE_Memory::createChunkedArray(sizeof(TextureNode), 256, 1, s_texturePackerRegion);
-		}
-
 		// Initialize with one page.
 		texturePacker->pageCount = 1;
 		texturePacker->reservedPages = 0;
@@ -111,6 +203,8 @@ namespace TFE_Jedi
 			texturepacker_destroy(texturePacker);
 			return nullptr;
 		}
+		// Pages are kept once allocated so they can be reused by later levels.
+		memset(texturePacker->pages, 0, sizeof(TexturePage*) * MAX_TEXTURE_PAGES);
 		texturePacker->pages[0] = allocateTexturePage(width, height);
 
 		texturePacker->textureTable = (Vec4i*)malloc(sizeof(Vec4i) * MAX_TEXTURE_COUNT);	// 256Kb (count can be up to 64K).
@@ -140,25 +234,28 @@ namespace TFE_Jedi
 	void texturepacker_destroy(TexturePacker* texturePacker)
 	{
 		if (!texturePacker) { return; }
+		// Make sure the worker is not still writing into the pages.
+		texturepacker_waitForJobs();
 
 		TFE_RenderBackend::freeTexture(texturePacker->texture);
 		texturePacker->textureTableGPU.destroy();
 		free(texturePacker->textureTable);
-		for (s32 p = 0; p < texturePacker->pageCount; p++)
+		if (texturePacker->pages)
 		{
-			free(texturePacker->pages[p]->backingMemory);
+			for (s32 p = 0; p < MAX_TEXTURE_PAGES; p++)
+			{
+				freeTexturePage(texturePacker->pages[p]);
+			}
 		}
 		free(texturePacker->pages);
 		free(texturePacker);
-
-		TFE_Memory::region_destroy(s_texturePackerRegion);
-		s_texturePackerRegion = nullptr;
 	}
-		
+
 	void texturepacker_reserveCommitedPages(TexturePacker* texturePacker)
 	{
 		texturePacker->reservedPages = texturePacker->pageCount;
 		texturePacker->reservedTexturesPacked = texturePacker->texturesPacked;
+		s_reservedPackHash = s_packHash;
 	}
 
 	bool texturepacker_hasReservedPages(TexturePacker* texturePacker)
@@ -169,163 +266,189 @@ namespace TFE_Jedi
 	void texturepacker_discardUnreservedPages(TexturePacker* texturePacker)
 	{
 		if (!texturepacker_hasReservedPages(texturePacker)) { return; }
+		texturepacker_waitForJobs();
+
 		// Clear pages.
 		for (s32 p = 0; p < s_texturePacker->reservedPages; p++)
 		{
-			s_texturePacker->pages[p]->root = nullptr;
+			s_texturePacker->pages[p]->skylineCount = 0;
 		}
 		for (s32 p = s_texturePacker->reservedPages; p < s_texturePacker->pageCount; p++)
 		{
-			s_texturePacker->pages[p]->root = nullptr;
+			s_texturePacker->pages[p]->skylineCount = 0;
 			s_texturePacker->pages[p]->textureCount = 0;
 		}
 
-		TFE_Memory::chunkedArrayClear(s_nodePool);
 		s_textureDataMap.clear();
 		s_waxDataMap.clear();
 		s_texInfoPool.clear();
 
-		// Insert the parent that covers all of the available space.
 		s_texturePacker->pageCount = s_texturePacker->reservedPages;
 		s_texturePacker->texturesPacked = s_texturePacker->reservedTexturesPacked;
-	}
-		
-	bool textureFitsInNode(TextureNode* cur, u32 width, u32 height)
-	{
-		return width <= cur->rect.z && height <= cur->rect.w;
+		s_packHash = s_reservedPackHash;
 	}
 
-	bool textureTightFit(TextureNode* cur, u32 width, u32 height)
+	/////////////////////////////////////////////
+	// Skyline packing
+	/////////////////////////////////////////////
+	// Returns the y position if a (width x height) rectangle fits with its left edge at skyline node 'index', otherwise -1.
+	s32 skyline_fit(const TexturePage* page, s32 index, s32 width, s32 height)
 	{
-		return (cur->rect.z - width <= TIGHT_FIT_PIXELS) && (cur->rect.w - height <= TIGHT_FIT_PIXELS);
+		const SkylineNode* skyline = page->skyline;
+		if (skyline[index].x + width > s_texturePacker->width) { return -1; }
+
+		s32 y = skyline[index].y;
+		s32 widthLeft = width;
+		for (s32 i = index; widthLeft > 0; i++)
+		{
+			y = max(y, skyline[i].y);
+			if (y + height > s_texturePacker->height) { return -1; }
+			widthLeft -= skyline[i].width;
+		}
+		return y;
 	}
 
-	TextureNode* insertNode(TextureNode* cur, void* tex, u32 width, u32 height)
+	// Place the rectangle at the position that leaves the lowest top edge, using the narrowest node to break ties.
+	bool skyline_insert(TexturePage* page, s32 width, s32 height, s32* outX, s32* outY)
 	{
-		TextureNode* newNode = nullptr;
-		if (!s_root)
+		s32 bestIndex = -1, bestTop = INT_MAX, bestWidth = INT_MAX, bestY = 0;
+		for (s32 i = 0; i < page->skylineCount; i++)
 		{
-			newNode = allocateNode();
-			newNode->child[0] = nullptr;
-			newNode->child[1] = nullptr;
-			newNode->rect = {0u, 0u, (u32)s_texturePacker->width, (u32)s_texturePacker->height};
-			newNode->tex  = tex;
-			s_root = newNode;
+			const s32 y = skyline_fit(page, i, width, height);
+			if (y < 0) { continue; }
 
-			s_nodes.push_back(newNode);
-			return newNode;
+			const s32 top = y + height;
+			if (top < bestTop || (top == bestTop && page->skyline[i].width < bestWidth))
+			{
+				bestIndex = i;
+				bestTop = top;
+				bestWidth = page->skyline[i].width;
+				bestY = y;
+			}
 		}
+		if (bestIndex < 0) { return false; }
 
-		// We are not a leaf...
-		if (cur->child[0])
-		{
-			// Try inserting left.
-			newNode = insertNode(cur->child[0], tex, width, height);
-			if (newNode) { return newNode; }
+		// Insert the new node.
+		SkylineNode* skyline = page->skyline;
+		const s32 x = skyline[bestIndex].x;
+		memmove(&skyline[bestIndex + 1], &skyline[bestIndex], sizeof(SkylineNode) * (page->skylineCount - bestIndex));
+		skyline[bestIndex] = { x, bestTop, width };
+		page->skylineCount++;
 
-			// Then right.
-			return insertNode(cur->child[1], tex, width, height);
-		}
-		else // Leaf node.
+		// Shrink or remove the nodes now covered by the new node.
+		for (s32 i = bestIndex + 1; i < page->skylineCount; )
 		{
-			// If the node is already full...
-			if (cur->tex) { return nullptr; }
+			const s32 right = skyline[i - 1].x + skyline[i - 1].width;
+			if (skyline[i].x >= right) { break; }
 
-			// Check to see if the texture fits.
-			if (!textureFitsInNode(cur, width, height)) { return nullptr; }
+			const s32 shrink = right - skyline[i].x;
+			if (skyline[i].width > shrink)
+			{
+				skyline[i].x += shrink;
+				skyline[i].width -= shrink;
+				break;
+			}
+			memmove(&skyline[i], &skyline[i + 1], sizeof(SkylineNode) * (page->skylineCount - i - 1));
+			page->skylineCount--;
+		}
 
-			// Check to see if it is a tight fit.
-			if (textureTightFit(cur, width, height))
+		// Merge neighbors at the same height.
+		for (s32 i = 0; i < page->skylineCount - 1; )
+		{
+			if (skyline[i].y == skyline[i + 1].y)
 			{
-				cur->tex = tex;
-				return cur;
+				skyline[i].width += skyline[i + 1].width;
+				memmove(&skyline[i + 1], &skyline[i + 2], sizeof(SkylineNode) * (page->skylineCount - i - 2));
+				page->skylineCount--;
 			}
+			else
+			{
+				i++;
+			}
+		}
 
-			// Split the node.
-			cur->child[0] = allocateNode();
-			cur->child[1] = allocateNode();
+		*outX = x;
+		*outY = bestY;
+		return true;
+	}
 
-			// Push nodes so they can be deleted later.
-			s_nodes.push_back(cur->child[0]);
-			s_nodes.push_back(cur->child[1]);
-			
-			// Binary split along the longest axis.
-			const s32 dw = cur->rect.z - width;
-			const s32 dh = cur->rect.w - height;
-			if (dw > dh)
+	s32 skyline_getUsedHeight(const TexturePage* page)
+	{
+		s32 usedHeight = 0;
+		for (s32 i = 0; i < page->skylineCount; i++)
+		{
+			usedHeight = max(usedHeight, page->skyline[i].y);
+		}
+		return usedHeight;
+	}
+
+	// Make sure the page exists and has been started.
+	void texturepacker_setupPage(s32 pageIndex)
+	{
+		if (pageIndex >= s_texturePacker->pageCount)
+		{
+			if (!s_texturePacker->pages[pageIndex])
 			{
-				cur->child[0]->rect = { cur->rect.x, cur->rect.y, width, cur->rect.w };
-				cur->child[1]->rect = { cur->rect.x + width, cur->rect.y, cur->rect.z - width, cur->rect.w };
+				s_texturePacker->pages[pageIndex] = allocateTexturePage(s_texturePacker->width, s_texturePacker->height);
 			}
 			else
 			{
-				cur->child[0]->rect = { cur->rect.x, cur->rect.y, cur->rect.z, height };
-				cur->child[1]->rect = { cur->rect.x, cur->rect.y + height, cur->rect.z, cur->rect.w - height };
+				memset(s_texturePacker->pages[pageIndex]->backingMemory, 0, s_texturePacker->width * s_texturePacker->height);
+				s_texturePacker->pages[pageIndex]->skylineCount = 0;
 			}
+			s_texturePacker->pages[pageIndex]->textureCount = 0;
+			s_texturePacker->pageCount = pageIndex + 1;
+		}
 
-			// Then insert into the first child.
-			return insertNode(cur->child[0], tex, width, height);
+		TexturePage* page = s_texturePacker->pages[pageIndex];
+		if (!page->skylineCount)
+		{
+			page->skyline[0] = { 0, 0, s_texturePacker->width };
+			page->skylineCount = 1;
 		}
 	}
-				
-	void packNode(const TextureNode* node, const TextureData* texData, Vec4i* tableEntry)
+
+	/////////////////////////////////////////////
+	// Copy jobs
+	/////////////////////////////////////////////
+	void packNode(const PackJob* job)
 	{
 		// Copy the texture into place.
+		const TextureData* texData = (const TextureData*)job->src;
 		const u8* srcImage = texData->image;
-		u8* output = &s_texturePacker->pages[s_currentPage]->backingMemory[node->rect.y * s_texturePacker->width + node->rect.x];
-		for (s32 y = 0; y < texData->height; y++, output += s_texturePacker->width)
+		u8* output = job->output;
+		for (s32 y = 0; y < texData->height; y++, output += job->stride)
 		{
 			for (s32 x = 0; x < texData->width; x++)
 			{
 				output[x] = srcImage[x*texData->height + y];
 			}
 		}
-		s_usedTexels += texData->width * texData->height;
-
-		// Copy the mapping into the texture table.
-		tableEntry->x = (s32)node->rect.x;
-		tableEntry->y = (s32)node->rect.y;
-		tableEntry->z = (s32)texData->width;
-		tableEntry->w = (s32)texData->height;
-
-		// Page the page index into the x offset.
-		tableEntry->x |= (s_currentPage << 12);
 	}
 
-	void packNodeDeltaTex(const TextureNode* node, const TextureData* texData, Vec4i* tableEntry)
+	void packNodeDeltaTex(const PackJob* job)
 	{
 		// Copy the texture into place.
+		const TextureData* texData = (const TextureData*)job->src;
 		const u8* srcImage = texData->image;
-		u8* output = &s_texturePacker->pages[s_currentPage]->backingMemory[node->rect.y * s_texturePacker->width + node->rect.x];
-		for (s32 y = 0; y < texData->height; y++, output += s_texturePacker->width)
+		u8* output = job->output;
+		for (s32 y = 0; y < texData->height; y++, output += job->stride)
 		{
-			for (s32 x = 0; x < texData->width; x++)
-			{
-				output[x] = srcImage[(texData->height - y - 1)*texData->width + x];
-			}
+			memcpy(output, &srcImage[(texData->height - y - 1)*texData->width], texData->width);
 		}
-		s_usedTexels += texData->width * texData->height;
-
-		// Copy the mapping into the texture table.
-		tableEntry->x = (s32)node->rect.x;
-		tableEntry->y = (s32)node->rect.y;
-		tableEntry->z = (s32)texData->width;
-		tableEntry->w = (s32)texData->height;
-
-		// Page the page index into the x offset.
-		tableEntry->x |= (s_currentPage << 12);
 	}
 
-	void packNodeCell(const TextureNode* node, const void* basePtr, const WaxCell* cell, Vec4i* tableEntry)
+	void packNodeCell(const PackJob* job)
 	{
 		// Copy the texture into place.
+		const WaxCell* cell = (const WaxCell*)job->src;
 		const s32 compressed = cell->compressed;
 		u8* imageData = (u8*)cell + sizeof(WaxCell);
 		u8* image = (compressed == 1) ? imageData + (cell->sizeX * sizeof(u32)) : imageData;
-		u8* output = &s_texturePacker->pages[s_currentPage]->backingMemory[node->rect.y*s_texturePacker->width + node->rect.x];
+		u8* output = job->output;
 
 		u8 columnWorkBuffer[1024];
-		const u32* columnOffset = (u32*)((u8*)basePtr + cell->columnOffset);
+		const u32* columnOffset = (u32*)((u8*)job->basePtr + cell->columnOffset);
 		for (s32 x = 0; x < cell->sizeX; x++)
 		{
 			u8* column = (u8*)image + columnOffset[x];
@@ -338,21 +461,173 @@ namespace TFE_Jedi
 
 			for (s32 y = 0; y < cell->sizeY; y++)
 			{
-				output[y*s_texturePacker->width + x] = column[y];
+				output[y*job->stride + x] = column[y];
+			}
+		}
+	}
+
+	void texturepacker_copyCachedPages(AtlasCacheEntry* entry)
+	{
+		const u8* texels = entry->data.data() + entry->texelOffset;
+		const s32 pageCount = entry->header.endPage - entry->header.startPage;
+		for (s32 p = 0; p < pageCount; p++)
+		{
+			const size_t size = size_t(entry->usedHeight[p]) * size_t(entry->header.width);
+			memcpy(entry->pages[p], texels, size);
+			texels += size;
+		}
+		delete entry;
+	}
+
+	void texturepacker_executeJob(PackJob* job)
+	{
+		switch (job->type)
+		{
+			case PACKJOB_TEXTURE:
+				packNode(job);
+				break;
+			case PACKJOB_DELT_TEXTURE:
+				packNodeDeltaTex(job);
+				break;
+			case PACKJOB_WAX_CELL:
+				packNodeCell(job);
+				break;
+			case PACKJOB_WRITE_CACHE:
+				atlasCache_writeEntry((AtlasCacheEntry*)job->src);
+				break;
+			case PACKJOB_READ_CACHE:
+				texturepacker_copyCachedPages((AtlasCacheEntry*)job->src);
+				break;
+		}
+	}
+
+	void texturepacker_executeJobs()
+	{
+		TFE_ZONE("Texture Packer Jobs");
+		u32 done = s_packJobsDone.load();
+		while (done != s_packJobsQueued.load())
+		{
+			texturepacker_executeJob(&s_packJobs[done & (MAX_PACK_JOBS - 1)]);
+			done++;
+			s_packJobsDone.store(done);
+		}
+	}
+
+	TFE_THREADRET texturePackerWorkerFunc(void* userData)
+	{
+		TFE_Profiler::setThreadName("TexturePackerThread");
+		while (1)
+		{
+			s_packStart->wait();
+			if (!s_packThreadRunning.load()) { break; }
+
+			texturepacker_executeJobs();
+			s_packIdle->fire();
+		}
+		return (TFE_THREADRET)0;
+	}
+
+	void texturepacker_startWorker()
+	{
+		if (s_packJobs) { return; }
+		s_packJobs = (PackJob*)malloc(sizeof(PackJob) * MAX_PACK_JOBS);
+		s_packJobsQueued.store(0);
+		s_packJobsDone.store(0);
+
+		s_packStart = Signal::create();
+		s_packIdle = Signal::create();
+		s_packThreadRunning.store(true);
+		s_packThread = Thread::create("TexturePackerThread", texturePackerWorkerFunc, nullptr);
+		if (!s_packStart || !s_packIdle || !s_packThread || !s_packThread->run())
+		{
+			// Jobs are executed immediately instead.
+			TFE_System::logWrite(LOG_ERROR, "TexturePacker", "Cannot create the texture packer thread.");
+			delete s_packThread;
+			delete s_packStart;
+			delete s_packIdle;
+			s_packThread = nullptr;
+			s_packStart = nullptr;
+			s_packIdle = nullptr;
+		}
+	}
+
+	void texturepacker_stopWorker()
+	{
+		if (!s_packJobs) { return; }
+		texturepacker_waitForJobs();
+		if (s_packThread)
+		{
+			s_packThreadRunning.store(false);
+			s_packStart->fire();
+			s_packThread->waitOnExit();
+			delete s_packThread;
+			delete s_packStart;
+			delete s_packIdle;
+			s_packThread = nullptr;
+			s_packStart = nullptr;
+			s_packIdle = nullptr;
+		}
+		free(s_packJobs);
+		s_packJobs = nullptr;
+	}
+
+	void texturepacker_kickJobs()
+	{
+		if (s_packThread && s_packJobsDone.load() != s_packJobsQueued.load())
+		{
+			s_packStart->fire();
+		}
+	}
+
+	// Wait for the worker to finish all of the queued jobs.
+	void texturepacker_waitForJobs()
+	{
+		if (!s_packJobs) { return; }
+		TFE_ZONE("Texture Packer Wait");
+		if (s_packThread)
+		{
+			texturepacker_kickJobs();
+			while (s_packJobsDone.load() != s_packJobsQueued.load())
+			{
+				s_packIdle->wait();
 			}
 		}
-		s_usedTexels += cell->sizeX * cell->sizeY;
+		else
+		{
+			texturepacker_executeJobs();
+		}
+	}
+
+	void texturepacker_queueJob(PackJobType type, u8* output, const void* src, const void* basePtr)
+	{
+		texturepacker_startWorker();
+		const u32 queued = s_packJobsQueued.load();
+		if (queued - s_packJobsDone.load() >= MAX_PACK_JOBS)
+		{
+			texturepacker_waitForJobs();
+		}
 
-		// Copy the mapping into the texture table.
-		tableEntry->x = (s32)node->rect.x;
-		tableEntry->y = (s32)node->rect.y;
-		tableEntry->z = (s32)cell->sizeX;
-		tableEntry->w = (s32)cell->sizeY;
+		PackJob* job = &s_packJobs[queued & (MAX_PACK_JOBS - 1)];
+		job->type = type;
+		job->output = output;
+		job->stride = s_texturePacker->width;
+		job->src = src;
+		job->basePtr = basePtr;
+		s_packJobsQueued.store(queued + 1);
 
-		// Page the page index into the x offset.
-		tableEntry->x |= (s_currentPage << 12);
+		if (!s_packThread)
+		{
+			texturepacker_executeJobs();
+		}
+		else if (((queued + 1) % PACK_JOB_BATCH) == 0)
+		{
+			texturepacker_kickJobs();
+		}
 	}
 
+	/////////////////////////////////////////////
+	// Texture insertion
+	/////////////////////////////////////////////
 	bool isTextureInMap(TextureData* tex)
 	{
 		return (s_textureDataMap.find(tex) != s_textureDataMap.end());
@@ -373,41 +648,62 @@ namespace TFE_Jedi
 		s_waxDataMap[cell] = id;
 	}
 
-	bool insertTexture(TextureData* tex)
+	// Place a texture in the current page, returns its destination or null if it doesn't fit.
+	u8* placeTexture(s32 width, s32 height, s32 frame, s32* textureId)
 	{
-		if (!tex || isTextureInMap(tex)) { return true; }
-		TextureNode* node = insertNode(s_root, tex, tex->width, tex->height);
-		if (!node)
+		TexturePage* page = s_texturePacker->pages[s_currentPage];
+		s32 x, y;
+		if (!skyline_insert(page, width, height, &x, &y))
 		{
-			return false;
+			return nullptr;
 		}
+		assert(s_texturePacker->texturesPacked < MAX_TEXTURE_COUNT);
+
+		// Copy the mapping into the texture table, the page index is packed into the x offset.
+		Vec4i* tableEntry = &s_texturePacker->textureTable[s_texturePacker->texturesPacked];
+		tableEntry->x = x | (s_currentPage << 12);
+		tableEntry->y = y;
+		tableEntry->z = width;
+		tableEntry->w = height;
 
-		s_totalTexels += tex->width * tex->height;
-		insertTextureIntoMap(tex, s_texturePacker->texturesPacked);
+		s_assignments.push_back({ s_curListIndex, frame });
+		s_totalTexels += width * height;
+		page->textureCount++;
 
-		assert(node->tex == tex && s_texturePacker->texturesPacked < MAX_TEXTURE_COUNT);
-		tex->textureId = s_texturePacker->texturesPacked;
-		packNode(node, tex, &s_texturePacker->textureTable[s_texturePacker->texturesPacked]);
+		*textureId = s_texturePacker->texturesPacked;
 		s_texturePacker->texturesPacked++;
+		return &page->backingMemory[y * s_texturePacker->width + x];
+	}
+
+	bool insertTexture(TextureData* tex, s32 frame)
+	{
+		if (!tex || isTextureInMap(tex)) { return true; }
+		s32 id;
+		u8* output = placeTexture(tex->width, tex->height, frame, &id);
+		if (!output)
+		{
+			return false;
+		}
+
+		insertTextureIntoMap(tex, id);
+		tex->textureId = id;
+		texturepacker_queueJob(PACKJOB_TEXTURE, output, tex, nullptr);
 		return true;
 	}
 
 	bool insertDeltTexture(TextureData* tex)
 	{
 		if (!tex || isTextureInMap(tex)) { return true; }
-		TextureNode* node = insertNode(s_root, tex, tex->width, tex->height);
-		if (!node)
+		s32 id;
+		u8* output = placeTexture(tex->width, tex->height, 0, &id);
+		if (!output)
 		{
 			return false;
 		}
 
-		s_totalTexels += tex->width * tex->height;
-		insertTextureIntoMap(tex, s_texturePacker->texturesPacked);
-
-		assert(node->tex == tex && s_texturePacker->texturesPacked < MAX_TEXTURE_COUNT);
-		tex->textureId = s_texturePacker->texturesPacked;
-		packNodeDeltaTex(node, tex, &s_texturePacker->textureTable[s_texturePacker->texturesPacked]);
-		s_texturePacker->texturesPacked++;
+		insertTextureIntoMap(tex, id);
+		tex->textureId = id;
+		texturepacker_queueJob(PACKJOB_DELT_TEXTURE, output, tex, nullptr);
 		return true;
 	}
 
@@ -416,20 +712,17 @@ namespace TFE_Jedi
 		if (!basePtr || !frame) { return true; }
 		WaxCell* cell = WAX_CellPtr(basePtr, frame);
 		if (!cell || isWaxCellInMap(cell)) { return true; }
-		
-		TextureNode* node = insertNode(s_root, cell, cell->sizeX, cell->sizeY);
-		if (!node)
+
+		s32 id;
+		u8* output = placeTexture(cell->sizeX, cell->sizeY, 0, &id);
+		if (!output)
 		{
 			return false;
 		}
 
-		s_totalTexels += cell->sizeX * cell->sizeY;
-		insertWaxCellIntoMap(cell, s_texturePacker->texturesPacked);
-
-		assert(node->tex == cell && s_texturePacker->texturesPacked < MAX_TEXTURE_COUNT);
-		cell->textureId = s_texturePacker->texturesPacked;
-		packNodeCell(node, basePtr, cell, &s_texturePacker->textureTable[s_texturePacker->texturesPacked]);
-		s_texturePacker->texturesPacked++;
+		insertWaxCellIntoMap(cell, id);
+		cell->textureId = id;
+		texturepacker_queueJob(PACKJOB_WAX_CELL, output, cell, basePtr);
 		return true;
 	}
 
@@ -438,14 +731,14 @@ namespace TFE_Jedi
 		if (!animTex) { return true; }
 		for (s32 f = 0; f < animTex->count; f++)
 		{
-			if (!insertTexture(animTex->frameList[f]))
+			if (!insertTexture(animTex->frameList[f], f))
 			{
 				return false;
 			}
 		}
 		return true;
 	}
-		
+
 	s32 textureSort(const void* a, const void* b)
 	{
 		const TextureInfo* texA = (TextureInfo*)a;
@@ -455,17 +748,477 @@ namespace TFE_Jedi
 		return 0;
 	}
 
-	TextureNode* allocateNode()
+	/////////////////////////////////////////////
+	// Texture set hash
+	/////////////////////////////////////////////
+	enum HashTag : u64
+	{
+		HASH_TAG_PACKED = 1,	// Packed by an earlier call, the texture ID is hashed.
+		HASH_TAG_REPEAT,		// Already seen in this list, its index is hashed.
+		HASH_TAG_DATA,			// Dimensions and texels.
+		HASH_TAG_NULL,
+	};
+
+	u64 texturepacker_hashValue(u64 hash, u64 value)
+	{
+		hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+		return hash ^ (hash >> 29);
+	}
+
+	// Hashes 8 bytes at a time, the texture set can be many megabytes.
+	u64 texturepacker_hashData(u64 hash, const u8* data, size_t size)
+	{
+		for (; size >= 8; size -= 8, data += 8)
+		{
+			u64 value;
+			memcpy(&value, data, 8);
+			hash = texturepacker_hashValue(hash, value);
+		}
+		u64 tail = 0;
+		memcpy(&tail, data, size);
+		return texturepacker_hashValue(hash, tail | (u64(size) << 56));
+	}
+
+	// Textures already packed or already seen are hashed by identity, so the key also captures which
+	// list entries share textures.
+	bool texturepacker_hashIdentity(u64* hash, const void* ptr, s32 packedId)
+	{
+		if (!ptr)
+		{
+			*hash = texturepacker_hashValue(*hash, HASH_TAG_NULL);
+			return true;
+		}
+		if (packedId >= 0)
+		{
+			*hash = texturepacker_hashValue(*hash, (HASH_TAG_PACKED << 32) | u64(packedId));
+			return true;
+		}
+		std::unordered_map<const void*, s32>::iterator iSeen = s_hashDataMap.find(ptr);
+		if (iSeen != s_hashDataMap.end())
+		{
+			*hash = texturepacker_hashValue(*hash, (HASH_TAG_REPEAT << 32) | u64(iSeen->second));
+			return true;
+		}
+		s_hashDataMap[ptr] = s32(s_hashDataMap.size());
+		return false;
+	}
+
+	u64 texturepacker_hashTexture(u64 hash, TextureData* tex)
+	{
+		std::unordered_map<TextureData*, s32>::iterator iPacked = tex ? s_textureDataMap.find(tex) : s_textureDataMap.end();
+		if (texturepacker_hashIdentity(&hash, tex, iPacked != s_textureDataMap.end() ? iPacked->second : -1))
+		{
+			return hash;
+		}
+		hash = texturepacker_hashValue(hash, (HASH_TAG_DATA << 32) | (u64(tex->width) << 16) | u64(tex->height));
+		return texturepacker_hashData(hash, tex->image, size_t(tex->width) * size_t(tex->height));
+	}
+
+	u64 texturepacker_hashAnimatedTexture(u64 hash, AnimatedTexture* animTex)
+	{
+		if (!animTex) { return texturepacker_hashValue(hash, HASH_TAG_NULL); }
+		hash = texturepacker_hashValue(hash, u64(animTex->count));
+		for (s32 f = 0; f < animTex->count; f++)
+		{
+			hash = texturepacker_hashTexture(hash, animTex->frameList[f]);
+		}
+		return hash;
+	}
+
+	// Size of a compressed column, found by walking the runs.
+	size_t texturepacker_getCompressedColumnSize(const u8* colData, s32 height)
+	{
+		size_t size = 0;
+		for (s32 y = 0; y < height; )
+		{
+			const u8 count = colData[size++];
+			if (!(count & 0x7f)) { break; }
+			if (count & 0x80)
+			{
+				y += count & 0x7f;
+			}
+			else
+			{
+				y += count;
+				size += count;
+			}
+		}
+		return size;
+	}
+
+	u64 texturepacker_hashCell(u64 hash, void* basePtr, WaxFrame* frame)
+	{
+		WaxCell* cell = (basePtr && frame) ? WAX_CellPtr(basePtr, frame) : nullptr;
+		std::unordered_map<WaxCell*, s32>::iterator iPacked = cell ? s_waxDataMap.find(cell) : s_waxDataMap.end();
+		if (texturepacker_hashIdentity(&hash, cell, iPacked != s_waxDataMap.end() ? iPacked->second : -1))
+		{
+			return hash;
+		}
+		hash = texturepacker_hashValue(hash, (HASH_TAG_DATA << 32) | (u64(cell->sizeX) << 16) | u64(cell->sizeY));
+		hash = texturepacker_hashValue(hash, u64(cell->compressed));
+
+		const u8* image = (u8*)cell + sizeof(WaxCell);
+		const u32* columnOffset = (u32*)((u8*)basePtr + cell->columnOffset);
+		for (s32 x = 0; x < cell->sizeX; x++)
+		{
+			if (cell->compressed)
+			{
+				const u8* colPtr = (u8*)cell + columnOffset[x];
+				hash = texturepacker_hashData(hash, colPtr, texturepacker_getCompressedColumnSize(colPtr, cell->sizeY));
+			}
+			else
+			{
+				hash = texturepacker_hashData(hash, image + columnOffset[x], cell->sizeY);
+			}
+		}
+		return hash;
+	}
+
+	// Hash the sorted texture list, which together with the packer state is the atlas cache key.
+	u64 texturepacker_hashList(const TextureInfo* list, s32 count)
+	{
+		TFE_ZONE("Texture Packer Hash");
+		s_hashDataMap.clear();
+		u64 hash = texturepacker_hashValue(s_packHash, u64(count));
+		hash = texturepacker_hashValue(hash, (u64(s_texturePacker->width) << 32) | u64(s_texturePacker->height));
+		hash = texturepacker_hashValue(hash, (u64(s_texturePacker->reservedPages) << 32) | u64(s_texturePacker->texturesPacked));
+		for (s32 i = 0; i < count; i++)
+		{
+			hash = texturepacker_hashValue(hash, u64(list[i].type));
+			switch (list[i].type)
+			{
+				case TEXINFO_DF_TEXTURE_DATA:
+				{
+					if (list[i].texData->uvWidth == BM_ANIMATED_TEXTURE)
+					{
+						hash = texturepacker_hashAnimatedTexture(hash, (AnimatedTexture*)list[i].texData->image);
+					}
+					else
+					{
+						hash = texturepacker_hashTexture(hash, list[i].texData);
+					}
+				} break;
+				case TEXINFO_DF_DELT_TEX:
+				{
+					hash = texturepacker_hashTexture(hash, list[i].texData);
+				} break;
+				case TEXINFO_DF_ANIM_TEX:
+				{
+					hash = texturepacker_hashAnimatedTexture(hash, list[i].animTex);
+				} break;
+				case TEXINFO_DF_WAX_CELL:
+				{
+					hash = texturepacker_hashCell(hash, list[i].basePtr, list[i].frame);
+				} break;
+			}
+		}
+		s_hashDataMap.clear();
+		return hash;
+	}
+
+	/////////////////////////////////////////////
+	// Atlas Cache
+	/////////////////////////////////////////////
+	void atlasCache_getPath(u64 key, char* path)
+	{
+		sprintf(path, "%sCache/Atlas/%08x%08x.tpc", TFE_Paths::getPath(PATH_PROGRAM_DATA), u32(key >> 32), u32(key));
+	}
+
+	struct AtlasCacheFile
+	{
+		std::string path;
+		u64 time;
+		size_t size;
+	};
+
+	// Delete the least recently used entries until the cache fits in ATLAS_CACHE_MAX_SIZE.
+	// Reading an entry updates its modified time, so the oldest file is the least recently used.
+	void atlasCache_trim(const char* cacheDir)
+	{
+		FileList fileList;
+		FileUtil::readDirectory(cacheDir, "tpc", fileList);
+
+		std::vector<AtlasCacheFile> files;
+		size_t totalSize = 0;
+		for (size_t i = 0; i < fileList.size(); i++)
+		{
+			AtlasCacheFile cacheFile;
+			cacheFile.path = std::string(cacheDir) + fileList[i];
+
+			FileStream file;
+			if (!file.open(cacheFile.path.c_str(), Stream::MODE_READ)) { continue; }
+			cacheFile.size = file.getSize();
+			file.close();
+
+			cacheFile.time = FileUtil::getModifiedTime(cacheFile.path.c_str());
+			totalSize += cacheFile.size;
+			files.push_back(cacheFile);
+		}
+		if (totalSize <= ATLAS_CACHE_MAX_SIZE) { return; }
+
+		std::sort(files.begin(), files.end(), [](const AtlasCacheFile& a, const AtlasCacheFile& b) { return a.time < b.time; });
+		// Always keep the newest entry, which is the one just written.
+		for (size_t i = 0; i + 1 < files.size() && totalSize > ATLAS_CACHE_MAX_SIZE; i++)
+		{
+			FileUtil::deleteFile(files[i].path.c_str());
+			totalSize -= files[i].size;
+		}
+	}
+
+	// Called on the texture packer thread, after the textures in the packing have been copied.
+	void atlasCache_writeEntry(AtlasCacheEntry* entry)
+	{
+		TFE_ZONE("Atlas Cache Write");
+		char cacheDir[TFE_MAX_PATH];
+		sprintf(cacheDir, "%sCache/", TFE_Paths::getPath(PATH_PROGRAM_DATA));
+		FileUtil::makeDirectory(cacheDir);
+		strcat(cacheDir, "Atlas/");
+		FileUtil::makeDirectory(cacheDir);
+
+		char cachePath[TFE_MAX_PATH];
+		atlasCache_getPath(entry->header.key, cachePath);
+		FileStream file;
+		if (file.open(cachePath, Stream::MODE_WRITE))
+		{
+			file.writeBuffer(&entry->header, sizeof(AtlasCacheHeader));
+			file.writeBuffer(entry->data.data(), u32(entry->data.size()));
+
+			const s32 pageCount = entry->header.endPage - entry->header.startPage;
+			for (s32 p = 0; p < pageCount; p++)
+			{
+				file.writeBuffer(entry->pages[p], u32(entry->usedHeight[p] * entry->header.width));
+			}
+			file.close();
+			atlasCache_trim(cacheDir);
+		}
+		else
+		{
+			TFE_System::logWrite(LOG_WARNING, "TexturePacker", "Cannot write atlas cache '%s'.", cachePath);
+		}
+		delete entry;
+	}
+
+	template <typename T>
+	void atlasCache_append(std::vector<u8>& data, const T* src, size_t count)
+	{
+		const u8* bytes = (const u8*)src;
+		data.insert(data.end(), bytes, bytes + sizeof(T) * count);
+	}
+
+	// Queue a write of the packing just finished, the texels are read once the copy jobs queued before it are done.
+	void atlasCache_queueWrite(u64 key, s32 startId)
+	{
+		AtlasCacheEntry* entry = new AtlasCacheEntry();
+		AtlasCacheHeader& header = entry->header;
+		header.magic = ATLAS_CACHE_MAGIC;
+		header.version = ATLAS_CACHE_VERSION;
+		header.key = key;
+		header.width = s_texturePacker->width;
+		header.height = s_texturePacker->height;
+		header.startId = startId;
+		header.endId = s_texturePacker->texturesPacked;
+		header.startPage = s_texturePacker->reservedPages;
+		header.endPage = s_currentPage + 1;
+
+		const s32 textureCount = header.endId - header.startId;
+		assert(s32(s_assignments.size()) == textureCount);
+		atlasCache_append(entry->data, s_assignments.data(), textureCount);
+		atlasCache_append(entry->data, &s_texturePacker->textureTable[startId], textureCount);
+		for (s32 p = header.startPage; p < header.endPage; p++)
+		{
+			const TexturePage* page = s_texturePacker->pages[p];
+			AtlasCachePage cachePage = { page->textureCount, skyline_getUsedHeight(page), page->skylineCount, 0 };
+			atlasCache_append(entry->data, &cachePage, 1);
+			atlasCache_append(entry->data, page->skyline, page->skylineCount);
+
+			entry->pages[p - header.startPage] = page->backingMemory;
+			entry->usedHeight[p - header.startPage] = cachePage.usedHeight;
+		}
+		texturepacker_queueJob(PACKJOB_WRITE_CACHE, nullptr, entry, nullptr);
+	}
+
+	// Find the texture or cell that produced a packed texture, 'isCell' is set for sprite cells.
+	void* atlasCache_getTexture(const TextureInfo* info, s32 frame, bool* isCell)
 	{
-		TextureNode* node = (TextureNode*)TFE_Memory::allocFromChunkedArray(s_nodePool);
-		memset(node, 0, sizeof(TextureNode));
-		return node;
+		*isCell = false;
+		AnimatedTexture* animTex = nullptr;
+		switch (info->type)
+		{
+			case TEXINFO_DF_TEXTURE_DATA:
+			{
+				if (info->texData->uvWidth != BM_ANIMATED_TEXTURE)
+				{
+					return frame == 0 ? info->texData : nullptr;
+				}
+				animTex = (AnimatedTexture*)info->texData->image;
+			} break;
+			case TEXINFO_DF_DELT_TEX:
+			{
+				return frame == 0 ? info->texData : nullptr;
+			}
+			case TEXINFO_DF_ANIM_TEX:
+			{
+				animTex = info->animTex;
+			} break;
+			case TEXINFO_DF_WAX_CELL:
+			{
+				*isCell = true;
+				return (frame == 0 && info->basePtr && info->frame) ? WAX_CellPtr(info->basePtr, info->frame) : nullptr;
+			}
+			default:
+				return nullptr;
+		}
+		return (animTex && frame >= 0 && frame < animTex->count) ? animTex->frameList[frame] : nullptr;
+	}
+
+	// Apply a cached packing of the sorted list, returns false if there is no valid cache entry for 'key'.
+	bool atlasCache_read(u64 key, const TextureInfo* list, s32 count)
+	{
+		char cachePath[TFE_MAX_PATH];
+		atlasCache_getPath(key, cachePath);
+		FileStream file;
+		if (!FileUtil::exists(cachePath) || !file.open(cachePath, Stream::MODE_READ))
+		{
+			return false;
+		}
+		TFE_ZONE("Atlas Cache Read");
+		AtlasCacheEntry* entry = new AtlasCacheEntry();
+		const size_t size = file.getSize();
+		if (size < sizeof(AtlasCacheHeader))
+		{
+			file.close();
+			delete entry;
+			return false;
+		}
+		file.readBuffer(&entry->header, sizeof(AtlasCacheHeader));
+		entry->data.resize(size - sizeof(AtlasCacheHeader));
+		file.readBuffer(entry->data.data(), u32(entry->data.size()));
+		file.close();
+
+		// Validate the header against the current packer state.
+		const AtlasCacheHeader& header = entry->header;
+		const s32 textureCount = header.endId - header.startId;
+		const s32 pageCount = header.endPage - header.startPage;
+		if (header.magic != ATLAS_CACHE_MAGIC || header.version != ATLAS_CACHE_VERSION || header.key != key ||
+			header.width != s_texturePacker->width || header.height != s_texturePacker->height ||
+			header.startId != s_texturePacker->texturesPacked || textureCount < 0 || header.endId > MAX_TEXTURE_COUNT ||
+			header.startPage != s_texturePacker->reservedPages || pageCount <= 0 || header.endPage > MAX_TEXTURE_PAGES)
+		{
+			delete entry;
+			return false;
+		}
+
+		// Validate the sections.
+		const u8* data = entry->data.data();
+		size_t offset = (sizeof(PackAssignment) + sizeof(Vec4i)) * size_t(textureCount);
+		if (offset > entry->data.size())
+		{
+			delete entry;
+			return false;
+		}
+		const PackAssignment* assignments = (const PackAssignment*)data;
+		const Vec4i* table = (const Vec4i*)(data + sizeof(PackAssignment) * textureCount);
+
+		const AtlasCachePage* pages[MAX_TEXTURE_PAGES];
+		size_t texelSize = 0;
+		for (s32 p = 0; p < pageCount; p++)
+		{
+			if (offset + sizeof(AtlasCachePage) > entry->data.size()) { delete entry; return false; }
+			pages[p] = (const AtlasCachePage*)(data + offset);
+			offset += sizeof(AtlasCachePage);
+
+			const s32 skylineCount = pages[p]->skylineCount;
+			if (skylineCount <= 0 || skylineCount > header.width || pages[p]->usedHeight < 0 || pages[p]->usedHeight > header.height ||
+				offset + sizeof(SkylineNode) * skylineCount > entry->data.size())
+			{
+				delete entry;
+				return false;
+			}
+			offset += sizeof(SkylineNode) * skylineCount;
+			texelSize += size_t(pages[p]->usedHeight) * size_t(header.width);
+		}
+		if (offset + texelSize != entry->data.size())
+		{
+			delete entry;
+			return false;
+		}
+
+		// Find the textures before changing any state.
+		std::vector<void*> textures(textureCount);
+		std::vector<bool> isCell(textureCount);
+		s_hashDataMap.clear();
+		for (s32 i = 0; i < textureCount; i++)
+		{
+			bool cell = false;
+			void* tex = nullptr;
+			if (assignments[i].listIndex >= 0 && assignments[i].listIndex < count)
+			{
+				tex = atlasCache_getTexture(&list[assignments[i].listIndex], assignments[i].frame, &cell);
+			}
+			const bool packed = cell ? isWaxCellInMap((WaxCell*)tex) : isTextureInMap((TextureData*)tex);
+			if (!tex || packed || s_hashDataMap.find(tex) != s_hashDataMap.end())
+			{
+				s_hashDataMap.clear();
+				delete entry;
+				return false;
+			}
+			s_hashDataMap[tex] = i;
+			textures[i] = tex;
+			isCell[i] = cell;
+		}
+		s_hashDataMap.clear();
+
+		// Apply the texture IDs and table.
+		for (s32 i = 0; i < textureCount; i++)
+		{
+			const s32 id = header.startId + i;
+			if (isCell[i])
+			{
+				WaxCell* cell = (WaxCell*)textures[i];
+				insertWaxCellIntoMap(cell, id);
+				cell->textureId = id;
+			}
+			else
+			{
+				TextureData* tex = (TextureData*)textures[i];
+				insertTextureIntoMap(tex, id);
+				tex->textureId = id;
+			}
+			s_totalTexels += table[i].z * table[i].w;
+		}
+		memcpy(&s_texturePacker->textureTable[header.startId], table, sizeof(Vec4i) * textureCount);
+		s_texturePacker->texturesPacked = header.endId;
+
+		// Restore the page skylines, so later packs can continue filling the pages.
+		offset = (sizeof(PackAssignment) + sizeof(Vec4i)) * size_t(textureCount);
+		for (s32 p = 0; p < pageCount; p++)
+		{
+			const s32 pageIndex = header.startPage + p;
+			texturepacker_setupPage(pageIndex);
+			TexturePage* page = s_texturePacker->pages[pageIndex];
+			page->textureCount = pages[p]->textureCount;
+			page->skylineCount = pages[p]->skylineCount;
+			memcpy(page->skyline, data + offset + sizeof(AtlasCachePage), sizeof(SkylineNode) * page->skylineCount);
+			offset += sizeof(AtlasCachePage) + sizeof(SkylineNode) * page->skylineCount;
+
+			entry->pages[p] = page->backingMemory;
+			entry->usedHeight[p] = pages[p]->usedHeight;
+		}
+		entry->texelOffset = offset;
+		s_currentPage = header.endPage - 1;
+		// Mark the entry as recently used, so it is not trimmed.
+		FileUtil::touchFile(cachePath);
+
+		// The texels are copied on the worker, in order with any copies still in flight.
+		texturepacker_queueJob(PACKJOB_READ_CACHE, nullptr, entry, nullptr);
+		return true;
 	}
 
 	// Begin the packing process, this clears out the texture packer.
 	bool texturepacker_begin(TexturePacker* texturePacker)
 	{
 		if (!texturePacker) { return false; }
+		texturepacker_waitForJobs();
 		if (s_texInfoPool.capacity() == 0)
 		{
 			s_texInfoPool.reserve(MAX_TEXTURE_COUNT);
@@ -476,25 +1229,27 @@ namespace TFE_Jedi
 		// Clear pages.
 		for (s32 p = 0; p < s_texturePacker->pageCount; p++)
 		{
-			s_texturePacker->pages[p]->root = nullptr;
+			s_texturePacker->pages[p]->skylineCount = 0;
 			s_texturePacker->pages[p]->textureCount = 0;
 		}
 
-		TFE_Memory::chunkedArrayClear(s_nodePool);
 		s_textureDataMap.clear();
 		s_waxDataMap.clear();
 		s_texInfoPool.clear();
+		s_packHash = c_packHashSeed;
 
-		// Insert the parent that covers all of the available space.
-		s_root = nullptr;
-		insertNode(nullptr, nullptr, 0, 0);
-		s_texturePacker->pages[0]->root = s_root;
+		// Start the first page.
+		texturepacker_setupPage(0);
 		return true;
 	}
 
 	// Commit the final packing to GPU memory.
 	void texturepacker_commit()
 	{
+		TFE_ZONE("Texture Packer Commit");
+		// The pages are complete once the copies are done.
+		texturepacker_waitForJobs();
+
 		// Update the texture table.
 		s_texturePacker->textureTableGPU.update(s_texturePacker->textureTable, sizeof(Vec4i) * s_texturePacker->texturesPacked);
 
@@ -526,6 +1281,7 @@ namespace TFE_Jedi
 	s32 texturepacker_pack(TextureListCallback getList, AssetPool pool)
 	{
 		if (!getList) { return 0; }
+		TFE_ZONE("Texture Packing");
 
 		// Get textures.
 		s_texInfoPool.clear();
@@ -566,34 +1322,28 @@ namespace TFE_Jedi
 			// 2. Sort textures by perimeter from largest to smallest - simplified to w+h
 			std::qsort(list, size_t(count), sizeof(TextureInfo), textureSort);
 
-			// 3. Put all textures into the unpacked list.
+			// 3. Use the cached packing if these textures have been packed before from the same state.
+			const s32 startId = s_texturePacker->texturesPacked;
+			const u64 key = texturepacker_hashList(list, count);
+			s_packHash = key;
+			if (count > 0 && atlasCache_read(key, list, count))
+			{
+				texturepacker_kickJobs();
+				return s_texturePacker->texturesPacked;
+			}
+
+			// 4. Put all textures into the unpacked list.
 			s_unpackedTextures[0].resize(count);
 			TextureInfo** unpackedList = s_unpackedTextures[0].data();
 			for (s32 i = 0; i < count; i++)
 			{
 				unpackedList[i] = &list[i];
 			}
+			s_assignments.clear();
 
-			// 4. Insert each texture into the tree, adding pages as needed.
+			// 5. Insert each texture into the current page, adding pages as needed.
 			s_currentPage = s_texturePacker->reservedPages;
-			if (s_currentPage >= s_texturePacker->pageCount)
-			{
-				s_texturePacker->pages[s_texturePacker->pageCount] = allocateTexturePage(s_texturePacker->width, s_texturePacker->height);
-				s_texturePacker->pageCount++;
-
-				s_root = nullptr;
-				insertNode(nullptr, nullptr, 0, 0);
-				s_texturePacker->pages[s_currentPage]->root = s_root;
-			}
-			else
-			{
-				s_root = s_texturePacker->pages[s_currentPage]->root;
-				if (!s_root)
-				{
-					insertNode(nullptr, nullptr, 0, 0);
-					s_texturePacker->pages[s_currentPage]->root = s_root;
-				}
-			}
+			texturepacker_setupPage(s_currentPage);
 
 			s_unpackedBuffer = 0;
 			while (!s_unpackedTextures[s_unpackedBuffer].empty())
@@ -606,6 +1356,7 @@ namespace TFE_Jedi
 
 				for (s32 i = 0; i < count; i++)
 				{
+					s_curListIndex = s32(unpackedList[i] - list);
 					switch (unpackedList[i]->type)
 					{
 						case TEXINFO_DF_TEXTURE_DATA:
@@ -620,7 +1371,7 @@ namespace TFE_Jedi
 							}
 							else
 							{
-								if (!insertTexture(unpackedList[i]->texData))
+								if (!insertTexture(unpackedList[i]->texData, 0))
 								{
 									s_unpackedTextures[s_unpackedBuffer].push_back(unpackedList[i]);
 								}
@@ -653,27 +1404,24 @@ namespace TFE_Jedi
 				// Allocate another page...
 				if (!s_unpackedTextures[s_unpackedBuffer].empty())
 				{
-					s_currentPage++;
-					if (s_currentPage >= s_texturePacker->pageCount)
-					{
-						s_texturePacker->pages[s_texturePacker->pageCount] = allocateTexturePage(s_texturePacker->width, s_texturePacker->height);
-						s_texturePacker->pageCount++;
-
-						s_root = nullptr;
-						insertNode(nullptr, nullptr, 0, 0);
-						s_texturePacker->pages[s_currentPage]->root = s_root;
-					}
-					else
+					// Textures that do not fit in an empty page can never be packed.
+					if (s_currentPage + 1 >= MAX_TEXTURE_PAGES || s_texturePacker->pages[s_currentPage]->textureCount == 0)
 					{
-						s_root = s_texturePacker->pages[s_currentPage]->root;
-						if (!s_root)
-						{
-							insertNode(nullptr, nullptr, 0, 0);
-							s_texturePacker->pages[s_currentPage]->root = s_root;
-						}
+						TFE_System::logWrite(LOG_ERROR, "TexturePacker", "%d textures do not fit in the texture atlas '%s'.",
+							(s32)s_unpackedTextures[s_unpackedBuffer].size(), s_texturePacker->name);
+						s_unpackedTextures[s_unpackedBuffer].clear();
+						break;
 					}
+					s_currentPage++;
+					texturepacker_setupPage(s_currentPage);
 				}
 			}
+
+			if (s32(s_assignments.size()) == s_texturePacker->texturesPacked - startId && !s_assignments.empty())
+			{
+				atlasCache_queueWrite(key, startId);
+			}
+			texturepacker_kickJobs();
 		}
 		return s_texturePacker->texturesPacked;
 	}
@@ -682,18 +1430,16 @@ namespace TFE_Jedi
 	{
 		TexturePacker* texturePacker = s_globalTexturePacker;
 		if (!texturePacker) { return; }
+		texturepacker_waitForJobs();
 
 		texturePacker->pageCount = 1;
 		texturePacker->reservedPages = 0;
 		texturePacker->reservedTexturesPacked = 0;
 
-		s_usedTexels = 0;
 		s_totalTexels = 0;
-		s_nodePoolIndex = 0;
 		s_unpackedBuffer = 0;
 		s_currentPage = 0;
 
-		TFE_Memory::chunkedArrayClear(s_nodePool);
 		s_textureDataMap.clear();
 		s_waxDataMap.clear();
 		s_texInfoPool.clear();
@@ -755,5 +1501,6 @@ namespace TFE_Jedi
 	{
 		texturepacker_destroy(s_globalTexturePacker);
 		s_globalTexturePacker = nullptr;
+		texturepacker_stopWorker();
 	}
-}
\ No newline at end of file
+}
@@ -1,6 +1,15 @@
 #pragma once
 //////////////////////////////////////////////////////////////////////
 // Pack level textures into an atlas texture or array of textures.
+// Textures are placed using a skyline packer on the calling thread,
+// so texture IDs are available as soon as texturepacker_pack()
+// returns. Copying texels into the pages happens on a worker thread
+// and texturepacker_commit() waits for it to finish.
+//
+// Each packing is also written to an atlas cache, keyed by a hash of
+// the texture set and the packer state. Packing the same textures
+// again, such as reloading a level, reads the pages and texture table
+// from the cache instead.
 //////////////////////////////////////////////////////////////////////
 #include <TFE_System/types.h>
 #include <TFE_System/memoryPool.h>
@@ -17,13 +26,15 @@ struct WaxFrame;
 
 namespace TFE_Jedi
 {
-	struct TextureNode;
+	struct SkylineNode;
 
 	struct TexturePage
 	{
 		s32 textureCount;
 		u8* backingMemory = nullptr;
-		TextureNode* root = nullptr;
+		// Skyline, the top edge of the packed textures from left to right. Empty if the page has not been started.
+		SkylineNode* skyline = nullptr;
+		s32 skylineCount = 0;
 	};
 
 	struct TexturePacker
@@ -351,6 +351,10 @@ namespace TFE_Settings
 		writeKeyValue_Float(settings, "reticleScale",   s_graphicsSettings.reticleScale);
 
 		writeKeyValue_Int(settings, "renderer", s_graphicsSettings.rendererIndex);
+		writeKeyValue_Int(settings, "renderThreadCount", s_graphicsSettings.renderThreadCount);
+		writeKeyValue_Bool(settings, "pipelineFrames", s_graphicsSettings.pipelineFrames);
+		writeKeyValue_Int(settings, "gpuTraversalThreadCount", s_graphicsSettings.gpuTraversalThreadCount);
+		writeKeyValue_Int(settings, "recordingFormat", s_graphicsSettings.recordingFormat);
 		writeKeyValue_Int(settings, "skyMode", s_graphicsSettings.skyMode);
 	}
 		
@@ -374,6 +378,9 @@ namespace TFE_Settings
 		writeKeyValue_Float(settings, "cutsceneMusicVolume", s_soundSettings.cutsceneMusicVolume);
 		writeKeyValue_Bool(settings, "use16Channels", s_soundSettings.use16Channels);
 		writeKeyValue_Bool(settings, "disableSoundInMenus", s_soundSettings.disableSoundInMenus);
+		writeKeyValue_Bool(settings, "useMidiSynth", s_soundSettings.useMidiSynth);
+		writeKeyValue_Int(settings, "midiSynthPolyphony", s_soundSettings.midiSynthPolyphony);
+		writeKeyValue_String(settings, "midiSoundFont", s_soundSettings.midiSoundFont);
 	}
 
 	void writeGameSettings(FileStream& settings)
@@ -652,6 +659,22 @@ namespace TFE_Settings
 		{
 			s_graphicsSettings.rendererIndex = parseInt(value);
 		}
+		else if (strcasecmp("renderThreadCount", key) == 0)
+		{
+			s_graphicsSettings.renderThreadCount = parseInt(value);
+		}
+		else if (strcasecmp("pipelineFrames", key) == 0)
+		{
+			s_graphicsSettings.pipelineFrames = parseBool(value);
+		}
+		else if (strcasecmp("gpuTraversalThreadCount", key) == 0)
+		{
+			s_graphicsSettings.gpuTraversalThreadCount = parseInt(value);
+		}
+		else if (strcasecmp("recordingFormat", key) == 0)
+		{
+			s_graphicsSettings.recordingFormat = parseInt(value);
+		}
 		else if (strcasecmp("skyMode", key) == 0)
 		{
 			s_graphicsSettings.skyMode = SkyMode(parseInt(value));
@@ -726,6 +749,18 @@ namespace TFE_Settings
 		{
 			s_soundSettings.disableSoundInMenus = parseBool(value);
 		}
+		else if (strcasecmp("useMidiSynth", key) == 0)
+		{
+			s_soundSettings.useMidiSynth = parseBool(value);
+		}
+		else if (strcasecmp("midiSynthPolyphony", key) == 0)
+		{
+			s_soundSettings.midiSynthPolyphony = std::min(std::max(parseInt(value), 1), 128);
+		}
+		else if (strcasecmp("midiSoundFont", key) == 0)
+		{
+			strcpy(s_soundSettings.midiSoundFont, value);
+		}
 	}
 
 	void parseGame(const char* key, const char* value)
@@ -25,6 +25,24 @@ static const char* c_tfeSkyModeStrings[] =
 	"Cylinder",		// SKYMODE_CYLINDER
 };
 
+// Alt+F2 recording format.
+enum RecordingFormat
+{
+	RECORDING_GIF = 0,
+	RECORDING_Y4M,			// The video stream formats match VideoStreamFormat + 1.
+	RECORDING_RAW,
+	RECORDING_RAW_DEFLATE,
+	RECORDING_COUNT
+};
+
+static const char* c_tfeRecordingFormatStrings[] =
+{
+	"GIF",						// RECORDING_GIF
+	"Y4M Video",				// RECORDING_Y4M
+	"Raw RGBA",					// RECORDING_RAW
+	"Raw RGBA (Compressed)",	// RECORDING_RAW_DEFLATE
+};
+
 struct TFE_Settings_Window
 {
 	s32 x = 0;
@@ -51,6 +69,10 @@ struct TFE_Settings_Graphics
 	f32   saturation = 1.0f;
 	f32   gamma = 1.0f;
 	s32   rendererIndex = 0;
+	s32   renderThreadCount = 1;	// Software rasterization threads, only used above 320x200.
+	bool  pipelineFrames = false;	// Software rasterization overlaps the next simulation step (adds a frame of latency).
+	s32   gpuTraversalThreadCount = 1;	// Hardware renderer sector traversal threads.
+	s32   recordingFormat = RECORDING_GIF;	// See RecordingFormat.
 
 	// Reticle
 	bool reticleEnable  = false;
@@ -127,6 +149,10 @@ struct TFE_Settings_Sound
 	f32 cutsceneMusicVolume = 1.0f;
 	bool use16Channels = false;
 	bool disableSoundInMenus = false;
+	// Play the iMuse music using the built-in SoundFont synthesizer instead of an external midi device.
+	bool useMidiSynth = true;
+	s32 midiSynthPolyphony = 48;
+	char midiSoundFont[TFE_MAX_PATH] = "SoundFonts/SYNTHGM.sf2";
 };
 
 struct TFE_Game
@@ -22,6 +22,8 @@ bool ThreadLinux::run()
 	if (res == 0)
 	{
 		//setThreadName(m_win32Handle, m_name);
+		m_isRunning = true;
+		m_isPaused = false;
 	}
 	else
 	{
@@ -44,6 +46,14 @@ void ThreadLinux::resume()
 	//to-do.
 }
 
+void ThreadLinux::waitOnExit()
+{
+	if (!m_handle) { return; }
+	pthread_join(m_handle, NULL);
+	m_handle = 0;
+	m_isRunning = false;
+}
+
 //factory
 Thread* Thread::create(const char* name, ThreadFunc func, void* userData)
 {
@@ -1,29 +1,34 @@
 #include <cstring>
+#include <cstdio>
 
 #include "profiler.h"
+#include <TFE_System/Threads/mutex.h>
+#include <TFE_FileSystem/filestream.h>
 #include <assert.h>
 #include <algorithm>
 #include <vector>
 #include <string>
 #include <map>
 
-// TODO: Support call "paths" - with seperate time per path.
-
 namespace TFE_Profiler
 {
 	#define ZONE_BUFFER_COUNT 2
 	#define MAX_ZONE_STACK 256
-	
+	// Ring buffer sizes, these must be powers of two.
+	#define ZONE_EVENT_RING_SIZE 32768		// per thread, 768Kb
+	#define FRAME_RING_SIZE      1024
+	#define COUNTER_RING_SIZE    16384
+	// States of exited threads kept for the trace export and for reuse by new threads with the same name.
+	#define MAX_INACTIVE_THREADS 16
+	#define ROOT_ZONE 0
+
+	// A node in the call tree of a thread, the same site entered from different parents has different nodes.
 	struct Zone
 	{
-		u32  id;
+		const TFE_ZoneSite* site;
 		u32  level = 0;
 		u32  parent = NULL_ZONE;
-		u64  path;
 		u64  frame;
-		char name[64];
-		char func[64];
-		u32  lineNumber;
 
 		f64  timeInZone[ZONE_BUFFER_COUNT];
 		f64  timeInZoneAve;
@@ -31,6 +36,36 @@ namespace TFE_Profiler
 
 		u32  child = NULL_ZONE;
 		u32  sibling = NULL_ZONE;
+		u32  lastChild = NULL_ZONE;	// the most recently entered child, checked first.
+	};
+
+	struct ZoneEvent
+	{
+		u64 start;
+		u64 end;
+		const TFE_ZoneSite* site;
+	};
+
+	struct ZoneStackEntry
+	{
+		u32 zone;
+		u64 start;
+	};
+
+	struct ThreadState
+	{
+		u32  id;
+		char name[64];
+		bool frameThread;
+		bool active;		// false once the thread has exited.
+
+		std::vector<Zone> zones;
+		ZoneStackEntry stack[MAX_ZONE_STACK];
+		u32 level;
+
+		// Only the owning thread writes events, the count is read by other threads when exporting.
+		ZoneEvent* events;
+		atomic_u32 eventCount;
 	};
 
 	struct Counter
@@ -42,123 +77,225 @@ namespace TFE_Profiler
 		char name[64];
 	};
 
-	typedef std::map<std::string, u32> ZoneMap;
-	typedef std::vector<Zone> ZoneList;
+	struct CounterSample
+	{
+		u64 time;
+		u32 id;
+		s32 value;
+	};
+
+	typedef std::map<std::string, u32> CounterMap;
 	typedef std::vector<u32> SortedZoneList;
 	typedef std::vector<Counter> CounterList;
+	typedef std::vector<ThreadState*> ThreadList;
 
-	static ZoneMap  s_zoneMap;
-	static ZoneList s_zoneList;
 	static SortedZoneList s_sortedZoneList;
-	static SortedZoneList s_roots;
-
-	static ZoneMap  s_counterMap;
+	static CounterMap  s_counterMap;
 	static CounterList s_counterList;
 
+	// Marks the state of a thread as inactive when the thread exits.
+	struct ThreadExitHook
+	{
+		ThreadState* state = nullptr;
+		~ThreadExitHook();
+	};
+
+	static ThreadList s_threads;
+	static u32 s_nextThreadId = 0;
+	static thread_local ThreadState* s_thread = nullptr;
+	static thread_local ThreadExitHook s_threadExitHook;
+	// The thread that calls frameBegin(), its zones are used for the per-frame results.
+	static ThreadState* s_frameThread = nullptr;
+
 	static u64 s_frameBegin;
 	static f64 s_frameTime;
 	static u32 s_readBuffer = 0;
 	static u32 s_writeBuffer = 1;
-	static u32 s_level;
-	static u32 s_maxLevel;
-	static u32 s_zoneStack[MAX_ZONE_STACK];
 	static u64 s_currentFrame = 1;
-	static u64 s_currentPath;
 
-	void addZoneChild(u32 parentId, u32 zoneId)
+	// Frame markers and counter samples are only written by the frame thread.
+	static u64 s_frameRing[FRAME_RING_SIZE];
+	static u32 s_frameRingCount = 0;
+	static CounterSample s_counterRing[COUNTER_RING_SIZE];
+	static u32 s_counterRingCount = 0;
+
+	static bool s_capturing = false;
+	static u64  s_captureStart = 0;
+
+	Mutex* getThreadMutex()
 	{
-		Zone& parent = s_zoneList[parentId];
-		Zone& zone = s_zoneList[zoneId];
-		// This has already been added.
-		if (zone.sibling != NULL_ZONE)
-		{
-			return;
-		}
+		static Mutex* s_threadMutex = Mutex::create();
+		return s_threadMutex;
+	}
 
-		if (parent.child == zoneId)
-		{
-			return;
-		}
-		else if (parent.child == NULL_ZONE)
-		{
-			parent.child = zoneId;
-		}
-		else
-		{
-			Zone* child = &s_zoneList[parent.child];
-			while (1)
+	ThreadState* registerThread()
+	{
+		ThreadState* thread = new ThreadState();
+		thread->frameThread = false;
+		thread->active = true;
+		thread->level = 0;
+		thread->events = new ZoneEvent[ZONE_EVENT_RING_SIZE];
+		thread->eventCount = 0;
+
+		// The root zone is never entered, it is the parent of the top level zones.
+		Zone root;
+		root.site = nullptr;
+		root.frame = 0;
+		root.timeInZone[0] = 0.0;
+		root.timeInZone[1] = 0.0;
+		root.timeInZoneAve = 0.0;
+		root.fractOfParentAve = 0.0;
+		thread->zones.push_back(root);
+
+		Mutex* mutex = getThreadMutex();
+		mutex->lock();
+			thread->id = s_nextThreadId++;
+			sprintf(thread->name, "Thread %u", thread->id);
+			s_threads.push_back(thread);
+		mutex->unlock();
+
+		s_threadExitHook.state = thread;
+		return thread;
+	}
+
+	// The thread mutex must be held.
+	void destroyThread(ThreadState* thread)
+	{
+		s_threads.erase(std::find(s_threads.begin(), s_threads.end(), thread));
+		delete[] thread->events;
+		delete thread;
+	}
+
+	ThreadExitHook::~ThreadExitHook()
+	{
+		if (!state) { return; }
+
+		Mutex* mutex = getThreadMutex();
+		mutex->lock();
+			state->active = false;
+			// Nothing to export, so there is no reason to keep the state around.
+			if (state->eventCount.load() == 0)
+			{
+				destroyThread(state);
+			}
+
+			// Limit the number of inactive states, the oldest are removed first.
+			u32 inactiveCount = 0;
+			for (size_t t = 0; t < s_threads.size(); t++)
+			{
+				if (!s_threads[t]->active) { inactiveCount++; }
+			}
+			for (size_t t = 0; t < s_threads.size() && inactiveCount > MAX_INACTIVE_THREADS;)
 			{
-				if (child->sibling == zoneId)
+				if (!s_threads[t]->active)
 				{
-					return;
+					destroyThread(s_threads[t]);
+					inactiveCount--;
 				}
-				else if (child->sibling == NULL_ZONE)
+				else
 				{
-					child->sibling = zoneId;
-					break;
+					t++;
 				}
-				child = &s_zoneList[child->sibling];
-			};
-		}
+			}
+		mutex->unlock();
+		state = nullptr;
 	}
 
-	u32 beginZone(const char* name, const char* func, u32 lineNumber)
+	inline ThreadState* getThread()
 	{
-		ZoneMap::iterator iZone = s_zoneMap.find(name);
-		u32 id = 0;
-
-		if (iZone == s_zoneMap.end())
+		if (!s_thread)
 		{
-			id = (u32)s_zoneList.size();
-
-			Zone zone;
-			zone.id = id;
-			zone.path = s_currentPath;
-			zone.timeInZone[s_readBuffer]  = 0;
-			zone.timeInZone[s_writeBuffer] = 0;
-			zone.timeInZoneAve = 0.0;
-			zone.fractOfParentAve = 0.0;
-			zone.frame = 0;
-			
-			s_zoneList.push_back(zone);
-			s_zoneMap[name] = id;
+			s_thread = registerThread();
 		}
-		else
+		return s_thread;
+	}
+
+	u32 findChildZone(ThreadState* thread, u32 parentId, const TFE_ZoneSite* site)
+	{
+		std::vector<Zone>& zones = thread->zones;
+		Zone* parent = &zones[parentId];
+		if (parent->lastChild != NULL_ZONE && zones[parent->lastChild].site == site)
 		{
-			id = iZone->second;
+			return parent->lastChild;
 		}
 
-		Zone& zone = s_zoneList[id];
-		strcpy(zone.name, name);
-		strcpy(zone.func, func);
-		zone.lineNumber = lineNumber;
-		zone.level = s_level;
+		// Zones with the same name in the same parent are merged, even if they come from different sites.
+		u32 lastSibling = NULL_ZONE;
+		for (u32 id = parent->child; id != NULL_ZONE; id = zones[id].sibling)
+		{
+			if (zones[id].site == site || strcmp(zones[id].site->name, site->name) == 0)
+			{
+				parent->lastChild = id;
+				return id;
+			}
+			lastSibling = id;
+		}
 
-		zone.parent = s_level > 0 ? s_zoneStack[s_level - 1] : NULL_ZONE;
-		if (zone.parent == NULL_ZONE)
+		const u32 id = (u32)zones.size();
+		Zone zone;
+		zone.site = site;
+		zone.level = parentId == ROOT_ZONE ? 0 : zones[parentId].level + 1;
+		zone.parent = parentId;
+		zone.frame = 0;
+		zone.timeInZone[0] = 0.0;
+		zone.timeInZone[1] = 0.0;
+		zone.timeInZoneAve = 0.0;
+		zone.fractOfParentAve = 0.0;
+		zones.push_back(zone);
+
+		// Children are kept in the order they were first entered.
+		parent = &zones[parentId];
+		if (lastSibling == NULL_ZONE)
 		{
-			s_roots.push_back(id);
+			parent->child = id;
 		}
 		else
 		{
-			addZoneChild(zone.parent, zone.id);
+			zones[lastSibling].sibling = id;
 		}
-
-		s_zoneStack[s_level] = id;
-		s_level++;
-
+		parent->lastChild = id;
 		return id;
 	}
 
-	void endZone(u32 id, u64 dt)
+	void beginZone(const TFE_ZoneSite* site)
+	{
+		ThreadState* thread = getThread();
+		assert(thread->level < MAX_ZONE_STACK);
+
+		const u32 parentId = thread->level > 0 ? thread->stack[thread->level - 1].zone : ROOT_ZONE;
+		ZoneStackEntry& entry = thread->stack[thread->level];
+		entry.zone = findChildZone(thread, parentId, site);
+		thread->level++;
+		entry.start = TFE_System::getCurrentTimeInTicks();
+	}
+
+	void endZone()
 	{
-		s_zoneList[id].timeInZone[s_writeBuffer] += TFE_System::convertFromTicksToSeconds(dt);
-		s_level--;
+		const u64 end = TFE_System::getCurrentTimeInTicks();
+		ThreadState* thread = s_thread;
+		assert(thread && thread->level > 0);
+
+		thread->level--;
+		const ZoneStackEntry& entry = thread->stack[thread->level];
+		Zone& zone = thread->zones[entry.zone];
+
+		const u32 eventIndex = thread->eventCount.load(std::memory_order_relaxed);
+		ZoneEvent& event = thread->events[eventIndex & (ZONE_EVENT_RING_SIZE - 1)];
+		event.start = entry.start;
+		event.end = end;
+		event.site = zone.site;
+		thread->eventCount.store(eventIndex + 1, std::memory_order_release);
+
+		if (thread->frameThread)
+		{
+			zone.timeInZone[s_writeBuffer] += TFE_System::convertFromTicksToSeconds(end - entry.start);
+			zone.frame = s_currentFrame;
+		}
 	}
 
 	void addCounter(const char* name, s32* counter)
 	{
-		ZoneMap::iterator iCounter = s_counterMap.find(name);
+		CounterMap::iterator iCounter = s_counterMap.find(name);
 		if (iCounter == s_counterMap.end())
 		{
 			const u32 id = (u32)s_counterList.size();
@@ -174,90 +311,122 @@ namespace TFE_Profiler
 		}
 	}
 
+	void setThreadName(const char* name)
+	{
+		ThreadState* thread = getThread();
+		Mutex* mutex = getThreadMutex();
+		mutex->lock();
+			// Threads that are recreated, such as worker threads, take over the state of an exited thread with the
+			// same name. This keeps the number of states bounded and the trace on a single lane per thread name.
+			ThreadState* recycled = nullptr;
+			if (!thread->frameThread && thread->level == 0 && thread->eventCount.load() == 0)
+			{
+				for (size_t t = 0; t < s_threads.size() && !recycled; t++)
+				{
+					if (!s_threads[t]->active && strncmp(s_threads[t]->name, name, sizeof(thread->name) - 1) == 0)
+					{
+						recycled = s_threads[t];
+					}
+				}
+			}
+			if (recycled)
+			{
+				destroyThread(thread);
+				recycled->active = true;
+				recycled->level = 0;
+				s_thread = recycled;
+				s_threadExitHook.state = recycled;
+			}
+			else
+			{
+				strncpy(thread->name, name, sizeof(thread->name) - 1);
+				thread->name[sizeof(thread->name) - 1] = 0;
+			}
+		mutex->unlock();
+	}
+
 	void frameBegin()
 	{
+		if (!s_frameThread)
+		{
+			s_frameThread = getThread();
+			s_frameThread->frameThread = true;
+			setThreadName("Main");
+		}
+
 		std::swap(s_readBuffer, s_writeBuffer);
-		s_level = 0;
-		s_maxLevel = 0;
-		s_roots.clear();
+		s_frameThread->level = 0;
 
 		// Swap buffers, s_readBuffer is safe to read in the middle of the next frame.
-		const size_t zoneCount = s_zoneList.size();
+		std::vector<Zone>& zones = s_frameThread->zones;
+		const size_t zoneCount = zones.size();
 		for (size_t i = 0; i < zoneCount; i++)
 		{
-			s_zoneList[i].timeInZone[s_writeBuffer] = 0;
+			zones[i].timeInZone[s_writeBuffer] = 0;
 		}
 
+		s_frameBegin = TFE_System::getCurrentTimeInTicks();
+		s_frameRing[s_frameRingCount & (FRAME_RING_SIZE - 1)] = s_frameBegin;
+		s_frameRingCount++;
+
 		// Copy counter values from the frame, so that the results can be used
 	    // in the middle of the next frame.
 		const size_t counterCount = s_counterList.size();
 		for (size_t i = 0; i < counterCount; i++)
 		{
-			s_counterList[i].prevValue = *s_counterList[i].ptr;
+			Counter& counter = s_counterList[i];
+			counter.prevValue = *counter.ptr;
+
+			CounterSample& sample = s_counterRing[s_counterRingCount & (COUNTER_RING_SIZE - 1)];
+			sample.time = s_frameBegin;
+			sample.id = counter.id;
+			sample.value = counter.prevValue;
+			s_counterRingCount++;
 		}
-
-		s_frameBegin = TFE_System::getCurrentTimeInTicks();
 	}
 
-	void traverseZoneTree(u32 id)
+	void traverseZoneTree(std::vector<Zone>& zones, u32 id)
 	{
-		if (id == NULL_ZONE) { return; }
-		Zone* zone = &s_zoneList[id];
-		// Make sure zones are only inserted once for now.
-		if (zone->frame != s_currentFrame)
-		{
-			s_sortedZoneList.push_back(id);
-		}
-		zone->frame = s_currentFrame;
-		
-		while (zone->child != NULL_ZONE)
+		// Only zones entered during the frame are listed.
+		for (u32 child = zones[id].child; child != NULL_ZONE; child = zones[child].sibling)
 		{
-			traverseZoneTree(zone->child);
-			zone = &s_zoneList[zone->child];
-		}
+			if (zones[child].frame != s_currentFrame) { continue; }
 
-		zone = &s_zoneList[id];
-		while (zone->sibling != NULL_ZONE)
-		{
-			traverseZoneTree(zone->sibling);
-			zone = &s_zoneList[zone->sibling];
+			s_sortedZoneList.push_back(child);
+			traverseZoneTree(zones, child);
 		}
 	}
 
 	void frameEnd()
 	{
+		if (!s_frameThread) { return; }
+
 		s_frameTime = TFE_System::convertFromTicksToSeconds(TFE_System::getCurrentTimeInTicks() - s_frameBegin);
-		const size_t zoneCount = s_zoneList.size();
+		std::vector<Zone>& zones = s_frameThread->zones;
+		const size_t zoneCount = zones.size();
 		const f64 expBlend = 0.99;
 
 		// Sort Zones
 		s_sortedZoneList.clear();
-		const size_t rootCount = s_roots.size();
-		for (size_t r = 0; r < rootCount; r++)
-		{
-			traverseZoneTree(s_roots[r]);
-		}
+		traverseZoneTree(zones, ROOT_ZONE);
 
 		// First compute delta times for each zone.
-		for (size_t i = 0; i < zoneCount; i++)
+		for (size_t i = 1; i < zoneCount; i++)
 		{
-			s_zoneList[i].timeInZoneAve = expBlend * s_zoneList[i].timeInZoneAve + (1.0 - expBlend)*s_zoneList[i].timeInZone[s_writeBuffer];
+			zones[i].timeInZoneAve = expBlend * zones[i].timeInZoneAve + (1.0 - expBlend)*zones[i].timeInZone[s_writeBuffer];
 		}
 
-		// Then handle percentage of parent and clear
-		for (size_t i = 0; i < zoneCount; i++)
+		// Then handle percentage of parent.
+		for (size_t i = 1; i < zoneCount; i++)
 		{
-			f64 parentTime = (s_zoneList[i].parent != NULL_ZONE) ? s_zoneList[s_zoneList[i].parent].timeInZone[s_writeBuffer] : s_frameTime;
-			s_zoneList[i].fractOfParentAve = expBlend * s_zoneList[i].fractOfParentAve + (1.0 - expBlend)*s_zoneList[i].timeInZone[s_writeBuffer] / parentTime;
-			// Handle the rare case the parentTime = 0 causing s_zoneList[i].fractOfParentAve to become NAN. Once that happens it will never fix itself
+			f64 parentTime = (zones[i].parent != ROOT_ZONE) ? zones[zones[i].parent].timeInZone[s_writeBuffer] : s_frameTime;
+			zones[i].fractOfParentAve = expBlend * zones[i].fractOfParentAve + (1.0 - expBlend)*zones[i].timeInZone[s_writeBuffer] / parentTime;
+			// Handle the rare case the parentTime = 0 causing zones[i].fractOfParentAve to become NAN. Once that happens it will never fix itself
 			// because we are doing an average. So fix it manually.
-			if (isnan(s_zoneList[i].fractOfParentAve))
+			if (isnan(zones[i].fractOfParentAve))
 			{
-				s_zoneList[i].fractOfParentAve = 0.0;
+				zones[i].fractOfParentAve = 0.0;
 			}
-
-			s_zoneList[i].child = NULL_ZONE;
-			s_zoneList[i].sibling = NULL_ZONE;
 		}
 
 		s_currentFrame++;
@@ -272,15 +441,15 @@ namespace TFE_Profiler
 	{
 		if (index >= (u32)s_sortedZoneList.size()) { return; }
 
-		Zone& zone = s_zoneList[s_sortedZoneList[index]];
-		info->name = zone.name;
-		info->func = zone.func;
+		Zone& zone = s_frameThread->zones[s_sortedZoneList[index]];
+		info->name = zone.site->name;
+		info->func = zone.site->func;
 		info->level = zone.level;
-		info->lineNumber = zone.lineNumber;
+		info->lineNumber = zone.site->lineNumber;
 		info->timeInZone = zone.timeInZone[s_readBuffer];
 		info->timeInZoneAve = zone.timeInZoneAve;
 		info->fractOfParentAve = zone.fractOfParentAve;
-		info->parentId = zone.parent;
+		info->parentId = zone.parent == ROOT_ZONE ? NULL_ZONE : zone.parent;
 	}
 
 	f64 getTimeInFrame()
@@ -301,4 +470,143 @@ namespace TFE_Profiler
 		info->name = counter.name;
 		info->value = counter.prevValue;
 	}
+
+	/////////////////////////////////////////////
+	// Chrome Trace Export
+	/////////////////////////////////////////////
+	void writeJsonString(FileStream& file, const char* str)
+	{
+		std::string escaped;
+		for (const char* c = str; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') { escaped += '\\'; }
+			escaped += *c;
+		}
+		file.writeString("\"%s\"", escaped.c_str());
+	}
+
+	f64 ticksToMicroseconds(u64 ticks)
+	{
+		return TFE_System::convertFromTicksToSeconds(ticks) * 1000000.0;
+	}
+
+	// Copy the events of a thread that ended at or after 'start'.
+	// Other threads may keep writing while this runs, so any events that could have been overwritten during the copy are discarded.
+	void copyThreadEvents(ThreadState* thread, u64 start, std::vector<ZoneEvent>& events)
+	{
+		events.clear();
+		const u32 count = thread->eventCount.load(std::memory_order_acquire);
+		const u32 available = std::min(count, u32(ZONE_EVENT_RING_SIZE));
+		for (u32 i = count - available; i != count; i++)
+		{
+			const ZoneEvent& event = thread->events[i & (ZONE_EVENT_RING_SIZE - 1)];
+			if (event.end >= start)
+			{
+				events.push_back(event);
+			}
+		}
+
+		const u32 newCount = thread->eventCount.load(std::memory_order_acquire);
+		const u32 overwritten = newCount - count;
+		if (available + overwritten > ZONE_EVENT_RING_SIZE)
+		{
+			// Events are pushed in order of their end time, so the copied events are the newest part of the copied range
+			// and the overwritten slots are the oldest.
+			const u32 skipped = available - (u32)events.size();
+			const u32 lost = available + overwritten - ZONE_EVENT_RING_SIZE;
+			const size_t discard = std::min(events.size(), size_t(lost > skipped ? lost - skipped : 0));
+			events.erase(events.begin(), events.begin() + discard);
+		}
+	}
+
+	bool writeTrace(const char* path, u64 start)
+	{
+		FileStream file;
+		if (!file.open(path, Stream::MODE_WRITE))
+		{
+			TFE_System::logWrite(LOG_ERROR, "Profiler", "Cannot write trace to '%s'.", path);
+			return false;
+		}
+
+		file.writeString("{\r\n\"displayTimeUnit\": \"ms\",\r\n\"traceEvents\": [\r\n");
+		file.writeString("  { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": { \"name\": \"The Force Engine\" } }");
+
+		// Zones per thread.
+		u32 eventCount = 0;
+		std::vector<ZoneEvent> events;
+		Mutex* mutex = getThreadMutex();
+		mutex->lock();
+		for (size_t t = 0; t < s_threads.size(); t++)
+		{
+			ThreadState* thread = s_threads[t];
+			file.writeString(",\r\n  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": { \"name\": ", thread->id);
+			writeJsonString(file, thread->name);
+			file.writeString(" } }");
+
+			copyThreadEvents(thread, start, events);
+			for (size_t i = 0; i < events.size(); i++)
+			{
+				const ZoneEvent& event = events[i];
+				file.writeString(",\r\n  { \"name\": ");
+				writeJsonString(file, event.site->name);
+				file.writeString(", \"cat\": \"zone\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": { \"func\": ",
+					thread->id, ticksToMicroseconds(event.start), ticksToMicroseconds(event.end - event.start));
+				writeJsonString(file, event.site->func);
+				file.writeString(", \"line\": %u } }", event.site->lineNumber);
+			}
+			eventCount += (u32)events.size();
+		}
+		mutex->unlock();
+
+		// Frame markers.
+		const u32 frameCount = std::min(s_frameRingCount, u32(FRAME_RING_SIZE));
+		for (u32 i = s_frameRingCount - frameCount; i != s_frameRingCount; i++)
+		{
+			const u64 time = s_frameRing[i & (FRAME_RING_SIZE - 1)];
+			if (time < start) { continue; }
+			file.writeString(",\r\n  { \"name\": \"Frame %u\", \"cat\": \"frame\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": %.3f }", i, ticksToMicroseconds(time));
+		}
+
+		// Counter tracks.
+		const u32 sampleCount = std::min(s_counterRingCount, u32(COUNTER_RING_SIZE));
+		for (u32 i = s_counterRingCount - sampleCount; i != s_counterRingCount; i++)
+		{
+			const CounterSample& sample = s_counterRing[i & (COUNTER_RING_SIZE - 1)];
+			if (sample.time < start) { continue; }
+			file.writeString(",\r\n  { \"name\": ");
+			writeJsonString(file, s_counterList[sample.id].name);
+			file.writeString(", \"cat\": \"counter\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": { \"value\": %d } }", ticksToMicroseconds(sample.time), sample.value);
+		}
+
+		file.writeString("\r\n]\r\n}\r\n");
+		file.close();
+
+		TFE_System::logWrite(LOG_MSG, "Profiler", "Wrote %u zones to trace '%s'.", eventCount, path);
+		return true;
+	}
+
+	void captureBegin()
+	{
+		s_capturing = true;
+		s_captureStart = TFE_System::getCurrentTimeInTicks();
+	}
+
+	bool isCapturing()
+	{
+		return s_capturing;
+	}
+
+	bool captureEnd(const char* path)
+	{
+		if (!s_capturing) { return false; }
+		s_capturing = false;
+		return writeTrace(path, s_captureStart);
+	}
+
+	bool exportRecentFrames(const char* path, u32 frameCount)
+	{
+		frameCount = std::min(std::max(frameCount, 1u), std::min(s_frameRingCount, u32(FRAME_RING_SIZE)));
+		const u64 start = frameCount ? s_frameRing[(s_frameRingCount - frameCount) & (FRAME_RING_SIZE - 1)] : 0;
+		return writeTrace(path, start);
+	}
 }
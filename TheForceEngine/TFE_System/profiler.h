@@ -3,7 +3,15 @@
 // The Force Engine Profiler
 // Simple "zone" based profiler.
 // Add TFE_PROFILE_ENABLED to preprocessor defines in the build to enable.
-// Currently does not respect the call path, that is TODO.
+//
+// Zones are tracked per call path, so the same zone entered from two
+// different parents is timed separately. Each thread records its own
+// zones, the per-frame results shown in the UI are from the thread
+// that calls TFE_FRAME_BEGIN() / TFE_FRAME_END().
+//
+// Every thread also keeps a ring buffer of its most recent zones,
+// which along with frame markers and counter samples can be exported
+// as a Chrome trace (chrome://tracing, Perfetto).
 //////////////////////////////////////////////////////////////////////
 
 #include "types.h"
@@ -14,8 +22,9 @@
 #define TOKENPASTE(x, y) x ## y
 #define TOKENPASTE2(x, y) TOKENPASTE(x, y)
 #ifdef  TFE_PROFILE_ENABLED
-#define TFE_ZONE(name)  TFE_Profiler_Zone TOKENPASTE2(__localZone, __LINE__)(name, __FUNCTION__, __LINE__)
-#define TFE_ZONE_BEGIN(varName, name)  TFE_Profiler_ZoneManual varName(name, __FUNCTION__, __LINE__)
+#define TFE_ZONE_SITE(siteName, name) static const TFE_ZoneSite siteName = { name, __FUNCTION__, __LINE__ }
+#define TFE_ZONE(name)  TFE_ZONE_SITE(TOKENPASTE2(__localZoneSite, __LINE__), name); TFE_Profiler_Zone TOKENPASTE2(__localZone, __LINE__)(&TOKENPASTE2(__localZoneSite, __LINE__))
+#define TFE_ZONE_BEGIN(varName, name)  TFE_ZONE_SITE(TOKENPASTE2(varName, _site), name); TFE_Profiler_ZoneManual varName(&TOKENPASTE2(varName, _site))
 #define TFE_ZONE_END(varName)  varName.end()
 #define TFE_FRAME_BEGIN() TFE_Profiler::frameBegin()
 #define TFE_FRAME_END() TFE_Profiler::frameEnd()
@@ -32,10 +41,18 @@
 #define NULL_ZONE 0xffffffff
 
 #ifdef TFE_PROFILE_ENABLED
+// Static description of the place in the code where a zone is defined.
+struct TFE_ZoneSite
+{
+	const char* name;
+	const char* func;
+	u32 lineNumber;
+};
+
 struct TFE_ZoneInfo
 {
-	char* name;
-	char* func;
+	const char* name;
+	const char* func;
 	u32  lineNumber;
 	u32  level;
 	u32  parentId;
@@ -46,20 +63,22 @@ struct TFE_ZoneInfo
 
 struct TFE_CounterInfo
 {
-	char* name;
+	const char* name;
 	s32   value;
 };
 
 namespace TFE_Profiler
 {
 	// The main profiling API is used through Macros which can be disabled based on build flags.
-	u32  beginZone(const char* name, const char* func, u32 lineNumber);
-	void endZone(u32 id, u64 dt);
+	void beginZone(const TFE_ZoneSite* site);
+	void endZone();
 		
 	void frameBegin();
 	void frameEnd();
 
 	void addCounter(const char* name, s32* counter);
+	// Name the calling thread in exported traces.
+	void setThreadName(const char* name);
 
 	// Profile data API, this is used directly.
 	f64  getTimeInFrame();
@@ -69,43 +88,41 @@ namespace TFE_Profiler
 	
 	u32  getCounterCount();
 	void getCounterInfo(u32 index, TFE_CounterInfo* info);
+
+	// Trace capture, the captured range is limited by the size of the ring buffers.
+	void captureBegin();
+	bool isCapturing();
+	// Ends the capture and writes everything recorded since captureBegin() to 'path' as Chrome trace JSON.
+	bool captureEnd(const char* path);
+	// Writes the most recent 'frameCount' frames to 'path' as Chrome trace JSON, useful after a frame time spike.
+	bool exportRecentFrames(const char* path, u32 frameCount);
 }
 
 class TFE_Profiler_Zone
 {
 public:
-	TFE_Profiler_Zone(const char* name, const char* func, u32 lineNumber)
+	TFE_Profiler_Zone(const TFE_ZoneSite* site)
 	{
-		m_time = TFE_System::getCurrentTimeInTicks();
-		m_id = TFE_Profiler::beginZone(name, func, lineNumber);
+		TFE_Profiler::beginZone(site);
 	}
 
 	~TFE_Profiler_Zone()
 	{
-		const u64 deltaTime = TFE_System::getCurrentTimeInTicks() - m_time;
-		TFE_Profiler::endZone(m_id, deltaTime);
+		TFE_Profiler::endZone();
 	}
-private:
-	u64 m_time;
-	s32 m_id;
 };
 
 class TFE_Profiler_ZoneManual
 {
 public:
-	TFE_Profiler_ZoneManual(const char* name, const char* func, u32 lineNumber)
+	TFE_Profiler_ZoneManual(const TFE_ZoneSite* site)
 	{
-		m_time = TFE_System::getCurrentTimeInTicks();
-		m_id = TFE_Profiler::beginZone(name, func, lineNumber);
+		TFE_Profiler::beginZone(site);
 	}
 
 	void end()
 	{
-		const u64 deltaTime = TFE_System::getCurrentTimeInTicks() - m_time;
-		TFE_Profiler::endZone(m_id, deltaTime);
+		TFE_Profiler::endZone();
 	}
-private:
-	u64 m_time;
-	s32 m_id;
 };
 #endif
@@ -33,6 +33,11 @@ namespace TFE_System
 	static f64 s_dt = 1.0 / 60.0;		// This is just to handle the first frame, so any reasonable value will work.
 	static const f64 c_maxDt = 0.05;	// 20 fps
 
+	// Virtual time, see enableVirtualTime().
+	static f64 s_virtualTime = 0.0;
+	static f64 s_virtualTimePrev = 0.0;
+	static bool s_useVirtualTime = false;
+
 	static bool s_synced = false;
 	static bool s_resetStartTime = false;
 	static bool s_quitMessagePosted = false;
@@ -148,6 +153,9 @@ namespace TFE_System
 		// during loading spikes.
 		// This caps the low end framerate before slowdown to 20 fps.
 		s_dt = std::min(dt, c_maxDt);
+
+		s_virtualTimePrev = s_virtualTime;
+		s_virtualTime = s_virtualTimePrev + s_dt;
 	}
 
 	// Timing
@@ -160,9 +168,27 @@ namespace TFE_System
 	// Get time since "start time"
 	f64 getTime()
 	{
+		if (s_useVirtualTime)
+		{
+			return s_virtualTime;
+		}
 		const u64 uDt = s_time - s_startTime;
 		return f64(uDt) * s_freq;
 	}
+
+	void enableVirtualTime(bool enable)
+	{
+		s_useVirtualTime = enable;
+		s_virtualTime = 0.0;
+		s_virtualTimePrev = 0.0;
+	}
+
+	void setFrameDeltaTime(f64 dt)
+	{
+		s_dt = dt;
+		// Computed from the previous time rather than adjusted, so the result matches exactly when replayed.
+		s_virtualTime = s_virtualTimePrev + s_dt;
+	}
 	
 	u64 getCurrentTimeInTicks()
 	{
@@ -37,6 +37,11 @@ namespace TFE_System
 	f64 getDeltaTime();
 	// Get the absolute time since the last start time.
 	f64 getTime();
+	// Virtual time only advances by the frame delta time, so the timing seen by the game can be recorded
+	// and replayed exactly (see TFE_Demo).
+	void enableVirtualTime(bool enable);
+	// Replace the delta time of the current frame, call after update() with virtual time enabled.
+	void setFrameDeltaTime(f64 dt);
 
 	u64 getCurrentTimeInTicks();
 	f64 convertFromTicksToSeconds(u64 ticks);
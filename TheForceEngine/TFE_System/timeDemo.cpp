@@ -0,0 +1,180 @@
+#include <cstring>
+
+#include "timeDemo.h"
+#include "profiler.h"
+#include "system.h"
+#include <TFE_FileSystem/filestream.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace TFE_TimeDemo
+{
+	// The first frames in the level include the level load and the loading screen, so they are not recorded.
+	#define TIMEDEMO_WARMUP_FRAMES 4
+
+	struct ZoneSamples
+	{
+		std::string name;
+		std::vector<f64> time;	// time per frame in milliseconds from the first frame the zone was seen, 0 when it was not entered.
+	};
+
+	typedef std::map<std::string, u32> ZoneMap;
+
+	static bool s_active = false;
+	static char s_levelName[TFE_MAX_PATH];
+	static u32  s_frameCount = 0;
+	static u32  s_frame = 0;
+	static u32  s_warmup = 0;
+
+	static ZoneMap s_zoneMap;
+	static std::vector<ZoneSamples> s_zones;
+	static ZoneSamples s_frameTime;
+
+	void begin(const char* levelName, u32 frameCount)
+	{
+		end();
+		strncpy(s_levelName, levelName, TFE_MAX_PATH - 1);
+		s_levelName[TFE_MAX_PATH - 1] = 0;
+		s_frameCount = std::max(frameCount, 1u);
+		s_frame = 0;
+		s_warmup = TIMEDEMO_WARMUP_FRAMES;
+		s_active = true;
+
+		s_frameTime.name = "Frame";
+		s_frameTime.time.reserve(s_frameCount);
+		TFE_System::logWrite(LOG_MSG, "TimeDemo", "Time demo started: level '%s', %u frames.", s_levelName, s_frameCount);
+	}
+
+	void end()
+	{
+		s_active = false;
+		s_zoneMap.clear();
+		s_zones.clear();
+		s_frameTime.time.clear();
+	}
+
+	bool isActive()
+	{
+		return s_active;
+	}
+
+	const char* getLevelName()
+	{
+		return s_levelName;
+	}
+
+	bool recordFrame()
+	{
+		if (!s_active) { return false; }
+		if (s_frame >= s_frameCount) { return false; }
+		if (s_warmup)
+		{
+			s_warmup--;
+			return true;
+		}
+
+		s_frameTime.time.push_back(TFE_Profiler::getTimeInFrame() * 1000.0);
+
+		// Zones are listed depth first, so the call path of each zone can be built from the zones before it.
+		// The path is used as the name, since the same zone can be entered from different parents.
+		std::vector<std::string> path;
+		const u32 zoneCount = TFE_Profiler::getZoneCount();
+		for (u32 z = 0; z < zoneCount; z++)
+		{
+			TFE_ZoneInfo info;
+			TFE_Profiler::getZoneInfo(z, &info);
+
+			path.resize(info.level);
+			std::string name = path.empty() ? info.name : path.back() + "/" + info.name;
+			path.push_back(name);
+
+			u32 id;
+			ZoneMap::iterator iZone = s_zoneMap.find(name);
+			if (iZone == s_zoneMap.end())
+			{
+				id = (u32)s_zones.size();
+				s_zoneMap[name] = id;
+
+				s_zones.push_back({});
+				s_zones[id].name = name;
+				s_zones[id].time.reserve(s_frameCount);
+			}
+			else
+			{
+				id = iZone->second;
+			}
+			s_zones[id].time.push_back(info.timeInZone * 1000.0);
+		}
+
+		s_frame++;
+		return s_frame < s_frameCount;
+	}
+
+	void writeJsonString(FileStream& file, const char* str)
+	{
+		std::string escaped;
+		for (const char* c = str; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') { escaped += '\\'; }
+			escaped += *c;
+		}
+		file.writeString("\"%s\"", escaped.c_str());
+	}
+
+	void writeZone(FileStream& file, ZoneSamples& zone, bool last)
+	{
+		std::vector<f64>& time = zone.time;
+		const size_t count = time.size();
+		if (!count) { return; }
+
+		std::sort(time.begin(), time.end());
+		f64 total = 0.0;
+		for (size_t i = 0; i < count; i++)
+		{
+			total += time[i];
+		}
+		// Nearest rank percentile.
+		const size_t p99 = std::min(count - 1, (count * 99 + 99) / 100 - 1);
+
+		file.writeString("    { \"name\": ");
+		writeJsonString(file, zone.name.c_str());
+		file.writeString(", \"frames\": %u, \"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+			u32(count), time[0], total / f64(count), time[p99], time[count - 1], last ? "" : ",");
+	}
+
+	bool writeResults(const char* path)
+	{
+		FileStream file;
+		if (!file.open(path, Stream::MODE_WRITE))
+		{
+			TFE_System::logWrite(LOG_ERROR, "TimeDemo", "Cannot write time demo results to '%s'.", path);
+			return false;
+		}
+
+		file.writeString("{\n");
+		file.writeString("  \"level\": ");
+		writeJsonString(file, s_levelName);
+		file.writeString(",\n  \"frames\": %u,\n", s_frame);
+		file.writeString("  \"zones\":\n  [\n");
+
+		// Zones that were never entered are skipped, which can only happen for the frame time if no frames were recorded.
+		std::vector<ZoneSamples*> zones;
+		if (!s_frameTime.time.empty()) { zones.push_back(&s_frameTime); }
+		for (size_t i = 0; i < s_zones.size(); i++)
+		{
+			zones.push_back(&s_zones[i]);
+		}
+		for (size_t i = 0; i < zones.size(); i++)
+		{
+			writeZone(file, *zones[i], i + 1 == zones.size());
+		}
+
+		file.writeString("  ]\n}\n");
+		file.close();
+
+		TFE_System::logWrite(LOG_MSG, "TimeDemo", "Time demo finished: %u frames, results written to '%s'.", s_frame, path);
+		return true;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+//////////////////////////////////////////////////////////////////////
+// The Force Engine Time Demo
+// Runs a level for a fixed number of frames and gathers the frame
+// time of each profiler zone, so that performance can be compared
+// between builds (see the -timedemo command line option).
+//
+// Results are reported as min / average / 99th percentile per zone
+// in milliseconds and written as JSON.
+//////////////////////////////////////////////////////////////////////
+#include "types.h"
+
+namespace TFE_TimeDemo
+{
+	void begin(const char* levelName, u32 frameCount);
+	void end();
+
+	bool isActive();
+	const char* getLevelName();
+
+	// Call right after TFE_FRAME_BEGIN() when the previous frame was spent in the level,
+	// this records the profiler results of that frame.
+	// Returns false once all of the frames have been recorded.
+	bool recordFrame();
+
+	// Write the results to 'path' as JSON, returns false if the file cannot be written.
+	bool writeResults(const char* path);
+}
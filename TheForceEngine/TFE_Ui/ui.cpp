@@ -1,6 +1,8 @@
 #include <TFE_Ui/ui.h>
 #include <TFE_FileSystem/paths.h>
 #include <TFE_FileSystem/fileutil.h>
+#include <TFE_RenderBackend/renderBackend.h>
+#include <TFE_System/system.h>
 
 #include "imGUI/imgui.h"
 #include "imGUI/imgui_impl_sdl.h"
@@ -15,6 +17,9 @@ namespace TFE_Ui
 const char* glsl_version = "#version 130";
 SDL_Window* s_window = nullptr;
 static s32 s_uiScale = 100;
+// Set when there is no window (headless render backend), the UI is updated as normal but never drawn.
+static bool s_headless = false;
+static u64 s_prevFrameTime = 0;
 
 bool init(void* window, void* context, s32 uiScale)
 {
@@ -32,8 +37,12 @@ bool init(void* window, void* context, s32 uiScale)
 
 	// Setup Platform/Renderer bindings
 	s_window = (SDL_Window*)window;
-	ImGui_ImplSDL2_InitForOpenGL(s_window, context);
-	ImGui_ImplOpenGL3_Init(glsl_version);
+	s_headless = (window == nullptr);
+	if (!s_headless)
+	{
+		ImGui_ImplSDL2_InitForOpenGL(s_window, context);
+		ImGui_ImplOpenGL3_Init(glsl_version);
+	}
 
 	// Set the default font (13 px)
 	// TODO: Allow scaled UI, so loading a different font for larger scales.
@@ -62,8 +71,11 @@ void shutdown()
 {
 	TFE_Markdown::shutdown();
 
-	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplSDL2_Shutdown();
+	if (!s_headless)
+	{
+		ImGui_ImplOpenGL3_Shutdown();
+		ImGui_ImplSDL2_Shutdown();
+	}
 	ImGui::DestroyContext();
 }
 
@@ -79,21 +91,53 @@ s32 getUiScale()
 
 void setUiInput(const void* inputEvent)
 {
+	if (s_headless) { return; }
 	const SDL_Event* sdlEvent = (SDL_Event*)inputEvent;
 	ImGui_ImplSDL2_ProcessEvent(sdlEvent);
 }
 
+void beginHeadless()
+{
+	ImGuiIO& io = ImGui::GetIO();
+	// The font atlas would normally be built when the renderer creates the font texture.
+	if (!io.Fonts->IsBuilt())
+	{
+		u8* pixels;
+		s32 width, height;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	}
+
+	DisplayInfo displayInfo;
+	TFE_RenderBackend::getDisplayInfo(&displayInfo);
+	io.DisplaySize = ImVec2(f32(displayInfo.width), f32(displayInfo.height));
+
+	const u64 curTime = TFE_System::getCurrentTimeInTicks();
+	const f64 dt = s_prevFrameTime ? TFE_System::convertFromTicksToSeconds(curTime - s_prevFrameTime) : 0.0;
+	io.DeltaTime = dt > 0.0 ? f32(dt) : 1.0f / 60.0f;
+	s_prevFrameTime = curTime;
+}
+
 void begin()
 {
-	ImGui_ImplOpenGL3_NewFrame();
-	ImGui_ImplSDL2_NewFrame(s_window);
+	if (s_headless)
+	{
+		beginHeadless();
+	}
+	else
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplSDL2_NewFrame(s_window);
+	}
 	ImGui::NewFrame();
 }
 
 void render()
 {
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	if (!s_headless)
+	{
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
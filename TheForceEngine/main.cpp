@@ -3,9 +3,12 @@
 #include <SDL.h>
 #include <TFE_System/types.h>
 #include <TFE_System/profiler.h>
+#include <TFE_System/timeDemo.h>
 #include <TFE_Memory/memoryRegion.h>
+#include <TFE_Memory/memoryTracker.h>
 #include <TFE_Archive/gobArchive.h>
 #include <TFE_Game/igame.h>
+#include <TFE_Game/demo.h>
 #include <TFE_Game/saveSystem.h>
 #include <TFE_Game/reticle.h>
 #include <TFE_Jedi/InfSystem/infSystem.h>
@@ -21,6 +24,7 @@
 #include <TFE_System/CrashHandler/crashHandler.h>
 #include <TFE_System/tfeMessage.h>
 #include <TFE_Jedi/Task/task.h>
+#include <TFE_Jedi/Renderer/jediRenderer.h>
 #include <TFE_RenderShared/texturePacker.h>
 #include <TFE_Asset/paletteAsset.h>
 #include <TFE_Asset/imageAsset.h>
@@ -70,6 +74,10 @@ static char s_screenshotTime[TFE_MAX_PATH];
 static s32  s_startupGame = -1;
 static IGame* s_curGame = nullptr;
 static const char* s_loadRequestFilename = nullptr;
+static char s_startLevelArgs[2][TFE_MAX_PATH];
+static const char* s_recordDemoPath = nullptr;
+static const char* s_recordDemoLevel = nullptr;
+static const char* s_playDemoPath = nullptr;
 
 void parseOption(const char* name, const std::vector<const char*>& values, bool longName);
 bool validatePath();
@@ -161,22 +169,44 @@ void handleEvent(SDL_Event& Event)
 				{
 					static u64 _gifIndex = 0;
 					static bool _recording = false;
+					static bool _streaming = false;
+
+					// Resizing the window ends the stream, so the next press should start a new recording.
+					if (_recording && _streaming && !TFE_RenderBackend::isStreamRecording())
+					{
+						_recording = false;
+						_streaming = false;
+					}
 
 					if (!_recording)
 					{
 						char screenshotDir[TFE_MAX_PATH];
 						TFE_Paths::appendPath(TFE_PathType::PATH_USER_DOCUMENTS, "Screenshots/", screenshotDir);
 
-						char gifPath[TFE_MAX_PATH];
-						sprintf(gifPath, "%stfe_gif_%s_%llu.gif", screenshotDir, s_screenshotTime, _gifIndex);
+						// GIF or a video stream, which records every frame to disk as it goes.
+						const char* c_recordingExt[] = { "gif", "y4m", "rgba", "tfev" };
+						s32 format = TFE_Settings::getGraphicsSettings()->recordingFormat;
+						if (format < 0 || format >= RECORDING_COUNT) { format = RECORDING_GIF; }
+
+						char recordingPath[TFE_MAX_PATH];
+						sprintf(recordingPath, "%stfe_%s_%s_%llu.%s", screenshotDir, format == RECORDING_GIF ? "gif" : "video", s_screenshotTime, _gifIndex, c_recordingExt[format]);
 						_gifIndex++;
 
-						TFE_RenderBackend::startGifRecording(gifPath);
-						_recording = true;
+						_streaming = format != RECORDING_GIF;
+						if (_streaming)
+						{
+							_recording = TFE_RenderBackend::startStreamRecording(recordingPath, format - 1);
+						}
+						else
+						{
+							TFE_RenderBackend::startGifRecording(recordingPath);
+							_recording = true;
+						}
 					}
 					else
 					{
-						TFE_RenderBackend::stopGifRecording();
+						if (_streaming) { TFE_RenderBackend::stopStreamRecording(); }
+						else { TFE_RenderBackend::stopGifRecording(); }
 						_recording = false;
 					}
 				}
@@ -239,7 +269,9 @@ bool sdlInit()
 {
 	// Audio is handled outside of SDL2.
 	// Using the Force Engine Audio system for sound mixing, FluidSynth for Midi handling and rtAudio for audio I/O.
-	const int code = SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER);
+	// The headless render backend has no window, so video is not initialized and the window settings are used as-is.
+	const bool headless = TFE_RenderBackend::isHeadless();
+	const int code = SDL_Init(headless ? (SDL_INIT_TIMER | SDL_INIT_EVENTS) : (SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER));
 	if (code != 0) { return false; }
 
 	TFE_Settings_Window* windowSettings = TFE_Settings::getWindowSettings();
@@ -248,6 +280,12 @@ bool sdlInit()
 	s_displayHeight    = windowSettings->height;
 	s_baseWindowWidth  = windowSettings->baseWidth;
 	s_baseWindowHeight = windowSettings->baseHeight;
+	if (headless)
+	{
+		s_monitorWidth  = s_displayWidth;
+		s_monitorHeight = s_displayHeight;
+		return true;
+	}
 
 	// Get the displays and their bounds.
 	s_displayIndex = TFE_RenderBackend::getDisplayIndex(windowSettings->x, windowSettings->y);
@@ -375,6 +413,7 @@ void setAppState(AppState newState, int argc, char* argv[])
 				}
 				s_curGame = createGame(gameInfo->id);
 				TFE_SaveSystem::setCurrentGame(s_curGame);
+				TFE_Demo::onGameCreated(s_curGame);
 				if (!s_curGame)
 				{
 					TFE_System::logWrite(LOG_ERROR, "AppMain", "Cannot create game '%s'.", gameInfo->game);
@@ -584,12 +623,20 @@ int main(int argc, char* argv[])
 	}
 	TFE_Settings_Window* windowSettings = TFE_Settings::getWindowSettings();
 	TFE_Settings_Graphics* graphics = TFE_Settings::getGraphicsSettings();
-	TFE_System::init(s_refreshRate, graphics->vsync, c_gitVersion);
+	// Time demos run unsynced using the software renderer, the settings are restored before they are written back out.
+	const bool timeDemo = TFE_TimeDemo::isActive();
+	const s32 rendererIndex = graphics->rendererIndex;
+	const bool vsync = graphics->vsync && !timeDemo;
+	if (timeDemo)
+	{
+		graphics->rendererIndex = RENDERER_SOFTWARE;
+	}
+	TFE_System::init(s_refreshRate, vsync, c_gitVersion);
 	
 	// Setup the GPU Device and Window.
 	u32 windowFlags = 0;
 	if (windowSettings->fullscreen) { TFE_System::logWrite(LOG_MSG, "Display", "Fullscreen enabled."); windowFlags |= WINFLAG_FULLSCREEN; }
-	if (graphics->vsync) { TFE_System::logWrite(LOG_MSG, "Display", "Vertical Sync enabled."); windowFlags |= WINFLAG_VSYNC; }
+	if (vsync) { TFE_System::logWrite(LOG_MSG, "Display", "Vertical Sync enabled."); windowFlags |= WINFLAG_VSYNC; }
 	
 	WindowState windowState =
 	{
@@ -621,6 +668,22 @@ int main(int argc, char* argv[])
 	inputMapping_startup();
 	TFE_SaveSystem::init();
 
+	// Demos are started once the input mapping has been restored, since playback overrides the mouse settings.
+	bool demoFailed = false;
+	if (s_playDemoPath)
+	{
+		demoFailed = !TFE_Demo::startPlayback(s_playDemoPath);
+	}
+	else if (s_recordDemoPath)
+	{
+		demoFailed = !TFE_Demo::startRecording(s_recordDemoPath, s_recordDemoLevel);
+	}
+	const bool demo = TFE_Demo::isRecording() || TFE_Demo::isPlaying();
+	if (demoFailed)
+	{
+		s_loop = false;
+	}
+
 	// Uncomment to test memory region allocator.
 	// TFE_Memory::region_test();
 
@@ -637,7 +700,16 @@ int main(int argc, char* argv[])
 	#endif
 
 	// Start up the game and skip the title screen.
-	if (firstRun)
+	if (timeDemo || demo)
+	{
+		if (!validatePath())
+		{
+			TFE_System::logWrite(LOG_ERROR, timeDemo ? "TimeDemo" : "Demo", "Cannot run the demo, the game data is missing.");
+			s_loop = false;
+		}
+		TFE_FrontEndUI::setAppState(APP_STATE_GAME);
+	}
+	else if (firstRun)
 	{
 		TFE_FrontEndUI::setAppState(APP_STATE_SET_DEFAULTS);
 	}
@@ -646,6 +718,25 @@ int main(int argc, char* argv[])
 		TFE_FrontEndUI::setAppState(APP_STATE_GAME);
 	}
 
+	// Start the demo level directly, skipping cutscenes and the mission briefing.
+	// When a time demo measures demo playback, the level recorded in the demo is used.
+	const char* startLevel = demo ? TFE_Demo::getLevelName() : (timeDemo ? TFE_TimeDemo::getLevelName() : nullptr);
+	char* startLevelArgs[16];
+	if (startLevel)
+	{
+		s32 argCount = 0;
+		for (s32 i = 0; i < argc && i < 14; i++)
+		{
+			startLevelArgs[argCount++] = argv[i];
+		}
+		sprintf(s_startLevelArgs[0], "-c0");
+		sprintf(s_startLevelArgs[1], "-l%s", startLevel);
+		startLevelArgs[argCount++] = s_startLevelArgs[0];
+		startLevelArgs[argCount++] = s_startLevelArgs[1];
+		argc = argCount;
+		argv = startLevelArgs;
+	}
+
 	// Try to set the game right away, so the load menu works.
 	TFE_Game* gameInfo = TFE_Settings::getGame();
 	TFE_SaveSystem::setCurrentGame(gameInfo->id);
@@ -654,10 +745,18 @@ int main(int argc, char* argv[])
 	u32 frame = 0u;
 	bool showPerf = false;
 	bool relativeMode = false;
+	bool timeDemoFrame = false;
+	bool timeDemoComplete = false;
 	TFE_System::logWrite(LOG_MSG, "Progam Flow", "The Force Engine Game Loop Started");
 	while (s_loop && !TFE_System::quitMessagePosted())
 	{
 		TFE_FRAME_BEGIN();
+		// The profiler results of the previous frame are available once the next frame has begun.
+		if (timeDemoFrame && !TFE_TimeDemo::recordFrame())
+		{
+			timeDemoComplete = true;
+			s_loop = false;
+		}
 		
 		bool enableRelative = TFE_Input::relativeModeEnabled();
 		if (enableRelative != relativeMode)
@@ -726,6 +825,7 @@ int main(int argc, char* argv[])
 
 		TFE_Ui::begin();
 		TFE_System::update();
+		TFE_Demo::updateTime();
 
 		// Update
 		if (TFE_FrontEndUI::uiControlsEnabled() && task_canRun())
@@ -820,9 +920,15 @@ int main(int argc, char* argv[])
 			}
 			else
 			{
+				TFE_Demo::updateInput();
 				TFE_SaveSystem::update();
 				s_curGame->loopGame();
 				endInputFrame = TFE_Jedi::task_run() != 0;
+				if (!TFE_Demo::endFrame(s_curGame))
+				{
+					// Demo playback is complete.
+					s_loop = false;
+				}
 			}
 		}
 		else
@@ -846,14 +952,48 @@ int main(int argc, char* argv[])
 			TFE_Input::endFrame();
 			inputMapping_endFrame();
 		}
+		TFE_Memory::memtrack_frameEnd();
 		frame++;
 
+		if (timeDemo)
+		{
+			// Only frames that are spent in the level are recorded, stop if the game failed to start.
+			timeDemoFrame = endInputFrame && s_curState == APP_STATE_GAME && s_curGame && s_curGame->canSave();
+			if (s_curState == APP_STATE_CANNOT_RUN || s_curState == APP_STATE_NO_GAME_DATA)
+			{
+				TFE_System::logWrite(LOG_ERROR, "TimeDemo", "Cannot run the time demo, the game failed to start.");
+				s_loop = false;
+			}
+		}
+		else if (demo && (s_curState == APP_STATE_CANNOT_RUN || s_curState == APP_STATE_NO_GAME_DATA))
+		{
+			TFE_System::logWrite(LOG_ERROR, "Demo", "Cannot run the demo, the game failed to start.");
+			s_loop = false;
+		}
+
 		if (endInputFrame)
 		{
 			TFE_FRAME_END();
 		}
 	}
 
+	if (timeDemo)
+	{
+		if (timeDemoComplete)
+		{
+			char resultPath[TFE_MAX_PATH];
+			char resultName[TFE_MAX_PATH];
+			sprintf(resultName, "timedemo_%s.json", TFE_TimeDemo::getLevelName());
+			TFE_Paths::appendPath(TFE_PathType::PATH_USER_DOCUMENTS, resultName, resultPath);
+			timeDemoComplete = TFE_TimeDemo::writeResults(resultPath);
+		}
+		TFE_TimeDemo::end();
+		graphics->rendererIndex = rendererIndex;
+	}
+	// Stop the demo before the input mapping is serialized, so the mouse settings are restored.
+	TFE_Demo::stop();
+	const bool demoDiverged = TFE_Demo::getDivergenceCount() > 0;
+
 	if (s_curGame)
 	{
 		freeGame(s_curGame);
@@ -881,7 +1021,7 @@ int main(int argc, char* argv[])
 	TFE_System::logWrite(LOG_MSG, "Progam Flow", "The Force Engine Game Loop Ended.");
 	TFE_System::logClose();
 	TFE_System::freeMessages();
-	return PROGRAM_SUCCESS;
+	return ((timeDemo && !timeDemoComplete) || demoFailed || demoDiverged) ? PROGRAM_ERROR : PROGRAM_SUCCESS;
 }
 
 void parseOption(const char* name, const std::vector<const char*>& values, bool longName)
@@ -903,6 +1043,29 @@ void parseOption(const char* name, const std::vector<const char*>& values, bool
 			// -noaudio
 			s_nullAudioDevice = true;
 		}
+		else if (strcasecmp(name, "timedemo") == 0 && values.size() >= 2)
+		{
+			// -timedemo SECBASE 1000
+			const s32 frameCount = atoi(values[1]);
+			if (frameCount > 0)
+			{
+				s_startupGame = Game_Dark_Forces;
+				TFE_TimeDemo::begin(values[0], u32(frameCount));
+			}
+		}
+		else if (strcasecmp(name, "recorddemo") == 0 && values.size() >= 2)
+		{
+			// -recorddemo SECBASE secbase.dem
+			s_startupGame = Game_Dark_Forces;
+			s_recordDemoLevel = values[0];
+			s_recordDemoPath = values[1];
+		}
+		else if (strcasecmp(name, "playdemo") == 0 && values.size() >= 1)
+		{
+			// -playdemo secbase.dem
+			s_startupGame = Game_Dark_Forces;
+			s_playDemoPath = values[0];
+		}
 	}
 	else  // long names use the more traditional style of arguments which allow for multiple values.
 	{